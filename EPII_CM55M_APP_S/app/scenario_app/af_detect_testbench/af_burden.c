@@ -0,0 +1,69 @@
+/*
+ * af_burden.c
+ *
+ * See af_burden.h. Integer only, it runs once per window next to the model.
+ */
+#include <string.h>
+#include "af_burden.h"
+
+void af_burden_init(af_burden_t *b, const af_burden_cfg_t *cfg)
+{
+	memset(b, 0, sizeof(*b));
+	b->cfg = *cfg;
+}
+
+static int af_burden_end(af_burden_t *b, af_episode_t *ended)
+{
+	uint32_t len = b->now_ms - b->start_ms;
+
+	b->in_af = 0;
+	if (len < b->cfg.min_ms) {
+		return 0;
+	}
+	b->af_ms += len;
+	b->episodes++;
+	if (len > b->longest_ms) {
+		b->longest_ms = len;
+	}
+	if (ended) {
+		ended->start_ms = b->start_ms;
+		ended->length_ms = len;
+	}
+	return 1;
+}
+
+int af_burden_update(af_burden_t *b, int score_pct, uint32_t elapsed_ms, af_episode_t *ended)
+{
+	int32_t score = (score_pct < 0 ? 0 : score_pct > 100 ? 100 : score_pct) << 8;
+
+	/* the window ends now, its score holds for the time since the one before */
+	b->now_ms += elapsed_ms;
+	if (!b->primed) {
+		b->ema = score;
+		b->primed = 1;
+	} else {
+		b->ema += (score - b->ema) >> b->cfg.ema_shift;
+	}
+
+	if (!b->in_af) {
+		if (b->ema >= ((int32_t)b->cfg.on_pct << 8)) {
+			b->in_af = 1;
+			b->start_ms = b->now_ms - elapsed_ms;
+		}
+		return 0;
+	}
+	if (b->ema < ((int32_t)b->cfg.off_pct << 8)) {
+		return af_burden_end(b, ended);
+	}
+	return 0;
+}
+
+int af_burden_close(af_burden_t *b, af_episode_t *ended)
+{
+	return b->in_af ? af_burden_end(b, ended) : 0;
+}
+
+uint32_t af_burden_permille(const af_burden_t *b)
+{
+	return b->now_ms ? (uint32_t)((uint64_t)b->af_ms * 1000 / b->now_ms) : 0;
+}
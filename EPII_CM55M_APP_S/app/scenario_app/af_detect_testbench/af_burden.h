@@ -0,0 +1,77 @@
+#ifndef AF_BURDEN_H
+#define AF_BURDEN_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+/*
+ * AF episodes and burden from a stream of window scores.
+ *
+ * With a window every beat, one ectopic run or one noisy window flips the
+ * raw decision back and forth. The scores are smoothed instead:
+ *
+ *   score (0..100) -> EMA, weight 1/2^ema_shift
+ *                  -> AF from on_pct up, until the EMA falls below off_pct
+ *                  -> an episode counts if it lasts at least min_ms
+ *
+ * Time is the RR intervals of the beats between windows, so the burden is
+ * the share of the monitored time spent in counted episodes. The smoothing
+ * delays onset and end by a few windows alike, the episode length is kept.
+ */
+
+typedef struct {
+	uint8_t ema_shift;			/**< EMA weight 1/2^ema_shift, 0 takes the scores as they are */
+	uint8_t on_pct;				/**< smoothed score that starts an episode */
+	uint8_t off_pct;			/**< smoothed score below which it ends */
+	uint32_t min_ms;			/**< shorter episodes are not counted */
+} af_burden_cfg_t;
+
+typedef struct {
+	af_burden_cfg_t cfg;
+	int32_t ema;				/**< smoothed score, percent << 8 */
+	uint8_t primed;
+	uint8_t in_af;
+	uint32_t now_ms;			/**< monitored time */
+	uint32_t start_ms;			/**< of the open episode */
+	uint32_t af_ms;				/**< in counted episodes, the open one excluded */
+	uint32_t episodes;			/**< counted, the open one excluded */
+	uint32_t longest_ms;
+} af_burden_t;
+
+/** An episode reported by af_burden_update() */
+typedef struct {
+	uint32_t start_ms;
+	uint32_t length_ms;
+} af_episode_t;
+
+void af_burden_init(af_burden_t *b, const af_burden_cfg_t *cfg);
+
+/**
+ * @brief Adds the score of a window.
+ *
+ * @param score_pct AF score of the window, 0..100.
+ * @param elapsed_ms Time since the previous window, the RR intervals of
+ *        the beats in between.
+ * @param ended Set to the episode that ended with this window, if any.
+ * @return 1 if a counted episode ended, 0 otherwise.
+ */
+int af_burden_update(af_burden_t *b, int score_pct, uint32_t elapsed_ms, af_episode_t *ended);
+
+/**
+ * @brief Ends the open episode, e.g. at the end of the record.
+ *
+ * @return 1 if it was counted, with it in ended.
+ */
+int af_burden_close(af_burden_t *b, af_episode_t *ended);
+
+/** Share of the monitored time in counted episodes, in 1/1000 */
+uint32_t af_burden_permille(const af_burden_t *b);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // AF_BURDEN_H
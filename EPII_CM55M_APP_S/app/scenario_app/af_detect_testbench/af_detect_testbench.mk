@@ -14,23 +14,61 @@ APPL_DEFINES += -DEVT_DATAPATH
 #APPL_DEFINES += -DEVT_CM55MTIMER -DEVT_CM55MMB
 APPL_DEFINES += -DDBG_MORE
 
+# Use the model placement generated by model_placement/model_placement_planner.py
+# (model_placement.h / model_placement.ld) instead of the settings in common_config.h
+#APPL_DEFINES += -DMODEL_PLACEMENT_PLAN
+
 # Add model include path relative to the project root
 APPL_DEFINES += -I$(SCENARIO_APP_ROOT)/$(APP_TYPE)/$(dir $(MODEL_PATH))
 
 # Add the selected model to source files
 SRC_FILES += $(MODEL_PATH)
 
+# Optional non-vela (CMSIS-NN) build of the same model for AF_BACKEND_SEL in common_config.h.
+# The .cc must define: alignas(16) const unsigned char model_data_cpu[]
+#MODEL_CPU_PATH ?= models/v2_0_1_model_dense/model_cpu.cc
+ifneq ($(strip $(MODEL_CPU_PATH)),)
+APPL_DEFINES += -DAF_CPU_MODEL
+SRC_FILES += $(MODEL_CPU_PATH)
+# CMSIS-NN (Helium) kernels instead of the TFLM reference kernels
+override LIB_CMSIS_NN_ENALBE := 1
+override LIB_CMSIS_NN_VERSION := 7_0_0
+endif
+
+# Optional interpreter-free build of the same model, generated by
+# model_codegen/tflite_codegen.py --name af (af_compiled.cc / af_compiled.h).
+# Selected by AF_BACKEND_SEL in common_config.h.
+#MODEL_COMPILED_PATH ?= models/v2_0_1_model_dense/af_compiled.cc
+ifneq ($(strip $(MODEL_COMPILED_PATH)),)
+APPL_DEFINES += -DAF_COMPILED_MODEL
+APPL_DEFINES += -I$(SCENARIO_APP_ROOT)/$(APP_TYPE)/$(dir $(MODEL_COMPILED_PATH))
+SRC_FILES += $(MODEL_COMPILED_PATH)
+override LIB_CMSIS_NN_ENALBE := 1
+override LIB_CMSIS_NN_VERSION := 7_0_0
+endif
+
 # Rest of your existing Makefile remains unchanged...
 EVENTHANDLER_SUPPORT = event_handler
 EVENTHANDLER_SUPPORT_LIST += evt_datapath
 
-LIB_SEL = pwrmgmt sensordp tflmtag2412_u55tag2411 spi_ptl spi_eeprom hxevent
+LIB_SEL = pwrmgmt sensordp tflmtag2412_u55tag2411 spi_ptl spi_eeprom hxevent lpsched rrfe imuact cmsis_dsp dlog
 
 MID_SEL = fatfs
 FATFS_PORT_LIST = mmc_spi
 CMSIS_DRIVERS_LIST = SPI
 
+# FreeRTOS build: SD reader, inference and result writer tasks (af_rtos_pipeline.h)
+AF_TESTBENCH_RTOS ?= n
+ifeq ($(strip $(AF_TESTBENCH_RTOS)), y)
+override OS_SEL := freertos_10_5_1
+override OS_HAL := n
+override MPU := n
+APPL_DEFINES += -DAF_TESTBENCH_RTOS
+# per task run time for the utilization report, counter in af_rtos_port.c
+APPL_DEFINES += -DconfigGENERATE_RUN_TIME_STATS=1
+else
 override OS_SEL:=
+endif
 override TRUSTZONE := y
 override TRUSTZONE_TYPE := security
 override TRUSTZONE_FW_TYPE := 1
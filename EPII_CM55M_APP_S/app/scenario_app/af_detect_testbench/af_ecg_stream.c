@@ -0,0 +1,390 @@
+/*
+ * af_ecg_stream.c
+ *
+ * See af_ecg_stream.h. The model runs in the beat callback, between two
+ * chunks of the signal file, as it would between two sensor FIFO reads.
+ */
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "WE2_device.h"
+#include "WE2_core.h"
+#include "xprintf.h"
+#include "ff.h"
+#include "common_config.h"
+#include "af_model_run.h"
+#include "sd_card_testbench.h"
+#include "hx_rrfe.h"
+#include "hx_wfdb.h"
+#include "af_burden.h"
+#include "af_ecg_stream.h"
+#if AF_IMU_GATE
+#include "hx_icmfifo.h"
+#include "hx_imuact.h"
+#endif
+
+#if (MODEL_INPUT_TIMESTEPS * MODEL_INPUT_FEATURES > HX_RRFE_MAX_RR)
+#error "the model window is longer than the RR history of the front end (HX_RRFE_MAX_RR)"
+#endif
+#if AF_ECG_INCREMENTAL && ((AF_ECG_STRIDE != 1) || (MODEL_INPUT_FEATURES != 1))
+#error "AF_ECG_INCREMENTAL needs a window every beat (AF_ECG_STRIDE 1) of one RR interval per time step"
+#endif
+
+#define AF_ECG_CHUNK	510		/* signal file bytes per read, whole frames of format 16 and 212 */
+#define AF_ECG_HEA_MAX	1024
+#define AF_ECG_CPU_CLK	(0xffffff + 1)
+#define AF_ECG_WINDOW_RR	(MODEL_INPUT_TIMESTEPS * MODEL_INPUT_FEATURES)
+#define AF_IMU_CHUNK	(16 * 32)	/* FIFO dump bytes per read, 320 ms at 100 Hz */
+#define AF_ECG_RR_LOW_MS	300		/* RR intervals checked against AF_RR_SCALE, 200 to 30 bpm */
+#define AF_ECG_RR_HIGH_MS	2000
+
+typedef struct {
+	const af_model_image_t *image;
+	char prefix[MODEL_PREFIX_LEN + 4];
+	test_sample_t sample;
+	uint32_t fs_hz;
+	uint32_t beats;
+	uint32_t windows;
+	uint32_t failed;
+	uint32_t mismatched;			/* AF_ECG_INCREMENTAL 2: windows where the two differ */
+	uint64_t model_cycles;			/* inference and saving, inside hx_rrfe_process() */
+	uint64_t infer_cycles;			/* inference alone */
+	uint64_t naive_cycles;			/* AF_ECG_INCREMENTAL 2: run_af_model() */
+	uint32_t elapsed_ms;			/* since the last window */
+	af_burden_t burden;
+#if AF_IMU_GATE
+	uint32_t beat_ms[AF_ECG_WINDOW_RR + 1];	/* the last beats, for the time span of a window */
+	uint32_t beat_head;
+	uint32_t motion;				/* windows in motion */
+	uint32_t motion_af;				/* AF_IMU_GATE 1: AF-positive ones among them */
+#endif
+} af_ecg_ctx_t;
+
+static hx_rrfe af_rrfe;
+static af_ecg_ctx_t af_ecg;
+static char af_ecg_hea[AF_ECG_HEA_MAX];
+static uint8_t af_ecg_chunk[AF_ECG_CHUNK];
+static int16_t af_ecg_samples[AF_ECG_CHUNK];
+#if AF_IMU_GATE
+static hx_imuact af_imu;
+static FIL af_imu_file;
+static int af_imu_open;
+static uint32_t af_imu_held;
+static uint8_t af_imu_chunk[AF_IMU_CHUNK + HX_ICMFIFO_PKT_MAX];
+static hx_icm_sample af_imu_samples[AF_IMU_CHUNK / 8 + 1];
+#endif
+
+static uint64_t af_ecg_cycles(void)
+{
+	uint32_t tick, loop;
+
+	SystemGetTick(&tick, &loop);
+	return (uint64_t)loop * AF_ECG_CPU_CLK + (AF_ECG_CPU_CLK - 1 - tick);
+}
+
+/* the window of the last MODEL_INPUT_TIMESTEPS RR intervals through run_af_model() */
+static int af_ecg_infer_window(af_ecg_ctx_t *ctx, int8_t *model_output)
+{
+	uint16_t rr_ms[MODEL_INPUT_TIMESTEPS * MODEL_INPUT_FEATURES];
+	uint32_t i, len = MODEL_INPUT_TIMESTEPS * MODEL_INPUT_FEATURES;
+
+	if (hx_rrfe_window(&af_rrfe, rr_ms, len) != len) {
+		return -1;
+	}
+	for (i = 0; i < len; i++) {
+		ctx->sample.x_data[i] = rr_ms[i] * AF_RR_SCALE;
+	}
+	return run_af_model(&ctx->sample, model_output, 1);
+}
+
+#if AF_IMU_GATE
+/* the IMU up to ms into the signal; a packet cut at the end of a read is
+ * kept for the next one */
+static void af_imu_feed(uint32_t ms)
+{
+	uint32_t count, used;
+	UINT n;
+
+	while (af_imu_open && hx_imuact_now_ms(&af_imu) < ms) {
+		if (f_read(&af_imu_file, af_imu_chunk + af_imu_held, AF_IMU_CHUNK, &n) != FR_OK || n == 0) {
+			f_close(&af_imu_file);
+			af_imu_open = 0;
+			return;
+		}
+		count = hx_icmfifo_parse(af_imu_chunk, af_imu_held + n, af_imu_samples,
+				sizeof(af_imu_samples) / sizeof(af_imu_samples[0]), &used);
+		hx_imuact_push(&af_imu, af_imu_samples, count);
+		af_imu_held = af_imu_held + n - used;
+		memmove(af_imu_chunk, af_imu_chunk + used, af_imu_held);
+	}
+}
+
+/* 1 if the window that ends with this beat was mostly heavy motion; without
+ * IMU data over it, it is not */
+static int af_imu_in_motion(af_ecg_ctx_t *ctx, const hx_rrfe_beat *beat)
+{
+	uint32_t now_ms = (uint32_t)((uint64_t)beat->sample * 1000 / ctx->fs_hz);
+	hx_imuact_summary sum;
+
+	ctx->beat_ms[ctx->beat_head] = now_ms;
+	ctx->beat_head = (ctx->beat_head + 1) % (AF_ECG_WINDOW_RR + 1);
+	/* the oldest kept beat starts the window */
+	hx_imuact_summarize(&af_imu, ctx->beat_ms[ctx->beat_head], now_ms, &sum);
+	return sum.epochs && sum.heavy_pct >= AF_IMU_GATE_PCT;
+}
+#endif
+
+static void af_ecg_episode(const af_episode_t *ep)
+{
+	xprintf("AF episode at %lu s, %lu s long\n", ep->start_ms / 1000, ep->length_ms / 1000);
+}
+
+static void af_ecg_beat(void *arg, const hx_rrfe_beat *beat)
+{
+	af_ecg_ctx_t *ctx = (af_ecg_ctx_t *)arg;
+	int8_t model_output[1];
+	af_episode_t ep;
+	uint64_t t0, t1;
+	FRESULT fr;
+	int ret;
+	int motion = 0;
+#if AF_ECG_INCREMENTAL
+	float rr;
+#endif
+
+	ctx->beats++;
+	ctx->elapsed_ms += beat->rr_ms;
+#if AF_IMU_GATE
+	motion = af_imu_in_motion(ctx, beat);
+#endif
+#if AF_ECG_INCREMENTAL
+	if (beat->rr_ms == 0) {
+		return;
+	}
+	/* every beat goes into the window, hx_rrfe_window() is not needed */
+	rr = (uint16_t)beat->rr_ms * AF_RR_SCALE;
+#if (AF_IMU_GATE == 2)
+	if (motion) {
+		/* the window still moves on, without an inference */
+		if (run_af_model_step(&rr, NULL, 0) == 0) {
+			ctx->motion++;
+			ctx->elapsed_ms = 0;
+		}
+		return;
+	}
+#endif
+	t0 = af_ecg_cycles();
+	ret = run_af_model_step(&rr, model_output, 1);
+	t1 = af_ecg_cycles();
+	if (ret == 1) {
+		ctx->model_cycles += t1 - t0;
+		return;
+	}
+#if (AF_ECG_INCREMENTAL == 2)
+	if (ret == 0) {
+		int8_t naive_output[1];
+		uint64_t t2 = af_ecg_cycles();
+
+		if (af_ecg_infer_window(ctx, naive_output) != 0 || naive_output[0] != model_output[0]) {
+			ctx->mismatched++;
+		}
+		ctx->naive_cycles += af_ecg_cycles() - t2;
+	}
+#endif
+#else
+	if (!beat->window_ready) {
+		return;
+	}
+#if (AF_IMU_GATE == 2)
+	if (motion) {
+		ctx->motion++;
+		ctx->elapsed_ms = 0;
+		return;
+	}
+#endif
+	t0 = af_ecg_cycles();
+	ret = af_ecg_infer_window(ctx, model_output);
+	t1 = af_ecg_cycles();
+#endif
+	ctx->infer_cycles += t1 - t0;
+	if (ret != 0) {
+		xprintf("Inference failed for window %lu\n", ctx->windows);
+		ctx->failed++;
+		ctx->model_cycles += af_ecg_cycles() - t0;
+		return;
+	}
+	fr = save_result_vector_bulk(ctx->windows, model_output, 1, ctx->prefix);
+	if (fr != FR_OK) {
+		xprintf("Failed to save results for window %lu: %d\n", ctx->windows, fr);
+	}
+	if (af_burden_update(&ctx->burden, af_model_score_pct(model_output[0]), ctx->elapsed_ms, &ep)) {
+		af_ecg_episode(&ep);
+	}
+	ctx->elapsed_ms = 0;
+	ctx->model_cycles += af_ecg_cycles() - t0;
+#if (AF_IMU_GATE == 1)
+	if (motion) {
+		ctx->motion++;
+		if (af_model_score_pct(model_output[0]) >= AF_BURDEN_ON_PCT) {
+			ctx->motion_af++;
+		}
+	}
+#endif
+#if AF_SAMPLE_LOG
+	xprintf("window %lu: beat at %lu ms%s, RR %lu ms, AF score %d%s\n", ctx->windows,
+			(uint32_t)((uint64_t)beat->sample * 1000 / ctx->fs_hz),
+			beat->searchback ? " (searchback)" : "", beat->rr_ms, model_output[0],
+			motion ? ", in motion" : "");
+#endif
+	ctx->windows++;
+}
+
+static FRESULT af_ecg_read_header(const char *path, hx_wfdb_header *hea)
+{
+	FIL file;
+	UINT n;
+	FRESULT fr;
+
+	fr = f_open(&file, path, FA_READ);
+	if (fr != FR_OK) {
+		return fr;
+	}
+	fr = f_read(&file, af_ecg_hea, sizeof(af_ecg_hea), &n);
+	f_close(&file);
+	if (fr != FR_OK) {
+		return fr;
+	}
+	return hx_wfdb_parse_header(hea, af_ecg_hea, n) == 0 ? FR_OK : FR_INVALID_OBJECT;
+}
+
+int af_ecg_stream_run(const af_model_image_t *image)
+{
+	char path[MAX_PATH_LEN];
+	const char *slash = strrchr(AF_ECG_RECORD, '/');
+	uint32_t dir_len = slash ? (uint32_t)(slash - AF_ECG_RECORD + 1) : 0;
+	hx_wfdb_header hea;
+	hx_wfdb_dec dec;
+	hx_rrfe_cfg cfg;
+	af_burden_cfg_t burden_cfg = { AF_BURDEN_EMA_SHIFT, AF_BURDEN_ON_PCT, AF_BURDEN_OFF_PCT, AF_BURDEN_MIN_MS };
+	af_episode_t ep;
+	FIL file;
+	UINT n;
+	FRESULT fr;
+	uint32_t samples = 0, clk = 0;
+	uint64_t busy = 0;
+
+	xsprintf(path, "%s.hea", AF_ECG_RECORD);
+	fr = af_ecg_read_header(path, &hea);
+	if (fr != FR_OK || hx_wfdb_dec_init(&dec, &hea, AF_ECG_CHANNEL) != 0) {
+		xprintf("Cannot read %s or signal %d of it: %d\n", path, AF_ECG_CHANNEL, fr);
+		return -1;
+	}
+
+	memset(&af_ecg, 0, sizeof(af_ecg));
+	af_ecg.image = image;
+	af_ecg.fs_hz = hea.fs_hz;
+	af_ecg.sample.x_data_size = X_TEST_VECTOR_SIZE;
+	af_ecg.sample.y_data_size = Y_TEST_VECTOR_SIZE;
+	xsprintf(af_ecg.prefix, "%secg_", image->result_prefix);
+	af_burden_init(&af_ecg.burden, &burden_cfg);
+	af_model_step_reset();
+#if AF_IMU_GATE
+	{
+		hx_imuact_cfg imu_cfg;
+
+		hx_imuact_default_cfg(&imu_cfg, AF_IMU_ODR_HZ, AF_IMU_LSB_PER_G);
+		hx_imuact_init(&af_imu, &imu_cfg, NULL, NULL);
+		af_imu_held = 0;
+		xsprintf(path, "%s.imu", AF_ECG_RECORD);
+		af_imu_open = f_open(&af_imu_file, path, FA_READ) == FR_OK;
+		if (!af_imu_open) {
+			xprintf("No %s, no motion gating\n", path);
+		}
+	}
+#endif
+
+	hx_rrfe_default_cfg(&cfg, AF_ECG_SIGNAL, hea.fs_hz);
+	cfg.window = MODEL_INPUT_TIMESTEPS * MODEL_INPUT_FEATURES;
+	cfg.stride = AF_ECG_STRIDE;
+	if (hx_rrfe_init(&af_rrfe, &cfg, af_ecg_beat, &af_ecg) != 0) {
+		xprintf("%s at %lu Hz does not fit the RR front end\n", AF_ECG_RECORD, hea.fs_hz);
+		return -1;
+	}
+
+	/* the signal file is next to the header */
+	memcpy(path, AF_ECG_RECORD, dir_len);
+	strncpy(path + dir_len, hea.sig[AF_ECG_CHANNEL].file, sizeof(path) - dir_len - 1);
+	path[sizeof(path) - 1] = '\0';
+	fr = f_open(&file, path, FA_READ);
+	if (fr != FR_OK) {
+		xprintf("Cannot open %s: %d\n", path, fr);
+		return -1;
+	}
+	xprintf("Streaming %s signal %d (%s, %lu Hz) through model '%s', a window every %d beats%s\n",
+			AF_ECG_RECORD, AF_ECG_CHANNEL, hea.sig[AF_ECG_CHANNEL].desc, hea.fs_hz, image->name,
+			AF_ECG_STRIDE, AF_ECG_INCREMENTAL ? ", incremental" : "");
+	if (!af_model_input_fits(AF_ECG_RR_LOW_MS * AF_RR_SCALE) || !af_model_input_fits(AF_ECG_RR_HIGH_MS * AF_RR_SCALE)) {
+		xprintf("[WARNING] RR intervals of %d to %d ms do not fit the model input and are saturated, check AF_RR_SCALE\n",
+				AF_ECG_RR_LOW_MS, AF_ECG_RR_HIGH_MS);
+	}
+
+	while ((fr = f_read(&file, af_ecg_chunk, sizeof(af_ecg_chunk), &n)) == FR_OK && n > 0) {
+		uint32_t count = hx_wfdb_decode(&dec, af_ecg_chunk, n, af_ecg_samples);
+		uint64_t before = af_ecg_cycles();
+
+#if AF_IMU_GATE
+		/* the IMU as far as this chunk of the signal, as both sensors' FIFOs would be */
+		af_imu_feed((uint32_t)((uint64_t)(samples + count) * 1000 / hea.fs_hz));
+#endif
+		hx_rrfe_process(&af_rrfe, af_ecg_samples, count);
+		busy += af_ecg_cycles() - before;
+		samples += count;
+	}
+	f_close(&file);
+	if (fr != FR_OK) {
+		xprintf("Read error in %s: %d\n", path, fr);
+	}
+#if AF_IMU_GATE
+	if (af_imu_open) {
+		f_close(&af_imu_file);
+		af_imu_open = 0;
+	}
+#endif
+
+	/* the front end only, not the inferences it triggered */
+	busy -= af_ecg.model_cycles;
+	EPII_Get_Systemclock(&clk);
+	xprintf("%s: %lu samples (%lu s), %lu beats, %lu windows, %lu failed\n", AF_ECG_RECORD,
+			samples, samples / hea.fs_hz, af_ecg.beats, af_ecg.windows, af_ecg.failed);
+	if (samples) {
+		xprintf("RR front end: %lu cycles per sample, %lu us per second of signal at %lu MHz\n",
+				(uint32_t)(busy / samples), clk ? (uint32_t)(busy * hea.fs_hz / samples / (clk / 1000000)) : 0,
+				clk / 1000000);
+	}
+	if (af_ecg.windows) {
+		xprintf("Inference: %lu cycles per window%s\n", (uint32_t)(af_ecg.infer_cycles / af_ecg.windows),
+				AF_ECG_INCREMENTAL ? " (run_af_model_step)" : " (run_af_model)");
+#if (AF_ECG_INCREMENTAL == 2)
+		xprintf("Inference: %lu cycles per window (run_af_model), %lu windows differ\n",
+				(uint32_t)(af_ecg.naive_cycles / af_ecg.windows), af_ecg.mismatched);
+#endif
+	}
+#if (AF_IMU_GATE == 1)
+	xprintf("Motion: %lu of %lu windows in motion (%lu s of IMU), %lu of them AF-positive\n",
+			af_ecg.motion, af_ecg.windows, hx_imuact_now_ms(&af_imu) / 1000, af_ecg.motion_af);
+#elif (AF_IMU_GATE == 2)
+	/* an estimate: a skipped window would have cost the mean of those run */
+	xprintf("Motion: %lu windows not run (%lu s of IMU), about %lu cycles saved\n",
+			af_ecg.motion, hx_imuact_now_ms(&af_imu) / 1000,
+			af_ecg.windows ? (uint32_t)(af_ecg.infer_cycles / af_ecg.windows * af_ecg.motion) : 0);
+#endif
+
+	if (af_burden_close(&af_ecg.burden, &ep)) {
+		af_ecg_episode(&ep);
+	}
+	xprintf("AF burden: %lu.%lu%% of %lu s, %lu episodes, longest %lu s\n",
+			af_burden_permille(&af_ecg.burden) / 10, af_burden_permille(&af_ecg.burden) % 10,
+			af_ecg.burden.now_ms / 1000, af_ecg.burden.episodes, af_ecg.burden.longest_ms / 1000);
+	return 0;
+}
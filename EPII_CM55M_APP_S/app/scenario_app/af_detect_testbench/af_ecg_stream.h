@@ -0,0 +1,51 @@
+#ifndef AF_ECG_STREAM_H
+#define AF_ECG_STREAM_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include "af_model_loader.h"
+
+/*
+ * Raw signal input of the testbench (AF_ECG_STREAM in common_config.h).
+ *
+ * Instead of the x_test vectors, the model gets its RR intervals from a
+ * WFDB record on the SD card, AF_ECG_RECORD.hea and the signal file it
+ * names, streamed through the RR-interval front end of library/rrfe:
+ *
+ *   f_read -> hx_wfdb_decode -> hx_rrfe_process -> beat
+ *          -> every AF_ECG_STRIDE beats, the last MODEL_INPUT_TIMESTEPS
+ *             RR intervals -> run_af_model -> save_result_vector_bulk
+ *          -> af_burden_update
+ *
+ * With AF_ECG_INCREMENTAL every beat's RR interval goes straight to
+ * run_af_model_step() instead, which only does the work the new beat adds.
+ *
+ * With AF_IMU_GATE, AF_ECG_RECORD.imu, an ICM42688 FIFO dump, goes through
+ * library/imuact alongside, and windows during heavy motion are annotated
+ * or not run at all.
+ *
+ * The record is read as if it came from the sensor, one chunk at a time.
+ * The front end's cycles per sample, the inference cycles per window and
+ * the AF burden are logged at the end.
+ */
+
+/**
+ * @brief Streams AF_ECG_RECORD through the front end and the bound model.
+ *
+ * The results go to save_result_vector_bulk() with the image's result
+ * prefix followed by "ecg_", one per window.
+ *
+ * @param image The bound model, for its name and result prefix.
+ * @return 0 on success, -1 if the record cannot be read or does not fit
+ *         the front end.
+ */
+int af_ecg_stream_run(const af_model_image_t *image);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // AF_ECG_STREAM_H
@@ -0,0 +1,28 @@
+#ifndef AF_LOG_H
+#define AF_LOG_H
+
+#include "xprintf.h"
+#include "common_config.h"
+
+/*
+ * Console lines printed for every sample (X file, AF score, result file).
+ *
+ * With AF_LOG_DEFERRED they go to the deferred log of library/dlog while
+ * the serial loop of run_testbench() has it open, and the loop sends them
+ * out between samples; otherwise, and in the other paths, they are printed
+ * by xprintf right away.
+ */
+#if AF_LOG_DEFERRED
+#include "hx_dlog.h"
+
+#define af_log(fmt, ...) do { \
+		if (hx_dlog_active()) \
+			HX_DLOG_INFO(fmt, ##__VA_ARGS__); \
+		else \
+			xprintf(fmt, ##__VA_ARGS__); \
+	} while (0)
+#else
+#define af_log(fmt, ...)	xprintf(fmt, ##__VA_ARGS__)
+#endif
+
+#endif /* AF_LOG_H */
@@ -0,0 +1,330 @@
+#include "af_model_loader.h"
+#include <string.h>
+#include "board.h"
+#include "hx_drv_uart.h"
+#include "common_config.h"
+#include "model_data.h"
+
+// UART used for xmodem model transfers (console)
+#define MODEL_UART_ID 0
+// Max size of a sidecar or sweep list file
+#define MODEL_TEXT_FILE_LEN 512
+
+#define XMODEM_SOH 0x01
+#define XMODEM_STX 0x02
+#define XMODEM_EOT 0x04
+#define XMODEM_ACK 0x06
+#define XMODEM_NAK 0x15
+#define XMODEM_CAN 0x18
+#define XMODEM_CRC 'C'
+#define XMODEM_MAX_RETRY 10
+// Max gap between two bytes of a packet
+#define XMODEM_BYTE_TIMEOUT_MS 1000
+
+#if (RUNTIME_MODEL_LOAD != 0)
+// Runtime-loaded models land here, the interpreter reads weights in place
+__attribute__(( section(".bss.NoInit"))) static uint8_t model_load_buf[MODEL_LOAD_BUFSIZE] __ALIGNED(16);
+#endif
+
+static char text_buf[MODEL_TEXT_FILE_LEN + 1];
+
+
+/**
+ * @brief Reads a small text file into text_buf and null-terminates it.
+ *
+ * @param filepath The path to the text file.
+ * @return FRESULT FatFs result code.
+ */
+static FRESULT read_text_file(const char *filepath)
+{
+    FIL fil;
+    FRESULT res;
+    UINT br = 0;
+
+    res = f_open(&fil, filepath, FA_READ);
+    if (res != FR_OK) {
+        return res;
+    }
+    res = f_read(&fil, text_buf, MODEL_TEXT_FILE_LEN, &br);
+    f_close(&fil);
+    text_buf[br] = '\0';
+    return res;
+}
+
+/**
+ * @brief Returns the next line of text_buf and terminates it in place.
+ *
+ * Leading blanks and trailing blanks/CR are stripped.
+ *
+ * @param cursor In/out position in text_buf.
+ * @return Pointer to the line, or NULL at the end of the buffer.
+ */
+static char *next_line(char **cursor)
+{
+    char *line = *cursor;
+    char *end;
+
+    if (*line == '\0') {
+        return NULL;
+    }
+    end = strchr(line, '\n');
+    if (end != NULL) {
+        *end = '\0';
+        *cursor = end + 1;
+    } else {
+        *cursor = line + strlen(line);
+    }
+    while (*line == ' ' || *line == '\t') {
+        line++;
+    }
+    end = line + strlen(line);
+    while (end > line && (end[-1] == '\r' || end[-1] == ' ' || end[-1] == '\t')) {
+        *--end = '\0';
+    }
+    return line;
+}
+
+void af_model_builtin(af_model_image_t *image)
+{
+#if (FLASH_XIP_MODEL == 1)
+    image->data = (const uint8_t *)AF_MODEL_XIP_ADDR;
+    image->source = AF_MODEL_SRC_XIP;
+#else
+    image->data = (const uint8_t *)model_data;
+    image->source = AF_MODEL_SRC_BUILTIN;
+#endif
+    image->size = 0;
+    strncpy(image->name, "builtin", MODEL_NAME_LEN - 1);
+    image->name[MODEL_NAME_LEN - 1] = '\0';
+    strcpy(image->result_prefix, "qdense_bulk_result_");
+}
+
+FRESULT af_model_sweep_entry(uint32_t position, char *name)
+{
+    FRESULT res;
+    char *cursor = text_buf;
+    char *line;
+
+    res = read_text_file(MODEL_SWEEP_LIST);
+    if (res != FR_OK) {
+        xprintf("Failed to read model list '%s': %d\r\n", MODEL_SWEEP_LIST, res);
+        return res;
+    }
+
+    while ((line = next_line(&cursor)) != NULL) {
+        if (line[0] == '\0' || line[0] == '#') {
+            continue;
+        }
+        if (position-- == 0) {
+            strncpy(name, line, MODEL_NAME_LEN - 1);
+            name[MODEL_NAME_LEN - 1] = '\0';
+            return FR_OK;
+        }
+    }
+    return FR_NO_FILE;
+}
+
+#if (RUNTIME_MODEL_LOAD != 0)
+/**
+ * @brief Applies the key=value lines of a model sidecar file to the descriptor.
+ *
+ * @param name Model name.
+ * @param image Model descriptor to update.
+ */
+static void load_sidecar(const char *name, af_model_image_t *image)
+{
+    char filepath[MAX_PATH_LEN];
+    char *cursor = text_buf;
+    char *line;
+
+    xsprintf(filepath, "%s/%s.cfg", MODEL_DIR, name);
+    if (read_text_file(filepath) != FR_OK) {
+        return; // The sidecar is optional
+    }
+
+    while ((line = next_line(&cursor)) != NULL) {
+        char *value = strchr(line, '=');
+        if (line[0] == '#' || value == NULL) {
+            continue;
+        }
+        *value++ = '\0';
+        if (strcmp(line, "result_prefix") == 0) {
+            strncpy(image->result_prefix, value, MODEL_PREFIX_LEN - 1);
+            image->result_prefix[MODEL_PREFIX_LEN - 1] = '\0';
+        } else {
+            xprintf("  Unknown key '%s' in %s\r\n", line, filepath);
+        }
+    }
+}
+
+FRESULT af_model_load_sd(const char *name, af_model_image_t *image)
+{
+    char filepath[MAX_PATH_LEN];
+    FIL fil;
+    FRESULT res;
+    UINT br;
+    FSIZE_t size;
+
+    if (name == NULL || image == NULL || strlen(name) >= MODEL_NAME_LEN) {
+        return FR_INVALID_PARAMETER;
+    }
+
+    xsprintf(filepath, "%s/%s.tflite", MODEL_DIR, name);
+    res = f_open(&fil, filepath, FA_READ);
+    if (res != FR_OK) {
+        xprintf("Failed to open model '%s': %d\r\n", filepath, res);
+        return res;
+    }
+
+    size = f_size(&fil);
+    if (size == 0 || size > MODEL_LOAD_BUFSIZE) {
+        xprintf("Model '%s' is %lu bytes, buffer holds %d\r\n", filepath, (uint32_t)size, MODEL_LOAD_BUFSIZE);
+        f_close(&fil);
+        return FR_DENIED;
+    }
+
+    res = f_read(&fil, model_load_buf, (UINT)size, &br);
+    f_close(&fil);
+    if (res != FR_OK || br != size) {
+        xprintf("Failed to read model '%s': %d, bytes %u/%lu\r\n", filepath, res, br, (uint32_t)size);
+        return (res == FR_OK) ? FR_DISK_ERR : res;
+    }
+
+    image->data = model_load_buf;
+    image->size = (uint32_t)size;
+    image->source = AF_MODEL_SRC_SD;
+    strcpy(image->name, name);
+    xsprintf(image->result_prefix, "%s_bulk_result_", name);
+    load_sidecar(name, image);
+
+    xprintf("Loaded model '%s' (%lu bytes), result prefix '%s'\r\n", filepath, image->size, image->result_prefix);
+    return FR_OK;
+}
+
+static uint16_t xmodem_crc16(const uint8_t *data, uint32_t len)
+{
+    uint16_t crc = 0;
+
+    while (len--) {
+        crc ^= (uint16_t)(*data++) << 8;
+        for (int i = 0; i < 8; i++) {
+            crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+/**
+ * @brief Waits for one byte on the UART.
+ *
+ * @return 0 if a byte was read, -1 on timeout.
+ */
+static int xmodem_getc(DEV_UART *uart, uint8_t *c, uint32_t timeout_ms)
+{
+    do {
+        if (uart->uart_read_nonblock(c, 1) == 1) {
+            return 0;
+        }
+        board_delay_ms(1);
+    } while (timeout_ms--);
+    return -1;
+}
+
+static void xmodem_putc(DEV_UART *uart, uint8_t c)
+{
+    uart->uart_write(&c, 1);
+}
+
+int af_model_recv_xmodem(af_model_image_t *image, uint32_t timeout_ms)
+{
+    DEV_UART *uart = hx_drv_uart_get_dev((USE_DW_UART_E)MODEL_UART_ID);
+    static uint8_t packet[2 + 1024 + 2];
+    uint32_t received = 0;
+    uint8_t expected_seq = 1;
+    uint8_t reply = XMODEM_CRC;
+    int retry = 0;
+    uint8_t c;
+
+    if (uart == NULL || image == NULL) {
+        return -1;
+    }
+
+    xprintf("Waiting for xmodem model transfer (%lu ms)...\r\n", timeout_ms);
+
+    // Poll the sender with 'C' once a second until the first packet arrives
+    while (1) {
+        xmodem_putc(uart, reply);
+        if (xmodem_getc(uart, &c, 1000) != 0) {
+            if (expected_seq == 1 && retry == 0) {
+                if (timeout_ms < 1000) {
+                    break;
+                }
+                timeout_ms -= 1000;
+                continue;
+            }
+            if (++retry > XMODEM_MAX_RETRY) {
+                break;
+            }
+            reply = XMODEM_NAK;
+            continue;
+        }
+
+        if (c == XMODEM_EOT) {
+            xmodem_putc(uart, XMODEM_ACK);
+            image->data = model_load_buf;
+            image->size = received;
+            image->source = AF_MODEL_SRC_UART;
+            strcpy(image->name, "uart");
+            strcpy(image->result_prefix, "uart_bulk_result_");
+            xprintf("Received model over xmodem (%lu bytes)\r\n", received);
+            return 0;
+        }
+        if (c == XMODEM_CAN) {
+            break;
+        }
+        if (c != XMODEM_SOH && c != XMODEM_STX) {
+            reply = XMODEM_NAK;
+            continue;
+        }
+
+        // Senders emit a packet back to back, a stalled one is NAKed
+        uint32_t payload = (c == XMODEM_STX) ? 1024 : 128;
+        uint32_t len = 0;
+        while (len < payload + 4 && xmodem_getc(uart, &packet[len], XMODEM_BYTE_TIMEOUT_MS) == 0) {
+            len++;
+        }
+
+        uint8_t seq = packet[0];
+        uint16_t crc = ((uint16_t)packet[payload + 2] << 8) | packet[payload + 3];
+        if (len < payload + 4 || (uint8_t)(seq ^ packet[1]) != 0xFF ||
+            xmodem_crc16(&packet[2], payload) != crc) {
+            if (++retry > XMODEM_MAX_RETRY) {
+                break;
+            }
+            reply = XMODEM_NAK;
+            continue;
+        }
+        if (seq == (uint8_t)(expected_seq - 1)) {
+            reply = XMODEM_ACK; // Retransmission of a packet we already stored
+            continue;
+        }
+        if (seq != expected_seq) {
+            break;
+        }
+        if (received + payload > MODEL_LOAD_BUFSIZE) {
+            break;
+        }
+
+        memcpy(&model_load_buf[received], &packet[2], payload);
+        received += payload;
+        expected_seq++;
+        retry = 0;
+        reply = XMODEM_ACK;
+    }
+
+    xmodem_putc(uart, XMODEM_CAN);
+    xmodem_putc(uart, XMODEM_CAN);
+    xprintf("xmodem model transfer failed after %lu bytes\r\n", received);
+    return -1;
+}
+#endif
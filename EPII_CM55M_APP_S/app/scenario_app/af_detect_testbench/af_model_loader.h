@@ -0,0 +1,93 @@
+#ifndef AF_MODEL_LOADER_H
+#define AF_MODEL_LOADER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include "ff.h"
+#include "sd_card_testbench.h"
+
+// Directory on the SD card that holds <name>.tflite and the <name>.cfg sidecar
+#define MODEL_DIR "models"
+// Text file in MODEL_DIR listing one model name per line, '#' starts a comment
+#define MODEL_SWEEP_LIST MODEL_DIR "/sweep.txt"
+// Max length of a model name (without directory and extension)
+#define MODEL_NAME_LEN 32
+// Max length of a result file prefix, fits "<name>_bulk_result_"
+#define MODEL_PREFIX_LEN (MODEL_NAME_LEN + 16)
+// Size of the SRAM buffer that receives a runtime-loaded model, reserved
+// with RUNTIME_MODEL_LOAD != 0 only, as are the two loaders below
+#define MODEL_LOAD_BUFSIZE (256*1024)
+
+/**
+ * @brief Where the currently bound model came from.
+ */
+typedef enum {
+    AF_MODEL_SRC_BUILTIN = 0, // model_data[] compiled into the image
+    AF_MODEL_SRC_XIP,         // flash XIP address
+    AF_MODEL_SRC_SD,          // MODEL_DIR/<name>.tflite on the SD card
+    AF_MODEL_SRC_UART,        // received over the console UART with xmodem
+} af_model_src_t;
+
+/**
+ * @brief A model flatbuffer ready to be passed to bind_model().
+ */
+typedef struct {
+    const uint8_t *data;                // Flatbuffer address (16-byte aligned)
+    uint32_t size;                      // Flatbuffer size in bytes, 0 if unknown
+    af_model_src_t source;
+    char name[MODEL_NAME_LEN];
+    char result_prefix[MODEL_PREFIX_LEN]; // Prefix for save_result_vector_bulk()
+} af_model_image_t;
+
+/**
+ * @brief Describes the model compiled into the image (or mapped via XIP).
+ *
+ * @param image Model descriptor to fill.
+ */
+void af_model_builtin(af_model_image_t *image);
+
+/**
+ * @brief Reads the name of the n-th model listed in MODEL_SWEEP_LIST.
+ *
+ * Empty lines and lines starting with '#' are skipped.
+ *
+ * @param position Zero-based position in the list.
+ * @param name Buffer of at least MODEL_NAME_LEN bytes for the model name.
+ * @return FRESULT FR_OK if found, FR_NO_FILE past the end of the list,
+ * or other FatFs error codes.
+ */
+FRESULT af_model_sweep_entry(uint32_t position, char *name);
+
+/**
+ * @brief Loads MODEL_DIR/<name>.tflite from the SD card into the model buffer.
+ *
+ * The optional MODEL_DIR/<name>.cfg sidecar holds key=value lines;
+ * "result_prefix" overrides the result file prefix, which defaults to
+ * "<name>_bulk_result_". The previous runtime-loaded model is overwritten.
+ *
+ * @param name Model name without directory and extension.
+ * @param image Model descriptor to fill.
+ * @return FRESULT FR_OK if successful, or FatFs error code.
+ */
+FRESULT af_model_load_sd(const char *name, af_model_image_t *image);
+
+/**
+ * @brief Receives a .tflite file over the console UART with xmodem (CRC, 128/1K).
+ *
+ * Logging is silent while the transfer runs since xprintf shares the UART.
+ * The host side is xmodem/xmodem_model_push.py.
+ *
+ * @param image Model descriptor to fill.
+ * @param timeout_ms How long to wait for the sender to start.
+ * @return 0 on success, -1 on timeout, cancel or overflow.
+ */
+int af_model_recv_xmodem(af_model_image_t *image, uint32_t timeout_ms);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // AF_MODEL_LOADER_H
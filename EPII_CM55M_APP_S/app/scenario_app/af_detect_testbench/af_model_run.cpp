@@ -6,9 +6,12 @@
  */
 
 #include <cstdio>
+#include <new>
+#include <math.h>
 #include <assert.h>
 #include <stdbool.h>
 #include <stdint.h>
+#include <stddef.h>
 #include <string.h>
 #include <stdlib.h>
 #include "WE2_device.h"
@@ -20,6 +23,7 @@
 #include "WE2_device.h"
 
 #include "ethosu_driver.h"
+#include "pmu_ethosu.h"
 #include "tensorflow/lite/micro/micro_mutable_op_resolver.h"
 #include "tensorflow/lite/micro/micro_interpreter.h"
 #include "tensorflow/lite/schema/schema_generated.h"
@@ -34,7 +38,19 @@
 //#include "af_detection.h"
 #include "model_data.h"
 #include "common_config.h"
-#include "model_params.h" 
+#include "af_log.h"
+#include "npu_weight_prefetch.h"
+#include "af_op_profiler.h"
+#if AF_WARM_BOOT
+#if TFLM2209_U55TAG2205
+#error "AF_WARM_BOOT needs the split tensor arena, not available with TFLM2209_U55TAG2205"
+#endif
+#include "hx_drv_pmu_export.h"
+#include "hx_drv_pmu.h"
+#endif
+#ifdef AF_COMPILED_MODEL
+#include "af_compiled.h"
+#endif
 
 
 #define LOCAL_FRAQ_BITS (8)
@@ -43,6 +59,8 @@
 #define INPUT_SIZE_X 96
 #define INPUT_SIZE_Y 96
 
+#define CPU_CLK	0xffffff+1
+
 #ifdef TRUSTZONE_SEC
 #define U55_BASE	BASE_ADDR_APB_U55_CTRL_ALIAS
 #else
@@ -56,6 +74,16 @@
 #define TENSOR_ARENA_BUFSIZE  (125*1024)
 __attribute__(( section(".bss.NoInit"))) uint8_t tensor_arena_buf[TENSOR_ARENA_BUFSIZE] __ALIGNED(32);
 
+#if AF_WARM_BOOT
+#define AF_WARM_MAGIC	0x41465742
+/* Wake-ups from PS_PD, the only ones that may find SRAM retained */
+#define AF_PD_WAKEUP_EVENTS	(PMU_WAKEUP_PD_DC_FORCE | PMU_WAKEUP_PD_EXTGPIO | PMU_WAKEUP_PD_RTC_TIMER_INT | \
+		PMU_WAKEUP_PD_SB_TIMER_INT | PMU_WAKEUP_PD_CMP_int | PMU_WAKEUP_PD_TS_int | \
+		PMU_WAKEUP_PD_I2C_W_int | PMU_WAKEUP_PD_SB_timer0_int)
+static_assert(AF_ARENA_PERSISTENT_SIZE % 16 == 0 && AF_ARENA_PERSISTENT_SIZE < TENSOR_ARENA_BUFSIZE,
+		"AF_ARENA_PERSISTENT_SIZE must be a 16-byte multiple inside the tensor arena");
+#endif
+
 using namespace std;
 
 namespace {
@@ -66,7 +94,93 @@ uint32_t tensor_arena = (uint32_t)tensor_arena_buf;
 struct ethosu_driver ethosu_drv; /* Default Ethos-U device driver */
 tflite::MicroInterpreter *int_ptr=nullptr;
 TfLiteTensor* input, *output;
+
+typedef tflite::MicroMutableOpResolver<20> AfOpResolver;
+
+/* The interpreter is rebuilt in place every time a new model is bound,
+ * so it lives in static storage instead of a function-local static.
+ * The op resolver is built in place once; nodes of the interpreter point
+ * into it. Both are kept over PD_RET for a warm boot. */
+__attribute__(( section(".bss.NoInit"))) alignas(tflite::MicroInterpreter) uint8_t interpreter_buf[sizeof(tflite::MicroInterpreter)];
+__attribute__(( section(".bss.NoInit"))) alignas(AfOpResolver) uint8_t op_resolver_buf[sizeof(AfOpResolver)];
+AfOpResolver &op_resolver = *reinterpret_cast<AfOpResolver *>(op_resolver_buf);
+bool op_resolver_ready = false;
+AfOpProfiler op_profiler;
+bool model_uses_npu = false;
+#if TFLM2209_U55TAG2205
+tflite::MicroErrorReporter micro_error_reporter;
+#endif
+
+/* Quantization parameters of the bound model, read from the tensors. */
+float input_scale = 1.0f;
+int input_zero_point = 0;
+float output_scale = 1.0f;
+int output_zero_point = 0;
+
+/* Time to first inference, logged by the first run_af_model() after init_model() */
+bool first_inference_pending = false;
+bool warm_booted = false;
+uint32_t init_model_us = 0;
+
+#ifdef AF_COMPILED_MODEL
+/* Set while af_compiled_invoke() serves run_af_model() instead of the interpreter */
+bool compiled_active = false;
+int8_t compiled_input[AF_COMPILED_INPUT_SIZE];
+int8_t compiled_output[AF_COMPILED_OUTPUT_SIZE];
+static_assert(AF_COMPILED_INPUT_SIZE >= MODEL_INPUT_TIMESTEPS * MODEL_INPUT_FEATURES,
+		"compiled model input is smaller than the testbench sample");
+#endif
+
+/* Window of run_af_model_step(). Every step is quantized once and stored
+ * twice, so the last MODEL_INPUT_TIMESTEPS steps are always contiguous at
+ * step_ring + step_head and go to the model input as they are. */
+constexpr int step_window = MODEL_INPUT_TIMESTEPS * MODEL_INPUT_FEATURES;
+int8_t step_ring[2 * step_window];
+int step_head = 0;
+int step_count = 0;
+#if defined(AF_COMPILED_MODEL) && AF_COMPILED_SHIFTED && \
+	(AF_COMPILED_INPUT_SIZE == MODEL_INPUT_TIMESTEPS * MODEL_INPUT_FEATURES) && \
+	(AF_COMPILED_STEP_SIZE == MODEL_INPUT_FEATURES)
+#define AF_STEP_SHIFTED 1
+/* The compiled model holds the first layer of the window before the current one */
+bool step_shifted_ready = false;
+#else
+#define AF_STEP_SHIFTED 0
+#endif
+
+#if AF_WARM_BOOT
+/* What init_model() and bind_model() leave in the globals above, sealed by
+ * af_model_retain() together with the retained buffers */
+struct af_warm_state_t {
+	uint32_t magic;
+	uint32_t image_id;
+	tflite::MicroInterpreter *int_ptr;
+	TfLiteTensor *input, *output;
+	float input_scale;
+	int input_zero_point;
+	float output_scale;
+	int output_zero_point;
+	bool model_uses_npu;
+	bool compiled_active;
+	uint32_t crc;			/* of the fields above and the retained buffers */
 };
+__attribute__(( section(".bss.NoInit"))) af_warm_state_t warm_state;
+#endif
+};
+
+/**
+ * @brief Microseconds since SysTick started at reset
+ **/
+static uint32_t _us_since_reset(void)
+{
+	uint32_t systick, loop_cnt, clk = 0;
+
+	SystemGetTick(&systick, &loop_cnt);
+	EPII_Get_Systemclock(&clk);
+	if (clk < 1000000)
+		return 0;
+	return (uint32_t)(((uint64_t)loop_cnt * (CPU_CLK) + (CPU_CLK) - 1 - systick) / (clk / 1000000));
+}
 
 static void _arm_npu_irq_handler(void)
 {
@@ -119,41 +233,258 @@ static int _arm_npu_init(bool security_enable, bool privilege_enable)
     return 0;
 }
 
-int init_model(bool security_enable, bool privilege_enable)
+#if (NPU_WEIGHT_PREFETCH == 1)
+static uint32_t _measure_invoke_ticks(void)
 {
-    int ercode = 0;
-    const float input_scale = MODEL_INPUT_SCALE;
-    const int input_zero_point = MODEL_INPUT_ZERO_POINT;
-    const float output_scale = MODEL_OUTPUT_SCALE;
-    const int output_zero_point = MODEL_OUTPUT_ZERO_POINT;
+	uint32_t systick_1, systick_2;
+	uint32_t loop_cnt_1, loop_cnt_2;
 
+	memset(input->data.int8, input_zero_point, input->bytes);
+	SystemGetTick(&systick_1, &loop_cnt_1);
+	if (int_ptr->Invoke() != kTfLiteOk) {
+		return 0;
+	}
+	SystemGetTick(&systick_2, &loop_cnt_2);
+	return (loop_cnt_2-loop_cnt_1)*CPU_CLK+(systick_1-systick_2);
+}
 
-	if(_arm_npu_init(security_enable, privilege_enable)!=0)
-		return -1;
+/**
+ * @brief Copies the flash weight regions of the bound model into SRAM and
+ *        reports the Invoke() ticks saved by reading them from SRAM.
+ **/
+static void _prefetch_weights(void)
+{
+	npu_prefetch_reset();
 
-#if (FLASH_XIP_MODEL == 1)
-	static const tflite::Model*model = tflite::GetModel((const void *)0x3A180000);
-#else
-	//static const tflite::Model*model = tflite::GetModel((const void *)af_detection_vela_tflite);
-	static const tflite::Model*model = tflite::GetModel((const void *)model_data);
+	uint32_t flash_ticks = _measure_invoke_ticks();
+	npu_prefetch_enable(true);
+	_measure_invoke_ticks(); /* first job copies the regions */
+	uint32_t sram_ticks = _measure_invoke_ticks();
+
+	if (npu_prefetch_bytes() == 0 && npu_prefetch_skipped_bytes() == 0) {
+		xprintf("NPU weight prefetch: model weights are not in flash\n");
+		return;
+	}
+	xprintf("NPU weight prefetch: %lu bytes in SRAM, %lu bytes left in flash (budget %d)\n",
+			npu_prefetch_bytes(), npu_prefetch_skipped_bytes(), NPU_PREFETCH_BUDGET);
+	xprintf("Tick for Invoke flash:[%lu] sram:[%lu] saved:[%ld]\n",
+			flash_ticks, sram_ticks, (int32_t)(flash_ticks - sram_ticks));
+}
 #endif
 
-	if (model->version() != TFLITE_SCHEMA_VERSION) {
-		xprintf(
-			"[ERROR] model's schema version %d is not equal "
-			"to supported version %d\n",
-			model->version(), TFLITE_SCHEMA_VERSION);
+/**
+ * @brief Returns true if the model delegates work to the NPU (vela "ethos-u" custom op).
+ **/
+static bool _model_uses_npu(const tflite::Model *model)
+{
+	const auto *op_codes = model->operator_codes();
+	if (op_codes == nullptr)
+		return false;
+
+	for (uint32_t i = 0; i < op_codes->size(); i++) {
+		const auto *custom_code = op_codes->Get(i)->custom_code();
+		if (custom_code != nullptr && strcmp(custom_code->c_str(), "ethos-u") == 0)
+			return true;
+	}
+	return false;
+}
+
+#if (AF_BACKEND_SEL == 2) && (defined(AF_CPU_MODEL) || defined(AF_COMPILED_MODEL))
+/**
+ * @brief Benchmarks the bound model over runs Invoke() calls.
+ *
+ * Logs per-op and end-to-end ticks and the active cycles as energy proxy:
+ * the CPU sleeps in WFE while an NPU job runs, so its active cycles are the
+ * end-to-end ticks minus the NPU cycle counter.
+ *
+ * @return Average end-to-end ticks per Invoke(), 0 on failure.
+ **/
+static uint32_t _benchmark_backend(const char *label, uint32_t runs)
+{
+	uint32_t systick_1, systick_2;
+	uint32_t loop_cnt_1, loop_cnt_2;
+	uint32_t total_ticks = 0;
+	uint64_t npu_cycles = 0;
+
+	/* Hold a power request so the NPU is not reset between jobs and
+	 * the PMU keeps counting over all runs */
+	if (model_uses_npu) {
+		ethosu_request_power(&ethosu_drv);
+		ETHOSU_PMU_Enable(&ethosu_drv);
+		ETHOSU_PMU_CNTR_Enable(&ethosu_drv, ETHOSU_PMU_CCNT_Msk);
+		ETHOSU_PMU_CYCCNT_Reset(&ethosu_drv);
+	}
+
+	op_profiler.Reset();
+	op_profiler.Enable(true);
+	for (uint32_t i = 0; i < runs; i++) {
+		memset(input->data.int8, input_zero_point, input->bytes);
+		op_profiler.NewRun();
+		SystemGetTick(&systick_1, &loop_cnt_1);
+		if (int_ptr->Invoke() != kTfLiteOk) {
+			total_ticks = 0;
+			runs = 0;
+			break;
+		}
+		SystemGetTick(&systick_2, &loop_cnt_2);
+		total_ticks += (loop_cnt_2-loop_cnt_1)*CPU_CLK+(systick_1-systick_2);
+	}
+	op_profiler.Enable(false);
+
+	if (model_uses_npu) {
+		npu_cycles = ETHOSU_PMU_Get_CCNTR(&ethosu_drv);
+		ETHOSU_PMU_Disable(&ethosu_drv);
+		ethosu_release_power(&ethosu_drv);
+	}
+	if (runs == 0) {
+		xprintf("%s: Invoke failed\n", label);
+		return 0;
+	}
+
+	uint32_t avg_ticks = total_ticks / runs;
+	uint32_t avg_npu = (uint32_t)(npu_cycles / runs);
+	op_profiler.Log(label, runs);
+	xprintf("Tick for %s Invoke:[%lu]\n", label, avg_ticks);
+	if (model_uses_npu) {
+		xprintf("%s NPU launch overhead Tick:[%ld]\n", label,
+				(int32_t)(op_profiler.ticks_for("ethos-u") / runs - avg_npu));
+	}
+	xprintf("%s active cycles cpu:[%lu] npu:[%lu]\n", label,
+			avg_ticks > avg_npu ? avg_ticks - avg_npu : 0, avg_npu);
+	return avg_ticks;
+}
+
+#ifdef AF_COMPILED_MODEL
+static int _bind_compiled(void);
+
+/**
+ * @brief Benchmarks af_compiled_invoke() over runs calls.
+ *
+ * @return Average ticks per call, 0 on failure.
+ **/
+static uint32_t _benchmark_compiled(uint32_t runs)
+{
+	uint32_t systick_1, systick_2;
+	uint32_t loop_cnt_1, loop_cnt_2;
+	uint32_t total_ticks = 0;
+
+	for (uint32_t i = 0; i < runs; i++) {
+		memset(compiled_input, AF_COMPILED_INPUT_ZERO_POINT, sizeof(compiled_input));
+		SystemGetTick(&systick_1, &loop_cnt_1);
+		if (af_compiled_invoke(compiled_input, compiled_output) != 0) {
+			xprintf("Compiled: Invoke failed\n");
+			return 0;
+		}
+		SystemGetTick(&systick_2, &loop_cnt_2);
+		total_ticks += (loop_cnt_2-loop_cnt_1)*CPU_CLK+(systick_1-systick_2);
+	}
+
+	uint32_t avg_ticks = total_ticks / runs;
+	xprintf("Tick for Compiled Invoke:[%lu]\n", avg_ticks);
+	xprintf("Compiled active cycles cpu:[%lu] npu:[0]\n", avg_ticks);
+	return avg_ticks;
+}
+#endif
+
+/**
+ * @brief Benchmarks every linked backend and keeps the fastest one bound.
+ **/
+static int _select_backend(const void *npu_model)
+{
+	uint32_t npu_ticks = 0, cpu_ticks = 0, compiled_ticks = 0;
+
+	if (bind_model(npu_model, 0) == 0)
+		npu_ticks = _benchmark_backend("Ethos-U", AF_BACKEND_BENCH_RUNS);
+#ifdef AF_CPU_MODEL
+	if (bind_model((const void *)model_data_cpu, 0) == 0)
+		cpu_ticks = _benchmark_backend("CMSIS-NN", AF_BACKEND_BENCH_RUNS);
+#endif
+#ifdef AF_COMPILED_MODEL
+	compiled_ticks = _benchmark_compiled(AF_BACKEND_BENCH_RUNS);
+#endif
+	xprintf("Backend ticks Ethos-U:[%lu] CMSIS-NN:[%lu] Compiled:[%lu]\n", npu_ticks, cpu_ticks, compiled_ticks);
+
+#ifdef AF_COMPILED_MODEL
+	if (compiled_ticks != 0 && (npu_ticks == 0 || compiled_ticks < npu_ticks) &&
+			(cpu_ticks == 0 || compiled_ticks < cpu_ticks)) {
+		xprintf("Backend selected: Compiled\n");
+		return _bind_compiled();
+	}
+#endif
+	if (cpu_ticks != 0 && (npu_ticks == 0 || cpu_ticks < npu_ticks)) {
+		xprintf("Backend selected: CMSIS-NN\n");
+		return 0; /* CMSIS-NN model is still bound, the compiled run does not touch it */
+	}
+	xprintf("Backend selected: Ethos-U\n");
+	return bind_model(npu_model, 0);
+}
+#endif
+
+#ifdef AF_COMPILED_MODEL
+/**
+ * @brief Serves run_af_model() from af_compiled_invoke() instead of the interpreter.
+ **/
+static int _bind_compiled(void)
+{
+	af_model_step_reset();
+	if (af_compiled_check() != 0) {
+		xprintf("[ERROR] compiled model scratch buffer too small for this CMSIS-NN build\n");
 		return -1;
 	}
-	else {
-		xprintf("model's schema version %d\n", model->version());
+	compiled_active = true;
+	input_scale = AF_COMPILED_INPUT_SCALE;
+	input_zero_point = AF_COMPILED_INPUT_ZERO_POINT;
+	output_scale = AF_COMPILED_OUTPUT_SCALE;
+	output_zero_point = AF_COMPILED_OUTPUT_ZERO_POINT;
+
+	xprintf("Compiled model: %d bytes RAM (activations + scratch)\n", AF_COMPILED_RAM_BYTES);
+	xprintf("Backend: Compiled\n");
+	return 0;
+}
+
+#ifdef AF_CPU_MODEL
+/**
+ * @brief Checks af_compiled_invoke() against the interpreter running the
+ *        same non-vela model on runs pseudo-random inputs.
+ *
+ * @return Number of inputs whose outputs differ, -1 on failure.
+ **/
+static int _verify_compiled(uint32_t runs)
+{
+	uint32_t seed = 0x1234567u;
+	int mismatches = 0;
+
+	if (af_compiled_check() != 0 || bind_model((const void *)model_data_cpu, 0) != 0)
+		return -1;
+	if (input->bytes != AF_COMPILED_INPUT_SIZE || output->bytes != AF_COMPILED_OUTPUT_SIZE) {
+		xprintf("[ERROR] compiled model I/O does not match model_data_cpu\n");
+		return -1;
 	}
-	#if TFLM2209_U55TAG2205
-	static tflite::MicroErrorReporter micro_error_reporter;
-	#endif
-	static tflite::MicroMutableOpResolver<12> op_resolver;
 
-    op_resolver.AddDepthwiseConv2D();
+	for (uint32_t i = 0; i < runs; i++) {
+		for (int j = 0; j < AF_COMPILED_INPUT_SIZE; j++) {
+			seed = seed * 1664525u + 1013904223u;
+			compiled_input[j] = (int8_t)(seed >> 24);
+		}
+		memcpy(input->data.int8, compiled_input, AF_COMPILED_INPUT_SIZE);
+		if (int_ptr->Invoke() != kTfLiteOk || af_compiled_invoke(compiled_input, compiled_output) != 0)
+			return -1;
+		if (memcmp(output->data.int8, compiled_output, AF_COMPILED_OUTPUT_SIZE) != 0)
+			mismatches++;
+	}
+	xprintf("Compiled vs interpreter: %d/%lu outputs differ\n", mismatches, runs);
+	return mismatches;
+}
+#endif
+#endif
+
+static int _setup_op_resolver(void)
+{
+	if (op_resolver_ready)
+		return 0;
+
+	new (op_resolver_buf) AfOpResolver();
+	op_resolver.AddDepthwiseConv2D();
 	op_resolver.AddRelu6();
 	op_resolver.AddConv2D();
 	op_resolver.AddAveragePool2D();
@@ -163,68 +494,451 @@ int init_model(bool security_enable, bool privilege_enable)
 	op_resolver.AddStridedSlice();
 	op_resolver.AddPack();
 	op_resolver.AddFill();
+	/* Kernels of the non-vela model, mapped to CMSIS-NN where available */
+	op_resolver.AddFullyConnected();
+	op_resolver.AddLogistic();
+	op_resolver.AddQuantize();
+	op_resolver.AddRelu();
+	op_resolver.AddMaxPool2D();
+	op_resolver.AddExpandDims();
+	op_resolver.AddSqueeze();
 	if (kTfLiteOk != op_resolver.AddEthosU()){
 		xprintf("Failed to add Arm NPU support to op resolver.");
+		return -1;
+	}
+	op_resolver_ready = true;
+	return 0;
+}
+
+#if AF_WARM_BOOT
+/**
+ * @brief CRC-32 (IEEE 802.3), 4 bits per step
+ **/
+static uint32_t _crc32(uint32_t crc, const void *data, uint32_t len)
+{
+	static const uint32_t table[16] = {
+		0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+		0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C,
+	};
+	const uint8_t *p = (const uint8_t *)data;
+
+	crc = ~crc;
+	while (len--) {
+		crc ^= *p++;
+		crc = (crc >> 4) ^ table[crc & 0x0F];
+		crc = (crc >> 4) ^ table[crc & 0x0F];
+	}
+	return ~crc;
+}
+
+/**
+ * @brief Identifies the firmware image, the retained pointers are only
+ *        valid for the image that sealed them.
+ **/
+static uint32_t _warm_image_id(void)
+{
+	static const char build[] = __DATE__ " " __TIME__;
+	uintptr_t code = (uintptr_t)&init_model;
+
+	return _crc32(_crc32(0, build, sizeof(build)), &code, sizeof(code));
+}
+
+/**
+ * @brief CRC of the sealed state, the interpreter, the op resolver and the
+ *        persistent part of the tensor arena.
+ **/
+static uint32_t _warm_crc(void)
+{
+	uint32_t crc = _crc32(0, &warm_state, offsetof(af_warm_state_t, crc));
+
+	crc = _crc32(crc, interpreter_buf, sizeof(interpreter_buf));
+	crc = _crc32(crc, op_resolver_buf, sizeof(op_resolver_buf));
+	return _crc32(crc, tensor_arena_buf, AF_ARENA_PERSISTENT_SIZE);
+}
+
+/**
+ * @brief Takes back the model sealed by af_model_retain() after a PD_RET
+ *        wake-up: no op resolver setup, no AllocateTensors().
+ *
+ * @return true if restored, false if init_model() has to start over.
+ **/
+static bool _warm_restore(void)
+{
+	uint32_t wakeup_event;
+
+	hx_drv_pmu_get_ctrl(PMU_pmu_wakeup_EVT, &wakeup_event);
+	if ((wakeup_event & AF_PD_WAKEUP_EVENTS) == 0 || warm_state.magic != AF_WARM_MAGIC)
+		return false;
+	if (warm_state.image_id != _warm_image_id() || warm_state.crc != _warm_crc()) {
+		xprintf("Warm boot: retained model is not valid, cold init\n");
+		warm_state.magic = 0;
 		return false;
 	}
+
+	int_ptr = warm_state.int_ptr;
+	input = warm_state.input;
+	output = warm_state.output;
+	input_scale = warm_state.input_scale;
+	input_zero_point = warm_state.input_zero_point;
+	output_scale = warm_state.output_scale;
+	output_zero_point = warm_state.output_zero_point;
+	model_uses_npu = warm_state.model_uses_npu;
+#ifdef AF_COMPILED_MODEL
+	compiled_active = warm_state.compiled_active;
+#endif
+	op_resolver_ready = true;
+
+#if (NPU_WEIGHT_PREFETCH == 1)
+	/* The region table was not retained, the first job copies the weights again */
+	if (model_uses_npu) {
+		npu_prefetch_reset();
+		npu_prefetch_enable(true);
+	}
+#endif
+	xprintf("Warm boot: model restored from retained SRAM\n");
+	return true;
+}
+#endif
+
+void af_model_retain(void)
+{
+#if AF_WARM_BOOT
+	bool bound = int_ptr != nullptr;
+
+#ifdef AF_COMPILED_MODEL
+	bound = bound || compiled_active;
+	warm_state.compiled_active = compiled_active;
+#else
+	warm_state.compiled_active = false;
+#endif
+	if (!bound) {
+		warm_state.magic = 0;
+		return;
+	}
+	warm_state.magic = AF_WARM_MAGIC;
+	warm_state.image_id = _warm_image_id();
+	warm_state.int_ptr = int_ptr;
+	warm_state.input = input;
+	warm_state.output = output;
+	warm_state.input_scale = input_scale;
+	warm_state.input_zero_point = input_zero_point;
+	warm_state.output_scale = output_scale;
+	warm_state.output_zero_point = output_zero_point;
+	warm_state.model_uses_npu = model_uses_npu;
+	warm_state.crc = _warm_crc();
+#endif
+}
+
+int init_model(bool security_enable, bool privilege_enable)
+{
+	uint32_t start_us = _us_since_reset();
+	int ret;
+
+	if(_arm_npu_init(security_enable, privilege_enable)!=0)
+		return -1;
+
+#if AF_WARM_BOOT
+	if (_warm_restore()) {
+		warm_booted = true;
+		init_model_us = _us_since_reset() - start_us;
+		first_inference_pending = true;
+		return 0;
+	}
+#endif
+	warm_booted = false;
+
+	if(_setup_op_resolver()!=0)
+		return -1;
+
+#if (FLASH_XIP_MODEL == 1)
+	const void *npu_model = (const void *)AF_MODEL_XIP_ADDR;
+#else
+	//const void *npu_model = (const void *)af_detection_vela_tflite;
+	const void *npu_model = (const void *)model_data;
+#endif
+
+#if defined(AF_COMPILED_MODEL) && defined(AF_CPU_MODEL)
+	if (_verify_compiled(AF_COMPILED_VERIFY_RUNS) != 0)
+		xprintf("[WARNING] compiled model is not bit-exact with the interpreter\n");
+#endif
+
+#if (AF_BACKEND_SEL == 1) && defined(AF_CPU_MODEL)
+	ret = bind_model((const void *)model_data_cpu, 0);
+#elif (AF_BACKEND_SEL == 2) && (defined(AF_CPU_MODEL) || defined(AF_COMPILED_MODEL))
+	ret = _select_backend(npu_model);
+#elif (AF_BACKEND_SEL == 3) && defined(AF_COMPILED_MODEL)
+	ret = _bind_compiled();
+#else
+	ret = bind_model(npu_model, 0);
+#endif
+	init_model_us = _us_since_reset() - start_us;
+	first_inference_pending = (ret == 0);
+	return ret;
+}
+
+int bind_model(const void *model_addr, uint32_t model_size)
+{
+	if (model_addr == NULL) {
+		return -1;
+	}
+#ifdef AF_COMPILED_MODEL
+	compiled_active = false;
+#endif
+#if AF_WARM_BOOT
+	warm_state.magic = 0;
+#endif
+	af_model_step_reset();
+
+	/* Only models that arrive at runtime carry a size, verify those before use */
+	if (model_size != 0) {
+		flatbuffers::Verifier verifier((const uint8_t *)model_addr, model_size);
+		if (!tflite::VerifyModelBuffer(verifier)) {
+			xprintf("[ERROR] model flatbuffer verification failed (%lu bytes)\n", model_size);
+			return -1;
+		}
+	}
+
+	const tflite::Model *model = tflite::GetModel(model_addr);
+	if (model->version() != TFLITE_SCHEMA_VERSION) {
+		xprintf(
+			"[ERROR] model's schema version %d is not equal "
+			"to supported version %d\n",
+			model->version(), TFLITE_SCHEMA_VERSION);
+		return -1;
+	}
+	else {
+		xprintf("model's schema version %d\n", model->version());
+	}
+
+	/* Tear down the previous interpreter before rebuilding it in place */
+	if (int_ptr != nullptr) {
+		int_ptr->~MicroInterpreter();
+		int_ptr = nullptr;
+	}
+
 	#if TFLM2209_U55TAG2205
-	static tflite::MicroInterpreter static_interpreter(model, op_resolver, (uint8_t*)tensor_arena, tensor_arena_size, &micro_error_reporter);
+	tflite::MicroInterpreter *interpreter = new (interpreter_buf) tflite::MicroInterpreter(model, op_resolver, (uint8_t*)tensor_arena, tensor_arena_size, &micro_error_reporter);
+	#elif AF_WARM_BOOT
+	/* Persistent data in its own part of the arena, for the CRC of af_model_retain() */
+	tflite::MicroAllocator *allocator = tflite::MicroAllocator::Create(
+			tensor_arena_buf, AF_ARENA_PERSISTENT_SIZE,
+			tensor_arena_buf + AF_ARENA_PERSISTENT_SIZE, tensor_arena_size - AF_ARENA_PERSISTENT_SIZE);
+	if (allocator == nullptr) {
+		xprintf("[ERROR] AF_ARENA_PERSISTENT_SIZE too small for the allocator\n");
+		return -1;
+	}
+	tflite::MicroInterpreter *interpreter = new (interpreter_buf) tflite::MicroInterpreter(model, op_resolver, allocator, nullptr, &op_profiler);
 	#else
-	static tflite::MicroInterpreter static_interpreter(model, op_resolver, (uint8_t*)tensor_arena, tensor_arena_size);
+	tflite::MicroInterpreter *interpreter = new (interpreter_buf) tflite::MicroInterpreter(model, op_resolver, (uint8_t*)tensor_arena, tensor_arena_size, nullptr, &op_profiler);
 	#endif
-	if(static_interpreter.AllocateTensors()!= kTfLiteOk) {
-		return false;
+	if(interpreter->AllocateTensors()!= kTfLiteOk) {
+		interpreter->~MicroInterpreter();
+		return -1;
 	}
-	int_ptr = &static_interpreter;
-	input = static_interpreter.input(0);
-	output = static_interpreter.output(0);
+	input = interpreter->input(0);
+	output = interpreter->output(0);
+
+	if (input->type != kTfLiteInt8 || output->type != kTfLiteInt8) {
+		xprintf("[ERROR] model input/output must be int8 (got %d/%d)\n", input->type, output->type);
+		interpreter->~MicroInterpreter();
+		return -1;
+	}
+	if (input->bytes < MODEL_INPUT_TIMESTEPS * MODEL_INPUT_FEATURES) {
+		xprintf("[ERROR] model input holds %u values, testbench provides %d\n",
+				input->bytes, MODEL_INPUT_TIMESTEPS * MODEL_INPUT_FEATURES);
+		interpreter->~MicroInterpreter();
+		return -1;
+	}
+	int_ptr = interpreter;
+	model_uses_npu = _model_uses_npu(model);
+
+	input_scale = input->params.scale;
+	input_zero_point = input->params.zero_point;
+	output_scale = output->params.scale;
+	output_zero_point = output->params.zero_point;
 
 	xprintf("initial done\n");
-	
-    // Debug print (using integer-only formatting)
-    xprintf("Model parameter\n");
-    xprintf("Input: scale=%d/%d, zp=%d\n", (int)(input_scale*1e6), 1000000, input_zero_point);
-    xprintf("Output: scale=%d/%d, zp=%d\n", (int)(output_scale*1e6), 1000000, output_zero_point);
 
-	return ercode;
+	// Debug print (using integer-only formatting)
+	xprintf("Model parameter\n");
+	xprintf("Input: scale=%d/%d, zp=%d\n", (int)(input_scale*1e6), 1000000, input_zero_point);
+	xprintf("Output: scale=%d/%d, zp=%d\n", (int)(output_scale*1e6), 1000000, output_zero_point);
+	xprintf("Arena used: %u/%d bytes\n", int_ptr->arena_used_bytes(), tensor_arena_size);
+	xprintf("Backend: %s\n", model_uses_npu ? "Ethos-U" : "CMSIS-NN");
+
+#if (NPU_WEIGHT_PREFETCH == 1)
+	if (model_uses_npu)
+		_prefetch_weights();
+#endif
+
+	return 0;
 }
 
-int run_model(test_sample_t* sample, int8_t *model_output, uint32_t output_length) {
+/* Quantizes one input value with the parameters of the bound model,
+ * saturated to int8 since streamed RR intervals are not bounded */
+static int8_t _quantize(float val)
+{
+	float q = roundf(val / input_scale) + input_zero_point;
+
+	if (q < -128.0f)
+		return -128;
+	if (q > 127.0f)
+		return 127;
+	return (int8_t)q;
+}
+
+bool af_model_input_fits(float val)
+{
+	float q = roundf(val / input_scale) + input_zero_point;
+
+	return q >= -128.0f && q <= 127.0f;
+}
+
+/* Output of the inference just run, shared by run_af_model() and run_af_model_step() */
+static void _inference_done(const int8_t *result_data, int8_t *model_output, uint32_t output_length)
+{
+    memcpy(model_output, result_data, output_length * sizeof(int8_t));
+#ifndef AF_TESTBENCH_RTOS
+    if (first_inference_pending) {
+        first_inference_pending = false;
+        xprintf("%s boot: init_model %lu us, first inference %lu us after reset\n",
+                warm_booted ? "Warm" : "Cold", init_model_us, _us_since_reset());
+    }
+#endif
+#if AF_SAMPLE_LOG
+    int score_percent = af_model_score_pct(model_output[0]);
+    af_log("AF: raw=%d, score=%d%%, %s\n",
+           model_output[0], score_percent,
+           score_percent >= 50 ? "DETECTED" : "normal");
+#endif
+}
+
+int af_model_score_pct(int8_t raw)
+{
+    float af_score = (raw - output_zero_point) * output_scale;
+    af_score = fmaxf(0.0f, fminf(1.0f, af_score));  // Clamp to [0,1]
+    return (int)(af_score * 100);
+}
+
+int run_af_model(test_sample_t* sample, int8_t *model_output, uint32_t output_length) {
     int ercode = 0;
-    // MANUALLY SET THE CORRECT PARAMETERS (from Python output)
-    // Use the model-specific parameters
-    const float input_scale = MODEL_INPUT_SCALE;
-    const int input_zero_point = MODEL_INPUT_ZERO_POINT;
-    const float output_scale = MODEL_OUTPUT_SCALE;
-    const int output_zero_point = MODEL_OUTPUT_ZERO_POINT;
-    
-    // Quantize input
-    int8_t* tensor_data = input->data.int8;
-    for (int i = 0; i < 40; i++) {
-        float val = sample->x_data[i];
-        tensor_data[i] = (int8_t)(roundf(val / input_scale) + input_zero_point);
+    int8_t* tensor_data;
+    const int8_t* result_data;
+
+#ifdef AF_COMPILED_MODEL
+    if (compiled_active) {
+        tensor_data = compiled_input;
+        result_data = compiled_output;
+        if (output_length > AF_COMPILED_OUTPUT_SIZE)
+            output_length = AF_COMPILED_OUTPUT_SIZE;
+    } else
+#endif
+    {
+        if (int_ptr == nullptr) {
+            return -1;
+        }
+        tensor_data = input->data.int8;
+        result_data = output->data.int8;
+    }
+
+    // Quantize input with the parameters of the bound model
+    for (int i = 0; i < MODEL_INPUT_TIMESTEPS * MODEL_INPUT_FEATURES; i++) {
+        tensor_data[i] = _quantize(sample->x_data[i]);
     }
 
     // Run inference
+#ifdef AF_COMPILED_MODEL
+    if (compiled_active) {
+#if AF_STEP_SHIFTED
+        step_shifted_ready = false;
+#endif
+        if (af_compiled_invoke(compiled_input, compiled_output) != 0) {
+            xprintf("Inference failed\n");
+            return -1;
+        }
+#if AF_STEP_SHIFTED
+        // The kept first layer is now that of this window, still usable if it is the step window
+        step_shifted_ready = step_count == MODEL_INPUT_TIMESTEPS &&
+                memcmp(compiled_input, step_ring + step_head, step_window) == 0;
+#endif
+    } else
+#endif
     if(int_ptr->Invoke() != kTfLiteOk) {
         xprintf("Inference failed\n");
         return -1;
     }
 
-    // Dequantize output
-    memcpy(model_output, output->data.int8, output_length * sizeof(int8_t));
-    float af_score = (model_output[0] - output_zero_point) * output_scale;
-    af_score = fmaxf(0.0f, fminf(1.0f, af_score));  // Clamp to [0,1]
+    _inference_done(result_data, model_output, output_length);
+    return 0;
+}
 
-    // Print results (integer formatting workaround)
-    int score_percent = (int)(af_score * 100);
-    xprintf("AF: raw=%d, score=%d%%, %s\n", 
-           model_output[0], score_percent,
-           af_score >= 0.5f ? "DETECTED" : "normal");
+int run_af_model_step(const float *step, int8_t *model_output, uint32_t output_length) {
+    const int8_t *window;
 
+    // Quantize the new step only, the rest of the window is kept quantized
+    for (int i = 0; i < MODEL_INPUT_FEATURES; i++) {
+        int8_t q = _quantize(step[i]);
+        step_ring[step_head + i] = q;
+        step_ring[step_head + step_window + i] = q;
+    }
+    step_head = (step_head + MODEL_INPUT_FEATURES) % step_window;
+    if (step_count < MODEL_INPUT_TIMESTEPS)
+        step_count++;
+    if (step_count < MODEL_INPUT_TIMESTEPS)
+        return 1;
+    if (model_output == nullptr) {
+#if AF_STEP_SHIFTED
+        // The kept first layer misses this step, the next inference is a full one
+        step_shifted_ready = false;
+#endif
+        return 0;
+    }
+    window = step_ring + step_head;
+
+#ifdef AF_COMPILED_MODEL
+    if (compiled_active) {
+        int ret;
+
+        if (output_length > AF_COMPILED_OUTPUT_SIZE)
+            output_length = AF_COMPILED_OUTPUT_SIZE;
+#if AF_STEP_SHIFTED
+        // Only the first-layer columns that see the new step are computed
+        ret = step_shifted_ready ? af_compiled_invoke_shifted(window, compiled_output)
+                                 : af_compiled_invoke(window, compiled_output);
+        step_shifted_ready = (ret == 0);
+#else
+        memcpy(compiled_input, window, step_window);
+        ret = af_compiled_invoke(compiled_input, compiled_output);
+#endif
+        if (ret != 0) {
+            xprintf("Inference failed\n");
+            return -1;
+        }
+        _inference_done(compiled_output, model_output, output_length);
+        return 0;
+    }
+#endif
+    if (int_ptr == nullptr) {
+        return -1;
+    }
+    memcpy(input->data.int8, window, step_window);
+    if (int_ptr->Invoke() != kTfLiteOk) {
+        xprintf("Inference failed\n");
+        return -1;
+    }
+    _inference_done(output->data.int8, model_output, output_length);
     return 0;
 }
 
+void af_model_step_reset(void)
+{
+    step_head = 0;
+    step_count = 0;
+#if AF_STEP_SHIFTED
+    step_shifted_ready = false;
+#endif
+}
+
 int cv_deinit()
 {
 	//TODO: add more deinit items here if need.
@@ -16,8 +16,68 @@ extern "C" {
 
 int init_model(bool security_enable, bool privilege_enable);
 
+/**
+ * @brief Binds a model to the interpreter, rebuilding it in place.
+ *
+ * The NPU and op resolver set up by init_model() are kept. Quantization
+ * parameters are taken from the model's input and output tensors.
+ *
+ * @param model_addr Address of the .tflite flatbuffer (16-byte aligned).
+ * @param model_size Size of the flatbuffer in bytes, or 0 to skip verification.
+ * @return 0 on success, -1 on failure (no model is bound afterwards).
+ */
+int bind_model(const void *model_addr, uint32_t model_size);
+
 int run_af_model(test_sample_t* sample, int8_t *model_output, uint32_t output_length);
 
+/**
+ * @brief Runs the model on a window that slides by one time step per call.
+ *
+ * Only the MODEL_INPUT_FEATURES values of the new step are quantized; the
+ * window of the last MODEL_INPUT_TIMESTEPS steps is kept quantized and
+ * copied to the model input as is. A compiled model generated with
+ * af_compiled_invoke_shifted() (AF_COMPILED_SHIFTED) also keeps its first
+ * layer and only computes the columns that see the new step. The output is
+ * that of run_af_model() on the same window.
+ *
+ * @param step The new time step, MODEL_INPUT_FEATURES values.
+ * @param model_output NULL only adds the step to the window, without an
+ *        inference, e.g. while inferences are gated by motion.
+ * @return 0 on success, or for a window that was not run (model_output
+ *         NULL), 1 while less than a window has been given (no inference),
+ *         -1 on failure.
+ */
+int run_af_model_step(const float *step, int8_t *model_output, uint32_t output_length);
+
+/**
+ * @brief Empties the window of run_af_model_step(), e.g. after a gap.
+ *
+ * bind_model() does this too, the quantization may have changed.
+ */
+void af_model_step_reset(void);
+
+/**
+ * @brief Whether an input value fits the int8 input of the bound model.
+ *
+ * Values that do not are saturated by run_af_model() and run_af_model_step().
+ */
+bool af_model_input_fits(float val);
+
+/**
+ * @brief AF score of a raw model output, in percent.
+ */
+int af_model_score_pct(int8_t raw);
+
+/**
+ * @brief Seals the bound model in retained SRAM for a warm boot.
+ *
+ * After a PD_RET wake-up init_model() restores the interpreter sealed last,
+ * if its CRC still matches, instead of rebuilding it. Call it after the last
+ * inference before power down; bind_model() breaks the seal. No-op without
+ * AF_WARM_BOOT.
+ */
+void af_model_retain(void);
+
 int cv_deinit();
 #ifdef __cplusplus
 }
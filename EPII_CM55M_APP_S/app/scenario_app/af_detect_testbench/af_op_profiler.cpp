@@ -0,0 +1,69 @@
+#include "af_op_profiler.h"
+#include <string.h>
+#include "WE2_device.h"
+#include "xprintf.h"
+
+#define CPU_CLK	0xffffff+1
+
+uint32_t AfOpProfiler::BeginEvent(const char *tag)
+{
+	if (!enabled_ || position_ >= AF_PROFILER_MAX_OPS) {
+		return AF_PROFILER_MAX_OPS;
+	}
+
+	uint32_t handle = position_++;
+	if (handle >= (uint32_t)num_ops_) {
+		tags_[handle] = tag;
+		num_ops_ = handle + 1;
+	}
+	/* Operators do not nest, a single start time is enough */
+	SystemGetTick(&start_systick_, &start_loop_cnt_);
+	return handle;
+}
+
+void AfOpProfiler::EndEvent(uint32_t event_handle)
+{
+	uint32_t systick, loop_cnt;
+
+	SystemGetTick(&systick, &loop_cnt);
+	if (event_handle >= AF_PROFILER_MAX_OPS) {
+		return;
+	}
+	ticks_[event_handle] += (loop_cnt-start_loop_cnt_)*CPU_CLK+(start_systick_-systick);
+}
+
+void AfOpProfiler::Reset()
+{
+	memset(tags_, 0, sizeof(tags_));
+	memset(ticks_, 0, sizeof(ticks_));
+	num_ops_ = 0;
+	position_ = 0;
+}
+
+void AfOpProfiler::NewRun()
+{
+	position_ = 0;
+}
+
+uint32_t AfOpProfiler::ticks_for(const char *tag) const
+{
+	uint32_t sum = 0;
+
+	for (int i = 0; i < num_ops_; i++) {
+		if (tags_[i] != nullptr && strcmp(tags_[i], tag) == 0) {
+			sum += ticks_[i];
+		}
+	}
+	return sum;
+}
+
+void AfOpProfiler::Log(const char *label, uint32_t runs) const
+{
+	if (runs == 0) {
+		return;
+	}
+	for (int i = 0; i < num_ops_; i++) {
+		xprintf("%s op %d %s: Tick:[%lu]\n", label, i,
+				tags_[i] != nullptr ? tags_[i] : "?", ticks_[i] / runs);
+	}
+}
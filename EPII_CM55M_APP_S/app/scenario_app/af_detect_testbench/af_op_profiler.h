@@ -0,0 +1,48 @@
+#ifndef AF_OP_PROFILER_H
+#define AF_OP_PROFILER_H
+
+#include <stdint.h>
+#include "tensorflow/lite/micro/micro_profiler_interface.h"
+
+// Max number of operators per Invoke() that are timed separately
+#define AF_PROFILER_MAX_OPS 16
+
+/**
+ * @brief Per-operator tick profiler handed to the TFLM interpreter.
+ *
+ * The interpreter reports one event per operator and Invoke(). Events are
+ * matched by their position in the graph, so ticks of the same operator are
+ * summed over all runs between Reset() and Log(). Nothing is recorded while
+ * disabled, which keeps the overhead off the normal testbench loop.
+ */
+class AfOpProfiler : public tflite::MicroProfilerInterface {
+public:
+	uint32_t BeginEvent(const char *tag) override;
+	void EndEvent(uint32_t event_handle) override;
+
+	/* Clears all accumulated ticks */
+	void Reset();
+	/* Starts recording, call before every Invoke() */
+	void NewRun();
+	void Enable(bool enable) { enabled_ = enable; }
+
+	int num_ops() const { return num_ops_; }
+	const char *op_tag(int op) const { return tags_[op]; }
+	uint32_t op_ticks(int op) const { return ticks_[op]; }
+	/* Sum of the ticks of all operators whose tag matches */
+	uint32_t ticks_for(const char *tag) const;
+
+	/* Prints the average ticks per operator over runs Invoke() calls */
+	void Log(const char *label, uint32_t runs) const;
+
+private:
+	const char *tags_[AF_PROFILER_MAX_OPS] = {};
+	uint32_t ticks_[AF_PROFILER_MAX_OPS] = {};
+	uint32_t start_systick_ = 0;
+	uint32_t start_loop_cnt_ = 0;
+	int num_ops_ = 0;
+	int position_ = 0;
+	bool enabled_ = false;
+};
+
+#endif // AF_OP_PROFILER_H
@@ -0,0 +1,325 @@
+/*
+ * af_rtos_pipeline.c
+ *
+ * See af_rtos_pipeline.h. The tasks are created on the first run and kept
+ * for the next models of a sweep; each run refills the free queue and
+ * wakes the reader, the writer gives done_sem after the end marker.
+ */
+#ifdef AF_TESTBENCH_RTOS
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "WE2_device.h"
+#include "xprintf.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include "queue.h"
+#include "semphr.h"
+#include "common_config.h"
+#include "af_model_run.h"
+#include "sd_card_testbench.h"
+#include "af_rtos_pipeline.h"
+
+#if (configGENERATE_RUN_TIME_STATS != 1)
+#error "AF_TESTBENCH_RTOS needs -DconfigGENERATE_RUN_TIME_STATS=1 (af_detect_testbench.mk)"
+#endif
+
+#define AF_MAIN_STACK		2048	/* words, init_model() and the model sweep */
+#define AF_TASK_STACK		1024	/* words, a FatFs FIL holds a sector buffer */
+#define AF_INFER_PRIO		(configMAX_PRIORITIES - 1)
+#define AF_READER_PRIO		(configMAX_PRIORITIES - 2)
+#define AF_WRITER_PRIO		(configMAX_PRIORITIES - 3)
+#define AF_MAIN_PRIO		(tskIDLE_PRIORITY + 1)
+#define AF_MAX_TASKS		8		/* uxTaskGetSystemState() snapshot */
+
+typedef enum {
+	AF_SLOT_SAMPLE = 0,
+	AF_SLOT_FAILED,					/* inference failed, nothing to save */
+	AF_SLOT_END,					/* no sample, the run is over */
+} af_slot_state_t;
+
+typedef struct {
+	test_sample_t sample;
+	uint32_t index;
+	int8_t output[1];
+	af_slot_state_t state;
+} af_slot_t;
+
+enum { AF_TASK_READER = 0, AF_TASK_INFER, AF_TASK_WRITER, AF_TASK_NUM };
+
+/* Utilization counters at one point of the run */
+typedef struct {
+	TickType_t tick;
+	uint32_t run_us[AF_TASK_NUM];
+	uint32_t other_us;				/* main and timer tasks, not idle */
+	uint32_t samples;
+	uint32_t stalls[AF_TASK_NUM];
+} af_mark_t;
+
+static af_slot_t af_slot[AF_RTOS_PIPELINE_SLOTS];
+static QueueHandle_t free_q = NULL;
+static QueueHandle_t infer_q = NULL;
+static QueueHandle_t write_q = NULL;
+static SemaphoreHandle_t done_sem = NULL;
+static TaskHandle_t af_task[AF_TASK_NUM];
+
+static const af_model_image_t *run_image;
+static uint32_t run_max_index;
+static volatile uint32_t run_samples;
+/* a task found its input queue empty and had to wait */
+static volatile uint32_t run_stalls[AF_TASK_NUM];
+
+static af_slot_t *af_take(QueueHandle_t q, int task)
+{
+	af_slot_t *slot;
+
+	if (xQueueReceive(q, &slot, 0) != pdTRUE) {
+		run_stalls[task]++;
+		xQueueReceive(q, &slot, portMAX_DELAY);
+	}
+	return slot;
+}
+
+static void af_mark(af_mark_t *mark)
+{
+	TaskStatus_t status[AF_MAX_TASKS];
+	TaskHandle_t idle = xTaskGetIdleTaskHandle();
+	UBaseType_t n = uxTaskGetSystemState(status, AF_MAX_TASKS, NULL);
+
+	memset(mark, 0, sizeof(*mark));
+	mark->tick = xTaskGetTickCount();
+	mark->samples = run_samples;
+	for (int t = 0; t < AF_TASK_NUM; t++)
+		mark->stalls[t] = run_stalls[t];
+
+	for (UBaseType_t i = 0; i < n; i++) {
+		int t;
+
+		for (t = 0; t < AF_TASK_NUM; t++) {
+			if (status[i].xHandle == af_task[t])
+				break;
+		}
+		if (t < AF_TASK_NUM)
+			mark->run_us[t] = status[i].ulRunTimeCounter;
+		else if (status[i].xHandle != idle)
+			mark->other_us += status[i].ulRunTimeCounter;
+	}
+}
+
+/* Wall time comes from the tick count: the run time counter stops while the core sleeps */
+static void af_report(const char *what, const af_mark_t *from, const af_mark_t *to)
+{
+	uint32_t wall_ms = (uint32_t)(to->tick - from->tick) * portTICK_PERIOD_MS;
+	uint32_t wall_us = wall_ms * 1000;
+	uint32_t n = to->samples - from->samples;
+	uint32_t pct[AF_TASK_NUM + 1];
+	uint32_t busy = 0;
+
+	if (wall_ms == 0)
+		return;
+	for (int t = 0; t < AF_TASK_NUM; t++) {
+		pct[t] = (uint32_t)((uint64_t)(to->run_us[t] - from->run_us[t]) * 100 / wall_us);
+		busy += pct[t];
+	}
+	pct[AF_TASK_NUM] = (uint32_t)((uint64_t)(to->other_us - from->other_us) * 100 / wall_us);
+	busy += pct[AF_TASK_NUM];
+
+	xprintf("%s: %lu samples in %lu ms, %lu.%02lu samples/s\n", what, n, wall_ms,
+			(uint32_t)((uint64_t)n * 1000 / wall_ms), (uint32_t)((uint64_t)n * 100000 / wall_ms % 100));
+	xprintf("  busy: reader %lu%%, infer %lu%%, writer %lu%%, other %lu%%, idle %lu%%\n",
+			pct[AF_TASK_READER], pct[AF_TASK_INFER], pct[AF_TASK_WRITER], pct[AF_TASK_NUM],
+			busy < 100 ? 100 - busy : 0);
+	xprintf("  stalls: reader %lu (no free slot), infer %lu (no sample), writer %lu (no result)\n",
+			to->stalls[AF_TASK_READER] - from->stalls[AF_TASK_READER],
+			to->stalls[AF_TASK_INFER] - from->stalls[AF_TASK_INFER],
+			to->stalls[AF_TASK_WRITER] - from->stalls[AF_TASK_WRITER]);
+}
+
+static void af_reader_task(void *arg)
+{
+	(void)arg;
+
+	for (;;) {
+		uint32_t current_index = 0;
+
+		ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+		for (;;) {
+			af_slot_t *slot = af_take(free_q, AF_TASK_READER);
+			FRESULT fr;
+
+			if (current_index >= run_max_index) {
+				slot->state = AF_SLOT_END;
+				xQueueSend(infer_q, &slot, portMAX_DELAY);
+				break;
+			}
+
+			fr = load_next_test_vector(current_index, &slot->sample, &slot->index);
+			if (fr != FR_OK) {
+				if (fr == FR_NO_FILE) {
+					xprintf("Reached end of test samples at index %lu\n", current_index);
+				} else {
+					xprintf("Fatal error loading sample %lu: %d\n", current_index, fr);
+				}
+				slot->state = AF_SLOT_END;
+				xQueueSend(infer_q, &slot, portMAX_DELAY);
+				break;
+			}
+
+			slot->state = AF_SLOT_SAMPLE;
+			current_index = slot->index + 1;
+			xQueueSend(infer_q, &slot, portMAX_DELAY);
+		}
+	}
+}
+
+static void af_infer_task(void *arg)
+{
+	(void)arg;
+
+	for (;;) {
+		af_slot_t *slot = af_take(infer_q, AF_TASK_INFER);
+
+		if (slot->state == AF_SLOT_SAMPLE && run_af_model(&slot->sample, slot->output, 1) != 0) {
+			xprintf("Inference failed for sample %lu\n", slot->index);
+			slot->state = AF_SLOT_FAILED;
+		}
+		xQueueSend(write_q, &slot, portMAX_DELAY);
+	}
+}
+
+static void af_writer_task(void *arg)
+{
+	af_mark_t start, window, now;
+	uint32_t last_index = 0;
+
+	(void)arg;
+
+	af_mark(&start);
+	window = start;
+
+	for (;;) {
+		af_slot_t *slot = af_take(write_q, AF_TASK_WRITER);
+
+		if (slot->state == AF_SLOT_END) {
+			af_mark(&now);
+			xprintf("Test sequence completed for '%s'. Last processed sample: %lu\n", run_image->name, last_index);
+			af_report("pipeline total", &start, &now);
+			xQueueSend(free_q, &slot, 0);
+			xSemaphoreGive(done_sem);
+			/* the next run starts when the reader is woken again */
+			ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+			af_mark(&start);
+			window = start;
+			continue;
+		}
+
+		if (slot->state == AF_SLOT_SAMPLE) {
+			FRESULT fr = save_result_vector_bulk(slot->index, slot->output, 1, run_image->result_prefix);
+
+			if (fr != FR_OK) {
+				xprintf("Failed to save results for sample %lu: %d\n", slot->index, fr);
+			}
+			if (slot->index % 100 == 0) {
+				xprintf("Processed %lu samples...\n", slot->index + 1);
+			}
+			last_index = slot->index;
+			run_samples++;
+		}
+		xQueueSend(free_q, &slot, 0);
+
+		if (run_samples - window.samples >= AF_RTOS_REPORT_SAMPLES) {
+			af_mark(&now);
+			af_report("pipeline", &window, &now);
+			window = now;
+		}
+	}
+}
+
+static int af_rtos_create(void)
+{
+	static const struct {
+		TaskFunction_t fn;
+		const char *name;
+		UBaseType_t prio;
+	} tasks[AF_TASK_NUM] = {
+		[AF_TASK_READER] = { af_reader_task, "AFReader", AF_READER_PRIO },
+		[AF_TASK_INFER] = { af_infer_task, "AFInfer", AF_INFER_PRIO },
+		[AF_TASK_WRITER] = { af_writer_task, "AFWriter", AF_WRITER_PRIO },
+	};
+
+	free_q = xQueueCreate(AF_RTOS_PIPELINE_SLOTS, sizeof(af_slot_t *));
+	infer_q = xQueueCreate(AF_RTOS_PIPELINE_SLOTS, sizeof(af_slot_t *));
+	write_q = xQueueCreate(AF_RTOS_PIPELINE_SLOTS, sizeof(af_slot_t *));
+	done_sem = xSemaphoreCreateBinary();
+	if (free_q == NULL || infer_q == NULL || write_q == NULL || done_sem == NULL) {
+		xprintf("AF pipeline: queue creation failed\n");
+		return -1;
+	}
+
+	for (int t = 0; t < AF_TASK_NUM; t++) {
+		if (xTaskCreate(tasks[t].fn, tasks[t].name, AF_TASK_STACK, NULL, tasks[t].prio, &af_task[t]) != pdPASS) {
+			xprintf("AF pipeline: %s creation failed\n", tasks[t].name);
+			return -1;
+		}
+	}
+	return 0;
+}
+
+int af_rtos_pipeline_run(const af_model_image_t *image, uint32_t max_index)
+{
+	static bool created = false;
+
+	xprintf("Running testbench with model '%s', %d slots in flight\n", image->name, AF_RTOS_PIPELINE_SLOTS);
+
+	run_image = image;
+	run_max_index = max_index;
+	run_samples = 0;
+	for (int t = 0; t < AF_TASK_NUM; t++)
+		run_stalls[t] = 0;
+
+	/* the writer takes its start mark as soon as it runs */
+	if (!created) {
+		if (af_rtos_create() != 0)
+			return -1;
+		created = true;
+	} else {
+		xTaskNotifyGive(af_task[AF_TASK_WRITER]);
+	}
+
+	xQueueReset(free_q);
+	for (int i = 0; i < AF_RTOS_PIPELINE_SLOTS; i++) {
+		af_slot_t *slot = &af_slot[i];
+
+		xQueueSend(free_q, &slot, 0);
+	}
+
+	xTaskNotifyGive(af_task[AF_TASK_READER]);
+	xSemaphoreTake(done_sem, portMAX_DELAY);
+	return 0;
+}
+
+static int (*main_entry)(void);
+
+static void af_main_task(void *arg)
+{
+	(void)arg;
+
+	main_entry();
+	vTaskDelete(NULL);
+}
+
+int af_rtos_start(int (*entry)(void))
+{
+	main_entry = entry;
+	if (xTaskCreate(af_main_task, "AFMain", AF_MAIN_STACK, NULL, AF_MAIN_PRIO, NULL) != pdPASS) {
+		xprintf("AFMain creation failed\n");
+		return -1;
+	}
+	vTaskStartScheduler();
+
+	xprintf("vTaskStartScheduler returned\n");
+	return -1;
+}
+#endif /* AF_TESTBENCH_RTOS */
@@ -0,0 +1,73 @@
+#ifndef AF_RTOS_PIPELINE_H
+#define AF_RTOS_PIPELINE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include "af_model_loader.h"
+
+/*
+ * FreeRTOS build of the testbench (AF_TESTBENCH_RTOS=y in af_detect_testbench.mk).
+ *
+ * Three tasks pass sample slots to each other through queues of slot
+ * pointers, so a sample is read from the SD card straight into the buffer
+ * that inference and the result writer use:
+ *
+ *   free -> reader (load_next_test_vector) -> infer (run_af_model)
+ *        -> writer (save_result_vector_bulk, metrics) -> free
+ *
+ * The reader sleeps on the SPI completion of each SD block while the infer
+ * task sleeps on the NPU interrupt (ethosu_semaphore_*), so SD I/O and NPU
+ * work overlap. With AF_RTOS_PIPELINE_SLOTS 1 only one sample is in flight,
+ * which is the serial loop measured with the same counters.
+ */
+
+// Samples in flight between the tasks
+#ifndef AF_RTOS_PIPELINE_SLOTS
+#define AF_RTOS_PIPELINE_SLOTS 4
+#endif
+
+// Samples between two metric reports of the writer
+#ifndef AF_RTOS_REPORT_SAMPLES
+#define AF_RTOS_REPORT_SAMPLES 1024
+#endif
+
+/**
+ * @brief Runs entry in a task and starts the scheduler.
+ *
+ * Does not return unless the scheduler cannot start.
+ *
+ * @param entry Testbench main, called once in task context.
+ * @return -1 on failure.
+ */
+int af_rtos_start(int (*entry)(void));
+
+/**
+ * @brief Streams all test vectors through the bound model with the three tasks.
+ *
+ * Blocks the calling task until the last result is written, then logs the
+ * totals: samples/s and the share of time each task was running.
+ *
+ * @param image The bound model, for its name and result prefix.
+ * @param max_index Number of sample indices to process.
+ * @return 0 on success, -1 if the tasks or queues cannot be created.
+ */
+int af_rtos_pipeline_run(const af_model_image_t *image, uint32_t max_index);
+
+/**
+ * @brief Prepares the FreeRTOS versions of the NPU and SD SPI wait hooks (af_rtos_port.c).
+ *
+ * FreeRTOS calls from an ISR are only allowed at or below
+ * configMAX_SYSCALL_INTERRUPT_PRIORITY, so the priorities of the NPU and
+ * SD SPI interrupts (0 by default) are lowered. Call before sd_card_init()
+ * and init_model().
+ */
+void af_rtos_port_init(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // AF_RTOS_PIPELINE_H
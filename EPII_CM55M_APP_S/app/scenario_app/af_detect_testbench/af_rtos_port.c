@@ -0,0 +1,206 @@
+/*
+ * af_rtos_port.c
+ *
+ * FreeRTOS glue of the testbench (AF_TESTBENCH_RTOS): the static task
+ * memory hooks, the run time counter for per task utilization, and the
+ * blocking versions of the Ethos-U driver and SD SPI port wait hooks.
+ */
+#ifdef AF_TESTBENCH_RTOS
+#include <stdint.h>
+#include "WE2_device.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include "semphr.h"
+#include "timer_interface.h"
+#include "ethosu_driver.h"
+#include "mmc_we2.h"
+#include "af_rtos_pipeline.h"
+
+// Counting semaphores of the Ethos-U driver: one per registered driver at most
+#define ETHOSU_SEM_MAX_COUNT	8
+// A 512 byte SD block at the slow init clock takes about 20 ms
+#define SPI_XFER_TIMEOUT_MS		100
+
+static SemaphoreHandle_t spi_xfer_sem = NULL;
+
+void af_rtos_port_init(void)
+{
+	/* FreeRTOS FromISR calls need a priority at or below configMAX_SYSCALL_INTERRUPT_PRIORITY.
+	 * SSPI master completes in its own interrupt or on DMA2 (hx_drv_spi.h). */
+	NVIC_SetPriority((IRQn_Type)U55_IRQn, configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY);
+	NVIC_SetPriority((IRQn_Type)SSPI_HOST_IRQn, configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY);
+	NVIC_SetPriority((IRQn_Type)DMAC2_DMACINTTC_IRQn, configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY);
+	NVIC_SetPriority((IRQn_Type)DMAC2_DMACINTERR_IRQn, configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY);
+
+	if (spi_xfer_sem == NULL)
+		spi_xfer_sem = xSemaphoreCreateBinary();
+}
+
+static int af_rtos_in_isr(void)
+{
+	return __get_IPSR() != 0;
+}
+
+static int af_rtos_running(void)
+{
+	return xTaskGetSchedulerState() == taskSCHEDULER_RUNNING;
+}
+
+/*-----------------------------------------------------------*/
+/* Run time counter: DWT cycle counter extended to 64 bits, in us.
+ * It stops while the core sleeps, so it only measures task time; the
+ * pipeline takes wall time from the tick count. It must be read at least
+ * once per 2^32 cycles, which every context switch does. */
+
+static uint64_t run_time_cycles = 0;
+static uint32_t run_time_last = 0;
+static uint32_t run_time_cycles_per_us = 1;
+
+void vConfigureTimerForRunTimeStats(void)
+{
+	DCB->DEMCR |= DCB_DEMCR_TRCENA_Msk;
+	DWT->CYCCNT = 0;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+	run_time_last = 0;
+	run_time_cycles = 0;
+	run_time_cycles_per_us = SystemCoreClock / 1000000;
+	if (run_time_cycles_per_us == 0)
+		run_time_cycles_per_us = 1;
+}
+
+uint32_t ulGetRunTimeCounterValue(void)
+{
+	UBaseType_t mask = portSET_INTERRUPT_MASK_FROM_ISR();
+	uint32_t now = DWT->CYCCNT;
+	uint32_t us;
+
+	run_time_cycles += now - run_time_last;
+	run_time_last = now;
+	us = (uint32_t)(run_time_cycles / run_time_cycles_per_us);
+	portCLEAR_INTERRUPT_MASK_FROM_ISR(mask);
+	return us;
+}
+
+/*-----------------------------------------------------------*/
+/* Ethos-U driver: the infer task sleeps on the NPU interrupt instead of WFE */
+
+void *ethosu_mutex_create(void)
+{
+	return xSemaphoreCreateMutex();
+}
+
+void ethosu_mutex_destroy(void *mutex)
+{
+	vSemaphoreDelete((SemaphoreHandle_t)mutex);
+}
+
+int ethosu_mutex_lock(void *mutex)
+{
+	if (!af_rtos_running())
+		return 0;
+	return xSemaphoreTake((SemaphoreHandle_t)mutex, portMAX_DELAY) == pdTRUE ? 0 : -1;
+}
+
+int ethosu_mutex_unlock(void *mutex)
+{
+	if (!af_rtos_running())
+		return 0;
+	return xSemaphoreGive((SemaphoreHandle_t)mutex) == pdTRUE ? 0 : -1;
+}
+
+void *ethosu_semaphore_create(void)
+{
+	return xSemaphoreCreateCounting(ETHOSU_SEM_MAX_COUNT, 0);
+}
+
+void ethosu_semaphore_destroy(void *sem)
+{
+	vSemaphoreDelete((SemaphoreHandle_t)sem);
+}
+
+int ethosu_semaphore_take(void *sem, uint64_t timeout)
+{
+	TickType_t ticks = portMAX_DELAY;
+
+	if (timeout != ETHOSU_SEMAPHORE_WAIT_FOREVER)
+		ticks = pdMS_TO_TICKS((uint32_t)timeout);
+	return xSemaphoreTake((SemaphoreHandle_t)sem, ticks) == pdTRUE ? 0 : -1;
+}
+
+int ethosu_semaphore_give(void *sem)
+{
+	if (af_rtos_in_isr()) {
+		BaseType_t woken = pdFALSE;
+
+		xSemaphoreGiveFromISR((SemaphoreHandle_t)sem, &woken);
+		portYIELD_FROM_ISR(woken);
+		return 0;
+	}
+	return xSemaphoreGive((SemaphoreHandle_t)sem) == pdTRUE ? 0 : -1;
+}
+
+/*-----------------------------------------------------------*/
+/* SD SPI port (mmc_we2_spi.c): sleep until a data block is transferred */
+
+void mmc_spi_xfer_wait(void)
+{
+	if (spi_xfer_sem == NULL || !af_rtos_running() || af_rtos_in_isr())
+		return;
+	/* on timeout the port still polls the driver status */
+	xSemaphoreTake(spi_xfer_sem, pdMS_TO_TICKS(SPI_XFER_TIMEOUT_MS));
+}
+
+void mmc_spi_xfer_done(void)
+{
+	BaseType_t woken = pdFALSE;
+
+	if (spi_xfer_sem == NULL)
+		return;
+	if (af_rtos_in_isr()) {
+		xSemaphoreGiveFromISR(spi_xfer_sem, &woken);
+		portYIELD_FROM_ISR(woken);
+	} else {
+		xSemaphoreGive(spi_xfer_sem);
+	}
+}
+
+void mmc_spi_delay_ms(UINT ms)
+{
+	TickType_t ticks = pdMS_TO_TICKS(ms);
+
+	if (!af_rtos_running()) {
+		hx_drv_timer_cm55x_delay_ms(ms, TIMER_STATE_DC);
+		return;
+	}
+	vTaskDelay(ticks ? ticks : 1);
+}
+
+/*-----------------------------------------------------------*/
+/* configSUPPORT_STATIC_ALLOCATION is 1: memory of the idle and timer tasks */
+
+void vApplicationGetIdleTaskMemory(StaticTask_t **ppxIdleTaskTCBBuffer,
+		StackType_t **ppxIdleTaskStackBuffer, uint32_t *pulIdleTaskStackSize) {
+	static StaticTask_t xIdleTaskTCB;
+	static StackType_t uxIdleTaskStack[configMINIMAL_STACK_SIZE + 100];
+
+	*ppxIdleTaskTCBBuffer = &xIdleTaskTCB;
+	*ppxIdleTaskStackBuffer = uxIdleTaskStack;
+	*pulIdleTaskStackSize = configMINIMAL_STACK_SIZE + 100;
+}
+
+void vApplicationGetTimerTaskMemory(StaticTask_t **ppxTimerTaskTCBBuffer,
+		StackType_t **ppxTimerTaskStackBuffer, uint32_t *pulTimerTaskStackSize) {
+	static StaticTask_t xTimerTaskTCB;
+	static StackType_t uxTimerTaskStack[configTIMER_TASK_STACK_DEPTH];
+
+	*ppxTimerTaskTCBBuffer = &xTimerTaskTCB;
+	*ppxTimerTaskStackBuffer = uxTimerTaskStack;
+	*pulTimerTaskStackSize = configTIMER_TASK_STACK_DEPTH;
+}
+
+void vApplicationStackOverflowHook(TaskHandle_t xTask, char *pcTaskName) {
+	(void) xTask;
+
+	configASSERT(pcTaskName == 0);
+}
+#endif /* AF_TESTBENCH_RTOS */
@@ -63,6 +63,28 @@
 //#include "af_detection.h"
 #include "model_data.h"
 #include "sd_card_testbench.h"
+#include "af_model_loader.h"
+#ifdef AF_TESTBENCH_RTOS
+#include "af_rtos_pipeline.h"
+#endif
+#if AF_ECG_STREAM
+#include "af_ecg_stream.h"
+#endif
+#if AF_LOG_DEFERRED
+#include "hx_dlog.h"
+#endif
+#if (AF_DUTY_PERIOD_MS > 0) && !defined(AF_TESTBENCH_RTOS)
+#define AF_DUTY_CYCLE 1
+#if (RUNTIME_MODEL_LOAD != 0)
+#error "AF_DUTY_PERIOD_MS needs RUNTIME_MODEL_LOAD 0"
+#endif
+#include "hx_lpsched.h"
+#else
+#define AF_DUTY_CYCLE 0
+#endif
+#if AF_ECG_STREAM && AF_DUTY_CYCLE
+#error "AF_ECG_STREAM and AF_DUTY_PERIOD_MS cannot be used together"
+#endif
 
 #ifdef EPII_FPGA
 #define DBG_APP_LOG             (1)
@@ -79,25 +101,229 @@
 #define MAX_STRING  100
 #define DEBUG_SPIMST_SENDPICS		(0x01) //0x00: off/ 0x01: JPEG/0x02: YUV422/0x03: YUV420/0x04: YUV400/0x05: RGB
 #define SPI_SEN_PIC_CLK				(10000000)
+#define CPU_CLK	0xffffff+1
 
 
 /*******************************************************************************
  * Code
  ******************************************************************************/
 /*!
- * @brief Main function
+ * @brief Streams all test vectors, or the raw signal record (AF_ECG_STREAM),
+ * through the bound model and saves the results.
  */
-int app_main(void) {
+static int run_testbench(const af_model_image_t *image, uint32_t max_index)
+{
+#if AF_ECG_STREAM
+    return af_ecg_stream_run(image);
+#elif defined(AF_TESTBENCH_RTOS)
+    return af_rtos_pipeline_run(image, max_index);
+#else
+    test_sample_t my_test_sample;
+    uint32_t current_index = 0;
+    uint32_t loaded_index = 0;
+    uint32_t samples = 0;
+    uint32_t systick_1, systick_2, loop_cnt_1, loop_cnt_2, clk = 0;
+    uint64_t ticks;
+    int8_t model_output[1];
+    FRESULT fr;
+
+    xprintf("Running testbench with model '%s'\n", image->name);
+#if AF_LOG_DEFERRED
+    // Lines of the loop go out by UART DMA between samples, see af_log.h
+    hx_dlog_init(AF_LOG_DEFERRED == 2 ? HX_DLOG_BINARY : HX_DLOG_TEXT, &hx_dlog_we2_port);
+    hx_dlog_we2_capture(1);
+#endif
+    SystemGetTick(&systick_1, &loop_cnt_1);
+
+while(1) {
+    // 1. Load test vector with error handling
+    fr = load_next_test_vector(current_index, &my_test_sample, &loaded_index);
+    if (fr != FR_OK) {
+        if (fr == FR_NO_FILE) {
+            xprintf("Reached end of test samples at index %lu\n", current_index);
+        } else {
+            xprintf("Fatal error loading sample %lu: %d\n", current_index, fr);
+        }
+        break;
+    }
+
+    // 2. Run inference
+    if (run_af_model(&my_test_sample, model_output, 1) != 0) {
+        xprintf("Inference failed for sample %lu\n", loaded_index);
+        current_index = loaded_index + 1; // Skip to next sample
+        continue;
+    }
+    // xprintf("Main loop first result value: raw=%d\r\n", model_output[0]);
+    // 3. Get and save results
+    fr = save_result_vector_bulk(loaded_index, model_output, 1, image->result_prefix);
+    if (fr != FR_OK) {
+        xprintf("Failed to save results for sample %lu: %d\n", loaded_index, fr);
+        // Continue processing next sample despite save failure
+    }
+    samples++;
+
+    // 4. Progress update every 100 samples
+    if (loaded_index % 100 == 0) {
+        xprintf("Processed %lu samples...\n", loaded_index + 1);
+    }
+
+#if AF_LOG_DEFERRED
+    // The UART sends this sample's lines while the next one is read and run
+    hx_dlog_drain();
+#endif
+
+    // 5. Update index (use the actually loaded index)
+    current_index = loaded_index + 1;
+
+    // 6. Has all requested data been processed
+    if (current_index >= max_index){
+        break;
+    }
+}
+
+xprintf("Test sequence completed for '%s'. Last processed sample: %lu\n", image->name, loaded_index);
+
+    // Throughput of the serial loop, to compare with the FreeRTOS pipeline
+    SystemGetTick(&systick_2, &loop_cnt_2);
+#if AF_LOG_DEFERRED
+    {
+        hx_dlog_stats st;
+
+        hx_dlog_we2_capture(0);
+        hx_dlog_stop();
+        hx_dlog_get_stats(&st);
+        xprintf("dlog: %lu records, %lu dropped, %lu bytes, ring high water %lu words\n",
+                st.records, st.dropped, st.bytes_out, st.max_used);
+    }
+#endif
+    EPII_Get_Systemclock(&clk);
+    ticks = (uint64_t)(loop_cnt_2 - loop_cnt_1) * CPU_CLK + systick_1 - systick_2;
+    if (clk >= 1000 && ticks > 0) {
+        uint32_t ms = (uint32_t)(ticks / (clk / 1000));
+
+        xprintf("serial loop: %lu samples in %lu ms, %lu.%02lu samples/s\n", samples, ms,
+                (uint32_t)((uint64_t)samples * clk / ticks), (uint32_t)((uint64_t)samples * clk * 100 / ticks % 100));
+    }
+	return 0;
+#endif
+}
+
+#if AF_DUTY_CYCLE
+typedef struct {
+    const af_model_image_t *image;
+    uint32_t max_index;
+    int done;
+} af_duty_ctx_t;
+
+/* Survives PD_RET; after PD the schedule starts over */
+static hx_lpsched af_sched __attribute__((section(".bss.NoInit")));
+static af_duty_ctx_t af_duty;
+
+static void af_duty_sample(void *arg);
+
+static const hx_lpsched_job af_duty_job = {
+    "af", AF_DUTY_PERIOD_MS * 1000, AF_DUTY_LATE_MS * 1000, HX_LPSCHED_PD, af_duty_sample, &af_duty
+};
+
+/*!
+ * @brief One sample per period; the next index is kept in the AON register
+ *        appused1, which survives both PD states.
+ */
+static void af_duty_sample(void *arg)
+{
+    af_duty_ctx_t *ctx = (af_duty_ctx_t *)arg;
+    test_sample_t my_test_sample;
+    uint32_t current_index, loaded_index;
+    int8_t model_output[1];
+    FRESULT fr;
+
+    hx_drv_swreg_aon_get_appused1(&current_index);
+    if (current_index >= ctx->max_index) {
+        ctx->done = 1;
+        return;
+    }
+    fr = load_next_test_vector(current_index, &my_test_sample, &loaded_index);
+    if (fr != FR_OK) {
+        if (fr == FR_NO_FILE) {
+            xprintf("Reached end of test samples at index %lu\n", current_index);
+        } else {
+            xprintf("Fatal error loading sample %lu: %d\n", current_index, fr);
+        }
+        ctx->done = 1;
+        return;
+    }
+
+    if (run_af_model(&my_test_sample, model_output, 1) != 0) {
+        xprintf("Inference failed for sample %lu\n", loaded_index);
+    } else {
+        fr = save_result_vector_bulk(loaded_index, model_output, 1, ctx->image->result_prefix);
+        if (fr != FR_OK) {
+            xprintf("Failed to save results for sample %lu: %d\n", loaded_index, fr);
+        }
+    }
+    hx_drv_swreg_aon_set_appused1(loaded_index + 1);
+    // Whatever the scheduler picks next, PD_RET can skip init_model() on wake-up
+    af_model_retain();
+
+    if ((loaded_index + 1) % AF_DUTY_REPORT_RUNS == 0) {
+        hx_lpsched_report(&af_sched, xprintf);
+    }
+}
+
+/*!
+ * @brief Runs the testbench one sample every AF_DUTY_PERIOD_MS, sleeping in
+ *        between. A PD wake-up boots through testbench_main() again and comes
+ *        back here.
+ */
+static int run_duty_cycled(const af_model_image_t *image, uint32_t max_index)
+{
+    hx_lpsched_state woke;
+
+    af_duty.image = image;
+    af_duty.max_index = max_index;
+    af_duty.done = 0;
+    hx_lpsched_add(&af_sched, &af_duty_job);
+    woke = hx_lpsched_start(&af_sched);
+    if (woke != HX_LPSCHED_ACTIVE) {
+        // parsed by library/lpsched/test (make sim LOG=...)
+        xprintf("lpsched wake %s %u us\n", hx_lpsched_state_name(woke), af_sched.last_wake_us[woke]);
+    } else {
+        xprintf("Duty cycling model '%s', one sample every %u ms\n", image->name, AF_DUTY_PERIOD_MS);
+    }
+
+    while (!af_duty.done) {
+        hx_lpsched_run(&af_sched);
+    }
+
+    xprintf("Duty cycled test sequence completed for '%s'\n", image->name);
+    hx_lpsched_report(&af_sched, xprintf);
+    return 0;
+}
+#endif
+
+/*!
+ * @brief Testbench main, runs in a task in the FreeRTOS build
+ */
+static int testbench_main(void) {
         test_sample_t my_test_sample;
         uint32_t current_index = 0;
         const uint32_t max_index = 51200 + 25600 + 25600;
         uint32_t loaded_index = 0;
-        int8_t model_output[1];
+        af_model_image_t model_image;
         FRESULT fr;
 	uint32_t wakeup_event;
 	uint32_t wakeup_event1;
-	model_output[0] = 123;
 	
+#ifdef AF_TESTBENCH_RTOS
+	af_rtos_port_init();
+#endif
+#if AF_DUTY_CYCLE
+	// First thing after reset, the wake-up latency counts from here
+	hx_lpsched_init(&af_sched, &hx_lpsched_we2_port, NULL);
+	if (!hx_lpsched_we2_port.pd_wakeup()) {
+		hx_drv_swreg_aon_set_appused1(0);
+	}
+#endif
 	if (sd_card_init("blindfold_test_vectors","blindfold_test_vectors") != FR_OK) { // Use FR_OK for success check
           xprintf("SD card FatFs initialization failed in testbench_init!\r\n");
           return -1; // Indicate failure
@@ -130,51 +356,50 @@ int app_main(void) {
     hx_lib_spi_eeprom_enable_XIP(USE_DW_SPI_MST_Q, true, FLASH_QUAD, true);
 #endif
 
-    if(init_init(true, true)<0) {
+    if(init_model(true, true)<0) {
     	xprintf("cv init fail\n");
     	return -1;
     }
-    
-while(1) {
-    // 1. Load test vector with error handling
-    fr = load_next_test_vector(current_index, &my_test_sample, &loaded_index);
-    if (fr != FR_OK) {
-        if (fr == FR_NO_FILE) {
-            xprintf("Reached end of test samples at index %lu\n", current_index);
-        } else {
-            xprintf("Fatal error loading sample %lu: %d\n", current_index, fr);
-        }
-        break;
-    }
 
-    // 2. Run inference
-    if (run_model(&my_test_sample, model_output, 1) != 0) {
-        xprintf("Inference failed for sample %lu\n", loaded_index);
-        current_index = loaded_index + 1; // Skip to next sample
-        continue;
-    }
-    // xprintf("Main loop first result value: raw=%d\r\n", model_output[0]);
-    // 3. Get and save results
-    fr = save_result_vector_bulk(loaded_index, model_output, 1, "qdense_bulk_result_");
-    if (fr != FR_OK) {
-        xprintf("Failed to save results for sample %lu: %d\n", loaded_index, fr);
-        // Continue processing next sample despite save failure
+#if (RUNTIME_MODEL_LOAD == 0)
+    af_model_builtin(&model_image);
+#if AF_DUTY_CYCLE
+    run_duty_cycled(&model_image, max_index);
+#else
+    run_testbench(&model_image, max_index);
+#endif
+#elif (RUNTIME_MODEL_LOAD == 1)
+    // Sweep every model listed on the SD card without reflashing
+    char model_name[MODEL_NAME_LEN];
+    for (uint32_t position = 0; af_model_sweep_entry(position, model_name) == FR_OK; position++) {
+        if (af_model_load_sd(model_name, &model_image) != FR_OK ||
+            bind_model(model_image.data, model_image.size) != 0) {
+            xprintf("Skipping model '%s'\n", model_name);
+            continue;
+        }
+        run_testbench(&model_image, max_index);
     }
-
-    // 4. Progress update every 100 samples
-    if (loaded_index % 100 == 0) {
-        xprintf("Processed %lu samples...\n", loaded_index + 1);
+#elif (RUNTIME_MODEL_LOAD == 2)
+    // Run every model pushed over UART until the host stops sending
+    while (af_model_recv_xmodem(&model_image, MODEL_RECV_TIMEOUT_MS) == 0) {
+        if (bind_model(model_image.data, model_image.size) != 0) {
+            xprintf("Skipping received model\n");
+            continue;
+        }
+        run_testbench(&model_image, max_index);
     }
+#endif
 
-    // 5. Update index (use the actually loaded index)
-    current_index = loaded_index + 1;
-
-    // 6. Has all requested data been processed
-    if (current_index >= max_index){
-        break;
-    }
+	return 0;
 }
 
-xprintf("Test sequence completed. Last processed sample: %lu\n", loaded_index);
-	return 0;
+/*!
+ * @brief Main function
+ */
+int app_main(void) {
+#ifdef AF_TESTBENCH_RTOS
+	return af_rtos_start(testbench_main);
+#else
+	return testbench_main();
+#endif
 }
@@ -17,6 +17,189 @@
  *		in this example, model data is pre-burn to flash address: 0x180000
  * **/
 #define FLASH_XIP_MODEL 0
+
+/** Runtime model loading (one flash image sweeps several models):
+ *	0: only the model selected above is used.
+ *
+ *	1: every model listed in models/sweep.txt on the SD card is loaded in turn
+ *		from models/<name>.tflite (+ optional models/<name>.cfg sidecar).
+ *
+ *	2: models are received one after another over the console UART with xmodem,
+ *		see xmodem/xmodem_model_push.py.
+ * **/
+#define RUNTIME_MODEL_LOAD 0
+#define MODEL_RECV_TIMEOUT_MS	(60*1000)
+
+/** NPU weight prefetch:
+ *	1: when a model is bound, Ethos-U weight regions that the NPU would read
+ *		from flash (FLASH_XIP_MODEL) are copied into an SRAM buffer of
+ *		NPU_PREFETCH_BUDGET bytes and the NPU base address is patched to the copy.
+ *		Regions that do not fit stay in flash. Ticks saved per Invoke() are logged.
+ *	0: no buffer is reserved. The default follows FLASH_XIP_MODEL: a model
+ *		linked into SRAM has nothing to prefetch.
+ * **/
+#define NPU_WEIGHT_PREFETCH FLASH_XIP_MODEL
+#define NPU_PREFETCH_BUDGET	(192*1024)
+#define NPU_PREFETCH_SECTION	".bss.NoInit"
+#define AF_MODEL_XIP_ADDR	(0x3A180000)
+
+/** Inference backend:
+ *	0: Ethos-U55, the vela model selected above.
+ *
+ *	1: Cortex-M55 CMSIS-NN kernels (Helium), the non-vela model given by
+ *		MODEL_CPU_PATH in af_detect_testbench.mk (model_data_cpu[]).
+ *
+ *	2: every linked backend is benchmarked by init_model() over
+ *		AF_BACKEND_BENCH_RUNS Invoke() calls; per-op ticks, end-to-end ticks and
+ *		active CPU/NPU cycles are logged and the fastest backend is kept.
+ *
+ *	3: interpreter-free CMSIS-NN code generated by model_codegen/tflite_codegen.py,
+ *		given by MODEL_COMPILED_PATH in af_detect_testbench.mk (af_compiled_invoke()).
+ *	Without MODEL_CPU_PATH / MODEL_COMPILED_PATH the Ethos-U backend is always used.
+ *
+ *	When both MODEL_CPU_PATH and MODEL_COMPILED_PATH are given, init_model() first
+ *	checks the compiled code against the interpreter on AF_COMPILED_VERIFY_RUNS
+ *	random inputs; the outputs must be bit-exact.
+ * **/
+#define AF_BACKEND_SEL 2
+#define AF_BACKEND_BENCH_RUNS	8
+#define AF_COMPILED_VERIFY_RUNS	64
+
+/** Per sample console lines (X file path, AF score):
+ *	1: printed for every sample.
+ *
+ *	0: off. Each line costs UART time on every sample; keep them off when
+ *		comparing samples/s of the serial loop and of the FreeRTOS pipeline
+ *		(AF_TESTBENCH_RTOS in af_detect_testbench.mk), where the reader and
+ *		infer tasks would also interleave their lines.
+ * **/
+#ifdef AF_TESTBENCH_RTOS
+#define AF_SAMPLE_LOG 0
+#else
+#define AF_SAMPLE_LOG 1
+#endif
+
+/** Deferred per sample lines (af_log.h, library/dlog), bare metal serial loop:
+ *	0: printed by xprintf, the loop waits for the UART on every line.
+ *
+ *	1: the log call stores the format and its arguments in a RAM ring; the
+ *		loop formats them and hands them to the UART DMA once per sample,
+ *		the UART sends while the next sample is read and run. Plain xprintf
+ *		output of the loop goes through the same ring to keep the order.
+ *
+ *	2: as 1, the records are sent unformatted; decode the console capture
+ *		with library/dlog/tools/hx_dlog_decode.py and the flashed ELF.
+ * **/
+#define AF_LOG_DEFERRED 0
+
+/** FreeRTOS pipeline (AF_TESTBENCH_RTOS), see af_rtos_pipeline.h:
+ *	samples in flight between the reader, infer and writer tasks, 1 gives the
+ *	serial loop with the same metrics; samples between two metric reports.
+ * **/
+#define AF_RTOS_PIPELINE_SLOTS	4
+#define AF_RTOS_REPORT_SAMPLES	1024
+
+/** Duty-cycled testbench (bare metal only), see library/lpsched/hx_lpsched.h:
+ *	one sample every AF_DUTY_PERIOD_MS, the chip sleeps in between in WFI or
+ *	PMU power down as the gap allows; 0 streams the samples back to back.
+ *	Needs RUNTIME_MODEL_LOAD 0, a PD wake-up boots into the built-in model.
+ * **/
+#define AF_DUTY_PERIOD_MS	0
+#define AF_DUTY_LATE_MS		50
+#define AF_DUTY_REPORT_RUNS	64
+
+/** Warm boot after a PD_RET wake-up, see af_model_retain():
+ *	1: the interpreter, op resolver and tensor arena stay in .bss.NoInit and
+ *		init_model() restores them when their CRC still matches, instead of
+ *		NPU weight prefetch, backend benchmark and AllocateTensors(). The arena
+ *		is split: AF_ARENA_PERSISTENT_SIZE bytes for the interpreter's
+ *		persistent data, covered by the CRC, the rest for the tensors.
+ *	0: init_model() always starts over. Always 0 with TFLM2209_U55TAG2205,
+ *		whose interpreter takes the whole arena and cannot split it.
+ * **/
+#if (AF_DUTY_PERIOD_MS > 0) && !defined(TFLM2209_U55TAG2205)
+#define AF_WARM_BOOT 1
+#else
+#define AF_WARM_BOOT 0
+#endif
+#define AF_ARENA_PERSISTENT_SIZE	(16*1024)
+
+/** Raw signal input (af_ecg_stream.h), bare metal or FreeRTOS:
+ *	1: the windows come from the WFDB record AF_ECG_RECORD on the SD card
+ *		(AF_ECG_RECORD.hea and the signal file it names, format 16 or 212),
+ *		signal AF_ECG_CHANNEL of it, streamed through the RR-interval front
+ *		end of library/rrfe: the last MODEL_INPUT_TIMESTEPS RR intervals every
+ *		AF_ECG_STRIDE beats. AF_ECG_SIGNAL is HX_RRFE_ECG or HX_RRFE_PPG.
+ *	0: the x_test vectors.
+ *	AF_RR_SCALE is the model input for an RR interval of 1 ms; it must match
+ *	the preprocessing that made the x_test vectors, e.g. 0.001f for seconds.
+ *	The default 1.0f is milliseconds. A warning is logged at the start when
+ *	RR intervals of 300 to 2000 ms do not fit the int8 model input.
+ * **/
+#define AF_ECG_STREAM	0
+#define AF_ECG_RECORD	"ecg/100"
+#define AF_ECG_CHANNEL	0
+#define AF_ECG_SIGNAL	HX_RRFE_ECG
+#define AF_ECG_STRIDE	1
+#define AF_RR_SCALE		1.0f
+
+/** Sliding windows of the raw signal input (AF_ECG_STREAM):
+ *	AF_ECG_INCREMENTAL 1: every beat goes to run_af_model_step(), which only
+ *		quantizes the new RR interval; a compiled model generated with
+ *		af_compiled_invoke_shifted() also keeps its first layer. Needs
+ *		AF_ECG_STRIDE 1.
+ *	2: as 1, and every window also goes through run_af_model(). The outputs
+ *		must match, the cycles per window of both are logged.
+ *	0: run_af_model() re-quantizes and runs every window from scratch.
+ *	AF burden (af_burden.h): the window scores are smoothed with weight
+ *	1/2^AF_BURDEN_EMA_SHIFT; an episode starts at AF_BURDEN_ON_PCT, ends below
+ *	AF_BURDEN_OFF_PCT and counts from AF_BURDEN_MIN_MS up.
+ * **/
+#define AF_ECG_INCREMENTAL	1
+#define AF_BURDEN_EMA_SHIFT	3
+#define AF_BURDEN_ON_PCT	60
+#define AF_BURDEN_OFF_PCT	40
+#define AF_BURDEN_MIN_MS	(30*1000)
+
+/** Motion gating of the raw signal input (AF_ECG_STREAM), library/imuact:
+ *	the ICM42688 FIFO dump AF_ECG_RECORD.imu (16-byte packets at
+ *	AF_IMU_ODR_HZ, AF_IMU_LSB_PER_G, as imu_read reads them) is read in step
+ *	with the signal. A window is in motion when at least AF_IMU_GATE_PCT of
+ *	the 1 s activity epochs over its beats are heavy.
+ *	AF_IMU_GATE 1: every window is still run and saved, the ones in motion
+ *		are logged and counted, with the AF-positive ones among them.
+ *	2: windows in motion are not run; their time is left out of the AF
+ *		burden.
+ *	0: no IMU.
+ * **/
+#define AF_IMU_GATE			0
+#define AF_IMU_GATE_PCT		50
+#define AF_IMU_ODR_HZ		100
+#define AF_IMU_LSB_PER_G	2048
+
+/** Model placement plan (-DMODEL_PLACEMENT_PLAN in af_detect_testbench.mk):
+ *	model_placement.h generated by model_placement/model_placement_planner.py
+ *	overrides the settings above. The model is always read through XIP at the
+ *	planned flash offset; tier SRAM copies the weights into the
+ *	.model_plan_sram section sized by the planner, tier flash leaves them there.
+ * **/
+#ifdef MODEL_PLACEMENT_PLAN
+#include "model_placement.h"
+#undef FLASH_XIP_MODEL
+#undef NPU_WEIGHT_PREFETCH
+#undef NPU_PREFETCH_BUDGET
+#undef NPU_PREFETCH_SECTION
+#undef AF_MODEL_XIP_ADDR
+#define FLASH_XIP_MODEL 1
+#define AF_MODEL_XIP_ADDR	(MODEL_PLAN_AF_XIP_ADDR)
+#if (MODEL_PLAN_AF_TIER == MODEL_TIER_SRAM)
+#define NPU_WEIGHT_PREFETCH 1
+#else
+#define NPU_WEIGHT_PREFETCH 0
+#endif
+#define NPU_PREFETCH_BUDGET	(MODEL_PLAN_SRAM_BYTES)
+#define NPU_PREFETCH_SECTION	".model_plan_sram"
+#endif
 #define MEM_FREE_POS		(BOOT2NDLOADER_BASE) ////0x3401F000
 
 #endif /* APP_SCENARIO_ALLON_SENSOR_TFLM_COMMON_CONFIG_H_ */
@@ -279,7 +279,11 @@
 /      lock control is independent of re-entrancy. */
 
 
+#ifdef AF_TESTBENCH_RTOS
+#define FF_FS_REENTRANT	1	/* reader and writer tasks share the volume */
+#else
 #define FF_FS_REENTRANT	0
+#endif
 #define FF_FS_TIMEOUT	1000
 /* The option FF_FS_REENTRANT switches the re-entrancy (thread safe) of the FatFs
 /  module itself. Note that regardless of this option, file access to different
@@ -12,6 +12,10 @@
 #include <string.h>
 #include <stdlib.h>
 #include "WE2_device.h"
+#include "common_config.h"
+#if AF_LOG_DEFERRED
+#include "hx_dlog.h"
+#endif
 
 #if 0
 /* HardFault handler implementation that prints a message
@@ -26,6 +30,11 @@ void HardFault_Handler(void)
 }
 #endif
 void HardFault_Handler(void) {
+#if AF_LOG_DEFERRED
+	/* The log lines before the fault first, by blocking UART writes */
+	hx_dlog_we2_capture(0);
+	hx_dlog_panic();
+#endif
 	/* Handling SAU related secure faults */
 	printf("\r\nEntering HardFault interrupt!\r\n");
 	if (SAU->SFSR != 0) {
@@ -6,6 +6,10 @@ extern "C" {
 #endif
 
 extern const unsigned char model_data[];
+#ifdef AF_CPU_MODEL
+// Non-vela flatbuffer of the same model, run on CMSIS-NN kernels
+extern const unsigned char model_data_cpu[];
+#endif
 //extern const unsigned char af_detection_vela_tflite[];
 
 #ifdef __cplusplus
@@ -0,0 +1,20 @@
+/* Generated by model_placement/model_placement_planner.py -- do not edit */
+#ifndef MODEL_PLACEMENT_H
+#define MODEL_PLACEMENT_H
+
+#define MODEL_TIER_SRAM  0
+#define MODEL_TIER_PSRAM 1
+#define MODEL_TIER_FLASH 2
+
+/* Bytes of the .model_plan_sram / PSRAM areas holding weight copies */
+#define MODEL_PLAN_SRAM_BYTES  0x4920
+#define MODEL_PLAN_PSRAM_BYTES 0x0
+
+/* af: sram, predicted 61754 cycles (flash 158648) */
+#define MODEL_PLAN_AF_TIER         MODEL_TIER_SRAM
+#define MODEL_PLAN_AF_SIZE         0x4920
+#define MODEL_PLAN_AF_ARENA_SIZE   0x1400
+#define MODEL_PLAN_AF_FLASH_OFFSET 0x180000
+#define MODEL_PLAN_AF_XIP_ADDR     0x3A180000
+
+#endif /* MODEL_PLACEMENT_H */
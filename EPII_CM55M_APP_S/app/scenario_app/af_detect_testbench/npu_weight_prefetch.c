@@ -0,0 +1,110 @@
+#include "npu_weight_prefetch.h"
+#include <string.h>
+#include "WE2_device.h"
+#include "WE2_device_addr.h"
+#include "ethosu_driver.h"
+#include "common_config.h"
+
+/* Vela assigns the TFLM model (weights + biases) to base address 0,
+ * see tensorflow/lite/micro/kernels/ethos_u/ethosu.cc */
+#define NPU_WEIGHT_BASE_ADDR_INDEX 0
+
+#define FLASH_XIP_SIZE (0x01000000)
+#define IS_FLASH_ADDR(addr) ((addr) >= BASE_ADDR_FLASH1_R_ALIAS && (addr) < BASE_ADDR_FLASH1_R_ALIAS + FLASH_XIP_SIZE)
+
+typedef struct {
+    uint32_t src;  // Flash address the command stream was compiled against
+    uint32_t dst;  // SRAM copy, 0 if the region did not fit the budget
+    uint32_t size;
+} npu_prefetch_region_t;
+
+#if (NPU_WEIGHT_PREFETCH == 1)
+__attribute__(( section(NPU_PREFETCH_SECTION))) static uint8_t prefetch_buf[NPU_PREFETCH_BUDGET] __ALIGNED(32);
+#endif
+
+static npu_prefetch_region_t regions[NPU_PREFETCH_MAX_REGIONS];
+static uint32_t region_count = 0;
+static uint32_t prefetch_used = 0;
+static uint32_t prefetch_skipped = 0;
+static bool prefetch_enabled = false;
+
+void npu_prefetch_reset(void)
+{
+    region_count = 0;
+    prefetch_used = 0;
+    prefetch_skipped = 0;
+    prefetch_enabled = false;
+}
+
+void npu_prefetch_enable(bool enable)
+{
+    prefetch_enabled = enable;
+}
+
+uint32_t npu_prefetch_bytes(void)
+{
+    return prefetch_used;
+}
+
+uint32_t npu_prefetch_skipped_bytes(void)
+{
+    return prefetch_skipped;
+}
+
+#if (NPU_WEIGHT_PREFETCH == 1)
+static const npu_prefetch_region_t *lookup_region(uint32_t src, uint32_t size)
+{
+    for (uint32_t i = 0; i < region_count; i++) {
+        if (regions[i].src == src) {
+            return &regions[i];
+        }
+    }
+    if (region_count == NPU_PREFETCH_MAX_REGIONS) {
+        return NULL;
+    }
+
+    npu_prefetch_region_t *region = &regions[region_count++];
+    uint32_t aligned_size = (size + 31) & ~31U;
+    region->src = src;
+    region->size = size;
+    region->dst = 0;
+    if (prefetch_used + aligned_size <= NPU_PREFETCH_BUDGET) {
+        region->dst = (uint32_t)&prefetch_buf[prefetch_used];
+        memcpy((void *)region->dst, (const void *)src, size);
+        /* The NPU bypasses the D-cache, make the copy visible to it */
+        SCB_CleanDCache_by_Addr((void *)region->dst, (int32_t)aligned_size);
+        prefetch_used += aligned_size;
+    } else {
+        prefetch_skipped += size;
+    }
+    return region;
+}
+
+/**
+ * @brief Ethos-U driver callback, runs right before the command stream is started.
+ *
+ * Overrides the weak default in ethosu_driver.c. The base address table
+ * still points at the TFLM scratch buffer here, so redirecting the weight
+ * region only affects the job that is about to run.
+ */
+void ethosu_inference_begin(struct ethosu_driver *drv, void *user_arg)
+{
+    (void)user_arg;
+
+    if (!prefetch_enabled || drv->job.num_base_addr <= NPU_WEIGHT_BASE_ADDR_INDEX) {
+        return;
+    }
+
+    uint64_t *base_addr = (uint64_t *)drv->job.base_addr;
+    uint32_t src = (uint32_t)base_addr[NPU_WEIGHT_BASE_ADDR_INDEX];
+    if (!IS_FLASH_ADDR(src)) {
+        return;
+    }
+
+    const npu_prefetch_region_t *region =
+        lookup_region(src, (uint32_t)drv->job.base_addr_size[NPU_WEIGHT_BASE_ADDR_INDEX]);
+    if (region != NULL && region->dst != 0) {
+        base_addr[NPU_WEIGHT_BASE_ADDR_INDEX] = region->dst;
+    }
+}
+#endif
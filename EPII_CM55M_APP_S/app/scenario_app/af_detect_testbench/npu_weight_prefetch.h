@@ -0,0 +1,45 @@
+#ifndef NPU_WEIGHT_PREFETCH_H
+#define NPU_WEIGHT_PREFETCH_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Max number of Ethos-U weight regions (one per vela custom op) kept in SRAM
+#define NPU_PREFETCH_MAX_REGIONS 8
+
+/**
+ * @brief Forgets the regions of the previous model and disables patching.
+ *
+ * Must be called whenever a new model is bound, since the SRAM budget
+ * (NPU_PREFETCH_BUDGET) is handed out again from the start.
+ */
+void npu_prefetch_reset(void);
+
+/**
+ * @brief Enables or disables redirection of flash weight regions to SRAM.
+ *
+ * While enabled, the first NPU job that reads a weight region from flash
+ * copies it into SRAM if it fits the remaining budget. That job and every
+ * later one then has its base address patched to the SRAM copy.
+ */
+void npu_prefetch_enable(bool enable);
+
+/**
+ * @brief Returns the number of weight bytes currently served from SRAM.
+ */
+uint32_t npu_prefetch_bytes(void);
+
+/**
+ * @brief Returns the number of flash weight bytes that did not fit the budget.
+ */
+uint32_t npu_prefetch_skipped_bytes(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // NPU_WEIGHT_PREFETCH_H
@@ -1,4 +1,6 @@
 #include "sd_card_testbench.h"
+#include "common_config.h"
+#include "af_log.h"
 #include <math.h> // Corrected: Using C math header for roundf()
 #include <string.h> // Required for strcpy
 
@@ -165,7 +167,9 @@ FRESULT load_next_test_vector(uint32_t start_index, test_sample_t *sample_data,
                  g_y_test_folder, dir1, dir2, current_index);
 
         //xprintf("Attempting to load sample %lu:\r\n", current_index);
-        xprintf("  X file: %s\r\n", x_filepath);
+#if AF_SAMPLE_LOG
+        af_log("  X file: %s\r\n", x_filepath);
+#endif
         //xprintf("  Y file: %s\r\n", y_filepath);
 
         // Try to read both X and Y files
@@ -219,10 +223,10 @@ FRESULT save_result_vector(uint32_t index, int8_t *model_output, uint32_t output
     xsprintf(result_path, "%s/%02x/%02x/%s%06lu.bin",
              g_x_test_folder, dir1, dir2, file_prefix, index);
 
-    xprintf("Saving model output for sample %lu:\r\n", index);
-    xprintf("  Path: %s\r\n", result_path);
-    xprintf("  Output length: %lu elements\r\n", output_length);
-    xprintf("  First result value: raw=%d\r\n", model_output[0]);
+    af_log("Saving model output for sample %lu:\r\n", index);
+    af_log("  Path: %s\r\n", result_path);
+    af_log("  Output length: %lu elements\r\n", output_length);
+    af_log("  First result value: raw=%d\r\n", model_output[0]);
 
     // Ensure directory exists
     char dir_path[MAX_PATH_LEN];
@@ -251,7 +255,7 @@ FRESULT save_result_vector(uint32_t index, int8_t *model_output, uint32_t output
     }
 
     f_close(&file);
-    xprintf("  Successfully saved %d bytes of model output\r\n", bytes_written);
+    af_log("  Successfully saved %d bytes of model output\r\n", bytes_written);
     return FR_OK;
 }
 
@@ -289,7 +293,7 @@ FRESULT save_result_vector_bulk(uint32_t index, int8_t *model_output, uint32_t o
         xsprintf(result_path, "%s/%02x/%02x/%s.bin",
                  g_x_test_folder, dir1, dir2, file_prefix);
 
-        xprintf("Writing %d collected results to %s\r\n", BULK_RESULT_COUNT, result_path);
+        af_log("Writing %d collected results to %s\r\n", BULK_RESULT_COUNT, result_path);
 
         // Ensure the directory exists
         char dir_path[MAX_PATH_LEN];
@@ -317,7 +321,7 @@ FRESULT save_result_vector_bulk(uint32_t index, int8_t *model_output, uint32_t o
         }
 
         f_close(&file);
-        xprintf("  Successfully saved %d bytes in bulk.\r\n", bytes_written);
+        af_log("  Successfully saved %d bytes in bulk.\r\n", bytes_written);
 
         // Reset the counter for the next batch
         bulk_results_count = 0;
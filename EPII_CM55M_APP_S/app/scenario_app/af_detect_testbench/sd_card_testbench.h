@@ -26,7 +26,7 @@ extern "C" {
 #endif
 
 // Define max path length for file names
-#define MAX_PATH_LEN 64
+#define MAX_PATH_LEN 96
 // Define buffer size for a single X test vector (float32)
 #define X_TEST_VECTOR_SIZE (MODEL_INPUT_TIMESTEPS * MODEL_INPUT_FEATURES * sizeof(float))
 // Define buffer size for a single Y test vector (float32) - assuming a single float output label
@@ -182,6 +182,10 @@ static void dp_app_cv_eventhdl_cb(EVT_INDEX_E event)
 		g_cur_jpegenc_frame++;
     	g_frame_ready = 1;
 		dbg_printf(DBG_LESS_INFO, "SENSORDPLIB_STATUS_XDMA_FRAME_READY %d \n", g_cur_jpegenc_frame);
+#if (EVT_REPORT_FRAMES > 0)
+		if ( g_cur_jpegenc_frame % EVT_REPORT_FRAMES == 0 )
+			event_handler_report();
+#endif
 		break;
 
 	case EVT_INDEX_SENSOR_RTC_FIRE:
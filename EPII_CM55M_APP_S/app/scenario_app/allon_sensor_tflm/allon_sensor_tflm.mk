@@ -15,7 +15,16 @@ EVENTHANDLER_SUPPORT_LIST += evt_datapath
 # Add new library here
 # The source code should be loacted in ~\library\{lib_name}\
 ##
-LIB_SEL = pwrmgmt sensordp tflmtag2209_u55tag2205 spi_ptl spi_eeprom hxevent
+LIB_SEL = pwrmgmt sensordp tflmtag2209_u55tag2205 spi_ptl spi_eeprom
+
+# y runs the events of event_handler on library/evloop instead of the
+# prebuilt hxevent, with per event statistics (EVT_REPORT_FRAMES)
+ALLON_EVLOOP ?= n
+ifeq ($(strip $(ALLON_EVLOOP)), y)
+LIB_SEL += evloop
+else
+LIB_SEL += hxevent
+endif
 
 ##
 # middleware support feature
@@ -17,6 +17,12 @@
  *		in this example, model data is pre-burn to flash address: 0x180000
  * **/
 #define FLASH_XIP_MODEL 0
+
+/** Event statistics (ALLON_EVLOOP=y in allon_sensor_tflm.mk):
+ *	posts, latency and run time of every event are printed every
+ *	EVT_REPORT_FRAMES frames, see event_handler_report(); 0 for never.
+ * **/
+#define EVT_REPORT_FRAMES	100
 #define MEM_FREE_POS		(BOOT2NDLOADER_BASE) ////0x3401F000
 
 #endif /* APP_SCENARIO_ALLON_SENSOR_TFLM_COMMON_CONFIG_H_ */
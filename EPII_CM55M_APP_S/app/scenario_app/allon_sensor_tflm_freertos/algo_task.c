@@ -72,6 +72,7 @@
 #include "cisdp_sensor.h"
 #include "cisdp_cfg.h"
 #include "spi_master_protocol.h"
+#include "app_buf_pool.h"
 #ifdef IP_timer
 #include "timer_interface.h"
 #endif
@@ -79,27 +80,22 @@
 extern QueueHandle_t     xMainTaskQueue;
 extern QueueHandle_t     xAlgoTaskQueue;
 extern volatile APP_ALGO_TASK_STATE_E g_algotask_state;
-static uint32_t g_save_jpg_cnt = 0;
 
-#define SPI_SEN_PIC_CLK				(10000000)
-#define WE2_CHIP_VERSION_C		    0x8538000c
+/* model output of a frame, one per APP_BUF_POOL_RESULT slot */
+static int8_t g_algo_result[APP_BUF_RESULT_SLOTS][CV_SCORE_NUM];
 
 void algo_task(void *pvParameters)
 {
     APP_MSG_T algo_recv_msg;
     APP_MSG_T main_send_msg;
 	uint32_t chipid, version;
-	char filename[20];
+	uint32_t result;
+	app_buf_t *frame_buf, *result_buf;
 
-#if ( SUPPORT_FATFS == 1 )
-	fatfs_init();
-#else
-    if ( hx_drv_spi_mst_open_speed(SPI_SEN_PIC_CLK) != 0 )
+    for (uint32_t i = 0; i < APP_BUF_RESULT_SLOTS; i++)
     {
-        xprintf("SPI master init fail\r\n");
-        return;
+        app_buf_pool_add(APP_BUF_POOL_RESULT, (uint32_t)g_algo_result[i], CV_SCORE_NUM, 0);
     }
-#endif
 
     g_algotask_state = APP_ALGO_TASK_STATE_INIT;
 
@@ -122,22 +118,15 @@ void algo_task(void *pvParameters)
                 }
                 #endif
 
-				#if 1    // send JPG image
-                uint32_t jpeg_addr, jpeg_sz;
-                int32_t read_status;
-                cisdp_get_jpginfo(&jpeg_sz, &jpeg_addr);
-                #if ( SUPPORT_FATFS == 1 )
-                xsprintf(filename, "image%04d.jpg", g_save_jpg_cnt++);
-		        dbg_printf(DBG_LESS_INFO, "write frame to %s, data size=%d,addr=0x%x\n", filename, jpeg_sz, jpeg_addr);
-		        read_status = fastfs_write_image(jpeg_addr, jpeg_sz, filename);
-                #else
-				read_status = hx_drv_spi_mst_protocol_write_sp(jpeg_addr, jpeg_sz, DATA_TYPE_JPG);
-				//xprintf("write frame result %d, data size=%d,addr=0x%x\r\n", read_status, jpeg_sz, jpeg_addr);
-                #endif  // end SUPPORT_FATFS
-				#else   // send BGR image
+                /* the frame slot is owned through the token of the message, the
+                 * JPEG of the same frame is sent by comm_task meanwhile */
+                frame_buf = app_buf_get(algo_recv_msg.msg_data);
+                result = app_buf_acquire(APP_BUF_POOL_RESULT);
+                result_buf = app_buf_get(result);
+                if (frame_buf != NULL)
+                {
+				#if 0   // send the YUV frame as well
 				SPI_CMD_DATA_TYPE image_type;
-				uint32_t wdam3_addr = app_get_raw_addr();
-				uint32_t data_size = app_get_raw_sz();
 				uint8_t imagesize_header[4];
                 int32_t read_status;
 				image_type = DATA_TYPE_RAW_HEADER_IMG_YUV420_8U3C;
@@ -145,11 +134,21 @@ void algo_task(void *pvParameters)
 				imagesize_header[1] = (app_get_raw_width()>>8) & 0xFF;
 				imagesize_header[2] = app_get_raw_height() & 0xFF;
 				imagesize_header[3] = (app_get_raw_height()>>8) & 0xFF;
-				read_status =  hx_drv_spi_mst_protocol_write_ex(wdam3_addr, data_size, image_type, imagesize_header, 4);
-				xprintf("addr=0x%x, YUV write frame result %d, data size %d\n", wdam3_addr, read_status, data_size);
+				read_status =  hx_drv_spi_mst_protocol_write_ex(frame_buf->addr, frame_buf->len, image_type, imagesize_header, 4);
+				xprintf("addr=0x%x, YUV write frame result %d, data size %d\n", frame_buf->addr, read_status, frame_buf->len);
 				#endif
 
-				cv_run();
+                    cv_run(frame_buf->addr, result_buf != NULL ? (int8_t *)result_buf->addr : NULL);
+                    if (result_buf != NULL)
+                    {
+                        result_buf->len = CV_SCORE_NUM;
+                        result_buf->seq = frame_buf->seq;
+                    }
+                }
+                else
+                {
+                    dbg_printf(DBG_LESS_INFO, "no frame slot 0x%x\r\n", algo_recv_msg.msg_data);
+                }
 
                 #ifdef CIS_IMX
                 hx_drv_scu_get_version(&chipid, &version);
@@ -159,12 +158,14 @@ void algo_task(void *pvParameters)
                     cisdp_stream_on();
                 }
                 #endif
+                app_buf_unref(algo_recv_msg.msg_data);
 
-                main_send_msg.msg_data = 0;
+                main_send_msg.msg_data = result;
                 main_send_msg.msg_event = APP_MSG_MAINEVENT_VISIONALGO_STARTDONE;
     	   		if(xQueueSend( xMainTaskQueue , (void *) &main_send_msg , __QueueSendTicksToWait) != pdTRUE)
                 {
                     dbg_printf(DBG_LESS_INFO, "send main_send_msg=0x%x fail\r\n", main_send_msg.msg_event);
+                    app_buf_unref(result);
                 }
                 break;
             case APP_MSG_VISIONALGOEVENT_STOP_ALGO:
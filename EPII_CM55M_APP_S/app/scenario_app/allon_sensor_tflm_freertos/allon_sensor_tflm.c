@@ -60,6 +60,7 @@
 #include "cvapp.h"
 #include "sleep_mode.h"
 #include "pinmux_cfg.h"
+#include "app_buf_pool.h"
 
 #define CIS_XSHUT_SGPIO0
 #ifdef CIS_XSHUT_SGPIO0
@@ -225,6 +226,8 @@ void main_task(void *pvParameters)
 	APP_MSG_T main_recv_msg;
 	APP_MSG_T algo_send_msg;
 	APP_MSG_T dp_send_msg;
+	APP_MSG_T comm_send_msg;
+	app_buf_t *result_buf;
     uint8_t main_motion_detect = 0;
     uint8_t main_waitstart_cap = 0;
     uint8_t gpioValue;
@@ -279,11 +282,20 @@ void main_task(void *pvParameters)
     	   	switch(main_recv_msg.msg_event)
     	   	{
     	   	case APP_MSG_MAINEVENT_CAP_FRAME_DONE:
-    	   		algo_send_msg.msg_data = 0;
+    	   		/* the frame slot goes to algo_task, the JPEG slot of the same frame to comm_task */
+    	   		algo_send_msg.msg_data = APP_BUF_TOKEN_LO(main_recv_msg.msg_data);
     	   		algo_send_msg.msg_event = APP_MSG_VISIONALGOEVENT_START_ALGO;
     	   		if(xQueueSend( xAlgoTaskQueue , (void *) &algo_send_msg , __QueueSendTicksToWait) != pdTRUE)
     	   		{
     	    	   	dbg_printf(DBG_LESS_INFO, "send algo_send_msg=0x%x fail\r\n", algo_send_msg.msg_event);
+    	    	   	app_buf_unref(algo_send_msg.msg_data);
+    	   		}
+    	   		comm_send_msg.msg_data = APP_BUF_TOKEN_HI(main_recv_msg.msg_data);
+    	   		comm_send_msg.msg_event = APP_MSG_COMMEVENT_SPISEND_PIC;
+    	   		if(xQueueSend( xCommTaskQueue , (void *) &comm_send_msg , __QueueSendTicksToWait) != pdTRUE)
+    	   		{
+    	    	   	dbg_printf(DBG_LESS_INFO, "send comm_send_msg=0x%x fail\r\n", comm_send_msg.msg_event);
+    	    	   	app_buf_unref(comm_send_msg.msg_data);
     	   		}
     	   		break;
     	   	case APP_MSG_MAINEVENT_SENSOR_TIMER:
@@ -398,10 +410,22 @@ void main_task(void *pvParameters)
     	   		g_algotask_state = APP_ALGO_TASK_STATE_DOALGO_DONE;
 				g_algo_done_frame++;
 				dbg_printf(DBG_LESS_INFO, "g_algo_done_frame = %d\n", g_algo_done_frame);
+				result_buf = app_buf_get(main_recv_msg.msg_data);
+				if ( result_buf != NULL )
+				{
+					dbg_printf(DBG_LESS_INFO, "frame %d person_score %d\n", result_buf->seq,
+							((int8_t *)result_buf->addr)[CV_SCORE_PERSON]);
+				}
+				app_buf_unref(main_recv_msg.msg_data);
 				#if ( ENTER_SLEEP_MODE == 1 )
 				if ( g_algo_done_frame == g_enter_pmu_frame_cnt )
 				{
 					app_start_state(APP_STATE_STOP);
+					/* comm_task still owns the JPEGs in flight */
+					while ( app_buf_pool_in_use(APP_BUF_POOL_JPEG) != 0 )
+					{
+						vTaskDelay(pdMS_TO_TICKS(1));
+					}
 					dbg_printf(DBG_LESS_INFO, "\nEnter Sleep 1000ms\n");
 					app_pmu_enter_sleep(1000, 0xFF, 0);	// 1 second or AON_GPIO0 wake up, memory no retention
 				}
@@ -451,6 +475,15 @@ void main_task(void *pvParameters)
     	   	case APP_MSG_MAINEVENT_CM55SRDY_NOTIFY:
     	   		dbg_printf(DBG_LESS_INFO, "APP_MSG_MAINEVENT_CM55SRDY_NOTIFY\n");
     	   		break;
+    	   	case APP_MSG_MAINEVENT_SPISEND_PIC_DONE:
+    	   		/* a JPEG slot is free again, the capture may be waiting for it */
+    	   		dp_send_msg.msg_data = 0;
+    	   		dp_send_msg.msg_event = APP_MSG_DPEVENT_RECAPTURE;
+    	   		if(xQueueSend( xDPTaskQueue , (void *) &dp_send_msg , __QueueSendTicksToWait) != pdTRUE)
+    	   		{
+    	    	   	dbg_printf(DBG_LESS_INFO, "send dp_send_msg=0x%x fail\r\n", dp_send_msg.msg_event);
+    	   		}
+    	   		break;
     	   	default:
     	   		break;
     	   	}
@@ -0,0 +1,175 @@
+/*
+ * app_buf_pool.c
+ *
+ * See app_buf_pool.h. The slots and counters are only touched inside
+ * taskENTER_CRITICAL(), which on this port masks the interrupts up to
+ * configMAX_SYSCALL_INTERRUPT_PRIORITY for a few instructions.
+ */
+#include <stdint.h>
+#include <stddef.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "app_buf_pool.h"
+
+#define APP_BUF_TOKEN(gen, pool, idx)	(((uint32_t)(gen) << 8) | ((uint32_t)(pool) << 4) | (uint32_t)(idx))
+#define APP_BUF_TOKEN_POOL(token)		(((token) >> 4) & 0xF)
+#define APP_BUF_TOKEN_IDX(token)		((token) & 0xF)
+
+static app_buf_t g_buf[APP_BUF_POOL_NUM][APP_BUF_POOL_MAX_SLOTS];
+static uint32_t g_buf_cnt[APP_BUF_POOL_NUM];
+static uint32_t g_buf_exhausted[APP_BUF_POOL_NUM];
+
+/* Slot of a token, NULL if it does not name a registered slot.
+ * The caller checks buf->token == token inside its critical section. */
+static app_buf_t *app_buf_lookup(uint32_t token)
+{
+	uint32_t pool = APP_BUF_TOKEN_POOL(token);
+	uint32_t idx = APP_BUF_TOKEN_IDX(token);
+
+	if(token == APP_BUF_TOKEN_NONE || token > 0xFFFF)
+		return NULL;
+	if(pool >= APP_BUF_POOL_NUM || idx >= g_buf_cnt[pool])
+		return NULL;
+	return &g_buf[pool][idx];
+}
+
+int app_buf_pool_add(APP_BUF_POOL_E pool, uintptr_t addr, uint32_t size, uintptr_t aux_addr)
+{
+	app_buf_t *buf;
+	int idx = -1;
+
+	if(pool >= APP_BUF_POOL_NUM)
+		return -1;
+
+	taskENTER_CRITICAL();
+	if(g_buf_cnt[pool] < APP_BUF_POOL_MAX_SLOTS)
+	{
+		idx = g_buf_cnt[pool];
+		buf = &g_buf[pool][idx];
+		buf->addr = addr;
+		buf->size = size;
+		buf->aux_addr = aux_addr;
+		buf->len = 0;
+		buf->seq = 0;
+		buf->token = APP_BUF_TOKEN_NONE;
+		buf->ref = 0;
+		buf->gen = 0;
+		g_buf_cnt[pool]++;
+	}
+	taskEXIT_CRITICAL();
+
+	return idx;
+}
+
+uint32_t app_buf_acquire(APP_BUF_POOL_E pool)
+{
+	uint32_t token = APP_BUF_TOKEN_NONE;
+
+	if(pool >= APP_BUF_POOL_NUM)
+		return APP_BUF_TOKEN_NONE;
+
+	taskENTER_CRITICAL();
+	for(uint32_t i = 0; i < g_buf_cnt[pool]; i++)
+	{
+		app_buf_t *buf = &g_buf[pool][i];
+
+		if(buf->ref != 0)
+			continue;
+		/* generation 0 is skipped so that no token is APP_BUF_TOKEN_NONE */
+		if(++buf->gen == 0)
+			buf->gen = 1;
+		buf->ref = 1;
+		buf->len = 0;
+		buf->token = APP_BUF_TOKEN(buf->gen, pool, i);
+		token = buf->token;
+		break;
+	}
+	if(token == APP_BUF_TOKEN_NONE)
+		g_buf_exhausted[pool]++;
+	taskEXIT_CRITICAL();
+
+	return token;
+}
+
+app_buf_t *app_buf_get(uint32_t token)
+{
+	app_buf_t *buf = app_buf_lookup(token);
+
+	if(buf == NULL)
+		return NULL;
+
+	taskENTER_CRITICAL();
+	if(buf->token != token || buf->ref == 0)
+		buf = NULL;
+	taskEXIT_CRITICAL();
+
+	return buf;
+}
+
+int app_buf_ref(uint32_t token)
+{
+	app_buf_t *buf = app_buf_lookup(token);
+	int ret = -1;
+
+	if(buf == NULL)
+		return -1;
+
+	taskENTER_CRITICAL();
+	if(buf->token == token && buf->ref != 0 && buf->ref != UINT8_MAX)
+	{
+		buf->ref++;
+		ret = 0;
+	}
+	taskEXIT_CRITICAL();
+
+	return ret;
+}
+
+int app_buf_unref(uint32_t token)
+{
+	app_buf_t *buf;
+	int ret = -1;
+
+	if(token == APP_BUF_TOKEN_NONE)
+		return 0;
+	buf = app_buf_lookup(token);
+	if(buf == NULL)
+		return -1;
+
+	taskENTER_CRITICAL();
+	if(buf->token == token && buf->ref != 0)
+	{
+		ret = --buf->ref;
+		if(ret == 0)
+			buf->token = APP_BUF_TOKEN_NONE;
+	}
+	taskEXIT_CRITICAL();
+
+	return ret;
+}
+
+uint32_t app_buf_pool_in_use(APP_BUF_POOL_E pool)
+{
+	uint32_t n = 0;
+
+	if(pool >= APP_BUF_POOL_NUM)
+		return 0;
+
+	taskENTER_CRITICAL();
+	for(uint32_t i = 0; i < g_buf_cnt[pool]; i++)
+	{
+		if(g_buf[pool][i].ref != 0)
+			n++;
+	}
+	taskEXIT_CRITICAL();
+
+	return n;
+}
+
+uint32_t app_buf_pool_exhausted(APP_BUF_POOL_E pool)
+{
+	if(pool >= APP_BUF_POOL_NUM)
+		return 0;
+	return g_buf_exhausted[pool];
+}
@@ -0,0 +1,104 @@
+/*
+ * app_buf_pool.h
+ *
+ * Fixed pools of frame, JPEG and result slots shared by the tasks of the
+ * app. A slot is owned through a token: app_buf_acquire() returns a token
+ * holding one reference, the token travels in APP_MSG_T.msg_data, every
+ * holder drops its reference with app_buf_unref() and the slot is free
+ * again when the count reaches 0. A task that keeps using a slot after
+ * forwarding its token takes another reference first with app_buf_ref().
+ *
+ * The slot memory is registered once with app_buf_pool_add(); the pool only
+ * tracks ownership, the data is never copied.
+ *
+ * Tokens are (generation << 8) | (pool << 4) | index, so a token is never 0
+ * (APP_BUF_TOKEN_NONE) and a token kept after its slot was freed and
+ * acquired again is refused instead of aliasing the new owner's data. Two
+ * tokens fit in one msg_data, see APP_BUF_TOKEN_PAIR().
+ *
+ * All calls are for task context: they take a FreeRTOS critical section.
+ */
+
+#ifndef APP_SCENARIO_ALLON_SENSOR_TFLM_APP_BUF_POOL_H_
+#define APP_SCENARIO_ALLON_SENSOR_TFLM_APP_BUF_POOL_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define APP_BUF_POOL_MAX_SLOTS		8
+
+#define APP_BUF_TOKEN_NONE			0
+
+/* two 16 bit tokens in one msg_data */
+#define APP_BUF_TOKEN_PAIR(lo, hi)	((uint32_t)(lo) | ((uint32_t)(hi) << 16))
+#define APP_BUF_TOKEN_LO(pair)		((uint32_t)(pair) & 0xFFFF)
+#define APP_BUF_TOKEN_HI(pair)		((uint32_t)(pair) >> 16)
+
+typedef enum {
+	APP_BUF_POOL_FRAME = 0,		/* WDMA3 raw frame, read by cv_run() */
+	APP_BUF_POOL_JPEG,			/* WDMA2 JPEG, sent by comm_task */
+	APP_BUF_POOL_RESULT,		/* model output of one frame */
+	APP_BUF_POOL_NUM,
+} APP_BUF_POOL_E;
+
+typedef struct {
+	uintptr_t addr;
+	uint32_t size;				/* capacity in bytes */
+	uintptr_t aux_addr;			/* JPEG: size autofill word of the encoder */
+	uint32_t len;				/* valid bytes, set by the producer */
+	uint32_t seq;				/* frame number, set by the producer */
+	uint32_t token;				/* APP_BUF_TOKEN_NONE while free */
+	uint8_t ref;
+	uint8_t gen;
+} app_buf_t;
+
+/**
+ * \brief	Registers one slot of a pool. Call at init, before the slot
+ * 			can be acquired.
+ * \retval	index of the slot in the pool, -1 if the pool is full
+ */
+int app_buf_pool_add(APP_BUF_POOL_E pool, uintptr_t addr, uint32_t size, uintptr_t aux_addr);
+
+/**
+ * \brief	Takes a free slot of a pool with one reference.
+ * \retval	token of the slot, APP_BUF_TOKEN_NONE if all slots are in use
+ */
+uint32_t app_buf_acquire(APP_BUF_POOL_E pool);
+
+/**
+ * \brief	Slot of a token the caller holds a reference on.
+ * \retval	NULL if the token is APP_BUF_TOKEN_NONE or stale
+ */
+app_buf_t *app_buf_get(uint32_t token);
+
+/**
+ * \brief	Adds a reference, before the token is handed to one more task.
+ * \retval	0 on success, -1 if the token is stale
+ */
+int app_buf_ref(uint32_t token);
+
+/**
+ * \brief	Drops a reference; the slot is free once none is left.
+ * 			APP_BUF_TOKEN_NONE is ignored.
+ * \retval	references left, -1 if the token is stale
+ */
+int app_buf_unref(uint32_t token);
+
+/**
+ * \brief	Number of slots of a pool that are not free.
+ */
+uint32_t app_buf_pool_in_use(APP_BUF_POOL_E pool);
+
+/**
+ * \brief	Number of app_buf_acquire() calls of a pool that found no free slot.
+ */
+uint32_t app_buf_pool_exhausted(APP_BUF_POOL_E pool);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* APP_SCENARIO_ALLON_SENSOR_TFLM_APP_BUF_POOL_H_ */
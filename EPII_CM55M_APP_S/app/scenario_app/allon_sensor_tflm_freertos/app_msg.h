@@ -101,6 +101,7 @@ typedef enum
 	APP_MSG_DPEVENT_STOPCAPTURE				=0x0149,	/*!< DP Stop Capture */
 	APP_MSG_DPEVENT_RECAPTURE				=0x0150,	/*!< DP Re-Capture */
 	APP_MSG_DPEVENT_1BITPARSER_ERR          =0x0151,	/*!< inp1bitparser error */
+	APP_MSG_DPEVENT_ISR_RING                =0x0152,	/*!< DP callback events waiting in the ISR ring */
 	//Main Control
 	APP_MSG_MAINEVENT_CAP_FRAME_DONE			=0x0200,
 	APP_MSG_MAINEVENT_SENSOR_TIMER				=0x0201,
@@ -121,6 +122,7 @@ typedef enum
 	APP_MSG_MAINEVENT_VADBUF1_NOTIFY			=0x0210,
 	APP_MSG_MAINEVENT_VADBUF2_NOTIFY			=0x0211,
 	APP_MSG_MAINEVENT_CM55SRDY_NOTIFY			=0x0212,
+	APP_MSG_MAINEVENT_SPISEND_PIC_DONE			=0x0213,
 	//COMM Control
 	APP_MSG_COMMEVENT_AON_GPIO0_INT				=0x0300,
 	APP_MSG_COMMEVENT_AON_GPIO1_INT				=0x0301,
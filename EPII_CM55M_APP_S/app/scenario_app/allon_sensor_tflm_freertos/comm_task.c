@@ -60,6 +60,10 @@
 #include "comm_task.h"
 #include "algo_task.h"
 #include "allon_sensor_tflm.h"
+#include "common_config.h"
+#include "spi_master_protocol.h"
+#include "spi_fatfs.h"
+#include "app_buf_pool.h"
 
 #define DBG_EVT_IICS_CMD_LOG             (1)
 #define DBG_EVT_IICS_CALLBACK_LOG        (0)
@@ -85,6 +89,7 @@
 #define DATA_SFT_OFFSET_24          24
 
 #define EVT_I2CS_0_SLV_ADDR         0x62
+#define SPI_SEN_PIC_CLK				(10000000)
 //#define EVT_I2CS_1_SLV_ADDR         0x64
 unsigned char gWrite_buf[1][I2CCOMM_MAX_WBUF_SIZE];
 unsigned char gRead_buf[1][I2CCOMM_MAX_RBUF_SIZE];
@@ -92,6 +97,9 @@ unsigned char gRead_buf[1][I2CCOMM_MAX_RBUF_SIZE];
 extern QueueHandle_t     xMainTaskQueue;
 extern QueueHandle_t     xCommTaskQueue;
 extern volatile APP_COMM_TASK_STATE_E g_commtask_state;
+#if ( SUPPORT_FATFS == 1 )
+static uint32_t g_save_jpg_cnt = 0;
+#endif
 
 void app_i2ccomm_init();
 void aon_gpio0_cb(uint8_t group, uint8_t aIndex);
@@ -423,10 +431,37 @@ void aon_gpio1_interupt_init()
 /*!
  * @brief Task responsible for task communication
  */
+/* Sends the JPEG of a slot, the caller owns a reference */
+static void comm_send_jpeg(app_buf_t *jpeg_buf)
+{
+    int32_t read_status;
+#if ( SUPPORT_FATFS == 1 )
+	char filename[20];
+
+    xsprintf(filename, "image%04d.jpg", g_save_jpg_cnt++);
+    dbg_printf(DBG_LESS_INFO, "write frame to %s, data size=%d,addr=0x%x\n", filename, jpeg_buf->len, jpeg_buf->addr);
+    read_status = fastfs_write_image(jpeg_buf->addr, jpeg_buf->len, (uint8_t *)filename);
+#else
+    read_status = hx_drv_spi_mst_protocol_write_sp(jpeg_buf->addr, jpeg_buf->len, DATA_TYPE_JPG);
+#endif
+    dbg_printf(DBG_LESS_INFO, "write frame %d result %d, data size=%d,addr=0x%x\r\n", jpeg_buf->seq, read_status,
+            jpeg_buf->len, jpeg_buf->addr);
+}
+
 void comm_task(void *pvParameters)
 {
     APP_MSG_T comm_recv_msg;
     APP_MSG_T main_send_msg;
+    app_buf_t *jpeg_buf;
+
+#if ( SUPPORT_FATFS == 1 )
+	fatfs_init();
+#else
+    if ( hx_drv_spi_mst_open_speed(SPI_SEN_PIC_CLK) != 0 )
+    {
+        xprintf("SPI master init fail\r\n");
+    }
+#endif
 
     //init GPIO 0/1, if enable GPIO0/1, please make sure these GPIO are not floating
     //aon_gpio0_interupt_init();
@@ -497,6 +532,18 @@ void comm_task(void *pvParameters)
 
     			case APP_MSG_COMMEVENT_SPISEND_PIC:
     				dbg_printf(DBG_LESS_INFO, "APP_MSG_COMMEVENT_SPISEND_PIC\r\n");
+    				jpeg_buf = app_buf_get(comm_recv_msg.msg_data);
+    				if(jpeg_buf != NULL)
+    				{
+    					comm_send_jpeg(jpeg_buf);
+    				}
+    				app_buf_unref(comm_recv_msg.msg_data);
+    				main_send_msg.msg_data = comm_recv_msg.msg_data;
+    				main_send_msg.msg_event = APP_MSG_MAINEVENT_SPISEND_PIC_DONE;
+    				if(xQueueSend( xMainTaskQueue , (void *) &main_send_msg , __QueueSendTicksToWait) != pdTRUE)
+    				{
+    					dbg_printf(DBG_LESS_INFO, "send main_send_msg=0x%x fail\r\n", main_send_msg.msg_event);
+    				}
     				break;
 
     			default:
@@ -24,4 +24,15 @@
 #define SENSOR_AE_STABLE_CNT		10
 #define ENTER_PMU_MODE_FRAME_CNT	3
 
+/** Buffer pools (app_buf_pool.h):
+ *	frame slots are 640x480 YUV420 raw frames (450 KB each), JPEG slots hold the
+ *	encoded frame, result slots the model output. Slot 0 of the frame and JPEG
+ *	pools are the buffers of cisdp_sensor.c, the others are reserved in dp_task.c.
+ * **/
+#define APP_BUF_FRAME_SLOTS			2		// capture one frame while the previous one is inferred
+#define APP_BUF_JPEG_SLOTS			3		// capture and infer while a JPEG is sent
+#define APP_BUF_RESULT_SLOTS		2
+
+#define WE2_CHIP_VERSION_C			0x8538000c	// IMX sensors need the stream off around cv_run() on this chip
+
 #endif /* APP_SCENARIO_ALLON_SENSOR_TFLM_COMMON_CONFIG_H_ */
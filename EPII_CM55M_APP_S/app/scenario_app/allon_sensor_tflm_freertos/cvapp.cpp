@@ -204,11 +204,11 @@ int cv_init(bool security_enable, bool privilege_enable)
 	return ercode;
 }
 
-int cv_run() {
+int cv_run(uint32_t raw_addr, int8_t *scores) {
 	int ercode = 0;
 
 	//give image to input tensor
-	img_rescale((uint8_t*)app_get_raw_addr(), app_get_raw_width(), app_get_raw_height(), INPUT_SIZE_X, INPUT_SIZE_Y,
+	img_rescale((uint8_t*)raw_addr, app_get_raw_width(), app_get_raw_height(), INPUT_SIZE_X, INPUT_SIZE_Y,
 			input->data.int8, SC(app_get_raw_width(), INPUT_SIZE_X), SC(app_get_raw_height(), INPUT_SIZE_Y));
 
 	TfLiteStatus invoke_status = int_ptr->Invoke();
@@ -226,6 +226,11 @@ int cv_run() {
 	int8_t no_person_score = output->data.int8[0];
 
 	xprintf("person_score:%d\n",person_score);
+	if(scores != NULL)
+	{
+		scores[CV_SCORE_NO_PERSON] = no_person_score;
+		scores[CV_SCORE_PERSON] = person_score;
+	}
 	//error_reporter->Report(
 	//	   "person score: %d, no person score: %d\n", person_score,
 	//	   no_person_score);
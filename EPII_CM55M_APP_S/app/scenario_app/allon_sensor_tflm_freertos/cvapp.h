@@ -16,7 +16,17 @@ extern "C" {
 
 int cv_init(bool security_enable, bool privilege_enable);
 
-int cv_run();
+/* person_detect output, int8 scores in the order of the model */
+#define CV_SCORE_NO_PERSON	0
+#define CV_SCORE_PERSON		1
+#define CV_SCORE_NUM		2
+
+/**
+ * \brief	Runs person_detect on a raw frame of app_get_raw_width() x app_get_raw_height().
+ * \param[in]	raw_addr: frame slot (APP_BUF_POOL_FRAME)
+ * \param[out]	scores: CV_SCORE_NUM scores, may be NULL
+ */
+int cv_run(uint32_t raw_addr, int8_t *scores);
 
 int cv_deinit();
 #ifdef __cplusplus
@@ -25,6 +25,7 @@
 #endif
 #ifdef IP_xdma
 #include "hx_drv_xdma.h"
+#include "hx_drv_jpeg.h"
 #include "sensor_dp_lib.h"
 #endif
 #ifdef IP_cdm
@@ -91,6 +92,8 @@
 #include "cisdp_sensor.h"
 #include "cisdp_cfg.h"
 #include "spi_master_protocol.h"
+#include "app_buf_pool.h"
+#include "hx_ring.h"
 #define FRAME_CHECK_DEBUG 1
 #define MAX_STRING  100
 #define DEBUG_SPIMST_SENDPICS		(0x01) //0x00: off/ 0x01: JPEG/0x02: YUV422/0x03: YUV420/0x04: YUV400/0x05: RGB
@@ -105,9 +108,167 @@ static uint8_t g_spi_master_initial_status;
 uint32_t jpeg_addr, jpeg_sz;
 uint32_t g_img_data = 0;
 
+/* Frame and JPEG slots after slot 0, which is the buffer set of cisdp_sensor.c.
+ * Sized for APP_DP_RES_YUV640x480_INP_SUBSAMPLE_1X. */
+#define DP_BUF_FRAME_SZ				(640*480*3/2)
+#define DP_BUF_JPEG_SZ				(640*480/4)
+#define DP_BUF_JPEG_AUTOFILL_SZ		128
+#if (APP_BUF_FRAME_SLOTS > 1)
+__attribute__(( section(".bss.NoInit"))) uint8_t dp_frame_buf[APP_BUF_FRAME_SLOTS-1][DP_BUF_FRAME_SZ] __ALIGNED(32);
+#endif
+#if (APP_BUF_JPEG_SLOTS > 1)
+__attribute__(( section(".bss.NoInit"))) uint8_t dp_jpeg_buf[APP_BUF_JPEG_SLOTS-1][DP_BUF_JPEG_SZ] __ALIGNED(32);
+__attribute__(( section(".bss.NoInit"))) uint8_t dp_jpeg_autofill_buf[APP_BUF_JPEG_SLOTS-1][DP_BUF_JPEG_AUTOFILL_SZ] __ALIGNED(32);
+#endif
+
+static uint8_t g_dp_buf_init = 0;
+static uint8_t g_dp_capturing = 0;      /* sensor started, cleared by stop */
+static uint8_t g_dp_overlap = 1;        /* retrigger before the previous frame is consumed */
+static uint32_t g_dp_buf_stall = 0;     /* captures delayed for lack of a free slot */
+/* slots the datapath is writing to, owned by dp_task until the frame is ready */
+static uint32_t g_cap_frame = APP_BUF_TOKEN_NONE;
+static uint32_t g_cap_jpeg = APP_BUF_TOKEN_NONE;
+
+/* Datapath callback events, written by os_app_dplib_cb() and read by dp_task.
+ * Only the push that finds the ring empty sends APP_MSG_DPEVENT_ISR_RING to
+ * xDPTaskQueue, a burst of events costs one queue message. */
+#define DP_ISR_RING_LEN					8
+static APP_MSG_T dp_isr_ring_buf[DP_ISR_RING_LEN];
+static hx_ring dp_isr_ring = HX_RING_INITIALIZER(dp_isr_ring_buf, DP_ISR_RING_LEN, sizeof(APP_MSG_T));
+
+static void dp_buf_init(void)
+{
+    uint32_t wdma1_addr, wdma2_addr, wdma3_addr, autofill_addr;
+#ifdef CIS_IMX
+    uint32_t chipid, version;
+#endif
+
+    if (g_dp_buf_init)
+        return;
+    g_dp_buf_init = 1;
+
+    /* slot 0 is the buffer set cisdp_dp_init() gave to the datapath */
+    sensordplib_get_xDMA_baseaddr(&wdma1_addr, &wdma2_addr, &wdma3_addr);
+    sensordplib_get_jpegfilesize_addrbyapp(&autofill_addr);
+    app_buf_pool_add(APP_BUF_POOL_FRAME, wdma3_addr, app_get_raw_sz(), 0);
+    app_buf_pool_add(APP_BUF_POOL_JPEG, wdma2_addr, DP_BUF_JPEG_SZ, autofill_addr);
+#if (APP_BUF_FRAME_SLOTS > 1)
+    for (uint32_t i = 0; i < APP_BUF_FRAME_SLOTS - 1; i++)
+        app_buf_pool_add(APP_BUF_POOL_FRAME, (uint32_t)dp_frame_buf[i], DP_BUF_FRAME_SZ, 0);
+#endif
+#if (APP_BUF_JPEG_SLOTS > 1)
+    for (uint32_t i = 0; i < APP_BUF_JPEG_SLOTS - 1; i++)
+        app_buf_pool_add(APP_BUF_POOL_JPEG, (uint32_t)dp_jpeg_buf[i], DP_BUF_JPEG_SZ,
+                (uint32_t)dp_jpeg_autofill_buf[i]);
+#endif
+
+#ifdef CIS_IMX
+    /* algo_task stops the stream around cv_run() on this chip, so only one frame is in flight */
+    hx_drv_scu_get_version(&chipid, &version);
+    if (chipid == WE2_CHIP_VERSION_C)
+        g_dp_overlap = 0;
+#endif
+    xprintf("buffer pool: %d frame, %d jpeg slots, overlap %d\n", APP_BUF_FRAME_SLOTS, APP_BUF_JPEG_SLOTS, g_dp_overlap);
+}
+
+/* Points the datapath at a free frame and JPEG slot, false if one of them is not free */
+static bool dp_buf_arm(void)
+{
+    uint32_t wdma1_addr, wdma2_addr, wdma3_addr;
+    uint32_t frame = app_buf_acquire(APP_BUF_POOL_FRAME);
+    uint32_t jpeg = app_buf_acquire(APP_BUF_POOL_JPEG);
+    app_buf_t *frame_buf = app_buf_get(frame);
+    app_buf_t *jpeg_buf = app_buf_get(jpeg);
+
+    if (frame_buf == NULL || jpeg_buf == NULL)
+    {
+        app_buf_unref(frame);
+        app_buf_unref(jpeg);
+        return false;
+    }
+
+    sensordplib_get_xDMA_baseaddr(&wdma1_addr, &wdma2_addr, &wdma3_addr);
+    sensordplib_set_xDMA_baseaddrbyapp(wdma1_addr, jpeg_buf->addr, frame_buf->addr);
+    sensordplib_set_jpegfilesize_addrbyapp(jpeg_buf->aux_addr);
+
+    taskENTER_CRITICAL();
+    g_cap_frame = frame;
+    g_cap_jpeg = jpeg;
+    taskEXIT_CRITICAL();
+    return true;
+}
+
+/* Gives back the capture slots, the sensor is stopped or its datapath set up again */
+static void dp_buf_disarm(void)
+{
+    uint32_t frame, jpeg;
+
+    taskENTER_CRITICAL();
+    frame = g_cap_frame;
+    jpeg = g_cap_jpeg;
+    g_cap_frame = APP_BUF_TOKEN_NONE;
+    g_cap_jpeg = APP_BUF_TOKEN_NONE;
+    taskEXIT_CRITICAL();
+
+    app_buf_unref(frame);
+    app_buf_unref(jpeg);
+}
+
+/* Hands the slots of the finished capture over to the CAP_FRAME_DONE message */
+static uint32_t dp_buf_frame_done(void)
+{
+    app_buf_t *frame_buf = app_buf_get(g_cap_frame);
+    app_buf_t *jpeg_buf = app_buf_get(g_cap_jpeg);
+    uint32_t pair;
+
+    if (frame_buf != NULL)
+    {
+        frame_buf->len = app_get_raw_sz();
+        frame_buf->seq = g_cur_jpegenc_frame;
+        hx_InvalidateDCache_by_Addr((volatile void *)frame_buf->addr, frame_buf->len);
+    }
+    if (jpeg_buf != NULL)
+    {
+        /* size the encoder wrote to the slot's own autofill word; a slot holds
+         * one frame (cyclic_buffer_cnt 1), so frame 0 */
+        hx_InvalidateDCache_by_Addr((volatile void *)jpeg_buf->aux_addr, 32);
+        hx_drv_jpeg_get_FillFileSizeToMem(0, jpeg_buf->aux_addr, &jpeg_buf->len);
+        jpeg_buf->seq = g_cur_jpegenc_frame;
+        hx_InvalidateDCache_by_Addr((volatile void *)jpeg_buf->addr, jpeg_buf->len);
+    }
+
+    taskENTER_CRITICAL();
+    pair = APP_BUF_TOKEN_PAIR(g_cap_frame, g_cap_jpeg);
+    g_cap_frame = APP_BUF_TOKEN_NONE;
+    g_cap_jpeg = APP_BUF_TOKEN_NONE;
+    taskEXIT_CRITICAL();
+    return pair;
+}
+
+/* Retriggers the capture into free slots. Without a free slot the capture waits
+ * for the next APP_MSG_DPEVENT_RECAPTURE, which main_task sends when a frame is
+ * inferred or a JPEG is sent. */
+static void dp_buf_recapture(void)
+{
+    if (!g_dp_capturing || g_cap_frame != APP_BUF_TOKEN_NONE)
+        return;
+    if (!g_dp_overlap && app_buf_pool_in_use(APP_BUF_POOL_FRAME) != 0)
+        return;
+    if (!dp_buf_arm())
+    {
+        g_dp_buf_stall++;
+        dbg_printf(DBG_LESS_INFO, "no free slot (frame %d, jpeg %d in use), capture waits %d\n",
+                app_buf_pool_in_use(APP_BUF_POOL_FRAME), app_buf_pool_in_use(APP_BUF_POOL_JPEG), g_dp_buf_stall);
+        return;
+    }
+    g_dptask_state = APP_DP_TASK_STATE_RECAP_FRAME;
+    sensordplib_retrigger_capture();
+}
+
 void os_app_dplib_cb(SENSORDPLIB_STATUS_E event)
 {
     APP_MSG_T dp_msg;
+    bool was_empty;
 	BaseType_t xHigherPriorityTaskWoken;
 	/* We have not woken a task at the start of the ISR. */
     xHigherPriorityTaskWoken = pdFALSE;
@@ -268,7 +429,19 @@ void os_app_dplib_cb(SENSORDPLIB_STATUS_E event)
 
     dp_msg.msg_data = 0;
     dbg_printf(DBG_LESS_INFO, "send to dp task 0x%x\r\n", dp_msg.msg_event);
-	xQueueSendFromISR( xDPTaskQueue, &dp_msg, &xHigherPriorityTaskWoken );
+    was_empty = (hx_ring_count(&dp_isr_ring) == 0);
+    if (hx_ring_push(&dp_isr_ring, &dp_msg) != 0)
+    {
+        dbg_printf(DBG_LESS_INFO, "dp isr ring full, dropped %d\r\n", hx_ring_dropped(&dp_isr_ring));
+        return;
+    }
+    /* dp_task drains the ring before it blocks again, so if this send fails
+     * the messages filling the queue wake it up anyway */
+    if (was_empty)
+    {
+        dp_msg.msg_event = APP_MSG_DPEVENT_ISR_RING;
+        xQueueSendFromISR( xDPTaskQueue, &dp_msg, &xHigherPriorityTaskWoken );
+    }
     if( xHigherPriorityTaskWoken )
     {
     	taskYIELD();
@@ -309,7 +482,9 @@ void app_start_state(APP_STATE_E state)
     else if ( state == APP_STATE_STOP )
     {
         xprintf("APP_STATE_STOP\n");
+        g_dp_capturing = 0;
         cisdp_sensor_stop();
+        dp_buf_disarm();
         return;
     }
 
@@ -320,6 +495,15 @@ void app_start_state(APP_STATE_E state)
         APP_BLOCK_FUNC();
     }
 
+    /* cisdp_dp_init() pointed the datapath back at slot 0, which may still be in use */
+    dp_buf_init();
+    dp_buf_disarm();
+    while (!dp_buf_arm())
+    {
+        vTaskDelay(pdMS_TO_TICKS(10));
+    }
+    g_dp_capturing = 1;
+
     cisdp_sensor_start();
 }
 
@@ -336,8 +520,15 @@ void dp_task(void *pvParameters)
 
     for (;;)
     {
-    	if (xQueueReceive ( xDPTaskQueue , &(dp_recv_msg) , __QueueRecvTicksToWait ) == pdTRUE )
+    	if (hx_ring_pop(&dp_isr_ring, &dp_recv_msg) == 0 ||
+    		xQueueReceive ( xDPTaskQueue , &(dp_recv_msg) , __QueueRecvTicksToWait ) == pdTRUE )
         {
+            /* the doorbell of events already popped above finds the ring empty */
+            if (dp_recv_msg.msg_event == APP_MSG_DPEVENT_ISR_RING &&
+                hx_ring_pop(&dp_isr_ring, &dp_recv_msg) != 0)
+            {
+                continue;
+            }
             dbg_printf(DBG_LESS_INFO, "dp_recv_msg_event=0x%x\r\n", dp_recv_msg.msg_event);
             switch(dp_recv_msg.msg_event)
             {
@@ -470,10 +661,16 @@ void dp_task(void *pvParameters)
                 g_frame_ready = 1;
 		        dbg_printf(DBG_LESS_INFO, "SENSORDPLIB_STATUS_XDMA_FRAME_READY %d \n", g_cur_jpegenc_frame);
                 main_send_msg.msg_event = APP_MSG_MAINEVENT_CAP_FRAME_DONE;
-                main_send_msg.msg_data = 0;
+                main_send_msg.msg_data = dp_buf_frame_done();
+                /* capture the next frame while this one is inferred and sent */
+                if (g_dp_overlap)
+                    dp_buf_recapture();
     	   		if(xQueueSend( xMainTaskQueue , (void *) &main_send_msg , __QueueSendTicksToWait) != pdTRUE)
                 {
                     dbg_printf(DBG_LESS_INFO, "send main_send_msg=0x%x fail\r\n", main_send_msg.msg_event);
+                    app_buf_unref(APP_BUF_TOKEN_LO(main_send_msg.msg_data));
+                    app_buf_unref(APP_BUF_TOKEN_HI(main_send_msg.msg_data));
+                    dp_buf_recapture();
                 }
                 break;
 
@@ -506,7 +703,9 @@ void dp_task(void *pvParameters)
 
             case APP_MSG_DPEVENT_STOPCAPTURE:
                 g_dptask_state = APP_DP_TASK_STATE_STOP_CAP_START;
+                g_dp_capturing = 0;
         		cisdp_sensor_stop();
+                dp_buf_disarm();
                 main_send_msg.msg_data = dp_recv_msg.msg_event;
                 main_send_msg.msg_event = APP_MSG_MAINEVENT_STOP_CAPTURE;
     	   		if(xQueueSend( xMainTaskQueue , (void *) &main_send_msg , __QueueSendTicksToWait) != pdTRUE)
@@ -516,8 +715,7 @@ void dp_task(void *pvParameters)
                 break;
 
             case APP_MSG_DPEVENT_RECAPTURE:
-                g_dptask_state = APP_DP_TASK_STATE_RECAP_FRAME;
-                sensordplib_retrigger_capture();
+                dp_buf_recapture();
                 break;
 
     	   	case APP_MSG_DPEVENT_1BITPARSER_ERR:
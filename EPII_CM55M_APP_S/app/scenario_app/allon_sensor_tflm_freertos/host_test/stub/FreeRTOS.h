@@ -0,0 +1,12 @@
+/* Host stand-in for FreeRTOS.h: the critical section of app_buf_pool.c is
+ * one mutex shared by the threads of test_app_buf_pool.c */
+#ifndef HOST_STUB_FREERTOS_H
+#define HOST_STUB_FREERTOS_H
+
+void host_enter_critical(void);
+void host_exit_critical(void);
+
+#define taskENTER_CRITICAL()	host_enter_critical()
+#define taskEXIT_CRITICAL()		host_exit_critical()
+
+#endif
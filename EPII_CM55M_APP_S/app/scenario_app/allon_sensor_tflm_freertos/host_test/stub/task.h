@@ -0,0 +1,2 @@
+/* Host stand-in for task.h, the critical section macros are in FreeRTOS.h */
+#include "FreeRTOS.h"
@@ -0,0 +1,482 @@
+/*
+ * Host unit test of app_buf_pool.c.
+ *
+ * First checks tokens, reference counts and exhaustion on the pools set up
+ * like the app (APP_BUF_*_SLOTS of common_config.h). Then four threads
+ * stand in for the FreeRTOS tasks and pass tokens through queues the way
+ * dp_task, main_task, algo_task and comm_task do:
+ *
+ *   capture -> CAP_FRAME_DONE(frame, jpeg) -> main -> START_ALGO(frame) -> algo
+ *                                                  -> SPISEND_PIC(jpeg)  -> comm
+ *   algo -> STARTDONE(result) -> main,  comm -> SPISEND_PIC_DONE -> main
+ *   main -> RECAPTURE -> capture
+ *
+ * The capture thread fills a slot with a pattern of its frame number, algo
+ * and comm check the pattern before and after their (randomly long) work.
+ * A slot handed out again while a reference is still held shows up as a
+ * pattern mismatch or as a capture slot with more than one reference.
+ */
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "common_config.h"
+#include "app_buf_pool.h"
+
+#define FRAME_SZ		256
+#define JPEG_SZ			64
+#define RESULT_SZ		2
+#define STRESS_FRAMES	20000
+
+/*-----------------------------------------------------------*/
+/* FreeRTOS critical section of stub/FreeRTOS.h */
+
+static pthread_mutex_t critical = PTHREAD_MUTEX_INITIALIZER;
+
+void host_enter_critical(void)
+{
+	pthread_mutex_lock(&critical);
+}
+
+void host_exit_critical(void)
+{
+	pthread_mutex_unlock(&critical);
+}
+
+/*-----------------------------------------------------------*/
+/* Message queues, APP_MSG_T of app_msg.h */
+
+typedef enum {
+	EV_CAP_FRAME_DONE = 0,
+	EV_START_ALGO,
+	EV_ALGO_DONE,
+	EV_SEND_PIC,
+	EV_SEND_DONE,
+	EV_RECAPTURE,
+	EV_END,
+} event_t;
+
+typedef struct {
+	event_t msg_event;
+	uint32_t msg_data;
+} msg_t;
+
+#define QUEUE_LEN	32
+
+typedef struct {
+	msg_t item[QUEUE_LEN];
+	int head, count;
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+} queue_t;
+
+static void queue_init(queue_t *q)
+{
+	memset(q, 0, sizeof(*q));
+	pthread_mutex_init(&q->lock, NULL);
+	pthread_cond_init(&q->cond, NULL);
+}
+
+static void queue_send(queue_t *q, event_t event, uint32_t data)
+{
+	pthread_mutex_lock(&q->lock);
+	while (q->count == QUEUE_LEN)
+		pthread_cond_wait(&q->cond, &q->lock);
+	q->item[(q->head + q->count) % QUEUE_LEN] = (msg_t){ event, data };
+	q->count++;
+	pthread_cond_broadcast(&q->cond);
+	pthread_mutex_unlock(&q->lock);
+}
+
+static msg_t queue_recv(queue_t *q)
+{
+	msg_t msg;
+
+	pthread_mutex_lock(&q->lock);
+	while (q->count == 0)
+		pthread_cond_wait(&q->cond, &q->lock);
+	msg = q->item[q->head];
+	q->head = (q->head + 1) % QUEUE_LEN;
+	q->count--;
+	pthread_cond_broadcast(&q->cond);
+	pthread_mutex_unlock(&q->lock);
+	return msg;
+}
+
+/* drops the pending messages, dp_task handles them between frames */
+static void queue_flush(queue_t *q)
+{
+	pthread_mutex_lock(&q->lock);
+	q->count = 0;
+	pthread_cond_broadcast(&q->cond);
+	pthread_mutex_unlock(&q->lock);
+}
+
+/*-----------------------------------------------------------*/
+
+static uint8_t frame_mem[APP_BUF_FRAME_SLOTS][FRAME_SZ];
+static uint8_t jpeg_mem[APP_BUF_JPEG_SLOTS][JPEG_SZ];
+static int8_t result_mem[APP_BUF_RESULT_SLOTS][RESULT_SZ];
+
+static queue_t dp_q, main_q, algo_q, comm_q;
+
+/* counted by the threads, read after they are joined */
+static volatile uint32_t captured;
+static uint32_t shared_writes, frame_corrupt, jpeg_corrupt, result_corrupt;
+static uint32_t recapture_waits, no_result_slot, overlap_algo, overlap_comm;
+static uint32_t algo_frames, comm_frames;
+
+static uint8_t frame_byte(uint32_t seq, uint32_t i)
+{
+	return (uint8_t)(seq * 7 + i);
+}
+
+static uint8_t jpeg_byte(uint32_t seq, uint32_t i)
+{
+	return (uint8_t)(seq * 13 + i);
+}
+
+static int check(const char *what, int ok)
+{
+	if (!ok)
+		printf("FAIL: %s\n", what);
+	return !ok;
+}
+
+static void work(uint32_t max_us)
+{
+	uint32_t us = (uint32_t)rand() % (max_us + 1);
+
+	if (us < 20)
+		sched_yield();
+	else
+		usleep(us);
+}
+
+/*-----------------------------------------------------------*/
+/* dp_task: the datapath writes into the armed slots */
+
+static void *capture_thread(void *arg)
+{
+	uint32_t frame = APP_BUF_TOKEN_NONE, jpeg = APP_BUF_TOKEN_NONE;
+
+	(void)arg;
+
+	for (uint32_t seq = 1; seq <= STRESS_FRAMES; seq++) {
+		app_buf_t *frame_buf, *jpeg_buf;
+
+		/* dp_buf_arm(): both slots or none */
+		queue_flush(&dp_q);
+		for (;;) {
+			frame = app_buf_acquire(APP_BUF_POOL_FRAME);
+			jpeg = app_buf_acquire(APP_BUF_POOL_JPEG);
+			if (frame != APP_BUF_TOKEN_NONE && jpeg != APP_BUF_TOKEN_NONE)
+				break;
+			app_buf_unref(frame);
+			app_buf_unref(jpeg);
+			recapture_waits++;
+			while (queue_recv(&dp_q).msg_event != EV_RECAPTURE)
+				;
+		}
+		frame_buf = app_buf_get(frame);
+		jpeg_buf = app_buf_get(jpeg);
+		if (frame_buf->ref != 1 || jpeg_buf->ref != 1)
+			shared_writes++;
+
+		/* the DMA writes while algo and comm work on earlier frames */
+		for (uint32_t i = 0; i < FRAME_SZ; i++) {
+			((uint8_t *)frame_buf->addr)[i] = frame_byte(seq, i);
+			if (i % 64 == 0)
+				work(10);
+		}
+		jpeg_buf->len = JPEG_SZ / 2 + seq % (JPEG_SZ / 2);
+		for (uint32_t i = 0; i < jpeg_buf->len; i++)
+			((uint8_t *)jpeg_buf->addr)[i] = jpeg_byte(seq, i);
+		frame_buf->len = FRAME_SZ;
+		frame_buf->seq = seq;
+		jpeg_buf->seq = seq;
+
+		/* dp_buf_frame_done(): the tokens go with the message */
+		captured = seq;
+		queue_send(&main_q, EV_CAP_FRAME_DONE, APP_BUF_TOKEN_PAIR(frame, jpeg));
+	}
+	queue_send(&main_q, EV_END, 0);
+	return NULL;
+}
+
+/*-----------------------------------------------------------*/
+
+static int frame_ok(const app_buf_t *buf)
+{
+	for (uint32_t i = 0; i < FRAME_SZ; i++) {
+		if (((const uint8_t *)buf->addr)[i] != frame_byte(buf->seq, i))
+			return 0;
+	}
+	return 1;
+}
+
+static int jpeg_ok(const app_buf_t *buf)
+{
+	for (uint32_t i = 0; i < buf->len; i++) {
+		if (((const uint8_t *)buf->addr)[i] != jpeg_byte(buf->seq, i))
+			return 0;
+	}
+	return 1;
+}
+
+static void *algo_thread(void *arg)
+{
+	(void)arg;
+
+	for (;;) {
+		msg_t msg = queue_recv(&algo_q);
+		app_buf_t *frame_buf, *result_buf;
+		uint32_t result, start;
+
+		if (msg.msg_event == EV_END)
+			break;
+
+		frame_buf = app_buf_get(msg.msg_data);
+		result = app_buf_acquire(APP_BUF_POOL_RESULT);
+		result_buf = app_buf_get(result);
+		if (result_buf == NULL)
+			no_result_slot++;
+		if (frame_buf == NULL || !frame_ok(frame_buf)) {
+			frame_corrupt++;
+		} else {
+			start = captured;
+			work(300);		/* cv_run() */
+			if (!frame_ok(frame_buf))
+				frame_corrupt++;
+			if (captured != start)
+				overlap_algo++;
+			if (result_buf != NULL) {
+				((int8_t *)result_buf->addr)[0] = (int8_t)(frame_buf->seq & 0x7F);
+				result_buf->len = RESULT_SZ;
+				result_buf->seq = frame_buf->seq;
+			}
+		}
+		algo_frames++;
+		app_buf_unref(msg.msg_data);
+		queue_send(&main_q, EV_ALGO_DONE, result);
+	}
+	queue_send(&main_q, EV_END, 0);
+	return NULL;
+}
+
+static void *comm_thread(void *arg)
+{
+	(void)arg;
+
+	for (;;) {
+		msg_t msg = queue_recv(&comm_q);
+		app_buf_t *jpeg_buf;
+		uint32_t start;
+
+		if (msg.msg_event == EV_END)
+			break;
+
+		jpeg_buf = app_buf_get(msg.msg_data);
+		if (jpeg_buf == NULL || !jpeg_ok(jpeg_buf)) {
+			jpeg_corrupt++;
+		} else {
+			start = captured;
+			work(600);		/* SPI transfer */
+			if (!jpeg_ok(jpeg_buf))
+				jpeg_corrupt++;
+			if (captured != start)
+				overlap_comm++;
+		}
+		comm_frames++;
+		app_buf_unref(msg.msg_data);
+		queue_send(&main_q, EV_SEND_DONE, msg.msg_data);
+	}
+	queue_send(&main_q, EV_END, 0);
+	return NULL;
+}
+
+/* main_task: forwards the tokens, releases results, wakes the capture */
+static void main_loop(void)
+{
+	int ends = 0;
+
+	while (ends < 3) {
+		msg_t msg = queue_recv(&main_q);
+		app_buf_t *result_buf;
+
+		switch (msg.msg_event) {
+		case EV_CAP_FRAME_DONE:
+			queue_send(&algo_q, EV_START_ALGO, APP_BUF_TOKEN_LO(msg.msg_data));
+			queue_send(&comm_q, EV_SEND_PIC, APP_BUF_TOKEN_HI(msg.msg_data));
+			break;
+		case EV_ALGO_DONE:
+			result_buf = app_buf_get(msg.msg_data);
+			if (result_buf != NULL &&
+					((int8_t *)result_buf->addr)[0] != (int8_t)(result_buf->seq & 0x7F))
+				result_corrupt++;
+			app_buf_unref(msg.msg_data);
+			queue_send(&dp_q, EV_RECAPTURE, 0);
+			break;
+		case EV_SEND_DONE:
+			queue_send(&dp_q, EV_RECAPTURE, 0);
+			break;
+		case EV_END:
+			/* capture first, then algo and comm after their last frame */
+			if (ends++ == 0) {
+				queue_send(&algo_q, EV_END, 0);
+				queue_send(&comm_q, EV_END, 0);
+			}
+			break;
+		default:
+			break;
+		}
+	}
+}
+
+/*-----------------------------------------------------------*/
+
+static int test_tokens(void)
+{
+	int failures = 0;
+	uint32_t t0, t1, t2, stale, again;
+	app_buf_t *buf;
+	int ok;
+
+	for (int i = 0; i < APP_BUF_FRAME_SLOTS; i++)
+		failures += check("add frame slot", app_buf_pool_add(APP_BUF_POOL_FRAME, (uintptr_t)frame_mem[i], FRAME_SZ, 0) == i);
+	for (int i = 0; i < APP_BUF_JPEG_SLOTS; i++)
+		failures += check("add jpeg slot", app_buf_pool_add(APP_BUF_POOL_JPEG, (uintptr_t)jpeg_mem[i], JPEG_SZ, 0) == i);
+	for (int i = 0; i < APP_BUF_RESULT_SLOTS; i++)
+		failures += check("add result slot", app_buf_pool_add(APP_BUF_POOL_RESULT, (uintptr_t)result_mem[i], RESULT_SZ, 0) == i);
+	failures += check("add to an unknown pool", app_buf_pool_add(APP_BUF_POOL_NUM, 0, 0, 0) == -1);
+
+	/* exhaustion */
+	t0 = app_buf_acquire(APP_BUF_POOL_FRAME);
+	t1 = app_buf_acquire(APP_BUF_POOL_FRAME);
+	t2 = app_buf_acquire(APP_BUF_POOL_FRAME);
+	failures += check("acquired tokens are not NONE", t0 != APP_BUF_TOKEN_NONE && t1 != APP_BUF_TOKEN_NONE);
+	failures += check("acquired tokens differ", t0 != t1);
+	failures += check("tokens fit in 16 bits", t0 <= 0xFFFF && t1 <= 0xFFFF);
+	failures += check("no token from a pool in use", t2 == APP_BUF_TOKEN_NONE);
+	failures += check("exhaustion counted", app_buf_pool_exhausted(APP_BUF_POOL_FRAME) == 1);
+	failures += check("pool in use", app_buf_pool_in_use(APP_BUF_POOL_FRAME) == 2);
+	failures += check("slot memory of the token",
+			app_buf_get(t0) != NULL && app_buf_get(t0)->addr == (uintptr_t)frame_mem[0]);
+
+	/* references */
+	failures += check("ref", app_buf_ref(t0) == 0);
+	failures += check("unref with a reference left", app_buf_unref(t0) == 1);
+	failures += check("slot kept while referenced", app_buf_get(t0) != NULL);
+	failures += check("last unref", app_buf_unref(t0) == 0);
+	failures += check("slot freed", app_buf_pool_in_use(APP_BUF_POOL_FRAME) == 1);
+
+	/* stale tokens */
+	stale = t0;
+	failures += check("get with a stale token", app_buf_get(stale) == NULL);
+	failures += check("ref with a stale token", app_buf_ref(stale) == -1);
+	failures += check("unref with a stale token", app_buf_unref(stale) == -1);
+	again = app_buf_acquire(APP_BUF_POOL_FRAME);
+	failures += check("freed slot acquired again", again != APP_BUF_TOKEN_NONE);
+	failures += check("new token for the same slot",
+			again != stale && app_buf_get(again) != NULL && app_buf_get(again)->addr == (uintptr_t)frame_mem[0]);
+	failures += check("stale token does not alias the new owner", app_buf_get(stale) == NULL && app_buf_unref(stale) == -1);
+	failures += check("new owner keeps its reference", app_buf_get(again) != NULL && app_buf_get(again)->ref == 1);
+	app_buf_unref(again);
+	app_buf_unref(t1);
+
+	/* invalid tokens */
+	failures += check("unref NONE", app_buf_unref(APP_BUF_TOKEN_NONE) == 0);
+	failures += check("get NONE", app_buf_get(APP_BUF_TOKEN_NONE) == NULL);
+	failures += check("get out of range", app_buf_get(0x12345678) == NULL);
+	failures += check("get unknown pool", app_buf_get((1 << 8) | (APP_BUF_POOL_NUM << 4)) == NULL);
+	failures += check("get unregistered slot", app_buf_get((1 << 8) | (APP_BUF_POOL_FRAME << 4) | 7) == NULL);
+
+	/* token pairs in one msg_data */
+	t0 = app_buf_acquire(APP_BUF_POOL_FRAME);
+	t1 = app_buf_acquire(APP_BUF_POOL_JPEG);
+	failures += check("token pair",
+			APP_BUF_TOKEN_LO(APP_BUF_TOKEN_PAIR(t0, t1)) == t0 && APP_BUF_TOKEN_HI(APP_BUF_TOKEN_PAIR(t0, t1)) == t1);
+	failures += check("empty pair", APP_BUF_TOKEN_PAIR(APP_BUF_TOKEN_NONE, APP_BUF_TOKEN_NONE) == 0);
+	app_buf_unref(t0);
+	app_buf_unref(t1);
+
+	/* generation wrap */
+	ok = 1;
+	for (int i = 0; i < 1000; i++) {
+		uint32_t t = app_buf_acquire(APP_BUF_POOL_RESULT);
+
+		buf = app_buf_get(t);
+		if (t == APP_BUF_TOKEN_NONE || buf == NULL || buf->token != t)
+			ok = 0;
+		app_buf_unref(t);
+	}
+	failures += check("no NONE token over generation wrap", ok);
+
+	failures += check("all slots free",
+			app_buf_pool_in_use(APP_BUF_POOL_FRAME) == 0 && app_buf_pool_in_use(APP_BUF_POOL_JPEG) == 0 &&
+			app_buf_pool_in_use(APP_BUF_POOL_RESULT) == 0);
+	return failures;
+}
+
+static int test_tasks(void)
+{
+	int failures = 0;
+	pthread_t capture, algo, comm;
+
+	queue_init(&dp_q);
+	queue_init(&main_q);
+	queue_init(&algo_q);
+	queue_init(&comm_q);
+
+	pthread_create(&capture, NULL, capture_thread, NULL);
+	pthread_create(&algo, NULL, algo_thread, NULL);
+	pthread_create(&comm, NULL, comm_thread, NULL);
+	main_loop();
+	pthread_join(capture, NULL);
+	pthread_join(algo, NULL);
+	pthread_join(comm, NULL);
+
+	printf("%d frames: %u captured while algo ran, %u while comm ran, capture waited %u times, "
+			"no result slot %u times\n", STRESS_FRAMES, overlap_algo, overlap_comm, recapture_waits, no_result_slot);
+
+	failures += check("every frame inferred and sent", algo_frames == STRESS_FRAMES && comm_frames == STRESS_FRAMES);
+	failures += check("no slot written while referenced", shared_writes == 0);
+	failures += check("frames intact while inferred", frame_corrupt == 0);
+	failures += check("JPEGs intact while sent", jpeg_corrupt == 0);
+	failures += check("results intact", result_corrupt == 0);
+	failures += check("capture overlaps inference", overlap_algo > 0);
+	failures += check("capture overlaps transmit", overlap_comm > 0);
+	failures += check("all slots free at the end",
+			app_buf_pool_in_use(APP_BUF_POOL_FRAME) == 0 && app_buf_pool_in_use(APP_BUF_POOL_JPEG) == 0 &&
+			app_buf_pool_in_use(APP_BUF_POOL_RESULT) == 0);
+	return failures;
+}
+
+static int test_full_pool(void)
+{
+	int failures = 0;
+	int idx = 0;
+
+	for (int i = APP_BUF_RESULT_SLOTS; i < APP_BUF_POOL_MAX_SLOTS; i++)
+		idx = app_buf_pool_add(APP_BUF_POOL_RESULT, 0, 0, 0);
+	failures += check("pool takes APP_BUF_POOL_MAX_SLOTS slots", idx == APP_BUF_POOL_MAX_SLOTS - 1);
+	failures += check("no slot beyond APP_BUF_POOL_MAX_SLOTS", app_buf_pool_add(APP_BUF_POOL_RESULT, 0, 0, 0) == -1);
+	return failures;
+}
+
+int main(void)
+{
+	int failures = 0;
+
+	srand(1);
+	failures += test_tokens();
+	failures += test_tasks();
+	failures += test_full_pool();
+
+	printf("%s\n", failures ? "FAILED" : "PASSED");
+	return failures ? 1 : 0;
+}
@@ -21,6 +21,10 @@
 #include "hxevent_debug.h"
 #include "hx_drv_timer.h"
 #include "WE2_core.h"
+#ifdef LIB_EVLOOP
+#include "hx_evloop_hxevent.h"
+#include "xprintf.h"
+#endif
 
 #ifdef EVT_I2CS_0_CMD
 #include "i2c_comm.h"
@@ -741,8 +745,9 @@ void event_handler_init(void)
 
     /*
      * if enable WFI must disable systick
+     * evloop waits in WFI itself and keeps SysTick as its clock
      */
-#ifdef ENABLE_EVENT_IDLE_WFI
+#if defined(ENABLE_EVENT_IDLE_WFI) && !defined(LIB_EVLOOP)
     EPII_Set_Systick_enable(0);
 #endif
 
@@ -781,6 +786,15 @@ void event_handler_stop(void)
     return;
 }
 
+// Function used to print the event statistics
+void event_handler_report(void)
+{
+#ifdef LIB_EVLOOP
+    hx_evloop_report(hx_event_loop(), xprintf);
+#endif
+    return;
+}
+
 
 
 // Callback function for idle event
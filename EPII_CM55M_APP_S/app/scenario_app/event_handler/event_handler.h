@@ -99,6 +99,17 @@ void event_handler_start(void);
  */
 void event_handler_stop(void);
 
+
+/**
+ * \brief	The function use to print the statistics of the Event Handler Framework
+ *
+ * Posts, latency and run time of every event and idle time since
+ * hx_event_set_cycle_cnt(), when the events run on library/evloop (evloop
+ * instead of hxevent in LIB_SEL); nothing with the prebuilt hxevent
+ * \retval	void
+ */
+void event_handler_report(void);
+
 /** @} */
 
 #endif /* _EVENT_HANDLER_H_ */
@@ -207,3 +207,73 @@ IIC_ERR_CODE_E icm42688_get_data(icm42688_axis_t *acc_axis, icm42688_axis_t *gyr
     
     return error_check;
 }
+
+
+IIC_ERR_CODE_E icm42688_fifo_init(uint8_t odr, uint16_t watermark)
+{
+    uint8_t tmp_data[ 2 ];
+    IIC_ERR_CODE_E error_check = IIC_ERR_OK;
+
+    tmp_data[ 0 ] = ICM42688_ACFG0_FS_SEL_16G | odr;
+    error_check |= icm42688_i2c_write(ICM42688_REG0_ACCEL_CONFIG_0, tmp_data, 1);
+
+    tmp_data[ 0 ] = ICM42688_GCFG0_FS_SEL_2000DPS | odr;
+    error_check |= icm42688_i2c_write(ICM42688_REG0_GYRO_CONFIG_0, tmp_data, 1);
+
+    // the FIFO is stopped while it is set up
+    tmp_data[ 0 ] = ICM42688_FIFOCONFIG_BYPASS_MODE;
+    error_check |= icm42688_i2c_write(ICM42688_REG0_FIFO_CONFIG, tmp_data, 1);
+
+    // INT1 keeps firing while the FIFO stays above the watermark
+    tmp_data[ 0 ] = ICM42688_FIFOCONFIG1_WM_GT_TH |
+                    ICM42688_FIFOCONFIG1_TEMP_EN |
+                    ICM42688_FIFOCONFIG1_GYRO_EN |
+                    ICM42688_FIFOCONFIG1_ACCEL_EN;
+    error_check |= icm42688_i2c_write(ICM42688_REG0_FIFO_CONFIG_1, tmp_data, 1);
+
+    // FIFO_CONFIG2 is WM[7:0], FIFO_CONFIG3 WM[11:8]
+    tmp_data[ 0 ] = watermark & 0xFF;
+    tmp_data[ 1 ] = ( watermark >> 8 ) & 0x0F;
+    error_check |= icm42688_i2c_write(ICM42688_REG0_FIFO_CONFIG_2, tmp_data, 2);
+
+    // pulsed, so a rising edge per watermark on the GPIO side
+    tmp_data[ 0 ] = ICM42688_INTCONFIG_INT1_PUSH_PULL |
+                    ICM42688_INTCONFIG_INT1_ACTIVE_HIGH;
+    error_check |= icm42688_i2c_write(ICM42688_REG0_INT_CONFIG, tmp_data, 1);
+
+    tmp_data[ 0 ] = 0x00;
+    error_check |= icm42688_i2c_write(ICM42688_REG0_INT_CONFIG_1, tmp_data, 1);
+
+    tmp_data[ 0 ] = ICM42688_ISRC0_FIFO_THS_INT1_EN;
+    error_check |= icm42688_i2c_write(ICM42688_REG0_INT_SOURCE_0, tmp_data, 1);
+
+    tmp_data[ 0 ] = ICM42688_FIFOCONFIG_STREAM_TO_FIFO_MODE;
+    error_check |= icm42688_i2c_write(ICM42688_REG0_FIFO_CONFIG, tmp_data, 1);
+
+    tmp_data[ 0 ] = ICM42688_SPR_FIFO_FLUSH;
+    error_check |= icm42688_i2c_write(ICM42688_REG0_SIGNAL_PATH_RESET, tmp_data, 1);
+
+    return error_check;
+}
+
+
+IIC_ERR_CODE_E icm42688_fifo_count(uint16_t *count)
+{
+    uint8_t tmp_data[ 2 ];
+    IIC_ERR_CODE_E error_check;
+
+    // big endian after reset, reading the MSB first latches both
+    error_check = icm42688_i2c_read(ICM42688_REG0_FIFO_COUNT_MSB, tmp_data, 2);
+    *count = ( ( uint16_t )tmp_data[ 0 ] << 8 ) | tmp_data[ 1 ];
+
+    return error_check;
+}
+
+
+IIC_ERR_CODE_E icm42688_fifo_read(uint8_t *data_out, uint32_t len)
+{
+    uint8_t addr[1];
+
+    addr[0] = ICM42688_REG0_FIFO_DATA;
+    return hx_drv_i2cm_write_restart_read(USE_DW_IIC_0, ICM42688_I2C_ADDR, addr, 1, data_out, len);
+}
@@ -88,6 +88,49 @@ IIC_ERR_CODE_E icm42688_get_gyro_axis(icm42688_axis_t *axis);
 
 IIC_ERR_CODE_E icm42688_get_data(icm42688_axis_t *acc_axis, icm42688_axis_t *gyro_axis);
 
+/**
+ * @brief 6DOF IMU 14 FIFO and interrupt setup function.
+ * @details This function sets accel and gyro to the same ODR, streams
+ * accel, gyro and temperature packets ( 16 bytes ) into the FIFO and
+ * pulses INT1 ( push-pull, active high ) whenever the FIFO holds more than
+ * @b watermark bytes. The FIFO is flushed last. Call after icm42688_init().
+ * @param[in] odr : ICM42688_ACFG0_ODR_xxx, the same as ICM42688_GCFG0_ODR_xxx.
+ * @param[in] watermark : FIFO threshold in bytes, 1 to 2047.
+ * @return @li @c  0 - Success,
+ *         @li @c -1 - Error.
+ *
+ * See #IIC_ERR_CODE_E definition for detailed explanation.
+ * @note None.
+ */
+IIC_ERR_CODE_E icm42688_fifo_init(uint8_t odr, uint16_t watermark);
+
+/**
+ * @brief 6DOF IMU 14 FIFO count function.
+ * @details This function reads the number of bytes in the FIFO.
+ * @param[out] count : Bytes in the FIFO.
+ * @return @li @c  0 - Success,
+ *         @li @c -1 - Error.
+ *
+ * See #IIC_ERR_CODE_E definition for detailed explanation.
+ * @note None.
+ */
+IIC_ERR_CODE_E icm42688_fifo_count(uint16_t *count);
+
+/**
+ * @brief 6DOF IMU 14 FIFO burst read function.
+ * @details This function reads @b len bytes of FIFO_DATA in one I2C
+ * transfer. Packets are parsed by hx_icmfifo_parse(); reading past the
+ * FIFO count gives empty-FIFO headers.
+ * @param[out] data_out : Output read data.
+ * @param[in] len : Number of bytes to be read.
+ * @return @li @c  0 - Success,
+ *         @li @c -1 - Error.
+ *
+ * See #IIC_ERR_CODE_E definition for detailed explanation.
+ * @note None.
+ */
+IIC_ERR_CODE_E icm42688_fifo_read(uint8_t *data_out, uint32_t len);
+
 /**
  * @brief 6DOF IMU 14 USER BANK 0 register map summary.
  * @details The list of USER BANK 0 registers.
@@ -607,6 +650,26 @@ IIC_ERR_CODE_E icm42688_get_data(icm42688_axis_t *acc_axis, icm42688_axis_t *gyr
 #define ICM42688_DRIVECONFIG_MAX_SLEW_RATE        0x55
 #define ICM42688_DRIVECONFIG_MIN_SLEW_RATE        0x00
 
+/**
+ * @brief 6DOF IMU 14 INT CONFIG register settings.
+ * @details INT CONFIG register setting flags ( Default - 0x00 ).
+ */
+#define ICM42688_INTCONFIG_INT2_LATCHED            0x20
+#define ICM42688_INTCONFIG_INT2_PUSH_PULL          0x10
+#define ICM42688_INTCONFIG_INT2_ACTIVE_HIGH        0x08
+#define ICM42688_INTCONFIG_INT1_LATCHED            0x04
+#define ICM42688_INTCONFIG_INT1_PUSH_PULL          0x02
+#define ICM42688_INTCONFIG_INT1_ACTIVE_HIGH        0x01
+
+/**
+ * @brief 6DOF IMU 14 INT CONFIG 1 register settings.
+ * @details INT CONFIG 1 register setting flags ( Default - 0x10 ).
+ * INT_ASYNC_RESET has to be cleared for the INT1 and INT2 pins to work.
+ */
+#define ICM42688_INTCONFIG1_TPULSE_8US             0x40
+#define ICM42688_INTCONFIG1_TDEASSERT_DISABLE      0x20
+#define ICM42688_INTCONFIG1_ASYNC_RESET            0x10
+
 /**
  * @brief 6DOF IMU 14 FIFO CONFIG register settings.
  * @details FIFO CONFIG register setting flags.
@@ -620,6 +683,7 @@ IIC_ERR_CODE_E icm42688_get_data(icm42688_axis_t *acc_axis, icm42688_axis_t *gyr
  * @details FIFO CONFIG 1 register setting flags.
  */
 #define ICM42688_FIFOCONFIG1_RESUME_PARTIAL_RD     0x40
+#define ICM42688_FIFOCONFIG1_WM_GT_TH              0x20
 #define ICM42688_FIFOCONFIG1_HIRES_EN              0x10
 #define ICM42688_FIFOCONFIG1_TMST_FSYNC_EN         0x08
 #define ICM42688_FIFOCONFIG1_TEMP_EN               0x04
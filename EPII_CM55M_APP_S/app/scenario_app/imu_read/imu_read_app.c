@@ -24,24 +24,100 @@
 #endif
 #endif
 
+#include "WE2_device.h"
+#include "WE2_core.h"
 #include "xprintf.h"
 #include "timer_interface.h"
 #include "hx_drv_scu.h"
 #include "hx_drv_iic.h"
+#include "hx_drv_gpio.h"
 #include "imu_read_app.h"
 #include "icm42688.h"
+#include "hx_icmfifo.h"
+#include "hx_imuact.h"
+
+static volatile uint32_t g_imu_int = 0;
+static uint8_t g_fifo_buf[IMU_READ_FIFO_BYTES + HX_ICMFIFO_PKT_MAX];
+static uint32_t g_fifo_held = 0;
+static hx_icm_sample g_samples[IMU_READ_FIFO_BYTES / 8 + 1];
+static hx_imuact g_act;
+
+#if IMU_READ_USE_INT1
+static void imu_int1_cb(uint8_t group, uint8_t aIndex)
+{
+	hx_drv_gpio_clr_int_status(AON_GPIO0);
+	g_imu_int = 1;
+}
+
+static void imu_int1_init(void)
+{
+	hx_drv_scu_set_PA0_pinmux(SCU_PA0_PINMUX_AON_GPIO0_0, 1);
+	hx_drv_gpio_set_int_type(AON_GPIO0, GPIO_IRQ_TRIG_TYPE_EDGE_RISING);
+	hx_drv_gpio_cb_register(AON_GPIO0, imu_int1_cb);
+	hx_drv_gpio_set_input(AON_GPIO0);
+	hx_drv_gpio_set_int_enable(AON_GPIO0, 1);
+}
+#endif
+
+static void imu_epoch_cb(void *arg, const hx_imuact_epoch *e)
+{
+	static const char *const level[] = { "rest", "light", "HEAVY" };
+
+	xprintf("%d.%03d s activity %d mg %s (%d samples without accel)\n",
+			e->end_ms / 1000, e->end_ms % 1000, e->mg, level[e->level], g_act.invalid);
+}
+
+static void imu_wait(void)
+{
+#if IMU_READ_USE_INT1
+	/* with PRIMASK set a pending interrupt still ends __WFI(), so INT1
+	 * cannot fire between the check and the sleep */
+	__disable_irq();
+	while ( !g_imu_int )
+	{
+		__WFI();
+		__enable_irq();
+		__disable_irq();
+	}
+	g_imu_int = 0;
+	__enable_irq();
+#else
+	hx_drv_timer_cm55x_delay_ms(IMU_READ_POLL_MS, TIMER_STATE_DC);
+#endif
+}
+
+/* one burst of what the FIFO holds; a packet cut at the end of a burst is
+ * kept for the next one */
+static IIC_ERR_CODE_E imu_drain(void)
+{
+	IIC_ERR_CODE_E i2c_err;
+	uint16_t count;
+	uint32_t n, used, len;
+
+	i2c_err = icm42688_fifo_count(&count);
+	if ( i2c_err != IIC_ERR_OK || count == 0 )
+		return i2c_err;
+	len = count > IMU_READ_FIFO_BYTES ? IMU_READ_FIFO_BYTES : count;
+
+	i2c_err = icm42688_fifo_read(g_fifo_buf + g_fifo_held, len);
+	if ( i2c_err != IIC_ERR_OK )
+		return i2c_err;
+
+	n = hx_icmfifo_parse(g_fifo_buf, g_fifo_held + len, g_samples,
+			sizeof(g_samples) / sizeof(g_samples[0]), &used);
+	hx_imuact_push(&g_act, g_samples, n);
+	g_fifo_held = g_fifo_held + len - used;
+	memmove(g_fifo_buf, g_fifo_buf + used, g_fifo_held);
+	return IIC_ERR_OK;
+}
 
 /*!
  * @brief Main function
  */
 int app_main(void) {
 
-	uint8_t wbuffer[6];
-	uint8_t rbuffer[128];
-	// uint8_t addr[2];
-	// uint32_t i, data_size = 6, r_size = 32;
 	IIC_ERR_CODE_E i2c_err;
-	icm42688_axis_t accel, gyro;
+	hx_imuact_cfg act_cfg;
 
 	xprintf("Start IMU Read App\n");
 
@@ -59,37 +135,26 @@ int app_main(void) {
 		return -1;
 	}
 
+	hx_imuact_default_cfg(&act_cfg, IMU_READ_ODR_HZ, IMU_READ_LSB_PER_G);
+	hx_imuact_init(&g_act, &act_cfg, imu_epoch_cb, NULL);
+
+#if IMU_READ_USE_INT1
+	imu_int1_init();
+#endif
+	if ( icm42688_fifo_init(ICM42688_ACFG0_ODR_100HZ, IMU_READ_FIFO_WM) != IIC_ERR_OK )
+	{
+		xprintf("icm42688_fifo_init() fail!\n");
+		return -1;
+	}
+	xprintf("FIFO at %d Hz, INT1 every %d bytes, light from %d mg, heavy from %d mg\n",
+			IMU_READ_ODR_HZ, IMU_READ_FIFO_WM, act_cfg.light_mg, act_cfg.heavy_mg);
+
 	while ( 1 )
 	{
-		i2c_err = icm42688_get_accel_axis(&accel);
-		if ( i2c_err != 0 )
-			xprintf("icm42688_get_accel_axis ERROR(%d)\n", i2c_err);
-
-		i2c_err = icm42688_get_gyro_axis(&gyro);
-		if ( i2c_err != 0 )
-			xprintf("icm42688_get_gyro_axis ERROR(%d)\n", i2c_err);
-
-		xprintf("accel x = 0x%x(%d)\n", accel.x, accel.x);
-		xprintf("accel y = 0x%x(%d)\n", accel.y, accel.y);
-		xprintf("accel z = 0x%x(%d)\n", accel.z, accel.z);
-		xprintf("gyro  x = 0x%x(%d)\n", gyro.x, gyro.x);
-		xprintf("gyro  y = 0x%x(%d)\n", gyro.y, gyro.y);
-		xprintf("gyro  z = 0x%x(%d)\n", gyro.z, gyro.y);
-		xprintf("----------------------------------------\n");
-
-		i2c_err = icm42688_get_data(&accel, &gyro);
-		if ( i2c_err != 0 )
-			xprintf("icm42688_get_data ERROR(%d)\n", i2c_err);
-
-		xprintf("FIFO accel x = 0x%x(%d)\n", accel.x, accel.x);
-		xprintf("FIFO accel y = 0x%x(%d)\n", accel.y, accel.y);
-		xprintf("FIFO accel z = 0x%x(%d)\n", accel.z, accel.z);
-		xprintf("FIFO gyro  x = 0x%x(%d)\n", gyro.x, gyro.x);
-		xprintf("FIFO gyro  y = 0x%x(%d)\n", gyro.y, gyro.y);
-		xprintf("FIFO gyro  z = 0x%x(%d)\n", gyro.z, gyro.y);
-		xprintf("----------------------------------------\n");
-
-		hx_drv_timer_cm55x_delay_ms(100, TIMER_STATE_DC);
+		imu_wait();
+		i2c_err = imu_drain();
+		if ( i2c_err != IIC_ERR_OK )
+			xprintf("imu_drain ERROR(%d)\n", i2c_err);
 	}
 	return 0;
 }
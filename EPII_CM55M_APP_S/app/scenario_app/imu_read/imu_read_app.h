@@ -8,6 +8,17 @@
 #ifndef APP_SCENARIO_IMU_READ_APP_
 #define APP_SCENARIO_IMU_READ_APP_
 
+/* FIFO packets of accel, gyro and temperature, both sensors at 100 Hz */
+#define IMU_READ_ODR_HZ		100
+#define IMU_READ_LSB_PER_G	2048	/* +-16 g */
+/* INT1 every 25 packets, 250 ms; the FIFO holds 2 KB, 1.28 s */
+#define IMU_READ_FIFO_WM	(16 * 25)
+#define IMU_READ_FIFO_BYTES	2048
+/* 1: INT1 on PA0 (AON_GPIO0) wakes the CPU, 0: FIFO_COUNT polled every
+ * IMU_READ_POLL_MS, for boards without INT1 wired */
+#define IMU_READ_USE_INT1	1
+#define IMU_READ_POLL_MS	250
+
 #define APP_BLOCK_FUNC() do{ \
 	__asm volatile("b    .");\
 	}while(0)
@@ -10,7 +10,7 @@ EVENTHANDLER_SUPPORT =
 # Add new library here
 # The source code should be loacted in ~\library\{lib_name}\
 ##
-LIB_SEL = pwrmgmt spi_ptl spi_eeprom hxevent
+LIB_SEL = pwrmgmt spi_ptl spi_eeprom hxevent imuact
 
 ##
 # middleware support feature
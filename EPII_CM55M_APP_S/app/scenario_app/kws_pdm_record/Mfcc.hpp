@@ -30,6 +30,8 @@ namespace arm {
 namespace app {
 namespace audio {
 
+    class MfccEngine;
+
     /* MFCC's consolidated parameters. */
     class MfccParams {
     public:
@@ -151,6 +153,9 @@ namespace audio {
         static constexpr float ms_minLogHz = 1000.0;
         static constexpr float ms_minLogMel = ms_minLogHz / ms_freqStep;
 
+        /* Builds the same filter bank with MelScale(). */
+        friend class MfccEngine;
+
 
     protected:
         /**
@@ -0,0 +1,366 @@
+#include "MfccEngine.hpp"
+#include "PlatformMath.hpp"
+#include "log_macros.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+
+#if defined(__ARM_FEATURE_MVE) && (__ARM_FEATURE_MVE & 2)
+#include <arm_mve.h>
+#define MFCC_ENGINE_HELIUM 1
+#else
+#define MFCC_ENGINE_HELIUM 0
+#endif
+
+namespace arm {
+namespace app {
+namespace audio {
+
+    bool MfccEngine::Init(const MfccParams& params)
+    {
+        this->m_initialised = false;
+
+        if (params.m_frameLen == 0 ||
+                params.m_frameLenPadded > ms_maxFftLen ||
+                params.m_numFbankBins == 0 ||
+                params.m_numFbankBins > ms_maxFbankBins ||
+                params.m_numMfccFeatures == 0 ||
+                params.m_numMfccFeatures > ms_maxMfccFeatures) {
+            printf_err("MFCC engine sizes out of range\n");
+            return false;
+        }
+
+        this->m_frameLen = params.m_frameLen;
+        this->m_fftLen = params.m_frameLenPadded;
+        this->m_numFbankBins = params.m_numFbankBins;
+        this->m_numMfccFeatures = params.m_numMfccFeatures;
+
+        /* Same Hann window as the MFCC constructor. */
+        const auto multiplier = static_cast<float>(2 * M_PI / this->m_frameLen);
+        for (size_t i = 0; i < this->m_frameLen; i++) {
+            this->m_windowFunc[i] = (0.5 - (0.5 *
+                math::MathUtils::CosineF32(static_cast<float>(i) * multiplier)));
+        }
+
+        if (!this->CreateMelFilterBank(params)) {
+            return false;
+        }
+
+        /* Same DCT as MFCC::CreateDCTMatrix(), stored transposed. */
+        const int32_t inputLength = this->m_numFbankBins;
+        const float normalizer = math::MathUtils::SqrtF32(2.0f/inputLength);
+        const float angleIncr = M_PI/inputLength;
+        float angle = 0;
+
+        for (uint32_t k = 0; k < this->m_numMfccFeatures; k++) {
+            for (int32_t n = 0; n < inputLength; n++) {
+                this->m_dctMatrixT[n * this->m_numMfccFeatures + k] = normalizer *
+                    math::MathUtils::CosineF32((n + 0.5f) * angle);
+            }
+            angle += angleIncr;
+        }
+
+        math::MathUtils::FftInitF32(this->m_fftLen, this->m_fftInstance);
+        if (!this->m_fftInstance.m_initialised) {
+            return false;
+        }
+
+        params.Log();
+        this->m_initialised = true;
+        return true;
+    }
+
+    bool MfccEngine::CreateMelFilterBank(const MfccParams& params)
+    {
+        const size_t numFftBins = this->m_fftLen / 2;
+        const float fftBinWidth = static_cast<float>(params.m_samplingFreq) / params.m_frameLenPadded;
+
+        const float melLowFreq = MFCC::MelScale(params.m_melLoFreq, params.m_useHtkMethod);
+        const float melHighFreq = MFCC::MelScale(params.m_melHiFreq, params.m_useHtkMethod);
+        const float melFreqDelta = (melHighFreq - melLowFreq) / (params.m_numFbankBins + 1);
+
+        uint32_t numWeights = 0;
+        this->m_spectrumFirst = numFftBins;
+        this->m_spectrumLast = 0;
+
+        for (size_t bin = 0; bin < this->m_numFbankBins; bin++) {
+            const float leftMel = melLowFreq + bin * melFreqDelta;
+            const float centerMel = melLowFreq + (bin + 1) * melFreqDelta;
+            const float rightMel = melLowFreq + (bin + 2) * melFreqDelta;
+
+            uint32_t firstIndex = 0;
+            uint32_t lastIndex = 0;
+            bool firstIndexFound = false;
+
+            for (size_t i = 0; i < numFftBins; i++) {
+                const float freq = (fftBinWidth * i);  /* Center freq of this fft bin. */
+                const float mel = MFCC::MelScale(freq, params.m_useHtkMethod);
+
+                if (mel > leftMel && mel < rightMel) {
+                    if (!firstIndexFound) {
+                        firstIndex = i;
+                        firstIndexFound = true;
+                    }
+                    lastIndex = i;
+                }
+            }
+
+            /* An empty triangle keeps one zero weight at bin 0, like the
+             * 2D filter bank of MFCC. */
+            const uint32_t len = lastIndex - firstIndex + 1;
+            if (numWeights + len > ms_maxFilterWeights) {
+                printf_err("MFCC engine filter bank too large\n");
+                return false;
+            }
+
+            for (uint32_t i = firstIndex; i <= lastIndex; i++) {
+                const float mel = MFCC::MelScale(fftBinWidth * i, params.m_useHtkMethod);
+                float weight = 0.f;
+
+                if (mel > leftMel && mel < rightMel) {
+                    if (mel <= centerMel) {
+                        weight = (mel - leftMel) / (centerMel - leftMel);
+                    } else {
+                        weight = (rightMel - mel) / (rightMel - centerMel);
+                    }
+                }
+                this->m_filterWeights[numWeights + i - firstIndex] = weight;
+            }
+
+            this->m_filterFirst[bin] = firstIndex;
+            this->m_filterLen[bin] = len;
+            this->m_filterOffset[bin] = numWeights;
+            numWeights += len;
+
+            this->m_spectrumFirst = std::min<uint32_t>(this->m_spectrumFirst, firstIndex);
+            this->m_spectrumLast = std::max<uint32_t>(this->m_spectrumLast, lastIndex);
+        }
+
+        debug("MFCC engine filter bank: %" PRIu32 " weights, FFT bins %" PRIu32 "..%" PRIu32 "\n",
+              numWeights, this->m_spectrumFirst, this->m_spectrumLast);
+        return true;
+    }
+
+    void MfccEngine::ComputeFeatures(const int16_t* audioData)
+    {
+        /* TensorFlow way of normalizing .wav data to (-1, 1), then the window. */
+        constexpr float normaliser = 1.0/32768.0;
+        size_t i = 0;
+#if MFCC_ENGINE_HELIUM
+        for (; i + 4 <= this->m_frameLen; i += 4) {
+            float32x4_t x = vcvtq_f32_s32(vldrhq_s32(audioData + i));
+            x = vmulq_n_f32(x, normaliser);
+            vst1q_f32(this->m_frame + i, vmulq_f32(x, vld1q_f32(this->m_windowFunc + i)));
+        }
+#endif
+        for (; i < this->m_frameLen; i++) {
+            this->m_frame[i] = static_cast<float>(audioData[i]) * normaliser;
+            this->m_frame[i] *= this->m_windowFunc[i];
+        }
+        std::memset(this->m_frame + this->m_frameLen, 0,
+                    (this->m_fftLen - this->m_frameLen) * sizeof(float));
+
+        math::MathUtils::FftF32(this->m_frame, this->m_buffer, this->m_fftInstance);
+
+        /* Magnitudes of the bins read by the filter bank, into m_frame.
+         * m_buffer holds [real0, realN/2, real1, im1, ...]. */
+        float* magnitude = this->m_frame;
+        uint32_t k = this->m_spectrumFirst;
+        if (k == 0) {
+            magnitude[0] = this->m_buffer[0] * this->m_buffer[0];
+            k = 1;
+        }
+#if MFCC_ENGINE_HELIUM
+        for (; k + 4 <= this->m_spectrumLast + 1; k += 4) {
+            float32x4x2_t c = vld2q_f32(this->m_buffer + 2 * k);
+            vst1q_f32(magnitude + k, vaddq_f32(vmulq_f32(c.val[0], c.val[0]),
+                                               vmulq_f32(c.val[1], c.val[1])));
+        }
+#endif
+        for (; k <= this->m_spectrumLast; k++) {
+            const float real = this->m_buffer[2 * k];
+            const float im = this->m_buffer[2 * k + 1];
+            magnitude[k] = real*real + im*im;
+        }
+        for (k = this->m_spectrumFirst; k <= this->m_spectrumLast; k++) {
+            magnitude[k] = math::MathUtils::SqrtF32(magnitude[k]);
+        }
+
+        /* Apply the sparse mel filter bank and convert to logarithmic scale. */
+        for (uint32_t bin = 0; bin < this->m_numFbankBins; bin++) {
+            const float* weights = this->m_filterWeights + this->m_filterOffset[bin];
+            const float* energy = magnitude + this->m_filterFirst[bin];
+            const uint32_t len = this->m_filterLen[bin];
+            float melEnergy = FLT_MIN;  /* Avoid log of zero at later stages */
+#if MFCC_ENGINE_HELIUM
+            float32x4_t acc = vdupq_n_f32(0.f);
+            for (uint32_t j = 0; j < len; j += 4) {
+                mve_pred16_t p = vctp32q(len - j);
+                acc = vfmaq_f32(acc, vldrwq_z_f32(weights + j, p), vldrwq_z_f32(energy + j, p));
+            }
+            melEnergy += (vgetq_lane_f32(acc, 0) + vgetq_lane_f32(acc, 1)) +
+                         (vgetq_lane_f32(acc, 2) + vgetq_lane_f32(acc, 3));
+#else
+            for (uint32_t j = 0; j < len; j++) {
+                melEnergy += (weights[j] * energy[j]);
+            }
+#endif
+            this->m_melEnergies[bin] = logf((melEnergy > 1e-12)?melEnergy : 1e-12);
+        }
+
+        /* Take DCT, all coefficients at once from the transposed matrix. */
+        const uint32_t numFeats = this->m_numMfccFeatures;
+#if MFCC_ENGINE_HELIUM
+        for (uint32_t c = 0; c < numFeats; c += 4) {
+            mve_pred16_t p = vctp32q(numFeats - c);
+            const float* dct = this->m_dctMatrixT + c;
+            float32x4_t sum = vdupq_n_f32(0.f);
+            for (uint32_t n = 0; n < this->m_numFbankBins; n++, dct += numFeats) {
+                sum = vfmaq_n_f32(sum, vldrwq_z_f32(dct, p), this->m_melEnergies[n]);
+            }
+            vstrwq_p_f32(this->m_mfcc + c, sum, p);
+        }
+#else
+        std::memset(this->m_mfcc, 0, numFeats * sizeof(float));
+        const float* dct = this->m_dctMatrixT;
+        for (uint32_t n = 0; n < this->m_numFbankBins; n++, dct += numFeats) {
+            const float mel = this->m_melEnergies[n];
+            for (uint32_t c = 0; c < numFeats; c++) {
+                this->m_mfcc[c] += dct[c] * mel;
+            }
+        }
+#endif
+    }
+
+    void MfccEngine::MfccCompute(const int16_t* audioData, float* mfccOut)
+    {
+        if (!this->m_initialised) {
+            printf_err("MFCC engine uninitialised\n");
+            return;
+        }
+        this->ComputeFeatures(audioData);
+        std::memcpy(mfccOut, this->m_mfcc, this->m_numMfccFeatures * sizeof(float));
+    }
+
+    void MfccEngine::MfccComputeQuant(const int16_t* audioData,
+                                      const float quantScale,
+                                      const int quantOffset,
+                                      int8_t* mfccOut)
+    {
+        if (!this->m_initialised) {
+            printf_err("MFCC engine uninitialised\n");
+            return;
+        }
+        this->ComputeFeatures(audioData);
+
+        for (uint32_t i = 0; i < this->m_numMfccFeatures; i++) {
+            float sum = std::round((this->m_mfcc[i] / quantScale) + quantOffset);
+            mfccOut[i] = static_cast<int8_t>(std::min<float>(std::max<float>(sum, -128), 127));
+        }
+    }
+
+    bool MfccFeatureStream::Init(MfccEngine* engine, const uint32_t frameStride,
+                                 const uint32_t numRows, const float quantScale,
+                                 const int quantOffset)
+    {
+        if (engine == nullptr || engine->FrameLen() == 0 ||
+                frameStride == 0 || frameStride > engine->FrameLen() ||
+                numRows == 0 || numRows > ms_maxRows) {
+            printf_err("MFCC feature stream sizes out of range\n");
+            return false;
+        }
+
+        this->m_engine = engine;
+        this->m_frameLen = engine->FrameLen();
+        this->m_frameStride = frameStride;
+        this->m_numRows = numRows;
+        this->m_rowSize = engine->NumMfccFeatures();
+        this->m_quantScale = quantScale;
+        this->m_quantOffset = quantOffset;
+        this->Reset();
+        return true;
+    }
+
+    void MfccFeatureStream::Reset()
+    {
+        this->m_rowNext = 0;
+        this->m_rowsTotal = 0;
+        this->m_pendingLen = 0;
+    }
+
+    void MfccFeatureStream::AddRow(const int16_t* frame)
+    {
+        this->m_engine->MfccComputeQuant(frame, this->m_quantScale, this->m_quantOffset,
+                                         this->m_rows + this->m_rowNext * this->m_rowSize);
+        if (++this->m_rowNext == this->m_numRows) {
+            this->m_rowNext = 0;
+        }
+        if (this->m_rowsTotal < this->m_numRows) {
+            this->m_rowsTotal++;
+        }
+    }
+
+    uint32_t MfccFeatureStream::Push(const int16_t* audioData, const uint32_t numSamples)
+    {
+        if (this->m_engine == nullptr) {
+            printf_err("MFCC feature stream uninitialised\n");
+            return 0;
+        }
+
+        /* Sample positions count from the first pending sample. */
+        const uint32_t available = this->m_pendingLen + numSamples;
+        uint32_t numFrames = 0;
+        if (available >= this->m_frameLen) {
+            numFrames = (available - this->m_frameLen) / this->m_frameStride + 1;
+        }
+
+        /* Frames that would be overwritten within this push are skipped. */
+        uint32_t skip = 0;
+        if (numFrames > this->m_numRows) {
+            skip = numFrames - this->m_numRows;
+            this->m_rowNext = (this->m_rowNext + skip) % this->m_numRows;
+        }
+
+        uint32_t start = skip * this->m_frameStride;
+        for (uint32_t f = skip; f < numFrames; f++, start += this->m_frameStride) {
+            if (start >= this->m_pendingLen) {
+                this->AddRow(audioData + (start - this->m_pendingLen));
+            } else {
+                const uint32_t fromPending = this->m_pendingLen - start;
+                std::memcpy(this->m_staging, this->m_pending + start, fromPending * sizeof(int16_t));
+                std::memcpy(this->m_staging + fromPending, audioData,
+                            (this->m_frameLen - fromPending) * sizeof(int16_t));
+                this->AddRow(this->m_staging);
+            }
+        }
+
+        /* Keep the samples from the next frame start on; fewer than m_frameLen. */
+        if (start < this->m_pendingLen) {
+            const uint32_t kept = this->m_pendingLen - start;
+            std::memmove(this->m_pending, this->m_pending + start, kept * sizeof(int16_t));
+            std::memcpy(this->m_pending + kept, audioData, numSamples * sizeof(int16_t));
+            this->m_pendingLen = kept + numSamples;
+        } else {
+            const uint32_t used = start - this->m_pendingLen;
+            this->m_pendingLen = numSamples - used;
+            std::memcpy(this->m_pending, audioData + used, this->m_pendingLen * sizeof(int16_t));
+        }
+
+        return numFrames - skip;
+    }
+
+    void MfccFeatureStream::CopyTo(int8_t* dst) const
+    {
+        /* Once full, the oldest row is the next one to be written. */
+        const uint32_t oldest = (this->m_rowsTotal < this->m_numRows) ? 0 : this->m_rowNext;
+        const size_t head = (this->m_numRows - oldest) * this->m_rowSize;
+
+        std::memcpy(dst, this->m_rows + oldest * this->m_rowSize, head);
+        std::memcpy(dst + head, this->m_rows, oldest * this->m_rowSize);
+    }
+
+} /* namespace audio */
+} /* namespace app */
+} /* namespace arm */
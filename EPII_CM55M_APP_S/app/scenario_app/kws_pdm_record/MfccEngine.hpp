@@ -0,0 +1,177 @@
+#ifndef KWS_MFCC_ENGINE_HPP
+#define KWS_MFCC_ENGINE_HPP
+
+#include "Mfcc.hpp"
+#include "PlatformMath.hpp"
+
+#include <cstdint>
+
+namespace arm {
+namespace app {
+namespace audio {
+
+    /**
+     * @brief   MFCC feature extraction with every table built once.
+     *          Computes the same features as MFCC::MfccCompute() and
+     *          MfccComputeQuant(), but:
+     *          - the mel filter bank keeps only the non-zero weights of all
+     *            bins in one flat array, with a first FFT bin, a length and
+     *            an offset per bin,
+     *          - the DCT matrix is stored transposed so that all
+     *            coefficients are accumulated together,
+     *          - frames are read from int16 pointers, e.g. straight from
+     *            the PDM DMA buffer, and nothing is allocated after Init().
+     *          On Cortex-M55 windowing, power spectrum, filter bank and DCT
+     *          use Helium; the FFT is arm_rfft_fast_f32().
+     */
+    class MfccEngine {
+    public:
+        /* Static storage for MicroNet KWS sizes: 480 sample frames, 40 bins and features. */
+        static constexpr uint32_t ms_maxFftLen        = 512;
+        static constexpr uint32_t ms_maxFbankBins     = 40;
+        static constexpr uint32_t ms_maxMfccFeatures  = 40;
+        /* The triangles only overlap their neighbours, so every FFT bin
+         * has at most two weights. */
+        static constexpr uint32_t ms_maxFilterWeights = ms_maxFftLen;
+
+        MfccEngine() = default;
+        ~MfccEngine() = default;
+
+        /**
+         * @brief       Builds the window, filter bank, DCT and FFT tables.
+         * @param[in]   params   MFCC parameters, see MfccParams.
+         * @return      true if successful, false if a size is above the
+         *              ms_max* limits.
+         */
+        bool Init(const MfccParams& params);
+
+        /**
+         * @brief       Extract MFCC features for one frame.
+         * @param[in]   audioData   m_frameLen audio samples.
+         * @param[out]  mfccOut     m_numMfccFeatures features.
+         */
+        void MfccCompute(const int16_t* audioData, float* mfccOut);
+
+        /**
+         * @brief       Extract MFCC features for one frame and quantise
+         *              them to int8 like MFCC::MfccComputeQuant<int8_t>().
+         * @param[in]   audioData     m_frameLen audio samples.
+         * @param[in]   quantScale    Quantisation scale.
+         * @param[in]   quantOffset   Quantisation offset.
+         * @param[out]  mfccOut       m_numMfccFeatures features.
+         */
+        void MfccComputeQuant(const int16_t* audioData,
+                              float quantScale,
+                              int quantOffset,
+                              int8_t* mfccOut);
+
+        uint32_t FrameLen() const { return m_frameLen; }
+        uint32_t NumMfccFeatures() const { return m_numMfccFeatures; }
+
+    private:
+        uint32_t    m_frameLen{0};
+        uint32_t    m_fftLen{0};
+        uint32_t    m_numFbankBins{0};
+        uint32_t    m_numMfccFeatures{0};
+        uint32_t    m_spectrumFirst{0};     /* FFT bins read by the filter bank */
+        uint32_t    m_spectrumLast{0};
+        bool        m_initialised{false};
+
+        float       m_windowFunc[ms_maxFftLen];
+        float       m_frame[ms_maxFftLen];
+        float       m_buffer[ms_maxFftLen];
+        float       m_melEnergies[ms_maxFbankBins];
+        float       m_mfcc[ms_maxMfccFeatures];
+
+        uint16_t    m_filterFirst[ms_maxFbankBins];
+        uint16_t    m_filterLen[ms_maxFbankBins];
+        uint16_t    m_filterOffset[ms_maxFbankBins];
+        float       m_filterWeights[ms_maxFilterWeights];
+
+        /* m_dctMatrixT[n * m_numMfccFeatures + k] is MFCC's m_dctMatrix[k * m_numFbankBins + n] */
+        float       m_dctMatrixT[ms_maxFbankBins * ms_maxMfccFeatures];
+
+        arm::app::math::FftInstance m_fftInstance;
+
+        /** @brief  Builds the sparse mel filter bank, same weights as MFCC::CreateMelFilterBank(). */
+        bool CreateMelFilterBank(const MfccParams& params);
+
+        /** @brief  Window, FFT, filter bank and log; leaves the DCT output in m_mfcc. */
+        void ComputeFeatures(const int16_t* audioData);
+    };
+
+    /**
+     * @brief   Keeps the MFCC features of the last numRows frames of an
+     *          audio stream. Push() takes the samples as they arrive and
+     *          only computes the frames completed by them: frames that are
+     *          fully inside the pushed block are read in place, the few
+     *          that start in the previous block go through a frameLen
+     *          sample staging buffer.
+     *          With a 480 sample frame, a 160 sample stride and 98 rows,
+     *          pushing 8000 samples at a time gives exactly the features of
+     *          the last 16000 samples, so every push after the first two
+     *          computes 50 new rows instead of 98.
+     */
+    class MfccFeatureStream {
+    public:
+        static constexpr uint32_t ms_maxRows = 100;
+
+        MfccFeatureStream() = default;
+        ~MfccFeatureStream() = default;
+
+        /**
+         * @brief       Sets the frame stride, row count and int8 quantisation.
+         * @param[in]   engine        Initialised engine; kept by pointer.
+         * @param[in]   frameStride   Samples between two frames, 1 .. frame length.
+         * @param[in]   numRows       Rows given by CopyTo().
+         * @param[in]   quantScale    Quantisation scale of the model input.
+         * @param[in]   quantOffset   Quantisation offset of the model input.
+         * @return      true if successful, false if a size is out of range.
+         */
+        bool Init(MfccEngine* engine, uint32_t frameStride, uint32_t numRows,
+                  float quantScale, int quantOffset);
+
+        /** @brief  Drops all samples and rows, e.g. after missing audio. */
+        void Reset();
+
+        /**
+         * @brief       Computes the features of every frame completed by
+         *              the next numSamples samples of the stream.
+         * @return      Number of new rows.
+         */
+        uint32_t Push(const int16_t* audioData, uint32_t numSamples);
+
+        /** @brief  true once numRows rows have been computed since Reset(). */
+        bool Ready() const { return m_rowsTotal >= m_numRows; }
+
+        /**
+         * @brief       Copies the last numRows rows, oldest first, to dst,
+         *              e.g. the model input tensor.
+         */
+        void CopyTo(int8_t* dst) const;
+
+    private:
+        MfccEngine* m_engine{nullptr};
+        uint32_t    m_frameLen{0};
+        uint32_t    m_frameStride{0};
+        uint32_t    m_numRows{0};
+        uint32_t    m_rowSize{0};
+        float       m_quantScale{1.f};
+        int         m_quantOffset{0};
+
+        uint32_t    m_rowNext{0};           /* row written by the next frame */
+        uint32_t    m_rowsTotal{0};
+        uint32_t    m_pendingLen{0};        /* samples kept from earlier pushes */
+
+        int16_t     m_pending[MfccEngine::ms_maxFftLen];
+        int16_t     m_staging[MfccEngine::ms_maxFftLen];
+        int8_t      m_rows[ms_maxRows * MfccEngine::ms_maxMfccFeatures];
+
+        void AddRow(const int16_t* frame);
+    };
+
+} /* namespace audio */
+} /* namespace app */
+} /* namespace arm */
+
+#endif /* KWS_MFCC_ENGINE_HPP */
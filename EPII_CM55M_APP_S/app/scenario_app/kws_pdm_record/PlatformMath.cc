@@ -132,11 +132,10 @@ namespace math {
         fftInstance.m_initialised = true;
     }
 
-    static void FftRealF32(std::vector<float>& input,
-                           std::vector<float>& fftOutput)
+    static void FftRealF32(const float* input, const size_t inputLength,
+                           float* fftOutput)
     {
-        const size_t inputLength = input.size();
-        const size_t halfLength = input.size() / 2;
+        const size_t halfLength = inputLength / 2;
 
         fftOutput[0] = 0;
         fftOutput[1] = 0;
@@ -209,7 +208,7 @@ namespace math {
                 return;
             }
 #endif /* ARM_MATH_DSP */
-            FftRealF32(input, fftOutput);
+            FftRealF32(input.data(), input.size(), fftOutput.data());
             return;
 
         case FftType::complex:
@@ -233,6 +232,27 @@ namespace math {
         }
     }
 
+    void MathUtils::FftF32(float* input,
+                           float* fftOutput,
+                           arm::app::math::FftInstance& fftInstance)
+    {
+        if (!fftInstance.m_initialised) {
+            printf_err("FFT uninitialised\n");
+            return;
+        } else if (fftInstance.m_type != FftType::real) {
+            printf_err("Only real FFT instances take raw buffers\n");
+            return;
+        }
+
+#if ARM_MATH_DSP
+        if (fftInstance.m_optimisedOptionAvailable) {
+            arm_rfft_fast_f32(&fftInstance.m_instanceReal, input, fftOutput, 0);
+            return;
+        }
+#endif /* ARM_MATH_DSP */
+        FftRealF32(input, fftInstance.m_fftLen, fftOutput);
+    }
+
     void MathUtils::VecLogarithmF32(std::vector <float>& input,
                                     std::vector <float>& output)
     {
@@ -119,6 +119,19 @@ namespace math {
                            std::vector<float>& fftOutput,
                            FftInstance& fftInstance);
 
+        /**
+         * @brief       Computes the real FFT of fftInstance.m_fftLen elements
+         *              in place of caller owned buffers.
+         * @param[in]   input       m_fftLen input elements. The ARM DSP
+         *                          version uses them as scratch.
+         * @param[out]  fftOutput   m_fftLen output elements, packed like
+         *                          the vector version.
+         * @param[in]   fftInstance Real FFT instance struct to use.
+         */
+        static void FftF32(float* input,
+                           float* fftOutput,
+                           FftInstance& fftInstance);
+
         /**
          * @brief       Computes the natural logarithms of input floating point
          *              vector
@@ -16,6 +16,7 @@
 
 #include "TensorFlowLiteMicro.hpp"
 #include "MicroNetKwsMfcc.hpp"
+#include "MfccEngine.hpp"
 #include "AudioUtils.hpp"
 #include "common_config.h"
 
@@ -79,15 +80,30 @@ uint8_t tensor_arena[tensor_arena_size];
 struct ethosu_driver ethosu_drv; /* Default Ethos-U device driver */
 tflite::MicroInterpreter *kws_int_ptr=nullptr;
 TfLiteTensor *kws_input, *kws_output;
-};
 
-struct MyClassificationResult {
-    float normalisedVal = 0.f;
-    std::string label;
-    uint32_t labelIdx = 0;
+/* MFCC tables are built once in cv_kws_init(); the feature stream keeps the
+ * rows of the last kNumRows frames between the audio blocks. */
+arm::app::audio::MfccEngine kws_mfcc;
+arm::app::audio::MfccFeatureStream kws_features;
 };
 
-std::vector<std::string> kwtLabels = {"_silence_", "_unknown_", "yes", "no", "up", "down", "left", "right", "on", "off", "stop", "go"};
+/*
+ * Posterior smoothing: the model runs on a 1 second window every block, so a
+ * keyword is seen by several overlapping windows. The softmax outputs of the
+ * last KWS_SMOOTH_WINDOWS windows are averaged and a keyword is reported when
+ * the average is above threshold; the next KWS_SUPPRESS_WINDOWS windows then
+ * report nothing, so one utterance gives one detection.
+ */
+#define KWS_NUM_LABELS          12
+#define KWS_SMOOTH_WINDOWS      3
+#define KWS_SUPPRESS_WINDOWS    4
+#define KWS_FIRST_KEYWORD       2       /* labels below are _silence_ and _unknown_ */
+
+static const char *const kwtLabels[KWS_NUM_LABELS] = {"_silence_", "_unknown_", "yes", "no", "up", "down", "left", "right", "on", "off", "stop", "go"};
+
+static float kws_posteriors[KWS_SMOOTH_WINDOWS][KWS_NUM_LABELS];
+static uint32_t kws_num_windows = 0;       /* windows since the last reset */
+static uint32_t kws_suppress = 0;
 
 
 static void _arm_npu_irq_handler(void)
@@ -199,271 +215,109 @@ int cv_kws_init(bool security_enable, bool privilege_enable, uint32_t model_addr
 		kws_int_ptr = &kws_static_interpreter;
 		kws_input = kws_static_interpreter.input(0);
         kws_output = kws_static_interpreter.output(0);
+
+        if (kws_input->type != kTfLiteInt8 || kws_input->quantization.type != kTfLiteAffineQuantization) {
+            xprintf("Tensor type %s not supported\n", TfLiteTypeGetName(kws_input->type));
+            return -1;
+        }
+        auto *quantParams = (TfLiteAffineQuantization *) kws_input->quantization.params;
+
+        if (!kws_mfcc.Init(arm::app::audio::MfccParams(
+                arm::app::audio::MicroNetKwsMFCC::ms_defaultSamplingFreq,
+                arm::app::audio::MicroNetKwsMFCC::ms_defaultNumFbankBins,
+                arm::app::audio::MicroNetKwsMFCC::ms_defaultMelLoFreq,
+                arm::app::audio::MicroNetKwsMFCC::ms_defaultMelHiFreq,
+                kNumCols, frameLength,
+                arm::app::audio::MicroNetKwsMFCC::ms_defaultUseHtkMethod)) ||
+            !kws_features.Init(&kws_mfcc, frameStride, kNumRows,
+                quantParams->scale->data[0], quantParams->zero_point->data[0])) {
+            xprintf("Failed to initialise MFCC\n");
+            return -1;
+        }
 	}
 
 	xprintf("initial done\n");
 	return ercode;
 }
 
-template<class T>
-std::function<void (std::vector<int16_t>&, size_t, bool, size_t)>
-FeatureCalc(TfLiteTensor* inputTensor, size_t cacheSize,
-            std::function<std::vector<T> (std::vector<int16_t>& )> compute)
-{
-    /* Feature cache to be captured by lambda function. */
-    static std::vector<std::vector<T>> featureCache = std::vector<std::vector<T>>(cacheSize);
-
-    return [=](std::vector<int16_t>& audioDataWindow,
-                                    size_t index,
-                                    bool useCache,
-                                    size_t featuresOverlapIndex)
-    {
-        T *tensorData = tflite::GetTensorData<T>(inputTensor);
-        std::vector<T> features;
-
-        /* Reuse features from cache if cache is ready and sliding windows overlap.
-            * Overlap is in the beginning of sliding window with a size of a feature cache. */
-        if (useCache && index < featureCache.size()) {
-            features = std::move(featureCache[index]);
-        } else {
-            features = std::move(compute(audioDataWindow));
-        }
-        auto size = features.size();
-        auto sizeBytes = sizeof(T) * size;
-        std::memcpy(tensorData + (index * size), features.data(), sizeBytes);
-
-        /* Start renewing cache as soon iteration goes out of the windows overlap. */
-        if (index >= featuresOverlapIndex) {
-            featureCache[index - featuresOverlapIndex] = std::move(features);
-        }
-    };
-}
-
-template std::function<void (std::vector<int16_t>&, size_t , bool, size_t)>
-    FeatureCalc<int8_t>(TfLiteTensor* inputTensor,
-                        size_t cacheSize,
-                        std::function<std::vector<int8_t> (std::vector<int16_t>& )> compute);
-
-template std::function<void (std::vector<int16_t>&, size_t , bool, size_t)>
-    FeatureCalc<uint8_t>(TfLiteTensor* inputTensor,
-                            size_t cacheSize,
-                            std::function<std::vector<uint8_t> (std::vector<int16_t>& )> compute);
-
-template std::function<void (std::vector<int16_t>&, size_t , bool, size_t)>
-    FeatureCalc<int16_t>(TfLiteTensor* inputTensor,
-                            size_t cacheSize,
-                            std::function<std::vector<int16_t> (std::vector<int16_t>& )> compute);
-
-template std::function<void(std::vector<int16_t>&, size_t, bool, size_t)>
-    FeatureCalc<float>(TfLiteTensor* inputTensor,
-                        size_t cacheSize,
-                        std::function<std::vector<float>(std::vector<int16_t>&)> compute);
-
-
-
-static std::function<void (std::vector<int16_t>&, int, bool, size_t)>
-GetFeatureCalculator(arm::app::audio::MicroNetKwsMFCC& mfcc, TfLiteTensor* inputTensor, size_t cacheSize)
+/* Dequantises the output tensor into posteriors[] and applies softmax in place. */
+static bool kws_get_posteriors(TfLiteTensor *outputTensor, float *posteriors)
 {
-    std::function<void (std::vector<int16_t>&, size_t, bool, size_t)> mfccFeatureCalc;
-
-    TfLiteQuantization quant = inputTensor->quantization;
-
-    if (kTfLiteAffineQuantization == quant.type) {
-
-        auto *quantParams = (TfLiteAffineQuantization *) quant.params;
-        const float quantScale = quantParams->scale->data[0];
-        const int quantOffset = quantParams->zero_point->data[0];
-
-        switch (inputTensor->type) {
-            case kTfLiteInt8: {
-                mfccFeatureCalc = FeatureCalc<int8_t>(inputTensor,
-                                                        cacheSize,
-                                                        [=, &mfcc](std::vector<int16_t>& audioDataWindow) {
-                                                            return mfcc.MfccComputeQuant<int8_t>(audioDataWindow,
-                                                                                                quantScale,
-                                                                                                quantOffset);
-                                                        }
-                );
-                break;
-            }
-            case kTfLiteUInt8: {
-                mfccFeatureCalc = FeatureCalc<uint8_t>(inputTensor,
-                                                        cacheSize,
-                                                        [=, &mfcc](std::vector<int16_t>& audioDataWindow) {
-                                                            return mfcc.MfccComputeQuant<uint8_t>(audioDataWindow,
-                                                                                                    quantScale,
-                                                                                                    quantOffset);
-                                                        }
-                );
-                break;
-            }
-            case kTfLiteInt16: {
-                mfccFeatureCalc = FeatureCalc<int16_t>(inputTensor,
-                                                        cacheSize,
-                                                        [=, &mfcc](std::vector<int16_t>& audioDataWindow) {
-                                                            return mfcc.MfccComputeQuant<int16_t>(audioDataWindow,
-                                                                                                    quantScale,
-                                                                                                    quantOffset);
-                                                        }
-                );
-                break;
-            }
-            default:
-                xprintf("Tensor type %s not supported\n", TfLiteTypeGetName(inputTensor->type));
-        }
-
-
-    } else {
-        mfccFeatureCalc = mfccFeatureCalc = FeatureCalc<float>(inputTensor,
-                                                                cacheSize,
-                                                                [&mfcc](std::vector<int16_t>& audioDataWindow) {
-                                                                    return mfcc.MfccCompute(audioDataWindow);
-                                                                });
+    if (outputTensor == nullptr || outputTensor->bytes != KWS_NUM_LABELS) {
+        xprintf("Output size doesn't match the labels' size\n");
+        return false;
     }
-    return mfccFeatureCalc;
-}
-
-void SetVectorResults(std::set<std::pair<float, uint32_t>>& topNSet,
-                          std::vector<MyClassificationResult>& vecResults,
-                          const std::vector <std::string>& labels)
-    {
-
-        /* Reset the iterator to the largest element - use reverse iterator. */
-
-        auto topNIter = topNSet.rbegin();
-        for (size_t i = 0; i < vecResults.size() && topNIter != topNSet.rend(); ++i, ++topNIter) {
-            vecResults[i].normalisedVal = topNIter->first;
-            vecResults[i].label = labels[topNIter->second];
-            vecResults[i].labelIdx = topNIter->second;
-        }
+    if (outputTensor->type != kTfLiteInt8) {
+        xprintf("Tensor type %s not supported by classifier\n",
+            TfLiteTypeGetName(outputTensor->type));
+        return false;
     }
 
-bool GetTopNResults(const std::vector<float>& tensor,
-                                    std::vector<MyClassificationResult>& vecResults,
-                                    uint32_t topNCount,
-                                    const std::vector <std::string>& labels)
-    {
-
-        std::set<std::pair<float , uint32_t>> sortedSet;
-
-        /* NOTE: inputVec's size verification against labels should be
-         *       checked by the calling/public function. */
-
-        /* Set initial elements. */
-        for (uint32_t i = 0; i < topNCount; ++i) {
-            sortedSet.insert({tensor[i], i});
-        }
-
-        /* Initialise iterator. */
-        auto setFwdIter = sortedSet.begin();
+    arm::app::QuantParams quantParams = arm::app::GetTensorQuantParams(outputTensor);
+    const int8_t *tensor_buffer = tflite::GetTensorData<int8_t>(outputTensor);
 
-        /* Scan through the rest of elements with compare operations. */
-        for (uint32_t i = topNCount; i < labels.size(); ++i) {
-            if (setFwdIter->first < tensor[i]) {
-                sortedSet.erase(*setFwdIter);
-                sortedSet.insert({tensor[i], i});
-                setFwdIter = sortedSet.begin();
-            }
-        }
-
-        /* Final results' container. */
-        vecResults = std::vector<MyClassificationResult>(topNCount);
-        SetVectorResults(sortedSet, vecResults, labels);
-
-        return true;
+    float maxValue = -INFINITY;
+    for (uint32_t i = 0; i < KWS_NUM_LABELS; i++) {
+        posteriors[i] = quantParams.scale * (static_cast<float>(tensor_buffer[i]) - quantParams.offset);
+        maxValue = fmaxf(maxValue, posteriors[i]);
     }
 
-bool  GetClassificationResults(
-        TfLiteTensor* outputTensor,
-        std::vector<MyClassificationResult>& vecResults,
-        const std::vector <std::string>& labels,
-        uint32_t topNCount,
-        bool useSoftmax)
-    {
-        if (outputTensor == nullptr) {
-            xprintf("Output vector is null pointer.\n");
-            return false;
-        }
-
-        uint32_t totalOutputSize = 1;
-        for (int inputDim = 0; inputDim < outputTensor->dims->size; inputDim++) {
-            totalOutputSize *= outputTensor->dims->data[inputDim];
-        }
-
-        /* Sanity checks. */
-        if (totalOutputSize < topNCount) {
-            xprintf("Output vector is smaller than %d \n", topNCount);
-            return false;
-        } else if (totalOutputSize != labels.size()) {
-            xprintf("Output size doesn't match the labels' size\n");
-            return false;
-        } else if (topNCount == 0) {
-            xprintf("Top N results cannot be zero\n");
-            return false;
-        }
-
-        bool resultState;
-        vecResults.clear();
-
-        /* De-Quantize Output Tensor */
-        arm::app::QuantParams quantParams = arm::app::GetTensorQuantParams(outputTensor);
-
-        /* Floating point tensor data to be populated
-         * NOTE: The assumption here is that the output tensor size isn't too
-         * big and therefore, there's neglibible impact on heap usage. */
-        std::vector<float> tensorData(totalOutputSize);
-
-        /* Populate the floating point buffer */
-        switch (outputTensor->type) {
-            case kTfLiteUInt8: {
-                uint8_t *tensor_buffer = tflite::GetTensorData<uint8_t>(outputTensor);
-                for (size_t i = 0; i < totalOutputSize; ++i) {
-                    // printf("%d\n",tensor_buffer[i]);
-                    tensorData[i] = quantParams.scale *
-                        (static_cast<float>(tensor_buffer[i]) - quantParams.offset);
-                }
-                break;
-            }
-            case kTfLiteInt8: {
-                int8_t *tensor_buffer = tflite::GetTensorData<int8_t>(outputTensor);
-                for (size_t i = 0; i < totalOutputSize; ++i) {
-                    // printf("%d\n",tensor_buffer[i]);
-                    tensorData[i] = quantParams.scale *
-                        (static_cast<float>(tensor_buffer[i]) - quantParams.offset);
-                }
-                break;
-            }
-            case kTfLiteFloat32: {
-                float *tensor_buffer = tflite::GetTensorData<float>(outputTensor);
-                for (size_t i = 0; i < totalOutputSize; ++i) {
-                    // printf("%d\n",tensor_buffer[i]);
-                    tensorData[i] = tensor_buffer[i];
-                }
-                break;
-            }
-            default:
-                xprintf("Tensor type %s not supported by classifier\n",
-                    TfLiteTypeGetName(outputTensor->type));
-                return false;
-        }
+    float sumExp = 0.f;
+    for (uint32_t i = 0; i < KWS_NUM_LABELS; i++) {
+        posteriors[i] = expf(posteriors[i] - maxValue);
+        sumExp += posteriors[i];
+    }
+    for (uint32_t i = 0; i < KWS_NUM_LABELS; i++) {
+        posteriors[i] /= sumExp;
+    }
+    return true;
+}
 
-        if (useSoftmax) {
-            arm::app::math::MathUtils::SoftmaxF32(tensorData);
+/*
+ * Averages the posteriors of the windows kept in kws_posteriors[] and decides
+ * whether a keyword was spoken. Fills algoresult and returns true on detection.
+ */
+static bool kws_smooth_posteriors(struct_kws_algoResult *algoresult)
+{
+    const uint32_t num = kws_num_windows < KWS_SMOOTH_WINDOWS ? kws_num_windows : KWS_SMOOTH_WINDOWS;
+    float bestVal = 0.f;
+    uint32_t bestIdx = 0;
+
+    for (uint32_t i = 0; i < KWS_NUM_LABELS; i++) {
+        float sum = 0.f;
+        for (uint32_t w = 0; w < num; w++) {
+            sum += kws_posteriors[w][i];
         }
-
-        /* Get the top N results. */
-        resultState = GetTopNResults(tensorData, vecResults, topNCount, labels);
-
-        if (!resultState) {
-            xprintf("Failed to get top N results set\n");
-            return false;
+        if (sum > bestVal) {
+            bestVal = sum;
+            bestIdx = i;
         }
-
-        return true;
     }
+    bestVal /= num;
 
+    if (kws_suppress > 0) {
+        kws_suppress--;
+        return false;
+    }
+    if (bestIdx < KWS_FIRST_KEYWORD || bestVal < threshold) {
+        return false;
+    }
 
+    kws_suppress = KWS_SUPPRESS_WINDOWS;
+    algoresult->m_normalisedVal = bestVal;
+    strncpy(algoresult->m_label, kwtLabels[bestIdx], KWS_MAX_LABEL_SIZE - 1);
+    algoresult->m_label[KWS_MAX_LABEL_SIZE - 1] = '\0';
+    algoresult->m_labelIdx = bestIdx;
+    return true;
+}
 
+int cv_kws_reset(void)
+{
+    kws_features.Reset();
+    kws_num_windows = 0;
+    kws_suppress = 0;
+    return 0;
+}
 
 int cv_kws_run(struct_kws_algoResult *algoresult_kws_pdm_record, int16_t *audio_buf, int32_t audio_clip_length, void (*callback)(void)) {
 
@@ -478,146 +332,77 @@ int cv_kws_run(struct_kws_algoResult *algoresult_kws_pdm_record, int16_t *audio_
 			SystemGetTick(&systick_1, &loop_cnt_1);
 		#endif
 
-        #if KWS_DBG_APP_LOG
-            printf("Initialized kNumCols: %d, kNumRows: %d\n", kNumCols, kNumRows);
-        #endif
-
-        arm::app::audio::MicroNetKwsMFCC mfcc = arm::app::audio::MicroNetKwsMFCC(kNumCols, frameLength);
-        mfcc.Init();
-        #if KWS_DBG_APP_LOG
-            printf("MFCC initialized\n");
-        #endif
+        /* Only the frames completed by this block are computed, in place
+         * from audio_buf; the rest of the window comes from earlier blocks. */
+        kws_features.Push(audio_buf, audio_clip_length);
 
-        auto audioDataWindowSize = kNumRows * frameStride + (frameLength - frameStride);
-        auto mfccWindowSize = frameLength;
-        auto mfccWindowStride = frameStride;
-
-        #if KWS_DBG_APP_LOG
-            printf("Audio window size: %d, MFCC window size: %d, MFCC window stride: %d\n", 
-                audioDataWindowSize, mfccWindowSize, mfccWindowStride);
+        #ifdef EACH_STEP_TICK
+            SystemGetTick(&systick_2, &loop_cnt_2);
+            dbg_printf(DBG_LESS_INFO,"Tick for creating MFCC from audio for Keyword Transformer KWS:[%d]\r\n",(loop_cnt_2-loop_cnt_1)*CPU_CLK+(systick_1-systick_2));
         #endif
 
-
-        auto audioDataStride = audioDataWindowSize/2;
-        // printf("Initial audio data stride: %d\n", audioDataStride);
-
-        if (0 != audioDataStride % mfccWindowStride) {
-            audioDataStride -= audioDataStride % mfccWindowStride;
-            // printf("Adjusted audio data stride: %d\n", audioDataStride);
+        if (!kws_features.Ready()) {
+            #if KWS_DBG_APP_LOG
+                printf("Waiting for a full audio window\n");
+            #endif
+            return 0;
         }
 
-        auto nMfccVectorsInAudioStride = audioDataStride/mfccWindowStride;
-        // printf("Number of MFCC vectors in audio stride: %d\n", nMfccVectorsInAudioStride);
-
-        const float secondsPerSample = 1.0/arm::app::audio::MicroNetKwsMFCC::ms_defaultSamplingFreq;
-        // printf("Seconds per sample: %f\n", secondsPerSample);
-
-        arm::app::audio::SlidingWindow<const int16_t> audioMFCCWindowSlider(
-            // audio_clip_arrays, audioDataWindowSize, mfccWindowSize, mfccWindowStride);
-            audio_buf, audioDataWindowSize, mfccWindowSize, mfccWindowStride);
+        kws_features.CopyTo(kws_input->data.int8);
 
-        #if KWS_DBG_APP_LOG
-            xprintf("cvapp - Audio element [0] = %d\n", audio_buf[0]);
-            xprintf("cvapp - Audio element [1] = %d\n", audio_buf[1]);
-            xprintf("cvapp - Audio element [2] = %d\n", audio_buf[2]);
+        #ifdef EACH_STEP_TICK
+            SystemGetTick(&systick_1, &loop_cnt_1);
         #endif
 
-        arm::app::audio::SlidingWindow<const int16_t> audioDataSlider(
-            audio_buf, audio_clip_length, audioDataWindowSize, audioDataStride);
-
-        // printf("Sliding windows initialized\n");
-
-        auto numberOfReusedFeatureVectors = audioMFCCWindowSlider.TotalStrides() + 1 - nMfccVectorsInAudioStride;
-        auto mfccFeatureCalc = GetFeatureCalculator(mfcc, kws_input, numberOfReusedFeatureVectors);
-        // printf("Number of reused feature vectors: %d\n", numberOfReusedFeatureVectors);
-
-        if (!mfccFeatureCalc){
-            printf("Error: Failed to create feature calculator\n");
-            return false;
+        TfLiteStatus invoke_status = kws_int_ptr->Invoke();
+        if(invoke_status != kTfLiteOk) {
+            printf("kws detect invoke fail\n");
+            return -1;
         }
         #if KWS_DBG_APP_LOG
-            printf("Feature calculator created successfully\n");
+        else {
+            printf("kws detect invoke pass\n");
+        }
         #endif
 
         #ifdef EACH_STEP_TICK
-			SystemGetTick(&systick_1, &loop_cnt_1);
-		#endif
-
-        while (audioDataSlider.HasNext()) {
-            const int16_t *inferenceWindow = audioDataSlider.Next();
-            audioMFCCWindowSlider.Reset(inferenceWindow);
-            bool useCache = audioDataSlider.Index() > 0 && numberOfReusedFeatureVectors > 0;
-
-            #if KWS_DBG_APP_LOG
-                printf("audioDataSlider.Index(): %d", audioDataSlider.Index());
-                printf("Use cache: %s\n", useCache ? "true" : "false");
-            #endif
-
-            while (audioMFCCWindowSlider.HasNext()) {
-                const int16_t *mfccWindow = audioMFCCWindowSlider.Next();
-                std::vector<int16_t> mfccAudioData = std::vector<int16_t>(mfccWindow, mfccWindow + mfccWindowSize);
-                mfccFeatureCalc(mfccAudioData, audioMFCCWindowSlider.Index(), useCache, nMfccVectorsInAudioStride);
-            }
-
-            #ifdef EACH_STEP_TICK						
-                SystemGetTick(&systick_2, &loop_cnt_2);
-                dbg_printf(DBG_LESS_INFO,"Tick for creating MFCC from audio for Keyword Transformer KWS:[%d]\r\n",(loop_cnt_2-loop_cnt_1)*CPU_CLK+(systick_1-systick_2));							
-            #endif
-
-            #ifdef EACH_STEP_TICK
-                SystemGetTick(&systick_1, &loop_cnt_1);
-            #endif
+            SystemGetTick(&systick_2, &loop_cnt_2);
+        #endif
+        // 
 
-            TfLiteStatus invoke_status = kws_int_ptr->Invoke();
-            if(invoke_status != kTfLiteOk) {
-                printf("kws detect invoke fail\n");
-                return -1;
-            }
-            #if KWS_DBG_APP_LOG
-            else {
-                printf("kws detect invoke pass\n");
-            }
-            #endif
+        #ifdef EACH_STEP_TICK
+            dbg_printf(DBG_LESS_INFO,"Tick for Invoke for KWS:[%d]\r\n\n",(loop_cnt_2-loop_cnt_1)*CPU_CLK+(systick_1-systick_2));    
+        #endif
 
-            #ifdef EACH_STEP_TICK
-                SystemGetTick(&systick_2, &loop_cnt_2);
-            #endif
-            // 
+        #ifdef EACH_STEP_TICK
+            SystemGetTick(&systick_1, &loop_cnt_1);
+        #endif
 
-            #ifdef EACH_STEP_TICK
-                dbg_printf(DBG_LESS_INFO,"Tick for Invoke for KWS:[%d]\r\n\n",(loop_cnt_2-loop_cnt_1)*CPU_CLK+(systick_1-systick_2));    
-            #endif
+        if (!kws_get_posteriors(kws_output, kws_posteriors[kws_num_windows % KWS_SMOOTH_WINDOWS])) {
+            return -1;
+        }
+        kws_num_windows++;
+
+        bool detected = kws_smooth_posteriors(algoresult_kws_pdm_record);
+        if (detected)
+        {
+            xprintf("Label: %s " , algoresult_kws_pdm_record->m_label);
+            xprintf("Score: %d %% ", static_cast<int>(algoresult_kws_pdm_record->m_normalisedVal * 100));
+            xprintf("Label Index: %d \n" , algoresult_kws_pdm_record->m_labelIdx);
+        }
+        #if KWS_DBG_APP_LOG
+        else
+        {
+            xprintf("None \n");
+        }
+        #endif
 
-            #ifdef EACH_STEP_TICK
-                SystemGetTick(&systick_1, &loop_cnt_1);
-            #endif
+        // xprintf("-----------------------------------------------------------------------------\n");
 
-            std::vector<MyClassificationResult> vecResults;
-
-            GetClassificationResults(kws_output, vecResults, kwtLabels, 1, true);
-            // printf("Classification results obtained\n");
-
-            // xprintf("-----------------------------------------------------------------------------\n");
-            
-            
-            if(vecResults[0].normalisedVal >= threshold)
-            {
-                xprintf("Label: %s " , vecResults[0].label.c_str());
-                xprintf("Score: %d %", static_cast<int>(vecResults[0].normalisedVal * 100));
-                xprintf("Label Index: %d \n" , vecResults[0].labelIdx);
-            }
-            else
-            {
-                xprintf("None \n");
-            }
-
-            // xprintf("-----------------------------------------------------------------------------\n");
-
-            #ifdef EACH_STEP_TICK
-                SystemGetTick(&systick_2, &loop_cnt_2);
-                dbg_printf(DBG_LESS_INFO,"Tick for getting and printing classification results:[%d]\r\n\n",(loop_cnt_2-loop_cnt_1)*CPU_CLK+(systick_1-systick_2));    
-            #endif
-        }
+        #ifdef EACH_STEP_TICK
+            SystemGetTick(&systick_2, &loop_cnt_2);
+            dbg_printf(DBG_LESS_INFO,"Tick for getting and printing classification results:[%d]\r\n\n",(loop_cnt_2-loop_cnt_1)*CPU_CLK+(systick_1-systick_2));    
+        #endif
         #ifdef TOTAL_STEP_TICK						
 			SystemGetTick(&systick_2, &loop_cnt_2);
 			// dbg_printf(DBG_LESS_INFO,"Tick for TOTAL KWS:[%d]\r\n",(loop_cnt_2-loop_cnt_1)*CPU_CLK+(systick_1-systick_2));		
@@ -627,7 +412,7 @@ int cv_kws_run(struct_kws_algoResult *algoresult_kws_pdm_record, int16_t *audio_
             printf("Audio processing completed\n");
         #endif
 
-        return true;
+        return detected ? 1 : 0;
 
     }
 
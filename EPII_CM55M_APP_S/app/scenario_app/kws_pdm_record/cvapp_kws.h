@@ -9,8 +9,22 @@ extern "C" {
 
 int cv_kws_init(bool security_enable, bool privilege_enable, uint32_t model_addr);
 
+/*
+ * Takes the next audio_clip_length samples of the microphone stream, e.g. one
+ * PDM DMA block, and computes the MFCC features of the frames they complete.
+ * Runs the model once the features of a whole window (1 second) are buffered
+ * and smooths its output over the last windows. Returns 1 and fills
+ * algoresult_kws_pdm_record when a keyword is detected, 0 otherwise and -1
+ * on error.
+ */
 int cv_kws_run(struct_kws_algoResult *algoresult_kws_pdm_record, int16_t *audio_buf, int32_t audio_clip_length, void (*callback)(void));
 
+/*
+ * Drops the buffered features and posteriors, e.g. when audio blocks were
+ * lost: the next window is only run once it is complete again.
+ */
+int cv_kws_reset(void);
+
 int cv_kws_deinit();
 
 #ifdef __cplusplus
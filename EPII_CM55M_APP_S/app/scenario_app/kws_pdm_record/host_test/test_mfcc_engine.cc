@@ -0,0 +1,288 @@
+/*
+ * Host golden test for MfccEngine and MfccFeatureStream.
+ *
+ * MfccEngine::MfccCompute() and MfccComputeQuant() are compared with
+ * MicroNetKwsMFCC of Mfcc.cc on single frames of noise, tones, silence and
+ * full scale square waves. MfccFeatureStream is then fed a stream in PDM
+ * DMA sized blocks (and in odd sized ones) and every window it gives is
+ * compared with a copy of the per window loop of the old cv_kws_run(): a
+ * fresh MicroNetKwsMFCC and a std::vector per frame over the last 16000
+ * samples. Also counts heap allocations per push.
+ */
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <vector>
+
+#include "AudioUtils.hpp"
+#include "MicroNetKwsMfcc.hpp"
+#include "MfccEngine.hpp"
+
+static size_t heap_allocations;
+
+void *operator new(std::size_t size)
+{
+    heap_allocations++;
+    void *p = std::malloc(size ? size : 1);
+    if (!p)
+        throw std::bad_alloc();
+    return p;
+}
+
+void *operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void *p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void *p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void *p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void *p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+namespace {
+
+using arm::app::audio::MfccEngine;
+using arm::app::audio::MfccFeatureStream;
+using arm::app::audio::MfccParams;
+using arm::app::audio::MicroNetKwsMFCC;
+
+/* cvapp_kws.cpp sizes */
+const uint32_t kFrameLength = 480;
+const uint32_t kFrameStride = 160;
+const uint32_t kNumCols = 40;
+const uint32_t kNumRows = 98;
+const uint32_t kWindowLen = kNumRows * kFrameStride + (kFrameLength - kFrameStride);
+const uint32_t kBlockLen = 8000;    /* one PDM DMA block */
+
+struct Quant {
+    float scale;
+    int offset;
+};
+const Quant kQuants[] = {{1.0f, 0}, {0.35f, -5}, {2.7f, 83}};
+
+/* Float features may differ in the last bits: depending on how the
+ * compiler inlines MFCC::MelScale() into CreateMelFilterBank(), the
+ * reference filter bank weights differ by a few ULP. The quantised
+ * features must still match exactly. */
+const float kFloatTolerance = 1e-5f;
+
+int failures;
+
+uint32_t rng_state = 0x13579bdu;
+
+uint32_t rand_u32(void)
+{
+    rng_state = rng_state * 1664525u + 1013904223u;
+    return rng_state;
+}
+
+int16_t rand_sample(int amplitude)
+{
+    return (int16_t)((int)(rand_u32() >> 16) % (2 * amplitude + 1) - amplitude);
+}
+
+long long now_us(void)
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+MfccParams micronet_params(void)
+{
+    return MfccParams(MicroNetKwsMFCC::ms_defaultSamplingFreq, MicroNetKwsMFCC::ms_defaultNumFbankBins,
+                      MicroNetKwsMFCC::ms_defaultMelLoFreq, MicroNetKwsMFCC::ms_defaultMelHiFreq,
+                      kNumCols, kFrameLength, MicroNetKwsMFCC::ms_defaultUseHtkMethod);
+}
+
+/* A few seconds of speech-like test audio: noise, tones, silence, clipping. */
+std::vector<int16_t> make_stream(uint32_t len)
+{
+    std::vector<int16_t> s(len);
+    for (uint32_t i = 0; i < len; i++) {
+        const uint32_t seg = (i / 4000) % 6;
+        const float t = i / 16000.0f;
+        switch (seg) {
+        case 0:
+            s[i] = rand_sample(32767);
+            break;
+        case 1:
+            s[i] = (int16_t)(9000 * sinf(2 * (float)M_PI * (300 + 2000 * t) * t) + rand_sample(50));
+            break;
+        case 2:
+            s[i] = 0;
+            break;
+        case 3:
+            s[i] = ((i / 23) & 1) ? 32767 : -32768;
+            break;
+        case 4:
+            s[i] = rand_sample(40);
+            break;
+        default:
+            s[i] = (int16_t)(4000 * sinf(2 * (float)M_PI * 1000 * t) + 3000 * sinf(2 * (float)M_PI * 3500 * t));
+            break;
+        }
+    }
+    return s;
+}
+
+void check_frames(MfccEngine &engine)
+{
+    MicroNetKwsMFCC ref(kNumCols, kFrameLength);
+    ref.Init();
+
+    const std::vector<int16_t> audio = make_stream(6 * 4000 + kFrameLength);
+    float feats[kNumCols];
+    int8_t quant[kNumCols];
+    int frames = 0;
+    int mismatches = 0;
+    float max_diff = 0;
+
+    for (uint32_t start = 0; start + kFrameLength <= audio.size(); start += 1000) {
+        const std::vector<int16_t> frame(audio.begin() + start, audio.begin() + start + kFrameLength);
+
+        const std::vector<float> ref_feats = ref.MfccCompute(frame);
+        engine.MfccCompute(frame.data(), feats);
+        for (uint32_t i = 0; i < kNumCols; i++) {
+            const float diff = std::fabs(ref_feats[i] - feats[i]);
+            max_diff = std::fmax(max_diff, diff);
+            if (diff > kFloatTolerance * std::fmax(1.0f, std::fabs(ref_feats[i])))
+                mismatches++;
+        }
+
+        for (const Quant &q : kQuants) {
+            const std::vector<int8_t> ref_quant = ref.MfccComputeQuant<int8_t>(frame, q.scale, q.offset);
+            engine.MfccComputeQuant(frame.data(), q.scale, q.offset, quant);
+            if (memcmp(ref_quant.data(), quant, kNumCols) != 0)
+                mismatches++;
+        }
+        frames++;
+    }
+
+    printf("frames: %d frames x (float + %d quantisations), %d mismatches, max float diff %g\n",
+           frames, (int)(sizeof(kQuants) / sizeof(kQuants[0])), mismatches, max_diff);
+    if (mismatches)
+        failures++;
+}
+
+/* The per window loop of the old cv_kws_run(). */
+void reference_window(const int16_t *window, const Quant &q, int8_t *out)
+{
+    MicroNetKwsMFCC mfcc(kNumCols, kFrameLength);
+    mfcc.Init();
+
+    arm::app::audio::SlidingWindow<const int16_t> slider(window, kWindowLen, kFrameLength, kFrameStride);
+    while (slider.HasNext()) {
+        const int16_t *frame = slider.Next();
+        std::vector<int16_t> data(frame, frame + kFrameLength);
+        std::vector<int8_t> feats = mfcc.MfccComputeQuant<int8_t>(data, q.scale, q.offset);
+        memcpy(out + slider.Index() * kNumCols, feats.data(), kNumCols);
+    }
+}
+
+/* Pushes the stream in blocks cycling through sizes and checks every window. */
+void check_stream(MfccEngine &engine, const Quant &q, const std::vector<uint32_t> &sizes,
+                  uint32_t len, bool dma_blocks)
+{
+    static MfccFeatureStream stream;
+    static int8_t got[kNumRows * kNumCols];
+    static int8_t want[kNumRows * kNumCols];
+
+    if (!stream.Init(&engine, kFrameStride, kNumRows, q.scale, q.offset)) {
+        printf("stream init failed\n");
+        failures++;
+        return;
+    }
+
+    const std::vector<int16_t> audio = make_stream(len);
+    uint32_t pos = 0;
+    int windows = 0;
+    int mismatches = 0;
+    uint32_t rows = 0;
+    size_t allocations = 0;
+    long long stream_us = 0;
+    long long ref_us = 0;
+
+    for (size_t b = 0; pos < len; b++) {
+        const uint32_t n = std::min<uint32_t>(sizes[b % sizes.size()], len - pos);
+
+        const size_t heap_before = heap_allocations;
+        long long t0 = now_us();
+        rows += stream.Push(audio.data() + pos, n);
+        stream_us += now_us() - t0;
+        allocations += heap_allocations - heap_before;
+        pos += n;
+
+        /* Rows are the last kNumRows frames that end before pos. */
+        const uint32_t frames = pos >= kFrameLength ? (pos - kFrameLength) / kFrameStride + 1 : 0;
+        if ((frames >= kNumRows) != stream.Ready()) {
+            printf("ready after %u samples: %d, expected %d\n", pos, stream.Ready(), frames >= kNumRows);
+            mismatches++;
+        }
+        if (!stream.Ready())
+            continue;
+
+        stream.CopyTo(got);
+        const uint32_t first = (frames - kNumRows) * kFrameStride;
+        t0 = now_us();
+        reference_window(audio.data() + first, q, want);
+        ref_us += now_us() - t0;
+        if (memcmp(got, want, sizeof(got)) != 0) {
+            printf("window ending at frame %u differs\n", frames);
+            mismatches++;
+        }
+        windows++;
+    }
+
+    printf("stream: scale %.2f offset %d, %s: %d windows, %u rows computed, %d mismatches, %zu heap allocations",
+           q.scale, q.offset, dma_blocks ? "8000 sample blocks" : "odd blocks", windows, rows, mismatches,
+           allocations);
+    if (dma_blocks)
+        printf(", %lld us vs %lld us reference", stream_us, ref_us);
+    printf("\n");
+    if (mismatches || allocations)
+        failures++;
+}
+
+} /* namespace */
+
+int main(void)
+{
+    static MfccEngine engine;
+    if (!engine.Init(micronet_params())) {
+        printf("engine init failed\n");
+        return 1;
+    }
+
+    check_frames(engine);
+
+    const std::vector<uint32_t> dma = {kBlockLen};
+    const std::vector<uint32_t> odd = {1, 479, 480, 159, 161, 20000, 0, 7, 3333, 16000, 320};
+    for (const Quant &q : kQuants)
+        check_stream(engine, q, dma, 4 * kBlockLen, true);
+    check_stream(engine, kQuants[1], odd, 60000, false);
+
+    if (failures) {
+        printf("FAILED %d\n", failures);
+        return 1;
+    }
+    printf("PASSED\n");
+    return 0;
+}
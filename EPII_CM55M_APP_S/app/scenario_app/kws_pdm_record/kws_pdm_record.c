@@ -42,6 +42,7 @@
 #include "spi_protocol.h"
 #include "BITOPS.h"
 #include "common_config.h"
+#include "hx_ring.h"
 
 // #include "memory_manage.h"
 #include "hx_drv_watchdog.h"
@@ -49,6 +50,9 @@
 #include "hx_drv_pdm_rx.h" // PDM driver
 // #include "spi_fatfs.h"
 
+#define CPU_CLK	0xffffff+1
+#define KWS_REPORT_BLOCKS           20      // blocks between two duty cycle reports
+
 PDM_DEV_INFO pdm_dev_info;
 
 /*******************************************************************************
@@ -58,13 +62,10 @@ PDM_DEV_INFO pdm_dev_info;
  * create 8 blocks to save 2 second of data
  ******************************************************************************/
 #define QUARTER_SECOND_MONO_BYTES   8000    // 0.25 sec
-#define BLK_NUM                     2       // 0.5 sec
+#define BLK_NUM                     1       // 0.25 sec, the hop between two KWS windows
 #define AUDIO_LEN                   16000
 #define NUM_BUFF                    8
 
-//allocate 2 audio buffer with 64000 bytes, this buffer is located in the SRAM which described in the linker script (pdm_record.ld)
-int16_t audio_buf[NUM_BUFF][BLK_NUM*QUARTER_SECOND_MONO_BYTES/2];
-
 static uint8_t 	g_xdma_abnormal, g_md_detect, g_cdm_fifoerror, g_wdt1_timeout, g_wdt2_timeout,g_wdt3_timeout;
 static uint8_t 	g_hxautoi2c_error, g_inp1bitparer_abnormal;
 static uint32_t g_dp_event;
@@ -73,7 +74,7 @@ static uint32_t g_cur_jpegenc_frame;
 static uint8_t 	g_time;
 static uint8_t g_spi_master_initial_status;
 static uint32_t g_use_case;
-struct_algoResult algoresult_kws_pdm_record;
+struct_kws_algoResult algoresult_kws_pdm_record;
 static uint32_t g_trans_type;
 static uint32_t judge_case_data;
 uint32_t audio_addr, audio_sz;
@@ -116,24 +117,68 @@ void pinmux_init()
 }
 
 
-// volatile bool rx_cb_flag;
-volatile w_buf_idx = 0;
-volatile r_buf_idx = 0;
+/*******************************************************************************
+ * audio_buf is a hx_ring of NUM_BUFF blocks between one producer, the PDM DMA
+ * rx callback, and one consumer, the KWS loop. The DMA writes the pcm of the
+ * block hx_ring_reserve() returns and the callback stamps and commits it.
+ * When KWS is NUM_BUFF - 1 blocks behind, the callback drops the block just
+ * captured and lets the DMA write it again; the next block it commits is
+ * marked as a gap.
+ * The stamps live in audio_stamp[], apart from the blocks: invalidating a
+ * block for the DMA data must not drop what the callback wrote, nor may a
+ * dirty stamp line be written back over pcm. Every block is a whole number
+ * of cache lines. audio_buf is located in the SRAM described in the linker
+ * script (kws_pdm_record.ld).
+ ******************************************************************************/
+typedef struct
+{
+    int16_t pcm[BLK_NUM*QUARTER_SECOND_MONO_BYTES/2];
+} audio_blk_t;
+
+_Static_assert(sizeof(audio_blk_t) % HX_RING_CACHE_LINE == 0,
+               "audio blocks must be whole cache lines");
+
+typedef struct
+{
+    uint32_t systick;       // SystemGetTick() when the DMA completed the block
+    uint32_t loop_cnt;
+    uint8_t gap;            // blocks were dropped just before this one
+} audio_stamp_t;
+
+audio_blk_t audio_buf[NUM_BUFF] HX_RING_ALIGNED;
+static audio_stamp_t audio_stamp[NUM_BUFF];
+static hx_ring audio_ring;
+static uint8_t audio_ring_gap_pending = 0;
 
 void app_pdm_dma_rx_cb()
 {
-    //xprintf("\n[%s]\n", __FUNCTION__);
-    // rx_cb_flag = true;
+    uint32_t n;
+    audio_blk_t *blk = (audio_blk_t *) hx_ring_reserve(&audio_ring, &n);
+
+    // the block the DMA just filled counts as free until it is committed
+    if (hx_ring_space(&audio_ring) > 1)
+    {
+        audio_stamp_t *stamp = &audio_stamp[blk - audio_buf];
 
-    w_buf_idx++;
-    if (w_buf_idx == NUM_BUFF)
+        SystemGetTick(&stamp->systick, &stamp->loop_cnt);
+        stamp->gap = audio_ring_gap_pending;
+        audio_ring_gap_pending = 0;
+        hx_ring_commit(&audio_ring, 1);
+        blk = (audio_blk_t *) hx_ring_reserve(&audio_ring, &n);
+    }
+    else
     {
-        w_buf_idx = 0;
+        // keep the last free block for the DMA: drop what it just captured
+        hx_ring_drop(&audio_ring, 1);
+        audio_ring_gap_pending = 1;
     }
-    // xprintf("w_buf_idx %d \n", w_buf_idx);
-    hx_drv_pdm_dma_lli_transfer((void *) audio_buf[w_buf_idx], BLK_NUM, QUARTER_SECOND_MONO_BYTES, 0);
-    // xprintf("DMA transfer complete\n");
 
+    hx_drv_pdm_dma_lli_transfer((void *) blk->pcm, BLK_NUM, QUARTER_SECOND_MONO_BYTES, 0);
+}
+
+static uint32_t kws_tick_diff(uint32_t systick_1, uint32_t loop_cnt_1, uint32_t systick_2, uint32_t loop_cnt_2)
+{
+    return (loop_cnt_2-loop_cnt_1)*CPU_CLK+(systick_1-systick_2);
 }
 
 volatile bool kws_processing_complete = true;
@@ -375,6 +420,7 @@ int kws_pdm_record_app(void)
     uint32_t wakeup_event;
 	uint32_t wakeup_event1;
 	uint32_t freq=0;
+	uint32_t sys_clk=0;
 	int32_t buf_idx = 0;
     int32_t save_idx = 0;
     int32_t record_cnt = 0;
@@ -453,67 +499,87 @@ int kws_pdm_record_app(void)
 // 	mm_set_initial((int)(&mm_start_addr), 0x00200000-((int)(&mm_start_addr)-0x34000000));   
 // #endif
 
-	hx_drv_pdm_dma_lli_transfer((void *) audio_buf[w_buf_idx], BLK_NUM, QUARTER_SECOND_MONO_BYTES, 0);
+    EPII_Get_Systemclock(&sys_clk);
+
+	hx_ring_init(&audio_ring, audio_buf, NUM_BUFF, sizeof(audio_blk_t));
+	uint32_t n;
+	audio_blk_t *dma_blk = (audio_blk_t *) hx_ring_reserve(&audio_ring, &n);
+	hx_drv_pdm_dma_lli_transfer((void *) dma_blk->pcm, BLK_NUM, QUARTER_SECOND_MONO_BYTES, 0);
     xprintf("start KWS exmample now recording\n");
 
     cv_kws_init(true, true, KWS_FLASH_ADDR); 
 
-    int16_t temp_buf[AUDIO_LEN];
-
-    volatile a = 0;
-    volatile miss_inf = 0;
+    uint32_t late_blocks = 0;
+    uint32_t total_blocks = 0;
+    uint32_t busy_ticks = 0;
+    uint32_t report_systick, report_loop_cnt;
+    SystemGetTick(&report_systick, &report_loop_cnt);
 
 	do {
-        int32_t current_buf = w_buf_idx;
-        int32_t prev_buf = (current_buf - 1 + NUM_BUFF) % NUM_BUFF;
-        int32_t a = a % NUM_BUFF;
-
-        if(a != prev_buf)
-        {   
-            if(r_buf_idx > 0)
-            {
-                miss_inf++;
-            }
-            xprintf("We miss 1 inference where ");
-            xprintf("prev buf: %d and ", prev_buf);
-            xprintf("a: %d\n", a);
+        audio_blk_t *blk;
+        audio_stamp_t *stamp;
+        uint32_t start_systick, start_loop_cnt;
+        uint32_t end_systick, end_loop_cnt;
+
+        // sleep until the rx callback commits the next block
+        __disable_irq();
+        while ((blk = (audio_blk_t *) hx_ring_peek(&audio_ring, &n)) == NULL)
+        {
+            __WFI();
+            __enable_irq();
+            __disable_irq();
+        }
+        __enable_irq();
+        stamp = &audio_stamp[blk - audio_buf];
+
+        if (hx_ring_count(&audio_ring) > 1)
+        {
+            // more than one block is waiting, KWS is behind the microphone
+            late_blocks++;
         }
 
-        while (!kws_processing_complete);
+        SystemGetTick(&start_systick, &start_loop_cnt);
 
-        // dma transfer should be complete
-        while (w_buf_idx == current_buf);
+        if (stamp->gap)
+        {
+            // the stream is not continuous any more, start a new window
+            cv_kws_reset();
+        }
 
-        // invalud the cache here
-        SCB_InvalidateDCache_by_Addr((uint32_t*)audio_buf[prev_buf], QUARTER_SECOND_MONO_BYTES);
-        SCB_InvalidateDCache_by_Addr((uint32_t*)audio_buf[current_buf], QUARTER_SECOND_MONO_BYTES);
+        // invalidate the cache here, the DMA wrote the block behind it
+        SCB_InvalidateDCache_by_Addr((uint32_t*)blk->pcm, sizeof(blk->pcm));
 
-        // memcpy(temp_buf, audio_buf[prev_buf], 8000 * sizeof(int));
-        // memcpy(temp_buf + 8000, audio_buf[current_buf], 8000 * sizeof(int));
+        // MFCC reads the block in place; cv_kws_run keeps the features of the
+        // previous blocks and runs the model on the last AUDIO_LEN samples
+        int ret = cv_kws_run(&algoresult_kws_pdm_record, 
+                    blk->pcm, 
+                    BLK_NUM*QUARTER_SECOND_MONO_BYTES/2,
+                    kws_processing_callback);
 
-        memcpy(temp_buf, audio_buf[prev_buf], BLK_NUM*QUARTER_SECOND_MONO_BYTES/2 * sizeof(int));
-        memcpy(temp_buf + BLK_NUM*QUARTER_SECOND_MONO_BYTES/2, audio_buf[current_buf], BLK_NUM*QUARTER_SECOND_MONO_BYTES/2 * sizeof(int));
+        SystemGetTick(&end_systick, &end_loop_cnt);
+        busy_ticks += kws_tick_diff(start_systick, start_loop_cnt, end_systick, end_loop_cnt);
 
-        if (r_buf_idx > 0) {
-            cv_kws_run(&algoresult_kws_pdm_record, 
-                        temp_buf, 
-                        AUDIO_LEN,
-                        kws_processing_callback);
-            
-        } else {
-            // Skip processing for the first iteration
-            xprintf("Skipping first buffer processing\n");
-        }
-        if (r_buf_idx > 0)
+        if (ret > 0)
         {
-            a++;
+            // from the end of the block that completed the keyword to the result
+            uint32_t latency = kws_tick_diff(stamp->systick, stamp->loop_cnt, end_systick, end_loop_cnt);
+            xprintf("Wake latency %d ms\n", (uint32_t)((uint64_t)latency * 1000 / sys_clk));
         }
-        // a++;
-        r_buf_idx++;
 
-        if (r_buf_idx%20 == 0)
+        // give the block back to the DMA
+        hx_ring_release(&audio_ring, 1);
+        total_blocks++;
+
+        if (total_blocks % KWS_REPORT_BLOCKS == 0)
         {
-            xprintf("Missed inferences %d out of Total inferences %d\n", miss_inf, r_buf_idx);
+            uint32_t elapsed = kws_tick_diff(report_systick, report_loop_cnt, end_systick, end_loop_cnt);
+            uint32_t duty = (uint32_t)((uint64_t)busy_ticks * 1000 / elapsed);
+
+            xprintf("CPU duty cycle %d.%d%%, late blocks %d, dropped blocks %d out of total blocks %d\n",
+                    duty / 10, duty % 10, late_blocks, hx_ring_dropped(&audio_ring), total_blocks);
+            busy_ticks = 0;
+            report_systick = end_systick;
+            report_loop_cnt = end_loop_cnt;
         }
 
     } while(1);
@@ -28,6 +28,7 @@
 #include "tensorflow/lite/micro/micro_error_reporter.h"
 #endif
 #include "img_proc_helium.h"
+#include "hx_img_preproc.h"
 #include "yolo_postprocessing.h"
 #include "pose_processing.h"
 
@@ -56,6 +57,8 @@
 #ifndef YUV_640_480_INPUT /*RGB_320_240_INPUT*/
 
 #define COLOR_CHANNEL					3U
+#define FD_PREPROC_FMT					HX_IMG_PREPROC_BGR8U3C_TO_GRAY
+#define FM_PREPROC_FMT					HX_IMG_PREPROC_BGR8U3C_TO_RGB24
 #define MAX_RESIZE_IMAGE_SIDE_LENGTTH 	160
 #define FD_INPUT_TENSOR_WIDTH   		MAX_RESIZE_IMAGE_SIDE_LENGTTH
 #define FD_INPUT_TENSOR_HEIGHT  		MAX_RESIZE_IMAGE_SIDE_LENGTTH
@@ -72,6 +75,8 @@
 #else
 
 #define COLOR_CHANNEL					1U
+#define FD_PREPROC_FMT					HX_IMG_PREPROC_Y8_TO_Y8
+#define FM_PREPROC_FMT					HX_IMG_PREPROC_Y8_TO_YYY24
 #define MAX_RESIZE_IMAGE_SIDE_LENGTTH 	160
 #define FD_INPUT_TENSOR_WIDTH   		MAX_RESIZE_IMAGE_SIDE_LENGTTH
 #define FD_INPUT_TENSOR_HEIGHT  		MAX_RESIZE_IMAGE_SIDE_LENGTTH
@@ -92,6 +97,17 @@
 #define TOTAL_STEP_TICK 1
 #define CPU_CLK	0xffffff+1
 static uint32_t capture_image_tick = 0;
+// run the hx_img_preproc self test and the face mesh letterbox benchmark on the first face
+#define FD_FM_PREPROC_SELFTEST 0
+#if FD_FM_PREPROC_SELFTEST
+#include "hx_img_preproc_test.h"
+static uint32_t selftest_tick(void)
+{
+	uint32_t systick, loop_cnt;
+	SystemGetTick(&systick, &loop_cnt);
+	return loop_cnt * (CPU_CLK) - systick;
+}
+#endif
 //left eyes indices #16 point
 int LEFT_EYE_mesh_index[16] ={ 362, 382, 381, 380, 374, 373, 390, 249, 263, 466, 388, 387, 386, 385,384, 398 };
 
@@ -163,18 +179,19 @@ namespace {
 //constexpr int tensor_arena_size_second_model_tail_size = 736 ;
 constexpr int tensor_arena_model_tail_size = 1224;//568;
 constexpr int tensor_arena_size = 460*1024;//435*1024;
-#ifndef YUV_640_480_INPUT /*RGB_320_240_INPUT*/
-constexpr int resize_image_size = FM_INPUT_TENSOR_WIDTH*FM_INPUT_TENSOR_HEIGHT*COLOR_CHANNEL;
-constexpr int crop_image_size = CROP_IMAGE_WIDTH*CROP_IMAGE_HEIGHT*COLOR_CHANNEL;
-constexpr int crop_eye_size = IL_INPUT_TENSOR_WIDTH*IL_INPUT_TENSOR_HEIGHT; //64*64 = 4096 = 0x1000
-#else
-constexpr int resize_image_size = FM_INPUT_TENSOR_WIDTH*FM_INPUT_TENSOR_HEIGHT;
-constexpr int crop_image_size = CROP_IMAGE_WIDTH*CROP_IMAGE_HEIGHT;
-constexpr int crop_eye_size = IL_INPUT_TENSOR_WIDTH*IL_INPUT_TENSOR_HEIGHT; //64*64 = 4096 = 0x1000
-#endif
 
-static uint32_t tensor_arena=0, resized_img=0, crop_img=0,pad_img=0;;
-static uint32_t crop_eye_l=0,crop_eye_r = 0;
+static uint32_t tensor_arena=0;
+static hx_img_preproc fd_preproc;
+static int16_t fd_preproc_work[HX_IMG_PREPROC_WORK_SIZE(DP_INP_OUT_WIDTH, FD_INPUT_TENSOR_WIDTH, COLOR_CHANNEL) / 2];
+/* face box letterboxed to a square and resized to the FM input, sampled from the raw frame
+ * (no crop / pad / resized image buffers); the eye windows of IL are sampled on the same grid */
+static hx_img_preproc_roi fm_roi;
+static hx_img_preproc fm_preproc;
+static int16_t fm_preproc_work[HX_IMG_PREPROC_WORK_SIZE(DP_INP_OUT_WIDTH, FM_INPUT_TENSOR_WIDTH, COLOR_CHANNEL) / 2];
+#ifdef APP_IRIS_LANDMARK
+static hx_img_preproc il_preproc;
+static int16_t il_preproc_work[HX_IMG_PREPROC_WORK_SIZE(DP_INP_OUT_WIDTH, IL_INPUT_TENSOR_WIDTH, COLOR_CHANNEL) / 2];
+#endif
 
 struct ethosu_driver ethosu_drv; /* Default Ethos-U device driver */
 tflite::MicroInterpreter *fd_int_ptr=nullptr;
@@ -187,7 +204,7 @@ tflite::MicroInterpreter *il_int_ptr=nullptr;
 TfLiteTensor *il_input, *il_output;
 
 network fd_net;
-static uint32_t g_fd_fm_init = 0, g_image_mapping_init = 0;
+static uint32_t g_fd_fm_init = 0;
 
 static tflite::MicroMutableOpResolver<2> op_resolver;
 /*struct_algoResult algoresult;
@@ -200,74 +217,6 @@ static uint8_t crop_eye_L_buffer[crop_eye_buffer_max_size]  __attribute__((secti
 static uint8_t crop_eye_R_buffer[crop_eye_buffer_max_size]  __attribute__((section(".crop_eye_R_buffer")));*/
 
 };
-//TODO maybe use helium optimize
-static void BGRU3C_to_RGB24(uint8_t*in_image, int8_t*out_image,int32_t in_image_width, int32_t in_image_height)
-{
-	int32_t x,y;
-	uint8_t *b_image=in_image, *g_image= in_image+in_image_width*in_image_height, *r_image = g_image+in_image_width*in_image_height;
-	
-	//channel adjust (in_image BBBBBB/GGGGGG/RRRRRR => out_image RGBRGB)
-	for (y = 0; y < in_image_height; y++) {//compute new pixels
-			for (x = 0; x < in_image_width; x++) {
-				int8_t b,g,r;
-				b = b_image[y * in_image_width + x];
-				g = g_image[y * in_image_width + x];
-				r = r_image[y * in_image_width + x];
-
-				out_image[(in_image_width*y+x)*3] = r-128;
-				out_image[(in_image_width*y+x)*3+1] = g-128;
-				out_image[(in_image_width*y+x)*3+2] = b-128;
-			}
-	}
-
-}
-
-//Expand Y channel to 3 Y channel
-static void Y_to_YYY(uint8_t*in_image, int8_t*out_image,int32_t in_image_width, int32_t in_image_height)
-{
-	int32_t x,y;
-	uint8_t *Y_image=in_image;
-	
-	//channel adjust (in_image Y->YYY)
-	for (y = 0; y < in_image_height; y++) {//compute new pixels
-			for (x = 0; x < in_image_width; x++) {
-				int8_t Y;
-				Y = Y_image[y * in_image_width + x];
-				
-
-				out_image[(in_image_width*y+x)*3] = Y-128;
-				out_image[(in_image_width*y+x)*3+1] = Y-128;
-				out_image[(in_image_width*y+x)*3+2] = Y-128;
-			}
-	}
-
-}
-//TODO maybe use helium optimize
-static void BGRU3C_to_GRAY(uint8_t*in_image, int8_t*out_image,int32_t in_image_width, int32_t in_image_height)
-{
-	int32_t x,y;
-	uint8_t *b_image=in_image, *g_image= in_image+in_image_width*in_image_height, *r_image = g_image+in_image_width*in_image_height;
-	
-	//channel adjust (in_image BBBBBB/GGGGGG/RRRRRR => out_image RGBRGB)
-	for (y = 0; y < in_image_height; y++) {//compute new pixels
-			for (x = 0; x < in_image_width; x++) {
-				int32_t b,g,r;
-				b = b_image[y * in_image_width + x];
-				g = g_image[y * in_image_width + x];
-				r = r_image[y * in_image_width + x];
-
-				#if 0
-					out_image[(in_image_width*y+x)] = (int8_t)((b+g+r)/3-128);
-				#else
-					int16_t r_i = int16_t((float)r*(float)0.299); 
-					int16_t g_i = int16_t((float)g*(float)0.587); 
-					int16_t b_i = int16_t((float)b*(float)0.144); 
-					out_image[(in_image_width*y+x)] = (int8_t)((b_i+g_i+r_i)-128);
-				#endif
-			}
-	}
-
-}
 
 static network yolo_post_processing_init(TfLiteTensor* out_ten, TfLiteTensor* out2_ten)
 {
@@ -295,23 +244,26 @@ static network yolo_post_processing_init(TfLiteTensor* out_ten, TfLiteTensor* ou
 
 static void yolo_post_processing(network* net, struct_algoResult *alg_result)
 {
-	int nboxes=0;
 	float thresh = .50;
 	float nms = .45;
 	uint8_t counter = 0;
 	uint32_t sensor_width = app_get_raw_width();
 	uint32_t sensor_height = app_get_raw_height();
 
-	std::forward_list<detection> dets = get_network_boxes(net, sensor_width, sensor_height, thresh, &nboxes);
+	static hx_nms_boxes dets;
+	get_network_boxes(net, sensor_width, sensor_height, thresh, &dets);
 #ifdef FD_FL_DEBUG
-	dbg_printf(DBG_LESS_INFO,"box:%d\n",nboxes);
+	dbg_printf(DBG_LESS_INFO,"box:%d\n",dets.count);
 #endif
 
 	//clear_alg_rsult(&alg_result);
-	// do nms
-	diounms_sort(dets, net->num_classes, nms);
+	// do nms, per class with DIoU
+	uint16_t keep[MAX_TRACKED_ALGO_RES];
+	int nkeep = hx_nms_run(&dets, nms, HX_NMS_PER_GROUP | HX_NMS_DIOU, net->topN, MAX_TRACKED_ALGO_RES, keep);
 
-	for (std::forward_list<detection>::iterator it=dets.begin(); it != dets.end(); ++it){
+	for (int i = 0; i < nkeep; i++){
+		int k = keep[i];
+		box bbox = {dets.x[k] + dets.w[k] / 2, dets.y[k] + dets.h[k] / 2, dets.w[k], dets.h[k]};
 		/**************
 		 *
 		 * To let FD bbox do not too tight to do FL
@@ -324,22 +276,22 @@ static void yolo_post_processing(network* net, struct_algoResult *alg_result)
 			ymax = min(d['y'] + d['h']/2, image_shape[0])
 			boxes.append([xmin, ymin, xmax, ymax])
 		**************/
-		/*** do not change final it->bbox.w and it->bbox.h value
+		/*** do not change final bbox.w and bbox.h value
 		 * so combine this part at below code
-		//		it->bbox.w = it->bbox.w * 1.2;
-		//		it->bbox.h = it->bbox.h * 1.2;
+		//		bbox.w = bbox.w * 1.2;
+		//		bbox.h = bbox.h * 1.2;
 		*****/
-		// float ymin = it->bbox.y - it->bbox.h / 2.;
-		// float xmin = it->bbox.x - ((it->bbox.w * 1.2) / 2.);
-		// float xmax = it->bbox.x + ((it->bbox.w * 1.2) / 2.);
-		// float ymax = it->bbox.y + ((it->bbox.h * 1.2) / 2.);
+		// float ymin = bbox.y - bbox.h / 2.;
+		// float xmin = bbox.x - ((bbox.w * 1.2) / 2.);
+		// float xmax = bbox.x + ((bbox.w * 1.2) / 2.);
+		// float ymax = bbox.y + ((bbox.h * 1.2) / 2.);
 
 		float box_scale_factor = 1.6;//1.8;
 
-		float ymin = it->bbox.y - ((it->bbox.h * box_scale_factor) / 2.);
-		float xmin = it->bbox.x - ((it->bbox.w * box_scale_factor) / 2.);
-		float xmax = it->bbox.x + ((it->bbox.w * box_scale_factor) / 2.);
-		float ymax = it->bbox.y + ((it->bbox.h * box_scale_factor) / 2.);
+		float ymin = bbox.y - ((bbox.h * box_scale_factor) / 2.);
+		float xmin = bbox.x - ((bbox.w * box_scale_factor) / 2.);
+		float xmax = bbox.x + ((bbox.w * box_scale_factor) / 2.);
+		float ymax = bbox.y + ((bbox.h * box_scale_factor) / 2.);
 
 		if (xmin < 0) xmin = 0;
 		if (ymin < 0) ymin = 0;
@@ -350,27 +302,23 @@ static void yolo_post_processing(network* net, struct_algoResult *alg_result)
 		float by = ymin;
 		float bw = xmax - xmin;
 		float bh = ymax - ymin;
-		for (int j = 0; j < net->num_classes; ++j) {
-			if (it->prob[j] > 0 && counter < MAX_TRACKED_ALGO_RES) {
-				#ifdef FD_DEBUG
-				xprintf("{%d \"bbox\":[%d, %d, %d, %d], \"score\":%d},\n", j, (int)(bx), (int)(by), (int)(bw), (int)(bh), (int)(it->prob[j]*100));
-				xprintf("xmin: %d, ymin:%d, xmax: %d, ymax: %d\n",(int)(bx), (int)(by), (int)(bx+bw), (int)(by+bh));
-				#endif
-				alg_result->ht[counter].upper_body_score = (uint32_t)(it->prob[j]*100);
-				alg_result->ht[counter].upper_body_bbox.x = (uint32_t)(bx);      //xmin
-				alg_result->ht[counter].upper_body_bbox.y = (uint32_t)(by);      //ymin
-				alg_result->ht[counter].upper_body_bbox.width = (uint32_t)(bw);  //xmax
-				alg_result->ht[counter].upper_body_bbox.height = (uint32_t)(bh); //ymax
-				alg_result->ht[counter].upper_body_scale = j;
-				counter++;
-				alg_result->num_tracked_human_targets++;
-			}
-		}
+		int j = dets.group[k];
+		#ifdef FD_DEBUG
+		xprintf("{%d \"bbox\":[%d, %d, %d, %d], \"score\":%d},\n", j, (int)(bx), (int)(by), (int)(bw), (int)(bh), (int)(dets.score[k]*100));
+		xprintf("xmin: %d, ymin:%d, xmax: %d, ymax: %d\n",(int)(bx), (int)(by), (int)(bx+bw), (int)(by+bh));
+		#endif
+		alg_result->ht[counter].upper_body_score = (uint32_t)(dets.score[k]*100);
+		alg_result->ht[counter].upper_body_bbox.x = (uint32_t)(bx);      //xmin
+		alg_result->ht[counter].upper_body_bbox.y = (uint32_t)(by);      //ymin
+		alg_result->ht[counter].upper_body_bbox.width = (uint32_t)(bw);  //xmax
+		alg_result->ht[counter].upper_body_bbox.height = (uint32_t)(bh); //ymax
+		alg_result->ht[counter].upper_body_scale = j;
+		counter++;
+		alg_result->num_tracked_human_targets++;
 		#ifdef FD_DEBUG
 		xprintf("alg_result->num_tracked_human_targets: %d\r\n",alg_result->num_tracked_human_targets);
 		#endif
 	}
-	free_dets(dets);
 	//free((net->branchs));
 }
 
@@ -590,7 +538,7 @@ void compute_ANGLE_face_mesh(struct_fm_algoResult_with_fps *algoresult_fm)
 #endif//COMPUTE_ANGLE
 
 #ifdef APP_IRIS_LANDMARK
-void crop_single_eye_IL(uint8_t* input_face_w_pad_image,uint8_t* crop_dist_image,struct_position *fm_eye_r_wo_scale ,struct_position* eye_center, int LR)
+int crop_single_eye_IL(const uint8_t* raw_image, int img_w, int img_h, int8_t* il_input_data, struct_position *fm_eye_r_wo_scale ,struct_position* eye_center, int LR)
 {
 	eye_center->x = 0;
 	eye_center->y = 0;
@@ -620,12 +568,16 @@ void crop_single_eye_IL(uint8_t* input_face_w_pad_image,uint8_t* crop_dist_image
 	}
 
 
-	struct__box crop_eye_bbox;
-	crop_eye_bbox.x = eye_center->x - IL_INPUT_TENSOR_WIDTH/2;
-	crop_eye_bbox.y = eye_center->y - IL_INPUT_TENSOR_HEIGHT/2;	
-	crop_eye_bbox.width = IL_INPUT_TENSOR_WIDTH;
-	crop_eye_bbox.height = IL_INPUT_TENSOR_HEIGHT;
-	hx_lib_image_copy_helium((uint8_t*)input_face_w_pad_image, crop_dist_image, FM_INPUT_TENSOR_WIDTH, FM_INPUT_TENSOR_WIDTH, COLOR_CHANNEL, crop_eye_bbox.x, crop_eye_bbox.y, crop_eye_bbox.width, crop_eye_bbox.height);
+	//64x64 window around the eye on the FM input grid of the face, read from the raw frame
+	//the origin is clamped at 0 like eye_shift_x/y of IL_post_proccessing
+	hx_img_preproc_roi eye_roi = fm_roi;
+	eye_roi.out_x = MAX(eye_center->x - IL_INPUT_TENSOR_WIDTH/2, 0);
+	eye_roi.out_y = MAX(eye_center->y - IL_INPUT_TENSOR_HEIGHT/2, 0);
+	if(hx_img_preproc_init_roi(&il_preproc, FM_PREPROC_FMT, img_w, img_h, &eye_roi,
+			IL_INPUT_TENSOR_WIDTH, IL_INPUT_TENSOR_HEIGHT, il_preproc_work, sizeof(il_preproc_work)) != 0)
+		return -1;
+	hx_img_preproc_run(&il_preproc, raw_image, il_input_data);
+	return 0;
 }
 
 static void IL_post_proccessing(TfLiteTensor* outputTensor_1,TfLiteTensor* outputTensor_2, struct_fm_algoResult_with_fps *algoresult_fm,struct_position* eye_center, int LR)
@@ -1040,10 +992,8 @@ static int _arm_npu_init(bool security_enable, bool privilege_enable)
 int cv_fd_fm_init(bool security_enable, bool privilege_enable, uint32_t fd_model_addr, uint32_t fm_model_addr, uint32_t il_model_addr) {
 	int ercode = 0;
 
-	//set memory allocation to tensor_arena, resized_img, crop_img, crop_eye
+	//set memory allocation to tensor_arena
 	tensor_arena = mm_reserve_align(tensor_arena_size,0x20); //435kb
-	crop_eye_l = mm_reserve_align(crop_eye_size,0x20); //64*64
-	crop_eye_r = mm_reserve_align(crop_eye_size,0x20); //64*64
 
 	//for(int i = 0;i<tensor_arena_size;i++)
 	//	tensor_arena[i] = 0;
@@ -1158,9 +1108,6 @@ static uint32_t algo_tick = 0;
 	int ercode = 0;
 	TfLiteStatus invoke_status=kTfLiteOk;
 
-	float w_scale;
-    float h_scale;
-	int pad_sz = 0;
 
     uint32_t img_w = app_get_raw_width();
     uint32_t img_h = app_get_raw_height();
@@ -1171,44 +1118,25 @@ static uint32_t algo_tick = 0;
 	#endif
 	uint32_t raw_addr = app_get_raw_addr();
 
-	if(g_image_mapping_init==0) {
-		g_image_mapping_init = 1;
-		#ifndef YUV_640_480_INPUT /*RGB_320_240_INPUT*/
-			resized_img = mm_reserve_align(resize_image_size,0x20); //192*192*3
-			crop_img = mm_reserve_align(img_w*img_h*ch,0x20); //320*240*3
-			pad_img = mm_reserve_align(img_w*img_w*ch,0x20); //320*320*3
-		#else
-			resized_img = mm_reserve_align(resize_image_size,0x20); //192*192*1
-			crop_img = mm_reserve_align(img_w*img_h*ch,0x20); //640*480*1
-			pad_img = mm_reserve_align(img_w*img_w*ch,0x20); //640*640*1
-		#endif
-		#if DBG_APP_LOG
-		xprintf("addr: resized[%x] crop[%x] pad[%x]\n",resized_img, crop_img, pad_img, raw_addr);
-		#endif
-	}
     //send jpeg image and no wait
     alg_result->num_tracked_human_targets = 0;
 	#if DBG_APP_LOG
     xprintf("raw info: w[%d] h[%d] ch[%d] addr[%x]\n",img_w, img_h, ch, raw_addr);
 	#endif
-    w_scale = (float)(img_w - 1) / (FD_INPUT_TENSOR_WIDTH - 1);
-	h_scale = (float)(img_h - 1) / (FD_INPUT_TENSOR_HEIGHT - 1);
-	
-	#ifndef YUV_640_480_INPUT /*RGB_320_240_INPUT*/
-		hx_lib_image_resize_helium((uint8_t*)raw_addr, (uint8_t*)resized_img,
-					img_w, img_h, (int)COLOR_CHANNEL,
-					FD_INPUT_TENSOR_WIDTH, FD_INPUT_TENSOR_HEIGHT, w_scale,h_scale);
-
-    	BGRU3C_to_GRAY((uint8_t*)resized_img, (int8_t*)fd_input->data.int8, FD_INPUT_TENSOR_WIDTH, FD_INPUT_TENSOR_HEIGHT);
-	#else
-		hx_lib_image_resize_helium((uint8_t*)raw_addr, (uint8_t*)fd_input->data.data,
-					img_w, img_h, (int)COLOR_CHANNEL,
-					FD_INPUT_TENSOR_WIDTH, FD_INPUT_TENSOR_HEIGHT, w_scale,h_scale);
-
-		for (int i = 0; i < fd_input->bytes; ++i) {
-			*((int8_t *)fd_input->data.data+i) = *((int8_t *)fd_input->data.data+i) - 128;
+	//resize, convert to gray and shift to int8 in one pass, straight into the FD input tensor
+	if(fd_preproc.in_w != (int)img_w || fd_preproc.in_h != (int)img_h) {
+		if(hx_img_preproc_init(&fd_preproc, FD_PREPROC_FMT, img_w, img_h,
+				FD_INPUT_TENSOR_WIDTH, FD_INPUT_TENSOR_HEIGHT, fd_preproc_work, sizeof(fd_preproc_work)) != 0) {
+			xprintf("preproc init fail for %dx%d\n", img_w, img_h);
+			return -1;
 		}
-	#endif
+		#ifndef YUV_640_480_INPUT /*RGB_320_240_INPUT*/
+		// Q7 weights of the former BGRU3C_to_GRAY (0.299, 0.587, 0.144)
+		hx_img_preproc_set_gray_weights(&fd_preproc, 38, 75, 18);
+		#endif
+	}
+	hx_img_preproc_run(&fd_preproc, (const uint8_t*)raw_addr, fd_input->data.int8);
+
 	invoke_status = fd_int_ptr->Invoke();
 
 	if(invoke_status != kTfLiteOk)
@@ -1277,54 +1205,38 @@ static uint32_t algo_tick = 0;
 		}
 		alg_fm_result->num_tracked_face_targets = alg_result->num_tracked_human_targets;
 
-		//crop face area to crop_img
-		hx_lib_image_copy_helium((uint8_t*)raw_addr, (uint8_t*)crop_img, img_w, img_h, ch, \
-				alg_fm_result->face_bbox[0].x, alg_fm_result->face_bbox[0].y, \
-				alg_fm_result->face_bbox[0].width, alg_fm_result->face_bbox[0].height);
-
-#ifdef UART_SEND_ALOGO_RESEULT
-#else
-		//recapture image
-    	sensordplib_retrigger_capture();				
-#endif			
-
-		if(alg_fm_result->face_bbox[0].height > alg_fm_result->face_bbox[0].width)
-		{
-			int diff = alg_fm_result->face_bbox[0].height - alg_fm_result->face_bbox[0].width;
-			pad_sz = alg_fm_result->face_bbox[0].height;
-
-			hx_lib_pad_image((uint8_t*)crop_img, (uint8_t*)pad_img,
-					alg_fm_result->face_bbox[0].width, alg_fm_result->face_bbox[0].height, ch,
-				0, 0, (diff / 2),  (diff / 2 + diff % 2), pad_sz, pad_sz);/**pad_top, pad_bottom, pad_left,  pad_right**/
-
+		//letterbox the face box to a square (0 padding) and resize, reorder and shift it to int8
+		//straight from the raw frame into the FM input tensor
+		hx_img_preproc_rect face_box;
+		face_box.x = alg_fm_result->face_bbox[0].x;
+		face_box.y = alg_fm_result->face_bbox[0].y;
+		face_box.w = alg_fm_result->face_bbox[0].width;
+		face_box.h = alg_fm_result->face_bbox[0].height;
+		#if FD_FM_PREPROC_SELFTEST
+		static bool preproc_selftest_done = false;
+		if(!preproc_selftest_done) {
+			preproc_selftest_done = true;
+			uint32_t scratch = mm_reserve_align(HX_IMG_PREPROC_TEST_LETTERBOX_SCRATCH(img_w, img_h, FM_INPUT_TENSOR_WIDTH, COLOR_CHANNEL), 0x20);
+			hx_img_preproc_test_run(NULL, NULL, 0, 0, NULL, 0, 0);
+			if(scratch != 0)
+				hx_img_preproc_test_letterbox_bench(selftest_tick, FM_PREPROC_FMT, (const uint8_t*)raw_addr, img_w, img_h,
+						&face_box, FM_INPUT_TENSOR_WIDTH, (uint8_t*)scratch, fm_input->data.int8);
 		}
-		else if(alg_fm_result->face_bbox[0].width > alg_fm_result->face_bbox[0].height)
+		#endif
+		hx_img_preproc_letterbox_roi(&face_box, FM_INPUT_TENSOR_WIDTH, &fm_roi);
+		if(hx_img_preproc_init_roi(&fm_preproc, FM_PREPROC_FMT, img_w, img_h, &fm_roi,
+				FM_INPUT_TENSOR_WIDTH, FM_INPUT_TENSOR_HEIGHT, fm_preproc_work, sizeof(fm_preproc_work)) != 0)
 		{
-			int diff = alg_fm_result->face_bbox[0].width - alg_fm_result->face_bbox[0].height;
-			pad_sz = alg_fm_result->face_bbox[0].width;
-
-			hx_lib_pad_image((uint8_t*)crop_img, (uint8_t*)pad_img,
-					alg_fm_result->face_bbox[0].width, alg_fm_result->face_bbox[0].height, ch,
-				(diff / 2),  (diff / 2 + diff % 2) , 0,  0, pad_sz, pad_sz);/**pad_top, pad_bottom, pad_left,  pad_right**/
-
+			xprintf("face mesh preproc init fail for %dx%d\n", face_box.w, face_box.h);
+			return -1;
 		}
-		else
-		{
-			pad_sz = alg_fm_result->face_bbox[0].width;
+		hx_img_preproc_run(&fm_preproc, (const uint8_t*)raw_addr, fm_input->data.int8);
 
-			memcpy((void *)crop_img, (void *)pad_img, sizeof(uint8_t)*pad_sz*pad_sz*ch);
-		}
+#if !defined(UART_SEND_ALOGO_RESEULT) && !defined(APP_IRIS_LANDMARK)
+		//recapture image, the raw frame is not read after this
+    	sensordplib_retrigger_capture();
+#endif
 
-		w_scale = (float)(pad_sz- 1) / (FM_INPUT_TENSOR_WIDTH - 1);
-		h_scale = (float)(pad_sz - 1) / (FM_INPUT_TENSOR_HEIGHT - 1);
-		hx_lib_image_resize_helium((uint8_t*)pad_img, (uint8_t*)resized_img,
-					pad_sz, pad_sz, ch, \
-					FM_INPUT_TENSOR_WIDTH, FM_INPUT_TENSOR_HEIGHT,w_scale,h_scale);
-		#ifndef YUV_640_480_INPUT /*RGB_320_240_INPUT*/
-			BGRU3C_to_RGB24((uint8_t*)resized_img, (int8_t*)fm_input->data.int8, FM_INPUT_TENSOR_WIDTH, FM_INPUT_TENSOR_HEIGHT);
-    	#else
-			Y_to_YYY((uint8_t*)resized_img, (int8_t*)fm_input->data.int8, FM_INPUT_TENSOR_WIDTH, FM_INPUT_TENSOR_HEIGHT);
-		#endif
 		invoke_status = fm_int_ptr->Invoke();
 		if(invoke_status != kTfLiteOk)
 		{
@@ -1363,17 +1275,16 @@ static uint32_t algo_tick = 0;
 
 			
 				//LR 0:left, 1:right
-				crop_single_eye_IL((uint8_t*)resized_img, (uint8_t*)crop_eye_l, fm_eye_r_wo_scale_L, &eye_center_L, 0);
+				//LEFT IRIS LANDMARK
+				if(crop_single_eye_IL((const uint8_t*)raw_addr, img_w, img_h, il_input->data.int8, fm_eye_r_wo_scale_L, &eye_center_L, 0) != 0)
+				{
+					xprintf("left iris landmark preproc fail\n");
+					return -1;
+				}
 				#ifdef IL_DEBUG
 				xprintf("eye_center_R.x: %d eye_center_R.y: %d\n",eye_center_R.x,eye_center_R.y);
 				xprintf("eye_center_L.x: %d eye_center_L.y: %d\n",eye_center_L.x,eye_center_L.y);
 				#endif
-				//LEFT IRIS LANDMARK
-				#ifndef YUV_640_480_INPUT /*RGB_320_240_INPUT*/
-					BGRU3C_to_RGB24((uint8_t*)crop_eye_l, (int8_t*)il_input->data.int8, IL_INPUT_TENSOR_WIDTH, IL_INPUT_TENSOR_HEIGHT);
-				#else
-					Y_to_YYY((uint8_t*)crop_eye_l, (int8_t*)il_input->data.int8, IL_INPUT_TENSOR_WIDTH, IL_INPUT_TENSOR_HEIGHT);
-				#endif
 				invoke_status = il_int_ptr->Invoke();
 				if(invoke_status != kTfLiteOk)
 				{
@@ -1391,13 +1302,15 @@ static uint32_t algo_tick = 0;
 				cal_iris_angle(alg_fm_result,0);
 				//RIGHT IRIS LANDMARK
 
-				crop_single_eye_IL((uint8_t*)resized_img, (uint8_t*)crop_eye_r, fm_eye_r_wo_scale_R, &eye_center_R, 1);
-
-				#ifndef YUV_640_480_INPUT /*RGB_320_240_INPUT*/
-					BGRU3C_to_RGB24((uint8_t*)crop_eye_r, (int8_t*)il_input->data.int8, IL_INPUT_TENSOR_WIDTH, IL_INPUT_TENSOR_HEIGHT);
-				#else
-					Y_to_YYY((uint8_t*)crop_eye_r, (int8_t*)il_input->data.int8, IL_INPUT_TENSOR_WIDTH, IL_INPUT_TENSOR_HEIGHT);
-				#endif
+				if(crop_single_eye_IL((const uint8_t*)raw_addr, img_w, img_h, il_input->data.int8, fm_eye_r_wo_scale_R, &eye_center_R, 1) != 0)
+				{
+					xprintf("right iris landmark preproc fail\n");
+					return -1;
+				}
+#ifndef UART_SEND_ALOGO_RESEULT
+				//recapture image, the raw frame is not read after this
+				sensordplib_retrigger_capture();
+#endif
 				invoke_status = il_int_ptr->Invoke();
 				if(invoke_status != kTfLiteOk)
 				{
@@ -1414,6 +1327,13 @@ static uint32_t algo_tick = 0;
 				IL_post_proccessing(il_int_ptr->output(0),il_int_ptr->output(1),alg_fm_result, &eye_center_R, 1);
 				cal_iris_angle(alg_fm_result,1);
 			}
+#ifndef UART_SEND_ALOGO_RESEULT
+			else
+			{
+				//recapture image
+				sensordplib_retrigger_capture();
+			}
+#endif
 			
 #endif//APP_IRIS_LANDMARK
 #ifdef COMPUTE_ANGLE
@@ -1515,7 +1435,20 @@ if( g_trans_type == 0 || g_trans_type == 2)// transfer type is (UART) or (UART &
 		el_fm_face_bbox_algo.emplace_front(temp_el_fm_face_bbox_algo);
 	}
 	send_device_id();
-	event_reply(concat_strings(", ", fm_face_bbox_results_2_json_str(el_fm_face_bbox_algo),", ", algo_tick_2_json_str(algo_tick),", ", fm_point_results_2_json_str(el_fm_point_algo), ", ", img_2_json_str(&temp_el_jpg_img)));
+	// event_reply(concat_strings(", ", fm_face_bbox_results_2_json_str(el_fm_face_bbox_algo),", ", algo_tick_2_json_str(algo_tick),", ", fm_point_results_2_json_str(el_fm_point_algo), ", ", img_2_json_str(&temp_el_jpg_img)));
+	static char send_stream_buffer[SEND_STREAM_BUFFER_SIZE];
+	hx_json_stream send_stream;
+	send_stream_init(&send_stream, send_stream_buffer, sizeof(send_stream_buffer));
+	event_reply_begin(&send_stream);
+	hx_json_puts(&send_stream, ", ");
+	fm_face_bbox_results_2_json_stream(&send_stream, el_fm_face_bbox_algo);
+	hx_json_puts(&send_stream, ", ");
+	algo_tick_2_json_stream(&send_stream, algo_tick);
+	hx_json_puts(&send_stream, ", ");
+	fm_point_results_2_json_stream(&send_stream, el_fm_point_algo);
+	hx_json_puts(&send_stream, ", ");
+	img_2_json_stream(&send_stream, &temp_el_jpg_img);
+	event_reply_end(&send_stream);
 
 }
 else if( g_trans_type == 1)// transfer type is (SPI) 
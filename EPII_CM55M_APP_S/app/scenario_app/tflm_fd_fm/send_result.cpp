@@ -182,7 +182,7 @@ void el_base64_encode(const unsigned char* in, int in_len, char* out) {
         char_array_4[2] = ((char_array_3[1] & 0x0f) << 2) + ((char_array_3[2] & 0xc0) >> 6);
         char_array_4[3] = char_array_3[2] & 0x3f;
 
-        for (j = 0; j < i + 1; j++) *out++ = BASE64_CHARS_TABLE[char_array_4[i]];
+        for (j = 0; j < i + 1; j++) *out++ = BASE64_CHARS_TABLE[char_array_4[j]];
 
         while (i++ < 3) *out++ = '=';
     }
@@ -808,4 +808,223 @@ std::string  algo_tick_2_json_str(uint32_t algo_tick) {
     ss += "]";
 
     return ss;
-}
\ No newline at end of file
+}
+
+
+/*
+ * Streaming variants of the *_2_json_str() functions: same bytes, written
+ * through a hx_json_stream into a fixed buffer that is handed to
+ * send_bytes() (or any other sink) whenever it fills up, so a frame reply
+ * with its base64 JPEG needs no heap.
+ */
+static int send_stream_sink(void* ctx, const char* data, size_t len) {
+    (void)ctx;
+    return send_bytes(data, len) == EL_OK ? 0 : -1;
+}
+
+void send_stream_init(hx_json_stream* s, char* buf, size_t size) {
+    hx_json_stream_init(s, buf, size, send_stream_sink, nullptr);
+}
+
+void event_reply_begin(hx_json_stream* s) {
+    hx_json_puts(s, "\r{\"type\": 1, \"name\": \"INVOKE\", \"code\": ");
+    hx_json_put_int(s, EL_OK);
+    hx_json_puts(s, ", \"data\": {\"count\": 0");
+}
+
+el_err_code_t event_reply_end(hx_json_stream* s) {
+    hx_json_puts(s, "}}\n");
+    return hx_json_flush(s) == 0 ? EL_OK : EL_EIO;
+}
+
+static void put_box_values(hx_json_stream* s, const el_box_t& box) {
+    hx_json_put_uint(s, box.x);
+    hx_json_puts(s, ", ");
+    hx_json_put_uint(s, box.y);
+    hx_json_puts(s, ", ");
+    hx_json_put_uint(s, box.w);
+    hx_json_puts(s, ", ");
+    hx_json_put_uint(s, box.h);
+    hx_json_puts(s, ", ");
+    hx_json_put_uint(s, box.score);
+    hx_json_puts(s, ", ");
+    hx_json_put_uint(s, box.target);
+}
+
+static void put_point(hx_json_stream* s, const char* delim, const el_point_t& point, bool with_score) {
+    hx_json_puts(s, delim);
+    hx_json_puts(s, "[");
+    hx_json_put_uint(s, point.x);
+    hx_json_puts(s, ", ");
+    hx_json_put_uint(s, point.y);
+    hx_json_puts(s, ", ");
+    if (with_score) {
+        hx_json_put_uint(s, point.score);
+        hx_json_puts(s, ", ");
+    }
+    hx_json_put_uint(s, point.target);
+    hx_json_puts(s, "]");
+}
+
+// angle_num values in the order the json_str functions print them
+static void put_angle(hx_json_stream* s, const char* delim, const el_struct_angle& angle, int angle_num) {
+    const int16_t values[] = {angle.yaw,
+                              angle.pitch,
+                              angle.roll,
+                              angle.MAR,
+                              angle.LEAR,
+                              angle.REAR,
+                              angle.left_iris_theta,
+                              angle.left_iris_phi,
+                              angle.right_iris_theta,
+                              angle.right_iris_phi};
+    hx_json_puts(s, delim);
+    hx_json_puts(s, "[");
+    for (int i = 0; i < angle_num; i++) {
+        if (i)
+            hx_json_puts(s, ", ");
+        hx_json_put_int(s, values[i]);
+    }
+    hx_json_puts(s, "]");
+}
+
+static void put_boxes(hx_json_stream* s, const char* key, const std::forward_list<el_box_t>& results) {
+    const char* delim = "";
+
+    hx_json_puts(s, key);
+    for (const auto& box : results) {
+        hx_json_puts(s, delim);
+        hx_json_puts(s, "[");
+        put_box_values(s, box);
+        hx_json_puts(s, "]");
+        delim = ", ";
+    }
+    hx_json_puts(s, "]");
+}
+
+void img_2_json_stream(hx_json_stream* s, const el_img_t* img) {
+    hx_json_puts(s, "\"image\": \"");
+    if (img && img->data && img->size) [[likely]]
+        hx_json_put_base64(s, img->data, img->size);
+    hx_json_puts(s, "\"");
+}
+
+void img_res_2_json_stream(hx_json_stream* s, const el_img_t* img) {
+    hx_json_puts(s, "\"resolution\": [");
+    hx_json_put_uint(s, img->width);
+    hx_json_puts(s, ", ");
+    hx_json_put_uint(s, img->height);
+    hx_json_puts(s, "]");
+}
+
+void algo_tick_2_json_stream(hx_json_stream* s, uint32_t algo_tick) {
+    hx_json_puts(s, "\"algo_tick\": [[");
+    hx_json_put_uint(s, algo_tick);
+    hx_json_puts(s, "]]");
+}
+
+void box_results_2_json_stream(hx_json_stream* s, const std::forward_list<el_box_t>& results) {
+    put_boxes(s, "\"boxes\": [", results);
+}
+
+void fm_face_bbox_results_2_json_stream(hx_json_stream* s, const std::forward_list<el_box_t>& results) {
+    put_boxes(s, "\"fm_face_boxes\": [", results);
+}
+
+void keypoint_results_2_json_stream(hx_json_stream* s, const std::forward_list<el_keypoint_t>& results) {
+    const char* delim = "";
+
+    hx_json_puts(s, "\"keypoints\": [");
+    for (const auto& it : results) {
+        hx_json_puts(s, delim);
+        hx_json_puts(s, "[[");
+        put_box_values(s, it.el_box);
+        hx_json_puts(s, "]");
+        delim = ", [";
+        for (int i = 0; i < KEYPOINT_NUM; i++) {
+            put_point(s, delim, it.el_keypoint[i], true);
+            delim = ", ";
+        }
+        hx_json_puts(s, "]]");
+        delim = ", ";
+    }
+    hx_json_puts(s, "]");
+}
+
+void fm_point_results_2_json_stream(hx_json_stream* s, const std::forward_list<el_fm_point_t>& results) {
+    const char* delim = "";
+
+    hx_json_puts(s, "\"fm_points\": [");
+    for (const auto& it : results) {
+        hx_json_puts(s, delim);
+        hx_json_puts(s, "[[");
+        put_box_values(s, it.el_box);
+        hx_json_puts(s, "]");
+        delim = ", [";
+        for (int i = 0; i < FM_POINT_NUM; i++) {
+            put_point(s, delim, it.el_fm_point[i], true);
+            delim = ", ";
+        }
+        delim = "] , [";
+        for (int i = 0; i < FM_IRIS_POINT_NUM; i++) {
+            put_point(s, delim, it.el_fm_iris[i], true);
+            delim = ", ";
+        }
+        put_angle(s, "] , [", it.el_fm_angle, 10);
+        hx_json_puts(s, "]]");
+        delim = ", ";
+    }
+    hx_json_puts(s, "]");
+}
+
+void fd_fl_results_2_json_stream(hx_json_stream* s, const std::forward_list<el_fd_fl_t>& results) {
+    const char* delim = "";
+
+    hx_json_puts(s, "\"fd_fl\": [");
+    for (const auto& it : results) {
+        hx_json_puts(s, delim);
+        hx_json_puts(s, "[[");
+        put_box_values(s, it.el_box);
+        hx_json_puts(s, "]");
+        delim = ", [";
+        for (int i = 0; i < MAX_FACE_LAND_MARK_TRACKED_POINT; i++) {
+            put_point(s, delim, it.el_fl[i], false);
+            delim = ", ";
+        }
+        put_angle(s, "] , [", it.el_fl_angle, 6);
+        hx_json_puts(s, "]]");
+        delim = ", ";
+    }
+    hx_json_puts(s, "]");
+}
+
+void fd_fl_el_9t_results_2_json_stream(hx_json_stream* s, const std::forward_list<el_fd_fl_el_9pt_t>& results) {
+    const char* delim = "";
+
+    hx_json_puts(s, "\"fd_fl_el_9pt\": [");
+    for (const auto& it : results) {
+        hx_json_puts(s, delim);
+        hx_json_puts(s, "[[");
+        put_box_values(s, it.el_box);
+        hx_json_puts(s, "]");
+        delim = ", [";
+        for (int i = 0; i < MAX_FACE_LAND_MARK_TRACKED_POINT; i++) {
+            put_point(s, delim, it.el_fl[i], false);
+            delim = ", ";
+        }
+        delim = "] , [";
+        for (int i = 0; i < 9; i++) {
+            put_point(s, delim, it.left_eye_landmark[i], false);
+            delim = ", ";
+        }
+        delim = "] , [";
+        for (int i = 0; i < 9; i++) {
+            put_point(s, delim, it.right_eye_landmark[i], false);
+            delim = ", ";
+        }
+        put_angle(s, "] , [", it.el_fl_angle, 10);
+        hx_json_puts(s, "]]");
+        delim = ", ";
+    }
+    hx_json_puts(s, "]");
+}
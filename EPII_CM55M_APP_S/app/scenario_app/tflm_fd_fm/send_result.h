@@ -13,10 +13,12 @@
 extern "C" {
 #include "hx_drv_swreg_aon.h"
 }
+#include "hx_json_stream.h"
 #define CONSOLE_UART_ID 0
 #define EL_ATTR_WEAK __attribute__((weak))
 #define EL_VERSION                 __TIMESTAMP__
 #define CONFIG_SSCMA_CMD_MAX_LENGTH (4096)
+#define SEND_STREAM_BUFFER_SIZE (1024)
 #define KEYPOINT_NUM 17
 #define FM_POINT_NUM 468
 #define FM_IRIS_POINT_NUM 10
@@ -180,4 +182,28 @@ std::string  img_res_2_json_str(const el_img_t* img);
 std::string  algo_tick_2_json_str(uint32_t algo_tick);
 std::string  fd_fl_results_2_json_str(std::forward_list<el_fd_fl_t>& results);
 std::string  fd_fl_el_9t_results_2_json_str(std::forward_list<el_fd_fl_el_9pt_t>& results);
-std::string  fm_face_bbox_results_2_json_str(std::forward_list<el_box_t>& results);
\ No newline at end of file
+std::string  fm_face_bbox_results_2_json_str(std::forward_list<el_box_t>& results);
+
+/*
+ * Streaming variants: byte-for-byte the output of the matching
+ * *_2_json_str() / event_reply(), written through s without heap use.
+ *
+ *   send_stream_init(&s, buf, sizeof(buf));
+ *   event_reply_begin(&s);
+ *   hx_json_puts(&s, ", ");
+ *   box_results_2_json_stream(&s, el_algo);
+ *   ...
+ *   event_reply_end(&s);
+ */
+void send_stream_init(hx_json_stream* s, char* buf, size_t size);
+void event_reply_begin(hx_json_stream* s);
+el_err_code_t event_reply_end(hx_json_stream* s);
+void img_2_json_stream(hx_json_stream* s, const el_img_t* img);
+void img_res_2_json_stream(hx_json_stream* s, const el_img_t* img);
+void algo_tick_2_json_stream(hx_json_stream* s, uint32_t algo_tick);
+void box_results_2_json_stream(hx_json_stream* s, const std::forward_list<el_box_t>& results);
+void fm_face_bbox_results_2_json_stream(hx_json_stream* s, const std::forward_list<el_box_t>& results);
+void keypoint_results_2_json_stream(hx_json_stream* s, const std::forward_list<el_keypoint_t>& results);
+void fm_point_results_2_json_stream(hx_json_stream* s, const std::forward_list<el_fm_point_t>& results);
+void fd_fl_results_2_json_stream(hx_json_stream* s, const std::forward_list<el_fd_fl_t>& results);
+void fd_fl_el_9t_results_2_json_stream(hx_json_stream* s, const std::forward_list<el_fd_fl_el_9pt_t>& results);
\ No newline at end of file
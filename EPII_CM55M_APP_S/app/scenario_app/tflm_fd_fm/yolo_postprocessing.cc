@@ -2,53 +2,18 @@
 #include <math.h>
 #include "yolo_postprocessing.h"
 #include <cstdio>
-#include <algorithm>
-
-static int sort_class;
-
-void free_dets(std::forward_list<detection> &dets){
-    std::forward_list<detection>::iterator it;
-    for ( it = dets.begin(); it != dets.end(); ++it ){
-        free(it->prob);
-    }
-}
 
 float sigmoid(float x)
 {
     return 1.f/(1.f + exp(-x));
 } 
 
-bool det_objectness_comparator(detection &pa, detection &pb)
+void get_network_boxes(network *net, int image_w, int image_h, float thresh, hx_nms_boxes *dets)
 {
-    return pa.objectness < pb.objectness;
-}
-
-void insert_topN_det(std::forward_list<detection> &dets, detection det){
-    std::forward_list<detection>::iterator it;
-    std::forward_list<detection>::iterator last_it;
-    for ( it = dets.begin(); it != dets.end(); ++it ){
-        if(it->objectness > det.objectness)
-            break;
-        last_it = it;
-    }
-    if(it != dets.begin()){
-        dets.emplace_after(last_it, det);
-        free(dets.begin()->prob);
-        dets.pop_front();
-    }
-    else{
-        free(det.prob);
-    }
-}
-
-std::forward_list<detection> get_network_boxes(network *net, int image_w, int image_h, float thresh, int *num)
-{
-    std::forward_list<detection> dets;
-    int i;
     int num_classes = net->num_classes;
-    *num = 0;
 
-    for (i = 0; i < net->num_branch; ++i) {
+    hx_nms_reset(dets);
+    for (int i = 0; i < net->num_branch; ++i) {
         int height  = net->branchs[i].resolution;
         int width = net->branchs[i].resolution;
         int channel  = net->branchs[i].num_box*(5+num_classes);
@@ -62,62 +27,46 @@ std::forward_list<detection> get_network_boxes(network *net, int image_w, int im
                     float objectness = sigmoid(((float)net->branchs[i].tf_output[bbox_obj_offset] - net->branchs[i].zero_point) * net->branchs[i].scale);
 
                     if(objectness > thresh){
-                        detection det;
-                        det.prob = (float*)calloc(num_classes, sizeof(float));
-                        det.objectness = objectness;
+                        box bbox;
                         //get bbox prediction data for each anchor, each feature point
                         int bbox_x_offset = bbox_obj_offset -4;
                         int bbox_y_offset = bbox_x_offset + 1;
                         int bbox_w_offset = bbox_x_offset + 2;
                         int bbox_h_offset = bbox_x_offset + 3;
                         int bbox_scores_offset = bbox_x_offset + 5;
-                        //int bbox_scores_step = 1;
-                        det.bbox.x = ((float)net->branchs[i].tf_output[bbox_x_offset] - net->branchs[i].zero_point) * net->branchs[i].scale;
-                        det.bbox.y = ((float)net->branchs[i].tf_output[bbox_y_offset] - net->branchs[i].zero_point) * net->branchs[i].scale;
-                        det.bbox.w = ((float)net->branchs[i].tf_output[bbox_w_offset] - net->branchs[i].zero_point) * net->branchs[i].scale;
-                        det.bbox.h = ((float)net->branchs[i].tf_output[bbox_h_offset] - net->branchs[i].zero_point) * net->branchs[i].scale;
+                        bbox.x = ((float)net->branchs[i].tf_output[bbox_x_offset] - net->branchs[i].zero_point) * net->branchs[i].scale;
+                        bbox.y = ((float)net->branchs[i].tf_output[bbox_y_offset] - net->branchs[i].zero_point) * net->branchs[i].scale;
+                        bbox.w = ((float)net->branchs[i].tf_output[bbox_w_offset] - net->branchs[i].zero_point) * net->branchs[i].scale;
+                        bbox.h = ((float)net->branchs[i].tf_output[bbox_h_offset] - net->branchs[i].zero_point) * net->branchs[i].scale;
 
                         float bbox_x, bbox_y;
 
                         // Eliminate grid sensitivity trick involved in YOLOv4
-                        bbox_x = sigmoid(det.bbox.x); //* net->branchs[i].scale_x_y - (net->branchs[i].scale_x_y - 1) / 2;
-                        bbox_y = sigmoid(det.bbox.y); //* net->branchs[i].scale_x_y - (net->branchs[i].scale_x_y - 1) / 2;
-                        det.bbox.x = (bbox_x + w) / width;
-                        det.bbox.y = (bbox_y + h) / height;
+                        bbox_x = sigmoid(bbox.x); //* net->branchs[i].scale_x_y - (net->branchs[i].scale_x_y - 1) / 2;
+                        bbox_y = sigmoid(bbox.y); //* net->branchs[i].scale_x_y - (net->branchs[i].scale_x_y - 1) / 2;
+                        bbox.x = (bbox_x + w) / width;
+                        bbox.y = (bbox_y + h) / height;
 
-                        det.bbox.w = exp(det.bbox.w) * net->branchs[i].anchor[anc*2] / net->input_w;
-                        det.bbox.h = exp(det.bbox.h) * net->branchs[i].anchor[anc*2+1] / net->input_h;
-
-                        for (int s = 0; s < num_classes; s++) {
-                            det.prob[s] = sigmoid(((float)net->branchs[i].tf_output[bbox_scores_offset + s] - net->branchs[i].zero_point) * net->branchs[i].scale)*objectness;
-                            det.prob[s] = (det.prob[s] > thresh) ? det.prob[s] : 0;
-                        }
+                        bbox.w = exp(bbox.w) * net->branchs[i].anchor[anc*2] / net->input_w;
+                        bbox.h = exp(bbox.h) * net->branchs[i].anchor[anc*2+1] / net->input_h;
 
                         //correct_yolo_boxes 
-                        det.bbox.x *= image_w;
-                        det.bbox.w *= image_w;
-                        det.bbox.y *= image_h;
-                        det.bbox.h *= image_h;
+                        bbox.x *= image_w;
+                        bbox.w *= image_w;
+                        bbox.y *= image_h;
+                        bbox.h *= image_h;
 
-                        if (*num < net->topN || net->topN <=0){
-                            dets.emplace_front(det);
-                            *num += 1;
-                        }
-                        else if(*num ==  net->topN){
-                            dets.sort(det_objectness_comparator);
-                            insert_topN_det(dets,det);
-                            *num += 1;
-                        }else{
-                            insert_topN_det(dets,det);
+                        // one candidate per class above thresh, the class is the NMS group
+                        for (int s = 0; s < num_classes; s++) {
+                            float prob = sigmoid(((float)net->branchs[i].tf_output[bbox_scores_offset + s] - net->branchs[i].zero_point) * net->branchs[i].scale)*objectness;
+                            if (prob > thresh)
+                                hx_nms_add_center(dets, bbox.x, bbox.y, bbox.w, bbox.h, prob, s);
                         }
                     }
                 }
             }
         }
     }
-    if(*num > net->topN)
-        *num -=1;
-    return dets;
 }
 
 // init part
@@ -144,120 +93,3 @@ network creat_network(int input_w, int input_h, int num_classes, int num_branch,
     net.topN = topN;
     return net;
 }
-
-// NMS part
-
-float overlap(float x1, float w1, float x2, float w2)
-{
-    float l1 = x1 - w1/2;
-    float l2 = x2 - w2/2;
-    float left = l1 > l2 ? l1 : l2;
-    float r1 = x1 + w1/2;
-    float r2 = x2 + w2/2;
-    float right = r1 < r2 ? r1 : r2;
-    return right - left;
-}
-
-float box_intersection(box a, box b)
-{
-    float w = overlap(a.x, a.w, b.x, b.w);
-    float h = overlap(a.y, a.h, b.y, b.h);
-    if(w < 0 || h < 0) return 0;
-    float area = w*h;
-    return area;
-}
-
-float box_union(box a, box b)
-{
-    float i = box_intersection(a, b);
-    float u = a.w*a.h + b.w*b.h - i;
-    return u;
-}
-
-float box_iou(box a, box b)
-{
-    float I = box_intersection(a, b);
-    float U = box_union(a, b);
-    if (I == 0 || U == 0) {
-        return 0;
-    }
-    return I / U;
-}
-
-bool det_comparator(detection &pa, detection &pb)
-{
-    return pa.prob[sort_class] > pb.prob[sort_class];
-}
-
-void do_nms_sort(std::forward_list<detection> &dets, int classes, float thresh)
-{
-    int k;
-    
-    for (k = 0; k < classes; ++k) {
-        sort_class = k;
-        dets.sort(det_comparator);
-        
-        for (std::forward_list<detection>::iterator it=dets.begin(); it != dets.end(); ++it){
-            if (it->prob[k] == 0) continue;
-            for (std::forward_list<detection>::iterator itc=std::next(it, 1); itc != dets.end(); ++itc){
-                if (itc->prob[k] == 0) continue;
-                if (box_iou(it->bbox, itc->bbox) > thresh) {
-                    itc->prob[k] = 0;
-                }
-            }
-        }
-    }
-}
-
-
-boxabs box_c(box a, box b) {
-    boxabs ba;//
-    ba.top = 0;
-    ba.bot = 0;
-    ba.left = 0;
-    ba.right = 0;
-    ba.top = fmin(a.y - a.h / 2, b.y - b.h / 2);
-    ba.bot = fmax(a.y + a.h / 2, b.y + b.h / 2);
-    ba.left = fmin(a.x - a.w / 2, b.x - b.w / 2);
-    ba.right = fmax(a.x + a.w / 2, b.x + b.w / 2);
-    return ba;
-}
-
-
-float box_diou(box a, box b)
-{
-    boxabs ba = box_c(a, b);
-    float w = ba.right - ba.left;
-    float h = ba.bot - ba.top;
-    float c = w * w + h * h;
-    float iou = box_iou(a, b);
-    if (c == 0) {
-        return iou;
-    }
-    float d = (a.x - b.x) * (a.x - b.x) + (a.y - b.y) * (a.y - b.y);
-    float u = pow(d / c, 0.6);
-    float diou_term = u;
-
-    return iou - diou_term;
-}
-
-
-void diounms_sort(std::forward_list<detection> &dets, int classes, float thresh)
-{
-    int k;
-    
-    for (k = 0; k < classes; ++k) {
-        sort_class = k;
-        dets.sort(det_comparator);
-        
-        for (std::forward_list<detection>::iterator it=dets.begin(); it != dets.end(); ++it){
-            if (it->prob[k] == 0) continue;
-            for (std::forward_list<detection>::iterator itc=std::next(it, 1); itc != dets.end(); ++itc){
-                if (itc->prob[k] == 0) continue;
-                if (box_diou(it->bbox, itc->bbox) > thresh) {
-                    itc->prob[k] = 0;
-                }
-            }
-        }
-    }
-}
@@ -3,11 +3,7 @@
 
 #include <stdint.h>
 #include <forward_list>
-
-typedef struct boxabs {
-    float left, right, top, bot;
-} boxabs;
-
+#include "hx_nms.h"
 
 typedef struct branch {
     int resolution;
@@ -34,20 +30,15 @@ typedef struct box {
     float x, y, w, h;
 } box;
 
-typedef struct detection{
-    box bbox;
-    float *prob;
-    float objectness;
-} detection;
-
 branch create_brach(int resolution, int num_box, float *anchor, int8_t *tf_output, size_t size, float scale, int zero_point);
 network creat_network(int input_w, int input_h, int num_classes, int num_branch, branch* branchs, int topN);
 
-std::forward_list<detection> get_network_boxes(network *net, int image_w, int image_h, float thresh, int *num);
-
-void do_nms_sort(std::forward_list<detection> &dets, int classes, float thresh);
-void diounms_sort(std::forward_list<detection> &dets, int classes, float thresh);
+/**
+ * Decodes every anchor with objectness and class probability above thresh
+ * into dets (center converted to top-left, in image_w x image_h pixels),
+ * one candidate per class with the class index as NMS group.
+ */
+void get_network_boxes(network *net, int image_w, int image_h, float thresh, hx_nms_boxes *dets);
 
-void free_dets(std::forward_list<detection> &dets);
 float sigmoid(float x);
 #endif
@@ -27,6 +27,8 @@
 
 #include "img_proc_helium.h"
 #include "yolo_postprocessing.h"
+#include "hx_nms.h"
+#include "hx_img_preproc.h"
 
 
 #include "xprintf.h"
@@ -69,6 +71,9 @@ static uint32_t capture_image_tick = 0;
 #endif
 
 
+static hx_img_preproc yolo11n_ob_preproc;
+static int16_t yolo11n_ob_preproc_work[HX_IMG_PREPROC_WORK_SIZE(DP_INP_OUT_WIDTH, YOLO11_OB_INPUT_TENSOR_WIDTH, 3) / 2];
+
 using namespace std;
 
 namespace {
@@ -534,54 +539,6 @@ int cv_yolo11n_ob_init(bool security_enable, bool privilege_enable, uint32_t mod
 
 
 
-typedef struct detection_cls_yolo11{
-    box bbox;
-    float confidence;
-    float index;
-
-} detection_cls_yolo11;
-
-static bool yolo11_det_comparator(detection_cls_yolo11 &pa, detection_cls_yolo11 &pb)
-{
-    return pa.confidence > pb.confidence;
-}
-
-static void  yolo11_NMSBoxes(std::vector<box> &boxes,std::vector<float> &confidences,float modelScoreThreshold,float modelNMSThreshold,std::vector<int>& nms_result)
-{
-    detection_cls_yolo11 yolo11_bbox;
-    std::vector<detection_cls_yolo11> yolo11_bboxes{};
-    for(int i = 0; i < boxes.size(); i++)
-    {
-        yolo11_bbox.bbox = boxes[i];
-        yolo11_bbox.confidence = confidences[i];
-        yolo11_bbox.index = i;
-        yolo11_bboxes.push_back(yolo11_bbox);
-    }
-    sort(yolo11_bboxes.begin(), yolo11_bboxes.end(), yolo11_det_comparator);
-    int updated_size = yolo11_bboxes.size();
-    for(int k = 0; k < updated_size; k++)
-    {
-        if(yolo11_bboxes[k].confidence < modelScoreThreshold)
-        {
-            continue;
-        }
-        
-        nms_result.push_back(yolo11_bboxes[k].index);
-        for(int j = k + 1; j < updated_size; j++)
-        {
-            float iou = box_iou(yolo11_bboxes[k].bbox, yolo11_bboxes[j].bbox);
-            // float iou = box_diou(yolo11_bboxes[k].bbox, yolo11_bboxes[j].bbox);
-            if(iou > modelNMSThreshold)
-            {
-                yolo11_bboxes.erase(yolo11_bboxes.begin() + j);
-                updated_size = yolo11_bboxes.size();
-                j = j -1;
-            }
-        }
-
-    }
-}
-
 #if YOLO11_NO_POST_SEPARATE_OUTPUT
 static void yolo11_ob_post_processing(tflite::MicroInterpreter* static_interpreter,float modelScoreThreshold, float modelNMSThreshold, struct_yolov8_ob_algoResult *alg,	std::forward_list<el_box_t> &el_algo)
 {
@@ -621,9 +578,8 @@ static void yolo11_ob_post_processing(tflite::MicroInterpreter* static_interpret
 	int input_w = YOLO11_OB_INPUT_TENSOR_WIDTH;
 	int input_h = YOLO11_OB_INPUT_TENSOR_HEIGHT;
 
-	std::vector<uint16_t> class_idxs;
-	std::vector<float> confidences;
-	std::vector<box> boxes;
+	static hx_nms_boxes candidates;
+	hx_nms_reset(&candidates);
 
 	#if YOLO11_POST_EACH_STEP_TICK
 		SystemGetTick(&systick_1, &loop_cnt_1);
@@ -679,9 +635,7 @@ static void yolo11_ob_post_processing(tflite::MicroInterpreter* static_interpret
 		{
 			box bbox;
 			yolo11_nopost_cal_xywh(j,dims_cnt_1, dims_cnt_2,output[output_data_idx],&bbox, anchor_756_2,stride_756_1 );
-			boxes.push_back(bbox);
-			class_idxs.push_back(maxClassIndex);
-			confidences.push_back(maxScore);
+			hx_nms_add(&candidates, bbox.x, bbox.y, bbox.w, bbox.h, maxScore, maxClassIndex);
 			
 		}
 	}
@@ -691,38 +645,37 @@ static void yolo11_ob_post_processing(tflite::MicroInterpreter* static_interpret
 		dbg_printf(DBG_LESS_INFO,"Tick for dequantize the output result for box for yolo11 OB:[%d]\r\n",(loop_cnt_2-loop_cnt_1)*CPU_CLK+(systick_1-systick_2));							
 	#endif
 	#if DBG_APP_LOG
-		xprintf("boxes.size(): %d\r\n",boxes.size());
+		xprintf("boxes.size(): %d\r\n",candidates.count);
 	#endif
 	/**
 	 * do nms
 	 * 
 	 * **/
 
-	std::vector<int> nms_result;
-	yolo11_NMSBoxes(boxes, confidences, modelScoreThreshold, modelNMSThreshold, nms_result);
+	uint16_t nms_result[MAX_TRACKED_YOLOV8_ALGO_RES];
+	int nms_count = hx_nms_run(&candidates, modelNMSThreshold, HX_NMS_CLASS_AGNOSTIC, 0, MAX_TRACKED_YOLOV8_ALGO_RES, nms_result);
 	#if DBG_APP_LOG
-		xprintf("nms_result.size(): %d\r\n",nms_result.size());
+		xprintf("nms_result.size(): %d\r\n",nms_count);
 	#endif
-	for (int i = 0; i < nms_result.size(); i++)
+	for (int i = 0; i < nms_count; i++)
 	{
-		if(!(MAX_TRACKED_YOLOV8_ALGO_RES-i))break;
 		int idx = nms_result[i];
 
 		float scale_factor_w = (float)img_w / (float)YOLO11_OB_INPUT_TENSOR_WIDTH; 
 		float scale_factor_h = (float)img_h / (float)YOLO11_OB_INPUT_TENSOR_HEIGHT; 
-		alg->obr[i].confidence = confidences[idx];
-		alg->obr[i].bbox.x = (uint32_t)(boxes[idx].x * scale_factor_w);
-		alg->obr[i].bbox.y = (uint32_t)(boxes[idx].y * scale_factor_h);
-		alg->obr[i].bbox.width = (uint32_t)(boxes[idx].w * scale_factor_w);
-		alg->obr[i].bbox.height = (uint32_t)(boxes[idx].h * scale_factor_h);
-		alg->obr[i].class_idx = class_idxs[idx];
+		alg->obr[i].confidence = candidates.score[idx];
+		alg->obr[i].bbox.x = (uint32_t)(candidates.x[idx] * scale_factor_w);
+		alg->obr[i].bbox.y = (uint32_t)(candidates.y[idx] * scale_factor_h);
+		alg->obr[i].bbox.width = (uint32_t)(candidates.w[idx] * scale_factor_w);
+		alg->obr[i].bbox.height = (uint32_t)(candidates.h[idx] * scale_factor_h);
+		alg->obr[i].class_idx = candidates.group[idx];
 		el_box_t temp_el_box;
-		temp_el_box.score =  confidences[idx]*100;
-		temp_el_box.target =  class_idxs[idx];
-		temp_el_box.x = (uint32_t)(boxes[idx].x * scale_factor_w);
-		temp_el_box.y =  (uint32_t)(boxes[idx].y * scale_factor_h);
-		temp_el_box.w = (uint32_t)(boxes[idx].w * scale_factor_w);
-		temp_el_box.h = (uint32_t)(boxes[idx].h * scale_factor_h);
+		temp_el_box.score =  candidates.score[idx]*100;
+		temp_el_box.target =  candidates.group[idx];
+		temp_el_box.x = (uint32_t)(candidates.x[idx] * scale_factor_w);
+		temp_el_box.y =  (uint32_t)(candidates.y[idx] * scale_factor_h);
+		temp_el_box.w = (uint32_t)(candidates.w[idx] * scale_factor_w);
+		temp_el_box.h = (uint32_t)(candidates.h[idx] * scale_factor_h);
 
 
 		// printf("temp_el_box.x %d,temp_el_box.y: %d\r\n",temp_el_box.x,temp_el_box.y);
@@ -731,7 +684,7 @@ static void yolo11_ob_post_processing(tflite::MicroInterpreter* static_interpret
 		// 	printf("el_algo.box.x %d,el_algo.box.y%d\r\n",box.x,box.y);
 		// }
 		#if YOLO11N_OB_DBG_APP_LOG
-			printf("detect object[%d]: %s confidences: %f\r\n",i, coco_classes[class_idxs[idx]].c_str(),confidences[idx]);
+			printf("detect object[%d]: %s confidences: %f\r\n",i, coco_classes[candidates.group[idx]].c_str(),candidates.score[idx]);
 
 		#endif
 	}
@@ -753,9 +706,8 @@ static void yolo11_ob_post_processing(tflite::MicroInterpreter* static_interpret
 	int input_w = YOLO11_OB_INPUT_TENSOR_WIDTH;
 	int input_h = YOLO11_OB_INPUT_TENSOR_HEIGHT;
 
-	std::vector<uint16_t> class_idxs;
-	std::vector<float> confidences;
-	std::vector<box> boxes;
+	static hx_nms_boxes candidates;
+	hx_nms_reset(&candidates);
 
 
 	float output_scale = ((TfLiteAffineQuantization*)(output->quantization.params))->scale->data[0];
@@ -822,42 +774,39 @@ static void yolo11_ob_post_processing(tflite::MicroInterpreter* static_interpret
 			bbox.y = (outputs_bbox_data[1] - (0.5 * outputs_bbox_data[3]));
 			bbox.w =(outputs_bbox_data[2]);
 			bbox.h = (outputs_bbox_data[3]);
-			boxes.push_back(bbox);
-			class_idxs.push_back(maxClassIndex);
-			confidences.push_back(maxScore);
+			hx_nms_add(&candidates, bbox.x, bbox.y, bbox.w, bbox.h, maxScore, maxClassIndex);
 			
 		}
 	}
 	#if YOLO11N_OB_DBG_APP_LOG
-		xprintf("boxes.size(): %d\r\n",boxes.size());
+		xprintf("boxes.size(): %d\r\n",candidates.count);
 	#endif
 	/**
 	 * do nms
 	 * 
 	 * **/
 
-	std::vector<int> nms_result;
-	yolo11_NMSBoxes(boxes, confidences, modelScoreThreshold, modelNMSThreshold, nms_result);
-	for (int i = 0; i < nms_result.size(); i++)
+	uint16_t nms_result[MAX_TRACKED_YOLOV8_ALGO_RES];
+	int nms_count = hx_nms_run(&candidates, modelNMSThreshold, HX_NMS_CLASS_AGNOSTIC, 0, MAX_TRACKED_YOLOV8_ALGO_RES, nms_result);
+	for (int i = 0; i < nms_count; i++)
 	{
-		if(!(MAX_TRACKED_YOLOV8_ALGO_RES-i))break;
 		int idx = nms_result[i];
 
 		float scale_factor_w = (float)img_w / (float)YOLO11_OB_INPUT_TENSOR_WIDTH; 
 		float scale_factor_h = (float)img_h / (float)YOLO11_OB_INPUT_TENSOR_HEIGHT; 
-		alg->obr[i].confidence = confidences[idx];
-		alg->obr[i].bbox.x = (uint32_t)(boxes[idx].x * scale_factor_w);
-		alg->obr[i].bbox.y = (uint32_t)(boxes[idx].y * scale_factor_h);
-		alg->obr[i].bbox.width = (uint32_t)(boxes[idx].w * scale_factor_w);
-		alg->obr[i].bbox.height = (uint32_t)(boxes[idx].h * scale_factor_h);
-		alg->obr[i].class_idx = class_idxs[idx];
+		alg->obr[i].confidence = candidates.score[idx];
+		alg->obr[i].bbox.x = (uint32_t)(candidates.x[idx] * scale_factor_w);
+		alg->obr[i].bbox.y = (uint32_t)(candidates.y[idx] * scale_factor_h);
+		alg->obr[i].bbox.width = (uint32_t)(candidates.w[idx] * scale_factor_w);
+		alg->obr[i].bbox.height = (uint32_t)(candidates.h[idx] * scale_factor_h);
+		alg->obr[i].class_idx = candidates.group[idx];
 		el_box_t temp_el_box;
-		temp_el_box.score =  confidences[idx]*100;
-		temp_el_box.target =  class_idxs[idx];
-		temp_el_box.x = (uint32_t)(boxes[idx].x * scale_factor_w);
-		temp_el_box.y =  (uint32_t)(boxes[idx].y * scale_factor_h);
-		temp_el_box.w = (uint32_t)(boxes[idx].w * scale_factor_w);
-		temp_el_box.h = (uint32_t)(boxes[idx].h * scale_factor_h);
+		temp_el_box.score =  candidates.score[idx]*100;
+		temp_el_box.target =  candidates.group[idx];
+		temp_el_box.x = (uint32_t)(candidates.x[idx] * scale_factor_w);
+		temp_el_box.y =  (uint32_t)(candidates.y[idx] * scale_factor_h);
+		temp_el_box.w = (uint32_t)(candidates.w[idx] * scale_factor_w);
+		temp_el_box.h = (uint32_t)(candidates.h[idx] * scale_factor_h);
 
 
 		// printf("temp_el_box.x %d,temp_el_box.y: %d\r\n",temp_el_box.x,temp_el_box.y);
@@ -866,7 +815,7 @@ static void yolo11_ob_post_processing(tflite::MicroInterpreter* static_interpret
 		// 	printf("el_algo.box.x %d,el_algo.box.y%d\r\n",box.x,box.y);
 		// }
 		#if YOLO11N_OB_DBG_APP_LOG
-			printf("detect object[%d]: %s confidences: %f\r\n",i, coco_classes[class_idxs[idx]].c_str(),confidences[idx]);
+			printf("detect object[%d]: %s confidences: %f\r\n",i, coco_classes[candidates.group[idx]].c_str(),candidates.score[idx]);
 
 		#endif
 	}
@@ -876,8 +825,6 @@ static void yolo11_ob_post_processing(tflite::MicroInterpreter* static_interpret
 
 int cv_yolo11n_ob_run(struct_yolov8_ob_algoResult *algoresult_yolo11n_ob) {
 	int ercode = 0;
-    float w_scale;
-    float h_scale;
     uint32_t img_w = app_get_raw_width();
     uint32_t img_h = app_get_raw_height();
     uint32_t ch = app_get_raw_channels();
@@ -896,33 +843,20 @@ int cv_yolo11n_ob_run(struct_yolov8_ob_algoResult *algoresult_yolo11n_ob) {
 		#ifdef EACH_STEP_TICK
 			SystemGetTick(&systick_1, &loop_cnt_1);
 		#endif
-    	//get image from sensor and resize
-		w_scale = (float)(img_w - 1) / (YOLO11_OB_INPUT_TENSOR_WIDTH - 1);
-		h_scale = (float)(img_h - 1) / (YOLO11_OB_INPUT_TENSOR_HEIGHT - 1);
-
-		
-		hx_lib_image_resize_BGR8U3C_to_RGB24_helium((uint8_t*)raw_addr, (uint8_t*)yolo11n_ob_input->data.data,  
-		                    img_w, img_h, ch, 
-                        	YOLO11_OB_INPUT_TENSOR_WIDTH, YOLO11_OB_INPUT_TENSOR_HEIGHT, w_scale,h_scale);
-		#ifdef EACH_STEP_TICK						
+    	//get image from sensor, resize, reorder to RGB24 and shift to int8 in one pass
+		if(yolo11n_ob_preproc.in_w != (int)img_w || yolo11n_ob_preproc.in_h != (int)img_h) {
+			if(hx_img_preproc_init(&yolo11n_ob_preproc, HX_IMG_PREPROC_BGR8U3C_TO_RGB24, img_w, img_h,
+					YOLO11_OB_INPUT_TENSOR_WIDTH, YOLO11_OB_INPUT_TENSOR_HEIGHT, yolo11n_ob_preproc_work, sizeof(yolo11n_ob_preproc_work)) != 0) {
+				xprintf("preproc init fail for %dx%d\r\n", img_w, img_h);
+				return -1;
+			}
+		}
+		hx_img_preproc_run(&yolo11n_ob_preproc, (const uint8_t*)raw_addr, yolo11n_ob_input->data.int8);
+		#ifdef EACH_STEP_TICK
 			SystemGetTick(&systick_2, &loop_cnt_2);
-			dbg_printf(DBG_LESS_INFO,"Tick for resize image BGR8U3C_to_RGB24_helium for yolo11 OB:[%d]\r\n",(loop_cnt_2-loop_cnt_1)*CPU_CLK+(systick_1-systick_2));							
+			dbg_printf(DBG_LESS_INFO,"Tick for resize + RGB24 + int8 preprocessing for yolo11 OB:[%d]\r\n",(loop_cnt_2-loop_cnt_1)*CPU_CLK+(systick_1-systick_2));
 		#endif
 
-		#ifdef EACH_STEP_TICK
-			SystemGetTick(&systick_1, &loop_cnt_1);
-		#endif
-
-		// //uint8 to int8
-		for (int i = 0; i < yolo11n_ob_input->bytes; ++i) {
-			*((int8_t *)yolo11n_ob_input->data.data+i) = *((int8_t *)yolo11n_ob_input->data.data+i) - 128;
-    	}
-
-		#ifdef EACH_STEP_TICK
-		SystemGetTick(&systick_2, &loop_cnt_2);
-		dbg_printf(DBG_LESS_INFO,"Tick for Invoke for uint8toint8 for YOLO11_OB:[%d]\r\n\n",(loop_cnt_2-loop_cnt_1)*CPU_CLK+(systick_1-systick_2));    
-		#endif	
-
 		#ifdef EACH_STEP_TICK
 		SystemGetTick(&systick_1, &loop_cnt_1);
 		#endif
@@ -972,7 +906,7 @@ uint32_t judge_case_data;
 uint32_t g_trans_type;
 hx_drv_swreg_aon_get_appused1(&judge_case_data);
 g_trans_type = (judge_case_data>>16);
-if( g_trans_type == 0 || g_trans_type == 2)// transfer type is (UART) or (UART & SPI) 
+if( g_trans_type == 0 || g_trans_type == 2 || g_trans_type == 3)// transfer type is (UART), (UART & SPI) or (UART binary)
 {
 	//invalid dcache to let uart can send the right jpeg img out
 	hx_InvalidateDCache_by_Addr((volatile void *)app_get_jpeg_addr(), sizeof(uint8_t) *app_get_jpeg_sz());
@@ -985,9 +919,32 @@ if( g_trans_type == 0 || g_trans_type == 2)// transfer type is (UART) or (UART &
 	temp_el_jpg_img.format = EL_PIXEL_FORMAT_JPEG;
 	temp_el_jpg_img.rotate = EL_PIXEL_ROTATE_0;
 
-	send_device_id();
-	// event_reply(concat_strings(", ", box_results_2_json_str(el_algo), ", ", img_2_json_str(&temp_el_jpg_img)));
-	event_reply(concat_strings(", ", algo_tick_2_json_str(algoresult_yolo11n_ob->algo_tick),", ", box_results_2_json_str(el_algo), ", ", img_2_json_str(&temp_el_jpg_img)));
+	static char send_stream_buffer[SEND_STREAM_BUFFER_SIZE];
+	hx_json_stream send_stream;
+	send_stream_init(&send_stream, send_stream_buffer, sizeof(send_stream_buffer));
+	if( g_trans_type == 3)// binary frame, see send_result.h
+	{
+		el_bin_frame_t bin_frame;
+		bin_reply_begin(&bin_frame, &send_stream, algo_tick_2_bin_size() + box_results_2_bin_size(el_algo) + img_2_bin_size(&temp_el_jpg_img));
+		algo_tick_2_bin(&bin_frame, algoresult_yolo11n_ob->algo_tick);
+		box_results_2_bin(&bin_frame, el_algo);
+		img_2_bin(&bin_frame, &temp_el_jpg_img);
+		bin_reply_end(&bin_frame);
+	}
+	else
+	{
+		send_device_id();
+		// event_reply(concat_strings(", ", box_results_2_json_str(el_algo), ", ", img_2_json_str(&temp_el_jpg_img)));
+		// event_reply(concat_strings(", ", algo_tick_2_json_str(algoresult_yolo11n_ob->algo_tick),", ", box_results_2_json_str(el_algo), ", ", img_2_json_str(&temp_el_jpg_img)));
+		event_reply_begin(&send_stream);
+		hx_json_puts(&send_stream, ", ");
+		algo_tick_2_json_stream(&send_stream, algoresult_yolo11n_ob->algo_tick);
+		hx_json_puts(&send_stream, ", ");
+		box_results_2_json_stream(&send_stream, el_algo);
+		hx_json_puts(&send_stream, ", ");
+		img_2_json_stream(&send_stream, &temp_el_jpg_img);
+		event_reply_end(&send_stream);
+	}
 }
 	set_model_change_by_uart();
 #endif	
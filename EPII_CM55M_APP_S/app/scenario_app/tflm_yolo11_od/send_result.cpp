@@ -107,6 +107,12 @@ void set_model_change_by_uart()
             delete[] img_2_json_str_buffer; 
             SetPSPDNoVid();
         }
+        if( c == 252)// set using UART binary frames (trans_type == 3)
+        {
+            hx_drv_swreg_aon_set_appused1( (0x3<<16) | (model_case&0xff));
+            delete[] img_2_json_str_buffer;
+            SetPSPDNoVid();
+        }
         if(c == 0)
         {
             hx_drv_swreg_aon_set_appused1( (trans_type<<16) | (0 & 0xff));
@@ -182,7 +188,7 @@ void el_base64_encode(const unsigned char* in, int in_len, char* out) {
         char_array_4[2] = ((char_array_3[1] & 0x0f) << 2) + ((char_array_3[2] & 0xc0) >> 6);
         char_array_4[3] = char_array_3[2] & 0x3f;
 
-        for (j = 0; j < i + 1; j++) *out++ = BASE64_CHARS_TABLE[char_array_4[i]];
+        for (j = 0; j < i + 1; j++) *out++ = BASE64_CHARS_TABLE[char_array_4[j]];
 
         while (i++ < 3) *out++ = '=';
     }
@@ -709,15 +715,17 @@ const static uint16_t CRC16_MAXIM_TABLE[256] = {
   0x4c80, 0x8c41, 0x4400, 0x84c1, 0x8581, 0x4540, 0x8701, 0x47c0, 0x4680, 0x8641, 0x8201, 0x42c0, 0x4380, 0x8341,
   0x4100, 0x81c1, 0x8081, 0x4040};
 
-EL_ATTR_WEAK uint16_t el_crc16_maxim(const uint8_t* data, size_t length) {
-    uint16_t crc = 0x0000;
-
+uint16_t el_crc16_maxim_update(uint16_t crc, const uint8_t* data, size_t length) {
     for (size_t i = 0; i < length; ++i) {
         uint8_t index = static_cast<uint8_t>(crc ^ data[i]);
         crc           = (crc >> 8) ^ CRC16_MAXIM_TABLE[index];
     }
 
-    return crc ^ 0xffff;
+    return crc;
+}
+
+EL_ATTR_WEAK uint16_t el_crc16_maxim(const uint8_t* data, size_t length) {
+    return el_crc16_maxim_update(0x0000, data, length) ^ 0xffff;
 }
 
 
@@ -809,4 +817,333 @@ std::string  algo_tick_2_json_str(uint32_t algo_tick) {
 
     return ss;
 }
-#endif
\ No newline at end of file
+
+/*
+ * Streaming variants of the *_2_json_str() functions: same bytes, written
+ * through a hx_json_stream into a fixed buffer that is handed to
+ * send_bytes() (or any other sink) whenever it fills up, so a frame reply
+ * with its base64 JPEG needs no heap.
+ */
+static int send_stream_sink(void* ctx, const char* data, size_t len) {
+    (void)ctx;
+    return send_bytes(data, len) == EL_OK ? 0 : -1;
+}
+
+void send_stream_init(hx_json_stream* s, char* buf, size_t size) {
+    hx_json_stream_init(s, buf, size, send_stream_sink, nullptr);
+}
+
+void event_reply_begin(hx_json_stream* s) {
+    hx_json_puts(s, "\r{\"type\": 1, \"name\": \"INVOKE\", \"code\": ");
+    hx_json_put_int(s, EL_OK);
+    hx_json_puts(s, ", \"data\": {\"count\": 0");
+}
+
+el_err_code_t event_reply_end(hx_json_stream* s) {
+    hx_json_puts(s, "}}\n");
+    return hx_json_flush(s) == 0 ? EL_OK : EL_EIO;
+}
+
+static void put_box_values(hx_json_stream* s, const el_box_t& box) {
+    hx_json_put_uint(s, box.x);
+    hx_json_puts(s, ", ");
+    hx_json_put_uint(s, box.y);
+    hx_json_puts(s, ", ");
+    hx_json_put_uint(s, box.w);
+    hx_json_puts(s, ", ");
+    hx_json_put_uint(s, box.h);
+    hx_json_puts(s, ", ");
+    hx_json_put_uint(s, box.score);
+    hx_json_puts(s, ", ");
+    hx_json_put_uint(s, box.target);
+}
+
+static void put_point(hx_json_stream* s, const char* delim, const el_point_t& point, bool with_score) {
+    hx_json_puts(s, delim);
+    hx_json_puts(s, "[");
+    hx_json_put_uint(s, point.x);
+    hx_json_puts(s, ", ");
+    hx_json_put_uint(s, point.y);
+    hx_json_puts(s, ", ");
+    if (with_score) {
+        hx_json_put_uint(s, point.score);
+        hx_json_puts(s, ", ");
+    }
+    hx_json_put_uint(s, point.target);
+    hx_json_puts(s, "]");
+}
+
+// angle_num values in the order the json_str functions print them
+static void put_angle(hx_json_stream* s, const char* delim, const el_struct_angle& angle, int angle_num) {
+    const int16_t values[] = {angle.yaw,
+                              angle.pitch,
+                              angle.roll,
+                              angle.MAR,
+                              angle.LEAR,
+                              angle.REAR,
+                              angle.left_iris_theta,
+                              angle.left_iris_phi,
+                              angle.right_iris_theta,
+                              angle.right_iris_phi};
+    hx_json_puts(s, delim);
+    hx_json_puts(s, "[");
+    for (int i = 0; i < angle_num; i++) {
+        if (i)
+            hx_json_puts(s, ", ");
+        hx_json_put_int(s, values[i]);
+    }
+    hx_json_puts(s, "]");
+}
+
+static void put_boxes(hx_json_stream* s, const char* key, const std::forward_list<el_box_t>& results) {
+    const char* delim = "";
+
+    hx_json_puts(s, key);
+    for (const auto& box : results) {
+        hx_json_puts(s, delim);
+        hx_json_puts(s, "[");
+        put_box_values(s, box);
+        hx_json_puts(s, "]");
+        delim = ", ";
+    }
+    hx_json_puts(s, "]");
+}
+
+void img_2_json_stream(hx_json_stream* s, const el_img_t* img) {
+    hx_json_puts(s, "\"image\": \"");
+    if (img && img->data && img->size) [[likely]]
+        hx_json_put_base64(s, img->data, img->size);
+    hx_json_puts(s, "\"");
+}
+
+void img_res_2_json_stream(hx_json_stream* s, const el_img_t* img) {
+    hx_json_puts(s, "\"resolution\": [");
+    hx_json_put_uint(s, img->width);
+    hx_json_puts(s, ", ");
+    hx_json_put_uint(s, img->height);
+    hx_json_puts(s, "]");
+}
+
+void algo_tick_2_json_stream(hx_json_stream* s, uint32_t algo_tick) {
+    hx_json_puts(s, "\"algo_tick\": [[");
+    hx_json_put_uint(s, algo_tick);
+    hx_json_puts(s, "]]");
+}
+
+void box_results_2_json_stream(hx_json_stream* s, const std::forward_list<el_box_t>& results) {
+    put_boxes(s, "\"boxes\": [", results);
+}
+
+void fm_face_bbox_results_2_json_stream(hx_json_stream* s, const std::forward_list<el_box_t>& results) {
+    put_boxes(s, "\"fm_face_boxes\": [", results);
+}
+
+void keypoint_results_2_json_stream(hx_json_stream* s, const std::forward_list<el_keypoint_t>& results) {
+    const char* delim = "";
+
+    hx_json_puts(s, "\"keypoints\": [");
+    for (const auto& it : results) {
+        hx_json_puts(s, delim);
+        hx_json_puts(s, "[[");
+        put_box_values(s, it.el_box);
+        hx_json_puts(s, "]");
+        delim = ", [";
+        for (int i = 0; i < KEYPOINT_NUM; i++) {
+            put_point(s, delim, it.el_keypoint[i], true);
+            delim = ", ";
+        }
+        hx_json_puts(s, "]]");
+        delim = ", ";
+    }
+    hx_json_puts(s, "]");
+}
+
+void fm_point_results_2_json_stream(hx_json_stream* s, const std::forward_list<el_fm_point_t>& results) {
+    const char* delim = "";
+
+    hx_json_puts(s, "\"fm_points\": [");
+    for (const auto& it : results) {
+        hx_json_puts(s, delim);
+        hx_json_puts(s, "[[");
+        put_box_values(s, it.el_box);
+        hx_json_puts(s, "]");
+        delim = ", [";
+        for (int i = 0; i < FM_POINT_NUM; i++) {
+            put_point(s, delim, it.el_fm_point[i], true);
+            delim = ", ";
+        }
+        delim = "] , [";
+        for (int i = 0; i < FM_IRIS_POINT_NUM; i++) {
+            put_point(s, delim, it.el_fm_iris[i], true);
+            delim = ", ";
+        }
+        put_angle(s, "] , [", it.el_fm_angle, 10);
+        hx_json_puts(s, "]]");
+        delim = ", ";
+    }
+    hx_json_puts(s, "]");
+}
+
+void fd_fl_results_2_json_stream(hx_json_stream* s, const std::forward_list<el_fd_fl_t>& results) {
+    const char* delim = "";
+
+    hx_json_puts(s, "\"fd_fl\": [");
+    for (const auto& it : results) {
+        hx_json_puts(s, delim);
+        hx_json_puts(s, "[[");
+        put_box_values(s, it.el_box);
+        hx_json_puts(s, "]");
+        delim = ", [";
+        for (int i = 0; i < MAX_FACE_LAND_MARK_TRACKED_POINT; i++) {
+            put_point(s, delim, it.el_fl[i], false);
+            delim = ", ";
+        }
+        put_angle(s, "] , [", it.el_fl_angle, 6);
+        hx_json_puts(s, "]]");
+        delim = ", ";
+    }
+    hx_json_puts(s, "]");
+}
+
+void fd_fl_el_9t_results_2_json_stream(hx_json_stream* s, const std::forward_list<el_fd_fl_el_9pt_t>& results) {
+    const char* delim = "";
+
+    hx_json_puts(s, "\"fd_fl_el_9pt\": [");
+    for (const auto& it : results) {
+        hx_json_puts(s, delim);
+        hx_json_puts(s, "[[");
+        put_box_values(s, it.el_box);
+        hx_json_puts(s, "]");
+        delim = ", [";
+        for (int i = 0; i < MAX_FACE_LAND_MARK_TRACKED_POINT; i++) {
+            put_point(s, delim, it.el_fl[i], false);
+            delim = ", ";
+        }
+        delim = "] , [";
+        for (int i = 0; i < 9; i++) {
+            put_point(s, delim, it.left_eye_landmark[i], false);
+            delim = ", ";
+        }
+        delim = "] , [";
+        for (int i = 0; i < 9; i++) {
+            put_point(s, delim, it.right_eye_landmark[i], false);
+            delim = ", ";
+        }
+        put_angle(s, "] , [", it.el_fl_angle, 10);
+        hx_json_puts(s, "]]");
+        delim = ", ";
+    }
+    hx_json_puts(s, "]");
+}
+
+/*
+ * Binary result frame, see send_result.h for the layout. The CRC is
+ * updated as the bytes go out, so the JPEG is sent straight from the
+ * jpeg buffer without a copy.
+ */
+static void bin_put(el_bin_frame_t* f, const void* data, size_t len) {
+    f->crc = el_crc16_maxim_update(f->crc, static_cast<const uint8_t*>(data), len);
+    hx_json_put(f->stream, static_cast<const char*>(data), len);
+}
+
+static void bin_put_u16(el_bin_frame_t* f, uint16_t v) {
+    const uint8_t b[2] = {static_cast<uint8_t>(v), static_cast<uint8_t>(v >> 8)};
+    bin_put(f, b, sizeof(b));
+}
+
+static void bin_put_u32(el_bin_frame_t* f, uint32_t v) {
+    const uint8_t b[4] = {
+      static_cast<uint8_t>(v), static_cast<uint8_t>(v >> 8), static_cast<uint8_t>(v >> 16), static_cast<uint8_t>(v >> 24)};
+    bin_put(f, b, sizeof(b));
+}
+
+static void bin_put_record(el_bin_frame_t* f, el_bin_record_type_t type, uint32_t len) {
+    const uint8_t t = static_cast<uint8_t>(type);
+    bin_put(f, &t, 1);
+    bin_put_u32(f, len);
+}
+
+static void bin_put_box(el_bin_frame_t* f, const el_box_t& box) {
+    const uint8_t st[2] = {box.score, box.target};
+    bin_put_u16(f, box.x);
+    bin_put_u16(f, box.y);
+    bin_put_u16(f, box.w);
+    bin_put_u16(f, box.h);
+    bin_put(f, st, sizeof(st));
+}
+
+void bin_reply_begin(el_bin_frame_t* f, hx_json_stream* s, uint32_t payload_len) {
+    const uint8_t sync[2] = {BIN_FRAME_SYNC0, BIN_FRAME_SYNC1};
+    const uint8_t head[2] = {BIN_FRAME_VERSION, 0};
+
+    f->stream = s;
+    f->crc    = 0x0000;
+    hx_json_put(s, reinterpret_cast<const char*>(sync), sizeof(sync));
+    bin_put(f, head, sizeof(head));
+    bin_put_u32(f, payload_len);
+}
+
+el_err_code_t bin_reply_end(el_bin_frame_t* f) {
+    const uint16_t crc = f->crc ^ 0xffff;
+    const uint8_t  b[2] = {static_cast<uint8_t>(crc), static_cast<uint8_t>(crc >> 8)};
+
+    hx_json_put(f->stream, reinterpret_cast<const char*>(b), sizeof(b));
+    return hx_json_flush(f->stream) == 0 ? EL_OK : EL_EIO;
+}
+
+uint32_t algo_tick_2_bin_size() { return BIN_RECORD_HEADER_SIZE + 4; }
+
+void algo_tick_2_bin(el_bin_frame_t* f, uint32_t algo_tick) {
+    bin_put_record(f, BIN_RECORD_ALGO_TICK, 4);
+    bin_put_u32(f, algo_tick);
+}
+
+uint32_t img_res_2_bin_size() { return BIN_RECORD_HEADER_SIZE + 4; }
+
+void img_res_2_bin(el_bin_frame_t* f, const el_img_t* img) {
+    bin_put_record(f, BIN_RECORD_RESOLUTION, 4);
+    bin_put_u16(f, img->width);
+    bin_put_u16(f, img->height);
+}
+
+uint32_t img_2_bin_size(const el_img_t* img) {
+    return BIN_RECORD_HEADER_SIZE + ((img && img->data) ? img->size : 0);
+}
+
+void img_2_bin(el_bin_frame_t* f, const el_img_t* img) {
+    const uint32_t size = (img && img->data) ? img->size : 0;
+    bin_put_record(f, BIN_RECORD_JPEG, size);
+    if (size)
+        bin_put(f, img->data, size);
+}
+
+uint32_t box_results_2_bin_size(const std::forward_list<el_box_t>& results) {
+    uint32_t n = 0;
+    for (auto it = results.begin(); it != results.end(); ++it) ++n;
+    return BIN_RECORD_HEADER_SIZE + n * BIN_BOX_SIZE;
+}
+
+void box_results_2_bin(el_bin_frame_t* f, const std::forward_list<el_box_t>& results) {
+    bin_put_record(f, BIN_RECORD_BOXES, box_results_2_bin_size(results) - BIN_RECORD_HEADER_SIZE);
+    for (const auto& box : results) bin_put_box(f, box);
+}
+
+uint32_t keypoint_results_2_bin_size(const std::forward_list<el_keypoint_t>& results) {
+    uint32_t n = 0;
+    for (auto it = results.begin(); it != results.end(); ++it) ++n;
+    return BIN_RECORD_HEADER_SIZE + n * (BIN_BOX_SIZE + KEYPOINT_NUM * BIN_POINT_SIZE);
+}
+
+void keypoint_results_2_bin(el_bin_frame_t* f, const std::forward_list<el_keypoint_t>& results) {
+    bin_put_record(f, BIN_RECORD_KEYPOINTS, keypoint_results_2_bin_size(results) - BIN_RECORD_HEADER_SIZE);
+    for (const auto& it : results) {
+        bin_put_box(f, it.el_box);
+        for (int i = 0; i < KEYPOINT_NUM; i++) {
+            const uint8_t st[2] = {it.el_keypoint[i].score, it.el_keypoint[i].target};
+            bin_put_u16(f, it.el_keypoint[i].x);
+            bin_put_u16(f, it.el_keypoint[i].y);
+            bin_put(f, st, sizeof(st));
+        }
+    }
+}
+#endif
\ No newline at end of file
@@ -13,10 +13,12 @@
 extern "C" {
 #include "hx_drv_swreg_aon.h"
 }
+#include "hx_json_stream.h"
 #define CONSOLE_UART_ID 0
 #define EL_ATTR_WEAK __attribute__((weak))
 #define EL_VERSION                 __TIMESTAMP__
 #define CONFIG_SSCMA_CMD_MAX_LENGTH (4096)
+#define SEND_STREAM_BUFFER_SIZE (1024)
 #define KEYPOINT_NUM 17
 #define FM_POINT_NUM 468
 #define FM_IRIS_POINT_NUM 10
@@ -181,4 +183,86 @@ std::string  algo_tick_2_json_str(uint32_t algo_tick);
 std::string  fd_fl_results_2_json_str(std::forward_list<el_fd_fl_t>& results);
 std::string  fd_fl_el_9t_results_2_json_str(std::forward_list<el_fd_fl_el_9pt_t>& results);
 std::string  fm_face_bbox_results_2_json_str(std::forward_list<el_box_t>& results);
-#endif
\ No newline at end of file
+
+/*
+ * Streaming variants: byte-for-byte the output of the matching
+ * *_2_json_str() / event_reply(), written through s without heap use.
+ *
+ *   send_stream_init(&s, buf, sizeof(buf));
+ *   event_reply_begin(&s);
+ *   hx_json_puts(&s, ", ");
+ *   box_results_2_json_stream(&s, el_algo);
+ *   ...
+ *   event_reply_end(&s);
+ */
+void send_stream_init(hx_json_stream* s, char* buf, size_t size);
+void event_reply_begin(hx_json_stream* s);
+el_err_code_t event_reply_end(hx_json_stream* s);
+void img_2_json_stream(hx_json_stream* s, const el_img_t* img);
+void img_res_2_json_stream(hx_json_stream* s, const el_img_t* img);
+void algo_tick_2_json_stream(hx_json_stream* s, uint32_t algo_tick);
+void box_results_2_json_stream(hx_json_stream* s, const std::forward_list<el_box_t>& results);
+void fm_face_bbox_results_2_json_stream(hx_json_stream* s, const std::forward_list<el_box_t>& results);
+void keypoint_results_2_json_stream(hx_json_stream* s, const std::forward_list<el_keypoint_t>& results);
+void fm_point_results_2_json_stream(hx_json_stream* s, const std::forward_list<el_fm_point_t>& results);
+void fd_fl_results_2_json_stream(hx_json_stream* s, const std::forward_list<el_fd_fl_t>& results);
+void fd_fl_el_9t_results_2_json_stream(hx_json_stream* s, const std::forward_list<el_fd_fl_el_9pt_t>& results);
+
+uint16_t el_crc16_maxim(const uint8_t* data, size_t length);
+/** CRC-16/MAXIM without the final xor, start from 0 and xor 0xffff at the end */
+uint16_t el_crc16_maxim_update(uint16_t crc, const uint8_t* data, size_t length);
+
+/*
+ * Binary result frame, sent instead of the JSON reply when the transfer
+ * type is 3 (UART binary, selected by sending 252 to the device). It
+ * carries the JPEG raw instead of base64 and the results as packed 16-bit
+ * fields. Little endian:
+ *
+ *   'H' 'X'                    sync
+ *   u8 version, u8 reserved
+ *   u32 payload length
+ *   payload: records of u8 type, u32 length, data
+ *   u16 el_crc16_maxim() of version .. end of payload
+ *
+ * Host decoder: result_protocol/result_decoder.py
+ *
+ *   el_bin_frame_t f;
+ *   bin_reply_begin(&f, &s, algo_tick_2_bin_size() + box_results_2_bin_size(el_algo) + img_2_bin_size(&img));
+ *   algo_tick_2_bin(&f, tick);
+ *   box_results_2_bin(&f, el_algo);
+ *   img_2_bin(&f, &img);
+ *   bin_reply_end(&f);
+ */
+#define BIN_FRAME_SYNC0 'H'
+#define BIN_FRAME_SYNC1 'X'
+#define BIN_FRAME_VERSION 1
+#define BIN_RECORD_HEADER_SIZE 5
+#define BIN_BOX_SIZE 10    // u16 x, y, w, h, u8 score, target
+#define BIN_POINT_SIZE 6   // u16 x, y, u8 score, target
+
+typedef enum {
+    BIN_RECORD_ALGO_TICK  = 1,  // u32
+    BIN_RECORD_RESOLUTION = 2,  // u16 width, height
+    BIN_RECORD_BOXES      = 3,  // BIN_BOX_SIZE per box
+    BIN_RECORD_KEYPOINTS  = 4,  // per result: box, then KEYPOINT_NUM points
+    BIN_RECORD_JPEG       = 5,  // raw JPEG
+} el_bin_record_type_t;
+
+typedef struct el_bin_frame_t {
+    hx_json_stream* stream;
+    uint16_t        crc;
+} el_bin_frame_t;
+
+void bin_reply_begin(el_bin_frame_t* f, hx_json_stream* s, uint32_t payload_len);
+el_err_code_t bin_reply_end(el_bin_frame_t* f);
+uint32_t algo_tick_2_bin_size();
+void algo_tick_2_bin(el_bin_frame_t* f, uint32_t algo_tick);
+uint32_t img_res_2_bin_size();
+void img_res_2_bin(el_bin_frame_t* f, const el_img_t* img);
+uint32_t img_2_bin_size(const el_img_t* img);
+void img_2_bin(el_bin_frame_t* f, const el_img_t* img);
+uint32_t box_results_2_bin_size(const std::forward_list<el_box_t>& results);
+void box_results_2_bin(el_bin_frame_t* f, const std::forward_list<el_box_t>& results);
+uint32_t keypoint_results_2_bin_size(const std::forward_list<el_keypoint_t>& results);
+void keypoint_results_2_bin(el_bin_frame_t* f, const std::forward_list<el_keypoint_t>& results);
+#endif
\ No newline at end of file
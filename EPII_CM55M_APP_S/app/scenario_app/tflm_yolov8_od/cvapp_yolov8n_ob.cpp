@@ -29,6 +29,10 @@
 #endif
 #include "img_proc_helium.h"
 #include "yolo_postprocessing.h"
+#include "yolov8_decode.h"
+#include "hx_nms.h"
+#include "hx_img_preproc.h"
+#include "hx_tracker.h"
 
 
 #include "xprintf.h"
@@ -58,10 +62,21 @@
 // #define EACH_STEP_TICK
 #define TOTAL_STEP_TICK
 #define YOLOV8_POST_EACH_STEP_TICK 0
+// run the hx_nms self test and benchmark once at init
+#define YOLOV8_NMS_SELFTEST 0
+// run the hx_img_preproc self test and benchmark once on the first frame
+#define YOLOV8_PREPROC_SELFTEST 0
+// skip the model on static scenes and send the hx_tracker boxes instead, see README
+#define YOLOV8_TRACKER 0
+// run the model on every frame and print a TRK line per frame for the tracker replay benchmark
+#define YOLOV8_TRACKER_RECORD 0
+#define YOLOV8_TRACKER_REPORT_FRAMES 30
+// a frame moved when more than 2% of the motion grid samples changed by more than 24
+#define YOLOV8_MOTION_PIXEL_TH 24
+#define YOLOV8_MOTION_PERMILLE 20
 uint32_t systick_1, systick_2;
 uint32_t loop_cnt_1, loop_cnt_2;
 #define CPU_CLK	0xffffff+1
-static uint32_t capture_image_tick = 0;
 #ifdef TRUSTZONE_SEC
 #define U55_BASE	BASE_ADDR_APB_U55_CTRL_ALIAS
 #else
@@ -72,6 +87,32 @@ static uint32_t capture_image_tick = 0;
 #endif
 #endif
 
+#if YOLOV8_NMS_SELFTEST || YOLOV8_PREPROC_SELFTEST
+#if YOLOV8_NMS_SELFTEST
+#include "hx_nms_test.h"
+#endif
+#if YOLOV8_PREPROC_SELFTEST
+#include "hx_img_preproc_test.h"
+#endif
+static uint32_t selftest_tick(void)
+{
+	uint32_t systick, loop_cnt;
+	SystemGetTick(&systick, &loop_cnt);
+	return loop_cnt * (CPU_CLK) - systick;
+}
+#endif
+
+
+static hx_img_preproc yolov8n_ob_preproc;
+static int16_t yolov8n_ob_preproc_work[HX_IMG_PREPROC_WORK_SIZE(DP_INP_OUT_WIDTH, YOLOV8_OB_INPUT_TENSOR_WIDTH, 3) / 2];
+
+//set by the CDM motion event, consumed by the next cv_yolov8n_ob_run()
+static volatile uint8_t yolov8n_ob_cdm_motion = 0;
+#if YOLOV8_TRACKER || YOLOV8_TRACKER_RECORD
+static hx_tracker yolov8n_ob_tracker;
+static hx_tracker_motion yolov8n_ob_motion;
+static int yolov8n_ob_frame_motion = 0;
+#endif
 
 using namespace std;
 
@@ -159,6 +200,10 @@ int cv_yolov8n_ob_init(bool security_enable, bool privilege_enable, uint32_t mod
 	if(_arm_npu_init(security_enable, privilege_enable)!=0)
 		return -1;
 
+	#if YOLOV8_NMS_SELFTEST
+		hx_nms_test_run(selftest_tick);
+	#endif
+
 	if(model_addr != 0) {
 		static const tflite::Model*yolov8n_ob_model = tflite::GetModel((const void *)model_addr);
 
@@ -208,58 +253,8 @@ int cv_yolov8n_ob_init(bool security_enable, bool privilege_enable, uint32_t mod
 
 
 
-typedef struct detection_cls_yolov8{
-    box bbox;
-    float confidence;
-    float index;
-
-} detection_cls_yolov8;
-
-static bool yolov8_det_comparator(detection_cls_yolov8 &pa, detection_cls_yolov8 &pb)
-{
-    return pa.confidence > pb.confidence;
-}
-
-static void  yolov8_NMSBoxes(std::vector<box> &boxes,std::vector<float> &confidences,float modelScoreThreshold,float modelNMSThreshold,std::vector<int>& nms_result)
-{
-    detection_cls_yolov8 yolov8_bbox;
-    std::vector<detection_cls_yolov8> yolov8_bboxes{};
-    for(int i = 0; i < boxes.size(); i++)
-    {
-        yolov8_bbox.bbox = boxes[i];
-        yolov8_bbox.confidence = confidences[i];
-        yolov8_bbox.index = i;
-        yolov8_bboxes.push_back(yolov8_bbox);
-    }
-    sort(yolov8_bboxes.begin(), yolov8_bboxes.end(), yolov8_det_comparator);
-    int updated_size = yolov8_bboxes.size();
-    for(int k = 0; k < updated_size; k++)
-    {
-        if(yolov8_bboxes[k].confidence < modelScoreThreshold)
-        {
-            continue;
-        }
-        
-        nms_result.push_back(yolov8_bboxes[k].index);
-        for(int j = k + 1; j < updated_size; j++)
-        {
-            float iou = box_iou(yolov8_bboxes[k].bbox, yolov8_bboxes[j].bbox);
-            // float iou = box_diou(yolov8_bboxes[k].bbox, yolov8_bboxes[j].bbox);
-            if(iou > modelNMSThreshold)
-            {
-                yolov8_bboxes.erase(yolov8_bboxes.begin() + j);
-                updated_size = yolov8_bboxes.size();
-                j = j -1;
-            }
-        }
-
-    }
-}
-
-
-
 #if CHANGE_YOLOV8_OB_OUPUT_SHAPE
-static void yolov8_ob_post_processing(tflite::MicroInterpreter* static_interpreter,float modelScoreThreshold, float modelNMSThreshold, struct_yolov8_ob_algoResult *alg,	std::forward_list<el_box_t> &el_algo)
+static int yolov8_ob_post_processing(tflite::MicroInterpreter* static_interpreter,float modelScoreThreshold, float modelNMSThreshold, struct_yolov8_ob_algoResult *alg,	std::forward_list<el_box_t> &el_algo)
 {
 	uint32_t img_w = app_get_raw_width();
     uint32_t img_h = app_get_raw_height();
@@ -284,11 +279,6 @@ static void yolov8_ob_post_processing(tflite::MicroInterpreter* static_interpret
 	int input_w = YOLOV8_OB_INPUT_TENSOR_WIDTH;
 	int input_h = YOLOV8_OB_INPUT_TENSOR_HEIGHT;
 
-	std::vector<uint16_t> class_idxs;
-	std::vector<float> confidences;
-	std::vector<box> boxes;
-
-
 	float output_scale = ((TfLiteAffineQuantization*)(output->quantization.params))->scale->data[0];
 	int output_zeropoint = ((TfLiteAffineQuantization*)(output->quantization.params))->zero_point->data[0];
 
@@ -304,98 +294,59 @@ static void yolov8_ob_post_processing(tflite::MicroInterpreter* static_interpret
 		xprintf("output_2_zeropoint: %d\r\n",output_2_zeropoint);
 	#endif
 	/***
-	 * dequantize the output result for box
-	 * 
+	 * decode in the int8 domain: the score threshold is quantized once,
+	 * anchors whose best class is below it are dropped before any dequantize
 	 * 
 	 ******/
-	for(int dims_cnt_2 = 0; dims_cnt_2 < output->dims->data[2]; dims_cnt_2++)//// output->dims->data[2] is 756
-	{
-		float outputs_bbox_data[4];
-		float maxScore = (-1);// the first four indexes are bbox information
-		uint16_t maxClassIndex = 0;
-		for(int dims_cnt_1 = 0; dims_cnt_1 < output->dims->data[1]; dims_cnt_1++)// output->dims->data[1] is 4 
-		{
-			int value =  output->data.int8[ dims_cnt_2 + dims_cnt_1 * output->dims->data[2]];
-			
-			float deq_value = ((float) value-(float)output_zeropoint) * output_scale ;
-
-			/***
-			 * fix big score
-			 * ****/
-			if(dims_cnt_1%2)//==1
-			{
-				deq_value *= (float)input_h;
-			}
-			else
-			{
-				deq_value *= (float)input_w;
-			}
-			outputs_bbox_data[dims_cnt_1] = deq_value;
-		}
-
-		for(int output_2_dims_cnt_1 = 0; output_2_dims_cnt_1 < output_2->dims->data[2]; output_2_dims_cnt_1++)//output_2->dims->data[2] is 80
-		{
-			int value_2 =  output_2->data.int8[ output_2_dims_cnt_1 + dims_cnt_2 * output_2->dims->data[2]];
-			
-			float deq_value_2 = ((float) value_2-(float)output_2_zeropoint) * output_2_scale ;
-			/***
-			 * find maximum Score and correspond Class idx
-			 * **/
-			if(maxScore < deq_value_2)
-			{
-				maxScore = deq_value_2;
-				maxClassIndex = output_2_dims_cnt_1;
-			}
-		}
-		if (maxScore >= modelScoreThreshold)
-		{
-			box bbox;
-			
-			bbox.x = (outputs_bbox_data[0] - (0.5 * outputs_bbox_data[2]));
-			bbox.y = (outputs_bbox_data[1] - (0.5 * outputs_bbox_data[3]));
-			bbox.w =(outputs_bbox_data[2]);
-			bbox.h = (outputs_bbox_data[3]);
-			boxes.push_back(bbox);
-			class_idxs.push_back(maxClassIndex);
-			confidences.push_back(maxScore);
-			
-		}
-	}
+	yolov8_tensor_q bbox_q = {output->data.int8, output_scale, output_zeropoint};
+	yolov8_tensor_q cls_q = {output_2->data.int8, output_2_scale, output_2_zeropoint};
+	static hx_nms_boxes candidates;
+	#if YOLOV8_POST_EACH_STEP_TICK
+		uint32_t decode_systick_1, decode_systick_2, decode_loop_cnt_1, decode_loop_cnt_2;
+		SystemGetTick(&decode_systick_1, &decode_loop_cnt_1);
+		yolov8_decode_float(&bbox_q, &cls_q, output->dims->data[2], num_classes, modelScoreThreshold, input_w, input_h, &candidates);
+		SystemGetTick(&decode_systick_2, &decode_loop_cnt_2);
+		dbg_printf(DBG_LESS_INFO,"Tick for YOLOV8_OB float decode:[%d]\r\n",(decode_loop_cnt_2-decode_loop_cnt_1)*CPU_CLK+(decode_systick_1-decode_systick_2));
+		SystemGetTick(&decode_systick_1, &decode_loop_cnt_1);
+	#endif
+	yolov8_decode_int8(&bbox_q, &cls_q, output->dims->data[2], num_classes, modelScoreThreshold, input_w, input_h, &candidates);
+	#if YOLOV8_POST_EACH_STEP_TICK
+		SystemGetTick(&decode_systick_2, &decode_loop_cnt_2);
+		dbg_printf(DBG_LESS_INFO,"Tick for YOLOV8_OB int8 decode:[%d] candidates:[%d] dropped:[%d]\r\n",(decode_loop_cnt_2-decode_loop_cnt_1)*CPU_CLK+(decode_systick_1-decode_systick_2), candidates.count, candidates.dropped);
+	#endif
 
-	
 	#if YOLOV8N_OB_DBG_APP_LOG
-		xprintf("boxes.size(): %d\r\n",boxes.size());
+		xprintf("boxes.size(): %d\r\n",candidates.count);
 	#endif
 	/**
 	 * do nms
 	 * 
 	 * **/
 
-	std::vector<int> nms_result;
-	yolov8_NMSBoxes(boxes, confidences, modelScoreThreshold, modelNMSThreshold, nms_result);
+	uint16_t nms_result[MAX_TRACKED_YOLOV8_ALGO_RES];
+	int nms_count = hx_nms_run(&candidates, modelNMSThreshold, HX_NMS_CLASS_AGNOSTIC, 0, MAX_TRACKED_YOLOV8_ALGO_RES, nms_result);
 	#if YOLOV8N_OB_DBG_APP_LOG
-		xprintf("nms_result.size(): %d\r\n",nms_result.size());
+		xprintf("nms_result.size(): %d\r\n",nms_count);
 	#endif
-	for (int i = 0; i < nms_result.size(); i++)
+	for (int i = 0; i < nms_count; i++)
 	{
-		if(!(MAX_TRACKED_YOLOV8_ALGO_RES-i))break;
 		int idx = nms_result[i];
 
 		float scale_factor_w = (float)img_w / (float)YOLOV8_OB_INPUT_TENSOR_WIDTH; 
 		float scale_factor_h = (float)img_h / (float)YOLOV8_OB_INPUT_TENSOR_HEIGHT; 
-		alg->obr[i].confidence = confidences[idx];
-		alg->obr[i].bbox.x = (uint32_t)(boxes[idx].x * scale_factor_w);
-		alg->obr[i].bbox.y = (uint32_t)(boxes[idx].y * scale_factor_h);
-		alg->obr[i].bbox.width = (uint32_t)(boxes[idx].w * scale_factor_w);
-		alg->obr[i].bbox.height = (uint32_t)(boxes[idx].h * scale_factor_h);
-		alg->obr[i].class_idx = class_idxs[idx];
+		alg->obr[i].confidence = candidates.score[idx];
+		alg->obr[i].bbox.x = (uint32_t)(candidates.x[idx] * scale_factor_w);
+		alg->obr[i].bbox.y = (uint32_t)(candidates.y[idx] * scale_factor_h);
+		alg->obr[i].bbox.width = (uint32_t)(candidates.w[idx] * scale_factor_w);
+		alg->obr[i].bbox.height = (uint32_t)(candidates.h[idx] * scale_factor_h);
+		alg->obr[i].class_idx = candidates.group[idx];
 		el_box_t temp_el_box;
-		temp_el_box.score =  confidences[idx]*100;
-		temp_el_box.target =  class_idxs[idx];
-		temp_el_box.x = (uint32_t)(boxes[idx].x * scale_factor_w);
-		temp_el_box.y =  (uint32_t)(boxes[idx].y * scale_factor_h);
-		temp_el_box.w = (uint32_t)(boxes[idx].w * scale_factor_w);
-		temp_el_box.h = (uint32_t)(boxes[idx].h * scale_factor_h);
+		temp_el_box.score =  candidates.score[idx]*100;
+		temp_el_box.target =  candidates.group[idx];
+		temp_el_box.x = (uint32_t)(candidates.x[idx] * scale_factor_w);
+		temp_el_box.y =  (uint32_t)(candidates.y[idx] * scale_factor_h);
+		temp_el_box.w = (uint32_t)(candidates.w[idx] * scale_factor_w);
+		temp_el_box.h = (uint32_t)(candidates.h[idx] * scale_factor_h);
 
 
 		// printf("temp_el_box.x %d,temp_el_box.y: %d\r\n",temp_el_box.x,temp_el_box.y);
@@ -404,10 +355,11 @@ static void yolov8_ob_post_processing(tflite::MicroInterpreter* static_interpret
 		// 	printf("el_algo.box.x %d,el_algo.box.y%d\r\n",box.x,box.y);
 		// }
 		#if YOLOV8N_OB_DBG_APP_LOG
-			printf("detect object[%d]: %s confidences: %f\r\n",i, coco_classes[class_idxs[idx]].c_str(),confidences[idx]);
+			printf("detect object[%d]: %s confidences: %f\r\n",i, coco_classes[candidates.group[idx]].c_str(),candidates.score[idx]);
 
 		#endif
 	}
+	return nms_count;
 }
 #else
 static void yolov8_ob_post_processing(tflite::MicroInterpreter* static_interpreter,float modelScoreThreshold, float modelNMSThreshold, struct_yolov8_ob_algoResult *alg)
@@ -426,9 +378,8 @@ static void yolov8_ob_post_processing(tflite::MicroInterpreter* static_interpret
 	int input_w = YOLOV8_OB_INPUT_TENSOR_WIDTH;
 	int input_h = YOLOV8_OB_INPUT_TENSOR_HEIGHT;
 
-	std::vector<uint16_t> class_idxs;
-	std::vector<float> confidences;
-	std::vector<box> boxes;
+	static hx_nms_boxes candidates;
+	hx_nms_reset(&candidates);
 
 
 	float output_scale = ((TfLiteAffineQuantization*)(output->quantization.params))->scale->data[0];
@@ -495,37 +446,34 @@ static void yolov8_ob_post_processing(tflite::MicroInterpreter* static_interpret
 			bbox.y = (outputs_bbox_data[1] - (0.5 * outputs_bbox_data[3]));
 			bbox.w =(outputs_bbox_data[2]);
 			bbox.h = (outputs_bbox_data[3]);
-			boxes.push_back(bbox);
-			class_idxs.push_back(maxClassIndex);
-			confidences.push_back(maxScore);
+			hx_nms_add(&candidates, bbox.x, bbox.y, bbox.w, bbox.h, maxScore, maxClassIndex);
 			
 		}
 	}
 	#if YOLOV8N_OB_DBG_APP_LOG
-		xprintf("boxes.size(): %d\r\n",boxes.size());
+		xprintf("boxes.size(): %d\r\n",candidates.count);
 	#endif
 	/**
 	 * do nms
 	 * 
 	 * **/
 
-	std::vector<int> nms_result;
-	yolov8_NMSBoxes(boxes, confidences, modelScoreThreshold, modelNMSThreshold, nms_result);
-	for (int i = 0; i < nms_result.size(); i++)
+	uint16_t nms_result[MAX_TRACKED_YOLOV8_ALGO_RES];
+	int nms_count = hx_nms_run(&candidates, modelNMSThreshold, HX_NMS_CLASS_AGNOSTIC, 0, MAX_TRACKED_YOLOV8_ALGO_RES, nms_result);
+	for (int i = 0; i < nms_count; i++)
 	{
-		if(!(MAX_TRACKED_YOLOV8_ALGO_RES-i))break;
 		int idx = nms_result[i];
 
 		float scale_factor_w = (float)img_w / (float)YOLOV8_OB_INPUT_TENSOR_WIDTH; 
 		float scale_factor_h = (float)img_h / (float)YOLOV8_OB_INPUT_TENSOR_HEIGHT; 
-		alg->obr[i].confidence = confidences[idx];
-		alg->obr[i].bbox.x = (uint32_t)(boxes[idx].x * scale_factor_w);
-		alg->obr[i].bbox.y = (uint32_t)(boxes[idx].y * scale_factor_h);
-		alg->obr[i].bbox.width = (uint32_t)(boxes[idx].w * scale_factor_w);
-		alg->obr[i].bbox.height = (uint32_t)(boxes[idx].h * scale_factor_h);
-		alg->obr[i].class_idx = class_idxs[idx];
+		alg->obr[i].confidence = candidates.score[idx];
+		alg->obr[i].bbox.x = (uint32_t)(candidates.x[idx] * scale_factor_w);
+		alg->obr[i].bbox.y = (uint32_t)(candidates.y[idx] * scale_factor_h);
+		alg->obr[i].bbox.width = (uint32_t)(candidates.w[idx] * scale_factor_w);
+		alg->obr[i].bbox.height = (uint32_t)(candidates.h[idx] * scale_factor_h);
+		alg->obr[i].class_idx = candidates.group[idx];
 		#if YOLOV8N_OB_DBG_APP_LOG
-			printf("detect object[%d]: %s confidences: %f\r\n",i, coco_classes[class_idxs[idx]].c_str(),confidences[idx]);
+			printf("detect object[%d]: %s confidences: %f\r\n",i, coco_classes[candidates.group[idx]].c_str(),candidates.score[idx]);
 
 		#endif
 	}
@@ -533,21 +481,122 @@ static void yolov8_ob_post_processing(tflite::MicroInterpreter* static_interpret
 
 #endif
 
-int cv_yolov8n_ob_run(struct_yolov8_ob_algoResult *algoresult_yolov8n_ob) {
+//boxes of the last cv_yolov8n_ob_run(), sent by cv_yolov8n_ob_send()
+static std::forward_list<el_box_t> yolov8n_ob_el_algo;
+
+#if YOLOV8_TRACKER || YOLOV8_TRACKER_RECORD
+/**
+ * Moves the tracks one frame forward and decides if the model has to run.
+ * Motion is the CDM event or a change of the G plane since the last frame.
+ * Returns 1 if the tracks were written to alg and el_algo instead.
+ */
+static int yolov8n_ob_track_frame(struct_yolov8_ob_algoResult *alg, std::forward_list<el_box_t> &el_algo,
+		uint32_t raw_addr, uint32_t img_w, uint32_t img_h)
+{
+	static hx_tracker_box tracks[HX_TRACKER_MAX_TRACKS];
+	int n;
+
+	if(yolov8n_ob_tracker.next_id == 0)
+		hx_tracker_init(&yolov8n_ob_tracker, NULL);
+	if(yolov8n_ob_motion.w != (int)img_w || yolov8n_ob_motion.h != (int)img_h)
+		hx_tracker_motion_init(&yolov8n_ob_motion, img_w, img_h, YOLOV8_MOTION_PIXEL_TH, YOLOV8_MOTION_PERMILLE);
+
+	yolov8n_ob_frame_motion = hx_tracker_motion_update(&yolov8n_ob_motion, (const uint8_t*)raw_addr + img_w * img_h);
+	if(yolov8n_ob_cdm_motion) {
+		yolov8n_ob_cdm_motion = 0;
+		yolov8n_ob_frame_motion = 1;
+	}
+
+	hx_tracker_predict(&yolov8n_ob_tracker);
+	if(yolov8n_ob_tracker.frames % YOLOV8_TRACKER_REPORT_FRAMES == 0) {
+		xprintf("tracker: model ran on %d of %d frames\r\n", yolov8n_ob_tracker.detects, yolov8n_ob_tracker.frames);
+	}
+	if(YOLOV8_TRACKER_RECORD || hx_tracker_need_detect(&yolov8n_ob_tracker, yolov8n_ob_frame_motion))
+		return 0;
+
+	n = hx_tracker_get(&yolov8n_ob_tracker, tracks, HX_TRACKER_MAX_TRACKS);
+	for (int i = 0; i < n; i++)
+	{
+		float x = tracks[i].x < 0 ? 0 : tracks[i].x;
+		float y = tracks[i].y < 0 ? 0 : tracks[i].y;
+		alg->obr[i].confidence = tracks[i].score;
+		alg->obr[i].bbox.x = (uint32_t)x;
+		alg->obr[i].bbox.y = (uint32_t)y;
+		alg->obr[i].bbox.width = (uint32_t)tracks[i].w;
+		alg->obr[i].bbox.height = (uint32_t)tracks[i].h;
+		alg->obr[i].class_idx = tracks[i].cls;
+		el_box_t temp_el_box;
+		temp_el_box.score = tracks[i].score*100;
+		temp_el_box.target = tracks[i].cls;
+		temp_el_box.x = (uint32_t)x;
+		temp_el_box.y = (uint32_t)y;
+		temp_el_box.w = (uint32_t)tracks[i].w;
+		temp_el_box.h = (uint32_t)tracks[i].h;
+		el_algo.emplace_front(temp_el_box);
+	}
+	return 1;
+}
+
+/* Corrects the tracks with the count boxes the model found, in score order in alg. */
+static void yolov8n_ob_track_update(const struct_yolov8_ob_algoResult *alg, int count)
+{
+	static hx_tracker_box det[HX_TRACKER_MAX_DETECTIONS];
+
+	if(count > HX_TRACKER_MAX_DETECTIONS)
+		count = HX_TRACKER_MAX_DETECTIONS;
+	for (int i = 0; i < count; i++)
+	{
+		det[i].x = alg->obr[i].bbox.x;
+		det[i].y = alg->obr[i].bbox.y;
+		det[i].w = alg->obr[i].bbox.width;
+		det[i].h = alg->obr[i].bbox.height;
+		det[i].score = alg->obr[i].confidence;
+		det[i].cls = alg->obr[i].class_idx;
+		det[i].id = 0;
+	}
+	hx_tracker_update(&yolov8n_ob_tracker, det, count);
+
+	#if YOLOV8_TRACKER_RECORD
+	xprintf("TRK %d %d", yolov8n_ob_frame_motion, count);
+	for (int i = 0; i < count; i++)
+		xprintf(" %d %d %d %d %d %d", (int)det[i].x, (int)det[i].y, (int)det[i].w, (int)det[i].h,
+				(int)(det[i].score * 100), det[i].cls);
+	xprintf("\r\n");
+	#endif
+}
+#endif
+
+void cv_yolov8n_ob_set_motion(void) {
+	yolov8n_ob_cdm_motion = 1;
+}
+
+int cv_yolov8n_ob_run(struct_yolov8_ob_algoResult *algoresult_yolov8n_ob, uint32_t raw_addr) {
 	int ercode = 0;
-    float w_scale;
-    float h_scale;
     uint32_t img_w = app_get_raw_width();
     uint32_t img_h = app_get_raw_height();
     uint32_t ch = app_get_raw_channels();
-    uint32_t raw_addr = app_get_raw_addr();
     uint32_t expand = 0;
-	std::forward_list<el_box_t> el_algo;
+	std::forward_list<el_box_t> &el_algo = yolov8n_ob_el_algo;
+
+	el_algo.clear();
 
 	#if YOLOV8N_OB_DBG_APP_LOG
     xprintf("raw info: w[%d] h[%d] ch[%d] addr[%x]\n",img_w, img_h, ch, raw_addr);
 	#endif
 
+	#if YOLOV8_TRACKER || YOLOV8_TRACKER_RECORD
+	if(yolov8n_ob_int_ptr!= nullptr) {
+		SystemGetTick(&systick_1, &loop_cnt_1);
+		if(yolov8n_ob_track_frame(algoresult_yolov8n_ob, el_algo, raw_addr, img_w, img_h)) {
+			SystemGetTick(&systick_2, &loop_cnt_2);
+			#ifdef UART_SEND_ALOGO_RESEULT
+			algoresult_yolov8n_ob->algo_tick = (loop_cnt_2-loop_cnt_1)*CPU_CLK+(systick_1-systick_2);
+			#endif
+			return ercode;
+		}
+	}
+	#endif
+
     if(yolov8n_ob_int_ptr!= nullptr) {
 		#ifdef TOTAL_STEP_TICK
 			SystemGetTick(&systick_1, &loop_cnt_1);
@@ -555,33 +604,28 @@ int cv_yolov8n_ob_run(struct_yolov8_ob_algoResult *algoresult_yolov8n_ob) {
 		#ifdef EACH_STEP_TICK
 			SystemGetTick(&systick_1, &loop_cnt_1);
 		#endif
-    	//get image from sensor and resize
-		w_scale = (float)(img_w - 1) / (YOLOV8_OB_INPUT_TENSOR_WIDTH - 1);
-		h_scale = (float)(img_h - 1) / (YOLOV8_OB_INPUT_TENSOR_HEIGHT - 1);
-
-		
-		hx_lib_image_resize_BGR8U3C_to_RGB24_helium((uint8_t*)raw_addr, (uint8_t*)yolov8n_ob_input->data.data,  
-		                    img_w, img_h, ch, 
-                        	YOLOV8_OB_INPUT_TENSOR_WIDTH, YOLOV8_OB_INPUT_TENSOR_HEIGHT, w_scale,h_scale);
-		#ifdef EACH_STEP_TICK						
-			SystemGetTick(&systick_2, &loop_cnt_2);
-			dbg_printf(DBG_LESS_INFO,"Tick for resize image BGR8U3C_to_RGB24_helium for yolov8 OB:[%d]\r\n",(loop_cnt_2-loop_cnt_1)*CPU_CLK+(systick_1-systick_2));							
+		#if YOLOV8_PREPROC_SELFTEST
+		static bool preproc_selftest_done = false;
+		if(!preproc_selftest_done) {
+			preproc_selftest_done = true;
+			hx_img_preproc_test_run(selftest_tick, (const uint8_t*)raw_addr, img_w, img_h, yolov8n_ob_input->data.int8,
+					YOLOV8_OB_INPUT_TENSOR_WIDTH, YOLOV8_OB_INPUT_TENSOR_HEIGHT);
+		}
 		#endif
-
+    	//get image from sensor, resize, reorder to RGB24 and shift to int8 in one pass
+		if(yolov8n_ob_preproc.in_w != (int)img_w || yolov8n_ob_preproc.in_h != (int)img_h) {
+			if(hx_img_preproc_init(&yolov8n_ob_preproc, HX_IMG_PREPROC_BGR8U3C_TO_RGB24, img_w, img_h,
+					YOLOV8_OB_INPUT_TENSOR_WIDTH, YOLOV8_OB_INPUT_TENSOR_HEIGHT, yolov8n_ob_preproc_work, sizeof(yolov8n_ob_preproc_work)) != 0) {
+				xprintf("preproc init fail for %dx%d\r\n", img_w, img_h);
+				return -1;
+			}
+		}
+		hx_img_preproc_run(&yolov8n_ob_preproc, (const uint8_t*)raw_addr, yolov8n_ob_input->data.int8);
 		#ifdef EACH_STEP_TICK
-			SystemGetTick(&systick_1, &loop_cnt_1);
+			SystemGetTick(&systick_2, &loop_cnt_2);
+			dbg_printf(DBG_LESS_INFO,"Tick for resize + RGB24 + int8 preprocessing for yolov8 OB:[%d]\r\n",(loop_cnt_2-loop_cnt_1)*CPU_CLK+(systick_1-systick_2));
 		#endif
 
-		// //uint8 to int8
-		for (int i = 0; i < yolov8n_ob_input->bytes; ++i) {
-			*((int8_t *)yolov8n_ob_input->data.data+i) = *((int8_t *)yolov8n_ob_input->data.data+i) - 128;
-    	}
-
-		#ifdef EACH_STEP_TICK
-		SystemGetTick(&systick_2, &loop_cnt_2);
-		dbg_printf(DBG_LESS_INFO,"Tick for Invoke for uint8toint8 for YOLOV8_OB:[%d]\r\n\n",(loop_cnt_2-loop_cnt_1)*CPU_CLK+(systick_1-systick_2));    
-		#endif	
-
 		#ifdef EACH_STEP_TICK
 		SystemGetTick(&systick_1, &loop_cnt_1);
 		#endif
@@ -609,7 +653,12 @@ int cv_yolov8n_ob_run(struct_yolov8_ob_algoResult *algoresult_yolov8n_ob) {
 			SystemGetTick(&systick_1, &loop_cnt_1);
 		#endif
 		//retrieve output data
-		yolov8_ob_post_processing(yolov8n_ob_int_ptr,0.25, 0.45, algoresult_yolov8n_ob,el_algo);
+		int nms_count = yolov8_ob_post_processing(yolov8n_ob_int_ptr,0.25, 0.45, algoresult_yolov8n_ob,el_algo);
+		#if YOLOV8_TRACKER || YOLOV8_TRACKER_RECORD
+			yolov8n_ob_track_update(algoresult_yolov8n_ob, nms_count);
+		#else
+			(void)nms_count;
+		#endif
 		#ifdef EACH_STEP_TICK
 			SystemGetTick(&systick_2, &loop_cnt_2);
 			dbg_printf(DBG_LESS_INFO,"Tick for Invoke for YOLOV8_OB_post_processing:[%d]\r\n\n",(loop_cnt_2-loop_cnt_1)*CPU_CLK+(systick_1-systick_2));    
@@ -626,39 +675,62 @@ int cv_yolov8n_ob_run(struct_yolov8_ob_algoResult *algoresult_yolov8n_ob) {
 	
 
 #ifdef UART_SEND_ALOGO_RESEULT
-	algoresult_yolov8n_ob->algo_tick = (loop_cnt_2-loop_cnt_1)*CPU_CLK+(systick_1-systick_2) + capture_image_tick;
+	algoresult_yolov8n_ob->algo_tick = (loop_cnt_2-loop_cnt_1)*CPU_CLK+(systick_1-systick_2);
+#endif
+	return ercode;
+}
+
+int cv_yolov8n_ob_send(struct_yolov8_ob_algoResult *algoresult_yolov8n_ob, uint32_t jpeg_addr, uint32_t jpeg_sz) {
+#ifdef UART_SEND_ALOGO_RESEULT
+std::forward_list<el_box_t> &el_algo = yolov8n_ob_el_algo;
 uint32_t judge_case_data;
 uint32_t g_trans_type;
 hx_drv_swreg_aon_get_appused1(&judge_case_data);
 g_trans_type = (judge_case_data>>16);
-if( g_trans_type == 0 || g_trans_type == 2)// transfer type is (UART) or (UART & SPI) 
+if( g_trans_type == 0 || g_trans_type == 2 || g_trans_type == 3)// transfer type is (UART), (UART & SPI) or (UART binary)
 {
 	//invalid dcache to let uart can send the right jpeg img out
-	hx_InvalidateDCache_by_Addr((volatile void *)app_get_jpeg_addr(), sizeof(uint8_t) *app_get_jpeg_sz());
+	hx_InvalidateDCache_by_Addr((volatile void *)jpeg_addr, sizeof(uint8_t) *jpeg_sz);
 
 	el_img_t temp_el_jpg_img = el_img_t{};
-	temp_el_jpg_img.data = (uint8_t *)app_get_jpeg_addr();
-	temp_el_jpg_img.size = app_get_jpeg_sz();
+	temp_el_jpg_img.data = (uint8_t *)jpeg_addr;
+	temp_el_jpg_img.size = jpeg_sz;
 	temp_el_jpg_img.width = app_get_raw_width();
 	temp_el_jpg_img.height = app_get_raw_height();
 	temp_el_jpg_img.format = EL_PIXEL_FORMAT_JPEG;
 	temp_el_jpg_img.rotate = EL_PIXEL_ROTATE_0;
 
-	send_device_id();
-	// event_reply(concat_strings(", ", box_results_2_json_str(el_algo), ", ", img_2_json_str(&temp_el_jpg_img)));
-	event_reply(concat_strings(", ", algo_tick_2_json_str(algoresult_yolov8n_ob->algo_tick),", ", box_results_2_json_str(el_algo), ", ", img_2_json_str(&temp_el_jpg_img)));
+	static char send_stream_buffer[SEND_STREAM_BUFFER_SIZE];
+	hx_json_stream send_stream;
+	send_stream_init(&send_stream, send_stream_buffer, sizeof(send_stream_buffer));
+	if( g_trans_type == 3)// binary frame, see send_result.h
+	{
+		el_bin_frame_t bin_frame;
+		bin_reply_begin(&bin_frame, &send_stream, algo_tick_2_bin_size() + box_results_2_bin_size(el_algo) + img_2_bin_size(&temp_el_jpg_img));
+		algo_tick_2_bin(&bin_frame, algoresult_yolov8n_ob->algo_tick);
+		box_results_2_bin(&bin_frame, el_algo);
+		img_2_bin(&bin_frame, &temp_el_jpg_img);
+		bin_reply_end(&bin_frame);
+	}
+	else
+	{
+		send_device_id();
+		// event_reply(concat_strings(", ", box_results_2_json_str(el_algo), ", ", img_2_json_str(&temp_el_jpg_img)));
+		// event_reply(concat_strings(", ", algo_tick_2_json_str(algoresult_yolov8n_ob->algo_tick),", ", box_results_2_json_str(el_algo), ", ", img_2_json_str(&temp_el_jpg_img)));
+		event_reply_begin(&send_stream);
+		hx_json_puts(&send_stream, ", ");
+		algo_tick_2_json_stream(&send_stream, algoresult_yolov8n_ob->algo_tick);
+		hx_json_puts(&send_stream, ", ");
+		box_results_2_json_stream(&send_stream, el_algo);
+		hx_json_puts(&send_stream, ", ");
+		img_2_json_stream(&send_stream, &temp_el_jpg_img);
+		event_reply_end(&send_stream);
+	}
 }
 	set_model_change_by_uart();
 #endif	
 
-	SystemGetTick(&systick_1, &loop_cnt_1);
-	//recapture image
-	sensordplib_retrigger_capture();
-
-	
-	SystemGetTick(&systick_2, &loop_cnt_2);
-	capture_image_tick = (loop_cnt_2-loop_cnt_1)*CPU_CLK+(systick_1-systick_2);	
-	return ercode;
+	return 0;
 }
 
 int cv_yolov8n_ob_deinit()
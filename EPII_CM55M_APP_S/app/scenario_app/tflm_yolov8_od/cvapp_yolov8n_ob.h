@@ -16,7 +16,14 @@ extern "C" {
 
 int cv_yolov8n_ob_init(bool security_enable, bool privilege_enable, uint32_t model_addr);
 
-int cv_yolov8n_ob_run(struct_yolov8_ob_algoResult *algoresult_yolov8n_ob);
+/* Runs the model on the raw frame at raw_addr; keeps the boxes for cv_yolov8n_ob_send(). */
+int cv_yolov8n_ob_run(struct_yolov8_ob_algoResult *algoresult_yolov8n_ob, uint32_t raw_addr);
+
+/* Sends the boxes of the last cv_yolov8n_ob_run() with the JPEG of the same frame. */
+int cv_yolov8n_ob_send(struct_yolov8_ob_algoResult *algoresult_yolov8n_ob, uint32_t jpeg_addr, uint32_t jpeg_sz);
+
+/* Marks the next frame as moving (CDM motion event), so that the tracker runs the model on it. */
+void cv_yolov8n_ob_set_motion(void);
 
 int cv_yolov8n_ob_deinit();
 #ifdef __cplusplus
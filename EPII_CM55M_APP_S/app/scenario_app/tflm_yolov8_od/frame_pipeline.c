@@ -0,0 +1,262 @@
+/*
+ * frame_pipeline.c
+ *
+ * See frame_pipeline.h. All functions run in the datapath event callback,
+ * not in interrupt context, so the slot states need no locking.
+ */
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "WE2_device.h"
+#include "WE2_core.h"
+#include "xprintf.h"
+#include "sensor_dp_lib.h"
+#include "hx_drv_jpeg.h"
+#include "cisdp_sensor.h"
+#include "memory_manage.h"
+#include "frame_pipeline.h"
+
+#define CPU_CLK	0xffffff+1
+
+/* Same sizes as cisdp_dp_init() reserves: JPEG buffer is a quarter of the
+ * pixel count, the autofill word is written by the JPEG encoder. */
+#define FRAME_PIPELINE_JPEG_AUTOFILL_SZ	100
+#define FRAME_PIPELINE_ALIGN			0x20
+
+static frame_slot_t g_slot[FRAME_PIPELINE_MAX_SLOTS];
+static uint32_t g_slot_cnt = 0;
+static FRAME_PIPELINE_POLICY_E g_policy = FRAME_PIPELINE_BACKPRESSURE;
+static int32_t g_capture_idx = -1;		/* slot in FRAME_SLOT_CAPTURE, -1 while stopped */
+static uint32_t g_wdma1_addr = 0;
+static uint32_t g_raw_sz = 0;
+static uint32_t g_seq = 0;
+
+/* statistics of the current report window, in ticks */
+static uint32_t g_stat_frames = 0;
+static uint32_t g_stat_dropped = 0;
+static uint32_t g_stat_stalled = 0;
+static uint64_t g_stat_capture = 0;
+static uint64_t g_stat_wait = 0;
+static uint64_t g_stat_infer = 0;
+static uint64_t g_stat_send = 0;
+static uint64_t g_stat_total = 0;
+static frame_tick_t g_stat_start;
+
+static void frame_pipeline_get_tick(frame_tick_t *tick)
+{
+	SystemGetTick(&tick->systick, &tick->loop_cnt);
+}
+
+static uint32_t frame_pipeline_tick_diff(const frame_tick_t *from, const frame_tick_t *to)
+{
+	return (to->loop_cnt-from->loop_cnt)*CPU_CLK+(from->systick-to->systick);
+}
+
+static void frame_pipeline_set_state(frame_slot_t *slot, FRAME_SLOT_STATE_E state)
+{
+	slot->state = state;
+	frame_pipeline_get_tick(&slot->tick[state]);
+}
+
+/* Oldest (lowest seq) or newest slot in the given state, -1 if none. */
+static int32_t frame_pipeline_find(FRAME_SLOT_STATE_E state, bool newest)
+{
+	int32_t found = -1;
+
+	for(uint32_t i = 0; i < g_slot_cnt; i++)
+	{
+		if(g_slot[i].state != state)
+			continue;
+		if(found < 0 || ((int32_t)(g_slot[i].seq - g_slot[found].seq) > 0) == newest)
+			found = i;
+	}
+	return found;
+}
+
+/* Points the datapath at a slot; retrigger is false only for the first frame,
+ * which cisdp_sensor_start() starts. */
+static void frame_pipeline_capture(uint32_t idx, bool retrigger)
+{
+	frame_slot_t *slot = &g_slot[idx];
+
+	sensordplib_set_xDMA_baseaddrbyapp(g_wdma1_addr, slot->jpeg_addr, slot->raw_addr);
+	sensordplib_set_jpegfilesize_addrbyapp(slot->jpeg_autofill_addr);
+	slot->seq = g_seq++;
+	slot->jpeg_sz = 0;
+	frame_pipeline_set_state(slot, FRAME_SLOT_CAPTURE);
+	g_capture_idx = idx;
+
+	if(retrigger)
+		sensordplib_retrigger_capture();
+}
+
+static void frame_pipeline_report(const frame_tick_t *now)
+{
+	uint32_t clk = 0;
+	uint32_t elapsed = frame_pipeline_tick_diff(&g_stat_start, now);
+	uint32_t n = g_stat_frames;
+
+	EPII_Get_Systemclock(&clk);
+	clk /= 1000000;
+	if(clk == 0 || n == 0 || elapsed == 0)
+		return;
+
+	xprintf("pipeline %d slots: %d.%02d fps, dropped %d, stalled %d\n", g_slot_cnt,
+			(uint32_t)((uint64_t)n * clk * 1000000 / elapsed),
+			(uint32_t)((uint64_t)n * clk * 100000000 / elapsed % 100),
+			g_stat_dropped, g_stat_stalled);
+	xprintf("pipeline avg us: capture %d, wait %d, infer %d, send %d, end to end %d\n",
+			(uint32_t)(g_stat_capture / n / clk), (uint32_t)(g_stat_wait / n / clk),
+			(uint32_t)(g_stat_infer / n / clk), (uint32_t)(g_stat_send / n / clk),
+			(uint32_t)(g_stat_total / n / clk));
+
+	g_stat_frames = 0;
+	g_stat_dropped = 0;
+	g_stat_stalled = 0;
+	g_stat_capture = 0;
+	g_stat_wait = 0;
+	g_stat_infer = 0;
+	g_stat_send = 0;
+	g_stat_total = 0;
+	g_stat_start = *now;
+}
+
+int frame_pipeline_init(uint32_t slot_cnt, FRAME_PIPELINE_POLICY_E policy)
+{
+	uint32_t wdma2_addr, wdma3_addr;
+	uint32_t jpeg_sz = app_get_raw_width() * app_get_raw_height() / 4;
+	uint32_t i;
+
+	if(slot_cnt < 2)
+		slot_cnt = 2;
+	if(slot_cnt > FRAME_PIPELINE_MAX_SLOTS)
+		slot_cnt = FRAME_PIPELINE_MAX_SLOTS;
+
+	memset(g_slot, 0, sizeof(g_slot));
+	g_policy = policy;
+	g_raw_sz = app_get_raw_sz();
+	g_seq = 0;
+
+	sensordplib_get_xDMA_baseaddr(&g_wdma1_addr, &wdma2_addr, &wdma3_addr);
+
+	for(i = 0; i < slot_cnt; i++)
+	{
+		frame_slot_t *slot = &g_slot[i];
+
+		if(i == 0)
+		{
+			slot->raw_addr = wdma3_addr;
+			slot->jpeg_addr = wdma2_addr;
+		}
+		else
+		{
+			slot->raw_addr = mm_reserve_align(g_raw_sz, FRAME_PIPELINE_ALIGN);
+			slot->jpeg_addr = mm_reserve_align(jpeg_sz, FRAME_PIPELINE_ALIGN);
+		}
+		slot->jpeg_autofill_addr = mm_reserve_align(FRAME_PIPELINE_JPEG_AUTOFILL_SZ, FRAME_PIPELINE_ALIGN);
+
+		if(slot->raw_addr == 0 || slot->jpeg_addr == 0 || slot->jpeg_autofill_addr == 0)
+		{
+			xprintf("frame pipeline: no memory for slot %d\n", i);
+			break;
+		}
+		xprintf("frame slot %d: RAW[%x], JPEG[%x], JPAuto[%x]\n", i, slot->raw_addr, slot->jpeg_addr,
+				slot->jpeg_autofill_addr);
+	}
+	g_slot_cnt = i;
+	if(g_slot_cnt == 0)
+	{
+		g_capture_idx = -1;
+		return 0;
+	}
+
+	frame_pipeline_capture(0, false);
+	frame_pipeline_get_tick(&g_stat_start);
+
+	return g_slot_cnt;
+}
+
+frame_slot_t *frame_pipeline_frame_ready(void)
+{
+	frame_slot_t *done;
+	int32_t next, infer;
+
+	if(g_capture_idx < 0)
+		return NULL;
+
+	done = &g_slot[g_capture_idx];
+	g_capture_idx = -1;
+
+	/* size the encoder wrote to the slot's own autofill word; the JPEG buffer
+	 * of a slot holds one frame (cyclic_buffer_cnt 1), so frame 0 */
+	hx_InvalidateDCache_by_Addr((volatile void *)done->jpeg_autofill_addr, FRAME_PIPELINE_ALIGN);
+	hx_drv_jpeg_get_FillFileSizeToMem(0, done->jpeg_autofill_addr, &done->jpeg_sz);
+	hx_InvalidateDCache_by_Addr((volatile void *)done->raw_addr, g_raw_sz);
+	frame_pipeline_set_state(done, FRAME_SLOT_READY);
+
+	/* keep the datapath busy before touching this frame */
+	next = frame_pipeline_find(FRAME_SLOT_FREE, false);
+	if(next < 0 && g_policy == FRAME_PIPELINE_DROP_OLDEST)
+	{
+		next = frame_pipeline_find(FRAME_SLOT_READY, false);
+		if(next >= 0 && &g_slot[next] != done)
+			g_stat_dropped++;
+		else
+			next = -1;
+	}
+	if(next >= 0)
+		frame_pipeline_capture(next, true);
+	else
+		g_stat_stalled++;
+
+	/* FIFO under back-pressure; newest first otherwise, dropping the rest */
+	infer = frame_pipeline_find(FRAME_SLOT_READY, g_policy == FRAME_PIPELINE_DROP_OLDEST);
+	if(infer < 0)
+		return NULL;
+
+	if(g_policy == FRAME_PIPELINE_DROP_OLDEST)
+	{
+		int32_t old;
+
+		while((old = frame_pipeline_find(FRAME_SLOT_READY, false)) >= 0 && old != infer)
+		{
+			g_slot[old].state = FRAME_SLOT_FREE;
+			g_stat_dropped++;
+		}
+	}
+
+	frame_pipeline_set_state(&g_slot[infer], FRAME_SLOT_INFER);
+	return &g_slot[infer];
+}
+
+void frame_pipeline_send(frame_slot_t *slot)
+{
+	frame_pipeline_set_state(slot, FRAME_SLOT_SEND);
+}
+
+void frame_pipeline_release(frame_slot_t *slot)
+{
+	frame_tick_t now;
+
+	frame_pipeline_get_tick(&now);
+	if(slot->state != FRAME_SLOT_SEND)
+		slot->tick[FRAME_SLOT_SEND] = now;
+
+	g_stat_frames++;
+	g_stat_capture += frame_pipeline_tick_diff(&slot->tick[FRAME_SLOT_CAPTURE], &slot->tick[FRAME_SLOT_READY]);
+	g_stat_wait += frame_pipeline_tick_diff(&slot->tick[FRAME_SLOT_READY], &slot->tick[FRAME_SLOT_INFER]);
+	g_stat_infer += frame_pipeline_tick_diff(&slot->tick[FRAME_SLOT_INFER], &slot->tick[FRAME_SLOT_SEND]);
+	g_stat_send += frame_pipeline_tick_diff(&slot->tick[FRAME_SLOT_SEND], &now);
+	g_stat_total += frame_pipeline_tick_diff(&slot->tick[FRAME_SLOT_CAPTURE], &now);
+
+	slot->state = FRAME_SLOT_FREE;
+
+	/* back-pressure released: restart the datapath into this slot */
+	if(g_capture_idx < 0)
+		frame_pipeline_capture(slot - g_slot, true);
+
+	if(g_stat_frames >= FRAME_PIPELINE_REPORT_FRAMES)
+		frame_pipeline_report(&now);
+}
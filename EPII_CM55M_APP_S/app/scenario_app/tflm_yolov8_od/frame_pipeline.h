@@ -0,0 +1,96 @@
+/*
+ * frame_pipeline.h
+ *
+ * Rotating WDMA frame slots so that the datapath captures the next frame
+ * while the CPU and NPU work on the previous one.
+ *
+ * Each slot owns a raw (WDMA3) buffer, a JPEG (WDMA2) buffer and a JPEG
+ * size autofill word. A slot moves through
+ *
+ *   FREE -> CAPTURE -> READY -> INFER -> SEND -> FREE
+ *
+ * Only one slot is in CAPTURE at a time: the datapath is retriggered into
+ * a free slot as soon as the previous capture completes, before that frame
+ * is inferred. When no slot is free the pipeline applies its policy:
+ * - FRAME_PIPELINE_BACKPRESSURE stops capturing until a slot is released,
+ * - FRAME_PIPELINE_DROP_OLDEST captures over the oldest READY frame that
+ *   has not been picked up yet, so the newest frame is always the one
+ *   inferred.
+ */
+
+#ifndef SCENARIO_TFLM_YOLOV8_OD_FRAME_PIPELINE_H_
+#define SCENARIO_TFLM_YOLOV8_OD_FRAME_PIPELINE_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define FRAME_PIPELINE_MAX_SLOTS	4
+#define FRAME_PIPELINE_REPORT_FRAMES	30	/* frames between two statistics reports */
+
+typedef enum {
+	FRAME_SLOT_FREE = 0,
+	FRAME_SLOT_CAPTURE,
+	FRAME_SLOT_READY,
+	FRAME_SLOT_INFER,
+	FRAME_SLOT_SEND,
+} FRAME_SLOT_STATE_E;
+
+typedef enum {
+	FRAME_PIPELINE_BACKPRESSURE = 0,
+	FRAME_PIPELINE_DROP_OLDEST,
+} FRAME_PIPELINE_POLICY_E;
+
+typedef struct {
+	uint32_t systick;
+	uint32_t loop_cnt;
+} frame_tick_t;
+
+typedef struct {
+	uint32_t raw_addr;			/* WDMA3, app_get_raw_sz() bytes */
+	uint32_t jpeg_addr;			/* WDMA2 */
+	uint32_t jpeg_autofill_addr;
+	uint32_t jpeg_sz;			/* valid from READY */
+	uint32_t seq;				/* capture sequence number */
+	FRAME_SLOT_STATE_E state;
+	frame_tick_t tick[FRAME_SLOT_SEND + 1];	/* when the slot entered each state */
+} frame_slot_t;
+
+/**
+ * \brief	Sets up slot_cnt slots. Slot 0 is the buffer set already given
+ * 			to the datapath by cisdp_dp_init(), the others are reserved with
+ * 			mm_reserve_align(). Call after cisdp_dp_init() and before
+ * 			cisdp_sensor_start(), which captures the first frame into slot 0.
+ * \param[in]	slot_cnt: 2 .. FRAME_PIPELINE_MAX_SLOTS
+ * \param[in]	policy: what to do when a capture completes and no slot is free
+ * \retval	number of slots set up (fewer than slot_cnt if memory ran out)
+ */
+int frame_pipeline_init(uint32_t slot_cnt, FRAME_PIPELINE_POLICY_E policy);
+
+/**
+ * \brief	Call on EVT_INDEX_XDMA_FRAME_READY. Marks the capturing slot READY,
+ * 			retriggers the datapath into the next slot and returns the newest
+ * 			READY slot, now in INFER, or NULL if there is none.
+ */
+frame_slot_t *frame_pipeline_frame_ready(void);
+
+/**
+ * \brief	Moves a slot to FRAME_SLOT_SEND once its results are computed.
+ */
+void frame_pipeline_send(frame_slot_t *slot);
+
+/**
+ * \brief	Gives a slot back after its results and JPEG are sent. Restarts
+ * 			the capture if it was stopped by back-pressure, and prints the
+ * 			frame rate and per stage latency every FRAME_PIPELINE_REPORT_FRAMES
+ * 			frames.
+ */
+void frame_pipeline_release(frame_slot_t *slot);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SCENARIO_TFLM_YOLOV8_OD_FRAME_PIPELINE_H_ */
@@ -0,0 +1,9 @@
+/* Host stand-in for WE2_core.h: the host has no data cache to maintain */
+#ifndef HOST_STUB_WE2_CORE_H
+#define HOST_STUB_WE2_CORE_H
+
+#include <stdint.h>
+
+static inline void hx_InvalidateDCache_by_Addr(volatile void *, int32_t) {}
+
+#endif
@@ -0,0 +1,10 @@
+/* Host stand-in for drivers/seconly_inc/hx_drv_swreg_aon.h */
+#ifndef HOST_STUB_HX_DRV_SWREG_AON_H
+#define HOST_STUB_HX_DRV_SWREG_AON_H
+
+#include <stdint.h>
+
+void hx_drv_swreg_aon_set_appused1(uint32_t data);
+void hx_drv_swreg_aon_get_appused1(uint32_t *data);
+
+#endif
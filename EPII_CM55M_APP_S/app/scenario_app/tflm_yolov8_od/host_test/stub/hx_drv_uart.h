@@ -0,0 +1,25 @@
+/* Host stand-in for drivers/inc/hx_drv_uart.h: writes go to host_uart_tx,
+ * uart_read_udma() never completes */
+#ifndef HOST_STUB_HX_DRV_UART_H
+#define HOST_STUB_HX_DRV_UART_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+typedef enum {
+    USE_DW_UART_0 = 0,
+} USE_DW_UART_E;
+
+#define UART_BAUDRATE_921600 921600
+
+typedef struct {
+    int (*uart_open)(uint32_t baud);
+    int (*uart_write)(const void *data, uint32_t len);
+    int (*uart_read)(void *data, uint32_t len);
+    int (*uart_read_nonblock)(void *data, uint32_t len);
+    int (*uart_read_udma)(void *data, uint32_t len, void *cb);
+} DEV_UART;
+
+DEV_UART *hx_drv_uart_get_dev(USE_DW_UART_E id);
+
+#endif
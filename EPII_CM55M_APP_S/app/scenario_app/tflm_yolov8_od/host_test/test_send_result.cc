@@ -0,0 +1,483 @@
+/*
+ * Host unit test for the streaming result serializer.
+ *
+ * Links the real send_result.cpp against the driver stand-ins in stub/
+ * and compares every *_2_json_stream() function and the
+ * event_reply_begin()/end() pair byte for byte with the std::string
+ * *_2_json_str() / event_reply() output, for several stream buffer sizes.
+ * Also checks the base64 encoder against the RFC 4648 vectors, counts
+ * heap allocations per frame reply, and decodes the binary result frames
+ * (bin_reply_begin() ...) back. With a file argument the binary frames are
+ * written there for result_protocol/result_decoder.py --check.
+ */
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <forward_list>
+#include <new>
+#include <string>
+#include <vector>
+
+extern "C" {
+#include "hx_drv_uart.h"
+#include "hx_drv_swreg_aon.h"
+}
+#include "send_result.h"
+
+static std::string uart_tx;
+static size_t heap_allocations;
+
+void *operator new(std::size_t size)
+{
+    heap_allocations++;
+    void *p = std::malloc(size ? size : 1);
+    if (!p)
+        throw std::bad_alloc();
+    return p;
+}
+
+void *operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void *p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void *p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void *p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void *p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+extern "C" {
+static int stub_uart_open(uint32_t)
+{
+    return 0;
+}
+
+static int stub_uart_write(const void *data, uint32_t len)
+{
+    uart_tx.append((const char *)data, len);
+    return (int)len;
+}
+
+static int stub_uart_read(void *, uint32_t)
+{
+    return 0;
+}
+
+static int stub_uart_read_udma(void *, uint32_t, void *)
+{
+    return 0;
+}
+
+DEV_UART *hx_drv_uart_get_dev(USE_DW_UART_E)
+{
+    static DEV_UART uart = {stub_uart_open, stub_uart_write, stub_uart_read, stub_uart_read, stub_uart_read_udma};
+    return &uart;
+}
+
+void hx_drv_swreg_aon_set_appused1(uint32_t) {}
+void hx_drv_swreg_aon_get_appused1(uint32_t *data)
+{
+    *data = 0;
+}
+
+void SetPSPDNoVid() {}
+}
+
+void el_base64_encode(const unsigned char *in, int in_len, char *out);
+
+namespace {
+
+uint32_t rng_state = 0x1357924u;
+
+uint32_t rand_u32(void)
+{
+    rng_state = rng_state * 1664525u + 1013904223u;
+    return rng_state >> 8;
+}
+
+int failures;
+int cases;
+
+void expect_same(const char *name, size_t buffer_size, const std::string &expected, const std::string &got)
+{
+    cases++;
+    if (expected == got)
+        return;
+    size_t at = 0;
+    while (at < expected.size() && at < got.size() && expected[at] == got[at])
+        at++;
+    printf("FAIL %s (buffer %zu): %zu/%zu bytes, first difference at %zu\n", name, buffer_size, got.size(),
+           expected.size(), at);
+    failures++;
+}
+
+int capture_sink(void *ctx, const char *data, size_t len)
+{
+    ((std::string *)ctx)->append(data, len);
+    return 0;
+}
+
+el_box_t rand_box(void)
+{
+    el_box_t b;
+    b.x = (uint16_t)rand_u32();
+    b.y = (uint16_t)rand_u32();
+    b.w = (uint16_t)(rand_u32() % 640);
+    b.h = (uint16_t)(rand_u32() % 480);
+    b.score = (uint8_t)rand_u32();
+    b.target = (uint8_t)(rand_u32() % 80);
+    return b;
+}
+
+el_point_t rand_point(void)
+{
+    el_point_t p;
+    p.x = (uint16_t)rand_u32();
+    p.y = (uint16_t)rand_u32();
+    p.score = (uint8_t)rand_u32();
+    p.target = (uint8_t)rand_u32();
+    return p;
+}
+
+el_struct_angle rand_angle(void)
+{
+    el_struct_angle a;
+    int16_t *v = (int16_t *)&a;
+    for (size_t i = 0; i < sizeof(a) / sizeof(int16_t); i++)
+        v[i] = (int16_t)rand_u32();
+    return a;
+}
+
+// Runs fn on a fresh stream with the given buffer and returns what reached the sink
+template <typename F> std::string stream_output(size_t buffer_size, F fn)
+{
+    std::string out;
+    std::vector<char> buf(buffer_size);
+    hx_json_stream s;
+    hx_json_stream_init(&s, buf.data(), buf.size(), capture_sink, &out);
+    fn(&s);
+    hx_json_flush(&s);
+    if (s.total != out.size()) {
+        printf("FAIL total %zu, sink got %zu\n", s.total, out.size());
+        failures++;
+    }
+    return out;
+}
+
+void check_base64(void)
+{
+    static const char *const vectors[][2] = {{"", ""},           {"f", "Zg=="},         {"fo", "Zm8="},
+                                             {"foo", "Zm9v"},    {"foob", "Zm9vYg=="},  {"fooba", "Zm9vYmE="},
+                                             {"foobar", "Zm9vYmFy"}};
+    char out[16];
+    for (const auto &v : vectors) {
+        size_t n = hx_base64_encode((const uint8_t *)v[0], strlen(v[0]), out);
+        cases++;
+        if (std::string(out, n) != v[1]) {
+            printf("FAIL hx_base64_encode(\"%s\") = \"%.*s\"\n", v[0], (int)n, out);
+            failures++;
+        }
+        memset(out, 0, sizeof(out));
+        el_base64_encode((const unsigned char *)v[0], (int)strlen(v[0]), out);
+        cases++;
+        if (std::string(out) != v[1]) {
+            printf("FAIL el_base64_encode(\"%s\") = \"%s\"\n", v[0], out);
+            failures++;
+        }
+    }
+}
+
+uint32_t get_le(const std::string &b, size_t at, int bytes)
+{
+    uint32_t v = 0;
+    for (int i = bytes - 1; i >= 0; i--)
+        v = v << 8 | (uint8_t)b[at + i];
+    return v;
+}
+
+// Frame with every record type, parsed back field by field
+std::string check_binary_frame(const std::forward_list<el_box_t> &boxes,
+                               const std::forward_list<el_keypoint_t> &keypoints, const el_img_t &img, uint32_t tick)
+{
+    std::string out = stream_output(63, [&](hx_json_stream *s) {
+        el_bin_frame_t f;
+        bin_reply_begin(&f, s,
+                        algo_tick_2_bin_size() + img_res_2_bin_size() + box_results_2_bin_size(boxes) +
+                            keypoint_results_2_bin_size(keypoints) + img_2_bin_size(&img));
+        algo_tick_2_bin(&f, tick);
+        img_res_2_bin(&f, &img);
+        box_results_2_bin(&f, boxes);
+        keypoint_results_2_bin(&f, keypoints);
+        img_2_bin(&f, &img);
+        bin_reply_end(&f);
+    });
+
+    std::vector<std::string> errors;
+    if (out.size() < 10 || out[0] != 'H' || out[1] != 'X' || out[2] != BIN_FRAME_VERSION)
+        errors.push_back("header");
+    else if (get_le(out, 4, 4) != out.size() - 10)
+        errors.push_back("payload length");
+    else if (get_le(out, out.size() - 2, 2) !=
+             el_crc16_maxim((const uint8_t *)out.data() + 2, out.size() - 4))
+        errors.push_back("crc");
+    else {
+        size_t pos = 8;
+        std::string expect;
+        while (pos < out.size() - 2) {
+            int type = (uint8_t)out[pos];
+            uint32_t len = get_le(out, pos + 1, 4);
+            pos += BIN_RECORD_HEADER_SIZE;
+            size_t at = pos;
+            auto box_ok = [&](const el_box_t &b) {
+                bool ok = get_le(out, at, 2) == b.x && get_le(out, at + 2, 2) == b.y && get_le(out, at + 4, 2) == b.w &&
+                          get_le(out, at + 6, 2) == b.h && (uint8_t)out[at + 8] == b.score &&
+                          (uint8_t)out[at + 9] == b.target;
+                at += BIN_BOX_SIZE;
+                return ok;
+            };
+            if (type == BIN_RECORD_ALGO_TICK && get_le(out, pos, 4) != tick)
+                errors.push_back("algo_tick");
+            if (type == BIN_RECORD_RESOLUTION && (get_le(out, pos, 2) != img.width || get_le(out, pos + 2, 2) != img.height))
+                errors.push_back("resolution");
+            if (type == BIN_RECORD_BOXES) {
+                for (const auto &b : boxes)
+                    if (!box_ok(b))
+                        errors.push_back("box");
+            }
+            if (type == BIN_RECORD_KEYPOINTS) {
+                for (const auto &k : keypoints) {
+                    if (!box_ok(k.el_box))
+                        errors.push_back("keypoint box");
+                    for (const auto &p : k.el_keypoint) {
+                        if (get_le(out, at, 2) != p.x || get_le(out, at + 2, 2) != p.y ||
+                            (uint8_t)out[at + 4] != p.score || (uint8_t)out[at + 5] != p.target)
+                            errors.push_back("keypoint");
+                        at += BIN_POINT_SIZE;
+                    }
+                }
+            }
+            if (type == BIN_RECORD_JPEG && (len != img.size || out.compare(pos, len, (const char *)img.data, len) != 0))
+                errors.push_back("jpeg");
+            if (type != BIN_RECORD_BOXES && type != BIN_RECORD_KEYPOINTS)
+                at = pos + len;
+            if (at != pos + len)
+                errors.push_back("record length");
+            pos += len;
+            expect += (char)type;
+        }
+        if (expect != "\x01\x02\x03\x04\x05")
+            errors.push_back("record order");
+    }
+    cases++;
+    for (const auto &e : errors)
+        printf("FAIL binary frame: %s\n", e.c_str());
+    if (!errors.empty())
+        failures++;
+    return out;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    const size_t buffer_sizes[] = {HX_JSON_STREAM_MIN_BUFFER, 17, 63, 1024, 4096};
+
+    check_base64();
+
+    // Images of every length around the buffer and 12-byte block boundaries, then JPEG sized
+    std::vector<uint8_t> jpeg(40000);
+    for (auto &b : jpeg)
+        b = (uint8_t)rand_u32();
+    std::vector<size_t> image_sizes;
+    for (size_t n = 0; n <= 100; n++)
+        image_sizes.push_back(n);
+    image_sizes.push_back(4095);
+    image_sizes.push_back(4096);
+    image_sizes.push_back(4097);
+    image_sizes.push_back(jpeg.size());
+
+    for (size_t buffer_size : buffer_sizes) {
+        for (size_t n : image_sizes) {
+            el_img_t img = el_img_t{};
+            img.data = jpeg.data();
+            img.size = n;
+            img.width = 640;
+            img.height = 480;
+            std::string expected = img_2_json_str(&img);
+            expect_same("img", buffer_size, expected,
+                        stream_output(buffer_size, [&](hx_json_stream *s) { img_2_json_stream(s, &img); }));
+        }
+    }
+
+    for (int round = 0; round < 20; round++) {
+        const size_t buffer_size = buffer_sizes[round % 5];
+        const int count = round % 4 == 0 ? 0 : 1 + (int)(rand_u32() % 4);
+        std::forward_list<el_box_t> boxes;
+        std::forward_list<el_keypoint_t> keypoints;
+        std::forward_list<el_fm_point_t> fm_points;
+        std::forward_list<el_fd_fl_t> fd_fl;
+        std::forward_list<el_fd_fl_el_9pt_t> fd_fl_9pt;
+        for (int i = 0; i < count; i++) {
+            boxes.emplace_front(rand_box());
+
+            el_keypoint_t kp;
+            kp.el_box = rand_box();
+            for (auto &p : kp.el_keypoint)
+                p = rand_point();
+            keypoints.emplace_front(kp);
+
+            static el_fm_point_t fm;
+            fm.el_box = rand_box();
+            for (auto &p : fm.el_fm_point)
+                p = rand_point();
+            for (auto &p : fm.el_fm_iris)
+                p = rand_point();
+            fm.el_fm_angle = rand_angle();
+            fm_points.emplace_front(fm);
+
+            el_fd_fl_t fl;
+            fl.el_box = rand_box();
+            for (auto &p : fl.el_fl)
+                p = rand_point();
+            fl.el_fl_angle = rand_angle();
+            fd_fl.emplace_front(fl);
+
+            el_fd_fl_el_9pt_t fl9;
+            fl9.el_box = rand_box();
+            for (auto &p : fl9.el_fl)
+                p = rand_point();
+            for (auto &p : fl9.left_eye_landmark)
+                p = rand_point();
+            for (auto &p : fl9.right_eye_landmark)
+                p = rand_point();
+            fl9.el_fl_angle = rand_angle();
+            fd_fl_9pt.emplace_front(fl9);
+        }
+        el_img_t img = el_img_t{};
+        img.width = (uint16_t)rand_u32();
+        img.height = (uint16_t)rand_u32();
+        uint32_t tick = rand_u32() << 8 | (rand_u32() & 0xff);
+
+        expect_same("boxes", buffer_size, box_results_2_json_str(boxes),
+                    stream_output(buffer_size, [&](hx_json_stream *s) { box_results_2_json_stream(s, boxes); }));
+        expect_same("fm_face_boxes", buffer_size, fm_face_bbox_results_2_json_str(boxes),
+                    stream_output(buffer_size,
+                                  [&](hx_json_stream *s) { fm_face_bbox_results_2_json_stream(s, boxes); }));
+        expect_same("keypoints", buffer_size, keypoint_results_2_json_str(keypoints),
+                    stream_output(buffer_size,
+                                  [&](hx_json_stream *s) { keypoint_results_2_json_stream(s, keypoints); }));
+        expect_same("fm_points", buffer_size, fm_point_results_2_json_str(fm_points),
+                    stream_output(buffer_size,
+                                  [&](hx_json_stream *s) { fm_point_results_2_json_stream(s, fm_points); }));
+        expect_same("fd_fl", buffer_size, fd_fl_results_2_json_str(fd_fl),
+                    stream_output(buffer_size, [&](hx_json_stream *s) { fd_fl_results_2_json_stream(s, fd_fl); }));
+        expect_same("fd_fl_el_9pt", buffer_size, fd_fl_el_9t_results_2_json_str(fd_fl_9pt),
+                    stream_output(buffer_size,
+                                  [&](hx_json_stream *s) { fd_fl_el_9t_results_2_json_stream(s, fd_fl_9pt); }));
+        expect_same("resolution", buffer_size, img_res_2_json_str(&img),
+                    stream_output(buffer_size, [&](hx_json_stream *s) { img_res_2_json_stream(s, &img); }));
+        expect_same("algo_tick", buffer_size, algo_tick_2_json_str(tick),
+                    stream_output(buffer_size, [&](hx_json_stream *s) { algo_tick_2_json_stream(s, tick); }));
+    }
+
+    // A whole frame reply as cv_yolov8n_ob_run() sends it, through the UART stub
+    std::forward_list<el_box_t> boxes;
+    for (int i = 0; i < 10; i++)
+        boxes.emplace_front(rand_box());
+    el_img_t img = el_img_t{};
+    img.data = jpeg.data();
+    img.size = 30001;
+    const uint32_t tick = 123456;
+    const int runs = 50;
+    static char stream_buffer[1024];
+
+    uart_tx.reserve(64 * 1024 * runs);
+    uart_tx.clear();
+    heap_allocations = 0;
+    auto t0 = std::chrono::steady_clock::now();
+    for (int r = 0; r < runs; r++)
+        event_reply(concat_strings(", ", algo_tick_2_json_str(tick), ", ", box_results_2_json_str(boxes), ", ",
+                                   img_2_json_str(&img)));
+    auto t1 = std::chrono::steady_clock::now();
+    const size_t string_allocations = heap_allocations;
+    std::string expected = uart_tx.substr(0, uart_tx.size() / runs);
+
+    uart_tx.clear();
+    heap_allocations = 0;
+    auto t2 = std::chrono::steady_clock::now();
+    for (int r = 0; r < runs; r++) {
+        hx_json_stream s;
+        send_stream_init(&s, stream_buffer, sizeof(stream_buffer));
+        event_reply_begin(&s);
+        hx_json_puts(&s, ", ");
+        algo_tick_2_json_stream(&s, tick);
+        hx_json_puts(&s, ", ");
+        box_results_2_json_stream(&s, boxes);
+        hx_json_puts(&s, ", ");
+        img_2_json_stream(&s, &img);
+        cases++;
+        if (event_reply_end(&s) != EL_OK) {
+            printf("FAIL event_reply_end\n");
+            failures++;
+        }
+    }
+    auto t3 = std::chrono::steady_clock::now();
+    const size_t stream_allocations = heap_allocations;
+    expect_same("event_reply", sizeof(stream_buffer), expected, uart_tx.substr(0, uart_tx.size() / runs));
+
+    // CRC-16/MAXIM check value
+    cases++;
+    if (el_crc16_maxim((const uint8_t *)"123456789", 9) != 0x44c2) {
+        printf("FAIL el_crc16_maxim check value\n");
+        failures++;
+    }
+
+    std::forward_list<el_keypoint_t> keypoints;
+    for (int i = 0; i < 3; i++) {
+        el_keypoint_t kp;
+        kp.el_box = rand_box();
+        for (auto &p : kp.el_keypoint)
+            p = rand_point();
+        keypoints.emplace_front(kp);
+    }
+    img.width = 640;
+    img.height = 480;
+    std::string frames = check_binary_frame(boxes, keypoints, img, tick);
+    const size_t binary_size = frames.size();
+    frames += "\r{\"type\": 0, \"name\": \"HX noise\"}\n";
+    img.size = 7;
+    frames += check_binary_frame(std::forward_list<el_box_t>(), std::forward_list<el_keypoint_t>(), img, 0);
+    if (argc > 1) {
+        FILE *f = fopen(argv[1], "wb");
+        if (!f || fwrite(frames.data(), 1, frames.size(), f) != frames.size()) {
+            printf("FAIL writing %s\n", argv[1]);
+            failures++;
+        }
+        if (f)
+            fclose(f);
+    }
+
+    printf("%d cases, %d failures\n", cases, failures);
+    printf("binary frame with 3 keypoint results (%zu bytes)\n", binary_size);
+    printf("frame reply (%zu bytes): std::string %.1f us %zu allocations, stream %.1f us %zu allocations\n",
+           expected.size(), std::chrono::duration<double, std::micro>(t1 - t0).count() / runs,
+           string_allocations / runs, std::chrono::duration<double, std::micro>(t3 - t2).count() / runs,
+           stream_allocations / runs);
+    return failures ? 1 : 0;
+}
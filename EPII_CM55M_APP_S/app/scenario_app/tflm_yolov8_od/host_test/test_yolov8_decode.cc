@@ -0,0 +1,247 @@
+/*
+ * Host unit test for yolov8_decode_int8().
+ *
+ * Compares the int8-domain decoder with a copy of the float loop of
+ * cvapp_yolov8n_ob.cpp (every element dequantized, then argmax and
+ * threshold) on random and hand-made split YOLOv8 outputs. Candidates,
+ * class indexes, confidences and boxes must match bit for bit.
+ */
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "yolov8_decode.h"
+#include "yolo_postprocessing.h"
+
+namespace {
+
+const int kAnchors = 756;
+const int kClasses = 80;
+const int kInputSize = 192;
+
+uint32_t rng_state = 0x2468aceu;
+
+uint32_t rand_u32(void)
+{
+    rng_state = rng_state * 1664525u + 1013904223u;
+    return rng_state;
+}
+
+int8_t rand_s8(void)
+{
+    return (int8_t)(rand_u32() >> 24);
+}
+
+struct reference_result {
+    std::vector<uint16_t> class_idxs;
+    std::vector<float> confidences;
+    std::vector<box> boxes;
+};
+
+// The decode loop of yolov8_ob_post_processing() before the int8 decoder
+reference_result original_decode(const int8_t *bbox_data, float output_scale, int output_zeropoint,
+                                 const int8_t *cls_data, float output_2_scale, int output_2_zeropoint,
+                                 float modelScoreThreshold)
+{
+    reference_result r;
+    int input_w = kInputSize;
+    int input_h = kInputSize;
+    for (int dims_cnt_2 = 0; dims_cnt_2 < kAnchors; dims_cnt_2++) {
+        float outputs_bbox_data[4];
+        float maxScore = (-1);
+        uint16_t maxClassIndex = 0;
+        for (int dims_cnt_1 = 0; dims_cnt_1 < 4; dims_cnt_1++) {
+            int value = bbox_data[dims_cnt_2 + dims_cnt_1 * kAnchors];
+            float deq_value = ((float)value - (float)output_zeropoint) * output_scale;
+            if (dims_cnt_1 % 2)
+                deq_value *= (float)input_h;
+            else
+                deq_value *= (float)input_w;
+            outputs_bbox_data[dims_cnt_1] = deq_value;
+        }
+        for (int output_2_dims_cnt_1 = 0; output_2_dims_cnt_1 < kClasses; output_2_dims_cnt_1++) {
+            int value_2 = cls_data[output_2_dims_cnt_1 + dims_cnt_2 * kClasses];
+            float deq_value_2 = ((float)value_2 - (float)output_2_zeropoint) * output_2_scale;
+            if (maxScore < deq_value_2) {
+                maxScore = deq_value_2;
+                maxClassIndex = output_2_dims_cnt_1;
+            }
+        }
+        if (maxScore >= modelScoreThreshold) {
+            box bbox;
+            bbox.x = (outputs_bbox_data[0] - (0.5 * outputs_bbox_data[2]));
+            bbox.y = (outputs_bbox_data[1] - (0.5 * outputs_bbox_data[3]));
+            bbox.w = (outputs_bbox_data[2]);
+            bbox.h = (outputs_bbox_data[3]);
+            r.boxes.push_back(bbox);
+            r.class_idxs.push_back(maxClassIndex);
+            r.confidences.push_back(maxScore);
+        }
+    }
+    return r;
+}
+
+bool same_float(float a, float b)
+{
+    return memcmp(&a, &b, sizeof(float)) == 0;
+}
+
+bool same_box(const hx_nms_boxes &a, const hx_nms_boxes &b, int i)
+{
+    return same_float(a.x[i], b.x[i]) && same_float(a.y[i], b.y[i]) && same_float(a.w[i], b.w[i]) &&
+           same_float(a.h[i], b.h[i]);
+}
+
+bool same_candidate(const hx_nms_boxes &out, int i, const reference_result &ref)
+{
+    const box &b = ref.boxes[i];
+    return out.group[i] == ref.class_idxs[i] && same_float(out.score[i], ref.confidences[i]) &&
+           same_float(out.x[i], b.x) && same_float(out.y[i], b.y) && same_float(out.w[i], b.w) &&
+           same_float(out.h[i], b.h);
+}
+
+int failures = 0;
+
+void check(const char *name, const std::vector<int8_t> &bbox_data, float bbox_scale, int bbox_zp,
+           const std::vector<int8_t> &cls_data, float cls_scale, int cls_zp, float threshold)
+{
+    static hx_nms_boxes int8_out, float_out;
+    yolov8_tensor_q bbox = {bbox_data.data(), bbox_scale, bbox_zp};
+    yolov8_tensor_q cls = {cls_data.data(), cls_scale, cls_zp};
+
+    reference_result ref = original_decode(bbox_data.data(), bbox_scale, bbox_zp, cls_data.data(), cls_scale,
+                                           cls_zp, threshold);
+    yolov8_decode_int8(&bbox, &cls, kAnchors, kClasses, threshold, kInputSize, kInputSize, &int8_out);
+    yolov8_decode_float(&bbox, &cls, kAnchors, kClasses, threshold, kInputSize, kInputSize, &float_out);
+
+    // Past capacity the candidate sets differ from the unbounded reference by design
+    int expected = (int)ref.boxes.size();
+    if (expected > HX_NMS_MAX_BOXES) {
+        bool ok = int8_out.count == HX_NMS_MAX_BOXES && float_out.count == int8_out.count &&
+                  int8_out.dropped == expected - HX_NMS_MAX_BOXES;
+        for (int i = 0; ok && i < int8_out.count; i++) {
+            ok = same_float(int8_out.score[i], float_out.score[i]) && int8_out.group[i] == float_out.group[i] &&
+                 same_box(int8_out, float_out, i);
+        }
+        if (!ok) {
+            printf("FAIL %s: capacity handling differs (%d reference candidates)\n", name, expected);
+            failures++;
+        }
+        return;
+    }
+
+    if (int8_out.count != expected || float_out.count != expected) {
+        printf("FAIL %s: candidates int8 %d float %d reference %d\n", name, int8_out.count, float_out.count,
+               expected);
+        failures++;
+        return;
+    }
+    for (int i = 0; i < expected; i++) {
+        if (!same_candidate(int8_out, i, ref) || !same_candidate(float_out, i, ref)) {
+            printf("FAIL %s: candidate %d class %d/%d score %.9g/%.9g\n", name, i, int8_out.group[i],
+                   ref.class_idxs[i], int8_out.score[i], ref.confidences[i]);
+            failures++;
+            return;
+        }
+    }
+}
+
+void fill_random(std::vector<int8_t> &v)
+{
+    for (size_t i = 0; i < v.size(); i++)
+        v[i] = rand_s8();
+}
+
+// Mostly background scores near the zero point, a few objects above it
+void fill_realistic(std::vector<int8_t> &cls, int zp, int objects)
+{
+    for (size_t i = 0; i < cls.size(); i++)
+        cls[i] = (int8_t)(zp + (int)(rand_u32() >> 29));
+    for (int o = 0; o < objects; o++) {
+        int anchor = rand_u32() % kAnchors;
+        int c = rand_u32() % kClasses;
+        cls[anchor * kClasses + c] = rand_s8();
+    }
+}
+
+} // namespace
+
+int main(void)
+{
+    std::vector<int8_t> bbox(4 * kAnchors), cls(kAnchors * kClasses);
+    const float thresholds[] = {0.25f, 0.0f, 0.5f, 0.0039215689f, 0.99f, 1.5f, -2.0f};
+    const float scales[] = {0.00390625f, 0.0039215689f, 0.0078125f, 0.02f};
+    const int zps[] = {-128, -100, 0, 17};
+    int cases = 0;
+
+    // Random tensors over a grid of quantization parameters and thresholds
+    for (int round = 0; round < 20; round++) {
+        for (float scale : scales) {
+            for (int zp : zps) {
+                for (float thr : thresholds) {
+                    fill_random(bbox);
+                    if (round % 2)
+                        fill_realistic(cls, zp, 40);
+                    else
+                        fill_random(cls);
+                    check("random", bbox, 0.005f, -3, cls, scale, zp, thr);
+                    cases++;
+                }
+            }
+        }
+    }
+
+    // Every anchor scores exactly one step below / at the quantized threshold
+    for (float scale : scales) {
+        for (int zp : zps) {
+            int q = yolov8_quantize_threshold(0.25f, scale, zp);
+            if (q > 127)
+                continue;
+            fill_random(bbox);
+            memset(cls.data(), q - 1 < -128 ? -128 : q - 1, cls.size());
+            check("below threshold", bbox, 0.005f, 0, cls, scale, zp, 0.25f);
+            for (int a = 0; a < kAnchors; a++)
+                cls[a * kClasses + a % kClasses] = (int8_t)q;
+            check("at threshold", bbox, 0.005f, 0, cls, scale, zp, 0.25f);
+            cases += 2;
+        }
+    }
+
+    // Ties: the first class holding the maximum wins
+    fill_random(bbox);
+    memset(cls.data(), -128, cls.size());
+    for (int a = 0; a < kAnchors; a++) {
+        cls[a * kClasses + (a % 40) + 40] = 100;
+        cls[a * kClasses + (a % 40) + 17] = 100;
+    }
+    check("ties", bbox, 0.005f, 0, cls, 0.00390625f, -128, 0.25f);
+    cases++;
+
+    // Every anchor passes
+    fill_random(bbox);
+    fill_random(cls);
+    check("overflow", bbox, 0.005f, 0, cls, 0.00390625f, -128, 0.0f);
+    cases++;
+
+    // Host timing of one frame with a realistic score distribution
+    fill_random(bbox);
+    fill_realistic(cls, -128, 40);
+    static hx_nms_boxes out;
+    yolov8_tensor_q tb = {bbox.data(), 0.005f, 0};
+    yolov8_tensor_q tc = {cls.data(), 0.00390625f, -128};
+    const int runs = 2000;
+    auto t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < runs; i++)
+        yolov8_decode_float(&tb, &tc, kAnchors, kClasses, 0.25f, kInputSize, kInputSize, &out);
+    auto t1 = std::chrono::steady_clock::now();
+    for (int i = 0; i < runs; i++)
+        yolov8_decode_int8(&tb, &tc, kAnchors, kClasses, 0.25f, kInputSize, kInputSize, &out);
+    auto t2 = std::chrono::steady_clock::now();
+    double float_us = std::chrono::duration<double, std::micro>(t1 - t0).count() / runs;
+    double int8_us = std::chrono::duration<double, std::micro>(t2 - t1).count() / runs;
+
+    printf("%d cases, %d failures\n", cases, failures);
+    printf("decode per frame: float %.1f us, int8 %.1f us (%d candidates)\n", float_us, int8_us, out.count);
+    return failures ? 1 : 0;
+}
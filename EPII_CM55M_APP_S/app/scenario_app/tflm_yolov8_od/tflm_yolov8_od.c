@@ -65,6 +65,7 @@
 #include "cisdp_sensor.h"
 #include "event_handler.h"
 #include "cvapp_yolov8n_ob.h"
+#include "frame_pipeline.h"
 #include "memory_manage.h"
 #include "hx_drv_watchdog.h"
 
@@ -89,6 +90,14 @@
 
 #define GROVE_VISION_AI_II
 
+/*
+ * The datapath captures the next frame into another slot while the current
+ * one is inferred and sent. Two slots are enough while every frame is sent
+ * before the next frame ready event; more only help if slots are held longer.
+ */
+#define FRAME_PIPELINE_SLOTS	2
+#define FRAME_PIPELINE_POLICY	FRAME_PIPELINE_DROP_OLDEST
+
 static uint8_t 	g_xdma_abnormal, g_md_detect, g_cdm_fifoerror, g_wdt1_timeout, g_wdt2_timeout,g_wdt3_timeout;
 static uint8_t 	g_hxautoi2c_error, g_inp1bitparer_abnormal;
 static uint32_t g_dp_event;
@@ -692,6 +701,7 @@ static void dp_app_cv_yolov8n_ob_eventhdl_cb(EVT_INDEX_E event)
 		 * */
 		dbg_printf(DBG_LESS_INFO, "Motion Detect\n");
 		g_md_detect = 1;
+		cv_yolov8n_ob_set_motion();
 		break;
 	case EVT_INDEX_XDMA_FRAME_READY:
 		g_cur_jpegenc_frame++;
@@ -735,14 +745,19 @@ static void dp_app_cv_yolov8n_ob_eventhdl_cb(EVT_INDEX_E event)
 
 		//TODO: check if register changed by pc tool
 
-		cisdp_get_jpginfo(&jpeg_sz, &jpeg_addr);
+		//datapath goes on with the next slot, this frame stays in its own one
+		frame_slot_t *slot = frame_pipeline_frame_ready();
+		if(slot == NULL)
+			return;
+		jpeg_sz = slot->jpeg_sz;
+		jpeg_addr = slot->jpeg_addr;
 
 #if FRAME_CHECK_DEBUG
 			if(g_spi_master_initial_status == 0) {
 				if(hx_drv_spi_mst_open_speed(SPI_SEN_PIC_CLK) != 0)
 				{
 					dbg_printf(DBG_LESS_INFO, "DEBUG SPI master init fail\r\n");
-					sensordplib_retrigger_capture();
+					frame_pipeline_release(slot);
 					return ;
 				}
 				g_spi_master_initial_status = 1;
@@ -751,7 +766,7 @@ static void dp_app_cv_yolov8n_ob_eventhdl_cb(EVT_INDEX_E event)
 
 				hx_drv_swreg_aon_get_appused1(&judge_case_data);
 				g_trans_type = (judge_case_data>>16);
-				if( g_trans_type == 0 )// transfer type is (UART) 
+				if( g_trans_type == 0 || g_trans_type == 3 )// transfer type is (UART) or (UART binary)
 				{
 
 				}
@@ -772,9 +787,9 @@ static void dp_app_cv_yolov8n_ob_eventhdl_cb(EVT_INDEX_E event)
 
 	hx_drv_swreg_aon_get_appused1(&judge_case_data);
 	g_trans_type = (judge_case_data>>16);
-	if( g_trans_type == 0 )// transfer type is (UART) 
+	if( g_trans_type == 0 || g_trans_type == 3 )// transfer type is (UART) or (UART binary)
 	{
-		cv_yolov8n_ob_run(&algoresult_yolov8n_ob);
+		cv_yolov8n_ob_run(&algoresult_yolov8n_ob, slot->raw_addr);
 	}
 	else if( g_trans_type == 1 || g_trans_type == 2)// transfer type is (SPI) or (UART & SPI) 
 	{
@@ -783,7 +798,7 @@ static void dp_app_cv_yolov8n_ob_eventhdl_cb(EVT_INDEX_E event)
 				uint32_t loop_cnt_1, loop_cnt_2;
 				SystemGetTick(&systick_1, &loop_cnt_1);
 		#endif
-			cv_yolov8n_ob_run(&algoresult_yolov8n_ob);
+			cv_yolov8n_ob_run(&algoresult_yolov8n_ob, slot->raw_addr);
 
 		#if TOTAL_STEP_TICK						
 				SystemGetTick(&systick_2, &loop_cnt_2);
@@ -808,7 +823,7 @@ static void dp_app_cv_yolov8n_ob_eventhdl_cb(EVT_INDEX_E event)
 			SystemGetTick(&systick_1, &loop_cnt_1);
 	#endif
 
-			cv_yolov8n_ob_run(&algoresult_yolov8n_ob);
+			cv_yolov8n_ob_run(&algoresult_yolov8n_ob, slot->raw_addr);
 	#if TOTAL_STEP_TICK						
 			SystemGetTick(&systick_2, &loop_cnt_2);
 		#if TOTAL_STEP_TICK_DBG_LOG
@@ -822,6 +837,9 @@ static void dp_app_cv_yolov8n_ob_eventhdl_cb(EVT_INDEX_E event)
 	#endif
 
 #endif
+		frame_pipeline_send(slot);
+		cv_yolov8n_ob_send(&algoresult_yolov8n_ob, slot->jpeg_addr, slot->jpeg_sz);
+
 		//clear_alg_hp_rsult
 		for (int i = 0; i < MAX_TRACKED_YOLOV8_ALGO_RES; ++i) 
 		{
@@ -833,9 +851,8 @@ static void dp_app_cv_yolov8n_ob_eventhdl_cb(EVT_INDEX_E event)
 			algoresult_yolov8n_ob.obr[i].class_idx = 0;
 		}
 #endif
-		//recapture image
-		//comment here, we will re-trigger at cv run
-		//sensordplib_retrigger_capture();
+		//the next capture was already triggered by frame_pipeline_frame_ready()
+		frame_pipeline_release(slot);
 	}
 
 	if(g_md_detect == 1)
@@ -863,7 +880,7 @@ void app_start_state(APP_STATE_E state)
 
 	hx_drv_swreg_aon_get_appused1(&judge_case_data);
 	g_trans_type = (judge_case_data>>16);
-	if( g_trans_type == 0 || g_trans_type == 2)// transfer type is (UART) or (UART & SPI) 
+	if( g_trans_type == 0 || g_trans_type == 2 || g_trans_type == 3)// transfer type is (UART), (UART & SPI) or (UART binary)
 	{
 		if(state == APP_STATE_ALLON_YOLOV8N_OB)
 		{
@@ -895,6 +912,12 @@ void app_start_state(APP_STATE_E state)
         }
 	}
 #endif
+	if(frame_pipeline_init(FRAME_PIPELINE_SLOTS, FRAME_PIPELINE_POLICY) == 0)
+	{
+		xprintf("\r\nframe pipeline init fail\r\n");
+		APP_BLOCK_FUNC();
+	}
+
 	event_handler_init();
 
     cisdp_sensor_start();
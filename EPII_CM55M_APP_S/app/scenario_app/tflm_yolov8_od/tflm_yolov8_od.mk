@@ -17,7 +17,7 @@ EVENTHANDLER_SUPPORT_LIST += evt_datapath
 # The source code should be loacted in ~\library\{lib_name}\
 ##
 # LIB_SEL = pwrmgmt sensordp tflmtag2209_u55tag2205 spi_ptl spi_eeprom hxevent img_proc
-LIB_SEL = pwrmgmt sensordp tflmtag2412_u55tag2411 spi_ptl spi_eeprom hxevent img_proc
+LIB_SEL = pwrmgmt sensordp tflmtag2412_u55tag2411 spi_ptl spi_eeprom hxevent img_proc nms json_stream img_preproc tracker ring
 
 ##
 # middleware support feature
@@ -0,0 +1,107 @@
+#include "yolov8_decode.h"
+
+#if defined(__ARM_FEATURE_MVE) && (__ARM_FEATURE_MVE & 1)
+#include <arm_mve.h>
+#define YOLOV8_DECODE_HELIUM 1
+#endif
+
+static inline float dequantize(int value, const yolov8_tensor_q *t)
+{
+    return ((float)value - (float)t->zero_point) * t->scale;
+}
+
+int yolov8_quantize_threshold(float threshold, float scale, int zero_point)
+{
+    for (int q = -128; q <= 127; q++) {
+        if (((float)q - (float)zero_point) * scale >= threshold)
+            return q;
+    }
+    return 128;
+}
+
+static void push_candidate(hx_nms_boxes *out, const float bbox_data[4], float score, uint16_t class_idx)
+{
+    float x = (bbox_data[0] - (0.5 * bbox_data[2]));
+    float y = (bbox_data[1] - (0.5 * bbox_data[3]));
+    hx_nms_add(out, x, y, bbox_data[2], bbox_data[3], score, class_idx);
+}
+
+static void read_bbox(const yolov8_tensor_q *bbox, int num_anchors, int anchor, int input_w, int input_h,
+                      float bbox_data[4])
+{
+    for (int i = 0; i < 4; i++) {
+        float value = dequantize(bbox->data[anchor + i * num_anchors], bbox);
+        bbox_data[i] = value * (float)((i % 2) ? input_h : input_w);
+    }
+}
+
+static inline int8_t row_max(const int8_t *row, int n)
+{
+#ifdef YOLOV8_DECODE_HELIUM
+    int8_t max = INT8_MIN;
+    while (n > 0) {
+        mve_pred16_t p = vctp8q(n);
+        int8x16_t v = vldrbq_z_s8(row, p);
+        max = vmaxvq_p_s8(max, v, p);
+        row += 16;
+        n -= 16;
+    }
+    return max;
+#else
+    int8_t max = row[0];
+    for (int i = 1; i < n; i++) {
+        if (row[i] > max)
+            max = row[i];
+    }
+    return max;
+#endif
+}
+
+void yolov8_decode_int8(const yolov8_tensor_q *bbox, const yolov8_tensor_q *cls, int num_anchors, int num_classes,
+                        float score_threshold, int input_w, int input_h, hx_nms_boxes *out)
+{
+    const int q_threshold = yolov8_quantize_threshold(score_threshold, cls->scale, cls->zero_point);
+
+    hx_nms_reset(out);
+    if (q_threshold > 127)
+        return;
+
+    const int8_t *row = cls->data;
+    for (int anchor = 0; anchor < num_anchors; anchor++, row += num_classes) {
+        const int8_t max = row_max(row, num_classes);
+        if (max < q_threshold)
+            continue;
+
+        // First class holding the maximum, like the strict '<' of the float search
+        uint16_t class_idx = 0;
+        while (row[class_idx] != max)
+            class_idx++;
+
+        float bbox_data[4];
+        read_bbox(bbox, num_anchors, anchor, input_w, input_h, bbox_data);
+        push_candidate(out, bbox_data, dequantize(max, cls), class_idx);
+    }
+}
+
+void yolov8_decode_float(const yolov8_tensor_q *bbox, const yolov8_tensor_q *cls, int num_anchors, int num_classes,
+                         float score_threshold, int input_w, int input_h, hx_nms_boxes *out)
+{
+    hx_nms_reset(out);
+
+    for (int anchor = 0; anchor < num_anchors; anchor++) {
+        float bbox_data[4];
+        float max_score = (-1);
+        uint16_t max_class_idx = 0;
+
+        read_bbox(bbox, num_anchors, anchor, input_w, input_h, bbox_data);
+        for (int c = 0; c < num_classes; c++) {
+            float score = dequantize(cls->data[c + anchor * num_classes], cls);
+            if (max_score < score) {
+                max_score = score;
+                max_class_idx = c;
+            }
+        }
+        if (max_score >= score_threshold)
+            push_candidate(out, bbox_data, max_score, max_class_idx);
+    }
+}
@@ -0,0 +1,45 @@
+#ifndef YOLOV8_DECODE_H
+#define YOLOV8_DECODE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "hx_nms.h"
+
+typedef struct yolov8_tensor_q {
+    const int8_t *data;
+    float scale;
+    int zero_point;
+} yolov8_tensor_q;
+
+/**
+ * @brief Returns the smallest int8 value whose dequantized score is >= threshold.
+ *
+ * Uses the same float expression as the dequantizing decoder, so comparing
+ * raw int8 scores against it selects exactly the same anchors.
+ * Returns 128 if no int8 value reaches the threshold.
+ */
+int yolov8_quantize_threshold(float threshold, float scale, int zero_point);
+
+/**
+ * @brief Decodes the split YOLOv8 outputs in the int8 domain.
+ *
+ * bbox is [1, 4, num_anchors] (cx, cy, w, h normalized), cls is
+ * [1, num_anchors, num_classes]. Each anchor's class row is reduced to its
+ * int8 maximum (Helium on Cortex-M55) and rejected against the quantized
+ * threshold; only surviving anchors have their score and box dequantized.
+ * Boxes are scaled to input_w x input_h pixels and added to out with the
+ * class index as group, ready for hx_nms_run().
+ */
+void yolov8_decode_int8(const yolov8_tensor_q *bbox, const yolov8_tensor_q *cls, int num_anchors, int num_classes,
+                        float score_threshold, int input_w, int input_h, hx_nms_boxes *out);
+
+/**
+ * @brief Reference decoder that dequantizes every element to float first.
+ *
+ * Same results as yolov8_decode_int8(), kept for the host test and the
+ * post-processing tick comparison (YOLOV8_POST_EACH_STEP_TICK).
+ */
+void yolov8_decode_float(const yolov8_tensor_q *bbox, const yolov8_tensor_q *cls, int num_anchors, int num_classes,
+                         float score_threshold, int input_w, int input_h, hx_nms_boxes *out);
+
+#endif
@@ -35,6 +35,8 @@
 #include "cisdp_cfg.h"
 #include "memory_manage.h"
 #include "yolo_postprocessing.h"
+#include "hx_nms.h"
+#include "hx_img_preproc.h"
 #include "send_result.h"
 #define YOLOV8_POSE_INPUT_224 0
 #define YOLOV8_POSE_INPUT_256 1
@@ -70,6 +72,9 @@
 #endif
 
 
+static hx_img_preproc yolov8_pose_preproc;
+static int16_t yolov8_pose_preproc_work[HX_IMG_PREPROC_WORK_SIZE(DP_INP_OUT_WIDTH, YOLOV8_POSE_INPUT_TENSOR_WIDTH, 3) / 2];
+
 using namespace std;
 
 namespace {
@@ -347,54 +352,6 @@ int cv_yolov8_pose_init(bool security_enable, bool privilege_enable, uint32_t mo
 	return ercode;
 }
 
-typedef struct detection_cls_yolov8{
-    box bbox;
-    float confidence;
-    float index;
-
-} detection_cls_yolov8;
-
-bool yolov8_det_comparator(detection_cls_yolov8 &pa, detection_cls_yolov8 &pb)
-{
-    return pa.confidence > pb.confidence;
-}
-
-static void  yolov8_NMSBoxes(std::vector<box> &boxes,std::vector<float> &confidences,float modelScoreThreshold,float modelNMSThreshold,std::vector<int>& nms_result)
-{
-    detection_cls_yolov8 yolov8_bbox;
-    std::vector<detection_cls_yolov8> yolov8_bboxes{};
-    for(int i = 0; i < boxes.size(); i++)
-    {
-        yolov8_bbox.bbox = boxes[i];
-        yolov8_bbox.confidence = confidences[i];
-        yolov8_bbox.index = i;
-        yolov8_bboxes.push_back(yolov8_bbox);
-    }
-    sort(yolov8_bboxes.begin(), yolov8_bboxes.end(), yolov8_det_comparator);
-    int updated_size = yolov8_bboxes.size();
-    for(int k = 0; k < updated_size; k++)
-    {
-        if(yolov8_bboxes[k].confidence < modelScoreThreshold)
-        {
-            continue;
-        }
-        
-        nms_result.push_back(yolov8_bboxes[k].index);
-        for(int j = k + 1; j < updated_size; j++)
-        {
-            float iou = box_iou(yolov8_bboxes[k].bbox, yolov8_bboxes[j].bbox);
-            // float iou = box_diou(yolov8_bboxes[k].bbox, yolov8_bboxes[j].bbox);
-            if(iou > modelNMSThreshold)
-            {
-                yolov8_bboxes.erase(yolov8_bboxes.begin() + j);
-                updated_size = yolov8_bboxes.size();
-                j = j -1;
-            }
-        }
-
-    }
-}
-
 static void softmax(float *input, size_t input_len) {
   assert(input);
   // assert(input_len >= 0);  Not needed
@@ -582,10 +539,10 @@ static void yolov8_pose_post_processing(tflite::MicroInterpreter* static_interpr
 	// // start postprocessing
 
 
-	std::vector<int> class_ids;
-	std::vector<float> confidences;
-	std::vector<box> boxes;
-	std::vector< struct_human_pose_17> kpts_vector;
+	// keypoints are only decoded for the anchors that survive NMS
+	static hx_nms_boxes candidates;
+	static uint16_t candidate_anchor[HX_NMS_MAX_BOXES];
+	hx_nms_reset(&candidates);
 
 	for(int dims_cnt_1=0;dims_cnt_1<dim_total_size;dims_cnt_1++)
 	{
@@ -615,43 +572,38 @@ static void yolov8_pose_post_processing(tflite::MicroInterpreter* static_interpr
 			box bbox;
 	
 			yolov8_pose_cal_xywh(dims_cnt_1, output, &bbox, anchor_756_2, stride_756_1,out_dim_size );
-			boxes.push_back(bbox);
-			confidences.push_back(maxScore);
-			
-			// printf("idx: %d,bbox.x: %f, bbox.y: %f, bbox.w: %f , bbox.h: %f\r\n",dims_cnt_2,bbox.x,bbox.y,bbox.w,bbox.h);
-			struct_human_pose_17 kpts;
-			for(int k = 0 ; k < 17 ; k++)
-			{
-				kpts.hpr[k].x = yolov8_pose_key_pts_dequant_value(dims_cnt_1,k*3 , output[3],anchor_756_2[dims_cnt_1][0],anchor_756_2[dims_cnt_1][1],stride_756_1[dims_cnt_1]);
-				kpts.hpr[k].y = yolov8_pose_key_pts_dequant_value(dims_cnt_1,k*3+1 , output[3],anchor_756_2[dims_cnt_1][0],anchor_756_2[dims_cnt_1][1],stride_756_1[dims_cnt_1]);
-				kpts.hpr[k].score = yolov8_pose_key_pts_dequant_value(dims_cnt_1,k*3+2 , output[3],anchor_756_2[dims_cnt_1][0],anchor_756_2[dims_cnt_1][1],stride_756_1[dims_cnt_1]);
-				// printf("idx: %d,kpts[%d] x: %d, y: %d, score: %f\r\n",dims_cnt_2,k,kpts.hpr[k].x,kpts.hpr[k].y,kpts.hpr[k].score);
-			}
-			kpts_vector.push_back(kpts);
-			// printf("\r\n");
+			int slot = hx_nms_add(&candidates, bbox.x, bbox.y, bbox.w, bbox.h, maxScore, 0);
+			if (slot >= 0)
+				candidate_anchor[slot] = dims_cnt_1;
 		}
 	}
 	#if DBG_APP_LOG
-		printf("boxes.size(): %d\r\n",boxes.size());
+		printf("boxes.size(): %d\r\n",candidates.count);
 	#endif
 
 	/**
 	 * do nms
 	 * **/
 
-	std::vector<int> nms_result;
-	yolov8_NMSBoxes(boxes, confidences, modelScoreThreshold, modelNMSThreshold, nms_result);
-	std::vector<detection_yolov8_pose> results_yolov8_pose;
-	for (int i = 0; i < nms_result.size(); i++)
+	uint16_t nms_result[MAX_TRACKED_YOLOV8_ALGO_RES];
+	int nms_count = hx_nms_run(&candidates, modelNMSThreshold, HX_NMS_CLASS_AGNOSTIC, 0, MAX_TRACKED_YOLOV8_ALGO_RES, nms_result);
+	for (int i = 0; i < nms_count; i++)
 	{
-		if(!(MAX_TRACKED_YOLOV8_ALGO_RES-i))break;
 		int idx = nms_result[i];
+		int anchor = candidate_anchor[idx];
+		struct_human_pose_17 kpts;
+		for(int k = 0 ; k < 17 ; k++)
+		{
+			kpts.hpr[k].x = yolov8_pose_key_pts_dequant_value(anchor,k*3 , output[3],anchor_756_2[anchor][0],anchor_756_2[anchor][1],stride_756_1[anchor]);
+			kpts.hpr[k].y = yolov8_pose_key_pts_dequant_value(anchor,k*3+1 , output[3],anchor_756_2[anchor][0],anchor_756_2[anchor][1],stride_756_1[anchor]);
+			kpts.hpr[k].score = yolov8_pose_key_pts_dequant_value(anchor,k*3+2 , output[3],anchor_756_2[anchor][0],anchor_756_2[anchor][1],stride_756_1[anchor]);
+		}
 
-		alg->dypr[i].bbox.x = (uint32_t)boxes[idx].x;
+		alg->dypr[i].bbox.x = (uint32_t)candidates.x[idx];
 
-		alg->dypr[i].bbox.y = (uint32_t)boxes[idx].y;
-		alg->dypr[i].bbox.width = (uint32_t)boxes[idx].w;
-		alg->dypr[i].bbox.height = (uint32_t)boxes[idx].h;
+		alg->dypr[i].bbox.y = (uint32_t)candidates.y[idx];
+		alg->dypr[i].bbox.width = (uint32_t)candidates.w[idx];
+		alg->dypr[i].bbox.height = (uint32_t)candidates.h[idx];
 
 		if(alg->dypr[i].bbox.x >= YOLOV8_POSE_INPUT_TENSOR_WIDTH)alg->dypr[i].bbox.x = YOLOV8_POSE_INPUT_TENSOR_WIDTH;
 		if(alg->dypr[i].bbox.y >= YOLOV8_POSE_INPUT_TENSOR_HEIGHT)alg->dypr[i].bbox.y = YOLOV8_POSE_INPUT_TENSOR_HEIGHT;
@@ -666,16 +618,16 @@ static void yolov8_pose_post_processing(tflite::MicroInterpreter* static_interpr
 		alg->dypr[i].bbox.height = (float)alg->dypr[i].bbox.height / (float)YOLOV8_POSE_INPUT_TENSOR_HEIGHT * (float)img_h;
 
 
-		alg->dypr[i].confidence = confidences[idx];
+		alg->dypr[i].confidence = candidates.score[idx];
 
 		el_keypoint_t temp_el_keypoint;
 		for(int k = 0 ; k < KEYPOINT_NUM ; k++)
 		{
-			alg->dypr[i].hpr[k].x = kpts_vector[idx].hpr[k].x;
-			alg->dypr[i].hpr[k].y = kpts_vector[idx].hpr[k].y;
-			alg->dypr[i].hpr[k].score = kpts_vector[idx].hpr[k].score;
+			alg->dypr[i].hpr[k].x = kpts.hpr[k].x;
+			alg->dypr[i].hpr[k].y = kpts.hpr[k].y;
+			alg->dypr[i].hpr[k].score = kpts.hpr[k].score;
 			#if DBG_APP_LOG
-				printf("idx: %d,kpts[%d] x: %d, y: %d, score: %f\r\n",idx,k,kpts_vector[idx].hpr[k].x,kpts_vector[idx].hpr[k].y,kpts_vector[idx].hpr[k].score);
+				printf("idx: %d,kpts[%d] x: %d, y: %d, score: %f\r\n",idx,k,kpts.hpr[k].x,kpts.hpr[k].y,kpts.hpr[k].score);
 			#endif
 			////resize to original image size
 			if(alg->dypr[i].hpr[k].x >= YOLOV8_POSE_INPUT_TENSOR_WIDTH)alg->dypr[i].hpr[k].x = YOLOV8_POSE_INPUT_TENSOR_WIDTH;
@@ -714,8 +666,6 @@ static void yolov8_pose_post_processing(tflite::MicroInterpreter* static_interpr
 
 int cv_yolov8_pose_run(struct_yolov8_pose_algoResult *algoresult_yolov8_pose) {
 	int ercode = 0;
-    float w_scale;
-    float h_scale;
     uint32_t img_w = app_get_raw_width();
     uint32_t img_h = app_get_raw_height();
     uint32_t ch = app_get_raw_channels();
@@ -733,33 +683,22 @@ int cv_yolov8_pose_run(struct_yolov8_pose_algoResult *algoresult_yolov8_pose) {
 	#endif
 
     if(yolov8_pose_int_ptr!= nullptr) {
-    	//get image from sensor and resize
-		w_scale = (float)(img_w - 1) / (YOLOV8_POSE_INPUT_TENSOR_WIDTH - 1);
-		h_scale = (float)(img_h - 1) / (YOLOV8_POSE_INPUT_TENSOR_HEIGHT - 1);
-
         #if EACH_STEP_TICK
             SystemGetTick(&systick_1, &loop_cnt_1);
         #endif
-		hx_lib_image_resize_BGR8U3C_to_RGB24_helium((uint8_t*)raw_addr, (uint8_t*)yolov8_pose_input->data.data,  
-		                    img_w, img_h, ch, 
-                        	YOLOV8_POSE_INPUT_TENSOR_WIDTH, YOLOV8_POSE_INPUT_TENSOR_HEIGHT, w_scale,h_scale);
-		#if EACH_STEP_TICK						
+    	//get image from sensor, resize, reorder to RGB24 and shift to int8 in one pass
+		if(yolov8_pose_preproc.in_w != (int)img_w || yolov8_pose_preproc.in_h != (int)img_h) {
+			if(hx_img_preproc_init(&yolov8_pose_preproc, HX_IMG_PREPROC_BGR8U3C_TO_RGB24, img_w, img_h,
+					YOLOV8_POSE_INPUT_TENSOR_WIDTH, YOLOV8_POSE_INPUT_TENSOR_HEIGHT, yolov8_pose_preproc_work, sizeof(yolov8_pose_preproc_work)) != 0) {
+				xprintf("preproc init fail for %dx%d\r\n", img_w, img_h);
+				return -1;
+			}
+		}
+		hx_img_preproc_run(&yolov8_pose_preproc, (const uint8_t*)raw_addr, yolov8_pose_input->data.int8);
+		#if EACH_STEP_TICK
             SystemGetTick(&systick_2, &loop_cnt_2);
-            xprintf("Tick for resize image BGR8U3C_to_RGB24_helium for yolov8 POSE:[%d]\r\n",(loop_cnt_2-loop_cnt_1)*CPU_CLK+(systick_1-systick_2));							
+            xprintf("Tick for resize + RGB24 + int8 preprocessing for yolov8 POSE:[%d]\r\n",(loop_cnt_2-loop_cnt_1)*CPU_CLK+(systick_1-systick_2));
 		#endif
-        #if EACH_STEP_TICK
-            SystemGetTick(&systick_1, &loop_cnt_1);
-        #endif
-        
-        // //uint8 to int8
-		for (int i = 0; i < yolov8_pose_input->bytes; ++i) {
-			*((int8_t *)yolov8_pose_input->data.data+i) = *((int8_t *)yolov8_pose_input->data.data+i) - 128;
-    	}
-
-        #if EACH_STEP_TICK
-            SystemGetTick(&systick_2, &loop_cnt_2);
-            xprintf("Tick for Invoke for uint8toint8 for YOLOV8_POSE:[%d]\r\n\n",(loop_cnt_2-loop_cnt_1)*CPU_CLK+(systick_1-systick_2));    
-        #endif	
 
 
         #if EACH_STEP_TICK
@@ -813,7 +752,7 @@ uint32_t judge_case_data;
 uint32_t g_trans_type;
 hx_drv_swreg_aon_get_appused1(&judge_case_data);
 g_trans_type = (judge_case_data>>16);
-if( g_trans_type == 0 || g_trans_type == 2)// transfer type is (UART) or (UART & SPI) 
+if( g_trans_type == 0 || g_trans_type == 2 || g_trans_type == 3)// transfer type is (UART), (UART & SPI) or (UART binary)
 {	
 	//invalid dcache to let uart can send the right jpeg img out
 	hx_InvalidateDCache_by_Addr((volatile void *)app_get_jpeg_addr(), sizeof(uint8_t) *app_get_jpeg_sz());
@@ -826,9 +765,32 @@ if( g_trans_type == 0 || g_trans_type == 2)// transfer type is (UART) or (UART &
 	temp_el_jpg_img.format = EL_PIXEL_FORMAT_JPEG;
 	temp_el_jpg_img.rotate = EL_PIXEL_ROTATE_0;
 
-	 send_device_id();
-	// event_reply(concat_strings(", ", keypoint_results_2_json_str(el_keypoint_algo), ", ", img_2_json_str(&temp_el_jpg_img)));
-	event_reply(concat_strings(", ", algo_tick_2_json_str(algoresult_yolov8_pose->algo_tick),", ", keypoint_results_2_json_str(el_keypoint_algo), ", ", img_2_json_str(&temp_el_jpg_img)));
+	static char send_stream_buffer[SEND_STREAM_BUFFER_SIZE];
+	hx_json_stream send_stream;
+	send_stream_init(&send_stream, send_stream_buffer, sizeof(send_stream_buffer));
+	if( g_trans_type == 3)// binary frame, see send_result.h
+	{
+		el_bin_frame_t bin_frame;
+		bin_reply_begin(&bin_frame, &send_stream, algo_tick_2_bin_size() + keypoint_results_2_bin_size(el_keypoint_algo) + img_2_bin_size(&temp_el_jpg_img));
+		algo_tick_2_bin(&bin_frame, algoresult_yolov8_pose->algo_tick);
+		keypoint_results_2_bin(&bin_frame, el_keypoint_algo);
+		img_2_bin(&bin_frame, &temp_el_jpg_img);
+		bin_reply_end(&bin_frame);
+	}
+	else
+	{
+		send_device_id();
+		// event_reply(concat_strings(", ", keypoint_results_2_json_str(el_keypoint_algo), ", ", img_2_json_str(&temp_el_jpg_img)));
+		// event_reply(concat_strings(", ", algo_tick_2_json_str(algoresult_yolov8_pose->algo_tick),", ", keypoint_results_2_json_str(el_keypoint_algo), ", ", img_2_json_str(&temp_el_jpg_img)));
+		event_reply_begin(&send_stream);
+		hx_json_puts(&send_stream, ", ");
+		algo_tick_2_json_stream(&send_stream, algoresult_yolov8_pose->algo_tick);
+		hx_json_puts(&send_stream, ", ");
+		keypoint_results_2_json_stream(&send_stream, el_keypoint_algo);
+		hx_json_puts(&send_stream, ", ");
+		img_2_json_stream(&send_stream, &temp_el_jpg_img);
+		event_reply_end(&send_stream);
+	}
 }
 	set_model_change_by_uart();
 #endif	
@@ -743,7 +743,7 @@ static void dp_app_cv_yolov8_pose_eventhdl_cb(EVT_INDEX_E event)
 
 				hx_drv_swreg_aon_get_appused1(&judge_case_data);
 				g_trans_type = (judge_case_data>>16);
-				if( g_trans_type == 0 )// transfer type is (UART) 
+				if( g_trans_type == 0 || g_trans_type == 3 )// transfer type is (UART) or (UART binary)
 				{
 
 				}
@@ -764,7 +764,7 @@ static void dp_app_cv_yolov8_pose_eventhdl_cb(EVT_INDEX_E event)
 
 	hx_drv_swreg_aon_get_appused1(&judge_case_data);
 	g_trans_type = (judge_case_data>>16);
-	if( g_trans_type == 0 )// transfer type is (UART) 
+	if( g_trans_type == 0 || g_trans_type == 3 )// transfer type is (UART) or (UART binary)
 	{
 		cv_yolov8_pose_run(&algoresult_yolov8_pose);
 	}
@@ -861,7 +861,7 @@ void app_start_state(APP_STATE_E state)
 
 	hx_drv_swreg_aon_get_appused1(&judge_case_data);
 	g_trans_type = (judge_case_data>>16);
-	if( g_trans_type == 0 || g_trans_type == 2)// transfer type is (UART) or (UART & SPI) 
+	if( g_trans_type == 0 || g_trans_type == 2 || g_trans_type == 3)// transfer type is (UART), (UART & SPI) or (UART binary)
 	{
 		if(state == APP_STATE_YOLOV8_POSE)
 		{
@@ -93,24 +93,36 @@ typedef struct {
 static volatile SPIx_Resources SPI0_Resources;
 static volatile bool spi0_done;
 
+/* Completion callbacks run in the SPI/DMA interrupt; the event lets a caller
+ * of Send/Receive/Transfer sleep instead of polling GetStatus() */
+static void ARM_SPIx_SignalEvent(volatile SPIx_Resources* spi, uint32_t event)
+{
+    if (spi->cb_event)
+        spi->cb_event(event);
+}
+
 static void callback_spi0_tx(void)
 {
     spi0_done = 1;
+    ARM_SPIx_SignalEvent(&SPI0_Resources, ARM_SPI_EVENT_TRANSFER_COMPLETE);
 }
 
 static void callback_spi0_rx(void)
 {
     spi0_done = 1;
+    ARM_SPIx_SignalEvent(&SPI0_Resources, ARM_SPI_EVENT_TRANSFER_COMPLETE);
 }
 
 static void callback_spi0_xfer(void)
 {
     spi0_done = 1;
+    ARM_SPIx_SignalEvent(&SPI0_Resources, ARM_SPI_EVENT_TRANSFER_COMPLETE);
 }
 
 static void callback_spi0_error(void)
 {
     SPI0_Resources.status.data_lost = 1;
+    ARM_SPIx_SignalEvent(&SPI0_Resources, ARM_SPI_EVENT_DATA_LOST);
 }
 
 static int32_t ARM_SPIx_Initialize(SPIx_Resources *spi, ARM_SPI_SignalEvent_t cb_event)
@@ -282,14 +294,6 @@ static int32_t ARM_SPIx_Control(SPIx_Resources *spi, uint32_t control, uint32_t
     return ARM_DRIVER_OK;
 }
 
-//static void ARM_SPIx_SignalEvent(const SPIx_Resources* spi, uint32_t event)
-//{
-//    if (spi->cb_event)
-//        spi->cb_event(event);
-//
-//    return;
-//}
-
 static int32_t ARM_SPIx_Send(SPIx_Resources* spi, const void* data, uint32_t num)
 {
     if(data == NULL || num == 0)
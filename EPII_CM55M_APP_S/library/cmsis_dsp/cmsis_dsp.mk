@@ -27,7 +27,7 @@ LIB_CMSIS_DSP_CSRC_SUBDIR += $(LIB_CMSIS_DSP_DIR)/Source/BasicMathFunctions \
 							 $(LIB_CMSIS_DSP_DIR)/Source/CommonTables_Used \
 							 $(LIB_CMSIS_DSP_DIR)/Source/TransformFunctions_Used \
 							 $(LIB_CMSIS_DSP_DIR)/Source/SupportFunctions \
-							 #$(LIB_CMSIS_DSP_DIR)/Source/FilteringFunctions_Used \
+							 $(LIB_CMSIS_DSP_DIR)/Source/FilteringFunctions_Used \
 						 	 #$(LIB_CMSIS_DSP_DIR)/Source/BasicMathFunctions \
 							 #$(LIB_CMSIS_DSP_DIR)/Source/MatrixFunctions \
 					 	 	 #$(LIB_CMSIS_DSP_DIR)/Source/FilteringFunctions \
@@ -103,4 +103,4 @@ LIB_ALLOBJS += $(LIB_CMSIS_DSP_OBJS)
 
 LIB_DEFINES += $(LIB_CMSIS_DSP_DEFINES)
 LIB_DEPS += $(LIB_CMSIS_DSP_DEPS)
-LIB_LIBS += $(LIB_CMSIS_DSP)
\ No newline at end of file
+LIB_LIBS += $(LIB_CMSIS_DSP)
\ No newline at end of file
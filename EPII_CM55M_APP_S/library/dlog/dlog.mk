@@ -0,0 +1,66 @@
+# directory declaration
+LIB_DLOG_DIR = $(LIBRARIES_ROOT)/dlog
+
+LIB_DLOG_ASMSRCDIR	= $(LIB_DLOG_DIR)
+LIB_DLOG_CSRCDIR	= $(LIB_DLOG_DIR)
+LIB_DLOG_CXXSRCSDIR    = $(LIB_DLOG_DIR)
+# hx_ring.h, header only
+LIB_DLOG_INCDIR	= $(LIB_DLOG_DIR) $(LIBRARIES_ROOT)/ring
+
+# find all the source files in the target directories
+LIB_DLOG_CSRCS = $(call get_csrcs, $(LIB_DLOG_CSRCDIR))
+LIB_DLOG_CXXSRCS = $(call get_cxxsrcs, $(LIB_DLOG_CXXSRCSDIR))
+LIB_DLOG_ASMSRCS = $(call get_asmsrcs, $(LIB_DLOG_ASMSRCDIR))
+
+# get object files
+LIB_DLOG_COBJS = $(call get_relobjs, $(LIB_DLOG_CSRCS))
+LIB_DLOG_CXXOBJS = $(call get_relobjs, $(LIB_DLOG_CXXSRCS))
+LIB_DLOG_ASMOBJS = $(call get_relobjs, $(LIB_DLOG_ASMSRCS))
+LIB_DLOG_OBJS = $(LIB_DLOG_COBJS) $(LIB_DLOG_ASMOBJS) $(LIB_DLOG_CXXOBJS)
+
+# get dependency files
+LIB_DLOG_DEPS = $(call get_deps, $(LIB_DLOG_OBJS))
+
+# extra macros to be defined
+LIB_DLOG_DEFINES = -DLIB_DLOG
+
+# genearte library
+ifeq ($(DLOG_LIB_FORCE_PREBUILT), y)
+override LIB_DLOG_OBJS:=
+endif
+DLOG_LIB_NAME = lib_dlog.a
+LIB_LIB_DLOG := $(subst /,$(PS), $(strip $(OUT_DIR)/$(DLOG_LIB_NAME)))
+
+# library generation rule
+$(LIB_LIB_DLOG): $(LIB_DLOG_OBJS)
+	$(TRACE_ARCHIVE)
+ifeq "$(strip $(LIB_DLOG_OBJS))" ""
+	$(CP) $(PREBUILT_LIB)$(DLOG_LIB_NAME) $(LIB_LIB_DLOG)
+else
+	$(Q)$(AR) $(AR_OPT) $@ $(LIB_DLOG_OBJS)
+	$(CP) $(LIB_LIB_DLOG) $(PREBUILT_LIB)$(DLOG_LIB_NAME)
+endif
+
+# specific compile rules
+# user can add rules to compile this middleware
+# if not rules specified to this middleware, it will use default compiling rules
+
+# Middleware Definitions
+LIB_INCDIR += $(LIB_DLOG_INCDIR)
+LIB_CSRCDIR += $(LIB_DLOG_CSRCDIR)
+LIB_CXXSRCDIR += $(LIB_DLOG_CXXSRCDIR)
+LIB_ASMSRCDIR += $(LIB_DLOG_ASMSRCDIR)
+
+LIB_CSRCS += $(LIB_DLOG_CSRCS)
+LIB_CXXSRCS += $(LIB_DLOG_CXXSRCS)
+LIB_ASMSRCS += $(LIB_DLOG_ASMSRCS)
+LIB_ALLSRCS += $(LIB_DLOG_CSRCS) $(LIB_DLOG_ASMSRCS)
+
+LIB_COBJS += $(LIB_DLOG_COBJS)
+LIB_CXXOBJS += $(LIB_DLOG_CXXOBJS)
+LIB_ASMOBJS += $(LIB_DLOG_ASMOBJS)
+LIB_ALLOBJS += $(LIB_DLOG_OBJS)
+
+LIB_DEFINES += $(LIB_DLOG_DEFINES)
+LIB_DEPS += $(LIB_DLOG_DEPS)
+LIB_LIBS += $(LIB_LIB_DLOG)
\ No newline at end of file
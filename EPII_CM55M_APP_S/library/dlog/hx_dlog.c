@@ -0,0 +1,543 @@
+/*
+ * hx_dlog.c
+ *
+ * See hx_dlog.h. One log for the whole image, like the xprintf console.
+ * The formatter is the one of xprintf (library/common/xprintf.c), reading
+ * the argument words of a record instead of a va_list.
+ */
+#include <stdarg.h>
+#include <string.h>
+#include "hx_dlog.h"
+
+#define REC_HDR(type, level, words) \
+    ((HX_DLOG_MAGIC << 24) | ((uint32_t)(type) << 20) | ((uint32_t)((level) & 0xF) << 16) | (words))
+#define REC_TYPE(hdr)   (((hdr) >> 20) & 0xF)
+#define REC_WORDS(hdr)  ((hdr) & 0xFFFF)
+
+/* a UART DMA transfer without linked lists, 4095 bytes on the WE2 */
+#define TX_CHUNK_MAX    4095
+
+/* a TEXT record of a full line may be longer than HX_DLOG_REC_WORDS */
+#define TEXT_WORDS      (3 + (HX_DLOG_LINE_MAX + 3) / 4)
+#define REC_MAX_WORDS   (HX_DLOG_REC_WORDS > TEXT_WORDS ? HX_DLOG_REC_WORDS : TEXT_WORDS)
+#define OUT_MAX         (HX_DLOG_LINE_MAX > REC_MAX_WORDS * 4 ? HX_DLOG_LINE_MAX : REC_MAX_WORDS * 4)
+
+static uint32_t dlog_buf[HX_DLOG_RING_WORDS] HX_RING_ALIGNED;
+static uint8_t dlog_tx_buf[HX_DLOG_TX_BYTES] HX_RING_ALIGNED;
+static hx_ring dlog_ring;
+static hx_ring dlog_tx;
+static const hx_dlog_port *dlog_port;
+static hx_dlog_mode dlog_mode;
+static uint8_t dlog_sync;               /* write() only, after hx_dlog_panic() */
+static volatile uint8_t dlog_tx_busy;
+static volatile uint32_t dlog_tx_len;
+static uint32_t dlog_drop_reported;
+static hx_dlog_stats dlog_stats;
+
+/* plain console output, a line at a time */
+static char dlog_line[HX_DLOG_LINE_MAX];
+static uint32_t dlog_line_len;
+
+/* bytes of one record waiting for room in the TX ring */
+static uint8_t dlog_out[OUT_MAX];
+static uint32_t dlog_out_len;
+static uint32_t dlog_out_pos;
+
+/*---------------------------------------------------------------------------*/
+/* Producer */
+
+static void store(const uint32_t *rec, uint32_t words)
+{
+    const hx_dlog_port *port = dlog_port;
+    uint32_t state, used;
+
+    if (port == NULL)
+        return;
+    state = port->irq_save();
+    if (hx_ring_space(&dlog_ring) >= words)
+    {
+        hx_ring_write(&dlog_ring, rec, words);
+        dlog_stats.records++;
+        used = hx_ring_count(&dlog_ring);
+        if (used > dlog_stats.max_used)
+            dlog_stats.max_used = used;
+    }
+    else
+    {
+        dlog_stats.dropped++;
+    }
+    port->irq_restore(state);
+}
+
+/* n bytes from s as a byte count and padded words at rec[*pos] */
+static void put_bytes(uint32_t *rec, uint32_t *pos, const char *s, uint32_t n)
+{
+    uint32_t words = (n + 3) / 4;
+
+    rec[(*pos)++] = n;
+    if (words)
+        rec[*pos + words - 1] = 0;
+    memcpy(&rec[*pos], s, n);
+    *pos += words;
+}
+
+void hx_dlog_printf(int level, const char *fmt, ...)
+{
+    uint32_t rec[HX_DLOG_REC_WORDS];
+    uint32_t n = 1, room, len;
+    const char *f = fmt, *s;
+    uintptr_t ptr = (uintptr_t)fmt;
+    va_list ap;
+    char c, d;
+    int lng;
+
+    if (dlog_port == NULL)
+        return;
+    memcpy(&rec[n], &ptr, sizeof(ptr));
+    n += HX_DLOG_PTR_WORDS;
+    rec[n++] = dlog_port->now_us();
+
+    /* the argument walk of xvprintf() */
+    va_start(ap, fmt);
+    for (;;)
+    {
+        c = *f++;
+        if (!c)
+            break;
+        if (c != '%')
+            continue;
+        c = *f++;
+        if (c == '0' || c == '-')
+            c = *f++;
+        while (c >= '0' && c <= '9')
+            c = *f++;
+        lng = 0;
+        if (c == 'l' || c == 'L')
+        {
+            lng = 1;
+            c = *f++;
+        }
+        if (!c)
+            break;
+        d = c >= 'a' ? c - 0x20 : c;
+        if (n >= HX_DLOG_REC_WORDS)
+        {
+            /* no room for the rest, the drain prints what is there */
+            break;
+        }
+        switch (d)
+        {
+        case 'S':
+            s = va_arg(ap, const char *);
+            room = (HX_DLOG_REC_WORDS - n - 1) * 4;
+            for (len = 0; s[len] && len < room; len++)
+                ;
+            put_bytes(rec, &n, s, len);
+            break;
+        case 'C':
+            rec[n++] = (uint32_t)va_arg(ap, int);
+            break;
+        case 'B':
+        case 'O':
+        case 'D':
+        case 'U':
+        case 'X':
+            rec[n++] = lng ? (uint32_t)va_arg(ap, long) : (uint32_t)va_arg(ap, int);
+            break;
+        default:
+            /* passed through, no argument */
+            break;
+        }
+    }
+    va_end(ap);
+
+    rec[0] = REC_HDR(HX_DLOG_FMT, level, n);
+    store(rec, n);
+}
+
+static void store_text(const char *s, uint32_t len)
+{
+    uint32_t rec[TEXT_WORDS];
+    uint32_t n = 1;
+
+    rec[n++] = dlog_port->now_us();
+    put_bytes(rec, &n, s, len);
+    rec[0] = REC_HDR(HX_DLOG_TEXT_REC, 0, n);
+    store(rec, n);
+}
+
+void hx_dlog_putc(unsigned char c)
+{
+    if (dlog_port == NULL)
+        return;
+    dlog_line[dlog_line_len++] = (char)c;
+    if (c == '\n' || dlog_line_len == HX_DLOG_LINE_MAX)
+    {
+        store_text(dlog_line, dlog_line_len);
+        dlog_line_len = 0;
+    }
+}
+
+/*---------------------------------------------------------------------------*/
+/* Formatter */
+
+typedef struct out_buf {
+    uint8_t *p;
+    uint32_t len;
+    uint32_t max;
+} out_buf;
+
+static void out_raw(out_buf *o, char c)
+{
+    if (o->len < o->max)
+        o->p[o->len++] = (uint8_t)c;
+}
+
+/* xputc() with _CR_CRLF */
+static void out_c(out_buf *o, char c)
+{
+    if (c == '\n')
+        out_raw(o, '\r');
+    out_raw(o, c);
+}
+
+static void out_s(out_buf *o, const char *s, uint32_t n)
+{
+    while (n--)
+        out_c(o, *s++);
+}
+
+/* xvprintf() on the argument words a[0..na) */
+static void format(out_buf *o, const char *fmt, const uint32_t *a, uint32_t na)
+{
+    unsigned int r, i, j, w, f;
+    uint32_t v, k = 0, slen;
+    const char *sp;
+    char s[16], c, d;
+
+    for (;;)
+    {
+        c = *fmt++;
+        if (!c)
+            break;
+        if (c != '%')
+        {
+            out_c(o, c);
+            continue;
+        }
+        f = 0;
+        c = *fmt++;
+        if (c == '0')
+        {
+            f = 1;
+            c = *fmt++;
+        }
+        else if (c == '-')
+        {
+            f = 2;
+            c = *fmt++;
+        }
+        for (w = 0; c >= '0' && c <= '9'; c = *fmt++)
+            w = w * 10 + c - '0';
+        if (c == 'l' || c == 'L')
+        {
+            f |= 4;
+            c = *fmt++;
+        }
+        if (!c)
+            break;
+        d = c;
+        if (d >= 'a')
+            d -= 0x20;
+        switch (d)
+        {
+        case 'S':
+            if (k >= na)
+                return;
+            slen = a[k++];
+            if ((slen + 3) / 4 > na - k)
+                return;
+            sp = (const char *)&a[k];
+            k += (slen + 3) / 4;
+            j = slen;
+            while (!(f & 2) && j++ < w)
+                out_c(o, ' ');
+            out_s(o, sp, slen);
+            while (j++ < w)
+                out_c(o, ' ');
+            continue;
+        case 'C':
+            if (k >= na)
+                return;
+            out_c(o, (char)a[k++]);
+            continue;
+        case 'B':
+            r = 2;
+            break;
+        case 'O':
+            r = 8;
+            break;
+        case 'D':
+        case 'U':
+            r = 10;
+            break;
+        case 'X':
+            r = 16;
+            break;
+        default:
+            out_c(o, c);
+            continue;
+        }
+
+        if (k >= na)
+            return;
+        v = a[k++];
+        if (d == 'D' && (v & 0x80000000))
+        {
+            v = 0 - v;
+            f |= 8;
+        }
+        i = 0;
+        do
+        {
+            d = (char)(v % r);
+            v /= r;
+            if (d > 9)
+                d += (c == 'x') ? 0x27 : 0x07;
+            s[i++] = d + '0';
+        } while (v && i < sizeof(s));
+        if ((f & 8) && (i < sizeof(s)))
+            s[i++] = '-';
+        j = i;
+        d = (f & 1) ? '0' : ' ';
+        while (!(f & 2) && j++ < w)
+            out_c(o, d);
+        do
+            out_c(o, s[--i]);
+        while (i);
+        while (j++ < w)
+            out_c(o, ' ');
+    }
+}
+
+/* the bytes of one record into dlog_out */
+static void render(const uint32_t *rec, uint32_t words)
+{
+    out_buf o = { dlog_out, 0, sizeof(dlog_out) };
+    const char *fmt;
+    uintptr_t ptr;
+    uint32_t hdr = rec[0];
+
+    if (dlog_mode == HX_DLOG_BINARY)
+    {
+        memcpy(dlog_out, rec, words * 4);
+        dlog_out_len = words * 4;
+        dlog_out_pos = 0;
+        return;
+    }
+    switch (REC_TYPE(hdr))
+    {
+    case HX_DLOG_FMT:
+        memcpy(&ptr, &rec[1], sizeof(ptr));
+        fmt = (const char *)ptr;
+        format(&o, fmt, &rec[2 + HX_DLOG_PTR_WORDS], words - 2 - HX_DLOG_PTR_WORDS);
+        break;
+    case HX_DLOG_TEXT_REC:
+        /* already through xputc() */
+        if (rec[2] <= (words - 3) * 4)
+        {
+            memcpy(dlog_out, &rec[3], rec[2] < o.max ? rec[2] : o.max);
+            o.len = rec[2] < o.max ? rec[2] : o.max;
+        }
+        break;
+    case HX_DLOG_DROP:
+        format(&o, "[dlog: %u records dropped]\n", &rec[2], 1);
+        break;
+    default:
+        break;
+    }
+    dlog_out_len = o.len;
+    dlog_out_pos = 0;
+}
+
+/*---------------------------------------------------------------------------*/
+/* Consumer */
+
+static void tx_start(void);
+
+static void tx_done(void)
+{
+    hx_ring_release(&dlog_tx, dlog_tx_len);
+    dlog_stats.bytes_out += dlog_tx_len;
+    dlog_tx_busy = 0;
+    tx_start();
+}
+
+/* interrupts masked, or from tx_done() */
+static void tx_start(void)
+{
+    uint8_t *p;
+    uint32_t n;
+
+    if (dlog_tx_busy || dlog_sync || dlog_port->write_async == NULL)
+        return;
+    p = (uint8_t *)hx_ring_peek(&dlog_tx, &n);
+    if (p == NULL)
+        return;
+    if (n > TX_CHUNK_MAX)
+        n = TX_CHUNK_MAX;
+    dlog_tx_len = n;
+    dlog_tx_busy = 1;
+    if (dlog_port->write_async(p, n, tx_done) != 0)
+        dlog_tx_busy = 0;
+}
+
+static void tx_kick(void)
+{
+    uint32_t state = dlog_port->irq_save();
+
+    tx_start();
+    dlog_port->irq_restore(state);
+}
+
+static int tx_sync(void)
+{
+    uint8_t *p;
+    uint32_t n;
+
+    if (!dlog_sync && dlog_port->write_async != NULL)
+        return 0;
+    while ((p = (uint8_t *)hx_ring_peek(&dlog_tx, &n)) != NULL)
+    {
+        dlog_port->write(p, n);
+        hx_ring_release(&dlog_tx, n);
+        dlog_stats.bytes_out += n;
+    }
+    return 1;
+}
+
+static int pop(uint32_t *rec, uint32_t *words)
+{
+    uint32_t n;
+
+    if (hx_ring_read(&dlog_ring, rec, 1) != 1)
+        return 0;
+    n = REC_WORDS(rec[0]);
+    if (n < 1 || n > REC_MAX_WORDS)
+        n = 1;
+    hx_ring_read(&dlog_ring, &rec[1], n - 1);
+    *words = n;
+    return 1;
+}
+
+uint32_t hx_dlog_drain(void)
+{
+    uint32_t rec[REC_MAX_WORDS];
+    uint32_t words, n, dropped;
+
+    if (dlog_port == NULL)
+        return 0;
+    for (;;)
+    {
+        if (dlog_out_pos < dlog_out_len)
+        {
+            n = hx_ring_space(&dlog_tx);
+            if (n > dlog_out_len - dlog_out_pos)
+                n = dlog_out_len - dlog_out_pos;
+            hx_ring_write(&dlog_tx, dlog_out + dlog_out_pos, n);
+            dlog_out_pos += n;
+            if (dlog_out_pos < dlog_out_len)
+            {
+                /* TX ring full: wait for the DMA, or write it out */
+                if (!tx_sync())
+                    break;
+                continue;
+            }
+        }
+
+        dropped = dlog_stats.dropped;
+        if (dropped != dlog_drop_reported)
+        {
+            rec[0] = REC_HDR(HX_DLOG_DROP, 0, 3);
+            rec[1] = dlog_port->now_us();
+            rec[2] = dropped - dlog_drop_reported;
+            dlog_drop_reported = dropped;
+            render(rec, 3);
+            continue;
+        }
+        if (!pop(rec, &words))
+            break;
+        render(rec, words);
+    }
+    if (!tx_sync())
+        tx_kick();
+    return hx_ring_count(&dlog_ring);
+}
+
+void hx_dlog_flush(void)
+{
+    if (dlog_port == NULL)
+        return;
+    if (dlog_line_len)
+    {
+        store_text(dlog_line, dlog_line_len);
+        dlog_line_len = 0;
+    }
+    while (hx_dlog_drain() || dlog_out_pos < dlog_out_len || hx_ring_count(&dlog_tx))
+        ;
+}
+
+void hx_dlog_stop(void)
+{
+    if (dlog_port == NULL)
+        return;
+    hx_dlog_flush();
+    dlog_port = NULL;
+}
+
+void hx_dlog_panic(void)
+{
+    if (dlog_port == NULL)
+        return;
+    /* a transfer in flight may be sent twice, better than lost */
+    dlog_sync = 1;
+    dlog_tx_busy = 0;
+    hx_dlog_stop();
+}
+
+int hx_dlog_init(hx_dlog_mode mode, const hx_dlog_port *port)
+{
+    uint32_t hello[3];
+
+    if (mode != HX_DLOG_TEXT && mode != HX_DLOG_BINARY)
+        return -1;
+    hx_ring_init(&dlog_ring, dlog_buf, HX_DLOG_RING_WORDS, 4);
+    hx_ring_init(&dlog_tx, dlog_tx_buf, HX_DLOG_TX_BYTES, 1);
+    memset(&dlog_stats, 0, sizeof(dlog_stats));
+    dlog_mode = mode;
+    dlog_sync = 0;
+    dlog_tx_busy = 0;
+    dlog_drop_reported = 0;
+    dlog_line_len = 0;
+    dlog_out_len = 0;
+    dlog_out_pos = 0;
+    dlog_port = port;
+    if (mode == HX_DLOG_BINARY)
+    {
+        hello[0] = REC_HDR(HX_DLOG_HELLO, 0, 3);
+        hello[1] = HX_DLOG_HELLO_ID;
+        hello[2] = HX_DLOG_VERSION | (uint32_t)sizeof(void *) << 8;
+        store(hello, 3);
+    }
+    return 0;
+}
+
+int hx_dlog_active(void)
+{
+    return dlog_port != NULL;
+}
+
+void hx_dlog_get_stats(hx_dlog_stats *stats)
+{
+    *stats = dlog_stats;
+}
@@ -0,0 +1,187 @@
+#ifndef _LIB_HX_DLOG_H_
+#define _LIB_HX_DLOG_H_
+/*
+ * Deferred xprintf logging: a log call stores the format pointer and its
+ * raw arguments as one record in a RAM ring and returns; the text is made
+ * and sent to the UART later, by hx_dlog_drain(), in a gap of the app.
+ *
+ * - Arguments follow xprintf: %d %u %x %X %o %b %c take an int, or a long
+ *   with l; %s is copied into the record, so a buffer on the stack may be
+ *   logged. No floats, as with xprintf.
+ * - The record ring is an hx_ring: lock-free between the log calls and the
+ *   drain. Log calls from ISRs and the main loop mask interrupts for the
+ *   copy of one record. A record that does not fit is dropped and counted,
+ *   the drain prints how many; a log call never waits for the UART.
+ * - HX_DLOG_TEXT: the drain formats the records as xprintf would, \n as
+ *   \r\n included. HX_DLOG_BINARY: the drain sends the records as they are,
+ *   tools/hx_dlog_decode.py formats them on the host with the strings of
+ *   the ELF image; no formatting on the chip, and fewer UART bytes for
+ *   lines with more fixed text than arguments.
+ * - The drain fills a TX byte ring. With write_async in the port (UART
+ *   DMA on the WE2) the UART empties it in the background; without, the
+ *   drain writes it out, so call it where the app would wait anyway.
+ * - HX_DLOG_LEVEL removes the calls above it at compile time.
+ * - hx_dlog_putc() takes the characters of plain xprintf calls into the
+ *   same ring (hx_dlog_we2_capture()), so all console output keeps its
+ *   order and none of it goes to the UART behind the DMA.
+ *
+ * Usage:
+ *   hx_dlog_init(HX_DLOG_TEXT, &hx_dlog_we2_port);
+ *   hx_dlog_we2_capture(1);
+ *   HX_DLOG_INFO("  X file: %s\r\n", path);
+ *   ...
+ *   hx_dlog_drain();                  between samples, in idle time
+ *   hx_dlog_we2_capture(0);
+ *   hx_dlog_stop();                   sends the rest, the UART is free again
+ */
+#include <stdint.h>
+#include "hx_ring.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#define HX_DLOG_LVL_ERR     1
+#define HX_DLOG_LVL_WARN    2
+#define HX_DLOG_LVL_INFO    3
+#define HX_DLOG_LVL_DEBUG   4
+
+/** Log calls above this level are compiled out */
+#ifndef HX_DLOG_LEVEL
+#define HX_DLOG_LEVEL HX_DLOG_LVL_INFO
+#endif
+
+/** Record ring, in 32-bit words, a power of two */
+#ifndef HX_DLOG_RING_WORDS
+#define HX_DLOG_RING_WORDS 2048
+#endif
+
+/** TX ring, in bytes, a power of two */
+#ifndef HX_DLOG_TX_BYTES
+#define HX_DLOG_TX_BYTES 1024
+#endif
+
+/** Longest record in words, longer %s arguments are cut */
+#ifndef HX_DLOG_REC_WORDS
+#define HX_DLOG_REC_WORDS 64
+#endif
+
+/** Longest formatted line, and line of hx_dlog_putc() */
+#ifndef HX_DLOG_LINE_MAX
+#define HX_DLOG_LINE_MAX 256
+#endif
+
+#define HX_DLOG(level, fmt, ...) \
+    do { if ((level) <= HX_DLOG_LEVEL) hx_dlog_printf((level), fmt, ##__VA_ARGS__); } while (0)
+#define HX_DLOG_ERR(fmt, ...)   HX_DLOG(HX_DLOG_LVL_ERR, fmt, ##__VA_ARGS__)
+#define HX_DLOG_WARN(fmt, ...)  HX_DLOG(HX_DLOG_LVL_WARN, fmt, ##__VA_ARGS__)
+#define HX_DLOG_INFO(fmt, ...)  HX_DLOG(HX_DLOG_LVL_INFO, fmt, ##__VA_ARGS__)
+#define HX_DLOG_DEBUG(fmt, ...) HX_DLOG(HX_DLOG_LVL_DEBUG, fmt, ##__VA_ARGS__)
+
+typedef enum hx_dlog_mode {
+    HX_DLOG_TEXT = 1,
+    HX_DLOG_BINARY = 2,
+} hx_dlog_mode;
+
+/*
+ * Records, as stored and as sent in HX_DLOG_BINARY, little endian words:
+ *   word 0   HX_DLOG_MAGIC << 24 | type << 20 | level << 16 | words
+ *   FMT      format pointer (HX_DLOG_PTR_WORDS), time_us, arguments:
+ *            one word per number or char, %s as byte count then the bytes
+ *            padded to a word
+ *   TEXT     time_us, byte count, the bytes padded to a word
+ *   DROP     time_us, records dropped since the last DROP
+ *   HELLO    HX_DLOG_HELLO_ID, version | pointer bytes << 8, sent first
+ */
+#define HX_DLOG_MAGIC       0xA5u
+#define HX_DLOG_FMT         1
+#define HX_DLOG_TEXT_REC    2
+#define HX_DLOG_DROP        3
+#define HX_DLOG_HELLO       4
+#define HX_DLOG_HELLO_ID    0x4C445848u     /* "HXDL" */
+#define HX_DLOG_VERSION     1
+#define HX_DLOG_PTR_WORDS   ((sizeof(void *) + 3) / 4)
+
+/**
+ * Platform of the log, hx_dlog_we2_port on the chip.
+ */
+typedef struct hx_dlog_port {
+    uint32_t (*now_us)(void);
+    /** masks interrupts, returns the previous state for irq_restore */
+    uint32_t (*irq_save)(void);
+    void (*irq_restore)(uint32_t state);
+    /**
+     * Starts sending n bytes and returns 0, done() is called from the ISR
+     * once they are sent. NULL: write() only.
+     */
+    int (*write_async)(const uint8_t *buf, uint32_t n, void (*done)(void));
+    /** Sends n bytes, returns once they are sent */
+    void (*write)(const uint8_t *buf, uint32_t n);
+} hx_dlog_port;
+
+typedef struct hx_dlog_stats {
+    uint32_t records;       /**< stored */
+    uint32_t dropped;       /**< did not fit in the ring */
+    uint32_t bytes_out;     /**< handed to the UART */
+    uint32_t max_used;      /**< record ring high water, words */
+} hx_dlog_stats;
+
+/** The WE2 port: console UART (DW_UART_0) by DMA, PRIMASK, SysTick */
+extern const hx_dlog_port hx_dlog_we2_port;
+
+/**
+ * Sets up the rings, and sends the HELLO record in HX_DLOG_BINARY. Again
+ * after hx_dlog_stop() for a new session.
+ * @return 0, or -1 for an unknown mode
+ */
+int hx_dlog_init(hx_dlog_mode mode, const hx_dlog_port *port);
+
+/** 1 after hx_dlog_init(), until hx_dlog_stop() or hx_dlog_panic() */
+int hx_dlog_active(void);
+
+/** Stores one record, from any context; dropped before hx_dlog_init() */
+void hx_dlog_printf(int level, const char *fmt, ...)
+#if defined(__GNUC__)
+    __attribute__((format(printf, 2, 3)))
+#endif
+    ;
+
+/**
+ * Takes one character of plain console output; a line goes to the ring
+ * as a TEXT record at \n or when HX_DLOG_LINE_MAX long. Main loop only.
+ */
+void hx_dlog_putc(unsigned char c);
+
+/**
+ * Turns records into bytes in the TX ring as long as they fit, and starts
+ * the UART on them. Does not wait for the UART with write_async.
+ * @return records left in the ring
+ */
+uint32_t hx_dlog_drain(void);
+
+/** Drains until every record is sent, waiting for the UART */
+void hx_dlog_flush(void);
+
+/**
+ * Flushes and turns logging off; log calls are dropped until the next
+ * hx_dlog_init(), the UART is free for other use.
+ */
+void hx_dlog_stop(void);
+
+/**
+ * For a fault handler: stops using the DMA and writes out what is left
+ * with write(). Logging is off afterwards.
+ */
+void hx_dlog_panic(void);
+
+void hx_dlog_get_stats(hx_dlog_stats *stats);
+
+/** Plain xprintf output through hx_dlog_putc() (1) or to the console again (0) */
+void hx_dlog_we2_capture(int on);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _LIB_HX_DLOG_H_ */
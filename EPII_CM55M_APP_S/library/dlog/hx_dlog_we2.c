@@ -0,0 +1,88 @@
+/*
+ * hx_dlog_we2.c
+ *
+ * hx_dlog_port of the WE2: the console UART (DW_UART_0, set up by
+ * board_init()) by UART DMA, PRIMASK for the record copy, SysTick time.
+ */
+#include "WE2_device.h"
+#include "WE2_core.h"
+#include "hx_drv_uart.h"
+#include "console_io.h"
+#include "xprintf.h"
+#include "hx_dlog.h"
+
+#define WE2_SYSTICK_PERIOD  (SysTick_LOAD_RELOAD_Msk + 1)
+#define WE2_DCACHE_LINE     32
+
+static void (*we2_done)(void);
+
+static uint32_t we2_now_us(void)
+{
+    uint32_t tick, loop, tick2, loop2, clk;
+    uint64_t ticks;
+
+    do {
+        SystemGetTick(&tick, &loop);
+        SystemGetTick(&tick2, &loop2);
+    } while (loop != loop2 || tick2 > tick);
+
+    EPII_Get_Systemclock(&clk);
+    ticks = (uint64_t)loop * WE2_SYSTICK_PERIOD + (WE2_SYSTICK_PERIOD - 1 - tick);
+    return (uint32_t)(ticks / (clk / 1000000));
+}
+
+static uint32_t we2_irq_save(void)
+{
+    uint32_t primask = __get_PRIMASK();
+
+    __disable_irq();
+    return primask;
+}
+
+static void we2_irq_restore(uint32_t state)
+{
+    __set_PRIMASK(state);
+}
+
+static void we2_tx_cb(void)
+{
+    we2_done();
+}
+
+static int we2_write_async(const uint8_t *buf, uint32_t n, void (*done)(void))
+{
+    DEV_UART_PTR uart = hx_drv_uart_get_dev(USE_DW_UART_0);
+    uintptr_t start = (uintptr_t)buf & ~(uintptr_t)(WE2_DCACHE_LINE - 1);
+    uintptr_t end = ((uintptr_t)buf + n + WE2_DCACHE_LINE - 1) & ~(uintptr_t)(WE2_DCACHE_LINE - 1);
+
+    if (uart == NULL)
+        return -1;
+    /* the DMA reads memory, not the cache */
+    hx_CleanDCache_by_Addr((volatile void *)start, (int32_t)(end - start));
+    we2_done = done;
+    return uart->uart_write_udma(buf, n, (void *)we2_tx_cb) < 0 ? -1 : 0;
+}
+
+static void we2_write(const uint8_t *buf, uint32_t n)
+{
+    DEV_UART_PTR uart = hx_drv_uart_get_dev(USE_DW_UART_0);
+
+    if (uart != NULL)
+        uart->uart_write(buf, n);
+}
+
+void hx_dlog_we2_capture(int on)
+{
+    if (on)
+        xdev_out(hx_dlog_putc);
+    else
+        xdev_out(console_putchar);
+}
+
+const hx_dlog_port hx_dlog_we2_port = {
+    we2_now_us,
+    we2_irq_save,
+    we2_irq_restore,
+    we2_write_async,
+    we2_write,
+};
@@ -0,0 +1,410 @@
+/*
+ * Host unit tests of hx_dlog.
+ *
+ *   hx_dlog_test [binary.log text.log]
+ *
+ * The log runs on a fake port: a clock that moves 7 us per read, a UART
+ * that collects what it is given, and a fake UART DMA that completes when
+ * the test says so, or when interrupts are unmasked with fake_dma_auto.
+ * The reference text comes from xfprintf() of library/common/xprintf.c,
+ * built for the host.
+ *
+ * Checked: text mode output byte for byte against xprintf for the formats
+ * xprintf knows, %s copied at the call, long %s cut, level filtering, drops
+ * counted and reported, the DMA chaining over a full TX ring, plain
+ * xprintf lines in order with the records, hx_dlog_stop(), hx_dlog_panic()
+ * with a DMA that never completes. With the file arguments the same lines
+ * are also logged in binary mode, in two sessions; make check decodes
+ * binary.log with tools/hx_dlog_decode.py and compares it to text.log.
+ */
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include "xprintf.h"
+#include "hx_dlog.h"
+
+static int failures;
+
+#define CHECK(c) do { if (!(c)) { printf("%s:%d: %s\n", __FILE__, __LINE__, #c); failures++; } } while (0)
+
+/*
+ * Fake port
+ */
+#define OUT_SIZE 65536
+
+static uint8_t out[OUT_SIZE];
+static uint32_t out_len;
+static uint32_t fake_time;
+static uint32_t fake_masked;
+static const uint8_t *dma_buf;
+static uint32_t dma_len;
+static void (*dma_done)(void);
+static uint32_t dma_starts;
+static uint32_t dma_chained;     /* started by the completion */
+static int fake_dma_auto;
+static int dma_in_isr;
+
+static void out_bytes(const uint8_t *buf, uint32_t n)
+{
+    CHECK(out_len + n <= OUT_SIZE);
+    if (out_len + n <= OUT_SIZE)
+    {
+        memcpy(out + out_len, buf, n);
+        out_len += n;
+    }
+}
+
+/* the UART DMA interrupt */
+static int fake_dma_finish(void)
+{
+    void (*done)(void) = dma_done;
+
+    if (done == NULL)
+        return 0;
+    dma_done = NULL;
+    out_bytes(dma_buf, dma_len);
+    dma_in_isr = 1;
+    done();
+    dma_in_isr = 0;
+    return 1;
+}
+
+static uint32_t fake_now_us(void)
+{
+    fake_time += 7;
+    return fake_time;
+}
+
+static uint32_t fake_irq_save(void)
+{
+    uint32_t state = fake_masked;
+
+    fake_masked = 1;
+    return state;
+}
+
+static void fake_irq_restore(uint32_t state)
+{
+    fake_masked = state;
+    if (!fake_masked && fake_dma_auto)
+        fake_dma_finish();
+}
+
+static int fake_write_async(const uint8_t *buf, uint32_t n, void (*done)(void))
+{
+    /* started with interrupts masked, or from the DMA interrupt */
+    CHECK(fake_masked || dma_in_isr);
+    CHECK(dma_done == NULL);
+    CHECK(n > 0);
+    dma_buf = buf;
+    dma_len = n;
+    dma_done = done;
+    dma_starts++;
+    if (dma_in_isr)
+        dma_chained++;
+    return 0;
+}
+
+static void fake_write(const uint8_t *buf, uint32_t n)
+{
+    out_bytes(buf, n);
+}
+
+static const hx_dlog_port sync_port = {
+    fake_now_us, fake_irq_save, fake_irq_restore, NULL, fake_write,
+};
+
+static const hx_dlog_port dma_port = {
+    fake_now_us, fake_irq_save, fake_irq_restore, fake_write_async, fake_write,
+};
+
+/*
+ * Reference output of xprintf
+ */
+static uint8_t ref[OUT_SIZE];
+static uint32_t ref_len;
+
+static void ref_putc(unsigned char c)
+{
+    if (ref_len < OUT_SIZE)
+        ref[ref_len++] = c;
+}
+
+int console_putchar(unsigned char c)
+{
+    (void)c;
+    return 0;
+}
+
+int console_getchar(void)
+{
+    return 0;
+}
+
+static void reset_out(void)
+{
+    out_len = 0;
+    ref_len = 0;
+}
+
+static int same_as_ref(void)
+{
+    if (out_len == ref_len && memcmp(out, ref, out_len) == 0)
+        return 1;
+    printf("got %u bytes:\n%.*s\nexpected %u bytes:\n%.*s\n", out_len, (int)out_len, out, ref_len, (int)ref_len, ref);
+    return 0;
+}
+
+/* one log line, and the same through xprintf */
+#define BOTH(fmt, ...) do { \
+        HX_DLOG_INFO(fmt, ##__VA_ARGS__); \
+        xfprintf(ref_putc, fmt, ##__VA_ARGS__); \
+    } while (0)
+
+static void log_formats(void)
+{
+    char path[32];
+    long big = 123456789L;
+
+    strcpy(path, "0:/af/x_0001.bin");
+    BOTH("  X file: %s\r\n", path);
+    /* the record holds a copy */
+    strcpy(path, "overwritten");
+    BOTH("AF: raw=%d, score=%d%%, %s\n", -1234, 87, "AF");
+    BOTH("%u %x %X %o %b\n", 4000000000u, 0xBEEFu, 0xBEEFu, 8u, 5u);
+    BOTH("[%5d] [%-5d] [%05d] [%08X] [%-3u]\n", 42, 42, -42, 0xABCu, 7u);
+    BOTH("[%6s] [%-6s] [%c%c]\n", "ab", "cd", 'o', 'k');
+    BOTH("%ld %lu %lx\n", big, (unsigned long)big, -1L & 0xFFFFFFFFL);
+    BOTH("no arguments\n");
+    BOTH("%s", "");
+    BOTH("  Output length: %lu elements\r\n", 3UL);
+    BOTH("%d%d%d%d%d%d%d%d%d%d\n", 0, 1, 2, 3, 4, 5, 6, 7, 8, -9);
+}
+
+static void test_text(void)
+{
+    hx_dlog_stats st;
+
+    reset_out();
+    CHECK(hx_dlog_init(HX_DLOG_TEXT, &sync_port) == 0);
+    CHECK(hx_dlog_active());
+    log_formats();
+    CHECK(out_len == 0);
+    CHECK(hx_dlog_drain() == 0);
+    CHECK(same_as_ref());
+
+    /* compiled out, and not stored */
+    hx_dlog_get_stats(&st);
+    HX_DLOG_DEBUG("debug %d\n", 1);
+    HX_DLOG(HX_DLOG_LVL_DEBUG + 1, "trace\n");
+    HX_DLOG_ERR("err\n");
+    hx_dlog_get_stats(&st);
+    CHECK(st.records == 11);
+    CHECK(st.dropped == 0);
+    CHECK(st.max_used > 0);
+    HX_DLOG_WARN("warn\n");
+    reset_out();
+    hx_dlog_stop();
+    CHECK(!hx_dlog_active());
+    CHECK(out_len == 11 && memcmp(out, "err\r\nwarn\r\n", 11) == 0);
+    HX_DLOG_ERR("stopped\n");
+    CHECK(hx_dlog_drain() == 0);
+    CHECK(out_len == 11);
+}
+
+static void test_long_string(void)
+{
+    char s[1000];
+    uint32_t n;
+
+    memset(s, 'a', sizeof(s) - 1);
+    s[sizeof(s) - 1] = 0;
+    reset_out();
+    hx_dlog_init(HX_DLOG_TEXT, &sync_port);
+    HX_DLOG_INFO("<%s>%d\n", s, 5);
+    hx_dlog_flush();
+    /* cut to the record; the %d after it has no room */
+    n = (HX_DLOG_REC_WORDS - 2 - HX_DLOG_PTR_WORDS - 1) * 4;
+    CHECK(out_len == n + 2);
+    CHECK(out[0] == '<' && out[n] == 'a' && out[n + 1] == '>');
+}
+
+static void test_drops(void)
+{
+    hx_dlog_stats st;
+    char expect[64];
+    uint32_t i, total = HX_DLOG_RING_WORDS;
+
+    reset_out();
+    hx_dlog_init(HX_DLOG_TEXT, &sync_port);
+    /* FMT records of 4 words on a 32-bit pointer */
+    for (i = 0; i < total; i++)
+        HX_DLOG_INFO("%u\n", i);
+    hx_dlog_get_stats(&st);
+    CHECK(st.dropped > 0);
+    CHECK(st.records + st.dropped == total);
+    CHECK(st.max_used + 4 + HX_DLOG_PTR_WORDS > HX_DLOG_RING_WORDS);
+    hx_dlog_drain();
+    sprintf(expect, "[dlog: %u records dropped]\r\n", st.dropped);
+    CHECK(out_len > strlen(expect));
+    CHECK(memcmp(out, expect, strlen(expect)) == 0);
+    CHECK(memcmp(out + strlen(expect), "0\r\n1\r\n", 6) == 0);
+
+    /* reported once */
+    reset_out();
+    HX_DLOG_INFO("after\n");
+    hx_dlog_drain();
+    CHECK(out_len == 7 && memcmp(out, "after\r\n", 7) == 0);
+}
+
+static void test_dma(void)
+{
+    hx_dlog_stats st;
+    uint32_t i, left, rounds = 0;
+
+    reset_out();
+    hx_dlog_init(HX_DLOG_TEXT, &dma_port);
+    dma_starts = 0;
+    dma_chained = 0;
+    fake_dma_auto = 0;
+    for (i = 0; i < 5; i++)
+        BOTH("sample %u: raw=%d, score=%d%%\r\n", i, (int)i * 3 - 100, (int)(i % 100));
+    /* the drain does not wait for the UART */
+    CHECK(hx_dlog_drain() == 0);
+    CHECK(dma_starts == 1);
+    CHECK(out_len == 0);
+
+    /* several TX rings of text: the ring fills behind the transfer */
+    for (; i < 200; i++)
+        BOTH("sample %u: raw=%d, score=%d%%\r\n", i, (int)i * 3 - 100, (int)(i % 100));
+    left = hx_dlog_drain();
+    CHECK(left > 0);
+    CHECK(dma_starts == 1);
+
+    while (fake_dma_finish() || hx_dlog_drain() || dma_done)
+        rounds++;
+    CHECK(rounds > 2);
+    /* the TX ring wraps, the rest after the wrap goes from the ISR */
+    CHECK(dma_chained > 0);
+    CHECK(same_as_ref());
+    hx_dlog_get_stats(&st);
+    CHECK(st.bytes_out == out_len);
+    CHECK(st.dropped == 0);
+
+    /* flush waits for the DMA */
+    reset_out();
+    fake_dma_auto = 1;
+    for (i = 0; i < 100; i++)
+        BOTH("flush %u\n", i);
+    hx_dlog_flush();
+    CHECK(dma_done == NULL);
+    CHECK(same_as_ref());
+    fake_dma_auto = 0;
+}
+
+static void test_capture(void)
+{
+    reset_out();
+    hx_dlog_init(HX_DLOG_TEXT, &sync_port);
+    xdev_out(hx_dlog_putc);
+    xprintf("plain %d\n", 1);
+    HX_DLOG_INFO("record %d\n", 2);
+    xprintf("plain ");
+    xprintf("%d\n", 3);
+    xprintf("partial");
+    hx_dlog_drain();
+    CHECK(out_len == 28 && memcmp(out, "plain 1\r\nrecord 2\r\nplain 3\r\n", 28) == 0);
+    hx_dlog_flush();
+    CHECK(out_len == 35 && memcmp(out + 28, "partial", 7) == 0);
+    xdev_out(console_putchar);
+}
+
+static void test_panic(void)
+{
+    reset_out();
+    hx_dlog_init(HX_DLOG_TEXT, &dma_port);
+    fake_dma_auto = 0;
+    HX_DLOG_INFO("before %d\n", 1);
+    hx_dlog_drain();
+    CHECK(dma_done != NULL);
+    HX_DLOG_INFO("fault %d\n", 2);
+    /* the DMA never completes in a fault handler */
+    hx_dlog_panic();
+    CHECK(!hx_dlog_active());
+    CHECK(out_len == 19 && memcmp(out, "before 1\r\nfault 2\r\n", 19) == 0);
+    HX_DLOG_INFO("ignored\n");
+    CHECK(hx_dlog_drain() == 0);
+    CHECK(out_len == 19);
+    dma_done = NULL;
+}
+
+static int write_file(const char *path, const uint8_t *buf, uint32_t n)
+{
+    FILE *f = fopen(path, "wb");
+
+    if (f == NULL)
+        return -1;
+    fwrite(buf, 1, n, f);
+    fclose(f);
+    return 0;
+}
+
+/*
+ * The same lines in binary, for the decoder: behind a boot message, and
+ * a second session after plain console output
+ */
+static void test_binary(const char *bin_path, const char *text_path)
+{
+    static const char boot[] = "boot message before the log\r\n";
+    static const char plain[] = "console after hx_dlog_stop()\r\n";
+    uint32_t hello[3];
+
+    reset_out();
+    out_bytes((const uint8_t *)boot, sizeof(boot) - 1);
+    hx_dlog_init(HX_DLOG_BINARY, &dma_port);
+    fake_dma_auto = 1;
+    xfputs(ref_putc, boot);
+    log_formats();
+    xdev_out(hx_dlog_putc);
+    xprintf("plain %s\n", "line");
+    xfprintf(ref_putc, "plain %s\n", "line");
+    xdev_out(console_putchar);
+    hx_dlog_stop();
+
+    out_bytes((const uint8_t *)plain, sizeof(plain) - 1);
+    xfputs(ref_putc, plain);
+    hx_dlog_init(HX_DLOG_BINARY, &dma_port);
+    BOTH("second session %d\n", 2);
+    hx_dlog_stop();
+    fake_dma_auto = 0;
+
+    memcpy(hello, out + sizeof(boot) - 1, sizeof(hello));
+    CHECK(hello[0] == (HX_DLOG_MAGIC << 24 | HX_DLOG_HELLO << 20 | 3));
+    CHECK(hello[1] == HX_DLOG_HELLO_ID);
+    CHECK(hello[2] == (HX_DLOG_VERSION | sizeof(void *) << 8));
+    /* fewer bytes than the text */
+    printf("binary %u bytes, text %u bytes\n", out_len, ref_len);
+    CHECK(write_file(bin_path, out, out_len) == 0);
+    CHECK(write_file(text_path, ref, ref_len) == 0);
+}
+
+int main(int argc, char **argv)
+{
+    /* logged before init: dropped, nothing sent */
+    HX_DLOG_INFO("too early\n");
+    CHECK(!hx_dlog_active());
+    CHECK(hx_dlog_drain() == 0);
+    CHECK(hx_dlog_init((hx_dlog_mode)0, &sync_port) == -1);
+
+    test_text();
+    test_long_string();
+    test_drops();
+    test_dma();
+    test_capture();
+    test_panic();
+    if (argc == 3)
+        test_binary(argv[1], argv[2]);
+
+    printf(failures ? "FAILED\n" : "PASSED\n");
+    return failures ? 1 : 0;
+}
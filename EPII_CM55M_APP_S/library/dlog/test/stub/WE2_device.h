@@ -0,0 +1,4 @@
+/* Host build of library/common/xprintf.c: nothing of the device is used */
+#ifndef WE2_DEVICE_H_STUB
+#define WE2_DEVICE_H_STUB
+#endif
@@ -0,0 +1,300 @@
+#!/usr/bin/env python3
+"""Decode the HX_DLOG_BINARY log stream of library/dlog.
+
+In binary mode the WE2 sends each log call as the record it stored: the
+address of the format string and the raw arguments (see hx_dlog.h). This
+tool reads the format strings from the ELF image that produced the stream
+and formats the records as xprintf would.
+
+    python3 hx_dlog_decode.py --elf EPII_CM55M_gnu_epii_evb_WLCSP65_s.elf capture.bin
+    python3 hx_dlog_decode.py --elf app.elf --port /dev/ttyACM0 --baud 921600 --time
+
+Each hx_dlog_init() starts a session with a HELLO record. Bytes outside
+the sessions (boot messages, console output after hx_dlog_stop()) are
+printed as they are. The ELF must be the one flashed:
+with another build the format addresses point to the wrong strings.
+"""
+import argparse
+import struct
+import sys
+
+MAGIC = 0xA5
+REC_FMT = 1
+REC_TEXT = 2
+REC_DROP = 3
+REC_HELLO = 4
+HELLO_ID = 0x4C445848       # "HXDL"
+VERSION = 1
+
+HELLO = struct.pack('<II', MAGIC << 24 | REC_HELLO << 20 | 3, HELLO_ID)
+
+# Longer records are treated as a false sync
+MAX_WORDS = 1024
+
+LEVELS = {0: '', 1: 'E ', 2: 'W ', 3: 'I ', 4: 'D '}
+
+SHF_ALLOC = 0x2
+SHT_NOBITS = 8
+
+
+class Elf:
+    """The loaded sections of an ELF image, for the format strings"""
+
+    def __init__(self, path):
+        with open(path, 'rb') as f:
+            self.data = f.read()
+        d = self.data
+        if d[:4] != b'\x7fELF':
+            raise ValueError('%s: not an ELF file' % path)
+        if d[5] != 1:
+            raise ValueError('%s: big endian ELF not supported' % path)
+        if d[4] == 1:
+            shoff, = struct.unpack_from('<I', d, 0x20)
+            shentsize, shnum = struct.unpack_from('<HH', d, 0x2E)
+            sh = struct.Struct('<IIIIIIIIII')
+        else:
+            shoff, = struct.unpack_from('<Q', d, 0x28)
+            shentsize, shnum = struct.unpack_from('<HH', d, 0x3A)
+            sh = struct.Struct('<IIQQQQIIQQ')
+        self.sections = []
+        for i in range(shnum):
+            _, sh_type, flags, addr, offset, size = sh.unpack_from(d, shoff + i * shentsize)[:6]
+            if flags & SHF_ALLOC and sh_type != SHT_NOBITS and size:
+                self.sections.append((addr, addr + size, offset))
+
+    def string(self, addr):
+        for start, end, offset in self.sections:
+            if start <= addr < end:
+                pos = offset + addr - start
+                stop = self.data.find(b'\0', pos, offset + end - start)
+                if stop < 0:
+                    stop = offset + end - start
+                return self.data[pos:stop].decode('latin-1')
+        return None
+
+
+def xformat(fmt, args):
+    """xvprintf() of library/common/xprintf.c on the argument words"""
+    out = []
+    k = 0
+    i = 0
+    while i < len(fmt):
+        c = fmt[i]
+        i += 1
+        if c != '%':
+            out.append(c)
+            continue
+        flag = ''
+        c = fmt[i:i + 1]
+        i += 1
+        if c in ('0', '-'):
+            flag = c
+            c = fmt[i:i + 1]
+            i += 1
+        w = 0
+        while c.isdigit():
+            w = w * 10 + int(c)
+            c = fmt[i:i + 1]
+            i += 1
+        if c in ('l', 'L'):
+            c = fmt[i:i + 1]
+            i += 1
+        if not c:
+            break
+        d = c.upper()
+        if d not in 'SCBODUX':
+            out.append(c)
+            continue
+        if k >= len(args):
+            break
+        a = args[k]
+        k += 1
+        if d == 'S':
+            s = a
+        elif d == 'C':
+            out.append(chr(a & 0xFF))
+            continue
+        else:
+            r = {'B': 2, 'O': 8, 'D': 10, 'U': 10, 'X': 16}[d]
+            neg = d == 'D' and a & 0x80000000
+            if neg:
+                a = (-a) & 0xFFFFFFFF
+            digits = ''
+            while True:
+                v = a % r
+                a //= r
+                digits = '0123456789ABCDEF'[v] + digits
+                if not a:
+                    break
+            if c == 'x':
+                digits = digits.lower()
+            if neg:
+                digits = '-' + digits
+            s = digits
+        pad = max(w - len(s), 0)
+        if flag == '-':
+            s = s + ' ' * pad
+        elif flag == '0' and d != 'S':
+            s = '0' * pad + s
+        else:
+            s = ' ' * pad + s
+        out.append(s)
+    return ''.join(out)
+
+
+def fmt_args(fmt, words):
+    """Splits the argument words of a FMT record by the format"""
+    args = []
+    k = 0
+    i = 0
+    while i < len(fmt) and k < len(words):
+        c = fmt[i]
+        i += 1
+        if c != '%':
+            continue
+        c = fmt[i:i + 1]
+        i += 1
+        if c in ('0', '-'):
+            c = fmt[i:i + 1]
+            i += 1
+        while c.isdigit():
+            c = fmt[i:i + 1]
+            i += 1
+        if c in ('l', 'L'):
+            c = fmt[i:i + 1]
+            i += 1
+        if not c:
+            break
+        d = c.upper()
+        if d == 'S':
+            n = words[k]
+            raw = struct.pack('<%dI' % len(words[k + 1:]), *words[k + 1:])[:n]
+            args.append(raw.decode('latin-1'))
+            k += 1 + (n + 3) // 4
+        elif d in 'CBODUX':
+            args.append(words[k])
+            k += 1
+    return args
+
+
+class Decoder:
+    """Feed it the captured bytes, it returns the text of whole records"""
+
+    def __init__(self, elf, show_time=False, show_level=False):
+        self.elf = elf
+        self.show_time = show_time
+        self.show_level = show_level
+        self.buf = b''
+        self.synced = False
+        self.ptr_words = 1
+        self.records = 0
+        self.errors = 0
+
+    def prefix(self, level, time_us):
+        p = ''
+        if self.show_time:
+            p += '[%10.6f] ' % (time_us / 1e6)
+        if self.show_level:
+            p += LEVELS.get(level, '%d ' % level)
+        return p
+
+    def record(self, hdr, words):
+        rtype = hdr >> 20 & 0xF
+        level = hdr >> 16 & 0xF
+        if rtype == REC_HELLO:
+            if words[0] != HELLO_ID or words[1] & 0xFF != VERSION:
+                self.errors += 1
+                return '[dlog: unknown stream version]\n'
+            self.ptr_words = ((words[1] >> 8 & 0xFF) + 3) // 4
+            return ''
+        if rtype == REC_FMT:
+            pw = self.ptr_words
+            addr = words[0] if pw == 1 else words[0] | words[1] << 32
+            time_us = words[pw]
+            fmt = self.elf.string(addr)
+            if fmt is None:
+                self.errors += 1
+                return '[dlog: no format at 0x%x, is it the flashed ELF?]\n' % addr
+            return self.prefix(level, time_us) + xformat(fmt, fmt_args(fmt, words[pw + 1:]))
+        if rtype == REC_TEXT:
+            n = words[1]
+            raw = struct.pack('<%dI' % (len(words) - 2), *words[2:])[:n]
+            return self.prefix(0, words[0]) + raw.decode('latin-1')
+        if rtype == REC_DROP:
+            return '[dlog: %u records dropped]\n' % words[1]
+        self.errors += 1
+        return ''
+
+    def feed(self, data):
+        self.buf += data
+        out = []
+        while True:
+            if not self.synced:
+                pos = self.buf.find(HELLO)
+                if pos < 0:
+                    # keep what may be the start of a HELLO
+                    keep = len(HELLO) - 1
+                    cut = max(len(self.buf) - keep, 0)
+                    out.append(self.buf[:cut].decode('latin-1'))
+                    self.buf = self.buf[cut:]
+                    break
+                out.append(self.buf[:pos].decode('latin-1'))
+                self.buf = self.buf[pos:]
+                self.synced = True
+            if len(self.buf) < 4:
+                break
+            hdr, = struct.unpack_from('<I', self.buf)
+            n = hdr & 0xFFFF
+            if hdr >> 24 != MAGIC or n < 1 or n > MAX_WORDS:
+                # end of the session, plain text until the next HELLO
+                self.synced = False
+                continue
+            if len(self.buf) < n * 4:
+                break
+            words = struct.unpack_from('<%dI' % n, self.buf)
+            self.buf = self.buf[n * 4:]
+            self.records += 1
+            out.append(self.record(hdr, words[1:]))
+        return ''.join(out).replace('\r\n', '\n')
+
+    def finish(self):
+        """The text left at the end of the stream"""
+        if self.synced:
+            return ''
+        text = self.buf.decode('latin-1').replace('\r\n', '\n')
+        self.buf = b''
+        return text
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('file', nargs='?', help='captured byte stream to decode')
+    parser.add_argument('--elf', required=True, help='ELF image that sent the stream')
+    parser.add_argument('--port', help='serial port to read from (needs pyserial)')
+    parser.add_argument('--baud', type=int, default=921600)
+    parser.add_argument('--time', action='store_true', help='prefix each record with its time in seconds')
+    parser.add_argument('--level', action='store_true', help='prefix each record with its level letter')
+    parser.add_argument('--check', action='store_true', help='exit 1 if the stream has no record, a bad or a truncated one')
+    args = parser.parse_args()
+
+    dec = Decoder(Elf(args.elf), args.time, args.level)
+    if args.port:
+        import serial
+        with serial.Serial(args.port, args.baud, timeout=0.1) as port:
+            try:
+                while True:
+                    sys.stdout.write(dec.feed(port.read(4096)))
+                    sys.stdout.flush()
+            except KeyboardInterrupt:
+                pass
+    else:
+        with open(args.file, 'rb') if args.file else sys.stdin.buffer as f:
+            sys.stdout.write(dec.feed(f.read()))
+            sys.stdout.write(dec.finish())
+    if args.check and (not dec.records or dec.errors or dec.buf):
+        return 1
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
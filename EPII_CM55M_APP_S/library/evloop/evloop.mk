@@ -0,0 +1,70 @@
+# directory declaration
+LIB_EVLOOP_DIR = $(LIBRARIES_ROOT)/evloop
+
+LIB_EVLOOP_ASMSRCDIR	= $(LIB_EVLOOP_DIR)
+LIB_EVLOOP_CSRCDIR	= $(LIB_EVLOOP_DIR)
+LIB_EVLOOP_CXXSRCSDIR    = $(LIB_EVLOOP_DIR)
+# hxevent.h, implemented by hx_evloop_hxevent.c
+LIB_EVLOOP_INCDIR	= $(LIB_EVLOOP_DIR) $(LIBRARIES_ROOT)/hxevent
+
+ifneq ($(filter hxevent, $(LIB_SEL)),)
+$(error evloop replaces hxevent, select one of them in LIB_SEL)
+endif
+
+# find all the source files in the target directories
+LIB_EVLOOP_CSRCS = $(call get_csrcs, $(LIB_EVLOOP_CSRCDIR))
+LIB_EVLOOP_CXXSRCS = $(call get_cxxsrcs, $(LIB_EVLOOP_CXXSRCSDIR))
+LIB_EVLOOP_ASMSRCS = $(call get_asmsrcs, $(LIB_EVLOOP_ASMSRCDIR))
+
+# get object files
+LIB_EVLOOP_COBJS = $(call get_relobjs, $(LIB_EVLOOP_CSRCS))
+LIB_EVLOOP_CXXOBJS = $(call get_relobjs, $(LIB_EVLOOP_CXXSRCS))
+LIB_EVLOOP_ASMOBJS = $(call get_relobjs, $(LIB_EVLOOP_ASMSRCS))
+LIB_EVLOOP_OBJS = $(LIB_EVLOOP_COBJS) $(LIB_EVLOOP_ASMOBJS) $(LIB_EVLOOP_CXXOBJS)
+
+# get dependency files
+LIB_EVLOOP_DEPS = $(call get_deps, $(LIB_EVLOOP_OBJS))
+
+# extra macros to be defined
+LIB_EVLOOP_DEFINES = -DLIB_EVLOOP
+
+# genearte library
+ifeq ($(EVLOOP_LIB_FORCE_PREBUILT), y)
+override LIB_EVLOOP_OBJS:=
+endif
+EVLOOP_LIB_NAME = lib_evloop.a
+LIB_LIB_EVLOOP := $(subst /,$(PS), $(strip $(OUT_DIR)/$(EVLOOP_LIB_NAME)))
+
+# library generation rule
+$(LIB_LIB_EVLOOP): $(LIB_EVLOOP_OBJS)
+	$(TRACE_ARCHIVE)
+ifeq "$(strip $(LIB_EVLOOP_OBJS))" ""
+	$(CP) $(PREBUILT_LIB)$(EVLOOP_LIB_NAME) $(LIB_LIB_EVLOOP)
+else
+	$(Q)$(AR) $(AR_OPT) $@ $(LIB_EVLOOP_OBJS)
+	$(CP) $(LIB_LIB_EVLOOP) $(PREBUILT_LIB)$(EVLOOP_LIB_NAME)
+endif
+
+# specific compile rules
+# user can add rules to compile this middleware
+# if not rules specified to this middleware, it will use default compiling rules
+
+# Middleware Definitions
+LIB_INCDIR += $(LIB_EVLOOP_INCDIR)
+LIB_CSRCDIR += $(LIB_EVLOOP_CSRCDIR)
+LIB_CXXSRCDIR += $(LIB_EVLOOP_CXXSRCDIR)
+LIB_ASMSRCDIR += $(LIB_EVLOOP_ASMSRCDIR)
+
+LIB_CSRCS += $(LIB_EVLOOP_CSRCS)
+LIB_CXXSRCS += $(LIB_EVLOOP_CXXSRCS)
+LIB_ASMSRCS += $(LIB_EVLOOP_ASMSRCS)
+LIB_ALLSRCS += $(LIB_EVLOOP_CSRCS) $(LIB_EVLOOP_ASMSRCS)
+
+LIB_COBJS += $(LIB_EVLOOP_COBJS)
+LIB_CXXOBJS += $(LIB_EVLOOP_CXXOBJS)
+LIB_ASMOBJS += $(LIB_EVLOOP_ASMOBJS)
+LIB_ALLOBJS += $(LIB_EVLOOP_OBJS)
+
+LIB_DEFINES += $(LIB_EVLOOP_DEFINES)
+LIB_DEPS += $(LIB_EVLOOP_DEPS)
+LIB_LIBS += $(LIB_LIB_EVLOOP)
\ No newline at end of file
@@ -0,0 +1,509 @@
+/*
+ * hx_evloop.c
+ *
+ * See hx_evloop.h. The pending mask is indexed by rank, not by event id:
+ * bit 0 is the event of highest priority, so the next event is the lowest
+ * bit set. Ranks only change in hx_evloop_create() and
+ * hx_evloop_set_priority(), at init.
+ */
+#include <string.h>
+#include "hx_evloop.h"
+
+#define WORK_IDLE       0
+#define WORK_QUEUED     1
+#define WORK_DELAYED    2
+
+#define RANK_PENDING    0xFF
+
+/* 64-bit loop time from the wrapping port ticks, loop context only */
+static uint64_t now64(hx_evloop *ev)
+{
+    uint32_t t = ev->port->now();
+
+    if (t < ev->last_tick)
+        ev->tick_hi += (uint64_t)1 << 32;
+    ev->last_tick = t;
+    return ev->tick_hi | t;
+}
+
+static void rank_events(hx_evloop *ev)
+{
+    uint8_t order[HX_EVLOOP_MAX_EVENTS];
+    uint64_t pending = 0, old;
+    uint32_t state;
+    int i, j;
+
+    /* insertion sort on (prio, id), ids are in creation order */
+    for (i = 0; i < ev->num_events; i++)
+    {
+        for (j = i; j > 0 && ev->event[order[j - 1]].prio > ev->event[i].prio; j--)
+            order[j] = order[j - 1];
+        order[j] = (uint8_t)i;
+    }
+
+    state = ev->port->irq_save();
+    for (old = ev->pending; old; old &= old - 1)
+        ev->event[ev->order[__builtin_ctzll(old)]].rank = RANK_PENDING;
+    for (i = 0; i < ev->num_events; i++)
+    {
+        if (ev->event[order[i]].rank == RANK_PENDING)
+            pending |= (uint64_t)1 << i;
+        ev->event[order[i]].rank = (uint8_t)i;
+        ev->order[i] = order[i];
+    }
+    ev->pending = pending;
+    ev->port->irq_restore(state);
+}
+
+int hx_evloop_init(hx_evloop *ev, const hx_evloop_port *port)
+{
+    memset(ev, 0, sizeof(*ev));
+    ev->port = port;
+    ev->idle = port->idle;
+    ev->tpu = port->ticks_per_us();
+    if (ev->tpu == 0)
+        ev->tpu = 1;
+    ev->last_tick = port->now();
+    ev->stats_since = now64(ev);
+    return 0;
+}
+
+int hx_evloop_create(hx_evloop *ev, const char *name, uint8_t prio, hx_evloop_cb cb, void *arg)
+{
+    hx_evloop_event *e;
+    int id;
+
+    if (ev->num_events >= HX_EVLOOP_MAX_EVENTS)
+        return HX_EVLOOP_NONE;
+    id = ev->num_events;
+    e = &ev->event[id];
+    memset(e, 0, sizeof(*e));
+    e->cb = cb;
+    e->arg = arg;
+    e->name = name;
+    e->prio = prio;
+    ev->num_events++;
+    rank_events(ev);
+    return id;
+}
+
+void hx_evloop_set_callback(hx_evloop *ev, int id, hx_evloop_cb cb, void *arg)
+{
+    if (id < 0 || id >= ev->num_events)
+        return;
+    ev->event[id].cb = cb;
+    ev->event[id].arg = arg;
+}
+
+void hx_evloop_set_priority(hx_evloop *ev, int id, uint8_t prio)
+{
+    if (id < 0 || id >= ev->num_events || ev->event[id].prio == prio)
+        return;
+    ev->event[id].prio = prio;
+    rank_events(ev);
+}
+
+/* interrupts masked */
+static void post_locked(hx_evloop *ev, hx_evloop_event *e, uint32_t now)
+{
+    if (e->posts == 0)
+    {
+        e->post_tick = now;
+        ev->pending |= (uint64_t)1 << e->rank;
+    }
+#if HX_EVLOOP_STATS
+    else
+    {
+        e->stats.coalesced++;
+    }
+    e->stats.posts++;
+#endif
+    if (e->posts != UINT16_MAX)
+        e->posts++;
+}
+
+void hx_evloop_post(hx_evloop *ev, int id)
+{
+    uint32_t state, now;
+
+    if (id < 0 || id >= ev->num_events)
+        return;
+    now = ev->port->now();
+    state = ev->port->irq_save();
+    post_locked(ev, &ev->event[id], now);
+    ev->port->irq_restore(state);
+}
+
+void hx_evloop_set_idle(hx_evloop *ev, hx_evloop_idle_fn fn, void *arg)
+{
+    ev->idle = fn;
+    ev->idle_arg = arg;
+}
+
+/*
+ * Work queues
+ */
+static int queue_cb(void *arg, uint32_t posts)
+{
+    hx_evloop_queue *q = (hx_evloop_queue *)arg;
+    const hx_evloop_port *port = q->loop->port;
+    hx_evloop_work *w;
+    uint32_t state, n;
+
+    (void)posts;
+    q->runs++;
+    for (n = 0; n < q->batch; n++)
+    {
+        state = port->irq_save();
+        w = q->head;
+        if (w)
+        {
+            q->head = w->next;
+            if (q->head == NULL)
+                q->tail = NULL;
+            q->depth--;
+            w->next = NULL;
+            w->state = WORK_IDLE;
+        }
+        port->irq_restore(state);
+        if (w == NULL)
+            return HX_EVLOOP_DONE;
+        /* idle again, fn may queue it anew */
+        w->fn(w->arg);
+    }
+    /* work queued from an ISR meanwhile has posted the queue anyway */
+    return q->head ? HX_EVLOOP_AGAIN : HX_EVLOOP_DONE;
+}
+
+int hx_evloop_queue_init(hx_evloop *ev, hx_evloop_queue *q, const char *name, uint8_t prio, uint16_t batch)
+{
+    memset(q, 0, sizeof(*q));
+    q->loop = ev;
+    q->batch = batch ? batch : 1;
+    q->event = (int8_t)hx_evloop_create(ev, name, prio, queue_cb, q);
+    return q->event;
+}
+
+void hx_evloop_work_init(hx_evloop_work *w, void (*fn)(void *arg), void *arg)
+{
+    memset(w, 0, sizeof(*w));
+    w->fn = fn;
+    w->arg = arg;
+}
+
+int hx_evloop_defer(hx_evloop_queue *q, hx_evloop_work *w)
+{
+    hx_evloop *ev = q->loop;
+    uint32_t state, now;
+
+    if (q->event < 0)
+        return -1;
+    now = ev->port->now();
+    state = ev->port->irq_save();
+    if (w->state != WORK_IDLE)
+    {
+        ev->port->irq_restore(state);
+        return -1;
+    }
+    w->state = WORK_QUEUED;
+    w->queue = q;
+    w->next = NULL;
+    if (q->tail)
+        q->tail->next = w;
+    else
+        q->head = w;
+    q->tail = w;
+    if (++q->depth > q->max_depth)
+        q->max_depth = q->depth;
+    post_locked(ev, &ev->event[q->event], now);
+    ev->port->irq_restore(state);
+    return 0;
+}
+
+int hx_evloop_defer_delayed(hx_evloop_queue *q, hx_evloop_work *w, uint32_t delay_us)
+{
+    hx_evloop *ev = q->loop;
+    hx_evloop_work **pp;
+    uint32_t state;
+
+    if (q->event < 0)
+        return -1;
+    state = ev->port->irq_save();
+    if (w->state != WORK_IDLE)
+    {
+        ev->port->irq_restore(state);
+        return -1;
+    }
+    w->state = WORK_DELAYED;
+    ev->port->irq_restore(state);
+
+    w->queue = q;
+    w->due = now64(ev) + (uint64_t)delay_us * ev->tpu;
+    /* behind the work due at the same time */
+    for (pp = &ev->delayed; *pp && (*pp)->due <= w->due; pp = &(*pp)->next)
+        ;
+    w->next = *pp;
+    *pp = w;
+    return 0;
+}
+
+int hx_evloop_cancel(hx_evloop_work *w)
+{
+    hx_evloop_queue *q = w->queue;
+    hx_evloop *ev;
+    hx_evloop_work **pp, *prev = NULL;
+    uint32_t state;
+    int ret = -1;
+
+    if (q == NULL)
+        return -1;
+    ev = q->loop;
+    if (w->state == WORK_DELAYED)
+    {
+        for (pp = &ev->delayed; *pp; pp = &(*pp)->next)
+        {
+            if (*pp == w)
+            {
+                *pp = w->next;
+                w->next = NULL;
+                w->state = WORK_IDLE;
+                return 0;
+            }
+        }
+        return -1;
+    }
+
+    state = ev->port->irq_save();
+    if (w->state == WORK_QUEUED)
+    {
+        for (pp = &q->head; *pp; prev = *pp, pp = &(*pp)->next)
+        {
+            if (*pp == w)
+            {
+                *pp = w->next;
+                if (q->tail == w)
+                    q->tail = prev;
+                q->depth--;
+                w->next = NULL;
+                w->state = WORK_IDLE;
+                ret = 0;
+                break;
+            }
+        }
+    }
+    ev->port->irq_restore(state);
+    return ret;
+}
+
+/* the due delayed work to its queues */
+static void promote_due(hx_evloop *ev)
+{
+    hx_evloop_work *w;
+    uint64_t now;
+
+    if (ev->delayed == NULL)
+        return;
+    now = now64(ev);
+    while ((w = ev->delayed) != NULL && w->due <= now)
+    {
+        ev->delayed = w->next;
+        w->next = NULL;
+        w->state = WORK_IDLE;
+        hx_evloop_defer(w->queue, w);
+    }
+}
+
+/*
+ * Dispatch
+ */
+#if HX_EVLOOP_STATS
+static void hist_add(uint16_t *hist, uint32_t us)
+{
+    uint32_t bin = us ? 32 - __builtin_clz(us) : 0;
+
+    if (bin >= HX_EVLOOP_HIST_BINS)
+        bin = HX_EVLOOP_HIST_BINS - 1;
+    if (hist[bin] != UINT16_MAX)
+        hist[bin]++;
+}
+#endif
+
+static int dispatch_one(hx_evloop *ev)
+{
+    const hx_evloop_port *port = ev->port;
+    hx_evloop_event *e;
+    uint32_t state, posts, post_tick;
+    uint64_t pending;
+    int rank, id, ret;
+#if HX_EVLOOP_STATS
+    uint32_t t0, t1, lat_us, run_us;
+#endif
+
+    state = port->irq_save();
+    pending = ev->pending;
+    if (pending == 0)
+    {
+        port->irq_restore(state);
+        return 0;
+    }
+    rank = __builtin_ctzll(pending);
+    ev->pending = pending & ~((uint64_t)1 << rank);
+    id = ev->order[rank];
+    e = &ev->event[id];
+    posts = e->posts;
+    post_tick = e->post_tick;
+    e->posts = 0;
+    port->irq_restore(state);
+
+#if HX_EVLOOP_STATS
+    t0 = port->now();
+#endif
+    ret = e->cb ? e->cb(e->arg, posts) : HX_EVLOOP_DONE;
+#if HX_EVLOOP_STATS
+    t1 = port->now();
+    lat_us = (t0 - post_tick) / ev->tpu;
+    run_us = (t1 - t0) / ev->tpu;
+    e->stats.runs++;
+    e->stats.run_us += run_us;
+    if (lat_us > e->stats.lat_max_us)
+        e->stats.lat_max_us = lat_us;
+    if (run_us > e->stats.run_max_us)
+        e->stats.run_max_us = run_us;
+    hist_add(e->stats.lat_hist, lat_us);
+    hist_add(e->stats.run_hist, run_us);
+#else
+    (void)post_tick;
+#endif
+    if (ret == HX_EVLOOP_AGAIN)
+        hx_evloop_post(ev, id);
+    return 1;
+}
+
+uint32_t hx_evloop_poll(hx_evloop *ev)
+{
+    uint32_t runs = 0;
+
+    promote_due(ev);
+    while (dispatch_one(ev))
+    {
+        runs++;
+        promote_due(ev);
+    }
+    return runs;
+}
+
+void hx_evloop_idle(hx_evloop *ev)
+{
+    uint32_t state, max_us = HX_EVLOOP_FOREVER;
+    uint64_t now, t0;
+
+    if (ev->idle == NULL)
+        return;
+    if (ev->delayed)
+    {
+        now = now64(ev);
+        if (ev->delayed->due <= now)
+            return;
+        t0 = (ev->delayed->due - now + ev->tpu - 1) / ev->tpu;
+        max_us = t0 >= HX_EVLOOP_FOREVER ? HX_EVLOOP_FOREVER - 1 : (uint32_t)t0;
+    }
+
+    state = ev->port->irq_save();
+    /* an ISR that posts from here on ends the idle hook */
+    if (ev->pending == 0 && !ev->stop)
+    {
+        t0 = now64(ev);
+        ev->idle(ev->idle_arg, max_us);
+        ev->idle_ticks += now64(ev) - t0;
+        ev->idle_entries++;
+    }
+    ev->port->irq_restore(state);
+}
+
+void hx_evloop_run(hx_evloop *ev)
+{
+    ev->stop = 0;
+    while (!ev->stop)
+    {
+        promote_due(ev);
+        if (!dispatch_one(ev))
+            hx_evloop_idle(ev);
+    }
+}
+
+void hx_evloop_stop(hx_evloop *ev)
+{
+    ev->stop = 1;
+}
+
+uint64_t hx_evloop_now_us(hx_evloop *ev)
+{
+    return now64(ev) / ev->tpu;
+}
+
+void hx_evloop_stats_reset(hx_evloop *ev)
+{
+#if HX_EVLOOP_STATS
+    int i;
+
+    for (i = 0; i < ev->num_events; i++)
+        memset(&ev->event[i].stats, 0, sizeof(ev->event[i].stats));
+#endif
+    ev->tpu = ev->port->ticks_per_us();
+    if (ev->tpu == 0)
+        ev->tpu = 1;
+    ev->idle_ticks = 0;
+    ev->idle_entries = 0;
+    ev->stats_since = now64(ev);
+}
+
+#if HX_EVLOOP_STATS
+static void print_hist(void (*print)(const char *fmt, ...), const char *what, const uint16_t *hist)
+{
+    int i;
+
+    print("    %s us:", what);
+    for (i = 0; i < HX_EVLOOP_HIST_BINS; i++)
+    {
+        if (hist[i] == 0)
+            continue;
+        if (i == HX_EVLOOP_HIST_BINS - 1)
+            print(" >=%u:%u", 1u << (i - 1), (unsigned)hist[i]);
+        else
+            print(" <%u:%u", 1u << i, (unsigned)hist[i]);
+    }
+    print("\n");
+}
+#endif
+
+void hx_evloop_report(hx_evloop *ev, void (*print)(const char *fmt, ...))
+{
+    uint64_t total = now64(ev) - ev->stats_since;
+#if HX_EVLOOP_STATS
+    const hx_evloop_event *e;
+    int rank;
+#endif
+
+    print("evloop: %u ms, idle %u ms (%u%%) in %u entries\n",
+          (unsigned)(total / ev->tpu / 1000), (unsigned)(ev->idle_ticks / ev->tpu / 1000),
+          (unsigned)(total ? ev->idle_ticks * 100 / total : 0), (unsigned)ev->idle_entries);
+#if HX_EVLOOP_STATS
+    for (rank = 0; rank < ev->num_events; rank++)
+    {
+        e = &ev->event[ev->order[rank]];
+        if (e->stats.posts == 0)
+            continue;
+        if (e->name)
+            print("  %s:", e->name);
+        else
+            print("  event %u:", (unsigned)ev->order[rank]);
+        print(" prio %u, %u posts, %u coalesced, %u runs, run %u us avg %u us max, latency %u us max\n",
+              (unsigned)e->prio, (unsigned)e->stats.posts, (unsigned)e->stats.coalesced,
+              (unsigned)e->stats.runs,
+              (unsigned)(e->stats.runs ? e->stats.run_us / e->stats.runs : 0),
+              (unsigned)e->stats.run_max_us, (unsigned)e->stats.lat_max_us);
+        print_hist(print, "latency", e->stats.lat_hist);
+        print_hist(print, "run", e->stats.run_hist);
+    }
+#endif
+}
@@ -0,0 +1,265 @@
+#ifndef _LIB_HX_EVLOOP_H_
+#define _LIB_HX_EVLOOP_H_
+/*
+ * Event loop for bare-metal apps, the open counterpart of hxevent.
+ *
+ * Events are posted from ISRs or from the loop itself and dispatched one
+ * at a time, highest priority (lowest value) first, events of the same
+ * priority in the order they were created. The events are kept ranked by
+ * priority, so picking the next one is a count of trailing zeros of one
+ * 64-bit pending mask, whatever the number of events.
+ *
+ * An event posted again before it was dispatched is not queued twice: the
+ * posts are coalesced and the callback gets their number. A callback that
+ * returns HX_EVLOOP_AGAIN is posted again behind the events of higher
+ * priority that came in meanwhile.
+ *
+ * Deferred work (hx_evloop_work) is queued on a work queue, which is an
+ * event of its own priority running up to batch items per dispatch.
+ * Delayed work waits in a list sorted by due time and goes to its queue
+ * when due; the loop does not sleep past the first one.
+ *
+ * With nothing pending the idle hook is called with interrupts masked and
+ * the time to the next delayed work; it returns once an interrupt is
+ * pending. The WE2 hooks are hx_evloop_we2_wfi() and, with lpsched,
+ * hx_evloop_we2_pmu() (PMU power down when the gap allows).
+ *
+ * Per event, HX_EVLOOP_STATS keeps the posts, the coalesced posts and
+ * log2 histograms of the latency (first post to dispatch) and of the run
+ * time of the callback, in microseconds.
+ *
+ * hx_evloop_hxevent.c implements hxevent.h on one loop, so event_handler.c
+ * runs on it unchanged: select evloop instead of hxevent in LIB_SEL.
+ *
+ * Usage:
+ *   static hx_evloop loop;
+ *   hx_evloop_init(&loop, &hx_evloop_we2_port);
+ *   rx = hx_evloop_create(&loop, "rx", 0, rx_cb, NULL);
+ *   hx_evloop_queue_init(&loop, &log_q, "log", 200, 4);
+ *   ISR: hx_evloop_post(&loop, rx);
+ *   rx_cb: hx_evloop_defer(&log_q, &log_work);
+ *   hx_evloop_run(&loop);
+ */
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/** One bit per event in the pending mask */
+#define HX_EVLOOP_MAX_EVENTS 64
+
+#ifndef HX_EVLOOP_STATS
+#define HX_EVLOOP_STATS 1
+#endif
+
+/** Histogram bins: <1 us, then [2^(i-1), 2^i) us, the last one open */
+#ifndef HX_EVLOOP_HIST_BINS
+#define HX_EVLOOP_HIST_BINS 16
+#endif
+
+#define HX_EVLOOP_NONE      (-1)
+#define HX_EVLOOP_FOREVER   UINT32_MAX
+
+/** Callback return */
+#define HX_EVLOOP_DONE      0
+#define HX_EVLOOP_AGAIN     1
+
+/**
+ * Event callback.
+ * @param posts  posts coalesced into this dispatch, at least 1
+ * @return HX_EVLOOP_DONE, or HX_EVLOOP_AGAIN to be posted again
+ */
+typedef int (*hx_evloop_cb)(void *arg, uint32_t posts);
+
+/**
+ * Idle hook, called with interrupts masked. Returns once an interrupt is
+ * pending or max_us has passed (HX_EVLOOP_FOREVER: no delayed work).
+ */
+typedef void (*hx_evloop_idle_fn)(void *arg, uint32_t max_us);
+
+/**
+ * Platform of the loop, hx_evloop_we2_port on the chip.
+ */
+typedef struct hx_evloop_port {
+    /** free-running tick counter, wraps at 2^32 */
+    uint32_t (*now)(void);
+    uint32_t (*ticks_per_us)(void);
+    /** masks interrupts, returns the previous state for irq_restore */
+    uint32_t (*irq_save)(void);
+    void (*irq_restore)(uint32_t state);
+    /** default idle hook, NULL to spin */
+    hx_evloop_idle_fn idle;
+} hx_evloop_port;
+
+typedef struct hx_evloop_stats {
+    uint32_t posts;
+    uint32_t coalesced;     /**< posts that found the event already pending */
+    uint32_t runs;
+    uint32_t lat_max_us;
+    uint32_t run_max_us;
+    uint64_t run_us;
+    uint16_t lat_hist[HX_EVLOOP_HIST_BINS];     /**< saturate at UINT16_MAX */
+    uint16_t run_hist[HX_EVLOOP_HIST_BINS];
+} hx_evloop_stats;
+
+typedef struct hx_evloop_event {
+    hx_evloop_cb cb;
+    void *arg;
+    const char *name;
+    uint8_t prio;
+    uint8_t rank;           /**< bit in the pending mask */
+    volatile uint16_t posts;/**< since the last dispatch, saturates */
+    volatile uint32_t post_tick;
+#if HX_EVLOOP_STATS
+    hx_evloop_stats stats;
+#endif
+} hx_evloop_event;
+
+typedef struct hx_evloop hx_evloop;
+typedef struct hx_evloop_work hx_evloop_work;
+typedef struct hx_evloop_queue hx_evloop_queue;
+
+/** Deferred work item, owned by the loop while queued */
+struct hx_evloop_work {
+    void (*fn)(void *arg);
+    void *arg;
+    hx_evloop_work *next;
+    hx_evloop_queue *queue;
+    uint64_t due;           /**< loop ticks, delayed work only */
+    volatile uint8_t state;
+};
+
+struct hx_evloop_queue {
+    hx_evloop *loop;
+    hx_evloop_work *head;
+    hx_evloop_work *tail;
+    uint16_t batch;         /**< items per dispatch */
+    int8_t event;
+    uint32_t runs;
+    uint32_t max_depth;
+    uint32_t depth;
+};
+
+struct hx_evloop {
+    const hx_evloop_port *port;
+    volatile uint64_t pending;  /**< bit rank of every posted event */
+    uint8_t num_events;
+    uint8_t order[HX_EVLOOP_MAX_EVENTS];    /**< event id of every rank */
+    hx_evloop_event event[HX_EVLOOP_MAX_EVENTS];
+    hx_evloop_work *delayed;    /**< sorted by due */
+    hx_evloop_idle_fn idle;
+    void *idle_arg;
+    volatile uint8_t stop;
+    uint32_t tpu;               /**< ticks per microsecond */
+    uint32_t last_tick;
+    uint64_t tick_hi;
+    uint64_t stats_since;
+    uint64_t idle_ticks;
+    uint32_t idle_entries;
+};
+
+/** The WE2 port: SysTick clock, PRIMASK, hx_evloop_we2_wfi() */
+extern const hx_evloop_port hx_evloop_we2_port;
+
+int hx_evloop_init(hx_evloop *ev, const hx_evloop_port *port);
+
+/**
+ * Creates an event. Events of the same priority run in creation order.
+ * @return event id, or HX_EVLOOP_NONE if all HX_EVLOOP_MAX_EVENTS are used
+ */
+int hx_evloop_create(hx_evloop *ev, const char *name, uint8_t prio, hx_evloop_cb cb, void *arg);
+
+void hx_evloop_set_callback(hx_evloop *ev, int id, hx_evloop_cb cb, void *arg);
+
+/** Re-ranks the events, a pending post stays pending */
+void hx_evloop_set_priority(hx_evloop *ev, int id, uint8_t prio);
+
+/** Posts an event, from an ISR or the loop */
+void hx_evloop_post(hx_evloop *ev, int id);
+
+/** Replaces the idle hook of the port, NULL to spin */
+void hx_evloop_set_idle(hx_evloop *ev, hx_evloop_idle_fn fn, void *arg);
+
+/**
+ * Sets up a work queue, an event of priority prio running up to batch
+ * items per dispatch.
+ * @return the event id, or HX_EVLOOP_NONE
+ */
+int hx_evloop_queue_init(hx_evloop *ev, hx_evloop_queue *q, const char *name, uint8_t prio, uint16_t batch);
+
+void hx_evloop_work_init(hx_evloop_work *w, void (*fn)(void *arg), void *arg);
+
+/**
+ * Queues work, from an ISR or the loop.
+ * @return 0, or -1 if it is already queued or delayed
+ */
+int hx_evloop_defer(hx_evloop_queue *q, hx_evloop_work *w);
+
+/**
+ * Queues work in delay_us, from the loop only.
+ * @return 0, or -1 if it is already queued or delayed
+ */
+int hx_evloop_defer_delayed(hx_evloop_queue *q, hx_evloop_work *w, uint32_t delay_us);
+
+/**
+ * Takes queued or delayed work back, from the loop only.
+ * @return 0, or -1 if it was not queued
+ */
+int hx_evloop_cancel(hx_evloop_work *w);
+
+/**
+ * Moves the due delayed work to its queues and dispatches what is
+ * pending, without idling.
+ * @return the number of callbacks run
+ */
+uint32_t hx_evloop_poll(hx_evloop *ev);
+
+/**
+ * Calls the idle hook if nothing is pending, with the time to the next
+ * delayed work. For loops of the app's own around hx_evloop_poll().
+ */
+void hx_evloop_idle(hx_evloop *ev);
+
+/** Dispatches and idles until hx_evloop_stop() */
+void hx_evloop_run(hx_evloop *ev);
+
+/** Makes hx_evloop_run() return, from an ISR or a callback */
+void hx_evloop_stop(hx_evloop *ev);
+
+/** Loop time in microseconds */
+uint64_t hx_evloop_now_us(hx_evloop *ev);
+
+void hx_evloop_stats_reset(hx_evloop *ev);
+
+/** Posts, latency and run time per event, idle time */
+void hx_evloop_report(hx_evloop *ev, void (*print)(const char *fmt, ...));
+
+#ifdef LIB_LPSCHED
+#include "hx_lpsched.h"
+/**
+ * Argument of hx_evloop_we2_pmu(): PMU power down through lpsched when no
+ * interrupt source but the delayed work can end the idle time.
+ */
+typedef struct hx_evloop_we2_pmu_cfg {
+    hx_lpsched *sched;
+    hx_lpsched_state deepest;
+} hx_evloop_we2_pmu_cfg;
+#endif
+
+/** WFI, with the CM55M timer as the wake-up for delayed work */
+void hx_evloop_we2_wfi(void *arg, uint32_t max_us);
+
+/**
+ * The state hx_lpsched_pick() gives for the gap to the delayed work,
+ * WFI without delayed work. The PD states warm boot. arg is a
+ * hx_evloop_we2_pmu_cfg, needs lpsched in LIB_SEL.
+ */
+void hx_evloop_we2_pmu(void *arg, uint32_t max_us);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _LIB_HX_EVLOOP_H_ */
@@ -0,0 +1,127 @@
+/*
+ * hx_evloop_hxevent.c
+ *
+ * hxevent.h on hx_evloop: event_handler.c and the evt_* ISRs run on it as
+ * they are. The idle callback is called whenever the loop has nothing to
+ * do, before the idle hook of the port.
+ */
+#include <string.h>
+#include "hx_evloop_hxevent.h"
+
+#ifndef HX_EVLOOP_HXEVENT_PORT
+#define HX_EVLOOP_HXEVENT_PORT  hx_evloop_we2_port
+#endif
+extern const hx_evloop_port HX_EVLOOP_HXEVENT_PORT;
+
+typedef struct compat_event {
+    hx_event_cbfunc_t fn;
+    uint16_t backlog;       /* activations not called back yet */
+    uint8_t coalesce;
+    uint8_t again;          /* the next dispatch counts our own re-post */
+} compat_event;
+
+static hx_evloop compat_loop;
+static compat_event compat[HX_EVENTQUE_MAXSIZE];
+static hx_idle_cbfunc_t compat_idle;
+
+static int compat_cb(void *arg, uint32_t posts)
+{
+    compat_event *c = (compat_event *)arg;
+    uint32_t backlog;
+
+    if (c->again)
+        posts--;
+    backlog = c->coalesce ? 1 : c->backlog + posts;
+    if (backlog > UINT16_MAX)
+        backlog = UINT16_MAX;
+    if (backlog == 0)
+        backlog = 1;
+    /* HX_EVENT_RETURN_NULL and HX_EVENT_RETURN_DONE both end the activation */
+    if (c->fn)
+        c->fn();
+    c->backlog = (uint16_t)(backlog - 1);
+    c->again = c->backlog != 0;
+    return c->again ? HX_EVLOOP_AGAIN : HX_EVLOOP_DONE;
+}
+
+void hx_event_init()
+{
+    memset(compat, 0, sizeof(compat));
+    compat_idle = NULL;
+    hx_evloop_init(&compat_loop, &HX_EVLOOP_HXEVENT_PORT);
+}
+
+void hx_event_create(hx_event_t *event)
+{
+    int id = hx_evloop_create(&compat_loop, NULL, HX_EVENT_DEFAULT_PRIORITY, compat_cb, NULL);
+
+    if (id == HX_EVLOOP_NONE || id >= HX_EVENTQUE_MAXSIZE)
+    {
+        *event = HX_EVENTQUE_MAXSIZE;
+        return;
+    }
+    memset(&compat[id], 0, sizeof(compat[id]));
+    hx_evloop_set_callback(&compat_loop, id, compat_cb, &compat[id]);
+    *event = (hx_event_t)id;
+}
+
+void hx_event_set_priority(hx_event_t event, uint8_t prio)
+{
+    hx_evloop_set_priority(&compat_loop, event, prio);
+}
+
+void hx_event_set_callback(hx_event_t event, hx_event_cbfunc_t fct)
+{
+    if (event < HX_EVENTQUE_MAXSIZE)
+        compat[event].fn = fct;
+}
+
+void hx_eventloop_start()
+{
+    compat_loop.stop = 0;
+    while (!compat_loop.stop)
+    {
+        if (hx_evloop_poll(&compat_loop))
+            continue;
+        if (compat_idle)
+            compat_idle();
+        hx_evloop_idle(&compat_loop);
+    }
+}
+
+void hx_eventloop_stop()
+{
+    hx_evloop_stop(&compat_loop);
+}
+
+void hx_event_activate_ISR(hx_event_t event)
+{
+    hx_evloop_post(&compat_loop, event);
+}
+
+void hx_event_set_idlecb(hx_idle_cbfunc_t fct)
+{
+    compat_idle = fct;
+}
+
+void hx_event_set_cycle_cnt()
+{
+    hx_evloop_stats_reset(&compat_loop);
+}
+
+hx_evloop *hx_event_loop(void)
+{
+    return &compat_loop;
+}
+
+void hx_event_set_coalesce(hx_event_t event, int coalesce)
+{
+    if (event < HX_EVENTQUE_MAXSIZE)
+        compat[event].coalesce = coalesce != 0;
+}
+
+void hx_event_set_name(hx_event_t event, const char *name)
+{
+    if (event < compat_loop.num_events)
+        compat_loop.event[event].name = name;
+}
@@ -0,0 +1,32 @@
+#ifndef _LIB_HX_EVLOOP_HXEVENT_H_
+#define _LIB_HX_EVLOOP_HXEVENT_H_
+/*
+ * What hxevent.h does not have, for apps that run the hxevent API on
+ * hx_evloop (hx_evloop_hxevent.c).
+ *
+ * hxevent events are activated once per hx_event_activate_ISR(): posts
+ * coalesced by the loop run the callback as many times, one per dispatch,
+ * events of higher priority in between. hx_event_set_coalesce() makes one
+ * callback serve all of them.
+ */
+#include "hxevent.h"
+#include "hx_evloop.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/** The loop behind hxevent.h, for hx_evloop_report() or hx_evloop_set_idle() */
+hx_evloop *hx_event_loop(void);
+
+void hx_event_set_coalesce(hx_event_t event, int coalesce);
+
+/** Name in hx_evloop_report() */
+void hx_event_set_name(hx_event_t event, const char *name);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _LIB_HX_EVLOOP_HXEVENT_H_ */
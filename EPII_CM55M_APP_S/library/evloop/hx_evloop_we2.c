@@ -0,0 +1,127 @@
+/*
+ * hx_evloop_we2.c
+ *
+ * hx_evloop_port of the WE2: SysTick clock in core clock ticks, PRIMASK
+ * for the critical sections, WFI with CM55M timer 2 as the wake-up for
+ * delayed work.
+ */
+#include "WE2_device.h"
+#include "WE2_core.h"
+#include "hx_drv_timer.h"
+#include "hx_evloop.h"
+
+#define WE2_SYSTICK_PERIOD  (SysTick_LOAD_RELOAD_Msk + 1)
+
+static uint32_t we2_base;       /* ticks slept without SysTick */
+static volatile uint8_t we2_timer_fired;
+
+static uint32_t we2_now(void)
+{
+    uint32_t tick, loop, tick2, loop2;
+
+    /* SysTick counts down; a wrap between the two reads, read again */
+    do {
+        SystemGetTick(&tick, &loop);
+        SystemGetTick(&tick2, &loop2);
+    } while (loop != loop2 || tick2 > tick);
+
+    /* the period is 2^24, the product wraps with the counter */
+    return loop * WE2_SYSTICK_PERIOD + (WE2_SYSTICK_PERIOD - 1 - tick) + we2_base;
+}
+
+static uint32_t we2_ticks_per_us(void)
+{
+    uint32_t clk;
+
+    EPII_Get_Systemclock(&clk);
+    return clk / 1000000;
+}
+
+static uint32_t we2_irq_save(void)
+{
+    uint32_t primask = __get_PRIMASK();
+
+    __disable_irq();
+    return primask;
+}
+
+static void we2_irq_restore(uint32_t state)
+{
+    __set_PRIMASK(state);
+}
+
+static void we2_timer_cb(uint32_t event)
+{
+    we2_timer_fired = 1;
+}
+
+void hx_evloop_we2_wfi(void *arg, uint32_t max_us)
+{
+    TIMER_CFG_T timer_cfg;
+    uint32_t ms = 0, before = 0, slept, tpu;
+
+    (void)arg;
+    if (max_us != HX_EVLOOP_FOREVER)
+    {
+        ms = max_us / 1000;
+        /* below the timer resolution, the loop spins to the deadline */
+        if (ms == 0)
+            return;
+        /* the SysTick check below is in 32-bit ticks */
+        if (ms > 1000)
+            ms = 1000;
+        timer_cfg.period = ms;
+        timer_cfg.mode = TIMER_MODE_ONESHOT;
+        timer_cfg.ctrl = TIMER_CTRL_CPU;
+        timer_cfg.state = TIMER_STATE_DC;
+        we2_timer_fired = 0;
+        before = we2_now();
+        hx_drv_timer_cm55m_start(&timer_cfg, we2_timer_cb);
+    }
+
+    /* with PRIMASK set a pending interrupt still ends __WFI(), then the
+     * interrupt that woke the CPU is taken and may post */
+    __WFI();
+    __enable_irq();
+    __disable_irq();
+
+    if (ms == 0)
+        return;
+    if (!we2_timer_fired)
+    {
+        hx_drv_timer_cm55m_stop();
+        return;
+    }
+    /* in case SysTick stopped with the core clock */
+    tpu = we2_ticks_per_us();
+    slept = we2_now() - before;
+    if (slept < ms * 1000 * tpu)
+        we2_base += ms * 1000 * tpu - slept;
+}
+
+void hx_evloop_we2_pmu(void *arg, uint32_t max_us)
+{
+#ifdef LIB_LPSCHED
+    hx_evloop_we2_pmu_cfg *cfg = (hx_evloop_we2_pmu_cfg *)arg;
+    hx_lpsched_state state = HX_LPSCHED_WFI;
+
+    if (max_us != HX_EVLOOP_FOREVER)
+        state = hx_lpsched_pick(cfg->sched, max_us, cfg->deepest);
+    if (state == HX_LPSCHED_ACTIVE)
+        return;
+    if (state != HX_LPSCHED_WFI)
+    {
+        /* does not return, the wake-up is a warm boot */
+        cfg->sched->port->sleep(state, max_us);
+    }
+#endif
+    hx_evloop_we2_wfi(NULL, max_us);
+}
+
+const hx_evloop_port hx_evloop_we2_port = {
+    we2_now,
+    we2_ticks_per_us,
+    we2_irq_save,
+    we2_irq_restore,
+    hx_evloop_we2_wfi,
+};
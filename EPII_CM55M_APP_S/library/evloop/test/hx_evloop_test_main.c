@@ -0,0 +1,503 @@
+/*
+ * Host unit tests of hx_evloop.
+ *
+ *   hx_evloop_test
+ *
+ * The loop runs on a fake port: the clock only moves when a test or a
+ * callback moves it, 4 ticks per microsecond, and starts close to the
+ * 32-bit wrap. The idle hook checks that it is called with interrupts
+ * masked, moves the clock to the wake-up and raises the fake interrupt
+ * the test planned, which runs when the loop unmasks, as on the chip.
+ *
+ * Checked: dispatch order by priority then creation, re-ranking of pending
+ * events, coalesced posts, HX_EVLOOP_AGAIN behind higher priorities, work
+ * queue batches, delayed work order and idle time-outs across the clock
+ * wrap, cancel, the latency and run time histograms, and hxevent.h on the
+ * loop (activations, priorities, coalescing, idle callback, stop, the
+ * HX_EVENTQUE_MAXSIZE limit).
+ */
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include "hx_evloop.h"
+#include "hx_evloop_hxevent.h"
+
+#define TPU 4
+
+static int failures;
+
+#define CHECK(c) do { if (!(c)) { printf("%s:%d: %s\n", __FILE__, __LINE__, #c); failures++; } } while (0)
+
+/*
+ * Fake port
+ */
+static uint32_t fake_tick = 0xFFFFFFFFu - 25000 * TPU;
+static uint32_t fake_masked;
+static void (*fake_irq)(void);      /* raised, runs when unmasked */
+static void (*fake_plan)(void);     /* raised after fake_plan_us idle */
+static uint32_t fake_plan_us;
+static uint32_t idle_calls;
+static uint32_t idle_unmasked;
+static uint32_t last_max_us;
+
+static void advance_us(uint32_t us)
+{
+    fake_tick += us * TPU;
+}
+
+static uint32_t fake_now(void)
+{
+    return fake_tick;
+}
+
+static uint32_t fake_ticks_per_us(void)
+{
+    return TPU;
+}
+
+static uint32_t fake_irq_save(void)
+{
+    uint32_t state = fake_masked;
+
+    fake_masked = 1;
+    return state;
+}
+
+static void fake_irq_restore(uint32_t state)
+{
+    void (*irq)(void) = fake_irq;
+
+    fake_masked = state;
+    if (!fake_masked && irq)
+    {
+        fake_irq = NULL;
+        irq();
+    }
+}
+
+static void fake_idle(void *arg, uint32_t max_us)
+{
+    idle_calls++;
+    if (!fake_masked)
+        idle_unmasked++;
+    last_max_us = max_us;
+    if (fake_plan && fake_plan_us < max_us)
+    {
+        advance_us(fake_plan_us);
+        fake_irq = fake_plan;
+        fake_plan = NULL;
+        return;
+    }
+    /* only the time-out ends the sleep */
+    if (max_us != HX_EVLOOP_FOREVER)
+        advance_us(max_us);
+}
+
+const hx_evloop_port test_port = {
+    fake_now,
+    fake_ticks_per_us,
+    fake_irq_save,
+    fake_irq_restore,
+    fake_idle,
+};
+
+/*
+ * Test events
+ */
+static hx_evloop loop;
+static char trace[64];
+static int trace_len;
+static uint32_t last_posts;
+
+static void trace_add(char c)
+{
+    if (trace_len < (int)sizeof(trace) - 1)
+        trace[trace_len++] = c;
+    trace[trace_len] = 0;
+}
+
+static void trace_reset(void)
+{
+    trace_len = 0;
+    trace[0] = 0;
+}
+
+static int trace_cb(void *arg, uint32_t posts)
+{
+    trace_add(*(const char *)arg);
+    last_posts = posts;
+    return HX_EVLOOP_DONE;
+}
+
+static void test_priority(void)
+{
+    int a, b, c, d;
+
+    hx_evloop_init(&loop, &test_port);
+    a = hx_evloop_create(&loop, "a", 10, trace_cb, "a");
+    b = hx_evloop_create(&loop, "b", 0, trace_cb, "b");
+    c = hx_evloop_create(&loop, "c", 10, trace_cb, "c");
+    d = hx_evloop_create(&loop, "d", 200, trace_cb, "d");
+    CHECK(a == 0 && b == 1 && c == 2 && d == 3);
+
+    trace_reset();
+    hx_evloop_post(&loop, d);
+    hx_evloop_post(&loop, c);
+    hx_evloop_post(&loop, a);
+    hx_evloop_post(&loop, b);
+    CHECK(hx_evloop_poll(&loop) == 4);
+    CHECK(strcmp(trace, "bacd") == 0);
+
+    /* pending events keep their post through a re-rank */
+    trace_reset();
+    hx_evloop_post(&loop, d);
+    hx_evloop_post(&loop, a);
+    hx_evloop_set_priority(&loop, d, 0);
+    hx_evloop_post(&loop, b);
+    CHECK(hx_evloop_poll(&loop) == 3);
+    CHECK(strcmp(trace, "bda") == 0);
+
+    CHECK(hx_evloop_poll(&loop) == 0);
+    hx_evloop_post(&loop, -1);
+    hx_evloop_post(&loop, 4);
+    CHECK(hx_evloop_poll(&loop) == 0);
+}
+
+static void test_coalesce(void)
+{
+    int a;
+
+    hx_evloop_init(&loop, &test_port);
+    a = hx_evloop_create(&loop, "a", 0, trace_cb, "a");
+    trace_reset();
+    hx_evloop_post(&loop, a);
+    hx_evloop_post(&loop, a);
+    hx_evloop_post(&loop, a);
+    CHECK(hx_evloop_poll(&loop) == 1);
+    CHECK(strcmp(trace, "a") == 0);
+    CHECK(last_posts == 3);
+#if HX_EVLOOP_STATS
+    CHECK(loop.event[a].stats.posts == 3);
+    CHECK(loop.event[a].stats.coalesced == 2);
+    CHECK(loop.event[a].stats.runs == 1);
+#endif
+}
+
+static int again_left;
+static int hi_event;
+
+static int again_cb(void *arg, uint32_t posts)
+{
+    trace_add('x');
+    if (again_left == 2)
+        hx_evloop_post(&loop, hi_event);
+    return again_left-- > 0 ? HX_EVLOOP_AGAIN : HX_EVLOOP_DONE;
+}
+
+static void test_again(void)
+{
+    int x, lo;
+
+    hx_evloop_init(&loop, &test_port);
+    hi_event = hx_evloop_create(&loop, "hi", 0, trace_cb, "h");
+    x = hx_evloop_create(&loop, "x", 50, again_cb, NULL);
+    lo = hx_evloop_create(&loop, "lo", 100, trace_cb, "l");
+    again_left = 2;
+    trace_reset();
+    hx_evloop_post(&loop, lo);
+    hx_evloop_post(&loop, x);
+    CHECK(hx_evloop_poll(&loop) == 5);
+    CHECK(strcmp(trace, "xhxxl") == 0);
+}
+
+/*
+ * Work queues
+ */
+static hx_evloop_queue queue;
+static hx_evloop_work work[6];
+
+static void work_fn(void *arg)
+{
+    char c = *(const char *)arg;
+
+    trace_add(c);
+    if (c == '1')
+        hx_evloop_post(&loop, hi_event);
+}
+
+static void test_queue(void)
+{
+    static const char *names = "123456";
+    int i, ev;
+
+    hx_evloop_init(&loop, &test_port);
+    hi_event = hx_evloop_create(&loop, "hi", 0, trace_cb, "h");
+    ev = hx_evloop_queue_init(&loop, &queue, "q", 100, 2);
+    CHECK(ev == 1);
+    for (i = 0; i < 6; i++)
+        hx_evloop_work_init(&work[i], work_fn, (void *)&names[i]);
+
+    trace_reset();
+    for (i = 0; i < 5; i++)
+        CHECK(hx_evloop_defer(&queue, &work[i]) == 0);
+    CHECK(hx_evloop_defer(&queue, &work[2]) == -1);
+    CHECK(queue.depth == 5);
+    CHECK(hx_evloop_cancel(&work[3]) == 0);
+    CHECK(hx_evloop_cancel(&work[3]) == -1);
+    CHECK(queue.depth == 4);
+    /* batches of 2, the event posted by item 1 runs after the first one */
+    CHECK(hx_evloop_poll(&loop) == 3);
+    CHECK(strcmp(trace, "12h35") == 0);
+    CHECK(queue.runs == 2);
+    CHECK(queue.max_depth == 5);
+    CHECK(queue.depth == 0 && queue.head == NULL && queue.tail == NULL);
+
+    /* done work can be queued again */
+    trace_reset();
+    CHECK(hx_evloop_defer(&queue, &work[0]) == 0);
+    CHECK(hx_evloop_poll(&loop) == 2);
+    CHECK(strcmp(trace, "1h") == 0);
+}
+
+static void test_delayed(void)
+{
+    uint64_t start;
+    int i;
+
+    hx_evloop_init(&loop, &test_port);
+    hi_event = hx_evloop_create(&loop, "hi", 0, trace_cb, "h");
+    hx_evloop_queue_init(&loop, &queue, "q", 100, 4);
+    for (i = 0; i < 6; i++)
+        hx_evloop_work_init(&work[i], work_fn, (void *)&"123456"[i]);
+
+    start = hx_evloop_now_us(&loop);
+    trace_reset();
+    CHECK(hx_evloop_defer_delayed(&queue, &work[2], 30000) == 0);
+    CHECK(hx_evloop_defer_delayed(&queue, &work[1], 20000) == 0);
+    CHECK(hx_evloop_defer_delayed(&queue, &work[3], 20000) == 0);
+    CHECK(hx_evloop_defer_delayed(&queue, &work[4], 90000) == 0);
+    CHECK(hx_evloop_defer_delayed(&queue, &work[1], 10) == -1);
+    CHECK(hx_evloop_defer(&queue, &work[1]) == -1);
+    CHECK(hx_evloop_cancel(&work[4]) == 0);
+    CHECK(hx_evloop_poll(&loop) == 0);
+
+    /* the idle hook sleeps to the first due work, across the tick wrap */
+    idle_calls = 0;
+    idle_unmasked = 0;
+    hx_evloop_idle(&loop);
+    CHECK(idle_calls == 1 && idle_unmasked == 0);
+    CHECK(last_max_us == 20000);
+    CHECK(hx_evloop_poll(&loop) == 1);
+    CHECK(strcmp(trace, "24") == 0);
+    hx_evloop_idle(&loop);
+    CHECK(last_max_us == 10000);
+    CHECK(hx_evloop_poll(&loop) == 1);
+    CHECK(strcmp(trace, "243") == 0);
+    CHECK(hx_evloop_now_us(&loop) - start == 30000);
+
+    /* nothing delayed, sleep until an interrupt */
+    hx_evloop_idle(&loop);
+    CHECK(last_max_us == HX_EVLOOP_FOREVER);
+    CHECK(loop.delayed == NULL);
+    CHECK(idle_calls == 3);
+}
+
+/*
+ * run() with interrupts raised while idle
+ */
+static int isr_event;
+static int isr_count;
+
+static void fake_isr(void)
+{
+    hx_evloop_post(&loop, isr_event);
+    if (++isr_count < 3)
+    {
+        fake_plan = fake_isr;
+        fake_plan_us = 1000;
+    }
+}
+
+static int isr_cb(void *arg, uint32_t posts)
+{
+    trace_add('i');
+    /* 5 us run time, 20 us in the third run */
+    advance_us(isr_count == 3 ? 20 : 5);
+    if (isr_count == 3)
+        hx_evloop_stop(&loop);
+    return HX_EVLOOP_DONE;
+}
+
+static void test_run_stats(void)
+{
+    hx_evloop_init(&loop, &test_port);
+    isr_event = hx_evloop_create(&loop, "isr", 0, isr_cb, NULL);
+    isr_count = 0;
+    idle_calls = 0;
+    trace_reset();
+    fake_plan = fake_isr;
+    fake_plan_us = 1000;
+    hx_evloop_run(&loop);
+    CHECK(strcmp(trace, "iii") == 0);
+    CHECK(idle_calls == 3);
+    CHECK(idle_unmasked == 0);
+    CHECK(loop.idle_entries == 3);
+    CHECK(loop.idle_ticks == 3000 * TPU);
+#if HX_EVLOOP_STATS
+    int i;
+
+    /* posted as the loop unmasked, no latency; runs in [4,8) and [16,32) us */
+    CHECK(loop.event[isr_event].stats.lat_hist[0] == 3);
+    CHECK(loop.event[isr_event].stats.run_hist[3] == 2);
+    CHECK(loop.event[isr_event].stats.run_hist[5] == 1);
+    CHECK(loop.event[isr_event].stats.run_max_us == 20);
+    CHECK(loop.event[isr_event].stats.run_us == 30);
+
+    /* latency: posted 100 us before the dispatch, [64,128) */
+    hx_evloop_stats_reset(&loop);
+    hx_evloop_post(&loop, isr_event);
+    advance_us(100);
+    hx_evloop_poll(&loop);
+    CHECK(loop.event[isr_event].stats.lat_hist[7] == 1);
+    CHECK(loop.event[isr_event].stats.lat_max_us == 100);
+    /* the last bin is open */
+    hx_evloop_post(&loop, isr_event);
+    advance_us(1000000);
+    hx_evloop_poll(&loop);
+    CHECK(loop.event[isr_event].stats.lat_hist[HX_EVLOOP_HIST_BINS - 1] == 1);
+    for (i = 0; i < HX_EVLOOP_HIST_BINS; i++)
+        CHECK(i == 7 || i == HX_EVLOOP_HIST_BINS - 1 || loop.event[isr_event].stats.lat_hist[i] == 0);
+#endif
+}
+
+static void test_full(void)
+{
+    int i;
+
+    hx_evloop_init(&loop, &test_port);
+    for (i = 0; i < HX_EVLOOP_MAX_EVENTS; i++)
+        CHECK(hx_evloop_create(&loop, NULL, (uint8_t)(255 - i), trace_cb, "z") == i);
+    CHECK(hx_evloop_create(&loop, NULL, 0, trace_cb, "z") == HX_EVLOOP_NONE);
+    /* the last one created has the highest priority */
+    hx_evloop_post(&loop, 0);
+    hx_evloop_post(&loop, HX_EVLOOP_MAX_EVENTS - 1);
+    CHECK(loop.order[0] == HX_EVLOOP_MAX_EVENTS - 1);
+    CHECK(loop.pending == ((uint64_t)1 | ((uint64_t)1 << 63)));
+    CHECK(hx_evloop_poll(&loop) == 2);
+}
+
+/*
+ * hxevent.h on the loop
+ */
+static hx_event_t ev_lo, ev_hi;
+static int lo_calls, idle_cb_calls;
+
+static uint8_t lo_cb()
+{
+    trace_add('l');
+    if (++lo_calls == 1)
+        hx_event_activate_ISR(ev_hi);
+    return HX_EVENT_RETURN_DONE;
+}
+
+static uint8_t hi_cb()
+{
+    trace_add('h');
+    return HX_EVENT_RETURN_NULL;
+}
+
+static void legacy_idle()
+{
+    idle_cb_calls++;
+    trace_add('.');
+    if (idle_cb_calls == 2)
+        hx_eventloop_stop();
+    else
+        hx_event_activate_ISR(ev_lo);
+}
+
+static void test_hxevent(void)
+{
+    hx_event_t ev;
+    int i;
+
+    hx_event_init();
+    hx_event_create(&ev_lo);
+    hx_event_create(&ev_hi);
+    CHECK(ev_lo == 0 && ev_hi == 1);
+    hx_event_set_callback(ev_lo, lo_cb);
+    hx_event_set_callback(ev_hi, hi_cb);
+    hx_event_set_priority(ev_lo, 64);
+    hx_event_set_priority(ev_hi, 0);
+    hx_event_set_idlecb(legacy_idle);
+    hx_event_set_name(ev_lo, "lo");
+
+    /* one callback per activation, the one activated meanwhile in between */
+    trace_reset();
+    lo_calls = 0;
+    idle_cb_calls = 0;
+    hx_event_activate_ISR(ev_lo);
+    hx_event_activate_ISR(ev_lo);
+    hx_event_activate_ISR(ev_lo);
+    hx_eventloop_start();
+    CHECK(strcmp(trace, "lhll.l.") == 0);
+    CHECK(lo_calls == 4);
+    CHECK(idle_cb_calls == 2);
+
+    /* coalesced, one callback */
+    trace_reset();
+    hx_event_set_coalesce(ev_lo, 1);
+    hx_event_activate_ISR(ev_lo);
+    hx_event_activate_ISR(ev_lo);
+    hx_evloop_poll(hx_event_loop());
+    CHECK(strcmp(trace, "l") == 0);
+
+    hx_event_set_cycle_cnt();
+#if HX_EVLOOP_STATS
+    CHECK(hx_event_loop()->event[ev_lo].stats.posts == 0);
+#endif
+    CHECK(strcmp(hx_event_loop()->event[ev_lo].name, "lo") == 0);
+
+    for (i = 2; i < HX_EVENTQUE_MAXSIZE; i++)
+    {
+        hx_event_create(&ev);
+        CHECK(ev == i);
+    }
+    hx_event_create(&ev);
+    CHECK(ev == HX_EVENTQUE_MAXSIZE);
+}
+
+static void print(const char *fmt, ...)
+{
+    va_list ap;
+
+    va_start(ap, fmt);
+    vprintf(fmt, ap);
+    va_end(ap);
+}
+
+int main(void)
+{
+    test_priority();
+    test_coalesce();
+    test_again();
+    test_queue();
+    test_delayed();
+    test_run_stats();
+    test_full();
+    test_hxevent();
+
+    if (failures == 0)
+    {
+        /* the report of the last run, for a look at its format */
+        hx_evloop_init(&loop, &test_port);
+        isr_event = hx_evloop_create(&loop, "isr", 0, isr_cb, NULL);
+        isr_count = 0;
+        fake_plan = fake_isr;
+        fake_plan_us = 1000;
+        hx_evloop_run(&loop);
+        hx_evloop_report(&loop, print);
+    }
+    printf(failures ? "FAILED\n" : "PASSED\n");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,345 @@
+#include <string.h>
+#include "hx_img_preproc.h"
+
+#if defined(__ARM_FEATURE_MVE) && (__ARM_FEATURE_MVE & 1)
+#include <arm_mve.h>
+#define HX_IMG_PREPROC_HELIUM 1
+#endif
+
+#define FRAC_ONE (1 << HX_IMG_PREPROC_FRAC_BITS)
+
+static int round8(int n)
+{
+    return (n + 7) & ~7;
+}
+
+static int preproc_planes(hx_img_preproc_fmt fmt)
+{
+    return (fmt == HX_IMG_PREPROC_Y8_TO_Y8 || fmt == HX_IMG_PREPROC_Y8_TO_YYY24) ? 1 : 3;
+}
+
+static int preproc_out_channels(hx_img_preproc_fmt fmt)
+{
+    return (fmt == HX_IMG_PREPROC_BGR8U3C_TO_RGB24 || fmt == HX_IMG_PREPROC_Y8_TO_YYY24) ? 3 : 1;
+}
+
+/* Q16 frame position of grid sample i, align-corners; negative left of the frame */
+static int64_t preproc_pos(int src, int src_len, int i, int grid)
+{
+    int64_t pos = (int64_t)src * 65536;
+
+    if (grid > 1)
+        pos += ((int64_t)i * (src_len - 1) * 65536) / (grid - 1);
+    return pos;
+}
+
+/* Integer part of a Q16 position, rounded down */
+static int preproc_floor(int64_t pos)
+{
+    return (int)((pos - (pos & 0xffff)) / 65536);
+}
+
+/* First frame column and width of the row buffer that the output reads */
+static void preproc_row_span(const hx_img_preproc_roi *roi, int out_w, int *col0, int *row_w)
+{
+    int first = preproc_floor(preproc_pos(roi->src.x, roi->src.w, roi->out_x, roi->grid_w));
+    int last = preproc_floor(preproc_pos(roi->src.x, roi->src.w, roi->out_x + out_w - 1, roi->grid_w));
+
+    *col0 = first;
+    *row_w = last + 2 - first;
+}
+
+static int preproc_roi_ok(const hx_img_preproc_roi *roi, int out_w, int out_h)
+{
+    return roi->src.w >= 1 && roi->src.h >= 1 && roi->src.w <= 0xffff && roi->src.h <= 0xffff &&
+           roi->grid_w >= 1 && roi->grid_h >= 1 && roi->out_x >= 0 && roi->out_y >= 0 &&
+           out_w >= 1 && out_h >= 1 && out_w <= 0xffff && out_h <= 0xffff;
+}
+
+size_t hx_img_preproc_roi_work_size(hx_img_preproc_fmt fmt, const hx_img_preproc_roi *roi, int out_w)
+{
+    int col0;
+    int row_w;
+
+    if (!preproc_roi_ok(roi, out_w, 1))
+        return 0;
+    preproc_row_span(roi, out_w, &col0, &row_w);
+    return (size_t)2 * (3 * (size_t)round8(out_w) + (size_t)preproc_planes(fmt) * (size_t)round8(row_w));
+}
+
+int hx_img_preproc_init_roi(hx_img_preproc *p, hx_img_preproc_fmt fmt, int in_w, int in_h,
+                            const hx_img_preproc_roi *roi, int out_w, int out_h, void *work, size_t work_size)
+{
+    int planes = preproc_planes(fmt);
+    hx_img_preproc_rect *v;
+
+    memset(p, 0, sizeof(*p));
+    if (fmt > HX_IMG_PREPROC_Y8_TO_YYY24 || in_w < 1 || in_h < 1 || in_w > 0xffff || in_h > 0xffff ||
+        !preproc_roi_ok(roi, out_w, out_h) || work == NULL || ((uintptr_t)work & 3) != 0)
+        return -1;
+
+    preproc_row_span(roi, out_w, &p->col0, &p->row_w);
+    if (p->row_w > 0xffff || work_size < hx_img_preproc_roi_work_size(fmt, roi, out_w))
+        return -1;
+
+    p->fmt = fmt;
+    p->in_w = in_w;
+    p->in_h = in_h;
+    p->out_w = out_w;
+    p->out_h = out_h;
+    p->planes = planes;
+    p->roi = *roi;
+    hx_img_preproc_set_gray_weights(p, HX_IMG_PREPROC_GRAY_R, HX_IMG_PREPROC_GRAY_G, HX_IMG_PREPROC_GRAY_B);
+
+    /* clip the valid area to the frame; an empty area gives an all 0 output */
+    v = &p->roi.valid;
+    if (v->x < 0) {
+        v->w += v->x;
+        v->x = 0;
+    }
+    if (v->y < 0) {
+        v->h += v->y;
+        v->y = 0;
+    }
+    if (v->w > in_w - v->x)
+        v->w = in_w - v->x;
+    if (v->h > in_h - v->y)
+        v->h = in_h - v->y;
+    if (v->w < 0)
+        v->w = 0;
+    if (v->h < 0)
+        v->h = 0;
+
+    int out_w8 = round8(out_w);
+    p->x0 = (uint16_t *)work;
+    p->x1 = p->x0 + out_w8;
+    p->fx = (int16_t *)(p->x1 + out_w8);
+    p->row = p->fx + out_w8;
+
+    for (int x = 0; x < out_w8; x++) {
+        int64_t pos = preproc_pos(roi->src.x, roi->src.w, roi->out_x + x, roi->grid_w);
+        int x0 = preproc_floor(pos) - p->col0;
+
+        if (x >= out_w) {
+            x0 = 0;
+            pos = 0;
+        }
+        p->x0[x] = (uint16_t)x0;
+        p->x1[x] = (uint16_t)((x < out_w) ? x0 + 1 : x0);
+        p->fx[x] = (int16_t)((pos & 0xffff) >> 1);
+    }
+    /* columns outside the valid area are never written and stay 0 */
+    memset(p->row, 0, sizeof(int16_t) * (size_t)planes * (size_t)round8(p->row_w));
+    return 0;
+}
+
+int hx_img_preproc_init(hx_img_preproc *p, hx_img_preproc_fmt fmt, int in_w, int in_h, int out_w, int out_h,
+                        void *work, size_t work_size)
+{
+    hx_img_preproc_roi roi;
+
+    roi.src.x = 0;
+    roi.src.y = 0;
+    roi.src.w = in_w;
+    roi.src.h = in_h;
+    roi.valid = roi.src;
+    roi.grid_w = out_w;
+    roi.grid_h = out_h;
+    roi.out_x = 0;
+    roi.out_y = 0;
+    return hx_img_preproc_init_roi(p, fmt, in_w, in_h, &roi, out_w, out_h, work, work_size);
+}
+
+void hx_img_preproc_letterbox_roi(const hx_img_preproc_rect *box, int grid, hx_img_preproc_roi *roi)
+{
+    int side = (box->w > box->h) ? box->w : box->h;
+
+    roi->src.x = box->x - (side - box->w) / 2;
+    roi->src.y = box->y - (side - box->h) / 2;
+    roi->src.w = side;
+    roi->src.h = side;
+    roi->valid = *box;
+    roi->grid_w = grid;
+    roi->grid_h = grid;
+    roi->out_x = 0;
+    roi->out_y = 0;
+}
+
+void hx_img_preproc_set_gray_weights(hx_img_preproc *p, uint8_t r, uint8_t g, uint8_t b)
+{
+    p->gray_w[0] = r;
+    p->gray_w[1] = g;
+    p->gray_w[2] = b;
+}
+
+/*
+ * dst[x] = r0[x] * (1 - fy) + r1[x] * fy in Q7, a NULL row reads as 0.
+ * fy is Q15; the product is rounded like vqrdmulhq_s16.
+ */
+static void preproc_blend_span(int16_t *dst, const uint8_t *r0, const uint8_t *r1, int n, int fy)
+{
+#ifdef HX_IMG_PREPROC_HELIUM
+    for (int x = 0; x < n; x += 8) {
+        mve_pred16_t pred = vctp16q((uint32_t)(n - x));
+        int16x8_t a = vdupq_n_s16(0);
+        int16x8_t b = vdupq_n_s16(0);
+
+        if (r0 != NULL)
+            a = vshlq_n_s16(vreinterpretq_s16_u16(vldrbq_z_u16(r0 + x, pred)), HX_IMG_PREPROC_FRAC_BITS);
+        if (r1 != NULL)
+            b = vshlq_n_s16(vreinterpretq_s16_u16(vldrbq_z_u16(r1 + x, pred)), HX_IMG_PREPROC_FRAC_BITS);
+        int16x8_t v = vaddq_s16(a, vqrdmulhq_n_s16(vsubq_s16(b, a), (int16_t)fy));
+        vstrhq_p_s16(dst + x, v, pred);
+    }
+#else
+    for (int x = 0; x < n; x++) {
+        int a = (r0 != NULL) ? r0[x] << HX_IMG_PREPROC_FRAC_BITS : 0;
+        int b = (r1 != NULL) ? r1[x] << HX_IMG_PREPROC_FRAC_BITS : 0;
+        dst[x] = (int16_t)(a + ((2 * (b - a) * fy + (1 << 15)) >> 16));
+    }
+#endif
+}
+
+/* Blends frame rows y0 and y1 into the row buffer, for every plane */
+static void preproc_blend_rows(const hx_img_preproc *p, const uint8_t *in, int y0, int y1, int fy)
+{
+    const hx_img_preproc_rect *v = &p->roi.valid;
+    size_t plane_size = (size_t)p->in_w * (size_t)p->in_h;
+    int row_w8 = round8(p->row_w);
+    int j0 = v->x - p->col0;
+    int j1 = v->x + v->w - p->col0;
+    int in0 = (y0 >= v->y && y0 < v->y + v->h);
+    int in1 = (y1 >= v->y && y1 < v->y + v->h);
+
+    /* row buffer columns holding valid frame pixels */
+    if (j0 < 0)
+        j0 = 0;
+    if (j1 > p->row_w)
+        j1 = p->row_w;
+    if (j1 <= j0)
+        return;
+
+    for (int c = 0; c < p->planes; c++) {
+        const uint8_t *base = in + plane_size * c + (size_t)(p->col0 + j0);
+        const uint8_t *r0 = in0 ? base + (size_t)y0 * p->in_w : NULL;
+        const uint8_t *r1 = in1 ? base + (size_t)y1 * p->in_w : NULL;
+
+        preproc_blend_span(p->row + row_w8 * c + j0, r0, r1, j1 - j0, fy);
+    }
+}
+
+#ifndef HX_IMG_PREPROC_HELIUM
+/* a + (b - a) * fx (Q15) rounded like vqrdmulhq_s16, then back to 8 bits */
+static int preproc_lerp(const int16_t *row, const hx_img_preproc *p, int x)
+{
+    int a = row[p->x0[x]];
+    int b = row[p->x1[x]];
+    int h = a + ((2 * (b - a) * p->fx[x] + (1 << 15)) >> 16);
+    return (h + (FRAC_ONE >> 1)) >> HX_IMG_PREPROC_FRAC_BITS;
+}
+#endif
+
+static void preproc_columns(const hx_img_preproc *p, int8_t *dst)
+{
+    int row_w8 = round8(p->row_w);
+
+#ifdef HX_IMG_PREPROC_HELIUM
+    const uint16x8_t rgb_offset = vmulq_n_u16(vidupq_n_u16(0, 1), 3);
+
+    for (int x = 0; x < p->out_w; x += 8) {
+        mve_pred16_t pred = vctp16q((uint32_t)(p->out_w - x));
+        uint16x8_t o0 = vldrhq_z_u16(p->x0 + x, pred);
+        uint16x8_t o1 = vldrhq_z_u16(p->x1 + x, pred);
+        int16x8_t f = vldrhq_z_s16(p->fx + x, pred);
+        int16x8_t pix[3];
+
+        for (int c = 0; c < p->planes; c++) {
+            const int16_t *row = p->row + row_w8 * c;
+            int16x8_t a = vldrhq_gather_shifted_offset_z_s16(row, o0, pred);
+            int16x8_t b = vldrhq_gather_shifted_offset_z_s16(row, o1, pred);
+            int16x8_t h = vaddq_s16(a, vqrdmulhq_s16(vsubq_s16(b, a), f));
+            pix[c] = vrshrq_n_s16(h, HX_IMG_PREPROC_FRAC_BITS);
+        }
+
+        switch (p->fmt) {
+        case HX_IMG_PREPROC_Y8_TO_Y8:
+            vstrbq_p_s16(dst + x, vsubq_n_s16(pix[0], 128), pred);
+            break;
+        case HX_IMG_PREPROC_Y8_TO_YYY24: {
+            int16x8_t y = vsubq_n_s16(pix[0], 128);
+            vstrbq_scatter_offset_p_s16(dst + 3 * x + 0, rgb_offset, y, pred);
+            vstrbq_scatter_offset_p_s16(dst + 3 * x + 1, rgb_offset, y, pred);
+            vstrbq_scatter_offset_p_s16(dst + 3 * x + 2, rgb_offset, y, pred);
+            break;
+        }
+        case HX_IMG_PREPROC_BGR8U3C_TO_RGB24:
+            /* planes are B, G, R */
+            vstrbq_scatter_offset_p_s16(dst + 3 * x + 0, rgb_offset, vsubq_n_s16(pix[2], 128), pred);
+            vstrbq_scatter_offset_p_s16(dst + 3 * x + 1, rgb_offset, vsubq_n_s16(pix[1], 128), pred);
+            vstrbq_scatter_offset_p_s16(dst + 3 * x + 2, rgb_offset, vsubq_n_s16(pix[0], 128), pred);
+            break;
+        default: {
+            uint16x8_t s = vmulq_n_u16(vreinterpretq_u16_s16(pix[2]), p->gray_w[0]);
+            s = vmlaq_n_u16(s, vreinterpretq_u16_s16(pix[1]), p->gray_w[1]);
+            s = vmlaq_n_u16(s, vreinterpretq_u16_s16(pix[0]), p->gray_w[2]);
+            s = vminq_u16(vrshrq_n_u16(s, HX_IMG_PREPROC_FRAC_BITS), vdupq_n_u16(255));
+            vstrbq_p_s16(dst + x, vsubq_n_s16(vreinterpretq_s16_u16(s), 128), pred);
+            break;
+        }
+        }
+    }
+#else
+    const int16_t *row_b = p->row;
+    const int16_t *row_g = p->row + row_w8;
+    const int16_t *row_r = p->row + 2 * row_w8;
+
+    for (int x = 0; x < p->out_w; x++) {
+        switch (p->fmt) {
+        case HX_IMG_PREPROC_Y8_TO_Y8:
+            dst[x] = (int8_t)(preproc_lerp(row_b, p, x) - 128);
+            break;
+        case HX_IMG_PREPROC_Y8_TO_YYY24:
+            dst[3 * x + 0] = (int8_t)(preproc_lerp(row_b, p, x) - 128);
+            dst[3 * x + 1] = dst[3 * x + 0];
+            dst[3 * x + 2] = dst[3 * x + 0];
+            break;
+        case HX_IMG_PREPROC_BGR8U3C_TO_RGB24:
+            dst[3 * x + 0] = (int8_t)(preproc_lerp(row_r, p, x) - 128);
+            dst[3 * x + 1] = (int8_t)(preproc_lerp(row_g, p, x) - 128);
+            dst[3 * x + 2] = (int8_t)(preproc_lerp(row_b, p, x) - 128);
+            break;
+        default: {
+            int s = preproc_lerp(row_r, p, x) * p->gray_w[0] + preproc_lerp(row_g, p, x) * p->gray_w[1] +
+                    preproc_lerp(row_b, p, x) * p->gray_w[2];
+            s = (s + (FRAC_ONE >> 1)) >> HX_IMG_PREPROC_FRAC_BITS;
+            dst[x] = (int8_t)((s > 255 ? 255 : s) - 128);
+            break;
+        }
+        }
+    }
+#endif
+}
+
+void hx_img_preproc_run_rows(const hx_img_preproc *p, const uint8_t *in, int8_t *out, int y_begin, int y_end)
+{
+    int out_c = preproc_out_channels(p->fmt);
+
+    if (y_begin < 0)
+        y_begin = 0;
+    if (y_end > p->out_h)
+        y_end = p->out_h;
+    for (int y = y_begin; y < y_end; y++) {
+        int64_t pos = preproc_pos(p->roi.src.y, p->roi.src.h, p->roi.out_y + y, p->roi.grid_h);
+        int y0 = preproc_floor(pos);
+        int fy = (int)((pos & 0xffff) >> 1);
+
+        /* rows outside the valid area read as 0, like columns */
+        preproc_blend_rows(p, in, y0, y0 + 1, fy);
+        preproc_columns(p, out + (size_t)y * p->out_w * out_c);
+    }
+}
+
+void hx_img_preproc_run(const hx_img_preproc *p, const uint8_t *in, int8_t *out)
+{
+    hx_img_preproc_run_rows(p, in, out, 0, p->out_h);
+}
@@ -0,0 +1,149 @@
+#ifndef _LIB_HX_IMG_PREPROC_H_
+#define _LIB_HX_IMG_PREPROC_H_
+/*
+ * Single pass camera frame to int8 input tensor preprocessing.
+ *
+ * Bilinear resize, channel reorder or gray conversion and the uint8 to
+ * int8 offset (pixel - 128) are done together, one output row at a time:
+ * the two source rows are blended vertically into a small int16 row
+ * buffer, then every output pixel of the row is interpolated from it and
+ * written straight to the tensor. No full size intermediate image is
+ * needed. Cortex-M55 uses Helium, 8 pixels per instruction.
+ *
+ * Usage:
+ *   static hx_img_preproc pre;
+ *   static int16_t work[HX_IMG_PREPROC_WORK_SIZE(640, 224, 3) / 2];
+ *   hx_img_preproc_init(&pre, HX_IMG_PREPROC_BGR8U3C_TO_RGB24, img_w, img_h,
+ *                       224, 224, work, sizeof(work));
+ *   hx_img_preproc_run(&pre, (const uint8_t *)raw_addr, input->data.int8);
+ *
+ * Sampling is align-corners like hx_lib_image_resize_helium() with
+ * w_scale = (input_w - 1) / (output_w - 1): output x maps to input
+ * x * w_scale. Weights have 15 fraction bits and the blended rows 7, so
+ * the result is within 1 of float bilinear.
+ *
+ * hx_img_preproc_init_roi() samples a region of the frame instead, e.g. a
+ * face box letterboxed to a square: the parts of the region outside the
+ * valid rectangle read as 0, as if the box had been cropped and padded
+ * into a buffer first.
+ */
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+typedef enum hx_img_preproc_fmt {
+    HX_IMG_PREPROC_Y8_TO_Y8 = 0,        /**< 1 plane in, 1 channel out */
+    HX_IMG_PREPROC_BGR8U3C_TO_RGB24,    /**< B, G, R planes in, interleaved R G B out */
+    HX_IMG_PREPROC_BGR8U3C_TO_GRAY,     /**< B, G, R planes in, weighted gray out */
+    HX_IMG_PREPROC_Y8_TO_YYY24,         /**< 1 plane in, copied to 3 interleaved channels */
+} hx_img_preproc_fmt;
+
+/** Fraction bits of the row buffer and of the gray weights */
+#define HX_IMG_PREPROC_FRAC_BITS 7
+
+/** Default gray weights in Q7 (0.299, 0.587, 0.114) */
+#define HX_IMG_PREPROC_GRAY_R 38
+#define HX_IMG_PREPROC_GRAY_G 75
+#define HX_IMG_PREPROC_GRAY_B 15
+
+/**
+ * Bytes of work memory for a source width (input width, or ROI width for
+ * hx_img_preproc_init_roi()), output width and plane count.
+ */
+#define HX_IMG_PREPROC_WORK_SIZE(src_w, out_w, planes) \
+    ((size_t)2 * (3 * ((((size_t)(out_w)) + 7) & ~(size_t)7) + (size_t)(planes) * ((((size_t)(src_w)) + 8) & ~(size_t)7)))
+
+typedef struct hx_img_preproc_rect {
+    int x;
+    int y;
+    int w;
+    int h;
+} hx_img_preproc_rect;
+
+/**
+ * The src rectangle of the frame is resized to grid_w x grid_h samples
+ * (align-corners), and the output holds the samples from (out_x, out_y)
+ * on. Samples outside valid, or outside the frame, are 0.
+ */
+typedef struct hx_img_preproc_roi {
+    hx_img_preproc_rect src;    /**< may extend past the frame, e.g. letterbox padding */
+    hx_img_preproc_rect valid;  /**< frame area that is read */
+    int grid_w;
+    int grid_h;
+    int out_x;                  /**< >= 0; the output may run past the grid */
+    int out_y;
+} hx_img_preproc_roi;
+
+typedef struct hx_img_preproc {
+    hx_img_preproc_fmt fmt;
+    int in_w;
+    int in_h;
+    int out_w;
+    int out_h;
+    int planes;
+    hx_img_preproc_roi roi;     /**< valid is clipped to the frame */
+    int col0;               /**< frame column of row[0] */
+    int row_w;              /**< columns in the row buffer, per plane */
+    uint8_t gray_w[3];      /**< R, G, B gray weights, Q7 */
+    /* in work memory */
+    uint16_t *x0;           /**< left row buffer column of each output column */
+    uint16_t *x1;           /**< right row buffer column, x0 + 1 */
+    int16_t *fx;            /**< weight of x1, Q15 */
+    int16_t *row;           /**< vertically blended frame rows, Q7 */
+} hx_img_preproc;
+
+/**
+ * @brief Prepares the column tables for a whole frame to out_w x out_h.
+ * @param work at least HX_IMG_PREPROC_WORK_SIZE(in_w, out_w, planes)
+ *        bytes, 4 byte aligned; planes is 1 for HX_IMG_PREPROC_Y8_TO_Y8
+ *        and HX_IMG_PREPROC_Y8_TO_YYY24, 3 otherwise
+ * @return 0, or -1 if a size is out of range or work is too small
+ */
+int hx_img_preproc_init(hx_img_preproc *p, hx_img_preproc_fmt fmt, int in_w, int in_h, int out_w, int out_h,
+                        void *work, size_t work_size);
+
+/**
+ * @brief Prepares the column tables for a region of the frame.
+ * @param work at least hx_img_preproc_roi_work_size() bytes, which is at
+ *        most HX_IMG_PREPROC_WORK_SIZE(roi->src.w, out_w, planes) when
+ *        the output stays in the grid
+ * @return 0, or -1 if a size is out of range or work is too small
+ */
+int hx_img_preproc_init_roi(hx_img_preproc *p, hx_img_preproc_fmt fmt, int in_w, int in_h,
+                            const hx_img_preproc_roi *roi, int out_w, int out_h, void *work, size_t work_size);
+
+/** Work memory needed by hx_img_preproc_init_roi() */
+size_t hx_img_preproc_roi_work_size(hx_img_preproc_fmt fmt, const hx_img_preproc_roi *roi, int out_w);
+
+/**
+ * @brief Letterboxes box to a square of its longer side, centered like
+ *        hx_lib_pad_image() with (diff / 2, diff / 2 + diff % 2), and
+ *        fills roi to resize it to grid x grid with box as valid area.
+ */
+void hx_img_preproc_letterbox_roi(const hx_img_preproc_rect *box, int grid, hx_img_preproc_roi *roi);
+
+/**
+ * @brief Sets the Q7 weights of HX_IMG_PREPROC_BGR8U3C_TO_GRAY.
+ *        r + g + b must not be above 256; results above 255 saturate.
+ */
+void hx_img_preproc_set_gray_weights(hx_img_preproc *p, uint8_t r, uint8_t g, uint8_t b);
+
+/**
+ * @brief Writes output rows [y_begin, y_end) to out, which always points
+ *        at the start of the whole output image. Lets a caller process
+ *        a frame in strips, e.g. while the rest is still being captured.
+ */
+void hx_img_preproc_run_rows(const hx_img_preproc *p, const uint8_t *in, int8_t *out, int y_begin, int y_end);
+
+/** Writes the whole out_w x out_h output */
+void hx_img_preproc_run(const hx_img_preproc *p, const uint8_t *in, int8_t *out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,591 @@
+#ifndef _LIB_HX_IMG_PREPROC_TEST_H_
+#define _LIB_HX_IMG_PREPROC_TEST_H_
+/*
+ * Self test and benchmark of hx_img_preproc, shared by the host build
+ * (test/) and the firmware (include it in one app source file and call
+ * hx_img_preproc_test_run() with a tick counter and a camera frame).
+ *
+ * Every output byte of hx_img_preproc_run() must equal a per pixel
+ * reference written straight from the fixed point formula (no tables, no
+ * row buffer), so the Helium build is checked bit for bit against it.
+ * The reference itself is checked against float bilinear within 1 LSB.
+ */
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "hx_img_preproc.h"
+#ifdef LIB_IMG_PROC
+#include "img_proc_helium.h"
+#endif
+
+#ifndef HX_IMG_PREPROC_TEST_PRINTF
+#define HX_IMG_PREPROC_TEST_PRINTF printf
+#endif
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/** Returns a free running tick count, used for the benchmark only */
+typedef uint32_t (*hx_img_preproc_test_clock_fn)(void);
+
+#define HX_IMG_PREPROC_TEST_MAX_W 67
+#define HX_IMG_PREPROC_TEST_MAX_H 53
+
+static uint32_t hx_img_preproc_test_rng = 0x2468aceu;
+
+static inline uint32_t hx_img_preproc_test_rand(void)
+{
+    hx_img_preproc_test_rng = hx_img_preproc_test_rng * 1664525u + 1013904223u;
+    return hx_img_preproc_test_rng >> 8;
+}
+
+/* Sample i of a grid over [src, src + src_len - 1]: left index and Q15 weight of the right one */
+static inline void hx_img_preproc_test_map(int i, int src, int src_len, int grid, int *i0, int *f)
+{
+    int64_t pos = (int64_t)src * 65536;
+    if (grid > 1)
+        pos += (int64_t)i * (src_len - 1) * 65536 / (grid - 1);
+    *i0 = (int)(pos / 65536);
+    if (pos < (int64_t)*i0 * 65536)
+        (*i0)--;
+    *f = (int)((pos - (int64_t)*i0 * 65536) >> 1);
+}
+
+/* Frame pixel, 0 outside the valid area and outside the frame */
+static inline int hx_img_preproc_test_at(const uint8_t *plane, int in_w, int in_h, const hx_img_preproc_roi *roi,
+                                         int x, int y)
+{
+    const hx_img_preproc_rect *v = &roi->valid;
+    if (x < 0 || y < 0 || x >= in_w || y >= in_h || x < v->x || y < v->y || x >= v->x + v->w || y >= v->y + v->h)
+        return 0;
+    return plane[y * in_w + x];
+}
+
+/* a + (b - a) * f, f in Q15, rounded like vqrdmulhq_s16 */
+static inline int hx_img_preproc_test_lerp(int a, int b, int f)
+{
+    return a + ((2 * (b - a) * f + (1 << 15)) >> 16);
+}
+
+static inline void hx_img_preproc_test_full_roi(int in_w, int in_h, int out_w, int out_h, hx_img_preproc_roi *roi)
+{
+    roi->src.x = 0;
+    roi->src.y = 0;
+    roi->src.w = in_w;
+    roi->src.h = in_h;
+    roi->valid = roi->src;
+    roi->grid_w = out_w;
+    roi->grid_h = out_h;
+    roi->out_x = 0;
+    roi->out_y = 0;
+}
+
+/* Resized 8 bit value of one plane at output (x, y) */
+static inline int hx_img_preproc_test_ref_pixel(const uint8_t *plane, int in_w, int in_h,
+                                                const hx_img_preproc_roi *roi, int x, int y)
+{
+    int x0, fx, y0, fy;
+    hx_img_preproc_test_map(roi->out_x + x, roi->src.x, roi->src.w, roi->grid_w, &x0, &fx);
+    hx_img_preproc_test_map(roi->out_y + y, roi->src.y, roi->src.h, roi->grid_h, &y0, &fy);
+    /* vertical blend in Q7, then horizontal */
+    int a = hx_img_preproc_test_lerp(hx_img_preproc_test_at(plane, in_w, in_h, roi, x0, y0) * 128,
+                                     hx_img_preproc_test_at(plane, in_w, in_h, roi, x0, y0 + 1) * 128, fy);
+    int b = hx_img_preproc_test_lerp(hx_img_preproc_test_at(plane, in_w, in_h, roi, x0 + 1, y0) * 128,
+                                     hx_img_preproc_test_at(plane, in_w, in_h, roi, x0 + 1, y0 + 1) * 128, fy);
+    return (hx_img_preproc_test_lerp(a, b, fx) + 64) >> 7;
+}
+
+static inline float hx_img_preproc_test_float_pixel(const uint8_t *plane, int in_w, int in_h,
+                                                    const hx_img_preproc_roi *roi, int x, int y)
+{
+    double sx = roi->src.x, sy = roi->src.y;
+    if (roi->grid_w > 1)
+        sx += (double)(roi->out_x + x) * (roi->src.w - 1) / (roi->grid_w - 1);
+    if (roi->grid_h > 1)
+        sy += (double)(roi->out_y + y) * (roi->src.h - 1) / (roi->grid_h - 1);
+    int x0 = (int)floor(sx), y0 = (int)floor(sy);
+    float fx = (float)(sx - x0), fy = (float)(sy - y0);
+    float top = hx_img_preproc_test_at(plane, in_w, in_h, roi, x0, y0) * (1.0f - fx) +
+                hx_img_preproc_test_at(plane, in_w, in_h, roi, x0 + 1, y0) * fx;
+    float bot = hx_img_preproc_test_at(plane, in_w, in_h, roi, x0, y0 + 1) * (1.0f - fx) +
+                hx_img_preproc_test_at(plane, in_w, in_h, roi, x0 + 1, y0 + 1) * fx;
+    return top * (1.0f - fy) + bot * fy;
+}
+
+/* Reference output of any format, out_w * out_h * channels int8 */
+static inline void hx_img_preproc_test_reference(hx_img_preproc_fmt fmt, const uint8_t *in, int in_w, int in_h,
+                                                 const hx_img_preproc_roi *roi, int out_w, int out_h,
+                                                 const uint8_t gray_w[3], int8_t *out)
+{
+    const uint8_t *b = in;
+    const uint8_t *g = in + in_w * in_h;
+    const uint8_t *r = in + 2 * in_w * in_h;
+
+    for (int y = 0; y < out_h; y++) {
+        for (int x = 0; x < out_w; x++) {
+            int i = y * out_w + x;
+            if (fmt == HX_IMG_PREPROC_Y8_TO_Y8) {
+                out[i] = (int8_t)(hx_img_preproc_test_ref_pixel(b, in_w, in_h, roi, x, y) - 128);
+            } else if (fmt == HX_IMG_PREPROC_Y8_TO_YYY24) {
+                out[3 * i + 0] = (int8_t)(hx_img_preproc_test_ref_pixel(b, in_w, in_h, roi, x, y) - 128);
+                out[3 * i + 1] = out[3 * i + 0];
+                out[3 * i + 2] = out[3 * i + 0];
+            } else if (fmt == HX_IMG_PREPROC_BGR8U3C_TO_RGB24) {
+                out[3 * i + 0] = (int8_t)(hx_img_preproc_test_ref_pixel(r, in_w, in_h, roi, x, y) - 128);
+                out[3 * i + 1] = (int8_t)(hx_img_preproc_test_ref_pixel(g, in_w, in_h, roi, x, y) - 128);
+                out[3 * i + 2] = (int8_t)(hx_img_preproc_test_ref_pixel(b, in_w, in_h, roi, x, y) - 128);
+            } else {
+                int s = hx_img_preproc_test_ref_pixel(r, in_w, in_h, roi, x, y) * gray_w[0] +
+                        hx_img_preproc_test_ref_pixel(g, in_w, in_h, roi, x, y) * gray_w[1] +
+                        hx_img_preproc_test_ref_pixel(b, in_w, in_h, roi, x, y) * gray_w[2];
+                s = (s + 64) >> 7;
+                out[i] = (int8_t)((s > 255 ? 255 : s) - 128);
+            }
+        }
+    }
+}
+
+static inline int hx_img_preproc_test_planes(hx_img_preproc_fmt fmt)
+{
+    return (fmt == HX_IMG_PREPROC_Y8_TO_Y8 || fmt == HX_IMG_PREPROC_Y8_TO_YYY24) ? 1 : 3;
+}
+
+static inline int hx_img_preproc_test_channels(hx_img_preproc_fmt fmt)
+{
+    return (fmt == HX_IMG_PREPROC_BGR8U3C_TO_RGB24 || fmt == HX_IMG_PREPROC_Y8_TO_YYY24) ? 3 : 1;
+}
+
+/* uint8 planes to the int8 tensor layout of fmt, n pixels per plane */
+static inline void hx_img_preproc_test_convert(hx_img_preproc_fmt fmt, const uint8_t *u, int n,
+                                               const uint8_t gray_w[3], int8_t *out)
+{
+    for (int i = 0; i < n; i++) {
+        if (fmt == HX_IMG_PREPROC_Y8_TO_Y8) {
+            out[i] = (int8_t)(u[i] - 128);
+        } else if (fmt == HX_IMG_PREPROC_Y8_TO_YYY24) {
+            out[3 * i + 0] = (int8_t)(u[i] - 128);
+            out[3 * i + 1] = out[3 * i + 0];
+            out[3 * i + 2] = out[3 * i + 0];
+        } else if (fmt == HX_IMG_PREPROC_BGR8U3C_TO_RGB24) {
+            out[3 * i + 0] = (int8_t)(u[2 * n + i] - 128);
+            out[3 * i + 1] = (int8_t)(u[n + i] - 128);
+            out[3 * i + 2] = (int8_t)(u[i] - 128);
+        } else {
+            int s = (u[2 * n + i] * gray_w[0] + u[n + i] * gray_w[1] + u[i] * gray_w[2] + 64) >> 7;
+            out[i] = (int8_t)((s > 255 ? 255 : s) - 128);
+        }
+    }
+}
+
+/* Planar uint8 resize of every plane of in to u */
+static inline void hx_img_preproc_test_resize_planes(const uint8_t *in, int in_w, int in_h, int planes, int out_w,
+                                                     int out_h, uint8_t *u)
+{
+    hx_img_preproc_roi roi;
+
+    hx_img_preproc_test_full_roi(in_w, in_h, out_w, out_h, &roi);
+    for (int c = 0; c < planes; c++) {
+        for (int y = 0; y < out_h; y++) {
+            for (int x = 0; x < out_w; x++)
+                u[(c * out_h + y) * out_w + x] =
+                    (uint8_t)hx_img_preproc_test_ref_pixel(in + c * in_w * in_h, in_w, in_h, &roi, x, y);
+        }
+    }
+}
+
+/* Benchmark only: the - 128 (or gray) pass in place, planes stay planar */
+static inline void hx_img_preproc_test_convert_in_place(hx_img_preproc_fmt fmt, int8_t *out, int n,
+                                                        const uint8_t gray_w[3])
+{
+    const uint8_t *u = (const uint8_t *)out;
+
+    if (fmt == HX_IMG_PREPROC_BGR8U3C_TO_GRAY) {
+        for (int i = 0; i < n; i++) {
+            int s = (u[2 * n + i] * gray_w[0] + u[n + i] * gray_w[1] + u[i] * gray_w[2] + 64) >> 7;
+            out[i] = (int8_t)((s > 255 ? 255 : s) - 128);
+        }
+    } else {
+        for (int i = 0; i < n * hx_img_preproc_test_planes(fmt); i++)
+            out[i] = (int8_t)(u[i] - 128);
+    }
+}
+
+/*
+ * Separate passes like the apps did: resize every plane to uint8, then
+ * convert. Used for timing; out must hold out_w * out_h * 3 bytes.
+ */
+static inline void hx_img_preproc_test_two_pass(hx_img_preproc_fmt fmt, const uint8_t *in, int in_w, int in_h,
+                                                int out_w, int out_h, const uint8_t gray_w[3], int8_t *out)
+{
+    hx_img_preproc_test_resize_planes(in, in_w, in_h, hx_img_preproc_test_planes(fmt), out_w, out_h, (uint8_t *)out);
+    hx_img_preproc_test_convert_in_place(fmt, out, out_w * out_h, gray_w);
+}
+
+/** scratch bytes of the letterbox tests and benchmark */
+#define HX_IMG_PREPROC_TEST_LETTERBOX_SCRATCH(box_w, box_h, grid, planes) \
+    ((size_t)(planes) * ((size_t)(box_w) * (box_h) + (size_t)((box_w) > (box_h) ? (box_w) : (box_h)) * \
+                         ((box_w) > (box_h) ? (box_w) : (box_h)) + (size_t)(grid) * (grid)))
+
+/*
+ * The letterbox path the apps used before hx_img_preproc_init_roi(): copy
+ * box to a buffer, pad it to a square with 0, resize, convert.
+ */
+static inline void hx_img_preproc_test_crop_pad(hx_img_preproc_fmt fmt, const uint8_t *in, int in_w, int in_h,
+                                                const hx_img_preproc_rect *box, int out_w, int out_h,
+                                                const uint8_t gray_w[3], uint8_t *scratch, int8_t *out)
+{
+    int planes = hx_img_preproc_test_planes(fmt);
+    int side = box->w > box->h ? box->w : box->h;
+    int left = (side - box->w) / 2;
+    int top = (side - box->h) / 2;
+    uint8_t *crop = scratch;
+    uint8_t *pad = crop + planes * box->w * box->h;
+    uint8_t *resized = pad + planes * side * side;
+
+    for (int c = 0; c < planes; c++) {
+        for (int y = 0; y < box->h; y++)
+            memcpy(crop + (c * box->h + y) * box->w, in + (c * in_h + box->y + y) * in_w + box->x, (size_t)box->w);
+    }
+    memset(pad, 0, (size_t)planes * side * side);
+    for (int c = 0; c < planes; c++) {
+        for (int y = 0; y < box->h; y++)
+            memcpy(pad + (c * side + top + y) * side + left, crop + (c * box->h + y) * box->w, (size_t)box->w);
+    }
+    hx_img_preproc_test_resize_planes(pad, side, side, planes, out_w, out_h, resized);
+    hx_img_preproc_test_convert(fmt, resized, out_w * out_h, gray_w, out);
+}
+
+#ifdef LIB_IMG_PROC
+/* The same passes with the prebuilt img_proc Helium resize */
+static inline void hx_img_preproc_test_img_proc(hx_img_preproc_fmt fmt, const uint8_t *in, int in_w, int in_h,
+                                                int out_w, int out_h, const uint8_t gray_w[3], int8_t *out)
+{
+    uint8_t *u = (uint8_t *)out;
+    float w_scale = (float)(in_w - 1) / (out_w - 1);
+    float h_scale = (float)(in_h - 1) / (out_h - 1);
+
+    if (fmt == HX_IMG_PREPROC_BGR8U3C_TO_RGB24) {
+        hx_lib_image_resize_BGR8U3C_to_RGB24_helium((uint8_t *)in, u, in_w, in_h, 3, out_w, out_h, w_scale, h_scale);
+        for (int i = 0; i < out_w * out_h * 3; i++)
+            out[i] = (int8_t)(u[i] - 128);
+        return;
+    }
+    hx_lib_image_resize_helium((uint8_t *)in, u, in_w, in_h, hx_img_preproc_test_planes(fmt), out_w, out_h, w_scale,
+                               h_scale);
+    hx_img_preproc_test_convert_in_place(fmt, out, out_w * out_h, gray_w);
+}
+
+/* The letterbox path of tflm_fd_fm before hx_img_preproc_init_roi() */
+static inline void hx_img_preproc_test_img_proc_crop_pad(hx_img_preproc_fmt fmt, const uint8_t *in, int in_w,
+                                                         int in_h, const hx_img_preproc_rect *box, int out_w,
+                                                         int out_h, const uint8_t gray_w[3], uint8_t *scratch,
+                                                         int8_t *out)
+{
+    int planes = hx_img_preproc_test_planes(fmt);
+    int side = box->w > box->h ? box->w : box->h;
+    int diff_w = side - box->w;
+    int diff_h = side - box->h;
+    uint8_t *crop = scratch;
+    uint8_t *pad = crop + planes * box->w * box->h;
+    uint8_t *resized = pad + planes * side * side;
+    float scale = (float)(side - 1) / (out_w - 1);
+
+    hx_lib_image_copy_helium((uint8_t *)in, crop, in_w, in_h, planes, box->x, box->y, box->w, box->h);
+    hx_lib_pad_image(crop, pad, box->w, box->h, planes, diff_h / 2, diff_h / 2 + diff_h % 2, diff_w / 2,
+                     diff_w / 2 + diff_w % 2, side, side);
+    hx_lib_image_resize_helium(pad, resized, side, side, planes, out_w, out_h, scale, scale);
+    hx_img_preproc_test_convert(fmt, resized, out_w * out_h, gray_w, out);
+}
+#endif
+
+static inline int hx_img_preproc_test_fill(hx_img_preproc_fmt fmt, uint8_t *in, int in_w, int in_h)
+{
+    for (int i = 0; i < hx_img_preproc_test_planes(fmt) * in_w * in_h; i++) {
+        uint32_t v = hx_img_preproc_test_rand();
+        /* mostly random, some runs of the extremes */
+        in[i] = (v & 0x700) == 0 ? 0 : (v & 0x700) == 0x100 ? 255 : (uint8_t)v;
+    }
+    return 0;
+}
+
+/*
+ * Checks one output against the reference. roi NULL is the whole frame
+ * through hx_img_preproc_init(); strip > 0 runs the rows in strips.
+ */
+static inline int hx_img_preproc_test_case(hx_img_preproc_fmt fmt, int in_w, int in_h, const hx_img_preproc_roi *roi,
+                                           int out_w, int out_h, int strip)
+{
+    static uint8_t in[3 * HX_IMG_PREPROC_TEST_MAX_W * HX_IMG_PREPROC_TEST_MAX_H];
+    static int8_t out[3 * HX_IMG_PREPROC_TEST_MAX_W * HX_IMG_PREPROC_TEST_MAX_H + 16];
+    static int8_t ref[3 * HX_IMG_PREPROC_TEST_MAX_W * HX_IMG_PREPROC_TEST_MAX_H];
+    static int16_t work[HX_IMG_PREPROC_WORK_SIZE(2 * HX_IMG_PREPROC_TEST_MAX_W, HX_IMG_PREPROC_TEST_MAX_W, 3) / 2];
+    static const uint8_t gray_fd_fm[3] = {38, 75, 18};
+    hx_img_preproc p;
+    hx_img_preproc_roi full;
+    int planes = hx_img_preproc_test_planes(fmt);
+    int out_size = out_w * out_h * hx_img_preproc_test_channels(fmt);
+    int ret;
+
+    hx_img_preproc_test_fill(fmt, in, in_w, in_h);
+    if (roi == NULL) {
+        hx_img_preproc_test_full_roi(in_w, in_h, out_w, out_h, &full);
+        ret = hx_img_preproc_init(&p, fmt, in_w, in_h, out_w, out_h, work, sizeof(work));
+        roi = &full;
+    } else {
+        ret = hx_img_preproc_init_roi(&p, fmt, in_w, in_h, roi, out_w, out_h, work, sizeof(work));
+    }
+    if (ret != 0) {
+        HX_IMG_PREPROC_TEST_PRINTF("hx_img_preproc FAIL init %dx%d -> %dx%d\r\n", in_w, in_h, out_w, out_h);
+        return 1;
+    }
+    if (fmt == HX_IMG_PREPROC_BGR8U3C_TO_GRAY && strip)
+        hx_img_preproc_set_gray_weights(&p, gray_fd_fm[0], gray_fd_fm[1], gray_fd_fm[2]);
+
+    memset(out, 0x5a, sizeof(out));
+    if (strip) {
+        for (int y = 0; y < out_h; y += strip)
+            hx_img_preproc_run_rows(&p, in, out, y, y + strip);
+    } else {
+        hx_img_preproc_run(&p, in, out);
+    }
+    hx_img_preproc_test_reference(fmt, in, in_w, in_h, roi, out_w, out_h, p.gray_w, ref);
+
+    for (int i = 0; i < out_size; i++) {
+        if (out[i] != ref[i]) {
+            HX_IMG_PREPROC_TEST_PRINTF("hx_img_preproc FAIL fmt %d %dx%d roi %d,%d %dx%d -> %dx%d strip %d: byte %d "
+                                       "is %d, reference %d\r\n",
+                                       fmt, in_w, in_h, roi->src.x, roi->src.y, roi->src.w, roi->src.h, out_w, out_h,
+                                       strip, i, out[i], ref[i]);
+            return 1;
+        }
+    }
+    for (int i = out_size; i < out_size + 16; i++) {
+        if (out[i] != 0x5a) {
+            HX_IMG_PREPROC_TEST_PRINTF("hx_img_preproc FAIL fmt %d %dx%d -> %dx%d: wrote past the output\r\n", fmt,
+                                       in_w, in_h, out_w, out_h);
+            return 1;
+        }
+    }
+    /* the fixed point reference stays within 1 of float bilinear */
+    for (int c = 0; c < planes; c++) {
+        for (int y = 0; y < out_h; y++) {
+            for (int x = 0; x < out_w; x++) {
+                const uint8_t *plane = in + c * in_w * in_h;
+                int got = hx_img_preproc_test_ref_pixel(plane, in_w, in_h, roi, x, y);
+                float want = hx_img_preproc_test_float_pixel(plane, in_w, in_h, roi, x, y);
+                if (fabsf((float)got - want) > 1.0f) {
+                    HX_IMG_PREPROC_TEST_PRINTF("hx_img_preproc FAIL %dx%d -> %dx%d: (%d, %d) is %d, float %d\r\n",
+                                               in_w, in_h, out_w, out_h, x, y, got, (int)want);
+                    return 1;
+                }
+            }
+        }
+    }
+    return 0;
+}
+
+/*
+ * hx_img_preproc_letterbox_roi() on the frame must give the same bytes as
+ * cropping box, padding it with 0 and resizing the padded buffer.
+ */
+static inline int hx_img_preproc_test_letterbox(hx_img_preproc_fmt fmt, int in_w, int in_h,
+                                                const hx_img_preproc_rect *box, int grid)
+{
+    static uint8_t in[3 * HX_IMG_PREPROC_TEST_MAX_W * HX_IMG_PREPROC_TEST_MAX_H];
+    static uint8_t scratch[HX_IMG_PREPROC_TEST_LETTERBOX_SCRATCH(HX_IMG_PREPROC_TEST_MAX_W, HX_IMG_PREPROC_TEST_MAX_H,
+                                                                  HX_IMG_PREPROC_TEST_MAX_W, 3)];
+    static int8_t out[3 * HX_IMG_PREPROC_TEST_MAX_W * HX_IMG_PREPROC_TEST_MAX_W];
+    static int8_t ref[3 * HX_IMG_PREPROC_TEST_MAX_W * HX_IMG_PREPROC_TEST_MAX_W];
+    static int16_t work[HX_IMG_PREPROC_WORK_SIZE(HX_IMG_PREPROC_TEST_MAX_W, HX_IMG_PREPROC_TEST_MAX_W, 3) / 2];
+    hx_img_preproc p;
+    hx_img_preproc_roi roi;
+
+    hx_img_preproc_test_fill(fmt, in, in_w, in_h);
+    hx_img_preproc_letterbox_roi(box, grid, &roi);
+    if (hx_img_preproc_init_roi(&p, fmt, in_w, in_h, &roi, grid, grid, work, sizeof(work)) != 0) {
+        HX_IMG_PREPROC_TEST_PRINTF("hx_img_preproc FAIL letterbox init\r\n");
+        return 1;
+    }
+    hx_img_preproc_run(&p, in, out);
+    hx_img_preproc_test_crop_pad(fmt, in, in_w, in_h, box, grid, grid, p.gray_w, scratch, ref);
+    if (memcmp(out, ref, (size_t)grid * grid * hx_img_preproc_test_channels(fmt)) != 0) {
+        HX_IMG_PREPROC_TEST_PRINTF("hx_img_preproc FAIL fmt %d letterbox %d,%d %dx%d -> %d differs from crop + pad\r\n",
+                                   fmt, box->x, box->y, box->w, box->h, grid);
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Runs the bit exactness tests and, if now and frame are not NULL,
+ *        times every format on frame (B, G, R planes of frame_w x frame_h)
+ *        to out_w x out_h.
+ * @param out benchmark output, at least out_w * out_h * 3 bytes
+ * @return number of failed cases
+ */
+static inline int hx_img_preproc_test_run(hx_img_preproc_test_clock_fn now, const uint8_t *frame, int frame_w,
+                                          int frame_h, int8_t *out, int out_w, int out_h)
+{
+    const int sizes[][4] = {
+        {64, 48, 24, 24}, {67, 53, 32, 17}, {64, 48, 64, 48}, {7, 5, 13, 3}, {1, 9, 5, 5},
+        {33, 1, 8, 1}, {9, 9, 1, 1}, {2, 2, 67, 53}, {64, 48, 9, 40},
+    };
+    /* src x, y, w, h, valid x, y, w, h, grid w, h, out x, y, out w, h */
+    const int rois[][14] = {
+        {-5, 3, 40, 40, 0, 3, 30, 40, 24, 24, 0, 0, 24, 24},     /* letterbox, box at the left edge */
+        {50, 20, 30, 30, 50, 25, 30, 20, 19, 19, 0, 0, 19, 19},   /* past the right and bottom edge */
+        {-10, -10, 80, 70, -10, -10, 80, 70, 33, 29, 0, 0, 33, 29},/* valid clipped to the frame */
+        {-3, 7, 37, 37, 0, 7, 31, 37, 48, 48, 10, 13, 16, 16},    /* eye window inside the grid */
+        {-3, 7, 37, 37, 0, 7, 31, 37, 48, 48, 40, 41, 16, 16},    /* eye window past the grid */
+        {10, 10, 20, 20, 12, 14, 5, 3, 67, 53, 0, 0, 67, 53},     /* upscale of a small valid area */
+        {10, 10, 20, 20, 100, 100, 5, 5, 8, 8, 0, 0, 8, 8},       /* valid outside the frame: all 0 */
+        {3, 4, 1, 1, 3, 4, 1, 1, 5, 5, 0, 0, 5, 5},               /* one pixel */
+    };
+    const int boxes[][5] = {
+        /* x, y, w, h, grid */
+        {5, 3, 30, 41, 24}, {10, 20, 41, 30, 24}, {0, 0, 64, 48, 32}, {17, 9, 20, 20, 67}, {60, 40, 7, 13, 9},
+    };
+    const hx_img_preproc_fmt fmts[] = {HX_IMG_PREPROC_Y8_TO_Y8, HX_IMG_PREPROC_BGR8U3C_TO_RGB24,
+                                       HX_IMG_PREPROC_BGR8U3C_TO_GRAY, HX_IMG_PREPROC_Y8_TO_YYY24};
+    int nfmts = (int)(sizeof(fmts) / sizeof(fmts[0]));
+    int cases = 0;
+    int failures = 0;
+
+    for (unsigned s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        for (int f = 0; f < nfmts; f++) {
+            for (int strip = 0; strip <= 7; strip += 7) {
+                failures += hx_img_preproc_test_case(fmts[f], sizes[s][0], sizes[s][1], NULL, sizes[s][2],
+                                                     sizes[s][3], strip);
+                cases++;
+            }
+        }
+    }
+    for (unsigned r = 0; r < sizeof(rois) / sizeof(rois[0]); r++) {
+        hx_img_preproc_roi roi;
+        roi.src.x = rois[r][0];
+        roi.src.y = rois[r][1];
+        roi.src.w = rois[r][2];
+        roi.src.h = rois[r][3];
+        roi.valid.x = rois[r][4];
+        roi.valid.y = rois[r][5];
+        roi.valid.w = rois[r][6];
+        roi.valid.h = rois[r][7];
+        roi.grid_w = rois[r][8];
+        roi.grid_h = rois[r][9];
+        roi.out_x = rois[r][10];
+        roi.out_y = rois[r][11];
+        for (int f = 0; f < nfmts; f++) {
+            for (int strip = 0; strip <= 5; strip += 5) {
+                failures += hx_img_preproc_test_case(fmts[f], 64, 48, &roi, rois[r][12], rois[r][13], strip);
+                cases++;
+            }
+        }
+    }
+    for (unsigned b = 0; b < sizeof(boxes) / sizeof(boxes[0]); b++) {
+        hx_img_preproc_rect box = {boxes[b][0], boxes[b][1], boxes[b][2], boxes[b][3]};
+        for (int f = 0; f < nfmts; f++) {
+            failures += hx_img_preproc_test_letterbox(fmts[f], 67, 53, &box, boxes[b][4]);
+            cases++;
+        }
+    }
+
+    /* bad arguments */
+    {
+        static int16_t work[HX_IMG_PREPROC_WORK_SIZE(64, 32, 3) / 2 + 2];
+        hx_img_preproc p;
+        hx_img_preproc_roi roi;
+        hx_img_preproc_test_full_roi(64, 48, 32, 32, &roi);
+        roi.out_x = -1;
+        cases++;
+        if (hx_img_preproc_init(&p, HX_IMG_PREPROC_BGR8U3C_TO_RGB24, 64, 48, 32, 32, work, sizeof(work) - 8) == 0 ||
+            hx_img_preproc_init(&p, HX_IMG_PREPROC_BGR8U3C_TO_RGB24, 64, 48, 32, 32, (char *)work + 2,
+                                sizeof(work) - 4) == 0 ||
+            hx_img_preproc_init(&p, HX_IMG_PREPROC_Y8_TO_Y8, 0, 48, 32, 32, work, sizeof(work)) == 0 ||
+            hx_img_preproc_init_roi(&p, HX_IMG_PREPROC_Y8_TO_Y8, 64, 48, &roi, 32, 32, work, sizeof(work)) == 0 ||
+            hx_img_preproc_init(&p, HX_IMG_PREPROC_Y8_TO_Y8, 64, 48, 32, 32, work,
+                                HX_IMG_PREPROC_WORK_SIZE(64, 32, 1)) != 0) {
+            HX_IMG_PREPROC_TEST_PRINTF("hx_img_preproc FAIL argument checks\r\n");
+            failures++;
+        }
+    }
+
+    HX_IMG_PREPROC_TEST_PRINTF("hx_img_preproc: %d cases, %d failures\r\n", cases, failures);
+
+    if (now != NULL && frame != NULL) {
+        static int16_t work[HX_IMG_PREPROC_WORK_SIZE(640, 640, 3) / 2];
+        static const char *names[] = {"Y8_TO_Y8", "BGR8U3C_TO_RGB24", "BGR8U3C_TO_GRAY", "Y8_TO_YYY24"};
+        hx_img_preproc p;
+
+        for (int f = 0; f < nfmts; f++) {
+            if (hx_img_preproc_init(&p, fmts[f], frame_w, frame_h, out_w, out_h, work, sizeof(work)) != 0)
+                continue;
+            uint32_t t0 = now();
+            hx_img_preproc_run(&p, frame, out);
+            uint32_t t1 = now();
+            hx_img_preproc_test_two_pass(fmts[f], frame, frame_w, frame_h, out_w, out_h, p.gray_w, out);
+            uint32_t t2 = now();
+            HX_IMG_PREPROC_TEST_PRINTF("hx_img_preproc %s %dx%d -> %dx%d: fused %lu ticks, scalar passes %lu ticks\r\n",
+                                       names[f], frame_w, frame_h, out_w, out_h, (unsigned long)(t1 - t0),
+                                       (unsigned long)(t2 - t1));
+#ifdef LIB_IMG_PROC
+            t0 = now();
+            hx_img_preproc_test_img_proc(fmts[f], frame, frame_w, frame_h, out_w, out_h, p.gray_w, out);
+            t1 = now();
+            HX_IMG_PREPROC_TEST_PRINTF("hx_img_preproc %s: img_proc resize + convert passes %lu ticks\r\n", names[f],
+                                       (unsigned long)(t1 - t0));
+#endif
+        }
+    }
+    return failures;
+}
+
+/**
+ * @brief Times a letterboxed face box of frame to grid x grid (the face
+ *        mesh input of tflm_fd_fm) against copy + pad + resize + convert,
+ *        and prints the buffer bytes each one needs.
+ * @param scratch HX_IMG_PREPROC_TEST_LETTERBOX_SCRATCH(box->w, box->h,
+ *        grid, planes) bytes for the copy + pad path
+ * @param out at least grid * grid * 3 bytes
+ */
+static inline void hx_img_preproc_test_letterbox_bench(hx_img_preproc_test_clock_fn now, hx_img_preproc_fmt fmt,
+                                                       const uint8_t *frame, int frame_w, int frame_h,
+                                                       const hx_img_preproc_rect *box, int grid, uint8_t *scratch,
+                                                       int8_t *out)
+{
+    static int16_t work[HX_IMG_PREPROC_WORK_SIZE(640, 192, 3) / 2];
+    int planes = hx_img_preproc_test_planes(fmt);
+    /* crop_img, pad_img and resized_img of tflm_fd_fm, sized for the whole frame */
+    size_t old_bytes = (size_t)planes * ((size_t)frame_w * frame_h + (size_t)frame_w * frame_w + (size_t)grid * grid);
+    hx_img_preproc_roi roi;
+    hx_img_preproc p;
+
+    hx_img_preproc_letterbox_roi(box, grid, &roi);
+    uint32_t t0 = now();
+    if (hx_img_preproc_init_roi(&p, fmt, frame_w, frame_h, &roi, grid, grid, work, sizeof(work)) != 0)
+        return;
+    hx_img_preproc_run(&p, frame, out);
+    uint32_t t1 = now();
+    hx_img_preproc_test_crop_pad(fmt, frame, frame_w, frame_h, box, grid, grid, p.gray_w, scratch, out);
+    uint32_t t2 = now();
+    HX_IMG_PREPROC_TEST_PRINTF("hx_img_preproc letterbox %dx%d of %dx%d -> %d: roi %lu ticks %lu bytes, scalar copy + "
+                               "pad + passes %lu ticks %lu bytes\r\n",
+                               box->w, box->h, frame_w, frame_h, grid, (unsigned long)(t1 - t0),
+                               (unsigned long)hx_img_preproc_roi_work_size(fmt, &roi, grid),
+                               (unsigned long)(t2 - t1), (unsigned long)old_bytes);
+#ifdef LIB_IMG_PROC
+    t0 = now();
+    hx_img_preproc_test_img_proc_crop_pad(fmt, frame, frame_w, frame_h, box, grid, grid, p.gray_w, scratch, out);
+    t1 = now();
+    HX_IMG_PREPROC_TEST_PRINTF("hx_img_preproc letterbox: img_proc copy + pad + resize + convert %lu ticks\r\n",
+                               (unsigned long)(t1 - t0));
+#endif
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
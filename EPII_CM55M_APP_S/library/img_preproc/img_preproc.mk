@@ -0,0 +1,65 @@
+# directory declaration
+LIB_IMG_PREPROC_DIR = $(LIBRARIES_ROOT)/img_preproc
+
+LIB_IMG_PREPROC_ASMSRCDIR	= $(LIB_IMG_PREPROC_DIR)
+LIB_IMG_PREPROC_CSRCDIR	= $(LIB_IMG_PREPROC_DIR)
+LIB_IMG_PREPROC_CXXSRCSDIR    = $(LIB_IMG_PREPROC_DIR)
+LIB_IMG_PREPROC_INCDIR	= $(LIB_IMG_PREPROC_DIR)
+
+# find all the source files in the target directories
+LIB_IMG_PREPROC_CSRCS = $(call get_csrcs, $(LIB_IMG_PREPROC_CSRCDIR))
+LIB_IMG_PREPROC_CXXSRCS = $(call get_cxxsrcs, $(LIB_IMG_PREPROC_CXXSRCSDIR))
+LIB_IMG_PREPROC_ASMSRCS = $(call get_asmsrcs, $(LIB_IMG_PREPROC_ASMSRCDIR))
+
+# get object files
+LIB_IMG_PREPROC_COBJS = $(call get_relobjs, $(LIB_IMG_PREPROC_CSRCS))
+LIB_IMG_PREPROC_CXXOBJS = $(call get_relobjs, $(LIB_IMG_PREPROC_CXXSRCS))
+LIB_IMG_PREPROC_ASMOBJS = $(call get_relobjs, $(LIB_IMG_PREPROC_ASMSRCS))
+LIB_IMG_PREPROC_OBJS = $(LIB_IMG_PREPROC_COBJS) $(LIB_IMG_PREPROC_ASMOBJS) $(LIB_IMG_PREPROC_CXXOBJS)
+
+# get dependency files
+LIB_IMG_PREPROC_DEPS = $(call get_deps, $(LIB_IMG_PREPROC_OBJS))
+
+# extra macros to be defined
+LIB_IMG_PREPROC_DEFINES = -DLIB_IMG_PREPROC
+
+# genearte library
+ifeq ($(IMGPREPROC_LIB_FORCE_PREBUILT), y)
+override LIB_IMG_PREPROC_OBJS:=
+endif
+IMG_PREPROC_LIB_NAME = lib_img_preproc.a
+LIB_LIB_IMG_PREPROC := $(subst /,$(PS), $(strip $(OUT_DIR)/$(IMG_PREPROC_LIB_NAME)))
+
+# library generation rule
+$(LIB_LIB_IMG_PREPROC): $(LIB_IMG_PREPROC_OBJS)
+	$(TRACE_ARCHIVE)
+ifeq "$(strip $(LIB_IMG_PREPROC_OBJS))" ""
+	$(CP) $(PREBUILT_LIB)$(IMG_PREPROC_LIB_NAME) $(LIB_LIB_IMG_PREPROC)
+else
+	$(Q)$(AR) $(AR_OPT) $@ $(LIB_IMG_PREPROC_OBJS)
+	$(CP) $(LIB_LIB_IMG_PREPROC) $(PREBUILT_LIB)$(IMG_PREPROC_LIB_NAME)
+endif
+
+# specific compile rules
+# user can add rules to compile this middleware
+# if not rules specified to this middleware, it will use default compiling rules
+
+# Middleware Definitions
+LIB_INCDIR += $(LIB_IMG_PREPROC_INCDIR)
+LIB_CSRCDIR += $(LIB_IMG_PREPROC_CSRCDIR)
+LIB_CXXSRCDIR += $(LIB_IMG_PREPROC_CXXSRCDIR)
+LIB_ASMSRCDIR += $(LIB_IMG_PREPROC_ASMSRCDIR)
+
+LIB_CSRCS += $(LIB_IMG_PREPROC_CSRCS)
+LIB_CXXSRCS += $(LIB_IMG_PREPROC_CXXSRCS)
+LIB_ASMSRCS += $(LIB_IMG_PREPROC_ASMSRCS)
+LIB_ALLSRCS += $(LIB_IMG_PREPROC_CSRCS) $(LIB_IMG_PREPROC_ASMSRCS)
+
+LIB_COBJS += $(LIB_IMG_PREPROC_COBJS)
+LIB_CXXOBJS += $(LIB_IMG_PREPROC_CXXOBJS)
+LIB_ASMOBJS += $(LIB_IMG_PREPROC_ASMOBJS)
+LIB_ALLOBJS += $(LIB_IMG_PREPROC_OBJS)
+
+LIB_DEFINES += $(LIB_IMG_PREPROC_DEFINES)
+LIB_DEPS += $(LIB_IMG_PREPROC_DEPS)
+LIB_LIBS += $(LIB_LIB_IMG_PREPROC)
\ No newline at end of file
@@ -0,0 +1,42 @@
+/*
+ * Host runner of hx_img_preproc_test.h, ticks are microseconds. The
+ * benchmark frame is a 640x480 B, G, R planar gradient; the letterbox
+ * benchmark uses the tflm_fd_fm frame sizes and face mesh input.
+ */
+#define _POSIX_C_SOURCE 199309L
+#include <time.h>
+#include "hx_img_preproc_test.h"
+
+#define FRAME_W 640
+#define FRAME_H 480
+
+static uint8_t frame[3 * FRAME_W * FRAME_H];
+static int8_t out[224 * 224 * 3];
+static uint8_t scratch[HX_IMG_PREPROC_TEST_LETTERBOX_SCRATCH(260, 260, 192, 3)];
+
+static uint32_t host_now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)(ts.tv_sec * 1000000u + ts.tv_nsec / 1000);
+}
+
+int main(void)
+{
+    for (int c = 0; c < 3; c++) {
+        for (int y = 0; y < FRAME_H; y++) {
+            for (int x = 0; x < FRAME_W; x++)
+                frame[(c * FRAME_H + y) * FRAME_W + x] = (uint8_t)(x * (c + 1) + y);
+        }
+    }
+    int failures = hx_img_preproc_test_run(host_now_us, frame, FRAME_W, FRAME_H, out, 224, 224);
+
+    /* YUV 640x480 and RGB 320x240 modes of tflm_fd_fm */
+    hx_img_preproc_rect face_y = {220, 100, 200, 260};
+    hx_img_preproc_rect face_bgr = {110, 50, 100, 130};
+    hx_img_preproc_test_letterbox_bench(host_now_us, HX_IMG_PREPROC_Y8_TO_YYY24, frame, 640, 480, &face_y, 192,
+                                        scratch, out);
+    hx_img_preproc_test_letterbox_bench(host_now_us, HX_IMG_PREPROC_BGR8U3C_TO_RGB24, frame, 320, 240, &face_bgr, 192,
+                                        scratch, out);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,95 @@
+/*
+ * hx_icmfifo.c
+ *
+ * FIFO packet structure as in the ICM-42688-P datasheet, section 6.
+ */
+#include "hx_icmfifo.h"
+
+#define HDR_MSG     0x80
+#define HDR_ACCEL   0x40
+#define HDR_GYRO    0x20
+#define HDR_20      0x10
+
+static int16_t be16(const uint8_t *p)
+{
+    return (int16_t)((p[0] << 8) | p[1]);
+}
+
+uint32_t hx_icmfifo_packet_len(uint8_t hdr)
+{
+    if (hdr & HDR_MSG)
+        return 1;
+    if ((hdr & (HDR_ACCEL | HDR_GYRO)) == (HDR_ACCEL | HDR_GYRO))
+        return (hdr & HDR_20) ? 20 : 16;
+    if (hdr & (HDR_ACCEL | HDR_GYRO))
+        return 8;
+    return 0;
+}
+
+uint32_t hx_icmfifo_parse(const uint8_t *buf, uint32_t len, hx_icm_sample *out, uint32_t max, uint32_t *used)
+{
+    uint32_t pos = 0, n = 0;
+
+    while (pos < len && n < max)
+    {
+        uint8_t hdr = buf[pos];
+        uint32_t plen = hx_icmfifo_packet_len(hdr);
+        const uint8_t *p = buf + pos + 1;
+        hx_icm_sample *s = &out[n];
+
+        if (plen == 0)
+        {
+            /* lost sync, look for the next header */
+            pos++;
+            continue;
+        }
+        if (plen == 1)
+        {
+            /* FIFO empty, the rest of the burst is filler */
+            pos = len;
+            break;
+        }
+        if (pos + plen > len)
+            break;
+
+        s->ax = s->ay = s->az = HX_ICMFIFO_INVALID;
+        s->gx = s->gy = s->gz = HX_ICMFIFO_INVALID;
+        s->ts = 0;
+        if (hdr & HDR_ACCEL)
+        {
+            s->ax = be16(p);
+            s->ay = be16(p + 2);
+            s->az = be16(p + 4);
+            p += 6;
+        }
+        if (hdr & HDR_GYRO)
+        {
+            s->gx = be16(p);
+            s->gy = be16(p + 2);
+            s->gz = be16(p + 4);
+            p += 6;
+        }
+        if (plen >= 16)
+            s->ts = (uint16_t)be16(plen == 20 ? p + 2 : p + 1);
+        pos += plen;
+        n++;
+    }
+    *used = pos;
+    return n;
+}
+
+void hx_icmfifo_pack(const hx_icm_sample *s, uint8_t *pkt)
+{
+    const int16_t v[6] = { s->ax, s->ay, s->az, s->gx, s->gy, s->gz };
+    int i;
+
+    pkt[0] = HDR_ACCEL | HDR_GYRO | 0x08;
+    for (i = 0; i < 6; i++)
+    {
+        pkt[1 + 2 * i] = (uint8_t)((uint16_t)v[i] >> 8);
+        pkt[2 + 2 * i] = (uint8_t)v[i];
+    }
+    pkt[13] = 0;
+    pkt[14] = (uint8_t)(s->ts >> 8);
+    pkt[15] = (uint8_t)s->ts;
+}
@@ -0,0 +1,63 @@
+#ifndef _LIB_HX_ICMFIFO_H_
+#define _LIB_HX_ICMFIFO_H_
+/*
+ * ICM-42688 FIFO packets, as read in one burst from FIFO_DATA.
+ *
+ * The FIFO holds packets of one header byte and the sensor data it flags,
+ * big endian (INTF_CONFIG0 reset value):
+ *   packet 1   accel only             8 bytes   hdr, accel 6, temp 1
+ *   packet 2   gyro only              8 bytes   hdr, gyro 6, temp 1
+ *   packet 3   accel and gyro        16 bytes   hdr, accel 6, gyro 6, temp 1, timestamp 2
+ *   packet 4   20-bit accel and gyro 20 bytes   as 3, temp 2, and 3 bytes of low bits
+ * A header with HEADER_MSG set is an empty FIFO. A sensor that has no new
+ * sample in a packet reads -32768.
+ *
+ * No I2C/SPI here: the driver reads FIFO_COUNT and that many bytes, this
+ * turns them into samples. A packet cut at the end of a burst is left for
+ * the next one.
+ */
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/** Longest packet */
+#define HX_ICMFIFO_PKT_MAX  20
+
+/** Value of an axis with no new sample */
+#define HX_ICMFIFO_INVALID  (-32768)
+
+typedef struct hx_icm_sample {
+    int16_t ax, ay, az;         /**< accel LSB, HX_ICMFIFO_INVALID if not in the packet */
+    int16_t gx, gy, gz;         /**< gyro LSB, HX_ICMFIFO_INVALID if not in the packet */
+    uint16_t ts;                /**< ODR timestamp of packets 3 and 4, else 0 */
+} hx_icm_sample;
+
+/**
+ * Bytes of the packet that starts with header hdr.
+ * @return 8, 16 or 20, 1 for an empty-FIFO header, 0 for a header that
+ *         flags no sensor
+ */
+uint32_t hx_icmfifo_packet_len(uint8_t hdr);
+
+/**
+ * Parses whole packets from buf.
+ *
+ * @param[out] out   up to max samples, one per packet with data
+ * @param[out] used  bytes consumed, whole packets; the rest is a packet cut
+ *                   at the end of the burst, or garbage after an unknown
+ *                   header that was skipped one byte at a time
+ * @return samples written
+ */
+uint32_t hx_icmfifo_parse(const uint8_t *buf, uint32_t len, hx_icm_sample *out, uint32_t max, uint32_t *used);
+
+/** Writes a packet 3 for s into pkt (16 bytes), for recorded traces and tests */
+void hx_icmfifo_pack(const hx_icm_sample *s, uint8_t *pkt);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _LIB_HX_ICMFIFO_H_ */
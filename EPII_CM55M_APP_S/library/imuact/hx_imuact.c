@@ -0,0 +1,127 @@
+/*
+ * hx_imuact.c
+ *
+ * See hx_imuact.h. A few adds and shifts per sample, nothing per axis
+ * that needs a multiply; the mg conversion is once per epoch.
+ */
+#include <string.h>
+#include "hx_imuact.h"
+
+void hx_imuact_default_cfg(hx_imuact_cfg *cfg, uint16_t odr_hz, uint16_t lsb_per_g)
+{
+    uint8_t shift = 0;
+
+    memset(cfg, 0, sizeof(*cfg));
+    cfg->odr_hz = odr_hz;
+    cfg->lsb_per_g = lsb_per_g;
+    cfg->epoch_ms = 1000;
+    /* time constant 2^shift samples, about 1.3 s */
+    while ((1u << (shift + 1)) <= (uint32_t)odr_hz * 13 / 10 && shift < 15)
+        shift++;
+    cfg->hp_shift = shift;
+    cfg->light_mg = 50;
+    cfg->heavy_mg = 200;
+}
+
+int hx_imuact_init(hx_imuact *ia, const hx_imuact_cfg *cfg, hx_imuact_epoch_cb cb, void *arg)
+{
+    memset(ia, 0, sizeof(*ia));
+    ia->cfg = *cfg;
+    ia->cb = cb;
+    ia->cb_arg = arg;
+    ia->epoch_len = (uint32_t)cfg->odr_hz * cfg->epoch_ms / 1000;
+    if (ia->epoch_len == 0 || cfg->lsb_per_g == 0)
+        return -1;
+    return 0;
+}
+
+uint32_t hx_imuact_now_ms(const hx_imuact *ia)
+{
+    return (uint32_t)((uint64_t)ia->samples * 1000 / ia->cfg.odr_hz);
+}
+
+static void end_epoch(hx_imuact *ia)
+{
+    hx_imuact_epoch *e = &ia->hist[ia->head];
+    uint32_t mg = (uint32_t)((uint64_t)ia->sum * 1000 / ((uint64_t)ia->epoch_len * ia->cfg.lsb_per_g));
+
+    e->end_ms = hx_imuact_now_ms(ia);
+    e->mg = mg > UINT16_MAX ? UINT16_MAX : (uint16_t)mg;
+    e->level = mg >= ia->cfg.heavy_mg ? HX_IMUACT_HEAVY : mg >= ia->cfg.light_mg ? HX_IMUACT_LIGHT : HX_IMUACT_REST;
+    ia->head = (uint16_t)((ia->head + 1) % HX_IMUACT_HIST);
+    if (ia->count < HX_IMUACT_HIST)
+        ia->count++;
+    ia->sum = 0;
+    ia->in_epoch = 0;
+    if (ia->cb)
+        ia->cb(ia->cb_arg, e);
+}
+
+static uint32_t axis(int32_t *base, int16_t v, uint8_t shift)
+{
+    int32_t d = ((int32_t)v << 8) - *base;
+
+    *base += d >> shift;
+    return (uint32_t)((d < 0 ? -d : d) >> 8);
+}
+
+void hx_imuact_push(hx_imuact *ia, const hx_icm_sample *s, uint32_t n)
+{
+    uint32_t i;
+
+    for (i = 0; i < n; i++, s++)
+    {
+        if (s->ax == HX_ICMFIFO_INVALID && s->ay == HX_ICMFIFO_INVALID && s->az == HX_ICMFIFO_INVALID)
+        {
+            /* a gyro only packet, the epoch still runs on the sample clock */
+            ia->invalid++;
+        }
+        else if (!ia->primed)
+        {
+            ia->base[0] = (int32_t)s->ax << 8;
+            ia->base[1] = (int32_t)s->ay << 8;
+            ia->base[2] = (int32_t)s->az << 8;
+            ia->primed = 1;
+        }
+        else
+        {
+            ia->sum += axis(&ia->base[0], s->ax, ia->cfg.hp_shift) +
+                       axis(&ia->base[1], s->ay, ia->cfg.hp_shift) +
+                       axis(&ia->base[2], s->az, ia->cfg.hp_shift);
+        }
+        ia->samples++;
+        if (++ia->in_epoch == ia->epoch_len)
+            end_epoch(ia);
+    }
+}
+
+uint32_t hx_imuact_summarize(const hx_imuact *ia, uint32_t from_ms, uint32_t to_ms, hx_imuact_summary *sum)
+{
+    uint32_t i, total = 0, heavy = 0;
+
+    memset(sum, 0, sizeof(*sum));
+    for (i = 0; i < ia->count; i++)
+    {
+        const hx_imuact_epoch *e = &ia->hist[(ia->head + HX_IMUACT_HIST - 1 - i) % HX_IMUACT_HIST];
+        uint32_t start_ms = e->end_ms - ia->cfg.epoch_ms;
+
+        if (e->end_ms <= from_ms)
+            break;
+        if (start_ms >= to_ms)
+            continue;
+        sum->epochs++;
+        total += e->mg;
+        if (e->mg > sum->max_mg)
+            sum->max_mg = e->mg;
+        if (e->level > sum->level)
+            sum->level = e->level;
+        if (e->level == HX_IMUACT_HEAVY)
+            heavy++;
+    }
+    if (sum->epochs)
+    {
+        sum->mean_mg = (uint16_t)(total / sum->epochs);
+        sum->heavy_pct = (uint8_t)(heavy * 100 / sum->epochs);
+    }
+    return sum->epochs;
+}
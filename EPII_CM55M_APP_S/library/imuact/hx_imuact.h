@@ -0,0 +1,120 @@
+#ifndef _LIB_HX_IMUACT_H_
+#define _LIB_HX_IMUACT_H_
+/*
+ * Activity index from accelerometer samples, for gating or annotating
+ * inferences on signals that motion corrupts (ECG, PPG).
+ *
+ * Per sample, integer only:
+ *   gravity    per-axis EMA, weight 1/2^hp_shift, subtracted (a high-pass
+ *              that also follows slow changes of orientation)
+ *   activity   |ax| + |ay| + |az| of what is left, L1 so there is no sqrt
+ * Per epoch of epoch_ms, the mean activity in mg is the index, and its
+ * level is rest, light or heavy against light_mg and heavy_mg. The last
+ * HX_IMUACT_HIST epochs are kept, so a consumer that is seconds behind
+ * (an AF window covers 30 s of beats) can ask how much of its time span
+ * was heavy motion.
+ *
+ * Time is the sample count at odr_hz, from the first sample.
+ *
+ * Usage:
+ *   hx_imuact_default_cfg(&cfg, 100, 2048);
+ *   hx_imuact_init(&ia, &cfg, on_epoch, NULL);
+ *   for each FIFO burst
+ *       n = hx_icmfifo_parse(buf, len, s, max, &used);
+ *       hx_imuact_push(&ia, s, n);
+ *   before an inference on [t0, t1]
+ *       hx_imuact_summarize(&ia, t0, t1, &sum);
+ *       if (sum.epochs && sum.heavy_pct >= 50) skip it
+ */
+#include <stdint.h>
+#include "hx_icmfifo.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/** Epochs kept, 128 s at 1 s epochs */
+#ifndef HX_IMUACT_HIST
+#define HX_IMUACT_HIST 128
+#endif
+
+typedef enum hx_imuact_level {
+    HX_IMUACT_REST = 0,
+    HX_IMUACT_LIGHT,
+    HX_IMUACT_HEAVY
+} hx_imuact_level;
+
+typedef struct hx_imuact_cfg {
+    uint16_t odr_hz;            /**< accel samples per second */
+    uint16_t lsb_per_g;         /**< 2048 at +-16 g, 16384 at +-2 g */
+    uint16_t epoch_ms;
+    uint8_t hp_shift;           /**< gravity EMA weight 1/2^hp_shift per sample */
+    uint16_t light_mg;          /**< index from which an epoch is light motion */
+    uint16_t heavy_mg;          /**< and heavy motion */
+} hx_imuact_cfg;
+
+typedef struct hx_imuact_epoch {
+    uint32_t end_ms;
+    uint16_t mg;                /**< activity index */
+    uint8_t level;              /**< hx_imuact_level */
+} hx_imuact_epoch;
+
+typedef struct hx_imuact_summary {
+    uint16_t epochs;            /**< epochs that overlap the span, 0 if none is known */
+    uint16_t mean_mg;
+    uint16_t max_mg;
+    uint8_t heavy_pct;          /**< share of those epochs that are heavy */
+    uint8_t level;              /**< highest level of those epochs */
+} hx_imuact_summary;
+
+typedef void (*hx_imuact_epoch_cb)(void *arg, const hx_imuact_epoch *e);
+
+typedef struct hx_imuact {
+    hx_imuact_cfg cfg;
+    hx_imuact_epoch_cb cb;
+    void *cb_arg;
+
+    int32_t base[3];            /**< gravity, LSB << 8 */
+    uint8_t primed;
+    uint32_t epoch_len;         /**< samples */
+    uint32_t in_epoch;
+    uint32_t sum;               /**< activity of the epoch so far, LSB */
+    uint32_t samples;
+    uint32_t invalid;           /**< packets without accel data */
+
+    hx_imuact_epoch hist[HX_IMUACT_HIST];
+    uint16_t head;
+    uint16_t count;
+} hx_imuact;
+
+/**
+ * Defaults for odr_hz and lsb_per_g: 1 s epochs, gravity time constant of
+ * about 1.3 s at 100 Hz, light from 50 mg, heavy from 200 mg. Slow walking
+ * gives about 200 to 300 mg of this index, sitting still a few mg.
+ */
+void hx_imuact_default_cfg(hx_imuact_cfg *cfg, uint16_t odr_hz, uint16_t lsb_per_g);
+
+/**
+ * @param cb called at the end of every epoch, may be NULL
+ * @return 0, or -1 if an epoch is shorter than a sample
+ */
+int hx_imuact_init(hx_imuact *ia, const hx_imuact_cfg *cfg, hx_imuact_epoch_cb cb, void *arg);
+
+/** Feeds n samples, gyro only samples are counted but carry no activity */
+void hx_imuact_push(hx_imuact *ia, const hx_icm_sample *s, uint32_t n);
+
+/** Time of the samples fed so far */
+uint32_t hx_imuact_now_ms(const hx_imuact *ia);
+
+/**
+ * Sums up the kept epochs that overlap [from_ms, to_ms).
+ * @return sum->epochs
+ */
+uint32_t hx_imuact_summarize(const hx_imuact *ia, uint32_t from_ms, uint32_t to_ms, hx_imuact_summary *sum);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _LIB_HX_IMUACT_H_ */
@@ -0,0 +1,65 @@
+# directory declaration
+LIB_IMUACT_DIR = $(LIBRARIES_ROOT)/imuact
+
+LIB_IMUACT_ASMSRCDIR	= $(LIB_IMUACT_DIR)
+LIB_IMUACT_CSRCDIR	= $(LIB_IMUACT_DIR)
+LIB_IMUACT_CXXSRCSDIR    = $(LIB_IMUACT_DIR)
+LIB_IMUACT_INCDIR	= $(LIB_IMUACT_DIR)
+
+# find all the source files in the target directories
+LIB_IMUACT_CSRCS = $(call get_csrcs, $(LIB_IMUACT_CSRCDIR))
+LIB_IMUACT_CXXSRCS = $(call get_cxxsrcs, $(LIB_IMUACT_CXXSRCSDIR))
+LIB_IMUACT_ASMSRCS = $(call get_asmsrcs, $(LIB_IMUACT_ASMSRCDIR))
+
+# get object files
+LIB_IMUACT_COBJS = $(call get_relobjs, $(LIB_IMUACT_CSRCS))
+LIB_IMUACT_CXXOBJS = $(call get_relobjs, $(LIB_IMUACT_CXXSRCS))
+LIB_IMUACT_ASMOBJS = $(call get_relobjs, $(LIB_IMUACT_ASMSRCS))
+LIB_IMUACT_OBJS = $(LIB_IMUACT_COBJS) $(LIB_IMUACT_ASMOBJS) $(LIB_IMUACT_CXXOBJS)
+
+# get dependency files
+LIB_IMUACT_DEPS = $(call get_deps, $(LIB_IMUACT_OBJS))
+
+# extra macros to be defined
+LIB_IMUACT_DEFINES = -DLIB_IMUACT
+
+# genearte library
+ifeq ($(IMUACT_LIB_FORCE_PREBUILT), y)
+override LIB_IMUACT_OBJS:=
+endif
+IMUACT_LIB_NAME = lib_imuact.a
+LIB_LIB_IMUACT := $(subst /,$(PS), $(strip $(OUT_DIR)/$(IMUACT_LIB_NAME)))
+
+# library generation rule
+$(LIB_LIB_IMUACT): $(LIB_IMUACT_OBJS)
+	$(TRACE_ARCHIVE)
+ifeq "$(strip $(LIB_IMUACT_OBJS))" ""
+	$(CP) $(PREBUILT_LIB)$(IMUACT_LIB_NAME) $(LIB_LIB_IMUACT)
+else
+	$(Q)$(AR) $(AR_OPT) $@ $(LIB_IMUACT_OBJS)
+	$(CP) $(LIB_LIB_IMUACT) $(PREBUILT_LIB)$(IMUACT_LIB_NAME)
+endif
+
+# specific compile rules
+# user can add rules to compile this middleware
+# if not rules specified to this middleware, it will use default compiling rules
+
+# Middleware Definitions
+LIB_INCDIR += $(LIB_IMUACT_INCDIR)
+LIB_CSRCDIR += $(LIB_IMUACT_CSRCDIR)
+LIB_CXXSRCDIR += $(LIB_IMUACT_CXXSRCDIR)
+LIB_ASMSRCDIR += $(LIB_IMUACT_ASMSRCDIR)
+
+LIB_CSRCS += $(LIB_IMUACT_CSRCS)
+LIB_CXXSRCS += $(LIB_IMUACT_CXXSRCS)
+LIB_ASMSRCS += $(LIB_IMUACT_ASMSRCS)
+LIB_ALLSRCS += $(LIB_IMUACT_CSRCS) $(LIB_IMUACT_ASMSRCS)
+
+LIB_COBJS += $(LIB_IMUACT_COBJS)
+LIB_CXXOBJS += $(LIB_IMUACT_CXXOBJS)
+LIB_ASMOBJS += $(LIB_IMUACT_ASMOBJS)
+LIB_ALLOBJS += $(LIB_IMUACT_OBJS)
+
+LIB_DEFINES += $(LIB_IMUACT_DEFINES)
+LIB_DEPS += $(LIB_IMUACT_DEPS)
+LIB_LIBS += $(LIB_LIB_IMUACT)
\ No newline at end of file
@@ -0,0 +1,440 @@
+/*
+ * Host replay of ICM-42688 traces through hx_icmfifo and hx_imuact.
+ *
+ *   hx_imuact_replay --synth <dir>               synthetic trace, checked
+ *   hx_imuact_replay <trace> [odr_hz] [lsb_per_g]
+ *
+ * A trace is a FIFO dump, the FIFO_DATA bytes as the driver reads them
+ * (imu_read writes none, a logger or af_detect_testbench's .imu file does),
+ * or a .csv with ax,ay,az in LSB per line. Every epoch is printed with its
+ * index and level.
+ *
+ * --synth writes <dir>/synth.imu, 100 Hz at +-16 g, and checks it
+ * (make check). It is rest, a slow change of posture, fidgeting, walking,
+ * rest, running and rest, with sensor noise, labelled per segment. The
+ * dump is fed back in bursts of random length, each cut anywhere in a
+ * packet and some padded with empty-FIFO headers, as a driver reading
+ * FIFO_COUNT bytes on every watermark interrupt would see it.
+ *
+ *   parse      every sample comes back, bit exact, in order
+ *   levels     every epoch but the first of each segment has its label's
+ *              level; posture change is rest or light
+ *   gating     30 s windows every 5 s, gated at HEAVY_PCT heavy epochs:
+ *              none with less than 30% heavy time by label is gated, all
+ *              with more than 70% are
+ */
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "hx_imuact.h"
+
+#define ODR_HZ          100
+#define LSB_PER_G       2048
+#define MAX_SAMPLES     (ODR_HZ * 3600)
+#define MAX_EPOCHS      3600
+#define BURST_MAX       512
+#define WINDOW_MS       30000
+#define WINDOW_STEP_MS  5000
+#define HEAVY_PCT       50
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+enum { SEG_REST, SEG_TILT, SEG_FIDGET, SEG_WALK, SEG_RUN };
+
+typedef struct {
+    uint8_t kind;
+    uint16_t seconds;
+} segment_t;
+
+static const segment_t segments[] = {
+    { SEG_REST, 20 }, { SEG_TILT, 30 }, { SEG_FIDGET, 15 }, { SEG_WALK, 25 },
+    { SEG_REST, 15 }, { SEG_RUN, 15 }, { SEG_REST, 20 },
+};
+static const char *const seg_names[] = { "rest", "posture", "fidget", "walk", "run" };
+static const char *const level_names[] = { "rest", "light", "HEAVY" };
+
+static hx_icm_sample samples[MAX_SAMPLES];
+static hx_icm_sample parsed[MAX_SAMPLES];
+static uint8_t label[MAX_SAMPLES];
+static hx_imuact_epoch epochs[MAX_EPOCHS];
+static uint32_t num_epochs;
+static hx_imuact ia;
+
+/* synthesis */
+
+static uint32_t rng_state = 0x6d2b79f5u;
+
+static double uniform(void)
+{
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+    return (rng_state >> 8) / 16777216.0;
+}
+
+static double gauss(void)
+{
+    double u = uniform() + 1e-12, v = uniform();
+
+    return sqrt(-2.0 * log(u)) * cos(2.0 * M_PI * v);
+}
+
+static int16_t lsb(double g)
+{
+    double v = g * LSB_PER_G + gauss() * 0.002 * LSB_PER_G;
+
+    return (int16_t)(v > 32767 ? 32767 : v < -32767 ? -32767 : lrint(v));
+}
+
+static uint32_t synth(void)
+{
+    uint32_t n = 0, s, i;
+    double tilt = 0.0;
+
+    for (s = 0; s < sizeof(segments) / sizeof(segments[0]); s++)
+    {
+        uint32_t len = segments[s].seconds * ODR_HZ;
+
+        for (i = 0; i < len && n < MAX_SAMPLES; i++, n++)
+        {
+            double t = (double)i / ODR_HZ, x = 0, y = 0, z = 0;
+            hx_icm_sample *p = &samples[n];
+
+            switch (segments[s].kind)
+            {
+            case SEG_TILT:
+                /* lying down: gravity from z to x over the segment */
+                tilt = 0.5 * M_PI * i / len;
+                break;
+            case SEG_FIDGET:
+                x = 0.08 * sin(2 * M_PI * 1.2 * t);
+                y = 0.06 * sin(2 * M_PI * 0.7 * t + 1.0);
+                break;
+            case SEG_WALK:
+                z = 0.35 * sin(2 * M_PI * 1.8 * t) + 0.08 * sin(2 * M_PI * 3.6 * t);
+                y = 0.15 * sin(2 * M_PI * 0.9 * t);
+                x = 0.10 * sin(2 * M_PI * 1.8 * t + 0.5);
+                break;
+            case SEG_RUN:
+                z = 1.2 * sin(2 * M_PI * 2.8 * t) + 0.4 * sin(2 * M_PI * 5.6 * t);
+                y = 0.4 * sin(2 * M_PI * 1.4 * t);
+                x = 0.3 * sin(2 * M_PI * 2.8 * t + 0.5);
+                break;
+            default:
+                break;
+            }
+            /* gravity in the sensor frame, the wearer turns with it */
+            p->ax = lsb(x + sin(tilt));
+            p->ay = lsb(y);
+            p->az = lsb(z + cos(tilt));
+            p->gx = (int16_t)lrint(gauss() * 4);
+            p->gy = (int16_t)lrint(gauss() * 4);
+            p->gz = (int16_t)lrint(gauss() * 4);
+            p->ts = (uint16_t)(n * 10);
+            label[n] = (uint8_t)s;
+        }
+    }
+    return n;
+}
+
+static int write_dump(const char *path, uint32_t n)
+{
+    FILE *f = fopen(path, "wb");
+    uint8_t pkt[16];
+    uint32_t i;
+
+    if (f == NULL)
+    {
+        printf("%s: cannot write\n", path);
+        return -1;
+    }
+    for (i = 0; i < n; i++)
+    {
+        hx_icmfifo_pack(&samples[i], pkt);
+        fwrite(pkt, 1, sizeof(pkt), f);
+    }
+    fclose(f);
+    return 0;
+}
+
+static uint8_t *load(const char *path, uint32_t *len)
+{
+    FILE *f = fopen(path, "rb");
+    uint8_t *buf;
+    long size;
+
+    if (f == NULL)
+        return NULL;
+    fseek(f, 0, SEEK_END);
+    size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    buf = malloc(size > 0 ? size : 1);
+    if (buf && fread(buf, 1, size, f) != (size_t)size)
+    {
+        free(buf);
+        buf = NULL;
+    }
+    fclose(f);
+    *len = (uint32_t)size;
+    return buf;
+}
+
+/* replay */
+
+static void on_epoch(void *arg, const hx_imuact_epoch *e)
+{
+    (void)arg;
+    if (num_epochs < sizeof(epochs) / sizeof(epochs[0]))
+        epochs[num_epochs++] = *e;
+}
+
+/*
+ * Feeds the dump as FIFO bursts; a cut packet stays in the burst buffer
+ * for the next read. With random set, bursts are of random length and
+ * some end in empty-FIFO filler.
+ */
+static uint32_t feed_dump(const uint8_t *dump, uint32_t len, int random, double *ns_per_sample)
+{
+    uint8_t burst[BURST_MAX + HX_ICMFIFO_PKT_MAX + 8];
+    hx_icm_sample out[BURST_MAX / 8 + 1];
+    uint32_t pos = 0, held = 0, total = 0;
+    clock_t busy = 0;
+
+    while (pos < len)
+    {
+        uint32_t take = random ? 1 + (uint32_t)(uniform() * BURST_MAX) : BURST_MAX;
+        uint32_t have, used, n;
+        int filler = 0;
+        clock_t c0;
+
+        if (take > len - pos)
+            take = len - pos;
+        memcpy(burst + held, dump + pos, take);
+        pos += take;
+        have = held + take;
+        /* a read past FIFO_COUNT, only after whole packets */
+        if (random && have % 16 == 0 && uniform() < 0.3)
+        {
+            filler = 1 + (int)(uniform() * 7);
+            memset(burst + have, 0x80, filler);
+            have += filler;
+        }
+
+        c0 = clock();
+        n = hx_icmfifo_parse(burst, have, out, sizeof(out) / sizeof(out[0]), &used);
+        hx_imuact_push(&ia, out, n);
+        busy += clock() - c0;
+
+        if (total + n <= MAX_SAMPLES)
+            memcpy(&parsed[total], out, n * sizeof(out[0]));
+        total += n;
+        held = have - used;
+        memmove(burst, burst + used, held);
+    }
+    if (held)
+        printf("  %u bytes of a cut packet left at the end\n", held);
+    *ns_per_sample = total ? (double)busy * 1e9 / CLOCKS_PER_SEC / total : 0.0;
+    return total;
+}
+
+static uint32_t parse_csv(const uint8_t *text, uint32_t len)
+{
+    uint32_t n = 0, pos = 0;
+    char line[128];
+
+    while (pos < len && n < MAX_SAMPLES)
+    {
+        uint32_t l = 0;
+        int ax, ay, az;
+
+        while (pos < len && text[pos] != '\n')
+        {
+            if (l < sizeof(line) - 1)
+                line[l++] = (char)text[pos];
+            pos++;
+        }
+        pos++;
+        line[l] = 0;
+        if (sscanf(line, "%d,%d,%d", &ax, &ay, &az) != 3)
+            continue;
+        memset(&samples[n], 0, sizeof(samples[n]));
+        samples[n].ax = (int16_t)ax;
+        samples[n].ay = (int16_t)ay;
+        samples[n].az = (int16_t)az;
+        n++;
+    }
+    return n;
+}
+
+static uint32_t true_heavy_pct(uint32_t from_ms, uint32_t to_ms, uint32_t n)
+{
+    uint32_t i, from = from_ms * ODR_HZ / 1000, to = to_ms * ODR_HZ / 1000, heavy = 0;
+
+    if (to > n)
+        to = n;
+    for (i = from; i < to; i++)
+    {
+        uint8_t k = segments[label[i]].kind;
+
+        heavy += k == SEG_WALK || k == SEG_RUN;
+    }
+    return to > from ? heavy * 100 / (to - from) : 0;
+}
+
+static int check_synth(const char *dir)
+{
+    char path[512];
+    uint8_t *dump;
+    uint32_t n, len, got, i, wrong = 0, scored = 0, gated = 0, bad_gate = 0, windows = 0;
+    hx_imuact_cfg cfg;
+    double ns;
+    int ok = 1;
+
+    n = synth();
+    snprintf(path, sizeof(path), "%s/synth.imu", dir);
+    if (write_dump(path, n) < 0 || (dump = load(path, &len)) == NULL)
+        return 0;
+
+    hx_imuact_default_cfg(&cfg, ODR_HZ, LSB_PER_G);
+    hx_imuact_init(&ia, &cfg, on_epoch, NULL);
+    num_epochs = 0;
+    got = feed_dump(dump, len, 1, &ns);
+    free(dump);
+    printf("%s: %u samples, %u epochs, %.0f ns per sample (parse and index)\n", path, got,
+            num_epochs, ns);
+
+    if (got != n || memcmp(parsed, samples, n * sizeof(samples[0])) != 0)
+    {
+        printf("  FAILED: %u of %u samples came back, or not bit exact\n", got, n);
+        ok = 0;
+    }
+
+    for (i = 0; i < num_epochs; i++)
+    {
+        uint32_t first = i * ODR_HZ, last = first + ODR_HZ - 1;
+        uint8_t kind = segments[label[first]].kind;
+        uint8_t want = kind == SEG_WALK || kind == SEG_RUN ? HX_IMUACT_HEAVY :
+                       kind == SEG_FIDGET ? HX_IMUACT_LIGHT : HX_IMUACT_REST;
+        int hit;
+
+        /* the first epoch of a segment is partly the one before */
+        if (i == 0 || label[first] != label[first - 1] || label[first] != label[last])
+            continue;
+        hit = kind == SEG_TILT ? epochs[i].level != HX_IMUACT_HEAVY : epochs[i].level == want;
+        scored++;
+        if (!hit)
+        {
+            wrong++;
+            printf("  epoch %u s, %s: %u mg, %s\n", i + 1, seg_names[kind], epochs[i].mg,
+                    level_names[epochs[i].level]);
+        }
+    }
+    for (i = 0; i < sizeof(segments) / sizeof(segments[0]); i++)
+    {
+        uint32_t from = 0, to, k, max = 0, sum = 0, cnt = 0;
+
+        for (k = 0; k < i; k++)
+            from += segments[k].seconds;
+        to = from + segments[i].seconds;
+        for (k = from + 1; k < to && k < num_epochs; k++)
+        {
+            sum += epochs[k].mg;
+            max = epochs[k].mg > max ? epochs[k].mg : max;
+            cnt++;
+        }
+        printf("  %-8s %3u s  %4u mg mean, %4u mg max\n", seg_names[segments[i].kind],
+                segments[i].seconds, cnt ? sum / cnt : 0, max);
+    }
+    printf("  levels: %u of %u epochs right\n", scored - wrong, scored);
+    if (wrong)
+        ok = 0;
+
+    for (i = WINDOW_MS; i <= n * 1000 / ODR_HZ; i += WINDOW_STEP_MS)
+    {
+        hx_imuact_summary sum;
+        uint32_t truth = true_heavy_pct(i - WINDOW_MS, i, n);
+        int gate;
+
+        hx_imuact_summarize(&ia, i - WINDOW_MS, i, &sum);
+        gate = sum.epochs && sum.heavy_pct >= HEAVY_PCT;
+        windows++;
+        gated += gate;
+        if ((gate && truth < 30) || (!gate && truth > 70))
+        {
+            bad_gate++;
+            printf("  window to %u s: %u%% heavy, %u%% by label, %s\n", i / 1000, sum.heavy_pct,
+                    truth, gate ? "gated" : "not gated");
+        }
+    }
+    printf("  gating: %u of %u windows gated, %u wrong\n", gated, windows, bad_gate);
+    if (bad_gate || gated == 0)
+        ok = 0;
+    return ok;
+}
+
+static void replay(const char *path, uint16_t odr_hz, uint16_t lsb_per_g)
+{
+    hx_imuact_cfg cfg;
+    uint8_t *data;
+    uint32_t len, n, i, counts[3] = { 0, 0, 0 };
+    size_t l = strlen(path);
+    double ns = 0.0;
+
+    data = load(path, &len);
+    if (data == NULL)
+    {
+        printf("%s: cannot read\n", path);
+        return;
+    }
+    hx_imuact_default_cfg(&cfg, odr_hz, lsb_per_g);
+    if (hx_imuact_init(&ia, &cfg, on_epoch, NULL) < 0)
+    {
+        printf("%u Hz does not make a %u ms epoch\n", odr_hz, cfg.epoch_ms);
+        free(data);
+        return;
+    }
+    num_epochs = 0;
+    if (l > 4 && strcmp(path + l - 4, ".csv") == 0)
+    {
+        n = parse_csv(data, len);
+        hx_imuact_push(&ia, samples, n);
+    }
+    else
+    {
+        n = feed_dump(data, len, 0, &ns);
+    }
+    free(data);
+
+    printf("%s: %u samples at %u Hz, %u epochs, light from %u mg, heavy from %u mg\n", path, n,
+            odr_hz, num_epochs, cfg.light_mg, cfg.heavy_mg);
+    for (i = 0; i < num_epochs; i++)
+    {
+        printf("  %6u.%03u s  %5u mg  %s\n", epochs[i].end_ms / 1000, epochs[i].end_ms % 1000,
+                epochs[i].mg, level_names[epochs[i].level]);
+        counts[epochs[i].level]++;
+    }
+    printf("  %u rest, %u light, %u heavy epochs\n", counts[0], counts[1], counts[2]);
+}
+
+int main(int argc, char **argv)
+{
+    if (argc == 3 && strcmp(argv[1], "--synth") == 0)
+    {
+        int ok = check_synth(argv[2]);
+
+        printf(ok ? "PASSED\n" : "FAILED\n");
+        return ok ? 0 : 1;
+    }
+    if (argc < 2)
+    {
+        printf("usage: %s --synth <dir> | <trace> [odr_hz] [lsb_per_g]\n", argv[0]);
+        return 1;
+    }
+    replay(argv[1], argc > 2 ? (uint16_t)atoi(argv[2]) : ODR_HZ,
+            argc > 3 ? (uint16_t)atoi(argv[3]) : LSB_PER_G);
+    return 0;
+}
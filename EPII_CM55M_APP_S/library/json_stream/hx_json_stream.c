@@ -0,0 +1,160 @@
+#include <string.h>
+#include "hx_json_stream.h"
+
+#if defined(__ARM_FEATURE_MVE) && (__ARM_FEATURE_MVE & 1)
+#include <arm_mve.h>
+#define HX_JSON_STREAM_HELIUM 1
+#endif
+
+static const char base64_table[64] = {
+    'A', 'B', 'C', 'D', 'E', 'F', 'G', 'H', 'I', 'J', 'K', 'L', 'M', 'N', 'O', 'P',
+    'Q', 'R', 'S', 'T', 'U', 'V', 'W', 'X', 'Y', 'Z', 'a', 'b', 'c', 'd', 'e', 'f',
+    'g', 'h', 'i', 'j', 'k', 'l', 'm', 'n', 'o', 'p', 'q', 'r', 's', 't', 'u', 'v',
+    'w', 'x', 'y', 'z', '0', '1', '2', '3', '4', '5', '6', '7', '8', '9', '+', '/'};
+
+#ifdef HX_JSON_STREAM_HELIUM
+/*
+ * 12 input bytes (4 groups a b c) give 16 output lanes. Lane j of a group
+ * takes its 6 bits from the byte pair (hi, lo):
+ *   j=0: a >> 2                  hi=a << -2, lo unused (>> 8)
+ *   j=1: (a & 3) << 4 | b >> 4   hi=a << 4,  lo=b >> 4
+ *   j=2: (b & 15) << 2 | c >> 6  hi=b << 2,  lo=c >> 6
+ *   j=3: c & 63                  hi=c,       lo unused (>> 8)
+ * then & 63 and a gather from the table.
+ */
+static const uint8_t base64_hi_offset[16] = {0, 0, 1, 2, 3, 3, 4, 5, 6, 6, 7, 8, 9, 9, 10, 11};
+static const uint8_t base64_lo_offset[16] = {0, 1, 2, 2, 3, 4, 5, 5, 6, 7, 8, 8, 9, 10, 11, 11};
+static const int8_t base64_hi_shift[16] = {-2, 4, 2, 0, -2, 4, 2, 0, -2, 4, 2, 0, -2, 4, 2, 0};
+static const int8_t base64_lo_shift[16] = {-8, -4, -6, -8, -8, -4, -6, -8, -8, -4, -6, -8, -8, -4, -6, -8};
+#endif
+
+size_t hx_base64_encode(const uint8_t *in, size_t len, char *out)
+{
+    char *p = out;
+
+#ifdef HX_JSON_STREAM_HELIUM
+    const uint8x16_t hi_offset = vld1q_u8(base64_hi_offset);
+    const uint8x16_t lo_offset = vld1q_u8(base64_lo_offset);
+    const int8x16_t hi_shift = vld1q_s8(base64_hi_shift);
+    const int8x16_t lo_shift = vld1q_s8(base64_lo_shift);
+
+    while (len >= 12) {
+        uint8x16_t hi = vldrbq_gather_offset_u8(in, hi_offset);
+        uint8x16_t lo = vldrbq_gather_offset_u8(in, lo_offset);
+        uint8x16_t idx = vorrq_u8(vshlq_u8(hi, hi_shift), vshlq_u8(lo, lo_shift));
+        idx = vandq_u8(idx, vdupq_n_u8(0x3f));
+        vstrbq_u8((uint8_t *)p, vldrbq_gather_offset_u8((const uint8_t *)base64_table, idx));
+        in += 12;
+        len -= 12;
+        p += 16;
+    }
+#endif
+
+    for (; len >= 3; len -= 3, in += 3) {
+        uint32_t v = ((uint32_t)in[0] << 16) | ((uint32_t)in[1] << 8) | in[2];
+        *p++ = base64_table[(v >> 18) & 0x3f];
+        *p++ = base64_table[(v >> 12) & 0x3f];
+        *p++ = base64_table[(v >> 6) & 0x3f];
+        *p++ = base64_table[v & 0x3f];
+    }
+    if (len) {
+        uint32_t v = (uint32_t)in[0] << 16;
+        if (len == 2)
+            v |= (uint32_t)in[1] << 8;
+        *p++ = base64_table[(v >> 18) & 0x3f];
+        *p++ = base64_table[(v >> 12) & 0x3f];
+        *p++ = (len == 2) ? base64_table[(v >> 6) & 0x3f] : '=';
+        *p++ = '=';
+    }
+    return (size_t)(p - out);
+}
+
+int hx_json_stream_init(hx_json_stream *s, char *buf, size_t size, hx_json_sink_fn sink, void *ctx)
+{
+    s->buf = buf;
+    s->size = size;
+    s->len = 0;
+    s->total = 0;
+    s->sink = sink;
+    s->ctx = ctx;
+    s->error = 0;
+    if (buf == NULL || size < HX_JSON_STREAM_MIN_BUFFER || sink == NULL) {
+        s->error = 1;
+        return -1;
+    }
+    return 0;
+}
+
+int hx_json_flush(hx_json_stream *s)
+{
+    if (s->len && !s->error) {
+        if (s->sink(s->ctx, s->buf, s->len) != 0)
+            s->error = 1;
+    }
+    s->len = 0;
+    return s->error ? -1 : 0;
+}
+
+void hx_json_put(hx_json_stream *s, const char *str, size_t len)
+{
+    while (len && !s->error) {
+        size_t room = s->size - s->len;
+        if (room == 0) {
+            hx_json_flush(s);
+            continue;
+        }
+        size_t n = len < room ? len : room;
+        memcpy(s->buf + s->len, str, n);
+        s->len += n;
+        s->total += n;
+        str += n;
+        len -= n;
+    }
+}
+
+void hx_json_puts(hx_json_stream *s, const char *str)
+{
+    hx_json_put(s, str, strlen(str));
+}
+
+void hx_json_put_uint(hx_json_stream *s, uint32_t v)
+{
+    char tmp[10];
+    int n = 0;
+
+    do {
+        tmp[sizeof(tmp) - 1 - n++] = (char)('0' + v % 10);
+        v /= 10;
+    } while (v);
+    hx_json_put(s, tmp + sizeof(tmp) - n, (size_t)n);
+}
+
+void hx_json_put_int(hx_json_stream *s, int32_t v)
+{
+    if (v < 0) {
+        hx_json_put(s, "-", 1);
+        hx_json_put_uint(s, (uint32_t)0 - (uint32_t)v);
+    } else {
+        hx_json_put_uint(s, (uint32_t)v);
+    }
+}
+
+void hx_json_put_base64(hx_json_stream *s, const uint8_t *data, size_t len)
+{
+    while (len && !s->error) {
+        size_t room = s->size - s->len;
+        if (room < 4) {
+            hx_json_flush(s);
+            continue;
+        }
+        /* whole groups that fit; a partial group only ends the data */
+        size_t n = (room / 4) * 3;
+        if (n > len)
+            n = len;
+        size_t out = hx_base64_encode(data, n, s->buf + s->len);
+        s->len += out;
+        s->total += out;
+        data += n;
+        len -= n;
+    }
+}
@@ -0,0 +1,75 @@
+#ifndef _LIB_HX_JSON_STREAM_H_
+#define _LIB_HX_JSON_STREAM_H_
+/*
+ * Allocation-free streaming writer for the JSON result replies.
+ *
+ * Text is appended to a caller-provided buffer; whenever the buffer is
+ * full it is handed to the sink (UART write, SPI/DMA transfer, ring
+ * buffer, ...) and reused, so a reply of any size (including the base64
+ * JPEG) needs only the buffer given at init time.
+ */
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/** Smallest buffer accepted by hx_json_stream_init() */
+#define HX_JSON_STREAM_MIN_BUFFER 16
+
+/**
+ * @brief Consumes len bytes of output.
+ * @return 0 on success, any other value aborts the stream
+ */
+typedef int (*hx_json_sink_fn)(void *ctx, const char *data, size_t len);
+
+typedef struct hx_json_stream {
+    char *buf;
+    size_t size;
+    size_t len;             /**< bytes pending in buf */
+    size_t total;           /**< bytes written since init */
+    hx_json_sink_fn sink;
+    void *ctx;
+    int error;              /**< sticky, set when the sink fails */
+} hx_json_stream;
+
+/**
+ * @brief Binds a stream to its buffer and sink.
+ * @return 0, or -1 if buf is smaller than HX_JSON_STREAM_MIN_BUFFER
+ */
+int hx_json_stream_init(hx_json_stream *s, char *buf, size_t size, hx_json_sink_fn sink, void *ctx);
+
+/** Appends len bytes of str */
+void hx_json_put(hx_json_stream *s, const char *str, size_t len);
+
+/** Appends a NUL-terminated string */
+void hx_json_puts(hx_json_stream *s, const char *str);
+
+/** Appends v in decimal, same text as std::to_string() */
+void hx_json_put_uint(hx_json_stream *s, uint32_t v);
+void hx_json_put_int(hx_json_stream *s, int32_t v);
+
+/** Appends the base64 encoding of data (with '=' padding) */
+void hx_json_put_base64(hx_json_stream *s, const uint8_t *data, size_t len);
+
+/**
+ * @brief Hands pending bytes to the sink.
+ * @return 0 if everything written so far reached the sink
+ */
+int hx_json_flush(hx_json_stream *s);
+
+/**
+ * @brief Encodes len bytes to base64 into out, which must hold
+ *        ((len + 2) / 3) * 4 bytes. No terminating NUL is written.
+ *        Full 12-byte blocks use Helium on Cortex-M55.
+ * @return number of characters written
+ */
+size_t hx_base64_encode(const uint8_t *in, size_t len, char *out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
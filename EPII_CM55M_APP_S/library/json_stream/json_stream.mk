@@ -0,0 +1,65 @@
+# directory declaration
+LIB_JSON_STREAM_DIR = $(LIBRARIES_ROOT)/json_stream
+
+LIB_JSON_STREAM_ASMSRCDIR	= $(LIB_JSON_STREAM_DIR)
+LIB_JSON_STREAM_CSRCDIR	= $(LIB_JSON_STREAM_DIR)
+LIB_JSON_STREAM_CXXSRCSDIR    = $(LIB_JSON_STREAM_DIR)
+LIB_JSON_STREAM_INCDIR	= $(LIB_JSON_STREAM_DIR)
+
+# find all the source files in the target directories
+LIB_JSON_STREAM_CSRCS = $(call get_csrcs, $(LIB_JSON_STREAM_CSRCDIR))
+LIB_JSON_STREAM_CXXSRCS = $(call get_cxxsrcs, $(LIB_JSON_STREAM_CXXSRCSDIR))
+LIB_JSON_STREAM_ASMSRCS = $(call get_asmsrcs, $(LIB_JSON_STREAM_ASMSRCDIR))
+
+# get object files
+LIB_JSON_STREAM_COBJS = $(call get_relobjs, $(LIB_JSON_STREAM_CSRCS))
+LIB_JSON_STREAM_CXXOBJS = $(call get_relobjs, $(LIB_JSON_STREAM_CXXSRCS))
+LIB_JSON_STREAM_ASMOBJS = $(call get_relobjs, $(LIB_JSON_STREAM_ASMSRCS))
+LIB_JSON_STREAM_OBJS = $(LIB_JSON_STREAM_COBJS) $(LIB_JSON_STREAM_ASMOBJS) $(LIB_JSON_STREAM_CXXOBJS)
+
+# get dependency files
+LIB_JSON_STREAM_DEPS = $(call get_deps, $(LIB_JSON_STREAM_OBJS))
+
+# extra macros to be defined
+LIB_JSON_STREAM_DEFINES = -DLIB_JSON_STREAM
+
+# genearte library
+ifeq ($(JSONSTREAM_LIB_FORCE_PREBUILT), y)
+override LIB_JSON_STREAM_OBJS:=
+endif
+JSON_STREAM_LIB_NAME = lib_json_stream.a
+LIB_LIB_JSON_STREAM := $(subst /,$(PS), $(strip $(OUT_DIR)/$(JSON_STREAM_LIB_NAME)))
+
+# library generation rule
+$(LIB_LIB_JSON_STREAM): $(LIB_JSON_STREAM_OBJS)
+	$(TRACE_ARCHIVE)
+ifeq "$(strip $(LIB_JSON_STREAM_OBJS))" ""
+	$(CP) $(PREBUILT_LIB)$(JSON_STREAM_LIB_NAME) $(LIB_LIB_JSON_STREAM)
+else
+	$(Q)$(AR) $(AR_OPT) $@ $(LIB_JSON_STREAM_OBJS)
+	$(CP) $(LIB_LIB_JSON_STREAM) $(PREBUILT_LIB)$(JSON_STREAM_LIB_NAME)
+endif
+
+# specific compile rules
+# user can add rules to compile this middleware
+# if not rules specified to this middleware, it will use default compiling rules
+
+# Middleware Definitions
+LIB_INCDIR += $(LIB_JSON_STREAM_INCDIR)
+LIB_CSRCDIR += $(LIB_JSON_STREAM_CSRCDIR)
+LIB_CXXSRCDIR += $(LIB_JSON_STREAM_CXXSRCDIR)
+LIB_ASMSRCDIR += $(LIB_JSON_STREAM_ASMSRCDIR)
+
+LIB_CSRCS += $(LIB_JSON_STREAM_CSRCS)
+LIB_CXXSRCS += $(LIB_JSON_STREAM_CXXSRCS)
+LIB_ASMSRCS += $(LIB_JSON_STREAM_ASMSRCS)
+LIB_ALLSRCS += $(LIB_JSON_STREAM_CSRCS) $(LIB_JSON_STREAM_ASMSRCS)
+
+LIB_COBJS += $(LIB_JSON_STREAM_COBJS)
+LIB_CXXOBJS += $(LIB_JSON_STREAM_CXXOBJS)
+LIB_ASMOBJS += $(LIB_JSON_STREAM_ASMOBJS)
+LIB_ALLOBJS += $(LIB_JSON_STREAM_OBJS)
+
+LIB_DEFINES += $(LIB_JSON_STREAM_DEFINES)
+LIB_DEPS += $(LIB_JSON_STREAM_DEPS)
+LIB_LIBS += $(LIB_LIB_JSON_STREAM)
\ No newline at end of file
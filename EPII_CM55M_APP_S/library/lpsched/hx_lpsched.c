@@ -0,0 +1,270 @@
+/*
+ * hx_lpsched.c
+ *
+ * Scheduling policy and bookkeeping of hx_lpsched, no hardware access; the
+ * chip is behind hx_lpsched_port (hx_lpsched_we2.c).
+ */
+#include <string.h>
+#include "hx_lpsched.h"
+
+#define HX_LPSCHED_MAGIC 0x4C505343
+
+/*
+ * Estimates of the WE2 EVB at 400 MHz until measured, see README.md.
+ * WFI uses the CM55M timer, whose resolution is 1 ms. The PD wake-up
+ * includes the re-init of the app and the model, which the app measures.
+ */
+const hx_lpsched_cost hx_lpsched_default_cost[HX_LPSCHED_STATE_NUM] = {
+    /* wake_us  boot_us  min_sleep_us */
+    {      0,       0,        0 },      /* ACTIVE */
+    {     50,       0,     1000 },      /* WFI */
+    {  15000,    3000,    50000 },      /* PD_RET */
+    {  60000,   20000,   500000 },      /* PD */
+};
+
+static const char *const state_name[HX_LPSCHED_STATE_NUM] = {
+    "ACTIVE", "WFI", "PD_RET", "PD"
+};
+
+const char *hx_lpsched_state_name(hx_lpsched_state state)
+{
+    return (unsigned)state < HX_LPSCHED_STATE_NUM ? state_name[state] : "?";
+}
+
+/* larger measurements count at once, smaller ones decay in by 1/8 */
+static void note_wake(hx_lpsched *s, hx_lpsched_state state, uint32_t lat)
+{
+    uint32_t w = s->wake_us[state];
+
+    s->last_wake_us[state] = lat;
+    s->wake_us[state] = lat >= w ? lat : w - (w - lat) / 8;
+}
+
+int hx_lpsched_init(hx_lpsched *s, const hx_lpsched_port *port, const hx_lpsched_cost *cost)
+{
+    int st;
+
+    if (cost == NULL)
+        cost = hx_lpsched_default_cost;
+
+    if (s->magic == HX_LPSCHED_MAGIC &&
+        s->sleep_state > HX_LPSCHED_WFI && s->sleep_state < HX_LPSCHED_STATE_NUM &&
+        port->pd_wakeup())
+    {
+        /* the measured wake-up latencies and the schedule carry on */
+        s->port = port;
+        memcpy(s->cost, cost, sizeof(s->cost));
+        s->num_jobs = 0;
+        s->resumed = 1;
+        return 1;
+    }
+
+    memset(s, 0, sizeof(*s));
+    s->magic = HX_LPSCHED_MAGIC;
+    s->port = port;
+    memcpy(s->cost, cost, sizeof(s->cost));
+    for (st = 0; st < HX_LPSCHED_STATE_NUM; st++)
+        s->wake_us[st] = cost[st].wake_us;
+    /* a PD wake-up without the struct: the latency is still measured */
+    if (port->pd_wakeup())
+        s->sleep_state = HX_LPSCHED_PD;
+    return 0;
+}
+
+int hx_lpsched_add(hx_lpsched *s, const hx_lpsched_job *job)
+{
+    hx_lpsched_slot *slot;
+
+    if (job->period_us == 0 || s->num_jobs >= HX_LPSCHED_MAX_JOBS)
+        return -1;
+
+    slot = &s->slot[s->num_jobs];
+    if (!s->resumed || slot->period_us != job->period_us)
+    {
+        /* new job, due at hx_lpsched_start() */
+        memset(slot, 0, sizeof(*slot));
+        slot->period_us = job->period_us;
+    }
+    slot->job = job;
+    return s->num_jobs++;
+}
+
+uint64_t hx_lpsched_now(const hx_lpsched *s)
+{
+    return s->port->now_us() + s->epoch_us;
+}
+
+hx_lpsched_state hx_lpsched_start(hx_lpsched *s)
+{
+    uint64_t boot_us = s->port->now_us();
+    hx_lpsched_state st = (hx_lpsched_state)s->sleep_state;
+    uint32_t lat;
+    int i;
+
+    /* the timer fired, then the bootrom and the app ran until here */
+    lat = s->cost[st].boot_us + (uint32_t)boot_us;
+    if (st != HX_LPSCHED_ACTIVE)
+        note_wake(s, st, lat);
+
+    if (s->resumed)
+    {
+        s->epoch_us = s->sleep_at_us + s->sleep_len_us + s->cost[st].boot_us;
+        s->stats.entries[st]++;
+        s->stats.sleep_us[st] += s->sleep_len_us;
+        s->stats.wake_us[st] += lat;
+    }
+    else
+    {
+        s->epoch_us = 0;
+        s->start_us = boot_us;
+    }
+    s->sleep_state = HX_LPSCHED_ACTIVE;
+
+    /* new jobs start their period now */
+    for (i = 0; i < s->num_jobs; i++)
+    {
+        if (s->slot[i].runs == 0 && s->slot[i].due_us == 0)
+            s->slot[i].due_us = boot_us + s->epoch_us;
+    }
+    return st;
+}
+
+hx_lpsched_state hx_lpsched_pick(const hx_lpsched *s, uint64_t gap_us, hx_lpsched_state deepest)
+{
+    int st;
+
+    for (st = deepest; st > HX_LPSCHED_ACTIVE; st--)
+    {
+        if (gap_us >= (uint64_t)s->wake_us[st] + s->cost[st].min_sleep_us + HX_LPSCHED_GUARD_US)
+            return (hx_lpsched_state)st;
+    }
+    return HX_LPSCHED_ACTIVE;
+}
+
+static hx_lpsched_slot *earliest(hx_lpsched *s)
+{
+    hx_lpsched_slot *next = NULL;
+    int i;
+
+    for (i = 0; i < s->num_jobs; i++)
+    {
+        if (next == NULL || s->slot[i].due_us < next->due_us)
+            next = &s->slot[i];
+    }
+    return next;
+}
+
+static void run_job(hx_lpsched *s, hx_lpsched_slot *slot, uint64_t now)
+{
+    const hx_lpsched_job *job = slot->job;
+    uint64_t late = now - slot->due_us;
+    uint64_t end;
+    uint32_t run_us;
+
+    if (late > job->late_us)
+    {
+        slot->misses++;
+        s->stats.misses++;
+    }
+    if (late > s->stats.max_late_us)
+        s->stats.max_late_us = late > UINT32_MAX ? UINT32_MAX : (uint32_t)late;
+
+    job->run(job->arg);
+    end = hx_lpsched_now(s);
+    run_us = (uint32_t)(end - now);
+    if (run_us > slot->run_max_us)
+        slot->run_max_us = run_us;
+    slot->runs++;
+    s->stats.runs++;
+
+    /* periods that already ended while it ran are skipped, as misses */
+    slot->due_us += job->period_us;
+    while (slot->due_us + job->late_us < end)
+    {
+        slot->due_us += job->period_us;
+        slot->misses++;
+        s->stats.misses++;
+    }
+}
+
+void hx_lpsched_run(hx_lpsched *s)
+{
+    hx_lpsched_slot *next;
+    hx_lpsched_state st, deepest;
+    uint64_t now, gap, woke;
+    uint32_t len, slept;
+    int i;
+
+    if (s->num_jobs == 0)
+        return;
+
+    now = hx_lpsched_now(s);
+    while ((next = earliest(s))->due_us <= now)
+    {
+        run_job(s, next, now);
+        now = hx_lpsched_now(s);
+    }
+    s->stats.total_us = now - s->start_us;
+
+    deepest = HX_LPSCHED_PD;
+    for (i = 0; i < s->num_jobs; i++)
+    {
+        if (s->slot[i].job->deepest < deepest)
+            deepest = s->slot[i].job->deepest;
+    }
+    gap = next->due_us - now;
+    st = hx_lpsched_pick(s, gap, deepest);
+    if (st == HX_LPSCHED_ACTIVE)
+        return;
+
+    len = (uint32_t)(gap - s->wake_us[st] - HX_LPSCHED_GUARD_US);
+    if (st != HX_LPSCHED_WFI)
+    {
+        /* hx_lpsched_init() and hx_lpsched_start() take it from here */
+        s->sleep_state = st;
+        s->sleep_at_us = now;
+        s->sleep_len_us = len;
+        s->port->sleep(st, len);
+        /* only if the port could not power down */
+        s->sleep_state = HX_LPSCHED_ACTIVE;
+        return;
+    }
+
+    slept = s->port->sleep(st, len);
+    if (slept == 0)
+        return;
+    woke = hx_lpsched_now(s);
+    note_wake(s, st, woke > now + slept ? (uint32_t)(woke - now - slept) : 0);
+    s->stats.entries[st]++;
+    s->stats.sleep_us[st] += slept;
+    s->stats.wake_us[st] += s->last_wake_us[st];
+}
+
+void hx_lpsched_report(const hx_lpsched *s, void (*print)(const char *fmt, ...))
+{
+    const hx_lpsched_stats *st = &s->stats;
+    uint64_t asleep = 0, active;
+    uint32_t total_ms = (uint32_t)(st->total_us / 1000);
+    int i;
+
+    for (i = 0; i < HX_LPSCHED_STATE_NUM; i++)
+        asleep += st->sleep_us[i] + st->wake_us[i];
+    active = st->total_us > asleep ? st->total_us - asleep : 0;
+
+    print("lpsched: %u ms, active %u ms (%u%%), %u runs, %u missed, max late %u us\n",
+            total_ms, (uint32_t)(active / 1000),
+            total_ms ? (uint32_t)(active / 10 / total_ms) : 0,
+            st->runs, st->misses, st->max_late_us);
+    for (i = HX_LPSCHED_WFI; i < HX_LPSCHED_STATE_NUM; i++)
+    {
+        print("  %s: %u sleeps, %u ms asleep, %u ms waking, wake-up %u us (last %u us)\n",
+                state_name[i], st->entries[i], (uint32_t)(st->sleep_us[i] / 1000),
+                (uint32_t)(st->wake_us[i] / 1000), s->wake_us[i], s->last_wake_us[i]);
+    }
+    for (i = 0; i < s->num_jobs; i++)
+    {
+        print("  job %s: every %u us, %u runs, %u missed, longest %u us\n",
+                s->slot[i].job->name, s->slot[i].period_us, s->slot[i].runs,
+                s->slot[i].misses, s->slot[i].run_max_us);
+    }
+}
@@ -0,0 +1,186 @@
+#ifndef _LIB_HX_LPSCHED_H_
+#define _LIB_HX_LPSCHED_H_
+/*
+ * Tickless duty cycling of periodic jobs, such as an AF check every N
+ * heartbeats or a camera frame every T ms, in the deepest power state that
+ * still meets the next deadline.
+ *
+ * hx_lpsched_run() runs the jobs that are due, earliest first, then takes
+ * the gap until the next one and sleeps in the deepest state whose wake-up
+ * latency plus break-even residency fits in it:
+ *   ACTIVE  no sleep, the gap is too short; hx_lpsched_run() returns
+ *   WFI     the CPU waits in __WFI for the CM55M timer, nothing is lost
+ *   PD_RET  PMU power down, TCM and HSC SRAM retained, warm boot
+ *   PD      PMU power down without retention, warm boot reloads the image
+ * The wake-up timer is set to the deadline minus the wake-up latency; there
+ * is no periodic tick.
+ *
+ * The PD states do not return, the chip warm boots into app_main() again.
+ * The app calls hx_lpsched_init() and hx_lpsched_add() on every boot, and
+ * hx_lpsched_start() once its init (drivers, model) is done. If the
+ * hx_lpsched struct was retained (keep it in .bss.NoInit) the schedule goes
+ * on where it stopped, otherwise every job starts at hx_lpsched_start().
+ * The app keeps its own progress the same way, or in an AON register for PD.
+ *
+ * Wake-up latencies start at the cost table given to hx_lpsched_init() and
+ * follow what is measured: the lateness of the timer wake-up for WFI, and
+ * boot_us plus the time from reset to hx_lpsched_start() for the PD states,
+ * which includes re-initializing the model. A larger measurement is taken
+ * at once, a smaller one decays in slowly.
+ *
+ * Usage, bare metal (FreeRTOS owns SysTick and has its own tickless idle):
+ *   static hx_lpsched sched __attribute__((section(".bss.NoInit")));
+ *   hx_lpsched_init(&sched, &hx_lpsched_we2_port, NULL);
+ *   hx_lpsched_add(&sched, &af_job);
+ *   init drivers and model
+ *   hx_lpsched_start(&sched);
+ *   for (;;)
+ *       hx_lpsched_run(&sched);
+ */
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#ifndef HX_LPSCHED_MAX_JOBS
+#define HX_LPSCHED_MAX_JOBS 4
+#endif
+
+/** Margin kept between the planned wake-up and the deadline */
+#ifndef HX_LPSCHED_GUARD_US
+#define HX_LPSCHED_GUARD_US 200
+#endif
+
+typedef enum hx_lpsched_state {
+    HX_LPSCHED_ACTIVE = 0,
+    HX_LPSCHED_WFI,
+    HX_LPSCHED_PD_RET,
+    HX_LPSCHED_PD,
+    HX_LPSCHED_STATE_NUM
+} hx_lpsched_state;
+
+/** Cost of one state, see hx_lpsched_default_cost */
+typedef struct hx_lpsched_cost {
+    uint32_t wake_us;       /**< first estimate of the wake-up latency, until measured */
+    uint32_t boot_us;       /**< part of the wake-up before the CPU runs (bootrom), not measurable by the app */
+    uint32_t min_sleep_us;  /**< break-even residency: shorter sleeps cost more than they save */
+} hx_lpsched_cost;
+
+/**
+ * Platform of the scheduler, hx_lpsched_we2_port on the chip.
+ */
+typedef struct hx_lpsched_port {
+    /** microseconds since reset, monotonic */
+    uint64_t (*now_us)(void);
+    /**
+     * Sleeps in state for about us. WFI returns once the timer fired and
+     * gives the time it programmed (0 if us is below its resolution). The
+     * PD states do not return.
+     */
+    uint32_t (*sleep)(hx_lpsched_state state, uint32_t us);
+    /** 1 if this boot is a PMU timer wake-up from PD */
+    int (*pd_wakeup)(void);
+} hx_lpsched_port;
+
+typedef struct hx_lpsched_job {
+    const char *name;
+    uint32_t period_us;
+    uint32_t late_us;               /**< start later than due + late_us is a miss */
+    hx_lpsched_state deepest;       /**< deepest state allowed while the job waits */
+    void (*run)(void *arg);
+    void *arg;
+} hx_lpsched_job;
+
+/** Time spent per state since the first hx_lpsched_start() */
+typedef struct hx_lpsched_stats {
+    uint64_t total_us;
+    uint64_t sleep_us[HX_LPSCHED_STATE_NUM];    /**< time asleep, wake-up excluded */
+    uint64_t wake_us[HX_LPSCHED_STATE_NUM];     /**< time waking up */
+    uint32_t entries[HX_LPSCHED_STATE_NUM];
+    uint32_t runs;
+    uint32_t misses;
+    uint32_t max_late_us;
+} hx_lpsched_stats;
+
+typedef struct hx_lpsched_slot {
+    const hx_lpsched_job *job;
+    uint64_t due_us;
+    uint32_t period_us;             /**< to recognise the job after a warm boot */
+    uint32_t run_max_us;
+    uint32_t runs;
+    uint32_t misses;
+} hx_lpsched_slot;
+
+typedef struct hx_lpsched {
+    uint32_t magic;
+    const hx_lpsched_port *port;
+    hx_lpsched_cost cost[HX_LPSCHED_STATE_NUM];
+    uint32_t wake_us[HX_LPSCHED_STATE_NUM];     /**< wake-up latency in use */
+    uint32_t last_wake_us[HX_LPSCHED_STATE_NUM];/**< last measurement */
+    hx_lpsched_slot slot[HX_LPSCHED_MAX_JOBS];
+    uint8_t num_jobs;
+    uint8_t resumed;                /**< the schedule survived the last boot */
+    uint8_t sleep_state;            /**< PD state entered or woken up from, HX_LPSCHED_ACTIVE when awake */
+    uint64_t epoch_us;              /**< schedule time = port->now_us() + epoch_us */
+    uint64_t start_us;
+    uint64_t sleep_at_us;
+    uint32_t sleep_len_us;
+    hx_lpsched_stats stats;
+} hx_lpsched;
+
+/** Estimates until measured on the chip, see README.md */
+extern const hx_lpsched_cost hx_lpsched_default_cost[HX_LPSCHED_STATE_NUM];
+
+/** The WE2 port: SysTick clock, CM55M timer 2, PMU power down */
+extern const hx_lpsched_port hx_lpsched_we2_port;
+
+/**
+ * Sets up the scheduler, keeping the schedule of a retained struct when
+ * this boot is a PD wake-up.
+ *
+ * @param[in] cost  HX_LPSCHED_STATE_NUM entries, NULL for hx_lpsched_default_cost
+ * @return 1 if the schedule was resumed, 0 if it starts over
+ */
+int hx_lpsched_init(hx_lpsched *s, const hx_lpsched_port *port, const hx_lpsched_cost *cost);
+
+/**
+ * Registers a job. After a resume the jobs must be added in the same order.
+ * @return job id, or -1 if the table is full or the period is 0
+ */
+int hx_lpsched_add(hx_lpsched *s, const hx_lpsched_job *job);
+
+/**
+ * Ends the boot: measures the wake-up latency when the boot is a PD
+ * wake-up, and carries on a resumed schedule.
+ * @return the state woken up from, HX_LPSCHED_ACTIVE for a cold boot
+ */
+hx_lpsched_state hx_lpsched_start(hx_lpsched *s);
+
+/**
+ * Runs the due jobs, then sleeps until the next one. Returns after a WFI
+ * wake-up, or at once when the gap is too short to sleep.
+ */
+void hx_lpsched_run(hx_lpsched *s);
+
+/** Schedule time in microseconds */
+uint64_t hx_lpsched_now(const hx_lpsched *s);
+
+/**
+ * The policy: deepest state, not deeper than deepest, whose wake-up latency
+ * and break-even residency fit in gap_us.
+ */
+hx_lpsched_state hx_lpsched_pick(const hx_lpsched *s, uint64_t gap_us, hx_lpsched_state deepest);
+
+/** Active against sleep time, per state, and the jobs */
+void hx_lpsched_report(const hx_lpsched *s, void (*print)(const char *fmt, ...));
+
+/** "ACTIVE", "WFI", "PD_RET", "PD" */
+const char *hx_lpsched_state_name(hx_lpsched_state state);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _LIB_HX_LPSCHED_H_ */
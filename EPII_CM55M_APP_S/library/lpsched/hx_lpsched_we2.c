@@ -0,0 +1,197 @@
+/*
+ * hx_lpsched_we2.c
+ *
+ * hx_lpsched_port of the WE2: SysTick clock, CM55M timer 2 for WFI and as
+ * the PMU wake-up timer, PD through the pwrmgmt library.
+ */
+#include <string.h>
+#include "WE2_device.h"
+#include "WE2_core.h"
+#include "hx_drv_timer.h"
+#include "hx_drv_swreg_aon.h"
+#include "hx_drv_pmu_export.h"
+#include "hx_drv_pmu.h"
+#include "powermode.h"
+#include "hx_lpsched.h"
+
+#define WE2_SYSTICK_PERIOD  (SysTick_LOAD_RELOAD_Msk + 1)
+
+static uint64_t we2_base_us;    /* SysTick restarts, time slept without SysTick */
+static uint64_t we2_last_us;
+static volatile uint8_t we2_timer_fired;
+
+static uint64_t we2_now_us(void)
+{
+    uint32_t tick, loop, tick2, loop2, clk;
+    uint64_t us;
+
+    /* SysTick counts down; a wrap between the two reads, read again */
+    do {
+        SystemGetTick(&tick, &loop);
+        SystemGetTick(&tick2, &loop2);
+    } while (loop != loop2 || tick2 > tick);
+
+    EPII_Get_Systemclock(&clk);
+    us = ((uint64_t)loop * WE2_SYSTICK_PERIOD + (WE2_SYSTICK_PERIOD - 1 - tick)) / (clk / 1000000);
+
+    /* SystemCoreClockUpdate() clears the loop count */
+    if (us + we2_base_us < we2_last_us)
+        we2_base_us = we2_last_us - us;
+    we2_last_us = us + we2_base_us;
+    return we2_last_us;
+}
+
+static void we2_timer_cb(uint32_t event)
+{
+    we2_timer_fired = 1;
+}
+
+static void we2_wfi(uint32_t ms)
+{
+    TIMER_CFG_T timer_cfg;
+    uint64_t before, after;
+
+    timer_cfg.period = ms;
+    timer_cfg.mode = TIMER_MODE_ONESHOT;
+    timer_cfg.ctrl = TIMER_CTRL_CPU;
+    timer_cfg.state = TIMER_STATE_DC;
+
+    before = we2_now_us();
+    we2_timer_fired = 0;
+    hx_drv_timer_cm55m_start(&timer_cfg, we2_timer_cb);
+
+    /* with PRIMASK set a pending interrupt still ends __WFI(), so the timer
+     * cannot fire between the check and the sleep; SysTick wakes it too */
+    __disable_irq();
+    while (!we2_timer_fired)
+    {
+        __WFI();
+        __enable_irq();
+        __disable_irq();
+    }
+    __enable_irq();
+
+    /* in case SysTick stopped with the core clock */
+    after = we2_now_us();
+    if (after < before + (uint64_t)ms * 1000)
+    {
+        we2_base_us += before + (uint64_t)ms * 1000 - after;
+        we2_last_us += before + (uint64_t)ms * 1000 - after;
+    }
+}
+
+static void we2_pd(uint32_t ms, uint32_t retention)
+{
+    PM_PD_NOVIDPRE_CFG_T cfg;
+    uint32_t freq;
+    SCU_LSC_CLK_CFG_T lsc_cfg;
+    SCU_PDHSC_HSCCLK_CFG_T hsc_cfg;
+    PM_CFG_PWR_MODE_E mode;
+    SCU_PLL_FREQ_E pmuwakeup_pll_freq;
+    SCU_HSCCLKDIV_E pmuwakeup_cm55m_div;
+    SCU_LSCCLKDIV_E pmuwakeup_cm55s_div;
+    SWREG_AON_RETENTION_E skip = retention ? SWREG_AON_RETENTION : SWREG_AON_NO_RETENTION;
+    PM_MEM_RET_E ret = retention ? PM_MEM_RET_YES : PM_MEM_RET_NO;
+    TIMER_CFG_T timer_cfg;
+
+    /*Clear PMU Wakeup Event*/
+    hx_lib_pm_clear_event();
+    hx_drv_timer_ClearIRQ(TIMER_ID_2);
+
+    /*Warm boot at the clock of now*/
+    hx_drv_swreg_aon_get_pmuwakeup_freq(&pmuwakeup_pll_freq, &pmuwakeup_cm55m_div, &pmuwakeup_cm55s_div);
+    hx_drv_swreg_aon_get_pllfreq(&freq);
+
+    mode = PM_MODE_PS_NOVID_PREROLLING;
+    hx_lib_pm_get_defcfg_bymode(&cfg, mode);
+
+    cfg.bootromspeed.bootromclkfreq = pmuwakeup_pll_freq;
+    cfg.bootromspeed.pll_freq = freq;
+    cfg.bootromspeed.cm55m_div = pmuwakeup_cm55m_div;
+    cfg.bootromspeed.cm55s_div = pmuwakeup_cm55s_div;
+
+    cfg.cm55s_reset = SWREG_AON_PMUWAKE_CM55S_RERESET_YES;
+    /*Only Timer2 wakes up*/
+    cfg.pmu_rtc_mask = PM_RTC_INT_MASK_ALLMASK;
+    cfg.pmu_pad_pa01_mask = PM_IP_INT_MASK;
+    cfg.pmu_pad_pa23_mask = PM_IP_INT_MASK;
+    cfg.pmu_i2cw_mask = PM_IP_INT_MASK;
+    cfg.pmu_cmp_mask = PM_IP_INT_MASK;
+    cfg.pmu_ts_mask = PM_IP_INT_MASK;
+    cfg.pmu_anti_mask = PM_IP_INT_MASK;
+    cfg.pmu_timer_mask = PM_TIMER_INT_MASK_TIMER_ALLMASK & ~PM_TIMER_INT_MASK_TIMER2;
+    cfg.support_debugdump = 0;
+
+    /*PD_RET keeps TCM and HSC SRAM and skips reloading the image*/
+    cfg.tcm_retention = ret;
+    cfg.hscsram_retention[0] = ret;
+    cfg.hscsram_retention[1] = ret;
+    cfg.hscsram_retention[2] = ret;
+    cfg.hscsram_retention[3] = ret;
+    cfg.lscsram_retention = PM_MEM_RET_NO;
+    cfg.skip_bootflow.sec_mem_flag = skip;
+    cfg.skip_bootflow.first_bl_flag = skip;
+    cfg.skip_bootflow.cm55m_s_app_flag = skip;
+    cfg.skip_bootflow.cm55m_ns_app_flag = skip;
+    cfg.skip_bootflow.cm55s_s_app_flag = SWREG_AON_NO_RETENTION;
+    cfg.skip_bootflow.cm55s_ns_app_flag = SWREG_AON_NO_RETENTION;
+    cfg.skip_bootflow.cm55m_model_flag = skip;
+    cfg.skip_bootflow.cm55s_model_flag = SWREG_AON_NO_RETENTION;
+    cfg.skip_bootflow.cm55m_appcfg_flag = skip;
+    cfg.skip_bootflow.cm55s_appcfg_flag = SWREG_AON_NO_RETENTION;
+    cfg.skip_bootflow.cm55m_s_app_rwdata_flag = SWREG_AON_NO_RETENTION;
+    cfg.skip_bootflow.cm55m_ns_app_rwdata_flag = SWREG_AON_NO_RETENTION;
+    cfg.skip_bootflow.cm55s_s_app_rwdata_flag = SWREG_AON_NO_RETENTION;
+    cfg.skip_bootflow.cm55s_ns_app_rwdata_flag = SWREG_AON_NO_RETENTION;
+    cfg.skip_bootflow.secure_debug_flag = skip;
+
+    cfg.support_bootwithcap = PM_BOOTWITHCAP_NO;
+    cfg.pmu_dcdc_outpin = PM_CFG_DCDC_MODE_OFF;
+    cfg.ioret = PM_CFG_PD_IORET_ON;
+    cfg.sensor_type = PM_SENSOR_TIMING_FVLDLVLD_CON;
+    cfg.simo_pd_onoff = PM_SIMO_PD_ONOFF_ON;
+
+    hx_lib_pm_cfg_set(&cfg, NULL, mode);
+
+    /* Timer2 as the PMU wake-up timer */
+    timer_cfg.period = ms;
+    timer_cfg.mode = TIMER_MODE_ONESHOT;
+    timer_cfg.ctrl = TIMER_CTRL_PMU;
+    timer_cfg.state = TIMER_STATE_PMU;
+    hx_drv_timer_cm55m_start(&timer_cfg, NULL);
+
+    /* Use PMU lib to control HSC_CLK and LSC_CLK so set those parameter to 0 */
+    memset(&hsc_cfg, 0, sizeof(SCU_PDHSC_HSCCLK_CFG_T));
+    memset(&lsc_cfg, 0, sizeof(SCU_LSC_CLK_CFG_T));
+    hx_lib_pm_trigger(hsc_cfg, lsc_cfg, PM_CLK_PARA_CTRL_BYPMLIB);
+}
+
+static uint32_t we2_sleep(hx_lpsched_state state, uint32_t us)
+{
+    uint32_t ms = us / 1000;
+
+    if (ms == 0)
+        return 0;
+    if (state == HX_LPSCHED_WFI)
+    {
+        we2_wfi(ms);
+        return ms * 1000;
+    }
+    we2_pd(ms, state == HX_LPSCHED_PD_RET);
+    /* not reached, the wake-up is a warm boot */
+    return 0;
+}
+
+static int we2_pd_wakeup(void)
+{
+    uint32_t wakeup_event;
+
+    hx_drv_pmu_get_ctrl(PMU_pmu_wakeup_EVT, &wakeup_event);
+    return (wakeup_event & PMU_WAKEUP_PD_SB_TIMER_INT) != 0;
+}
+
+const hx_lpsched_port hx_lpsched_we2_port = {
+    we2_now_us,
+    we2_sleep,
+    we2_pd_wakeup,
+};
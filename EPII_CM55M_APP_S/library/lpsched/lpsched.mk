@@ -0,0 +1,65 @@
+# directory declaration
+LIB_LPSCHED_DIR = $(LIBRARIES_ROOT)/lpsched
+
+LIB_LPSCHED_ASMSRCDIR	= $(LIB_LPSCHED_DIR)
+LIB_LPSCHED_CSRCDIR	= $(LIB_LPSCHED_DIR)
+LIB_LPSCHED_CXXSRCSDIR    = $(LIB_LPSCHED_DIR)
+LIB_LPSCHED_INCDIR	= $(LIB_LPSCHED_DIR)
+
+# find all the source files in the target directories
+LIB_LPSCHED_CSRCS = $(call get_csrcs, $(LIB_LPSCHED_CSRCDIR))
+LIB_LPSCHED_CXXSRCS = $(call get_cxxsrcs, $(LIB_LPSCHED_CXXSRCSDIR))
+LIB_LPSCHED_ASMSRCS = $(call get_asmsrcs, $(LIB_LPSCHED_ASMSRCDIR))
+
+# get object files
+LIB_LPSCHED_COBJS = $(call get_relobjs, $(LIB_LPSCHED_CSRCS))
+LIB_LPSCHED_CXXOBJS = $(call get_relobjs, $(LIB_LPSCHED_CXXSRCS))
+LIB_LPSCHED_ASMOBJS = $(call get_relobjs, $(LIB_LPSCHED_ASMSRCS))
+LIB_LPSCHED_OBJS = $(LIB_LPSCHED_COBJS) $(LIB_LPSCHED_ASMOBJS) $(LIB_LPSCHED_CXXOBJS)
+
+# get dependency files
+LIB_LPSCHED_DEPS = $(call get_deps, $(LIB_LPSCHED_OBJS))
+
+# extra macros to be defined
+LIB_LPSCHED_DEFINES = -DLIB_LPSCHED
+
+# genearte library
+ifeq ($(LPSCHED_LIB_FORCE_PREBUILT), y)
+override LIB_LPSCHED_OBJS:=
+endif
+LPSCHED_LIB_NAME = lib_lpsched.a
+LIB_LIB_LPSCHED := $(subst /,$(PS), $(strip $(OUT_DIR)/$(LPSCHED_LIB_NAME)))
+
+# library generation rule
+$(LIB_LIB_LPSCHED): $(LIB_LPSCHED_OBJS)
+	$(TRACE_ARCHIVE)
+ifeq "$(strip $(LIB_LPSCHED_OBJS))" ""
+	$(CP) $(PREBUILT_LIB)$(LPSCHED_LIB_NAME) $(LIB_LIB_LPSCHED)
+else
+	$(Q)$(AR) $(AR_OPT) $@ $(LIB_LPSCHED_OBJS)
+	$(CP) $(LIB_LIB_LPSCHED) $(PREBUILT_LIB)$(LPSCHED_LIB_NAME)
+endif
+
+# specific compile rules
+# user can add rules to compile this middleware
+# if not rules specified to this middleware, it will use default compiling rules
+
+# Middleware Definitions
+LIB_INCDIR += $(LIB_LPSCHED_INCDIR)
+LIB_CSRCDIR += $(LIB_LPSCHED_CSRCDIR)
+LIB_CXXSRCDIR += $(LIB_LPSCHED_CXXSRCDIR)
+LIB_ASMSRCDIR += $(LIB_LPSCHED_ASMSRCDIR)
+
+LIB_CSRCS += $(LIB_LPSCHED_CSRCS)
+LIB_CXXSRCS += $(LIB_LPSCHED_CXXSRCS)
+LIB_ASMSRCS += $(LIB_LPSCHED_ASMSRCS)
+LIB_ALLSRCS += $(LIB_LPSCHED_CSRCS) $(LIB_LPSCHED_ASMSRCS)
+
+LIB_COBJS += $(LIB_LPSCHED_COBJS)
+LIB_CXXOBJS += $(LIB_LPSCHED_CXXOBJS)
+LIB_ASMOBJS += $(LIB_LPSCHED_ASMOBJS)
+LIB_ALLOBJS += $(LIB_LPSCHED_OBJS)
+
+LIB_DEFINES += $(LIB_LPSCHED_DEFINES)
+LIB_DEPS += $(LIB_LPSCHED_DEPS)
+LIB_LIBS += $(LIB_LIB_LPSCHED)
\ No newline at end of file
@@ -0,0 +1,332 @@
+/*
+ * Host simulation of the hx_lpsched policy.
+ *
+ *   hx_lpsched_sim [log]
+ *
+ * The scheduler runs on a simulated clock. Jobs take their run time, WFI
+ * wakes up a little late, and the PD states end in a simulated warm boot:
+ * the timer fires, the bootrom takes boot_us of the cost table, the app
+ * re-initializes and calls hx_lpsched_init(), hx_lpsched_add() and
+ * hx_lpsched_start() again. PD without retention also wipes the
+ * hx_lpsched struct.
+ *
+ * Wake-up latencies are drawn from the log of af_detect_testbench run with
+ * AF_DUTY_PERIOD_MS, which prints after each PD wake-up:
+ *
+ *   lpsched wake <WFI|PD_RET|PD> <us>
+ *
+ * other lines of the log are skipped. States without a sample in the log,
+ * or all of them without a log, use the spread built in below, and the
+ * scenarios are checked (make check): no job starts more than late_us
+ * after one period since its last start, on the simulated wall clock, and
+ * most of the idle time is spent in the expected state.
+ */
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "hx_lpsched.h"
+
+#define SIM_SAMPLES 256
+#define SIM_SECONDS 120
+#define SIM_COLD_INIT_US 80000
+
+typedef struct {
+    const char *name;
+    uint32_t period_us;
+    uint32_t run_us;
+    uint32_t late_us;
+    hx_lpsched_state deepest;
+} scenario_job;
+
+typedef struct {
+    const char *name;
+    int num_jobs;
+    scenario_job job[2];
+    hx_lpsched_state expect;        /* state with the most idle time */
+    uint32_t max_misses;
+    uint32_t first_pd_ret_wake_us;  /* 0, or an estimate that is too low */
+} scenario;
+
+typedef struct {
+    hx_lpsched_job job;
+    uint32_t run_us;
+    uint64_t last_wall_us;
+    uint32_t runs;
+    uint32_t misses;
+    uint32_t max_err_us;
+} sim_job;
+
+/* latencies, us */
+static uint32_t sample[HX_LPSCHED_STATE_NUM][SIM_SAMPLES];
+static int num_samples[HX_LPSCHED_STATE_NUM];
+static int next_sample[HX_LPSCHED_STATE_NUM];
+
+static uint64_t sim_time_us;        /* wall clock */
+static uint64_t sim_reset_us;       /* wall clock of the last reset */
+static uint32_t sim_init_us;        /* app init of the boot in progress */
+static int sim_boot_state;          /* PD state the boot wakes up from, 0 for cold */
+static jmp_buf sim_boot;
+
+static uint64_t sim_asleep_us[HX_LPSCHED_STATE_NUM];
+static uint64_t sim_waking_us[HX_LPSCHED_STATE_NUM];
+static uint32_t sim_sleeps[HX_LPSCHED_STATE_NUM];
+
+static hx_lpsched sched;
+static hx_lpsched_cost cost[HX_LPSCHED_STATE_NUM];
+static sim_job jobs[2];
+
+static uint32_t rng_state = 0x2545f491u;
+
+static uint32_t rng(void)
+{
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+    return rng_state;
+}
+
+static uint32_t spread(uint32_t lo, uint32_t hi)
+{
+    return lo + rng() % (hi - lo + 1);
+}
+
+/* total wake-up latency: bootrom and app init for the PD states */
+static uint32_t wake_latency(hx_lpsched_state st)
+{
+    if (num_samples[st])
+    {
+        uint32_t v = sample[st][next_sample[st]];
+
+        next_sample[st] = (next_sample[st] + 1) % num_samples[st];
+        return v;
+    }
+    switch (st)
+    {
+    case HX_LPSCHED_WFI:
+        return spread(5, 30);
+    case HX_LPSCHED_PD_RET:
+        return spread(9000, 13000);
+    case HX_LPSCHED_PD:
+        return spread(45000, 58000);
+    default:
+        return 0;
+    }
+}
+
+static uint64_t sim_now_us(void)
+{
+    /* every look at the clock costs a little, so polling moves time on */
+    sim_time_us += 1;
+    return sim_time_us - sim_reset_us;
+}
+
+static uint32_t sim_sleep(hx_lpsched_state st, uint32_t us)
+{
+    uint32_t ms = us / 1000;
+    uint32_t lat;
+
+    if (ms == 0)
+        return 0;
+    lat = wake_latency(st);
+    sim_sleeps[st]++;
+    sim_asleep_us[st] += (uint64_t)ms * 1000;
+    sim_waking_us[st] += lat;
+    sim_time_us += (uint64_t)ms * 1000;
+    if (st == HX_LPSCHED_WFI)
+    {
+        sim_time_us += lat;
+        return ms * 1000;
+    }
+
+    /* the bootrom, then the app starts over */
+    sim_time_us += cost[st].boot_us;
+    sim_init_us = lat > cost[st].boot_us ? lat - cost[st].boot_us : 0;
+    if (st == HX_LPSCHED_PD)
+        memset(&sched, 0x5a, sizeof(sched));
+    longjmp(sim_boot, st);
+}
+
+static int sim_pd_wakeup(void)
+{
+    return sim_boot_state != 0;
+}
+
+static const hx_lpsched_port sim_port = {
+    sim_now_us,
+    sim_sleep,
+    sim_pd_wakeup,
+};
+
+static void sim_run(void *arg)
+{
+    sim_job *j = (sim_job *)arg;
+
+    if (j->last_wall_us)
+    {
+        uint64_t interval = sim_time_us - j->last_wall_us;
+        uint32_t err = (uint32_t)(interval > j->job.period_us ? interval - j->job.period_us
+                                                              : j->job.period_us - interval);
+
+        /* early is not a miss, it is the interval after a late start */
+        if (interval > (uint64_t)j->job.period_us + j->job.late_us)
+            j->misses++;
+        if (err > j->max_err_us)
+            j->max_err_us = err;
+    }
+    j->last_wall_us = sim_time_us;
+    j->runs++;
+    sim_time_us += spread(j->run_us * 9 / 10, j->run_us * 11 / 10);
+}
+
+static void print(const char *fmt, ...)
+{
+    va_list ap;
+
+    va_start(ap, fmt);
+    vprintf(fmt, ap);
+    va_end(ap);
+}
+
+static void sim_boot_app(const scenario *sc, uint64_t end_us)
+{
+    int i;
+
+    sim_boot_state = setjmp(sim_boot);
+    sim_reset_us = sim_time_us;
+    hx_lpsched_init(&sched, &sim_port, cost);
+    for (i = 0; i < sc->num_jobs; i++)
+        hx_lpsched_add(&sched, &jobs[i].job);
+    sim_time_us += sim_boot_state ? sim_init_us : SIM_COLD_INIT_US;
+    hx_lpsched_start(&sched);
+
+    while (sim_time_us < end_us)
+        hx_lpsched_run(&sched);
+}
+
+static int run_scenario(const scenario *sc)
+{
+    uint64_t end_us, idle = 0, total;
+    uint32_t misses = 0;
+    int i, best = HX_LPSCHED_WFI, ok;
+
+    memcpy(cost, hx_lpsched_default_cost, sizeof(cost));
+    if (sc->first_pd_ret_wake_us)
+        cost[HX_LPSCHED_PD_RET].wake_us = sc->first_pd_ret_wake_us;
+    memset(&sched, 0, sizeof(sched));
+    memset(jobs, 0, sizeof(jobs));
+    memset(sim_asleep_us, 0, sizeof(sim_asleep_us));
+    memset(sim_waking_us, 0, sizeof(sim_waking_us));
+    memset(sim_sleeps, 0, sizeof(sim_sleeps));
+    for (i = 0; i < sc->num_jobs; i++)
+    {
+        jobs[i].job.name = sc->job[i].name;
+        jobs[i].job.period_us = sc->job[i].period_us;
+        jobs[i].job.late_us = sc->job[i].late_us;
+        jobs[i].job.deepest = sc->job[i].deepest;
+        jobs[i].job.run = sim_run;
+        jobs[i].job.arg = &jobs[i];
+        jobs[i].run_us = sc->job[i].run_us;
+    }
+
+    sim_time_us = 0;
+    end_us = (uint64_t)SIM_SECONDS * 1000000;
+    sim_boot_app(sc, end_us);
+    total = sim_time_us;
+
+    printf("%s:\n", sc->name);
+    for (i = HX_LPSCHED_WFI; i < HX_LPSCHED_STATE_NUM; i++)
+    {
+        idle += sim_asleep_us[i] + sim_waking_us[i];
+        if (sim_asleep_us[i] > sim_asleep_us[best])
+            best = i;
+        printf("  %-6s %6u sleeps, %6.1f%% asleep, %5.2f%% waking\n", hx_lpsched_state_name(i),
+                sim_sleeps[i], 100.0 * sim_asleep_us[i] / total, 100.0 * sim_waking_us[i] / total);
+    }
+    printf("  active %.2f%% of %u s\n", 100.0 * (total - idle) / total, SIM_SECONDS);
+    for (i = 0; i < sc->num_jobs; i++)
+    {
+        misses += jobs[i].misses;
+        printf("  %s: %u runs, %u late by more than %u us, worst %u us off\n", jobs[i].job.name,
+                jobs[i].runs, jobs[i].misses, jobs[i].job.late_us, jobs[i].max_err_us);
+    }
+    printf("  since the last boot, as logged on the chip:\n  ");
+    hx_lpsched_report(&sched, print);
+
+    ok = misses <= sc->max_misses && best == (int)sc->expect;
+    if (!ok)
+        printf("  FAILED: %u misses (%u allowed), most sleep in %s instead of %s\n", misses,
+                sc->max_misses, hx_lpsched_state_name(best), hx_lpsched_state_name(sc->expect));
+    return ok;
+}
+
+static int load_log(const char *path)
+{
+    char line[256], name[16];
+    unsigned us;
+    FILE *f = fopen(path, "r");
+    int n = 0, st;
+
+    if (f == NULL)
+    {
+        perror(path);
+        return -1;
+    }
+    while (fgets(line, sizeof(line), f))
+    {
+        const char *p = strstr(line, "lpsched wake ");
+
+        if (p == NULL || sscanf(p, "lpsched wake %15s %u", name, &us) != 2)
+            continue;
+        for (st = HX_LPSCHED_WFI; st < HX_LPSCHED_STATE_NUM; st++)
+        {
+            if (strcmp(name, hx_lpsched_state_name(st)) == 0 && num_samples[st] < SIM_SAMPLES)
+            {
+                sample[st][num_samples[st]++] = us;
+                n++;
+            }
+        }
+    }
+    fclose(f);
+    for (st = HX_LPSCHED_WFI; st < HX_LPSCHED_STATE_NUM; st++)
+        printf("%s: %d wake-up samples from %s\n", hx_lpsched_state_name(st), num_samples[st], path);
+    return n;
+}
+
+static const scenario scenarios[] = {
+    { "AF check every 8 heartbeats at 75 bpm", 1,
+      { { "af", 6400000, 15000, 50000, HX_LPSCHED_PD } },
+      HX_LPSCHED_PD, 0, 0 },
+    { "camera frame every 200 ms", 1,
+      { { "frame", 200000, 40000, 5000, HX_LPSCHED_PD } },
+      HX_LPSCHED_PD_RET, 0, 0 },
+    { "camera at 30 fps", 1,
+      { { "frame", 33333, 20000, 2000, HX_LPSCHED_PD } },
+      HX_LPSCHED_WFI, 0, 0 },
+    { "AF check and a camera frame every 500 ms, sensor kept", 2,
+      { { "af", 6400000, 15000, 50000, HX_LPSCHED_PD },
+        { "frame", 500000, 40000, 20000, HX_LPSCHED_PD_RET } },
+      HX_LPSCHED_PD_RET, 0, 0 },
+    { "camera frame every 200 ms, PD_RET wake-up underestimated", 1,
+      { { "frame", 200000, 40000, 5000, HX_LPSCHED_PD } },
+      HX_LPSCHED_PD_RET, 1, 4000 },
+};
+
+int main(int argc, char **argv)
+{
+    int i, failed = 0, check = argc < 2;
+
+    if (!check && load_log(argv[1]) < 0)
+        return 1;
+
+    for (i = 0; i < (int)(sizeof(scenarios) / sizeof(scenarios[0])); i++)
+    {
+        if (!run_scenario(&scenarios[i]))
+            failed++;
+    }
+    if (!check)
+        return 0;
+    printf(failed ? "FAILED\n" : "PASSED\n");
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,287 @@
+#ifndef _LIB_HX_NMS_H_
+#define _LIB_HX_NMS_H_
+/*
+ * Header-only non-maximum suppression for the YOLO scenario apps.
+ *
+ * - Boxes are kept in fixed-capacity SoA arrays, nothing is allocated.
+ * - Candidates are not sorted: a max-heap is built in O(n) and popped only
+ *   until max_keep boxes are kept or top_k candidates were visited.
+ * - Each popped box is tested against the boxes kept so far. The IoU test
+ *   runs on 4 kept boxes at a time with Helium (MVE) on Cortex-M55.
+ *
+ * Usage:
+ *   static hx_nms_boxes boxes;
+ *   uint16_t keep[HX_NMS_MAX_KEEP];
+ *   hx_nms_reset(&boxes);
+ *   hx_nms_add(&boxes, x, y, w, h, score, class_idx);   // per candidate
+ *   int n = hx_nms_run(&boxes, 0.45f, HX_NMS_CLASS_AGNOSTIC, 0, 10, keep);
+ *   // keep[0..n-1] index boxes.x/y/w/h/score/group, highest score first
+ */
+#include <stdint.h>
+#include <math.h>
+
+#if defined(__ARM_FEATURE_MVE) && (__ARM_FEATURE_MVE & 1)
+#include <arm_mve.h>
+#define HX_NMS_HELIUM 1
+#endif
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/** Max candidate boxes per run; when full the lowest score is replaced */
+#ifndef HX_NMS_MAX_BOXES
+#define HX_NMS_MAX_BOXES 1024
+#endif
+
+/** Max boxes one run can keep */
+#ifndef HX_NMS_MAX_KEEP
+#define HX_NMS_MAX_KEEP 64
+#endif
+
+/** DIoU penalty exponent, same as darknet beta_nms */
+#ifndef HX_NMS_DIOU_BETA
+#define HX_NMS_DIOU_BETA 0.6f
+#endif
+
+/** hx_nms_run() mode flags */
+#define HX_NMS_CLASS_AGNOSTIC   0x0  /**< any kept box suppresses any other box */
+#define HX_NMS_PER_GROUP        0x1  /**< boxes only suppress boxes of the same group (class aware or batched) */
+#define HX_NMS_DIOU             0x2  /**< suppress on DIoU instead of IoU (scalar only) */
+
+typedef struct hx_nms_boxes {
+    /** candidates, (x, y) is the top-left corner */
+    float x[HX_NMS_MAX_BOXES];
+    float y[HX_NMS_MAX_BOXES];
+    float w[HX_NMS_MAX_BOXES];
+    float h[HX_NMS_MAX_BOXES];
+    float score[HX_NMS_MAX_BOXES];
+    /** class index for class aware NMS, or image/ROI index for batched NMS */
+    uint16_t group[HX_NMS_MAX_BOXES];
+    int count;
+    /** candidates lost because the arrays were full */
+    int dropped;
+
+    /* work area of hx_nms_run() */
+    uint16_t heap[HX_NMS_MAX_BOXES];
+    float kept_x1[HX_NMS_MAX_KEEP];
+    float kept_y1[HX_NMS_MAX_KEEP];
+    float kept_x2[HX_NMS_MAX_KEEP];
+    float kept_y2[HX_NMS_MAX_KEEP];
+    float kept_area[HX_NMS_MAX_KEEP];
+    int32_t kept_group[HX_NMS_MAX_KEEP];
+} hx_nms_boxes;
+
+static inline void hx_nms_reset(hx_nms_boxes *b)
+{
+    b->count = 0;
+    b->dropped = 0;
+}
+
+/**
+ * @brief Adds a candidate box.
+ *
+ * @param[in] x, y  top-left corner
+ * @param[in] w, h  size
+ * @return index of the box, or -1 if the arrays are full and score is not
+ *         above the lowest stored score
+ */
+static inline int hx_nms_add(hx_nms_boxes *b, float x, float y, float w, float h, float score, uint16_t group)
+{
+    int slot = b->count;
+    if (slot == HX_NMS_MAX_BOXES) {
+        slot = 0;
+        for (int i = 1; i < b->count; i++) {
+            if (b->score[i] < b->score[slot])
+                slot = i;
+        }
+        b->dropped++;
+        if (b->score[slot] >= score)
+            return -1;
+    } else {
+        b->count++;
+    }
+    b->x[slot] = x;
+    b->y[slot] = y;
+    b->w[slot] = w;
+    b->h[slot] = h;
+    b->score[slot] = score;
+    b->group[slot] = group;
+    return slot;
+}
+
+/** Adds a candidate given by its center */
+static inline int hx_nms_add_center(hx_nms_boxes *b, float cx, float cy, float w, float h, float score, uint16_t group)
+{
+    return hx_nms_add(b, cx - w / 2, cy - h / 2, w, h, score, group);
+}
+
+/* Heap order: higher score first, lower index first on equal scores */
+static inline int hx_nms_before(const hx_nms_boxes *b, uint16_t i, uint16_t j)
+{
+    return b->score[i] > b->score[j] || (b->score[i] == b->score[j] && i < j);
+}
+
+static inline void hx_nms_sift_down(hx_nms_boxes *b, int pos, int n)
+{
+    uint16_t *heap = b->heap;
+    uint16_t v = heap[pos];
+    for (;;) {
+        int child = 2 * pos + 1;
+        if (child >= n)
+            break;
+        if (child + 1 < n && hx_nms_before(b, heap[child + 1], heap[child]))
+            child++;
+        if (!hx_nms_before(b, heap[child], v))
+            break;
+        heap[pos] = heap[child];
+        pos = child;
+    }
+    heap[pos] = v;
+}
+
+/* Scalar IoU test, the same expression as the Helium path */
+static inline int hx_nms_iou_over(float ax1, float ay1, float ax2, float ay2, float a_area,
+                                  float bx1, float by1, float bx2, float by2, float b_area, float threshold)
+{
+    float iw = (ax2 < bx2 ? ax2 : bx2) - (ax1 > bx1 ? ax1 : bx1);
+    float ih = (ay2 < by2 ? ay2 : by2) - (ay1 > by1 ? ay1 : by1);
+    iw = iw > 0.0f ? iw : 0.0f;
+    ih = ih > 0.0f ? ih : 0.0f;
+    float inter = iw * ih;
+    float uni = (a_area + b_area) - inter;
+    /* inter / uni > threshold without the division */
+    return inter > uni * threshold;
+}
+
+static inline int hx_nms_diou_over(float ax1, float ay1, float ax2, float ay2, float a_area,
+                                   float bx1, float by1, float bx2, float by2, float b_area, float threshold)
+{
+    float iw = (ax2 < bx2 ? ax2 : bx2) - (ax1 > bx1 ? ax1 : bx1);
+    float ih = (ay2 < by2 ? ay2 : by2) - (ay1 > by1 ? ay1 : by1);
+    iw = iw > 0.0f ? iw : 0.0f;
+    ih = ih > 0.0f ? ih : 0.0f;
+    float inter = iw * ih;
+    float uni = (a_area + b_area) - inter;
+    float iou = (inter == 0.0f || uni == 0.0f) ? 0.0f : inter / uni;
+
+    /* squared center distance over squared diagonal of the enclosing box */
+    float cw = (ax2 > bx2 ? ax2 : bx2) - (ax1 < bx1 ? ax1 : bx1);
+    float ch = (ay2 > by2 ? ay2 : by2) - (ay1 < by1 ? ay1 : by1);
+    float c = cw * cw + ch * ch;
+    if (c == 0.0f)
+        return iou > threshold;
+    float dx = ((ax1 + ax2) - (bx1 + bx2)) * 0.5f;
+    float dy = ((ay1 + ay2) - (by1 + by2)) * 0.5f;
+    float d = dx * dx + dy * dy;
+    return iou - powf(d / c, HX_NMS_DIOU_BETA) > threshold;
+}
+
+/* Returns 1 if box i overlaps one of the n kept boxes above threshold */
+static inline int hx_nms_suppressed(const hx_nms_boxes *b, int i, int n, float threshold, int mode)
+{
+    const float x1 = b->x[i];
+    const float y1 = b->y[i];
+    const float x2 = x1 + b->w[i];
+    const float y2 = y1 + b->h[i];
+    const float area = b->w[i] * b->h[i];
+    const int32_t group = (mode & HX_NMS_PER_GROUP) ? b->group[i] : 0;
+
+    if (mode & HX_NMS_DIOU) {
+        for (int k = 0; k < n; k++) {
+            if (b->kept_group[k] == group &&
+                hx_nms_diou_over(b->kept_x1[k], b->kept_y1[k], b->kept_x2[k], b->kept_y2[k], b->kept_area[k],
+                                 x1, y1, x2, y2, area, threshold))
+                return 1;
+        }
+        return 0;
+    }
+
+#ifdef HX_NMS_HELIUM
+    for (int k = 0; k < n; k += 4) {
+        mve_pred16_t p = vctp32q(n - k);
+        float32x4_t kx1 = vldrwq_z_f32(&b->kept_x1[k], p);
+        float32x4_t ky1 = vldrwq_z_f32(&b->kept_y1[k], p);
+        float32x4_t kx2 = vldrwq_z_f32(&b->kept_x2[k], p);
+        float32x4_t ky2 = vldrwq_z_f32(&b->kept_y2[k], p);
+        float32x4_t karea = vldrwq_z_f32(&b->kept_area[k], p);
+        int32x4_t kgroup = vldrwq_z_s32(&b->kept_group[k], p);
+
+        float32x4_t iw = vsubq_f32(vminnmq_f32(kx2, vdupq_n_f32(x2)), vmaxnmq_f32(kx1, vdupq_n_f32(x1)));
+        float32x4_t ih = vsubq_f32(vminnmq_f32(ky2, vdupq_n_f32(y2)), vmaxnmq_f32(ky1, vdupq_n_f32(y1)));
+        iw = vmaxnmq_f32(iw, vdupq_n_f32(0.0f));
+        ih = vmaxnmq_f32(ih, vdupq_n_f32(0.0f));
+        float32x4_t inter = vmulq_f32(iw, ih);
+        float32x4_t uni = vsubq_f32(vaddq_n_f32(karea, area), inter);
+        mve_pred16_t hit = vcmpgtq_m_f32(inter, vmulq_n_f32(uni, threshold), p);
+        hit = vcmpeqq_m_n_s32(kgroup, group, hit);
+        if (hit)
+            return 1;
+    }
+    return 0;
+#else
+    for (int k = 0; k < n; k++) {
+        if (b->kept_group[k] == group &&
+            hx_nms_iou_over(b->kept_x1[k], b->kept_y1[k], b->kept_x2[k], b->kept_y2[k], b->kept_area[k],
+                            x1, y1, x2, y2, area, threshold))
+            return 1;
+    }
+    return 0;
+#endif
+}
+
+/**
+ * @brief Greedy NMS over the boxes added since hx_nms_reset().
+ *
+ * A box is kept if no higher scored kept box overlaps it by more than
+ * threshold; the result equals sorting all candidates and suppressing
+ * pairwise, but only the popped part of the candidates is ordered.
+ *
+ * @param[in] b          candidates; the work area inside is overwritten
+ * @param[in] threshold  IoU (or DIoU) above which a box is suppressed
+ * @param[in] mode       HX_NMS_CLASS_AGNOSTIC, or HX_NMS_PER_GROUP and/or HX_NMS_DIOU
+ * @param[in] top_k      only the top_k highest scores take part, 0 for all
+ * @param[in] max_keep   stop after this many kept boxes, at most HX_NMS_MAX_KEEP
+ * @param[out] keep      indexes of the kept boxes, highest score first
+ * @return number of kept boxes
+ */
+static inline int hx_nms_run(hx_nms_boxes *b, float threshold, int mode, int top_k, int max_keep, uint16_t *keep)
+{
+    int n = b->count;
+    int kept = 0;
+
+    if (max_keep > HX_NMS_MAX_KEEP)
+        max_keep = HX_NMS_MAX_KEEP;
+    if (top_k <= 0 || top_k > n)
+        top_k = n;
+
+    for (int i = 0; i < n; i++)
+        b->heap[i] = (uint16_t)i;
+    for (int i = n / 2 - 1; i >= 0; i--)
+        hx_nms_sift_down(b, i, n);
+
+    for (int visited = 0; visited < top_k && kept < max_keep; visited++) {
+        uint16_t i = b->heap[0];
+        b->heap[0] = b->heap[--n];
+        hx_nms_sift_down(b, 0, n);
+
+        if (hx_nms_suppressed(b, i, kept, threshold, mode))
+            continue;
+
+        b->kept_x1[kept] = b->x[i];
+        b->kept_y1[kept] = b->y[i];
+        b->kept_x2[kept] = b->x[i] + b->w[i];
+        b->kept_y2[kept] = b->y[i] + b->h[i];
+        b->kept_area[kept] = b->w[i] * b->h[i];
+        b->kept_group[kept] = (mode & HX_NMS_PER_GROUP) ? b->group[i] : 0;
+        keep[kept++] = i;
+    }
+    return kept;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
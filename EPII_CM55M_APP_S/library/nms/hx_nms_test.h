@@ -0,0 +1,201 @@
+#ifndef _LIB_HX_NMS_TEST_H_
+#define _LIB_HX_NMS_TEST_H_
+/*
+ * Self test and benchmark of hx_nms.h, shared by the host build (test/)
+ * and the firmware (include it in one app source file and call
+ * hx_nms_test_run() with a tick counter).
+ *
+ * hx_nms_run() is compared with a plain reference: sort every candidate,
+ * then suppress pairwise with inter / union > threshold.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "hx_nms.h"
+
+#ifndef HX_NMS_TEST_PRINTF
+#define HX_NMS_TEST_PRINTF printf
+#endif
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/** Returns a free running tick count, used for the benchmark only */
+typedef uint32_t (*hx_nms_test_clock_fn)(void);
+
+static uint32_t hx_nms_test_rng = 0x13579bdu;
+
+static inline uint32_t hx_nms_test_rand(void)
+{
+    hx_nms_test_rng = hx_nms_test_rng * 1664525u + 1013904223u;
+    return hx_nms_test_rng >> 8;
+}
+
+/* uniform in [lo, hi) */
+static inline float hx_nms_test_uniform(float lo, float hi)
+{
+    return lo + (hi - lo) * (float)hx_nms_test_rand() / (float)(1u << 24);
+}
+
+/* Clustered boxes on a 192x192 input like a YOLO decode produces */
+static inline void hx_nms_test_fill(hx_nms_boxes *b, int count, int groups, int clusters)
+{
+    hx_nms_reset(b);
+    for (int i = 0; i < count; i++) {
+        float cx = 20.0f + 152.0f * (float)(i % clusters) / (float)clusters;
+        float cy = 20.0f + 152.0f * (float)((i * 7) % clusters) / (float)clusters;
+        float w = hx_nms_test_uniform(10.0f, 60.0f);
+        float h = hx_nms_test_uniform(10.0f, 60.0f);
+        cx += hx_nms_test_uniform(-8.0f, 8.0f);
+        cy += hx_nms_test_uniform(-8.0f, 8.0f);
+        /* coarse scores so that ties happen */
+        float score = (float)(hx_nms_test_rand() % 64) / 64.0f;
+        hx_nms_add(b, cx - w * 0.5f, cy - h * 0.5f, w, h, score, (uint16_t)(hx_nms_test_rand() % groups));
+    }
+}
+
+static inline int hx_nms_test_ref_over(const hx_nms_boxes *b, int i, int j, float threshold, int mode)
+{
+    if (mode & HX_NMS_DIOU) {
+        return hx_nms_diou_over(b->x[i], b->y[i], b->x[i] + b->w[i], b->y[i] + b->h[i], b->w[i] * b->h[i],
+                                b->x[j], b->y[j], b->x[j] + b->w[j], b->y[j] + b->h[j], b->w[j] * b->h[j],
+                                threshold);
+    }
+    float left = b->x[i] > b->x[j] ? b->x[i] : b->x[j];
+    float top = b->y[i] > b->y[j] ? b->y[i] : b->y[j];
+    float right = (b->x[i] + b->w[i]) < (b->x[j] + b->w[j]) ? (b->x[i] + b->w[i]) : (b->x[j] + b->w[j]);
+    float bot = (b->y[i] + b->h[i]) < (b->y[j] + b->h[j]) ? (b->y[i] + b->h[i]) : (b->y[j] + b->h[j]);
+    if (right <= left || bot <= top)
+        return 0 > threshold;
+    float inter = (right - left) * (bot - top);
+    float uni = b->w[i] * b->h[i] + b->w[j] * b->h[j] - inter;
+    if (uni == 0.0f)
+        return 0 > threshold;
+    return inter / uni > threshold;
+}
+
+static const hx_nms_boxes *hx_nms_test_sort_boxes;
+
+static inline int hx_nms_test_compare(const void *a, const void *b)
+{
+    uint16_t i = *(const uint16_t *)a;
+    uint16_t j = *(const uint16_t *)b;
+    return hx_nms_before(hx_nms_test_sort_boxes, i, j) ? -1 : 1;
+}
+
+/* Reference NMS: sort every candidate, then pairwise suppression */
+static inline int hx_nms_test_reference(const hx_nms_boxes *b, float threshold, int mode, int top_k, int max_keep,
+                                        uint16_t *keep)
+{
+    static uint16_t order[HX_NMS_MAX_BOXES];
+    static uint8_t removed[HX_NMS_MAX_BOXES];
+    int n = b->count;
+    int kept = 0;
+
+    for (int i = 0; i < n; i++)
+        order[i] = (uint16_t)i;
+    hx_nms_test_sort_boxes = b;
+    qsort(order, n, sizeof(order[0]), hx_nms_test_compare);
+    if (top_k <= 0 || top_k > n)
+        top_k = n;
+    if (max_keep > HX_NMS_MAX_KEEP)
+        max_keep = HX_NMS_MAX_KEEP;
+    memset(removed, 0, sizeof(removed));
+    for (int k = 0; k < top_k && kept < max_keep; k++) {
+        if (removed[k])
+            continue;
+        keep[kept++] = order[k];
+        for (int j = k + 1; j < top_k; j++) {
+            if ((mode & HX_NMS_PER_GROUP) && b->group[order[j]] != b->group[order[k]])
+                continue;
+            if (hx_nms_test_ref_over(b, order[k], order[j], threshold, mode))
+                removed[j] = 1;
+        }
+    }
+    return kept;
+}
+
+/**
+ * @brief Runs the equivalence tests and, if now is not NULL, the benchmark.
+ * @return number of failed cases
+ */
+static inline int hx_nms_test_run(hx_nms_test_clock_fn now)
+{
+    static hx_nms_boxes b;
+    static uint16_t keep[HX_NMS_MAX_KEEP];
+    static uint16_t ref_keep[HX_NMS_MAX_KEEP];
+    const int counts[] = {0, 1, 7, 100, 756, HX_NMS_MAX_BOXES};
+    const float thresholds[] = {0.45f, 0.0f, 0.7f};
+    const int modes[] = {HX_NMS_CLASS_AGNOSTIC, HX_NMS_PER_GROUP, HX_NMS_DIOU, HX_NMS_PER_GROUP | HX_NMS_DIOU};
+    int cases = 0;
+    int failures = 0;
+
+    for (unsigned c = 0; c < sizeof(counts) / sizeof(counts[0]); c++) {
+        for (unsigned t = 0; t < sizeof(thresholds) / sizeof(thresholds[0]); t++) {
+            for (unsigned m = 0; m < sizeof(modes) / sizeof(modes[0]); m++) {
+                for (int top_k = 0; top_k <= 50; top_k += 50) {
+                    hx_nms_test_fill(&b, counts[c], 1 + (int)(m + c) % 4, 24);
+                    int ref = hx_nms_test_reference(&b, thresholds[t], modes[m], top_k, HX_NMS_MAX_KEEP, ref_keep);
+                    int got = hx_nms_run(&b, thresholds[t], modes[m], top_k, HX_NMS_MAX_KEEP, keep);
+                    cases++;
+                    if (got != ref || memcmp(keep, ref_keep, got * sizeof(keep[0])) != 0) {
+                        HX_NMS_TEST_PRINTF("hx_nms FAIL count %d thr %d%% mode %d top_k %d: kept %d reference %d\r\n",
+                                           counts[c], (int)(thresholds[t] * 100), modes[m], top_k, got, ref);
+                        failures++;
+                    }
+                }
+            }
+        }
+    }
+
+    /* max_keep stops early but keeps the same prefix */
+    hx_nms_test_fill(&b, 756, 1, 200);
+    int ref = hx_nms_test_reference(&b, 0.45f, HX_NMS_CLASS_AGNOSTIC, 0, 10, ref_keep);
+    int got = hx_nms_run(&b, 0.45f, HX_NMS_CLASS_AGNOSTIC, 0, 10, keep);
+    cases++;
+    if (got != ref || got != 10 || memcmp(keep, ref_keep, got * sizeof(keep[0])) != 0) {
+        HX_NMS_TEST_PRINTF("hx_nms FAIL max_keep: kept %d reference %d\r\n", got, ref);
+        failures++;
+    }
+
+    /* a full array keeps the highest scores */
+    hx_nms_reset(&b);
+    for (int i = 0; i < HX_NMS_MAX_BOXES + 10; i++)
+        hx_nms_add(&b, (float)i, 0.0f, 1.0f, 1.0f, (float)i, 0);
+    cases++;
+    if (b.count != HX_NMS_MAX_BOXES || b.dropped != 10 || b.score[0] != (float)HX_NMS_MAX_BOXES) {
+        HX_NMS_TEST_PRINTF("hx_nms FAIL capacity: count %d dropped %d\r\n", b.count, b.dropped);
+        failures++;
+    }
+
+    HX_NMS_TEST_PRINTF("hx_nms: %d cases, %d failures\r\n", cases, failures);
+
+    if (now != NULL) {
+        const int runs = 20;
+        const int sizes[] = {100, 756};
+        for (unsigned s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+            uint32_t ref_ticks = 0, nms_ticks = 0;
+            for (int r = 0; r < runs; r++) {
+                hx_nms_test_fill(&b, sizes[s], 1, 40);
+                uint32_t t0 = now();
+                hx_nms_test_reference(&b, 0.45f, HX_NMS_CLASS_AGNOSTIC, 0, 10, ref_keep);
+                uint32_t t1 = now();
+                hx_nms_run(&b, 0.45f, HX_NMS_CLASS_AGNOSTIC, 0, 10, keep);
+                uint32_t t2 = now();
+                ref_ticks += t1 - t0;
+                nms_ticks += t2 - t1;
+            }
+            HX_NMS_TEST_PRINTF("hx_nms %d boxes, keep 10: reference %lu ticks, hx_nms_run %lu ticks\r\n", sizes[s],
+                               (unsigned long)(ref_ticks / runs), (unsigned long)(nms_ticks / runs));
+        }
+    }
+    return failures;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,13 @@
+# directory declaration
+LIB_NMS_DIR = $(LIBRARIES_ROOT)/nms
+
+LIB_NMS_INCDIR	= $(LIB_NMS_DIR)
+
+# header-only library, nothing to compile or archive
+
+# extra macros to be defined
+LIB_NMS_DEFINES = -DLIB_NMS
+
+# Middleware Definitions
+LIB_INCDIR += $(LIB_NMS_INCDIR)
+LIB_DEFINES += $(LIB_NMS_DEFINES)
@@ -0,0 +1,18 @@
+/*
+ * Host runner of hx_nms_test.h, ticks are microseconds.
+ */
+#define _POSIX_C_SOURCE 199309L
+#include <time.h>
+#include "hx_nms_test.h"
+
+static uint32_t host_now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)(ts.tv_sec * 1000000u + ts.tv_nsec / 1000);
+}
+
+int main(void)
+{
+    return hx_nms_test_run(host_now_us) ? 1 : 0;
+}
@@ -0,0 +1,250 @@
+#ifndef _LIB_HX_RING_H_
+#define _LIB_HX_RING_H_
+/*
+ * Header-only single producer / single consumer ring, for data handed from
+ * an ISR or a DMA callback to a task (or back).
+ *
+ * - The producer only writes head, the consumer only writes tail. Both are
+ *   free running, so no lock and no interrupt masking is needed and either
+ *   side may run in an ISR. Each index is published with a release store and
+ *   read by the other side with an acquire load (a DMB on Cortex-M55).
+ * - The ring holds count units of unit bytes, count a power of two, and all
+ *   count units are usable. A byte stream is unit 1; messages and DMA blocks
+ *   are fixed records of unit sizeof(record).
+ * - hx_ring_reserve()/hx_ring_commit() give the producer the free units up
+ *   to the wrap as one contiguous span, so a DMA can write the ring in place.
+ *   hx_ring_peek()/hx_ring_release() do the same for the consumer.
+ * - head and tail sit on separate cache lines. When a DMA writes the data,
+ *   align the storage with HX_RING_ALIGNED, keep unit * count a multiple of
+ *   HX_RING_CACHE_LINE, and invalidate each span returned by hx_ring_peek()
+ *   before reading it. The CPU never writes that storage, so invalidating
+ *   the whole lines around a span cannot lose data.
+ *
+ * Usage, UART RX DMA into a byte ring:
+ *   static uint8_t rx_buf[256] HX_RING_ALIGNED;
+ *   static hx_ring rx;
+ *   hx_ring_init(&rx, rx_buf, sizeof(rx_buf), 1);
+ *   p = hx_ring_reserve(&rx, &n);  dma_read(p, n);          // producer
+ *   hx_ring_commit(&rx, n);                                  // DMA done
+ *   n = hx_ring_read(&rx, dst, sizeof(dst));                 // consumer
+ */
+#include <stdint.h>
+#include <string.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/** Data cache line, 32 bytes on Cortex-M55 */
+#ifndef HX_RING_CACHE_LINE
+#if defined(__arm__) || defined(__ARM_ARCH)
+#define HX_RING_CACHE_LINE 32
+#else
+#define HX_RING_CACHE_LINE 64
+#endif
+#endif
+
+#define HX_RING_ALIGNED __attribute__((aligned(HX_RING_CACHE_LINE)))
+
+#define HX_RING_LOAD(p)         __atomic_load_n((p), __ATOMIC_RELAXED)
+#define HX_RING_LOAD_ACQ(p)     __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define HX_RING_STORE(p, v)     __atomic_store_n((p), (v), __ATOMIC_RELAXED)
+#define HX_RING_STORE_REL(p, v) __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+
+typedef struct hx_ring {
+    /** written by the producer */
+    uint32_t head HX_RING_ALIGNED;
+    /** units the producer could not store */
+    uint32_t dropped;
+
+    /** written by the consumer */
+    uint32_t tail HX_RING_ALIGNED;
+
+    /** set by hx_ring_init() */
+    uint8_t *buf HX_RING_ALIGNED;
+    uint32_t mask;
+    uint32_t unit;
+} hx_ring;
+
+/** Static form of hx_ring_init(), for a ring an ISR may use before any init */
+#define HX_RING_INITIALIZER(buf, count, unit) \
+    { 0, 0, 0, (uint8_t *)(buf), (count) - 1, (unit) }
+
+/**
+ * @brief Sets up an empty ring over buf.
+ *
+ * @param[in] buf    count * unit bytes
+ * @param[in] count  number of units, a power of two
+ * @param[in] unit   bytes per unit, 1 for a byte stream
+ * @return 0, or -1 if count is not a power of two or unit is 0
+ */
+static inline int hx_ring_init(hx_ring *r, void *buf, uint32_t count, uint32_t unit)
+{
+    if (count == 0 || (count & (count - 1)) != 0 || unit == 0)
+        return -1;
+    r->buf = (uint8_t *)buf;
+    r->mask = count - 1;
+    r->unit = unit;
+    r->head = 0;
+    r->tail = 0;
+    r->dropped = 0;
+    return 0;
+}
+
+/** Empties the ring. Only while neither side uses it. */
+static inline void hx_ring_reset(hx_ring *r)
+{
+    r->head = 0;
+    r->tail = 0;
+    r->dropped = 0;
+}
+
+/** Units stored, from either side */
+static inline uint32_t hx_ring_count(const hx_ring *r)
+{
+    return HX_RING_LOAD_ACQ(&r->head) - HX_RING_LOAD_ACQ(&r->tail);
+}
+
+/** Free units, from either side */
+static inline uint32_t hx_ring_space(const hx_ring *r)
+{
+    return r->mask + 1 - hx_ring_count(r);
+}
+
+/** Units the producer dropped, see hx_ring_write() and hx_ring_drop() */
+static inline uint32_t hx_ring_dropped(const hx_ring *r)
+{
+    return HX_RING_LOAD(&r->dropped);
+}
+
+/*---------------------------------------------------------------------------*/
+/* Producer */
+
+/**
+ * @brief Contiguous free units at head, up to the wrap.
+ *
+ * Nothing changes until hx_ring_commit(), so calling it again returns the
+ * same span (plus what the consumer freed meanwhile).
+ *
+ * @param[out] n  number of units of the span
+ * @return first unit of the span, NULL if the ring is full
+ */
+static inline void *hx_ring_reserve(hx_ring *r, uint32_t *n)
+{
+    uint32_t head = HX_RING_LOAD(&r->head);
+    uint32_t free_units = r->mask + 1 - (head - HX_RING_LOAD_ACQ(&r->tail));
+    uint32_t idx = head & r->mask;
+    uint32_t to_wrap = r->mask + 1 - idx;
+
+    *n = free_units < to_wrap ? free_units : to_wrap;
+    return *n ? r->buf + idx * r->unit : NULL;
+}
+
+/** Publishes n units written at the span of hx_ring_reserve() */
+static inline void hx_ring_commit(hx_ring *r, uint32_t n)
+{
+    HX_RING_STORE_REL(&r->head, HX_RING_LOAD(&r->head) + n);
+}
+
+/** Counts n units the producer had to discard */
+static inline void hx_ring_drop(hx_ring *r, uint32_t n)
+{
+    HX_RING_STORE(&r->dropped, HX_RING_LOAD(&r->dropped) + n);
+}
+
+/**
+ * @brief Copies up to n units in, across the wrap.
+ * @return units stored; the rest is counted in dropped
+ */
+static inline uint32_t hx_ring_write(hx_ring *r, const void *src, uint32_t n)
+{
+    const uint8_t *s = (const uint8_t *)src;
+    uint32_t head = HX_RING_LOAD(&r->head);
+    uint32_t free_units = r->mask + 1 - (head - HX_RING_LOAD_ACQ(&r->tail));
+    uint32_t idx = head & r->mask;
+    uint32_t want = n;
+    uint32_t first;
+
+    if (n > free_units)
+        n = free_units;
+    first = r->mask + 1 - idx;
+    if (first > n)
+        first = n;
+    memcpy(r->buf + idx * r->unit, s, first * r->unit);
+    memcpy(r->buf, s + first * r->unit, (n - first) * r->unit);
+    /* one commit: the consumer sees the whole write at once */
+    if (n)
+        hx_ring_commit(r, n);
+    if (n < want)
+        hx_ring_drop(r, want - n);
+    return n;
+}
+
+/** Stores one record, 0 on success, -1 (and counted in dropped) if full */
+static inline int hx_ring_push(hx_ring *r, const void *rec)
+{
+    return hx_ring_write(r, rec, 1) == 1 ? 0 : -1;
+}
+
+/*---------------------------------------------------------------------------*/
+/* Consumer */
+
+/**
+ * @brief Contiguous stored units at tail, up to the wrap.
+ *
+ * @param[out] n  number of units of the span
+ * @return first unit of the span, NULL if the ring is empty
+ */
+static inline void *hx_ring_peek(hx_ring *r, uint32_t *n)
+{
+    uint32_t tail = HX_RING_LOAD(&r->tail);
+    uint32_t used = HX_RING_LOAD_ACQ(&r->head) - tail;
+    uint32_t idx = tail & r->mask;
+    uint32_t to_wrap = r->mask + 1 - idx;
+
+    *n = used < to_wrap ? used : to_wrap;
+    return *n ? r->buf + idx * r->unit : NULL;
+}
+
+/** Gives n units read at the span of hx_ring_peek() back to the producer */
+static inline void hx_ring_release(hx_ring *r, uint32_t n)
+{
+    HX_RING_STORE_REL(&r->tail, HX_RING_LOAD(&r->tail) + n);
+}
+
+/**
+ * @brief Copies up to n units out, across the wrap.
+ * @return units read
+ */
+static inline uint32_t hx_ring_read(hx_ring *r, void *dst, uint32_t n)
+{
+    uint8_t *d = (uint8_t *)dst;
+    uint32_t tail = HX_RING_LOAD(&r->tail);
+    uint32_t used = HX_RING_LOAD_ACQ(&r->head) - tail;
+    uint32_t idx = tail & r->mask;
+    uint32_t first;
+
+    if (n > used)
+        n = used;
+    first = r->mask + 1 - idx;
+    if (first > n)
+        first = n;
+    memcpy(d, r->buf + idx * r->unit, first * r->unit);
+    memcpy(d + first * r->unit, r->buf, (n - first) * r->unit);
+    if (n)
+        hx_ring_release(r, n);
+    return n;
+}
+
+/** Takes one record, 0 on success, -1 if the ring is empty */
+static inline int hx_ring_pop(hx_ring *r, void *rec)
+{
+    return hx_ring_read(r, rec, 1) == 1 ? 0 : -1;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
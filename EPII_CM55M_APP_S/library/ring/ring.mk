@@ -0,0 +1,13 @@
+# directory declaration
+LIB_RING_DIR = $(LIBRARIES_ROOT)/ring
+
+LIB_RING_INCDIR	= $(LIB_RING_DIR)
+
+# header-only library, nothing to compile or archive
+
+# extra macros to be defined
+LIB_RING_DEFINES = -DLIB_RING
+
+# Middleware Definitions
+LIB_INCDIR += $(LIB_RING_INCDIR)
+LIB_DEFINES += $(LIB_RING_DEFINES)
@@ -0,0 +1,420 @@
+/*
+ * Host test and benchmark of hx_ring.h.
+ *
+ *   hx_ring_test [bytes]    single threaded checks, then a producer and a
+ *                           consumer thread stream bytes and records through
+ *                           small rings, mixing copy and zero-copy calls
+ *   hx_ring_test --bench    throughput of the byte and record paths, next to
+ *                           the same ring behind a pthread mutex
+ */
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <sched.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "hx_ring.h"
+
+#define STREAM_RING     256
+#define RECORD_RING     16
+
+typedef struct {
+    uint32_t seq;
+    uint32_t data[6];
+    uint32_t check;
+} test_rec;
+
+static int check(const char *what, int ok)
+{
+    if (!ok)
+        printf("FAIL: %s\n", what);
+    return !ok;
+}
+
+static uint8_t stream_byte(uint64_t i)
+{
+    return (uint8_t)(i * 7 + (i >> 11));
+}
+
+static uint32_t rec_check(const test_rec *rec)
+{
+    uint32_t c = rec->seq * 2654435761u;
+
+    for (int i = 0; i < 6; i++)
+        c ^= rec->data[i] + (c << 6) + (c >> 2);
+    return c;
+}
+
+static double host_now_s(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* xorshift, one state per thread */
+static uint32_t next_rand(uint32_t *s)
+{
+    *s ^= *s << 13;
+    *s ^= *s >> 17;
+    *s ^= *s << 5;
+    return *s;
+}
+
+/*---------------------------------------------------------------------------*/
+
+static int test_single(void)
+{
+    static uint8_t buf[16] HX_RING_ALIGNED;
+    static test_rec recs[4];
+    uint8_t out[32];
+    hx_ring r;
+    uint32_t n;
+    uint8_t *p;
+    int failures = 0;
+
+    failures += check("head and tail on separate cache lines",
+                      offsetof(hx_ring, tail) - offsetof(hx_ring, head) >= HX_RING_CACHE_LINE);
+    failures += check("init rejects 0 units", hx_ring_init(&r, buf, 0, 1) == -1);
+    failures += check("init rejects 12 units", hx_ring_init(&r, buf, 12, 1) == -1);
+    failures += check("init rejects unit 0", hx_ring_init(&r, buf, 16, 0) == -1);
+    failures += check("init", hx_ring_init(&r, buf, sizeof(buf), 1) == 0);
+
+    failures += check("empty", hx_ring_count(&r) == 0 && hx_ring_space(&r) == 16);
+    failures += check("peek empty", hx_ring_peek(&r, &n) == NULL && n == 0);
+    failures += check("read empty", hx_ring_read(&r, out, 4) == 0);
+
+    /* write and read across the wrap */
+    failures += check("write 10", hx_ring_write(&r, "0123456789", 10) == 10);
+    failures += check("read 10", hx_ring_read(&r, out, sizeof(out)) == 10 && memcmp(out, "0123456789", 10) == 0);
+    failures += check("write over the wrap", hx_ring_write(&r, "abcdefghij", 10) == 10);
+    failures += check("count", hx_ring_count(&r) == 10 && hx_ring_space(&r) == 6);
+    p = (uint8_t *)hx_ring_peek(&r, &n);
+    failures += check("peek stops at the wrap", p == buf + 10 && n == 6 && memcmp(p, "abcdef", 6) == 0);
+    hx_ring_release(&r, 6);
+    p = (uint8_t *)hx_ring_peek(&r, &n);
+    failures += check("peek after the wrap", p == buf && n == 4 && memcmp(p, "ghij", 4) == 0);
+    hx_ring_release(&r, 4);
+
+    /* full ring, all units usable */
+    failures += check("write 20 stores 16", hx_ring_write(&r, "ABCDEFGHIJKLMNOPQRST", 20) == 16);
+    failures += check("overflow counted", hx_ring_dropped(&r) == 4);
+    failures += check("full", hx_ring_space(&r) == 0 && hx_ring_reserve(&r, &n) == NULL && n == 0);
+    failures += check("read full ring", hx_ring_read(&r, out, 16) == 16 && memcmp(out, "ABCDEFGHIJKLMNOP", 16) == 0);
+
+    /* reserve and commit */
+    hx_ring_reset(&r);
+    hx_ring_write(&r, "xxxxxxxxxxxx", 12);
+    hx_ring_read(&r, out, 8);
+    p = (uint8_t *)hx_ring_reserve(&r, &n);
+    failures += check("reserve stops at the wrap", p == buf + 12 && n == 4);
+    failures += check("reserve is repeatable", hx_ring_reserve(&r, &n) == p && n == 4);
+    memcpy(p, "wxyz", 4);
+    failures += check("nothing visible before commit", hx_ring_count(&r) == 4);
+    hx_ring_commit(&r, 4);
+    p = (uint8_t *)hx_ring_reserve(&r, &n);
+    failures += check("reserve after the wrap", p == buf && n == 8);
+    hx_ring_commit(&r, 0);
+    failures += check("read committed span", hx_ring_read(&r, out, 8) == 8 && memcmp(out + 4, "wxyz", 4) == 0);
+
+    /* records */
+    failures += check("record init", hx_ring_init(&r, recs, 4, sizeof(test_rec)) == 0);
+    for (uint32_t i = 0; i < 6; i++) {
+        test_rec rec = { .seq = i };
+
+        rec.check = rec_check(&rec);
+        if (i < 4)
+            failures += check("push", hx_ring_push(&r, &rec) == 0);
+        else
+            failures += check("push to a full ring", hx_ring_push(&r, &rec) == -1);
+    }
+    failures += check("record drops", hx_ring_dropped(&r) == 2);
+    for (uint32_t i = 0; i < 4; i++) {
+        test_rec rec;
+
+        failures += check("pop", hx_ring_pop(&r, &rec) == 0 && rec.seq == i && rec.check == rec_check(&rec));
+    }
+    failures += check("pop empty", hx_ring_pop(&r, out) == -1);
+    return failures;
+}
+
+/*---------------------------------------------------------------------------*/
+/* Two threads, the producer stands in for an ISR or a DMA */
+
+static hx_ring stream;
+static uint8_t stream_buf[STREAM_RING] HX_RING_ALIGNED;
+static hx_ring records;
+static test_rec record_buf[RECORD_RING] HX_RING_ALIGNED;
+static uint64_t stream_total;
+static uint32_t record_total;
+static uint32_t record_full;
+
+static void *stream_producer(void *arg)
+{
+    uint32_t seed = 0x1234567;
+    uint64_t i = 0;
+    uint8_t chunk[64];
+
+    (void)arg;
+    while (i < stream_total) {
+        uint32_t want = 1 + next_rand(&seed) % 64;
+
+        if (want > stream_total - i)
+            want = (uint32_t)(stream_total - i);
+        if (next_rand(&seed) & 1) {
+            /* copy in, a partial write is the caller's to retry */
+            for (uint32_t k = 0; k < want; k++)
+                chunk[k] = stream_byte(i + k);
+            i += hx_ring_write(&stream, chunk, want);
+        } else {
+            /* a DMA filling part of the reserved span */
+            uint32_t n;
+            uint8_t *p = (uint8_t *)hx_ring_reserve(&stream, &n);
+
+            if (p != NULL) {
+                if (n > want)
+                    n = want;
+                for (uint32_t k = 0; k < n; k++)
+                    p[k] = stream_byte(i + k);
+                hx_ring_commit(&stream, n);
+                i += n;
+            }
+        }
+        if (hx_ring_space(&stream) == 0)
+            sched_yield();
+    }
+    return NULL;
+}
+
+static void *stream_consumer(void *arg)
+{
+    uint32_t seed = 0x7654321;
+    uint64_t i = 0;
+    uint64_t bad = 0;
+    uint8_t chunk[64];
+
+    while (i < stream_total) {
+        uint32_t want = 1 + next_rand(&seed) % 64;
+        uint32_t n;
+
+        if (next_rand(&seed) & 1) {
+            n = hx_ring_read(&stream, chunk, want);
+            for (uint32_t k = 0; k < n; k++)
+                bad += chunk[k] != stream_byte(i + k);
+        } else {
+            const uint8_t *p = (const uint8_t *)hx_ring_peek(&stream, &n);
+
+            if (n > want)
+                n = want;
+            for (uint32_t k = 0; k < n; k++)
+                bad += p[k] != stream_byte(i + k);
+            if (n)
+                hx_ring_release(&stream, n);
+        }
+        i += n;
+        if (n == 0)
+            sched_yield();
+    }
+    *(uint64_t *)arg = bad;
+    return NULL;
+}
+
+static void *record_producer(void *arg)
+{
+    (void)arg;
+    for (uint32_t seq = 0; seq < record_total; ) {
+        test_rec rec = { .seq = seq };
+
+        for (int k = 0; k < 6; k++)
+            rec.data[k] = seq * (k + 3);
+        rec.check = rec_check(&rec);
+        if (hx_ring_push(&records, &rec) == 0) {
+            seq++;
+        } else {
+            record_full++;
+            sched_yield();
+        }
+    }
+    return NULL;
+}
+
+static void *record_consumer(void *arg)
+{
+    uint32_t bad = 0;
+
+    for (uint32_t seq = 0; seq < record_total; ) {
+        test_rec rec;
+
+        if (hx_ring_pop(&records, &rec) != 0) {
+            sched_yield();
+            continue;
+        }
+        bad += rec.seq != seq || rec.check != rec_check(&rec);
+        seq++;
+    }
+    *(uint32_t *)arg = bad;
+    return NULL;
+}
+
+static int test_threads(uint64_t bytes)
+{
+    pthread_t prod, cons;
+    uint64_t stream_bad = 0;
+    uint32_t record_bad = 0;
+    int failures = 0;
+
+    hx_ring_init(&stream, stream_buf, STREAM_RING, 1);
+    stream_total = bytes;
+    pthread_create(&prod, NULL, stream_producer, NULL);
+    pthread_create(&cons, NULL, stream_consumer, &stream_bad);
+    pthread_join(prod, NULL);
+    pthread_join(cons, NULL);
+    printf("stream: %llu bytes through %d bytes, %llu wraps\n", (unsigned long long)bytes, STREAM_RING,
+           (unsigned long long)(bytes / STREAM_RING));
+    failures += check("stream in order", stream_bad == 0);
+    failures += check("stream drained", hx_ring_count(&stream) == 0);
+
+    hx_ring_init(&records, record_buf, RECORD_RING, sizeof(test_rec));
+    record_total = (uint32_t)(bytes / sizeof(test_rec));
+    pthread_create(&prod, NULL, record_producer, NULL);
+    pthread_create(&cons, NULL, record_consumer, &record_bad);
+    pthread_join(prod, NULL);
+    pthread_join(cons, NULL);
+    printf("records: %u records through %d, full %u times\n", record_total, RECORD_RING, record_full);
+    failures += check("records in order and intact", record_bad == 0);
+    failures += check("full pushes counted", hx_ring_dropped(&records) == record_full);
+    return failures;
+}
+
+/*---------------------------------------------------------------------------*/
+/* Throughput */
+
+#define BENCH_RING  4096
+
+static hx_ring bench;
+static uint8_t bench_buf[BENCH_RING * sizeof(test_rec)] HX_RING_ALIGNED;
+static pthread_mutex_t bench_lock = PTHREAD_MUTEX_INITIALIZER;
+static int bench_locked;
+static uint32_t bench_chunk;
+static uint64_t bench_units;
+
+static uint32_t bench_write(const void *src, uint32_t n)
+{
+    uint32_t done;
+
+    if (!bench_locked)
+        return hx_ring_write(&bench, src, n);
+    pthread_mutex_lock(&bench_lock);
+    done = hx_ring_write(&bench, src, n);
+    pthread_mutex_unlock(&bench_lock);
+    return done;
+}
+
+static uint32_t bench_read(void *dst, uint32_t n)
+{
+    uint32_t done;
+
+    if (!bench_locked)
+        return hx_ring_read(&bench, dst, n);
+    pthread_mutex_lock(&bench_lock);
+    done = hx_ring_read(&bench, dst, n);
+    pthread_mutex_unlock(&bench_lock);
+    return done;
+}
+
+static void *bench_producer(void *arg)
+{
+    uint8_t chunk[256 * sizeof(test_rec)];
+
+    (void)arg;
+    memset(chunk, 0x5A, sizeof(chunk));
+    for (uint64_t i = 0; i < bench_units; ) {
+        uint32_t n = bench_write(chunk, bench_chunk);
+
+        i += n;
+        if (n == 0)
+            sched_yield();
+    }
+    return NULL;
+}
+
+static void *bench_consumer(void *arg)
+{
+    uint8_t chunk[256 * sizeof(test_rec)];
+
+    (void)arg;
+    for (uint64_t i = 0; i < bench_units; ) {
+        uint32_t n = bench_read(chunk, bench_chunk);
+
+        i += n;
+        if (n == 0)
+            sched_yield();
+    }
+    return NULL;
+}
+
+static double bench_run(uint32_t unit, uint32_t chunk, uint64_t units, int locked)
+{
+    pthread_t prod, cons;
+    double t0;
+
+    hx_ring_init(&bench, bench_buf, BENCH_RING, unit);
+    bench_chunk = chunk;
+    bench_units = units;
+    bench_locked = locked;
+    t0 = host_now_s();
+    pthread_create(&prod, NULL, bench_producer, NULL);
+    pthread_create(&cons, NULL, bench_consumer, NULL);
+    pthread_join(prod, NULL);
+    pthread_join(cons, NULL);
+    return host_now_s() - t0;
+}
+
+static void benchmark(void)
+{
+    static const uint32_t chunks[] = { 1, 16, 256 };
+
+    printf("%-26s %12s %12s\n", "", "lock-free", "mutex");
+    for (unsigned c = 0; c < sizeof(chunks) / sizeof(chunks[0]); c++) {
+        uint64_t bytes = (uint64_t)chunks[c] << 20;
+        double t_free, t_lock;
+        char name[32];
+
+        if (bytes < (16u << 20))
+            bytes = 16u << 20;
+        t_free = bench_run(1, chunks[c], bytes, 0);
+        t_lock = bench_run(1, chunks[c], bytes, 1);
+        snprintf(name, sizeof(name), "bytes, %u per call", chunks[c]);
+        printf("%-26s %9.1f MB/s %7.1f MB/s\n", name, bytes / t_free / 1e6, bytes / t_lock / 1e6);
+    }
+    {
+        uint64_t recs = 8u << 20;
+        double t_free = bench_run(sizeof(test_rec), 1, recs, 0);
+        double t_lock = bench_run(sizeof(test_rec), 1, recs, 1);
+
+        printf("%-26s %8.2f Mrec/s %6.2f Mrec/s\n", "32 byte records, 1 per call", recs / t_free / 1e6,
+               recs / t_lock / 1e6);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    uint64_t bytes = 64u << 20;
+    int failures = 0;
+
+    if (argc > 1 && strcmp(argv[1], "--bench") == 0) {
+        benchmark();
+        return 0;
+    }
+    if (argc > 1)
+        bytes = strtoull(argv[1], NULL, 0);
+
+    failures += test_single();
+    failures += test_threads(bytes);
+    printf("%s\n", failures ? "FAILED" : "PASSED");
+    return failures ? 1 : 0;
+}
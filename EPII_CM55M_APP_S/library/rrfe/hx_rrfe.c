@@ -0,0 +1,394 @@
+/*
+ * hx_rrfe.c
+ *
+ * Streaming RR-interval front end, see hx_rrfe.h. The filters are designed
+ * in float at init; hx_rrfe_process() is fixed point only.
+ */
+#include <math.h>
+#include <string.h>
+#include "hx_rrfe.h"
+
+#define HX_RRFE_HIST_MASK   (HX_RRFE_HIST - 1)
+#define HX_RRFE_DERIV_TAPS  6
+#define HX_RRFE_LEARN_MS    2000
+#define HX_RRFE_QUIET_MS    3000
+#define HX_RRFE_RR_AVG      8
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+/*
+ * 5-point derivative of Pan-Tompkins, (2x[n] + x[n-1] - x[n-3] - 2x[n-4]) / 8,
+ * time reversed as arm_fir_q15() wants it, one zero tap to make the count
+ * even and two more for the multiple of 8 of the Helium version.
+ */
+static const q15_t deriv_coef[8] = { 0, -8192, -4096, 0, 4096, 8192, 0, 0 };
+
+void hx_rrfe_default_cfg(hx_rrfe_cfg *cfg, hx_rrfe_signal sig, uint32_t fs_hz)
+{
+    memset(cfg, 0, sizeof(*cfg));
+    cfg->fs_hz = fs_hz;
+    cfg->signal = (uint8_t)sig;
+    cfg->window = 40;
+    cfg->stride = 1;
+    if (sig == HX_RRFE_PPG)
+    {
+        cfg->hp_hz10 = 5;
+        cfg->lp_hz10 = 80;
+        cfg->mwi_ms = 250;
+        cfg->refractory_ms = 300;
+        cfg->twave_ms = 400;
+        cfg->gain_shift = 0;
+    }
+    else
+    {
+        cfg->hp_hz10 = 50;
+        cfg->lp_hz10 = 150;
+        cfg->mwi_ms = 150;
+        cfg->refractory_ms = 200;
+        cfg->twave_ms = 360;
+        cfg->gain_shift = 4;
+    }
+}
+
+/* RBJ Butterworth biquad as {b0, b1, b2, a1, a2}, a0 = 1 */
+static void design_biquad(float *c, float f0, float fs, int highpass)
+{
+    float w0 = 2.0f * (float)M_PI * f0 / fs;
+    float cw = cosf(w0);
+    float alpha = sinf(w0) / (2.0f * 0.70710678f);
+    float a0 = 1.0f + alpha;
+    float b = highpass ? (1.0f + cw) / 2.0f : (1.0f - cw) / 2.0f;
+
+    c[0] = b / a0;
+    c[1] = (highpass ? -2.0f * b : 2.0f * b) / a0;
+    c[2] = b / a0;
+    c[3] = -2.0f * cw / a0;
+    c[4] = (1.0f - alpha) / a0;
+}
+
+/*
+ * Delay from a beat to its position in the filtered signal: a Gaussian
+ * pulse, as wide as a QRS or the rise of a pulse wave, through the
+ * biquads (and the derivative for PPG) in float.
+ */
+static float template_delay(const float *c, float fs, int ppg)
+{
+    float sigma = (ppg ? 0.05f : 0.01f) * fs, centre = fs / 2.0f;
+    float st[2][4] = { { 0 } }, h[4] = { 0 }, top = 0.0f;
+    int i, s, n = (int)fs, best = 0;
+
+    for (i = 0; i < n; i++)
+    {
+        float t = (i - centre) / sigma;
+        float x = expf(-t * t / 2.0f), v;
+
+        for (s = 0; s < 2; s++)
+        {
+            const float *k = &c[5 * s];
+            float y = k[0] * x + k[1] * st[s][0] + k[2] * st[s][1] - k[3] * st[s][2] - k[4] * st[s][3];
+
+            st[s][1] = st[s][0];
+            st[s][0] = x;
+            st[s][3] = st[s][2];
+            st[s][2] = y;
+            x = y;
+        }
+        v = ppg ? (2.0f * x + h[0] - h[2] - 2.0f * h[3]) / 8.0f : fabsf(x);
+        h[3] = h[2];
+        h[2] = h[1];
+        h[1] = h[0];
+        h[0] = x;
+        if (v > top)
+        {
+            top = v;
+            best = i;
+        }
+    }
+    /* the steepest rise of the pulse is one sigma before its top */
+    return best - (ppg ? centre - sigma : centre);
+}
+
+int hx_rrfe_init(hx_rrfe *fe, const hx_rrfe_cfg *cfg, hx_rrfe_beat_cb cb, void *arg)
+{
+    float c[10], fs = (float)cfg->fs_hz;
+    uint32_t mwi_len = cfg->mwi_ms * cfg->fs_hz / 1000;
+    int i;
+
+    if (cfg->fs_hz == 0 || mwi_len == 0 || mwi_len > HX_RRFE_MWI_MAX ||
+        cfg->window == 0 || cfg->window > HX_RRFE_MAX_RR || cfg->stride == 0 ||
+        cfg->hp_hz10 == 0 || cfg->lp_hz10 <= cfg->hp_hz10 || cfg->lp_hz10 * 2 >= cfg->fs_hz * 10)
+        return -1;
+
+    memset(fe, 0, sizeof(*fe));
+    fe->cfg = *cfg;
+    fe->cb = cb;
+    fe->cb_arg = arg;
+
+    /* high-pass then low-pass; postShift 1 leaves room for coefficients up to 2 */
+    design_biquad(&c[0], cfg->hp_hz10 / 10.0f, fs, 1);
+    design_biquad(&c[5], cfg->lp_hz10 / 10.0f, fs, 0);
+    for (i = 0; i < 10; i++)
+    {
+        /* CMSIS-DSP adds the feedback terms */
+        float v = (i % 5 >= 3 ? -c[i] : c[i]) * 1073741824.0f;
+
+        fe->bq_coef[i] = v >= 2147483647.0f ? INT32_MAX : (int32_t)lrintf(v);
+    }
+    arm_biquad_cascade_df1_init_q31(&fe->bq, 2, fe->bq_coef, fe->bq_state, 1);
+
+    memcpy(fe->fir_coef, deriv_coef, sizeof(deriv_coef));
+    arm_fir_init_q15(&fe->fir, HX_RRFE_DERIV_TAPS, fe->fir_coef, fe->fir_state, HX_RRFE_BLOCK);
+
+    fe->delay = (int16_t)lrintf(template_delay(c, fs, cfg->signal == HX_RRFE_PPG));
+
+    fe->mwi_len = (uint16_t)mwi_len;
+    fe->refractory = (uint16_t)(cfg->refractory_ms * cfg->fs_hz / 1000);
+    fe->twave = (uint16_t)(cfg->twave_ms * cfg->fs_hz / 1000);
+    fe->learn_left = HX_RRFE_LEARN_MS * cfg->fs_hz / 1000;
+    fe->fall_min = UINT32_MAX;
+    return 0;
+}
+
+static void set_thresholds(hx_rrfe *fe)
+{
+    fe->thr1 = fe->npki + (fe->spki - fe->npki) / 4;
+    fe->thr2 = fe->thr1 / 2;
+}
+
+/* fills in the beat position and the slope of an MWI peak */
+static void locate(hx_rrfe *fe, hx_rrfe_peak *p)
+{
+    uint32_t i, best = p->at, top = 0, from = p->at - fe->mwi_len + 1;
+    int ppg = fe->cfg.signal == HX_RRFE_PPG;
+    int32_t slope = 0;
+
+    for (i = from; i != p->at + 1; i++)
+    {
+        int32_t b = fe->hist_bp[i & HX_RRFE_HIST_MASK];
+        int32_t d = fe->hist_d[i & HX_RRFE_HIST_MASK];
+        uint32_t v = ppg ? (d > 0 ? (uint32_t)d : 0) : (uint32_t)(b < 0 ? -b : b);
+
+        if (v > top)
+        {
+            top = v;
+            best = i;
+        }
+        if (d < 0)
+            d = -d;
+        if (d > slope)
+            slope = d;
+    }
+    p->r = best - fe->delay;
+    p->slope = (uint16_t)slope;
+}
+
+static void push_rr(hx_rrfe *fe, uint32_t rr)
+{
+    uint32_t sum = 0, n, i;
+
+    fe->rr[fe->rr_head] = rr > UINT16_MAX ? UINT16_MAX : (uint16_t)rr;
+    fe->rr_head = (uint8_t)((fe->rr_head + 1) % HX_RRFE_MAX_RR);
+    if (fe->rr_count < HX_RRFE_MAX_RR)
+        fe->rr_count++;
+
+    n = fe->rr_count < HX_RRFE_RR_AVG ? fe->rr_count : HX_RRFE_RR_AVG;
+    for (i = 1; i <= n; i++)
+        sum += fe->rr[(fe->rr_head + HX_RRFE_MAX_RR - i) % HX_RRFE_MAX_RR];
+    fe->rr_avg = sum / n;
+}
+
+static void accept(hx_rrfe *fe, const hx_rrfe_peak *p, int searchback)
+{
+    hx_rrfe_beat beat;
+
+    beat.sample = p->r;
+    beat.detect_sample = fe->n;
+    beat.rr_ms = 0;
+    beat.searchback = (uint8_t)searchback;
+    beat.window_ready = 0;
+
+    if (fe->have_qrs)
+    {
+        uint32_t rr = p->r - fe->last.r;
+
+        push_rr(fe, rr);
+        beat.rr_ms = (rr * 1000 + fe->cfg.fs_hz / 2) / fe->cfg.fs_hz;
+        if (fe->rr_count >= fe->cfg.window && ++fe->since_window >= fe->cfg.stride)
+        {
+            fe->since_window = 0;
+            beat.window_ready = 1;
+        }
+    }
+    fe->have_qrs = 1;
+    fe->last = *p;
+    fe->sb.level = 0;
+    fe->quiet = fe->n;
+    fe->beats++;
+
+    if (fe->cb)
+        fe->cb(fe->cb_arg, &beat);
+}
+
+static void on_peak(hx_rrfe *fe, uint32_t level, uint32_t at)
+{
+    hx_rrfe_peak p;
+
+    p.level = level;
+    p.at = at;
+    locate(fe, &p);
+
+    if (fe->have_qrs && (int32_t)(p.r - fe->last.r) < (int32_t)fe->refractory)
+        return;
+
+    if (level > fe->thr1)
+    {
+        if (!(fe->have_qrs && p.r - fe->last.r < fe->twave && p.slope < fe->last.slope / 2))
+        {
+            fe->spki = (level + 7 * fe->spki) / 8;
+            set_thresholds(fe);
+            accept(fe, &p, 0);
+            return;
+        }
+    }
+    else if (level > fe->thr2 && level > fe->sb.level)
+    {
+        fe->sb = p;
+    }
+    fe->npki = (level + 7 * fe->npki) / 8;
+    set_thresholds(fe);
+}
+
+static void learn(hx_rrfe *fe, uint32_t m)
+{
+    if (m > fe->learn_max)
+        fe->learn_max = m;
+    fe->learn_sum += m;
+    if (--fe->learn_left == 0)
+    {
+        uint32_t len = HX_RRFE_LEARN_MS * fe->cfg.fs_hz / 1000;
+
+        fe->spki = fe->learn_max / 3;
+        fe->npki = (uint32_t)(fe->learn_sum / len / 2);
+        set_thresholds(fe);
+        fe->learn_max = 0;
+        fe->learn_sum = 0;
+        fe->quiet = fe->n;
+        fe->sb.level = 0;
+    }
+}
+
+static void step(hx_rrfe *fe, int16_t bp, int16_t d)
+{
+    uint32_t n = fe->n;
+    uint32_t sq = (uint32_t)((int32_t)d * d) >> 7;
+    uint32_t m;
+
+    fe->hist_bp[n & HX_RRFE_HIST_MASK] = bp;
+    fe->hist_d[n & HX_RRFE_HIST_MASK] = d;
+
+    fe->mwi_sum += sq - fe->mwi_ring[fe->mwi_pos];
+    fe->mwi_ring[fe->mwi_pos] = sq;
+    if (++fe->mwi_pos == fe->mwi_len)
+        fe->mwi_pos = 0;
+    m = fe->mwi_sum;
+
+    if (fe->learn_left)
+    {
+        learn(fe, m);
+        fe->cand_level = 0;
+        fe->fall_min = UINT32_MAX;
+        return;
+    }
+
+    /* an MWI peak ends when the MWI falls to half of it, a new one starts
+     * when it rises again from its low */
+    if (fe->cand_level)
+    {
+        if (m > fe->cand_level)
+        {
+            fe->cand_level = m;
+            fe->cand_at = n;
+        }
+        else if (m <= fe->cand_level / 2 ||
+                 n - fe->cand_at >= HX_RRFE_HIST - HX_RRFE_MWI_MAX - 1)
+        {
+            on_peak(fe, fe->cand_level, fe->cand_at);
+            fe->cand_level = 0;
+            fe->fall_min = m;
+        }
+    }
+    else if (m < fe->fall_min)
+    {
+        fe->fall_min = m;
+    }
+    else if (m > fe->fall_min)
+    {
+        fe->cand_level = m;
+        fe->cand_at = n;
+    }
+
+    /* searchback at half the threshold when a beat is overdue */
+    if (fe->have_qrs && fe->rr_avg && fe->sb.level &&
+        n - fe->last.r > fe->rr_avg * 166 / 100)
+    {
+        hx_rrfe_peak p = fe->sb;
+
+        fe->spki = (p.level + 3 * fe->spki) / 4;
+        set_thresholds(fe);
+        accept(fe, &p, 1);
+    }
+
+    /* levels too high for what comes in now */
+    if (n - fe->quiet > HX_RRFE_QUIET_MS * fe->cfg.fs_hz / 1000)
+        fe->learn_left = HX_RRFE_LEARN_MS * fe->cfg.fs_hz / 1000;
+}
+
+void hx_rrfe_process(hx_rrfe *fe, const int16_t *x, uint32_t n)
+{
+    q31_t a[HX_RRFE_BLOCK], b[HX_RRFE_BLOCK];
+    q15_t bp[HX_RRFE_BLOCK], d[HX_RRFE_BLOCK];
+    uint32_t k, i;
+
+    if (fe->n == 0 && n)
+    {
+        /* start the high-pass settled on the first sample, no step */
+        fe->bq_state[0] = (q31_t)x[0] << 16;
+        fe->bq_state[1] = (q31_t)x[0] << 16;
+    }
+
+    while (n)
+    {
+        k = n < HX_RRFE_BLOCK ? n : HX_RRFE_BLOCK;
+        arm_q15_to_q31(x, a, k);
+        arm_biquad_cascade_df1_q31(&fe->bq, a, b, k);
+        if (fe->cfg.gain_shift)
+            arm_shift_q31(b, fe->cfg.gain_shift, b, k);
+        arm_q31_to_q15(b, bp, k);
+        arm_fir_q15(&fe->fir, bp, d, k);
+
+        for (i = 0; i < k; i++)
+        {
+            step(fe, bp[i], d[i]);
+            fe->n++;
+        }
+        x += k;
+        n -= k;
+    }
+}
+
+uint32_t hx_rrfe_window(const hx_rrfe *fe, uint16_t *rr_ms, uint32_t len)
+{
+    uint32_t i, fs = fe->cfg.fs_hz;
+
+    if (len > fe->rr_count)
+        return 0;
+    for (i = 0; i < len; i++)
+    {
+        uint32_t rr = fe->rr[(fe->rr_head + HX_RRFE_MAX_RR - len + i) % HX_RRFE_MAX_RR];
+
+        rr_ms[i] = (uint16_t)(((uint32_t)rr * 1000 + fs / 2) / fs);
+    }
+    return len;
+}
@@ -0,0 +1,177 @@
+#ifndef _LIB_HX_RRFE_H_
+#define _LIB_HX_RRFE_H_
+/*
+ * Streaming RR-interval front end: raw ECG or PPG samples in, beats and
+ * windows of RR intervals for the AF model out.
+ *
+ * Pan-Tompkins style, in fixed point:
+ *   band-pass     high-pass and low-pass biquads, arm_biquad_cascade_df1_q31()
+ *   derivative    5-point, arm_fir_q15()
+ *   squaring and moving window integration (MWI) over mwi_ms
+ *   peaks of the MWI against adaptive signal and noise levels (SPKI,
+ *   NPKI), a refractory period, T-wave rejection by slope, and a
+ *   searchback at half the threshold when no beat came for 1.66 RR
+ * An MWI peak is taken once the MWI falls to half of it. The ECG beat is
+ * the largest band-passed sample of its MWI window, the PPG beat the
+ * steepest rise, less the group delay of the filters. The first 2 s learn
+ * the levels, and so do 3 s without a beat.
+ *
+ * Samples go through in blocks of HX_RRFE_BLOCK, so the work per sample
+ * is bounded: the CMSIS-DSP filters (Helium on the chip), a constant
+ * amount of scalar work, and a scan of at most the MWI window for a peak
+ * candidate. There is no heap.
+ *
+ * Each beat calls the beat callback. Once window RR intervals are known,
+ * every stride-th beat also marks a new window: hx_rrfe_window() copies
+ * the last window intervals, so with stride < window the windows overlap.
+ *
+ * Usage:
+ *   hx_rrfe_default_cfg(&cfg, HX_RRFE_ECG, 360);
+ *   hx_rrfe_init(&fe, &cfg, on_beat, NULL);
+ *   for each chunk of samples
+ *       hx_rrfe_process(&fe, x, n);
+ *   on_beat(): if (beat->window_ready) hx_rrfe_window(&fe, rr_ms, 40);
+ */
+#include <stdint.h>
+#include "arm_math.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/** Samples per call of the CMSIS-DSP filters */
+#ifndef HX_RRFE_BLOCK
+#define HX_RRFE_BLOCK 32
+#endif
+
+/** RR intervals kept, the longest window */
+#ifndef HX_RRFE_MAX_RR
+#define HX_RRFE_MAX_RR 64
+#endif
+
+/** Longest MWI window in samples, 150 ms at 1 kHz */
+#ifndef HX_RRFE_MWI_MAX
+#define HX_RRFE_MWI_MAX 160
+#endif
+
+/** Filtered samples kept to place the beat, a power of 2 above 2 * HX_RRFE_MWI_MAX */
+#define HX_RRFE_HIST 512
+
+typedef enum hx_rrfe_signal {
+    HX_RRFE_ECG = 0,
+    HX_RRFE_PPG
+} hx_rrfe_signal;
+
+typedef struct hx_rrfe_cfg {
+    uint32_t fs_hz;
+    uint8_t signal;             /**< hx_rrfe_signal, chooses the beat position */
+    uint16_t hp_hz10;           /**< band-pass corners in 0.1 Hz */
+    uint16_t lp_hz10;
+    uint16_t mwi_ms;            /**< moving window integration */
+    uint16_t refractory_ms;     /**< no second beat this soon */
+    uint16_t twave_ms;          /**< a beat this soon needs half the slope of the last one */
+    uint8_t gain_shift;         /**< gain after the band-pass, left shift with saturation */
+    uint8_t window;             /**< RR intervals per window, up to HX_RRFE_MAX_RR */
+    uint8_t stride;             /**< beats between windows, 1 for a window every beat */
+} hx_rrfe_cfg;
+
+typedef struct hx_rrfe_beat {
+    uint32_t sample;            /**< sample index of the R peak, or of the PPG pulse */
+    uint32_t detect_sample;     /**< sample index at which it was reported */
+    uint32_t rr_ms;             /**< interval to the previous beat, 0 for the first */
+    uint8_t searchback;         /**< found by the searchback */
+    uint8_t window_ready;       /**< hx_rrfe_window() has a new window */
+} hx_rrfe_beat;
+
+typedef void (*hx_rrfe_beat_cb)(void *arg, const hx_rrfe_beat *beat);
+
+/** MWI peak, a candidate beat */
+typedef struct hx_rrfe_peak {
+    uint32_t level;
+    uint32_t at;                /**< sample index of the MWI peak */
+    uint32_t r;                 /**< sample index of the beat */
+    uint16_t slope;
+} hx_rrfe_peak;
+
+typedef struct hx_rrfe {
+    hx_rrfe_cfg cfg;
+    hx_rrfe_beat_cb cb;
+    void *cb_arg;
+
+    /* filters */
+    arm_biquad_casd_df1_inst_q31 bq;
+    arm_fir_instance_q15 fir;
+    int32_t bq_coef[10];
+    int32_t bq_state[8];
+    int16_t fir_coef[8];
+    int16_t fir_state[8 + HX_RRFE_BLOCK];
+    int16_t delay;              /**< group delay up to the beat position, samples */
+
+    /* MWI */
+    uint32_t mwi_ring[HX_RRFE_MWI_MAX];
+    uint32_t mwi_sum;
+    uint16_t mwi_len;
+    uint16_t mwi_pos;
+    uint32_t cand_level;        /**< MWI peak in progress, 0 while falling */
+    uint32_t cand_at;
+    uint32_t fall_min;
+
+    /* band-passed signal and derivative, for the beat position and the slope */
+    int16_t hist_bp[HX_RRFE_HIST];
+    int16_t hist_d[HX_RRFE_HIST];
+
+    /* levels */
+    uint32_t spki;
+    uint32_t npki;
+    uint32_t thr1;
+    uint32_t thr2;
+    uint32_t learn_left;        /**< samples, 0 once the levels are known */
+    uint32_t quiet;             /**< sample index of the last beat or learning */
+    uint32_t learn_max;
+    uint64_t learn_sum;
+
+    /* beats */
+    uint32_t n;                 /**< samples processed */
+    uint8_t have_qrs;
+    hx_rrfe_peak last;          /**< last beat */
+    hx_rrfe_peak sb;            /**< best searchback candidate since then, level 0 if none */
+    uint32_t rr_avg;            /**< samples, mean of the last 8, 0 until known */
+    uint16_t refractory;        /**< samples */
+    uint16_t twave;
+
+    /* RR intervals in samples */
+    uint16_t rr[HX_RRFE_MAX_RR];
+    uint8_t rr_head;
+    uint8_t rr_count;
+    uint8_t since_window;
+    uint32_t beats;
+} hx_rrfe;
+
+/**
+ * Defaults for sig sampled at fs_hz. ECG: 5 to 15 Hz, 150 ms MWI, 200 ms
+ * refractory, gain 16 for 200 adu/mV. PPG: 0.5 to 8 Hz, 250 ms MWI, 300 ms
+ * refractory, gain 1. Both give a 40 interval window every beat.
+ */
+void hx_rrfe_default_cfg(hx_rrfe_cfg *cfg, hx_rrfe_signal sig, uint32_t fs_hz);
+
+/**
+ * @return 0, or -1 if the configuration does not fit the buffers
+ *         (MWI longer than HX_RRFE_MWI_MAX, window above HX_RRFE_MAX_RR)
+ */
+int hx_rrfe_init(hx_rrfe *fe, const hx_rrfe_cfg *cfg, hx_rrfe_beat_cb cb, void *arg);
+
+/** Feeds n samples, any n; beats are reported from in here */
+void hx_rrfe_process(hx_rrfe *fe, const int16_t *x, uint32_t n);
+
+/**
+ * Copies the last len RR intervals in ms, oldest first.
+ * @return len, or 0 if fewer are known
+ */
+uint32_t hx_rrfe_window(const hx_rrfe *fe, uint16_t *rr_ms, uint32_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _LIB_HX_RRFE_H_ */
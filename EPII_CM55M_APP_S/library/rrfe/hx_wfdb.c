@@ -0,0 +1,300 @@
+/*
+ * hx_wfdb.c
+ *
+ * WFDB header, signal and annotation formats as documented with the WFDB
+ * software package (header(5), signal(5), annot(5)).
+ */
+#include <stdlib.h>
+#include <string.h>
+#include "hx_wfdb.h"
+
+#define HX_WFDB_LINE    160
+#define HX_WFDB_FIELDS  10
+
+/* annotation words, code in the top 6 bits */
+#define ANN_SKIP    59
+#define ANN_NUM     60
+#define ANN_SUB     61
+#define ANN_CHN     62
+#define ANN_AUX     63
+
+/* splits line into blank separated fields, in place */
+static int split(char *line, char **field)
+{
+    int n = 0;
+
+    while (*line && n < HX_WFDB_FIELDS)
+    {
+        while (*line == ' ' || *line == '\t')
+            *line++ = '\0';
+        if (*line == '\0')
+            break;
+        field[n++] = line;
+        while (*line && *line != ' ' && *line != '\t')
+            line++;
+    }
+    return n;
+}
+
+static void copy(char *dst, const char *src, uint32_t size)
+{
+    strncpy(dst, src, size - 1);
+    dst[size - 1] = '\0';
+}
+
+static int parse_record(hx_wfdb_header *h, char **f, int n)
+{
+    char *slash;
+
+    if (n < 2)
+        return -1;
+    /* multi-segment records are not supported, only the name is kept */
+    slash = strchr(f[0], '/');
+    if (slash)
+        *slash = '\0';
+    copy(h->name, f[0], sizeof(h->name));
+    h->nsig = (uint8_t)strtoul(f[1], NULL, 10);
+    h->fs_hz = n > 2 ? (uint32_t)strtoul(f[2], NULL, 10) : 250;
+    h->nsamples = n > 3 ? (uint32_t)strtoul(f[3], NULL, 10) : 0;
+    if (h->fs_hz == 0)
+        h->fs_hz = 250;
+    return h->nsig ? 0 : -1;
+}
+
+static int parse_signal(hx_wfdb_sig *s, char **f, int n)
+{
+    char *end;
+    int has_base = 0;
+
+    if (n < 2)
+        return -1;
+    copy(s->file, f[0], sizeof(s->file));
+    s->format = (uint16_t)strtoul(f[1], NULL, 10);
+    if (s->format != 16 && s->format != 212)
+        return -1;
+
+    s->gain = 0.0f;
+    s->baseline = 0;
+    if (n > 2)
+    {
+        s->gain = strtof(f[2], &end);
+        if (*end == '(')
+        {
+            s->baseline = strtol(end + 1, NULL, 10);
+            has_base = 1;
+        }
+    }
+    if (s->gain == 0.0f)
+        s->gain = 200.0f;
+    /* the ADC zero is the baseline if none is given */
+    if (!has_base && n > 4)
+        s->baseline = strtol(f[4], NULL, 10);
+    copy(s->desc, n > 8 ? f[8] : "", sizeof(s->desc));
+    return 0;
+}
+
+int hx_wfdb_parse_header(hx_wfdb_header *h, const char *text, uint32_t len)
+{
+    char line[HX_WFDB_LINE], *f[HX_WFDB_FIELDS];
+    uint32_t pos = 0, k;
+    int i, j, n, got_record = 0, sig = 0;
+
+    memset(h, 0, sizeof(*h));
+    while (pos < len)
+    {
+        for (k = 0; pos < len && text[pos] != '\n'; pos++)
+        {
+            if (k < sizeof(line) - 1 && text[pos] != '\r')
+                line[k++] = text[pos];
+        }
+        line[k] = '\0';
+        pos++;
+        if (line[0] == '#')
+            continue;
+        n = split(line, f);
+        if (n == 0)
+            continue;
+
+        if (!got_record)
+        {
+            if (parse_record(h, f, n) < 0)
+                return -1;
+            got_record = 1;
+        }
+        else if (sig < h->nsig && sig < HX_WFDB_MAX_SIG)
+        {
+            if (parse_signal(&h->sig[sig], f, n) < 0)
+                return -1;
+            sig++;
+        }
+    }
+    if (!got_record)
+        return -1;
+    if (h->nsig > sig)
+        h->nsig = (uint8_t)sig;
+
+    /* signals sharing a file are interleaved in it */
+    for (i = 0; i < h->nsig; i++)
+    {
+        for (j = 0; j < h->nsig; j++)
+        {
+            if (strcmp(h->sig[i].file, h->sig[j].file) == 0)
+            {
+                if (j < i)
+                    h->sig[i].file_sig++;
+                h->sig[i].file_nsig++;
+            }
+        }
+    }
+    return 0;
+}
+
+int hx_wfdb_dec_init(hx_wfdb_dec *d, const hx_wfdb_header *h, uint8_t sig)
+{
+    if (sig >= h->nsig)
+        return -1;
+    memset(d, 0, sizeof(*d));
+    d->format = h->sig[sig].format;
+    d->nsig = h->sig[sig].file_nsig;
+    d->sig = h->sig[sig].file_sig;
+    return 0;
+}
+
+static uint32_t emit(hx_wfdb_dec *d, int16_t v, int16_t *out, uint32_t n)
+{
+    if (d->next == d->sig)
+        out[n++] = v;
+    if (++d->next == d->nsig)
+        d->next = 0;
+    return n;
+}
+
+uint32_t hx_wfdb_decode(hx_wfdb_dec *d, const uint8_t *in, uint32_t len, int16_t *out)
+{
+    uint32_t n = 0, i;
+
+    for (i = 0; i < len; i++)
+    {
+        d->pend[d->npend++] = in[i];
+        if (d->format == 16)
+        {
+            if (d->npend == 2)
+            {
+                n = emit(d, (int16_t)(d->pend[0] | (d->pend[1] << 8)), out, n);
+                d->npend = 0;
+            }
+        }
+        else if (d->npend == 3)
+        {
+            /* two 12-bit values in 3 bytes, the high nibbles in the middle byte */
+            int16_t a = (int16_t)(d->pend[0] | ((d->pend[1] & 0x0f) << 8));
+            int16_t b = (int16_t)(d->pend[2] | ((d->pend[1] & 0xf0) << 4));
+
+            if (a & 0x800)
+                a -= 0x1000;
+            if (b & 0x800)
+                b -= 0x1000;
+            n = emit(d, a, out, n);
+            n = emit(d, b, out, n);
+            d->npend = 0;
+        }
+    }
+    return n;
+}
+
+void hx_wfdb_ann_open(hx_wfdb_ann_reader *r, const uint8_t *buf, uint32_t len)
+{
+    r->p = buf;
+    r->end = buf + (len & ~1u);
+    r->t = 0;
+    r->chan = 0;
+    r->num = 0;
+}
+
+static uint16_t word(const uint8_t *p)
+{
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+int hx_wfdb_ann_next(hx_wfdb_ann_reader *r, hx_wfdb_ann *a)
+{
+    uint16_t w;
+    uint32_t code, v;
+
+    /* SKIP words before the annotation */
+    for (;;)
+    {
+        if (r->end - r->p < 2)
+            return 0;
+        w = word(r->p);
+        code = w >> 10;
+        v = w & 0x3ff;
+        if (w == 0)
+            return 0;
+        r->p += 2;
+        if (code == ANN_SKIP)
+        {
+            if (r->end - r->p < 4)
+                return 0;
+            /* PDP-11 order, the high word first */
+            r->t += ((uint32_t)word(r->p) << 16) | word(r->p + 2);
+            r->p += 4;
+            continue;
+        }
+        if (code == ANN_AUX)
+        {
+            /* one without an annotation, skipped */
+            r->p += (v + 1) & ~1u;
+            if (r->p > r->end)
+                r->p = r->end;
+            continue;
+        }
+        if (code >= ANN_NUM)
+            continue;
+        break;
+    }
+
+    r->t += v;
+    a->sample = r->t;
+    a->code = (uint8_t)code;
+    a->sub = 0;
+    a->aux = NULL;
+    a->aux_len = 0;
+
+    /* modifiers of it after it */
+    while (r->end - r->p >= 2)
+    {
+        w = word(r->p);
+        code = w >> 10;
+        v = w & 0x3ff;
+        if (code < ANN_NUM)
+            break;
+        r->p += 2;
+        if (code == ANN_NUM)
+            r->num = (uint8_t)v;
+        else if (code == ANN_SUB)
+            a->sub = (int8_t)v;
+        else if (code == ANN_CHN)
+            r->chan = (uint8_t)v;
+        else
+        {
+            /* AUX: v bytes, padded to a word */
+            if ((uint32_t)(r->end - r->p) < v)
+                v = (uint32_t)(r->end - r->p);
+            a->aux = r->p;
+            a->aux_len = (uint16_t)v;
+            r->p += (v + 1) & ~1u;
+            if (r->p > r->end)
+                r->p = r->end;
+        }
+    }
+    a->chan = r->chan;
+    a->num = r->num;
+    return 1;
+}
+
+int hx_wfdb_isqrs(uint8_t code)
+{
+    return (code >= 1 && code <= 13) || code == 25 || code == 30 || code == 34 ||
+            code == 35 || code == 37 || code == 38 || code == 41;
+}
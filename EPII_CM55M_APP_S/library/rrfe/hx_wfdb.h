@@ -0,0 +1,100 @@
+#ifndef _LIB_HX_WFDB_H_
+#define _LIB_HX_WFDB_H_
+/*
+ * PhysioNet WFDB records from memory: the header (.hea), the signal file
+ * (.dat) in format 16 or 212, and MIT annotations (.atr). No file access
+ * here; the caller reads the files (FatFs on the chip, stdio on the host)
+ * and passes the bytes, the signal file in chunks of any size.
+ *
+ *   hx_wfdb_parse_header(&hea, text, len);
+ *   hx_wfdb_dec_init(&dec, &hea, 0);
+ *   while ((n = read(hea.sig[0].file, buf, sizeof(buf))) > 0)
+ *       hx_rrfe_process(&fe, out, hx_wfdb_decode(&dec, buf, n, out));
+ */
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#ifndef HX_WFDB_MAX_SIG
+#define HX_WFDB_MAX_SIG 4
+#endif
+
+typedef struct hx_wfdb_sig {
+    char file[32];
+    uint16_t format;            /**< 16 or 212 */
+    uint8_t file_sig;           /**< index of the signal in its file */
+    uint8_t file_nsig;          /**< signals interleaved in the file */
+    float gain;                 /**< adu per physical unit, 200 if not given */
+    int32_t baseline;           /**< adu of 0 units */
+    char desc[16];
+} hx_wfdb_sig;
+
+typedef struct hx_wfdb_header {
+    char name[32];
+    uint32_t fs_hz;
+    uint32_t nsamples;          /**< per signal, 0 if not given */
+    uint8_t nsig;               /**< signals described, up to HX_WFDB_MAX_SIG */
+    hx_wfdb_sig sig[HX_WFDB_MAX_SIG];
+} hx_wfdb_header;
+
+/** Decoder of one signal of a signal file */
+typedef struct hx_wfdb_dec {
+    uint16_t format;
+    uint8_t nsig;
+    uint8_t sig;
+    uint8_t next;               /**< signal of the next value */
+    uint8_t npend;
+    uint8_t pend[3];
+} hx_wfdb_dec;
+
+typedef struct hx_wfdb_ann {
+    uint32_t sample;
+    uint8_t code;               /**< 1 NORMAL, 5 PVC, ... as in ecgcodes.h */
+    int8_t sub;
+    uint8_t chan;
+    uint8_t num;
+    const uint8_t *aux;         /**< text, not terminated, NULL if none */
+    uint16_t aux_len;
+} hx_wfdb_ann;
+
+typedef struct hx_wfdb_ann_reader {
+    const uint8_t *p;
+    const uint8_t *end;
+    uint32_t t;
+    uint8_t chan;
+    uint8_t num;
+} hx_wfdb_ann_reader;
+
+/**
+ * @return 0, or -1 if the record line is missing or a signal uses another
+ *         format than 16 and 212
+ */
+int hx_wfdb_parse_header(hx_wfdb_header *h, const char *text, uint32_t len);
+
+/** @return 0, or -1 if sig is not in the header */
+int hx_wfdb_dec_init(hx_wfdb_dec *d, const hx_wfdb_header *h, uint8_t sig);
+
+/**
+ * Decodes the next len bytes of the signal file; a sample split over two
+ * calls is kept.
+ * @param[out] out  samples of the signal, room for len
+ * @return samples written
+ */
+uint32_t hx_wfdb_decode(hx_wfdb_dec *d, const uint8_t *in, uint32_t len, int16_t *out);
+
+void hx_wfdb_ann_open(hx_wfdb_ann_reader *r, const uint8_t *buf, uint32_t len);
+
+/** @return 1 with the next annotation, 0 at the end */
+int hx_wfdb_ann_next(hx_wfdb_ann_reader *r, hx_wfdb_ann *a);
+
+/** 1 for the beat codes, as isqrs() of the WFDB library */
+int hx_wfdb_isqrs(uint8_t code);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _LIB_HX_WFDB_H_ */
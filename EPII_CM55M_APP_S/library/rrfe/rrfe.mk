@@ -0,0 +1,65 @@
+# directory declaration
+LIB_RRFE_DIR = $(LIBRARIES_ROOT)/rrfe
+
+LIB_RRFE_ASMSRCDIR	= $(LIB_RRFE_DIR)
+LIB_RRFE_CSRCDIR	= $(LIB_RRFE_DIR)
+LIB_RRFE_CXXSRCSDIR    = $(LIB_RRFE_DIR)
+LIB_RRFE_INCDIR	= $(LIB_RRFE_DIR)
+
+# find all the source files in the target directories
+LIB_RRFE_CSRCS = $(call get_csrcs, $(LIB_RRFE_CSRCDIR))
+LIB_RRFE_CXXSRCS = $(call get_cxxsrcs, $(LIB_RRFE_CXXSRCSDIR))
+LIB_RRFE_ASMSRCS = $(call get_asmsrcs, $(LIB_RRFE_ASMSRCDIR))
+
+# get object files
+LIB_RRFE_COBJS = $(call get_relobjs, $(LIB_RRFE_CSRCS))
+LIB_RRFE_CXXOBJS = $(call get_relobjs, $(LIB_RRFE_CXXSRCS))
+LIB_RRFE_ASMOBJS = $(call get_relobjs, $(LIB_RRFE_ASMSRCS))
+LIB_RRFE_OBJS = $(LIB_RRFE_COBJS) $(LIB_RRFE_ASMOBJS) $(LIB_RRFE_CXXOBJS)
+
+# get dependency files
+LIB_RRFE_DEPS = $(call get_deps, $(LIB_RRFE_OBJS))
+
+# extra macros to be defined
+LIB_RRFE_DEFINES = -DLIB_RRFE
+
+# genearte library
+ifeq ($(RRFE_LIB_FORCE_PREBUILT), y)
+override LIB_RRFE_OBJS:=
+endif
+RRFE_LIB_NAME = lib_rrfe.a
+LIB_LIB_RRFE := $(subst /,$(PS), $(strip $(OUT_DIR)/$(RRFE_LIB_NAME)))
+
+# library generation rule
+$(LIB_LIB_RRFE): $(LIB_RRFE_OBJS)
+	$(TRACE_ARCHIVE)
+ifeq "$(strip $(LIB_RRFE_OBJS))" ""
+	$(CP) $(PREBUILT_LIB)$(RRFE_LIB_NAME) $(LIB_LIB_RRFE)
+else
+	$(Q)$(AR) $(AR_OPT) $@ $(LIB_RRFE_OBJS)
+	$(CP) $(LIB_LIB_RRFE) $(PREBUILT_LIB)$(RRFE_LIB_NAME)
+endif
+
+# specific compile rules
+# user can add rules to compile this middleware
+# if not rules specified to this middleware, it will use default compiling rules
+
+# Middleware Definitions
+LIB_INCDIR += $(LIB_RRFE_INCDIR)
+LIB_CSRCDIR += $(LIB_RRFE_CSRCDIR)
+LIB_CXXSRCDIR += $(LIB_RRFE_CXXSRCDIR)
+LIB_ASMSRCDIR += $(LIB_RRFE_ASMSRCDIR)
+
+LIB_CSRCS += $(LIB_RRFE_CSRCS)
+LIB_CXXSRCS += $(LIB_RRFE_CXXSRCS)
+LIB_ASMSRCS += $(LIB_RRFE_ASMSRCS)
+LIB_ALLSRCS += $(LIB_RRFE_CSRCS) $(LIB_RRFE_ASMSRCS)
+
+LIB_COBJS += $(LIB_RRFE_COBJS)
+LIB_CXXOBJS += $(LIB_RRFE_CXXOBJS)
+LIB_ASMOBJS += $(LIB_RRFE_ASMOBJS)
+LIB_ALLOBJS += $(LIB_RRFE_OBJS)
+
+LIB_DEFINES += $(LIB_RRFE_DEFINES)
+LIB_DEPS += $(LIB_RRFE_DEPS)
+LIB_LIBS += $(LIB_LIB_RRFE)
\ No newline at end of file
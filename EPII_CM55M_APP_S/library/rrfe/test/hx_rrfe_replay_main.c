@@ -0,0 +1,566 @@
+/*
+ * Host replay of WFDB records through hx_wfdb and hx_rrfe.
+ *
+ *   hx_rrfe_replay --synth <dir>                 synthetic records, checked
+ *   hx_rrfe_replay <record> [signal] [ecg|ppg]   a PhysioNet record
+ *
+ * A record is <record>.hea, the signal file it names and, if there is one,
+ * <record>.atr. The signal file goes through hx_wfdb_decode() in odd sized
+ * chunks and the samples through hx_rrfe_process() as they come. With
+ * annotations the beats are scored against the reference beats (isqrs),
+ * from 3 s in, when the levels are learnt, to 1 s before the end:
+ *
+ *   Se, +P     a beat within 150 ms of a reference beat matches it
+ *   timing     mean and largest |beat - reference|, mean beat - reference
+ *   latency    mean and largest time from the beat to its report
+ *   RR         mean |RR - reference RR| over pairs of matched beats
+ *   windows    each window_ready gives the RR interval of its beat last
+ *
+ * --synth writes two records into <dir> and checks them (make check):
+ * synth_ecg, two ECG leads at 360 Hz in format 212 (as the MIT-BIH
+ * Arrhythmia Database) with sinus rhythm and HRV, PVCs, an AF episode with
+ * f-waves, small beats, baseline wander, mains and muscle noise; and
+ * synth_ppg, a PPG at 125 Hz in format 16, annotated at the steepest rise
+ * of each pulse. A PPG beat is reported later than an ECG beat, its
+ * latency bound is wider. The host time per sample is printed for
+ * reference only.
+ */
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "hx_rrfe.h"
+#include "hx_wfdb.h"
+
+#define MATCH_MS        150
+#define SKIP_START_MS   3000
+#define SKIP_END_MS     1000
+#define MAX_BEATS       20000
+#define CHUNK           499
+
+#define CHECK_SE        99.0
+#define CHECK_PP        99.0
+#define CHECK_TIMING_MS 20.0
+#define CHECK_LATENCY_MS 300.0
+#define CHECK_PPG_LATENCY_MS 500.0
+#define CHECK_RR_MS     10.0
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+typedef struct {
+    uint32_t sample[MAX_BEATS];
+    uint32_t detect[MAX_BEATS];
+    uint8_t searchback[MAX_BEATS];
+    uint32_t n;
+    uint32_t windows;
+    uint32_t window_errors;
+} beats_t;
+
+typedef struct {
+    double se, pp, timing_ms, bias_ms, timing_max_ms, latency_ms, latency_max_ms, rr_ms;
+    uint32_t tp, fn, fp;
+} score_t;
+
+static hx_rrfe fe;
+static beats_t beats;
+static uint32_t ref[MAX_BEATS];
+static uint32_t num_ref;
+
+/* synthesis */
+
+static uint32_t rng_state = 0x2545f491u;
+
+static double uniform(void)
+{
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+    return (rng_state >> 8) / 16777216.0;
+}
+
+static double gauss(void)
+{
+    double u = uniform() + 1e-12, v = uniform();
+
+    return sqrt(-2.0 * log(u)) * cos(2.0 * M_PI * v);
+}
+
+static void add_wave(float *x, uint32_t n, uint32_t fs, double at, double amp, double sigma)
+{
+    int32_t from = (int32_t)((at - 4 * sigma) * fs), to = (int32_t)((at + 4 * sigma) * fs) + 1;
+    int32_t i;
+
+    for (i = from < 0 ? 0 : from; i < to && i < (int32_t)n; i++)
+    {
+        double t = (double)i / fs - at;
+
+        x[i] += (float)(amp * exp(-t * t / (2 * sigma * sigma)));
+    }
+}
+
+static void put16(FILE *f, uint16_t w)
+{
+    fputc(w & 0xff, f);
+    fputc(w >> 8, f);
+}
+
+typedef struct {
+    FILE *f;
+    uint32_t t;
+} ann_writer;
+
+static void ann_put(ann_writer *w, uint32_t sample, uint8_t code, const char *aux)
+{
+    uint32_t dt = sample - w->t;
+
+    if (dt > 1023)
+    {
+        put16(w->f, 59 << 10);
+        put16(w->f, (uint16_t)(dt >> 16));
+        put16(w->f, (uint16_t)dt);
+        dt = 0;
+    }
+    put16(w->f, (uint16_t)((code << 10) | dt));
+    if (aux)
+    {
+        uint32_t len = (uint32_t)strlen(aux);
+
+        put16(w->f, (uint16_t)((63 << 10) | len));
+        fwrite(aux, 1, len, w->f);
+        if (len & 1)
+            fputc(0, w->f);
+    }
+    w->t = sample;
+}
+
+static FILE *open_out(const char *dir, const char *name, const char *ext)
+{
+    char path[512];
+    FILE *f;
+
+    snprintf(path, sizeof(path), "%s/%s%s", dir, name, ext);
+    f = fopen(path, "wb");
+    if (f == NULL)
+        perror(path);
+    return f;
+}
+
+static int synth_ecg(const char *dir)
+{
+    const uint32_t fs = 360, secs = 300, n = fs * secs;
+    float *x[2];
+    FILE *hea, *dat, *atr;
+    ann_writer aw;
+    double t = 0.6, rr_normal = 0.8;
+    uint32_t i, beat = 0, since_pvc = 0;
+    int af = 0, pvc = 0, s;
+
+    x[0] = calloc(n, sizeof(float));
+    x[1] = calloc(n, sizeof(float));
+    hea = open_out(dir, "synth_ecg", ".hea");
+    dat = open_out(dir, "synth_ecg", ".dat");
+    atr = open_out(dir, "synth_ecg", ".atr");
+    if (!x[0] || !x[1] || !hea || !dat || !atr)
+        return -1;
+    aw.f = atr;
+    aw.t = 0;
+    ann_put(&aw, 0, 28, "(N");
+
+    while (t < secs - 0.5)
+    {
+        double rr, resp = sin(2 * M_PI * t / 4.0), amp = 1.0 + 0.1 * resp;
+
+        /* some small beats after the AF, for the searchback */
+        if (t >= 210.0 && beat % 17 == 0)
+            amp = 0.35;
+
+        /* 0-120 s sinus with HRV and PVCs, 120-210 s AF, then faster sinus */
+        if (t < 120.0 || t >= 210.0)
+        {
+            if (af)
+            {
+                af = 0;
+                ann_put(&aw, (uint32_t)(t * fs) - 10, 28, "(N");
+            }
+            rr_normal = (t < 120.0 ? 0.8 : 0.6) + 0.04 * resp + 0.03 * sin(2 * M_PI * t / 25.0) +
+                    0.01 * gauss();
+            rr = rr_normal;
+        }
+        else
+        {
+            if (!af)
+            {
+                af = 1;
+                ann_put(&aw, (uint32_t)(t * fs) - 10, 28, "(AFIB");
+            }
+            rr = 0.45 + 0.6 * uniform();
+        }
+
+        for (s = 0; s < 2; s++)
+        {
+            double g = s ? 0.5 : 1.0;
+
+            if (pvc)
+            {
+                add_wave(x[s], n, fs, t, 1.4 * g * amp, 0.030);
+                add_wave(x[s], n, fs, t + 0.06, -0.5 * g, 0.030);
+                add_wave(x[s], n, fs, t + 0.32, -0.4 * g, 0.060);
+            }
+            else
+            {
+                if (!af)
+                    add_wave(x[s], n, fs, t - 0.16, 0.12 * g, 0.025);
+                add_wave(x[s], n, fs, t - 0.025, -0.12 * g, 0.008);
+                add_wave(x[s], n, fs, t, 1.0 * g * amp, 0.010);
+                add_wave(x[s], n, fs, t + 0.025, -0.25 * g, 0.010);
+                add_wave(x[s], n, fs, t + 0.3 * sqrt(rr_normal), 0.3 * g, 0.045);
+            }
+        }
+        ann_put(&aw, (uint32_t)lrint(t * fs), pvc ? 5 : 1, NULL);
+        beat++;
+
+        /* a PVC comes early and is followed by a compensatory pause */
+        if (pvc)
+        {
+            pvc = 0;
+            t += 1.4 * rr_normal;
+        }
+        else if (t < 120.0 && ++since_pvc >= 23)
+        {
+            pvc = 1;
+            since_pvc = 0;
+            t += 0.6 * rr_normal;
+        }
+        else
+        {
+            t += rr;
+        }
+    }
+    put16(atr, 0);
+
+    for (i = 0; i < n; i++)
+    {
+        double ts = (double)i / fs;
+        double muscle = (ts > 60.0 && ts < 70.0) ? 0.05 : 0.0;
+        double f_wave = (ts >= 120.0 && ts < 210.0) ? 0.05 * sin(2 * M_PI * 6.3 * ts + sin(ts)) : 0.0;
+        int16_t v[2];
+
+        for (s = 0; s < 2; s++)
+        {
+            double mv = x[s][i] + f_wave + 0.3 * sin(2 * M_PI * 0.3 * ts + s) +
+                    0.03 * sin(2 * M_PI * 60.0 * ts) + (0.015 + muscle) * gauss();
+            long adu = lrint(mv * 200.0) + 1024;
+
+            v[s] = (int16_t)(adu < 0 ? 0 : adu > 2047 ? 2047 : adu);
+        }
+        /* one frame of the two leads in 3 bytes */
+        fputc(v[0] & 0xff, dat);
+        fputc(((v[0] >> 8) & 0x0f) | ((v[1] >> 4) & 0xf0), dat);
+        fputc(v[1] & 0xff, dat);
+    }
+
+    fprintf(hea, "synth_ecg 2 %u %u\r\n", fs, n);
+    fprintf(hea, "synth_ecg.dat 212 200 11 1024 1024 0 0 MLII\r\n");
+    fprintf(hea, "synth_ecg.dat 212 200 11 1024 1024 0 0 V5\r\n");
+    fprintf(hea, "# synthetic: sinus with PVCs, AF from 120 s to 210 s, %u beats\r\n", beat);
+
+    fclose(hea);
+    fclose(dat);
+    fclose(atr);
+    free(x[0]);
+    free(x[1]);
+    return 0;
+}
+
+static int synth_ppg(const char *dir)
+{
+    const uint32_t fs = 125, secs = 180, n = fs * secs;
+    float *x;
+    FILE *hea, *dat, *atr;
+    ann_writer aw;
+    double t = 0.5;
+    uint32_t i;
+
+    x = calloc(n, sizeof(float));
+    hea = open_out(dir, "synth_ppg", ".hea");
+    dat = open_out(dir, "synth_ppg", ".dat");
+    atr = open_out(dir, "synth_ppg", ".atr");
+    if (!x || !hea || !dat || !atr)
+        return -1;
+    aw.f = atr;
+    aw.t = 0;
+
+    while (t < secs - 1.0)
+    {
+        double rr = t < 90.0 ? 0.85 + 0.05 * sin(2 * M_PI * t / 4.0) + 0.01 * gauss()
+                             : 0.45 + 0.6 * uniform();
+        double amp = t < 90.0 ? 1.0 : 0.6 + 0.4 * rr;
+
+        /* the steepest rise of a Gaussian is one sigma before its top */
+        add_wave(x, n, fs, t + 0.12, amp, 0.05);
+        add_wave(x, n, fs, t + 0.32, 0.35 * amp, 0.07);
+        ann_put(&aw, (uint32_t)lrint((t + 0.07) * fs), 1, NULL);
+        t += rr;
+    }
+    put16(atr, 0);
+
+    for (i = 0; i < n; i++)
+    {
+        double ts = (double)i / fs;
+        double v = x[i] + 0.2 * sin(2 * M_PI * 0.25 * ts) + 0.01 * gauss();
+
+        put16(dat, (uint16_t)(int16_t)lrint(v * 2000.0));
+    }
+
+    fprintf(hea, "synth_ppg 1 %u %u\n", fs, n);
+    fprintf(hea, "synth_ppg.dat 16 2000 16 0 0 0 0 PLETH\n");
+
+    fclose(hea);
+    fclose(dat);
+    fclose(atr);
+    free(x);
+    return 0;
+}
+
+/* replay */
+
+static uint8_t *load(const char *path, uint32_t *len)
+{
+    FILE *f = fopen(path, "rb");
+    uint8_t *buf;
+    long size;
+
+    if (f == NULL)
+        return NULL;
+    fseek(f, 0, SEEK_END);
+    size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    buf = malloc(size + 1);
+    if (buf && fread(buf, 1, size, f) != (size_t)size)
+    {
+        free(buf);
+        buf = NULL;
+    }
+    fclose(f);
+    *len = (uint32_t)size;
+    return buf;
+}
+
+static void on_beat(void *arg, const hx_rrfe_beat *beat)
+{
+    uint16_t rr[HX_RRFE_MAX_RR];
+    uint32_t w = fe.cfg.window;
+
+    (void)arg;
+    if (beats.n < MAX_BEATS)
+    {
+        beats.sample[beats.n] = beat->sample;
+        beats.detect[beats.n] = beat->detect_sample;
+        beats.searchback[beats.n] = beat->searchback;
+        beats.n++;
+    }
+    if (beat->window_ready)
+    {
+        beats.windows++;
+        if (hx_rrfe_window(&fe, rr, w) != w || rr[w - 1] != beat->rr_ms)
+            beats.window_errors++;
+    }
+}
+
+static void score(uint32_t fs, uint32_t nsamples, score_t *sc)
+{
+    uint32_t from = SKIP_START_MS * fs / 1000, to = nsamples - SKIP_END_MS * fs / 1000;
+    uint32_t match = MATCH_MS * fs / 1000;
+    uint32_t i, j = 0, rr_n = 0, det = 0;
+    int32_t prev_ref = -1, prev_det = -1;
+    double timing = 0, bias = 0, latency = 0, rr_err = 0;
+
+    memset(sc, 0, sizeof(*sc));
+    for (i = 0; i < beats.n; i++)
+    {
+        double lat = (double)(beats.detect[i] - beats.sample[i]) * 1000 / fs;
+
+        if (beats.sample[i] < from || beats.sample[i] > to)
+            continue;
+        det++;
+        latency += lat;
+        if (lat > sc->latency_max_ms)
+            sc->latency_max_ms = lat;
+    }
+
+    for (i = 0; i < num_ref; i++)
+    {
+        uint32_t r = ref[i], best = UINT32_MAX;
+        int32_t bi = -1;
+
+        if (r < from || r > to)
+            continue;
+        while (j < beats.n && beats.sample[j] + match < r)
+            j++;
+        /* the nearest beat within the match window */
+        for (uint32_t k = j; k < beats.n && beats.sample[k] <= r + match; k++)
+        {
+            uint32_t e = beats.sample[k] > r ? beats.sample[k] - r : r - beats.sample[k];
+
+            if (e < best)
+            {
+                best = e;
+                bi = (int32_t)k;
+            }
+        }
+        if (bi < 0)
+        {
+            sc->fn++;
+            prev_ref = -1;
+            continue;
+        }
+        sc->tp++;
+        timing += best;
+        bias += (double)beats.sample[bi] - r;
+        if (best > sc->timing_max_ms)
+            sc->timing_max_ms = best;
+        if (prev_ref >= 0 && prev_det == bi - 1)
+        {
+            int32_t e = (int32_t)(beats.sample[bi] - beats.sample[bi - 1]) - (int32_t)(r - prev_ref);
+
+            rr_err += e < 0 ? -e : e;
+            rr_n++;
+        }
+        prev_ref = (int32_t)r;
+        prev_det = bi;
+        j = bi + 1;
+    }
+
+    sc->fp = det > sc->tp ? det - sc->tp : 0;
+    sc->se = sc->tp + sc->fn ? 100.0 * sc->tp / (sc->tp + sc->fn) : 0;
+    sc->pp = sc->tp + sc->fp ? 100.0 * sc->tp / (sc->tp + sc->fp) : 0;
+    sc->timing_ms = sc->tp ? timing * 1000 / fs / sc->tp : 0;
+    sc->bias_ms = sc->tp ? bias * 1000 / fs / sc->tp : 0;
+    sc->timing_max_ms = sc->timing_max_ms * 1000 / fs;
+    sc->latency_ms = det ? latency / det : 0;
+    sc->rr_ms = rr_n ? rr_err * 1000 / fs / rr_n : 0;
+}
+
+static int replay(const char *record, uint8_t sig, hx_rrfe_signal type, int check)
+{
+    char path[512];
+    hx_wfdb_header hea;
+    hx_wfdb_dec dec;
+    hx_wfdb_ann_reader ar;
+    hx_wfdb_ann ann;
+    hx_rrfe_cfg cfg;
+    score_t sc;
+    uint8_t *text, *dat, *atr;
+    int16_t out[CHUNK];
+    uint32_t len, dat_len, atr_len, pos, total = 0, sb = 0, i;
+    const char *slash = strrchr(record, '/');
+    double max_latency = type == HX_RRFE_PPG ? CHECK_PPG_LATENCY_MS : CHECK_LATENCY_MS;
+    clock_t t0, busy = 0;
+    int ok = 1;
+
+    snprintf(path, sizeof(path), "%s.hea", record);
+    text = load(path, &len);
+    if (text == NULL || hx_wfdb_parse_header(&hea, (const char *)text, len) < 0 ||
+        hx_wfdb_dec_init(&dec, &hea, sig) < 0)
+    {
+        printf("%s: no header, or signal %u not in it\n", path, sig);
+        return 0;
+    }
+    free(text);
+
+    snprintf(path, sizeof(path), "%.*s%s", slash ? (int)(slash - record + 1) : 0, record,
+            hea.sig[sig].file);
+    dat = load(path, &dat_len);
+    if (dat == NULL)
+    {
+        perror(path);
+        return 0;
+    }
+
+    hx_rrfe_default_cfg(&cfg, type, hea.fs_hz);
+    if (hx_rrfe_init(&fe, &cfg, on_beat, NULL) < 0)
+    {
+        printf("%s: %u Hz does not fit the front end\n", record, hea.fs_hz);
+        return 0;
+    }
+    memset(&beats, 0, sizeof(beats));
+
+    for (pos = 0; pos < dat_len; pos += CHUNK)
+    {
+        uint32_t n = dat_len - pos < CHUNK ? dat_len - pos : CHUNK;
+
+        n = hx_wfdb_decode(&dec, dat + pos, n, out);
+        t0 = clock();
+        hx_rrfe_process(&fe, out, n);
+        busy += clock() - t0;
+        total += n;
+    }
+    free(dat);
+    for (i = 0; i < beats.n; i++)
+        sb += beats.searchback[i];
+
+    printf("%s: %s %s, %u Hz, %u samples, %u beats (%u by searchback), %u windows, %.0f ns per sample\n",
+            record, type == HX_RRFE_PPG ? "PPG" : "ECG", hea.sig[sig].desc, hea.fs_hz, total,
+            beats.n, sb, beats.windows, total ? (double)busy * 1e9 / CLOCKS_PER_SEC / total : 0.0);
+
+    snprintf(path, sizeof(path), "%s.atr", record);
+    atr = load(path, &atr_len);
+    if (atr == NULL)
+        return !check;
+    num_ref = 0;
+    hx_wfdb_ann_open(&ar, atr, atr_len);
+    while (hx_wfdb_ann_next(&ar, &ann) && num_ref < MAX_BEATS)
+    {
+        if (hx_wfdb_isqrs(ann.code))
+            ref[num_ref++] = ann.sample;
+    }
+    free(atr);
+
+    score(hea.fs_hz, total, &sc);
+    printf("  Se %.2f%% +P %.2f%% (%u TP, %u FN, %u FP)\n", sc.se, sc.pp, sc.tp, sc.fn, sc.fp);
+    printf("  timing %.1f ms mean (%+.1f ms bias), %.1f ms max; latency %.0f ms mean, %.0f ms max\n",
+            sc.timing_ms, sc.bias_ms, sc.timing_max_ms, sc.latency_ms, sc.latency_max_ms);
+    printf("  RR error %.1f ms mean; %u windows not ending with their beat\n", sc.rr_ms,
+            beats.window_errors);
+
+    if (check)
+    {
+        ok = sc.se >= CHECK_SE && sc.pp >= CHECK_PP && sc.timing_ms <= CHECK_TIMING_MS &&
+                sc.latency_ms <= max_latency && sc.rr_ms <= CHECK_RR_MS &&
+                beats.window_errors == 0 && beats.windows > 0;
+        if (!ok)
+            printf("  FAILED: needs Se and +P >= %.0f%%, timing <= %.0f ms, latency <= %.0f ms, "
+                    "RR error <= %.0f ms, consistent windows\n", CHECK_SE, CHECK_TIMING_MS,
+                    max_latency, CHECK_RR_MS);
+    }
+    return ok;
+}
+
+int main(int argc, char **argv)
+{
+    char record[512];
+    int failed = 0;
+
+    if (argc == 3 && strcmp(argv[1], "--synth") == 0)
+    {
+        if (synth_ecg(argv[2]) < 0 || synth_ppg(argv[2]) < 0)
+            return 1;
+        snprintf(record, sizeof(record), "%s/synth_ecg", argv[2]);
+        failed += !replay(record, 0, HX_RRFE_ECG, 1);
+        snprintf(record, sizeof(record), "%s/synth_ppg", argv[2]);
+        failed += !replay(record, 0, HX_RRFE_PPG, 1);
+        printf(failed ? "FAILED\n" : "PASSED\n");
+        return failed ? 1 : 0;
+    }
+    if (argc < 2)
+    {
+        printf("usage: %s --synth <dir> | <record> [signal] [ecg|ppg]\n", argv[0]);
+        return 1;
+    }
+    replay(argv[1], argc > 2 ? (uint8_t)atoi(argv[2]) : 0,
+            argc > 3 && strcmp(argv[3], "ppg") == 0 ? HX_RRFE_PPG : HX_RRFE_ECG, 0);
+    return 0;
+}
@@ -0,0 +1,318 @@
+#include <string.h>
+#include "hx_tracker.h"
+
+/* Velocity variance of a new track, (pixels per frame)^2: its speed is unknown */
+#define TRACKER_NEW_VEL_VAR 100.0f
+
+enum { AXIS_CX = 0, AXIS_CY, AXIS_W, AXIS_H };
+
+void hx_tracker_default_cfg(hx_tracker_cfg *cfg)
+{
+    cfg->max_interval = 10;
+    cfg->max_misses = 2;
+    cfg->iou_threshold = 0.3f;
+    cfg->speed_threshold = 2.0f;
+    cfg->pos_noise = 1.0f;
+    cfg->vel_noise = 0.25f;
+    cfg->meas_noise = 4.0f;
+}
+
+void hx_tracker_init(hx_tracker *t, const hx_tracker_cfg *cfg)
+{
+    memset(t, 0, sizeof(*t));
+    if (cfg)
+        t->cfg = *cfg;
+    else
+        hx_tracker_default_cfg(&t->cfg);
+    if (t->cfg.max_interval < 1)
+        t->cfg.max_interval = 1;
+    t->next_id = 1;
+}
+
+void hx_tracker_reset(hx_tracker *t)
+{
+    hx_tracker_cfg cfg = t->cfg;
+    uint16_t next_id = t->next_id;
+    uint32_t frames = t->frames;
+    uint32_t detects = t->detects;
+
+    hx_tracker_init(t, &cfg);
+    t->next_id = next_id;
+    t->frames = frames;
+    t->detects = detects;
+    t->since_detect = cfg.max_interval;
+}
+
+static void axis_init(hx_tracker_axis *a, float z, float meas_noise)
+{
+    a->p = z;
+    a->v = 0.0f;
+    a->p00 = meas_noise;
+    a->p01 = 0.0f;
+    a->p11 = TRACKER_NEW_VEL_VAR;
+}
+
+/* x = F x, P = F P F' + Q with F = [1 1; 0 1] */
+static void axis_predict(hx_tracker_axis *a, float pos_noise, float vel_noise)
+{
+    a->p += a->v;
+    a->p00 += 2.0f * a->p01 + a->p11 + pos_noise;
+    a->p01 += a->p11;
+    a->p11 += vel_noise;
+}
+
+/* Measurement of the value only, H = [1 0] */
+static void axis_update(hx_tracker_axis *a, float z, float meas_noise)
+{
+    float s = a->p00 + meas_noise;
+    float k0 = a->p00 / s;
+    float k1 = a->p01 / s;
+    float y = z - a->p;
+
+    a->p += k0 * y;
+    a->v += k1 * y;
+    a->p11 -= k1 * a->p01;
+    a->p01 -= k0 * a->p01;
+    a->p00 -= k0 * a->p00;
+}
+
+static void track_box(const hx_tracker_track *tr, hx_tracker_box *b)
+{
+    float w = tr->axis[AXIS_W].p;
+    float h = tr->axis[AXIS_H].p;
+
+    if (w < 1.0f)
+        w = 1.0f;
+    if (h < 1.0f)
+        h = 1.0f;
+    b->x = tr->axis[AXIS_CX].p - 0.5f * w;
+    b->y = tr->axis[AXIS_CY].p - 0.5f * h;
+    b->w = w;
+    b->h = h;
+    b->score = tr->score;
+    b->cls = tr->cls;
+    b->id = tr->id;
+}
+
+static void track_start(hx_tracker *t, hx_tracker_track *tr, const hx_tracker_box *d)
+{
+    float r = t->cfg.meas_noise;
+
+    axis_init(&tr->axis[AXIS_CX], d->x + 0.5f * d->w, r);
+    axis_init(&tr->axis[AXIS_CY], d->y + 0.5f * d->h, r);
+    axis_init(&tr->axis[AXIS_W], d->w, r);
+    axis_init(&tr->axis[AXIS_H], d->h, r);
+    tr->score = d->score;
+    tr->cls = d->cls;
+    tr->id = t->next_id++;
+    if (t->next_id == 0)
+        t->next_id = 1;
+    tr->hits = 1;
+    tr->misses = 0;
+    tr->used = 1;
+}
+
+static void track_correct(const hx_tracker *t, hx_tracker_track *tr, const hx_tracker_box *d)
+{
+    float r = t->cfg.meas_noise;
+
+    axis_update(&tr->axis[AXIS_CX], d->x + 0.5f * d->w, r);
+    axis_update(&tr->axis[AXIS_CY], d->y + 0.5f * d->h, r);
+    axis_update(&tr->axis[AXIS_W], d->w, r);
+    axis_update(&tr->axis[AXIS_H], d->h, r);
+    tr->score = d->score;
+    if (tr->hits < 0xffff)
+        tr->hits++;
+    tr->misses = 0;
+}
+
+float hx_tracker_iou(const hx_tracker_box *a, const hx_tracker_box *b)
+{
+    float x0 = a->x > b->x ? a->x : b->x;
+    float y0 = a->y > b->y ? a->y : b->y;
+    float x1 = (a->x + a->w) < (b->x + b->w) ? (a->x + a->w) : (b->x + b->w);
+    float y1 = (a->y + a->h) < (b->y + b->h) ? (a->y + a->h) : (b->y + b->h);
+    float inter, uni;
+
+    if (a->w <= 0.0f || a->h <= 0.0f || b->w <= 0.0f || b->h <= 0.0f || x1 <= x0 || y1 <= y0)
+        return 0.0f;
+    inter = (x1 - x0) * (y1 - y0);
+    uni = a->w * a->h + b->w * b->h - inter;
+    return inter / uni;
+}
+
+void hx_tracker_predict(hx_tracker *t)
+{
+    int i, k;
+
+    for (i = 0; i < HX_TRACKER_MAX_TRACKS; i++) {
+        if (!t->track[i].used)
+            continue;
+        for (k = 0; k < 4; k++)
+            axis_predict(&t->track[i].axis[k], t->cfg.pos_noise, t->cfg.vel_noise);
+    }
+    t->frames++;
+    if (t->since_detect < 0xffff)
+        t->since_detect++;
+}
+
+int hx_tracker_need_detect(const hx_tracker *t, int motion)
+{
+    float speed2 = t->cfg.speed_threshold * t->cfg.speed_threshold;
+    int i;
+
+    if (motion || t->detects == 0 || t->since_detect >= t->cfg.max_interval)
+        return 1;
+
+    for (i = 0; i < HX_TRACKER_MAX_TRACKS; i++) {
+        const hx_tracker_track *tr = &t->track[i];
+        float vx, vy;
+
+        if (!tr->used)
+            continue;
+        if (tr->hits < 2 || tr->misses > 0)
+            return 1;
+        vx = tr->axis[AXIS_CX].v;
+        vy = tr->axis[AXIS_CY].v;
+        if (vx * vx + vy * vy > speed2)
+            return 1;
+    }
+    return 0;
+}
+
+int hx_tracker_update(hx_tracker *t, const hx_tracker_box *det, int det_count)
+{
+    uint8_t det_used[HX_TRACKER_MAX_DETECTIONS];
+    uint8_t trk_used[HX_TRACKER_MAX_TRACKS];
+    int i, j, live = 0;
+
+    if (det_count < 0)
+        det_count = 0;
+    if (det_count > HX_TRACKER_MAX_DETECTIONS)
+        det_count = HX_TRACKER_MAX_DETECTIONS;
+    memset(det_used, 0, sizeof(det_used));
+    memset(trk_used, 0, sizeof(trk_used));
+
+    for (i = 0; i < HX_TRACKER_MAX_TRACKS; i++) {
+        hx_tracker_box pred;
+
+        if (!t->track[i].used)
+            continue;
+        track_box(&t->track[i], &pred);
+        for (j = 0; j < det_count; j++)
+            t->iou[i][j] = det[j].cls == pred.cls ? hx_tracker_iou(&pred, &det[j]) : 0.0f;
+    }
+
+    /* greedy: best remaining pair first */
+    for (;;) {
+        float best = t->cfg.iou_threshold;
+        int bi = -1, bj = -1;
+
+        for (i = 0; i < HX_TRACKER_MAX_TRACKS; i++) {
+            if (!t->track[i].used || trk_used[i])
+                continue;
+            for (j = 0; j < det_count; j++) {
+                if (!det_used[j] && t->iou[i][j] >= best) {
+                    best = t->iou[i][j];
+                    bi = i;
+                    bj = j;
+                }
+            }
+        }
+        if (bi < 0)
+            break;
+        track_correct(t, &t->track[bi], &det[bj]);
+        trk_used[bi] = 1;
+        det_used[bj] = 1;
+    }
+
+    for (i = 0; i < HX_TRACKER_MAX_TRACKS; i++) {
+        hx_tracker_track *tr = &t->track[i];
+
+        if (!tr->used || trk_used[i])
+            continue;
+        if (++tr->misses > t->cfg.max_misses)
+            tr->used = 0;
+    }
+
+    /* detections come in score order from NMS, so the best ones get slots */
+    for (j = 0, i = 0; j < det_count; j++) {
+        if (det_used[j] || det[j].w <= 0.0f || det[j].h <= 0.0f)
+            continue;
+        while (i < HX_TRACKER_MAX_TRACKS && t->track[i].used)
+            i++;
+        if (i == HX_TRACKER_MAX_TRACKS)
+            break;
+        track_start(t, &t->track[i], &det[j]);
+    }
+
+    for (i = 0; i < HX_TRACKER_MAX_TRACKS; i++)
+        live += t->track[i].used;
+
+    t->since_detect = 0;
+    t->detects++;
+    return live;
+}
+
+int hx_tracker_get(const hx_tracker *t, hx_tracker_box *out, int max_out)
+{
+    int i, n = 0;
+
+    for (i = 0; i < HX_TRACKER_MAX_TRACKS && n < max_out; i++) {
+        if (!t->track[i].used || t->track[i].misses > 0)
+            continue;
+        track_box(&t->track[i], &out[n++]);
+    }
+    return n;
+}
+
+int hx_tracker_motion_init(hx_tracker_motion *m, int w, int h, uint8_t pixel_threshold, uint16_t change_permille)
+{
+    int step = 1;
+
+    memset(m, 0, sizeof(*m));
+    if (w < 1 || h < 1)
+        return -1;
+    while (((w + step - 1) / step) * ((h + step - 1) / step) > HX_TRACKER_MOTION_MAX_SAMPLES)
+        step++;
+    m->w = w;
+    m->h = h;
+    m->step = step;
+    m->cols = (w + step - 1) / step;
+    m->rows = (h + step - 1) / step;
+    m->pixel_threshold = pixel_threshold;
+    m->change_permille = change_permille;
+    return 0;
+}
+
+int hx_tracker_motion_update(hx_tracker_motion *m, const uint8_t *plane)
+{
+    int count = m->cols * m->rows;
+    int x0 = m->step / 2;
+    int changed = 0;
+    int r, c, n = 0;
+
+    if (count == 0)
+        return 1;
+
+    for (r = 0; r < m->rows; r++) {
+        const uint8_t *row = plane + (size_t)(r * m->step + x0 < m->h ? r * m->step + x0 : m->h - 1) * m->w;
+
+        for (c = 0; c < m->cols; c++, n++) {
+            int x = c * m->step + x0;
+            uint8_t v = row[x < m->w ? x : m->w - 1];
+            int d = (int)v - (int)m->sample[n];
+
+            if (d > m->pixel_threshold || -d > m->pixel_threshold)
+                changed++;
+            m->sample[n] = v;
+        }
+    }
+
+    m->changed = (uint16_t)changed;
+    if (!m->valid) {
+        m->valid = 1;
+        return 1;
+    }
+    return changed * 1000 > (int)m->change_permille * count;
+}
@@ -0,0 +1,173 @@
+#ifndef _LIB_HX_TRACKER_H_
+#define _LIB_HX_TRACKER_H_
+/*
+ * Tracking-by-detection so that a detector does not have to run on every
+ * frame of a static scene.
+ *
+ * Every frame the app asks hx_tracker_need_detect() whether to run the
+ * detector. It says yes when the scene moved (a motion flag from the CDM
+ * event or from hx_tracker_motion_update()), when a track is moving, or
+ * when the last detection is max_interval frames old. Otherwise the app
+ * skips the model and sends the tracks that hx_tracker_predict() moved
+ * one frame forward.
+ *
+ * Each track keeps a constant velocity Kalman filter per box coordinate
+ * (centre x, centre y, width, height). Detections are matched to the
+ * predicted tracks greedily by IoU within the same class; unmatched
+ * detections start new tracks, tracks that miss max_misses detector runs
+ * in a row are dropped. Everything is in fixed size arrays, no heap.
+ *
+ * Usage, once per frame:
+ *   static hx_tracker trk;          hx_tracker_init(&trk, NULL) once
+ *   hx_tracker_predict(&trk);
+ *   if (hx_tracker_need_detect(&trk, motion)) {
+ *       run the model, fill det[0..n)
+ *       hx_tracker_update(&trk, det, n);
+ *       send det
+ *   } else {
+ *       n = hx_tracker_get(&trk, out, max);
+ *       send out
+ *   }
+ */
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#ifndef HX_TRACKER_MAX_TRACKS
+#define HX_TRACKER_MAX_TRACKS 16
+#endif
+
+/** Detections matched per hx_tracker_update(), the rest are ignored */
+#ifndef HX_TRACKER_MAX_DETECTIONS
+#define HX_TRACKER_MAX_DETECTIONS 40
+#endif
+
+/** Samples kept by hx_tracker_motion, 40 x 30 on a 640 x 480 frame */
+#ifndef HX_TRACKER_MOTION_MAX_SAMPLES
+#define HX_TRACKER_MOTION_MAX_SAMPLES 1200
+#endif
+
+/** Box in frame pixels, (x, y) is the top-left corner like el_box_t */
+typedef struct hx_tracker_box {
+    float x;
+    float y;
+    float w;
+    float h;
+    float score;
+    uint16_t cls;
+    uint16_t id;    /**< track id, set by hx_tracker_get(); ignored in detections */
+} hx_tracker_box;
+
+typedef struct hx_tracker_cfg {
+    uint16_t max_interval;  /**< run the detector at least every max_interval frames, >= 1 */
+    uint16_t max_misses;    /**< detector runs a track may go unmatched before it is dropped */
+    float iou_threshold;    /**< minimum IoU between a predicted track and a detection */
+    float speed_threshold;  /**< pixels per frame; a faster track forces a detector run */
+    float pos_noise;        /**< process noise of the position, pixels^2 per frame */
+    float vel_noise;        /**< process noise of the velocity, (pixels per frame)^2 per frame */
+    float meas_noise;       /**< detector box noise, pixels^2 */
+} hx_tracker_cfg;
+
+/** Kalman state of one coordinate: value, rate per frame and their covariance */
+typedef struct hx_tracker_axis {
+    float p;
+    float v;
+    float p00;
+    float p01;
+    float p11;
+} hx_tracker_axis;
+
+typedef struct hx_tracker_track {
+    hx_tracker_axis axis[4];    /**< centre x, centre y, w, h */
+    float score;
+    uint16_t cls;
+    uint16_t id;
+    uint16_t hits;
+    uint16_t misses;            /**< detector runs in a row without a match */
+    uint8_t used;
+} hx_tracker_track;
+
+typedef struct hx_tracker {
+    hx_tracker_cfg cfg;
+    hx_tracker_track track[HX_TRACKER_MAX_TRACKS];
+    uint16_t next_id;
+    uint16_t since_detect;      /**< frames since the last hx_tracker_update() */
+    uint32_t frames;            /**< hx_tracker_predict() calls */
+    uint32_t detects;           /**< hx_tracker_update() calls */
+    float iou[HX_TRACKER_MAX_TRACKS][HX_TRACKER_MAX_DETECTIONS];   /**< matching scratch */
+} hx_tracker;
+
+/**
+ * Sparse frame difference: one byte every step x step pixels of a plane
+ * is kept, a frame is "moving" when more than change_permille of those
+ * samples changed by more than pixel_threshold since the last call.
+ */
+typedef struct hx_tracker_motion {
+    uint8_t sample[HX_TRACKER_MOTION_MAX_SAMPLES];
+    int w;
+    int h;
+    int step;
+    int cols;
+    int rows;
+    int valid;
+    uint8_t pixel_threshold;
+    uint16_t change_permille;
+    uint16_t changed;           /**< changed samples in the last call */
+} hx_tracker_motion;
+
+/** max_interval 10, max_misses 2, IoU 0.3, speed 2 px/frame */
+void hx_tracker_default_cfg(hx_tracker_cfg *cfg);
+
+/** cfg may be NULL for hx_tracker_default_cfg() */
+void hx_tracker_init(hx_tracker *t, const hx_tracker_cfg *cfg);
+
+/** Drops all tracks; the next hx_tracker_need_detect() says yes */
+void hx_tracker_reset(hx_tracker *t);
+
+/** Moves every track one frame forward; call once per frame, before the rest */
+void hx_tracker_predict(hx_tracker *t);
+
+/**
+ * 1 if the detector has to run on this frame: on motion, on the first
+ * frame, max_interval frames after the last run, while a track is new
+ * (its velocity is not known yet), lost, or faster than speed_threshold.
+ */
+int hx_tracker_need_detect(const hx_tracker *t, int motion);
+
+/**
+ * Corrects the tracks with the detector output of this frame.
+ * \retval number of live tracks
+ */
+int hx_tracker_update(hx_tracker *t, const hx_tracker_box *det, int det_count);
+
+/**
+ * Tracks matched by the last detector run, at their predicted place.
+ * \retval number of boxes written to out, at most max_out
+ */
+int hx_tracker_get(const hx_tracker *t, hx_tracker_box *out, int max_out);
+
+/** IoU of two boxes, 0 when either is empty */
+float hx_tracker_iou(const hx_tracker_box *a, const hx_tracker_box *b);
+
+/**
+ * Samples a w x h plane on a grid of at most HX_TRACKER_MOTION_MAX_SAMPLES.
+ * \retval 0, or -1 for a bad size
+ */
+int hx_tracker_motion_init(hx_tracker_motion *m, int w, int h, uint8_t pixel_threshold, uint16_t change_permille);
+
+/**
+ * Compares the plane with the samples of the last call and keeps the new
+ * ones. The first call after init reports motion.
+ * \retval 1 on motion, 0 otherwise
+ */
+int hx_tracker_motion_update(hx_tracker_motion *m, const uint8_t *plane);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _LIB_HX_TRACKER_H_ */
@@ -0,0 +1,292 @@
+/*
+ * Replay benchmark of hx_tracker.
+ *
+ *   hx_tracker_replay [log] [max_interval]
+ *
+ * A sequence holds, per frame, the motion flag and the boxes of the
+ * detector run on that frame. tflm_yolov8_od prints one such line per
+ * frame with YOLOV8_TRACKER_RECORD set:
+ *
+ *   TRK <motion> <n> <x> <y> <w> <h> <score %> <class> ... (n boxes)
+ *
+ * other lines of the log are skipped. Without a log, synthetic sequences
+ * are replayed and checked (make check).
+ *
+ * The replay runs the scheduler: on detect frames the recorded boxes are
+ * fed to the tracker and sent, on the other frames the tracker output is
+ * sent. What was sent is then matched to the recorded boxes of the same
+ * frame, i.e. to a detector run on every frame: recall and precision at
+ * IoU 0.5 within the class, mean IoU of the matches, and the share of
+ * frames that ran the detector.
+ */
+#define _POSIX_C_SOURCE 199309L
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "hx_tracker.h"
+
+#define MAX_FRAMES 4000
+#define MAX_BOXES HX_TRACKER_MAX_DETECTIONS
+
+typedef struct {
+    int motion;
+    int count;
+    hx_tracker_box box[MAX_BOXES];
+} frame_rec;
+
+typedef struct {
+    int frames;
+    int detects;
+    int ref_boxes;
+    int sent_boxes;
+    int matched;
+    double iou_sum;
+    double us;
+} replay_stats;
+
+static frame_rec seq[MAX_FRAMES];
+
+static double host_now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static uint32_t rng_state = 0x2545f491u;
+
+static float rand_jitter(float amplitude)
+{
+    rng_state = rng_state * 1664525u + 1013904223u;
+    return amplitude * (2.0f * (float)(rng_state >> 8) / (float)(1u << 24) - 1.0f);
+}
+
+static int load_log(const char *path)
+{
+    char line[4096];
+    int n = 0;
+    FILE *f = fopen(path, "r");
+
+    if (!f) {
+        printf("cannot open %s\n", path);
+        return -1;
+    }
+    while (n < MAX_FRAMES && fgets(line, sizeof(line), f)) {
+        char *p = strstr(line, "TRK ");
+        frame_rec *fr = &seq[n];
+        int used, count;
+
+        if (!p || sscanf(p, "TRK %d %d%n", &fr->motion, &count, &used) != 2)
+            continue;
+        p += used;
+        fr->count = 0;
+        for (int i = 0; i < count; i++) {
+            int x, y, w, h, score, cls;
+
+            if (sscanf(p, "%d %d %d %d %d %d%n", &x, &y, &w, &h, &score, &cls, &used) != 6)
+                break;
+            p += used;
+            if (fr->count < MAX_BOXES) {
+                hx_tracker_box *b = &fr->box[fr->count++];
+                b->x = (float)x;
+                b->y = (float)y;
+                b->w = (float)w;
+                b->h = (float)h;
+                b->score = score / 100.0f;
+                b->cls = (uint16_t)cls;
+                b->id = 0;
+            }
+        }
+        n++;
+    }
+    fclose(f);
+    return n;
+}
+
+/* Sent boxes against the recorded ones, greedy by IoU */
+static void score_frame(const hx_tracker_box *sent, int sent_n, const frame_rec *ref, replay_stats *st)
+{
+    uint8_t used[MAX_BOXES] = {0};
+
+    st->ref_boxes += ref->count;
+    st->sent_boxes += sent_n;
+    for (int i = 0; i < ref->count; i++) {
+        float best = 0.5f;
+        int bj = -1;
+
+        for (int j = 0; j < sent_n; j++) {
+            float iou;
+
+            if (used[j] || sent[j].cls != ref->box[i].cls)
+                continue;
+            iou = hx_tracker_iou(&sent[j], &ref->box[i]);
+            if (iou >= best) {
+                best = iou;
+                bj = j;
+            }
+        }
+        if (bj >= 0) {
+            used[bj] = 1;
+            st->matched++;
+            st->iou_sum += best;
+        }
+    }
+}
+
+static void replay(const frame_rec *frames, int n, const hx_tracker_cfg *cfg, int use_motion, replay_stats *st)
+{
+    static hx_tracker trk;
+    hx_tracker_box out[MAX_BOXES];
+
+    memset(st, 0, sizeof(*st));
+    hx_tracker_init(&trk, cfg);
+    for (int f = 0; f < n; f++) {
+        const hx_tracker_box *sent;
+        int sent_n;
+        double t0 = host_now_us();
+
+        hx_tracker_predict(&trk);
+        if (hx_tracker_need_detect(&trk, use_motion && frames[f].motion)) {
+            hx_tracker_update(&trk, frames[f].box, frames[f].count);
+            sent = frames[f].box;
+            sent_n = frames[f].count;
+            st->detects++;
+        } else {
+            sent_n = hx_tracker_get(&trk, out, MAX_BOXES);
+            sent = out;
+        }
+        st->us += host_now_us() - t0;
+        score_frame(sent, sent_n, &frames[f], st);
+        st->frames++;
+    }
+}
+
+static void print_stats(const char *name, const char *mode, const replay_stats *st)
+{
+    printf("%-8s %-9s %5d frames, detector %5.1f%%, recall %5.3f, precision %5.3f, mean IoU %5.3f, %5.2f us/frame\n",
+           name, mode, st->frames, 100.0 * st->detects / st->frames,
+           st->ref_boxes ? (double)st->matched / st->ref_boxes : 1.0,
+           st->sent_boxes ? (double)st->matched / st->sent_boxes : 1.0,
+           st->matched ? st->iou_sum / st->matched : 1.0, st->us / st->frames);
+}
+
+/*
+ * Synthetic scenes on a 640x480 frame, boxes jitter by 1 px like a real
+ * detector on a still object:
+ * static  three still objects, one missed by the detector every 25 frames
+ * walker  still objects, a person crossing at 4 px/frame from frame 100
+ * drift   a slow pan, every box moves 0.5 px/frame and no motion flag
+ */
+static int make_scene(const char *name)
+{
+    int n = 300;
+
+    for (int f = 0; f < n; f++) {
+        frame_rec *fr = &seq[f];
+        int moving = 0;
+
+        fr->count = 0;
+        for (int i = 0; i < 3; i++) {
+            hx_tracker_box *b = &fr->box[fr->count];
+            float dx = 0.0f;
+
+            if (!strcmp(name, "static") && i == 1 && f % 25 == 24)
+                continue;
+            if (!strcmp(name, "drift"))
+                dx = 0.5f * f;
+            b->x = 60.0f + 200.0f * i + dx + rand_jitter(1.0f);
+            b->y = 120.0f + 30.0f * i + rand_jitter(1.0f);
+            b->w = 80.0f + rand_jitter(1.0f);
+            b->h = 120.0f + rand_jitter(1.0f);
+            b->score = 0.8f;
+            b->cls = (uint16_t)(i + 56);
+            b->id = 0;
+            fr->count++;
+        }
+        if (!strcmp(name, "walker") && f >= 100 && f < 250) {
+            hx_tracker_box *b = &fr->box[fr->count++];
+
+            b->x = 4.0f * (f - 100) + rand_jitter(1.0f);
+            b->y = 200.0f + rand_jitter(1.0f);
+            b->w = 60.0f + rand_jitter(1.0f);
+            b->h = 160.0f + rand_jitter(1.0f);
+            b->score = 0.7f;
+            b->cls = 0;
+            b->id = 0;
+            moving = 1;
+        }
+        fr->motion = moving;
+    }
+    return n;
+}
+
+static int check(const char *what, int ok)
+{
+    if (!ok)
+        printf("FAIL: %s\n", what);
+    return !ok;
+}
+
+int main(int argc, char **argv)
+{
+    hx_tracker_cfg cfg;
+    replay_stats st, every;
+    int failures = 0;
+
+    hx_tracker_default_cfg(&cfg);
+    if (argc > 2)
+        cfg.max_interval = (uint16_t)atoi(argv[2]);
+
+    if (argc > 1) {
+        int n = load_log(argv[1]);
+
+        if (n <= 0) {
+            printf("no TRK lines in %s\n", argv[1]);
+            return 1;
+        }
+        replay(seq, n, &cfg, 1, &st);
+        print_stats("log", "motion", &st);
+        replay(seq, n, &cfg, 0, &st);
+        print_stats("log", "no motion", &st);
+        return 0;
+    }
+
+    printf("max_interval %d, max_misses %d, IoU %.2f, speed %.1f px/frame\n", cfg.max_interval, cfg.max_misses,
+           cfg.iou_threshold, cfg.speed_threshold);
+
+    int n = make_scene("static");
+    replay(seq, n, &cfg, 1, &st);
+    print_stats("static", "motion", &st);
+    failures += check("static scene runs the detector on at most 15% of the frames", st.detects * 100 <= 15 * n);
+    failures += check("static scene recall", st.matched * 100 >= 98 * st.ref_boxes);
+    failures += check("static scene mean IoU", st.iou_sum >= 0.9 * st.matched);
+
+    n = make_scene("walker");
+    replay(seq, n, &cfg, 1, &st);
+    print_stats("walker", "motion", &st);
+    failures += check("walker recall with motion", st.matched == st.ref_boxes);
+    replay(seq, n, &cfg, 0, &st);
+    print_stats("walker", "no motion", &st);
+    failures += check("walker recall from track speed alone", st.matched * 100 >= 95 * st.ref_boxes);
+
+    n = make_scene("drift");
+    replay(seq, n, &cfg, 0, &st);
+    print_stats("drift", "no motion", &st);
+    failures += check("drift recall", st.matched * 100 >= 98 * st.ref_boxes);
+    failures += check("drift mean IoU", st.iou_sum >= 0.85 * st.matched);
+
+    /* max_interval 1 is the detector on every frame: nothing may change */
+    cfg.max_interval = 1;
+    replay(seq, n, &cfg, 0, &every);
+    print_stats("drift", "every", &every);
+    failures += check("max_interval 1 sends every detection", every.detects == n && every.matched == every.ref_boxes);
+
+    if (failures) {
+        printf("FAILED %d\n", failures);
+        return 1;
+    }
+    printf("PASSED\n");
+    return 0;
+}
@@ -0,0 +1,65 @@
+# directory declaration
+LIB_TRACKER_DIR = $(LIBRARIES_ROOT)/tracker
+
+LIB_TRACKER_ASMSRCDIR	= $(LIB_TRACKER_DIR)
+LIB_TRACKER_CSRCDIR	= $(LIB_TRACKER_DIR)
+LIB_TRACKER_CXXSRCSDIR    = $(LIB_TRACKER_DIR)
+LIB_TRACKER_INCDIR	= $(LIB_TRACKER_DIR)
+
+# find all the source files in the target directories
+LIB_TRACKER_CSRCS = $(call get_csrcs, $(LIB_TRACKER_CSRCDIR))
+LIB_TRACKER_CXXSRCS = $(call get_cxxsrcs, $(LIB_TRACKER_CXXSRCSDIR))
+LIB_TRACKER_ASMSRCS = $(call get_asmsrcs, $(LIB_TRACKER_ASMSRCDIR))
+
+# get object files
+LIB_TRACKER_COBJS = $(call get_relobjs, $(LIB_TRACKER_CSRCS))
+LIB_TRACKER_CXXOBJS = $(call get_relobjs, $(LIB_TRACKER_CXXSRCS))
+LIB_TRACKER_ASMOBJS = $(call get_relobjs, $(LIB_TRACKER_ASMSRCS))
+LIB_TRACKER_OBJS = $(LIB_TRACKER_COBJS) $(LIB_TRACKER_ASMOBJS) $(LIB_TRACKER_CXXOBJS)
+
+# get dependency files
+LIB_TRACKER_DEPS = $(call get_deps, $(LIB_TRACKER_OBJS))
+
+# extra macros to be defined
+LIB_TRACKER_DEFINES = -DLIB_TRACKER
+
+# genearte library
+ifeq ($(TRACKER_LIB_FORCE_PREBUILT), y)
+override LIB_TRACKER_OBJS:=
+endif
+TRACKER_LIB_NAME = lib_tracker.a
+LIB_LIB_TRACKER := $(subst /,$(PS), $(strip $(OUT_DIR)/$(TRACKER_LIB_NAME)))
+
+# library generation rule
+$(LIB_LIB_TRACKER): $(LIB_TRACKER_OBJS)
+	$(TRACE_ARCHIVE)
+ifeq "$(strip $(LIB_TRACKER_OBJS))" ""
+	$(CP) $(PREBUILT_LIB)$(TRACKER_LIB_NAME) $(LIB_LIB_TRACKER)
+else
+	$(Q)$(AR) $(AR_OPT) $@ $(LIB_TRACKER_OBJS)
+	$(CP) $(LIB_LIB_TRACKER) $(PREBUILT_LIB)$(TRACKER_LIB_NAME)
+endif
+
+# specific compile rules
+# user can add rules to compile this middleware
+# if not rules specified to this middleware, it will use default compiling rules
+
+# Middleware Definitions
+LIB_INCDIR += $(LIB_TRACKER_INCDIR)
+LIB_CSRCDIR += $(LIB_TRACKER_CSRCDIR)
+LIB_CXXSRCDIR += $(LIB_TRACKER_CXXSRCDIR)
+LIB_ASMSRCDIR += $(LIB_TRACKER_ASMSRCDIR)
+
+LIB_CSRCS += $(LIB_TRACKER_CSRCS)
+LIB_CXXSRCS += $(LIB_TRACKER_CXXSRCS)
+LIB_ASMSRCS += $(LIB_TRACKER_ASMSRCS)
+LIB_ALLSRCS += $(LIB_TRACKER_CSRCS) $(LIB_TRACKER_ASMSRCS)
+
+LIB_COBJS += $(LIB_TRACKER_COBJS)
+LIB_CXXOBJS += $(LIB_TRACKER_CXXOBJS)
+LIB_ASMOBJS += $(LIB_TRACKER_ASMOBJS)
+LIB_ALLOBJS += $(LIB_TRACKER_OBJS)
+
+LIB_DEFINES += $(LIB_TRACKER_DEFINES)
+LIB_DEPS += $(LIB_TRACKER_DEPS)
+LIB_LIBS += $(LIB_LIB_TRACKER)
\ No newline at end of file
@@ -27,6 +27,11 @@ DRESULT mmc_disk_write (const BYTE* buff, LBA_t sector, UINT count);
 DRESULT mmc_disk_ioctl (BYTE cmd, void* buff);
 void mmc_disk_timerproc (void);
 
+/* Weak wait hooks of the SPI port, see mmc_we2_spi.c */
+void mmc_spi_xfer_wait (void);      /* after a data block transfer is started */
+void mmc_spi_xfer_done (void);      /* the block transfer completed, interrupt context */
+void mmc_spi_delay_ms (UINT ms);    /* card busy polling interval */
+
 #ifdef __cplusplus
 }
 #endif
@@ -90,7 +90,7 @@ static BYTE CardType;    /* Card type flags */
 /*-----------------------------------------------------------------------*/
 /* SPI controls (Platform dependent)                                     */
 /*-----------------------------------------------------------------------*/
-#define DELAY(MS)   hx_drv_timer_cm55x_delay_ms(MS, TIMER_STATE_DC)
+#define DELAY(MS)   mmc_spi_delay_ms(MS)
 //#define DELAY(MS)   board_delay_ms(MS)
 
 #define MMC_WP()    0
@@ -118,6 +118,42 @@ static void wait_spi_completed(uint32_t data_count)
     while (Driver_SPI0.GetDataCount() < data_count);
 }
 
+/*-----------------------------------------------------------------------*/
+/* Wait hooks, weak: the defaults poll like wait_spi_completed(). An RTOS */
+/* build sleeps in mmc_spi_xfer_wait() until mmc_spi_xfer_done() is      */
+/* called from the SPI completion interrupt.                              */
+/*-----------------------------------------------------------------------*/
+static volatile BYTE block_xfer_pending;
+
+__WEAK void mmc_spi_xfer_wait(void)
+{
+}
+
+__WEAK void mmc_spi_xfer_done(void)
+{
+}
+
+__WEAK void mmc_spi_delay_ms(UINT ms)
+{
+    hx_drv_timer_cm55x_delay_ms(ms, TIMER_STATE_DC);
+}
+
+static void spi_event(uint32_t event)
+{
+    (void)event;
+    if (block_xfer_pending) {
+        block_xfer_pending = 0;
+        mmc_spi_xfer_done();
+    }
+}
+
+/* Data block transfers are the long ones; single bytes are not worth a sleep */
+static void wait_spi_block(uint32_t data_count)
+{
+    mmc_spi_xfer_wait();
+    wait_spi_completed(data_count);
+}
+
 /* Exchange a byte */
 static BYTE xchg_spi (
     BYTE dat    /* Data to send */
@@ -140,15 +176,17 @@ static void rcvr_spi_multi (
     uint32_t last_btr = btr - (block_num * 512);
 
     while (block_num) {    
+        block_xfer_pending = 1;
         Driver_SPI0.Receive(buff, 512);
-        wait_spi_completed(512);
+        wait_spi_block(512);
         block_num--;
         buff += 512;
     }
 
     if (last_btr) {
+        block_xfer_pending = 1;
         Driver_SPI0.Receive(buff, last_btr);
-        wait_spi_completed(last_btr);
+        wait_spi_block(last_btr);
     }
 }
 
@@ -163,15 +201,17 @@ static void xmit_spi_multi (
     uint32_t last_btx = btx - (block_num * 512);
 
     while (block_num) {    
+        block_xfer_pending = 1;
         Driver_SPI0.Send(buff, 512);
-        wait_spi_completed(512);
+        wait_spi_block(512);
         block_num--;
         buff += 512;
     }
 
     if (last_btx) {
+        block_xfer_pending = 1;
         Driver_SPI0.Send(buff, last_btx);
-        wait_spi_completed(last_btx);
+        wait_spi_block(last_btx);
     }
 }
 #endif
@@ -486,7 +526,7 @@ DSTATUS mmc_disk_initialize (void)
     if (Stat & STA_NODISK)
         return Stat;    /* Is card existing in the soket? */
 
-    ret = Driver_SPI0.Initialize(NULL); //HW Control CS
+    ret = Driver_SPI0.Initialize(spi_event); //HW Control CS
     ASSERT_HIGH(ret);
 
     ret = Driver_SPI0.PowerControl(ARM_POWER_FULL);
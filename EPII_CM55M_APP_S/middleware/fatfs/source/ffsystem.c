@@ -39,7 +39,11 @@ void ff_memfree (
 /* Definitions of Mutex                                                   */
 /*------------------------------------------------------------------------*/
 
+#ifdef FREERTOS
+#define OS_TYPE	3
+#else
 #define OS_TYPE	0	/* 0:Win32, 1:uITRON4.0, 2:uC/OS-II, 3:FreeRTOS, 4:CMSIS-RTOS */
+#endif
 
 
 #if   OS_TYPE == 0	/* Win32 */
@@ -96,6 +96,19 @@ extern uint32_t SystemCoreClock;
 /* Constants provided for debugging and optimisation assistance. */
 #define configCHECK_FOR_STACK_OVERFLOW        0
 #define configQUEUE_REGISTRY_SIZE             0
+
+/* Per task run time (uxTaskGetSystemState(), vTaskGetRunTimeStats()) is off
+ * by default. An application enables it with -DconfigGENERATE_RUN_TIME_STATS=1
+ * and provides the two functions below for the counter. */
+#ifndef configGENERATE_RUN_TIME_STATS
+#define configGENERATE_RUN_TIME_STATS         0
+#endif
+#if (configGENERATE_RUN_TIME_STATS == 1) && (defined(__ARMCC_VERSION) || defined(__GNUC__) || defined(__ICCARM__))
+extern void vConfigureTimerForRunTimeStats(void);
+extern uint32_t ulGetRunTimeCounterValue(void);
+#define portCONFIGURE_TIMER_FOR_RUN_TIME_STATS()    vConfigureTimerForRunTimeStats()
+#define portGET_RUN_TIME_COUNTER_VALUE()            ulGetRunTimeCounterValue()
+#endif
 #define configASSERT( x )                     if( ( x ) == 0 ) { taskDISABLE_INTERRUPTS(); for( ;; ); }
 
 /* Constants that define which hook (callback) functions should be used. */
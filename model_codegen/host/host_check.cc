@@ -0,0 +1,239 @@
+/*
+ * Host equivalence check and benchmark for tflite_codegen.py output.
+ *
+ * Runs the .tflite through the TFLM interpreter (CMSIS-NN kernels, plain C
+ * path) and the generated <name>_compiled_invoke() on the same random
+ * inputs, fails on the first output byte that differs and reports the
+ * average time per inference of both.
+ *
+ * With <name>_compiled_invoke_shifted() the same is done for a window
+ * sliding over a float stream one time step at a time: re-quantizing the
+ * whole window and re-running the interpreter or the compiled model on it,
+ * against quantizing only the new step into a ring and the shifted call.
+ *
+ * Usage: host_check <model.tflite> [iterations]
+ */
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "tensorflow/lite/micro/micro_interpreter.h"
+#include "tensorflow/lite/micro/micro_mutable_op_resolver.h"
+#include "tensorflow/lite/schema/schema_generated.h"
+
+#include "af_compiled.h"
+
+namespace {
+
+constexpr int kArenaSize = 128 * 1024;
+alignas(16) uint8_t tensor_arena[kArenaSize];
+
+uint32_t rng_state = 0x1234567u;
+
+int8_t rand_s8(void)
+{
+	rng_state = rng_state * 1664525u + 1013904223u;
+	return (int8_t)(rng_state >> 24);
+}
+
+std::vector<uint8_t> read_file(const char *path)
+{
+	std::vector<uint8_t> data;
+	FILE *f = fopen(path, "rb");
+	if (f == nullptr)
+		return data;
+	fseek(f, 0, SEEK_END);
+	data.resize(ftell(f));
+	fseek(f, 0, SEEK_SET);
+	if (fread(data.data(), 1, data.size(), f) != data.size())
+		data.clear();
+	fclose(f);
+	return data;
+}
+
+float rand_float(float scale, int zero_point)
+{
+	// Within the int8 range once quantized
+	return (rand_s8() - zero_point + (int)(rng_state >> 28) * 0.05f - 0.4f) * scale;
+}
+
+int8_t quantize(float value, float scale, int zero_point)
+{
+	// As run_af_model() in af_detect_testbench
+	return (int8_t)(roundf(value / scale) + zero_point);
+}
+
+template <typename F> double time_us(F fn, int runs)
+{
+	auto start = std::chrono::steady_clock::now();
+	for (int i = 0; i < runs; i++)
+		fn();
+	auto end = std::chrono::steady_clock::now();
+	return std::chrono::duration<double, std::micro>(end - start).count() / runs;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+	if (argc < 2) {
+		fprintf(stderr, "usage: %s <model.tflite> [iterations]\n", argv[0]);
+		return 1;
+	}
+	const int iterations = argc > 2 ? atoi(argv[2]) : 1000;
+
+	// Keep the flatbuffer 16-byte aligned like the firmware model arrays
+	std::vector<uint8_t> file = read_file(argv[1]);
+	if (file.empty()) {
+		fprintf(stderr, "%s: cannot read\n", argv[1]);
+		return 1;
+	}
+	std::vector<uint64_t> model_buf((file.size() + 7) / 8);
+	memcpy(model_buf.data(), file.data(), file.size());
+	const tflite::Model *model = tflite::GetModel(model_buf.data());
+
+	tflite::MicroMutableOpResolver<10> resolver;
+	resolver.AddConv2D();
+	resolver.AddFullyConnected();
+	resolver.AddMaxPool2D();
+	resolver.AddAveragePool2D();
+	resolver.AddLogistic();
+	resolver.AddRelu();
+	resolver.AddRelu6();
+	resolver.AddReshape();
+	resolver.AddExpandDims();
+	resolver.AddSqueeze();
+
+	tflite::MicroInterpreter interpreter(model, resolver, tensor_arena, kArenaSize);
+	if (interpreter.AllocateTensors() != kTfLiteOk) {
+		fprintf(stderr, "AllocateTensors failed\n");
+		return 1;
+	}
+	TfLiteTensor *input = interpreter.input(0);
+	TfLiteTensor *output = interpreter.output(0);
+	if (input->bytes != AF_COMPILED_INPUT_SIZE || output->bytes != AF_COMPILED_OUTPUT_SIZE) {
+		fprintf(stderr, "model I/O (%u, %u) does not match af_compiled.h (%d, %d)\n", (unsigned)input->bytes,
+			(unsigned)output->bytes, AF_COMPILED_INPUT_SIZE, AF_COMPILED_OUTPUT_SIZE);
+		return 1;
+	}
+	if (af_compiled_check() != 0) {
+		fprintf(stderr, "af_compiled_check: scratch buffer too small for this CMSIS-NN build\n");
+		return 1;
+	}
+	printf("arena used: %u bytes, compiled RAM: %d bytes\n", (unsigned)interpreter.arena_used_bytes(),
+	       AF_COMPILED_RAM_BYTES);
+
+	int8_t in[AF_COMPILED_INPUT_SIZE];
+	int8_t out[AF_COMPILED_OUTPUT_SIZE];
+	int histogram[4] = {0};
+	for (int it = 0; it < iterations; it++) {
+		for (int i = 0; i < AF_COMPILED_INPUT_SIZE; i++)
+			in[i] = rand_s8();
+		memcpy(input->data.int8, in, sizeof(in));
+		if (interpreter.Invoke() != kTfLiteOk) {
+			fprintf(stderr, "Invoke failed\n");
+			return 1;
+		}
+		if (af_compiled_invoke(in, out) != 0) {
+			fprintf(stderr, "af_compiled_invoke failed\n");
+			return 1;
+		}
+		for (int i = 0; i < AF_COMPILED_OUTPUT_SIZE; i++) {
+			if (out[i] != output->data.int8[i]) {
+				fprintf(stderr, "MISMATCH iteration %d output[%d]: compiled %d tflm %d\n", it, i, out[i],
+					output->data.int8[i]);
+				return 1;
+			}
+		}
+		histogram[(out[0] + 128) / 64]++;
+	}
+	printf("bit-exact over %d inputs, output quartiles: %d %d %d %d\n", iterations, histogram[0], histogram[1],
+	       histogram[2], histogram[3]);
+
+	const int runs = iterations * 10;
+	double tflm_us = time_us([&] { interpreter.Invoke(); }, runs);
+	double compiled_us = time_us([&] { af_compiled_invoke(in, out); }, runs);
+	printf("tflm: %.2f us/inference, compiled: %.2f us/inference (%.2fx)\n", tflm_us, compiled_us,
+	       tflm_us / compiled_us);
+
+#if AF_COMPILED_SHIFTED
+	constexpr int kWindow = AF_COMPILED_INPUT_SIZE, kStep = AF_COMPILED_STEP_SIZE;
+	const float scale = input->params.scale;
+	const int zero_point = input->params.zero_point;
+	std::vector<float> stream((size_t)(iterations + kWindow / kStep) * kStep);
+	for (auto &v : stream)
+		v = rand_float(scale, zero_point);
+
+	// The ring holds every step twice, so the window is always contiguous at ring + head
+	int8_t ring[2 * kWindow];
+	int head = 0;
+	auto push = [&](const float *step) {
+		for (int i = 0; i < kStep; i++)
+			ring[head + i] = ring[head + kWindow + i] = quantize(step[i], scale, zero_point);
+		head = (head + kStep) % kWindow;
+	};
+	auto slide = [&](bool check) {
+		int windows = 0;
+		for (int i = 0; i < kWindow; i += kStep)
+			push(&stream[i]);
+		if (af_compiled_invoke(ring + head, out) != 0)
+			return -1;
+		for (size_t pos = kWindow; pos < stream.size(); pos += kStep, windows++) {
+			push(&stream[pos]);
+			if (af_compiled_invoke_shifted(ring + head, out) != 0)
+				return -1;
+			if (!check)
+				continue;
+			memcpy(input->data.int8, ring + head, kWindow);
+			if (interpreter.Invoke() != kTfLiteOk || memcmp(out, output->data.int8, sizeof(out)) != 0) {
+				fprintf(stderr, "MISMATCH sliding window %d\n", windows);
+				return -1;
+			}
+		}
+		return windows;
+	};
+	auto requantize = [&](size_t pos) {
+		for (int i = 0; i < kWindow; i++)
+			in[i] = quantize(stream[pos - kWindow + kStep + i], scale, zero_point);
+	};
+
+	const int windows = slide(true);
+	if (windows < 0)
+		return 1;
+	printf("sliding window bit-exact over %d windows, %d time steps of %d values\n", windows, kWindow / kStep,
+	       kStep);
+
+	// Best of several passes over the stream, the differences are small next to host noise
+	auto best_us = [&](auto fn) {
+		double best = 1e30;
+		for (int i = 0; i < 7; i++) {
+			double us = time_us(fn, 1);
+			best = us < best ? us : best;
+		}
+		return best / windows;
+	};
+	double naive_tflm_us = best_us(
+		[&] {
+			for (size_t pos = kWindow; pos < stream.size(); pos += kStep) {
+				requantize(pos);
+				memcpy(input->data.int8, in, sizeof(in));
+				interpreter.Invoke();
+			}
+		});
+	double naive_compiled_us = best_us(
+		[&] {
+			for (size_t pos = kWindow; pos < stream.size(); pos += kStep) {
+				requantize(pos);
+				af_compiled_invoke(in, out);
+			}
+		});
+	double shifted_us = best_us([&] { slide(false); });
+	printf("per window: tflm %.2f us, compiled %.2f us, shifted %.2f us (%.2fx, %.2fx)\n", naive_tflm_us,
+	       naive_compiled_us, shifted_us, naive_tflm_us / shifted_us, naive_compiled_us / shifted_us);
+#endif
+	return 0;
+}
@@ -0,0 +1,201 @@
+/*
+ * Writes an int8 .tflite with the layer structure of the AF dense model
+ * (models/v2_0_1_model_dense: 2x Conv1D+MaxPool, Dense(32, relu), Dense(1),
+ * sigmoid) and random, fixed-seed weights.
+ *
+ * Only the vela-compiled AF models are checked in, so this gives the
+ * codegen host check a CPU model with the same operators, shapes and
+ * quantization layout to compare against TFLM.
+ *
+ * Usage: make_test_model <out.tflite> [seed]
+ */
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "tensorflow/lite/schema/schema_generated.h"
+
+namespace {
+
+using flatbuffers::FlatBufferBuilder;
+using flatbuffers::Offset;
+
+uint32_t rng_state = 1;
+
+int32_t rand_range(int32_t lo, int32_t hi)
+{
+	rng_state = rng_state * 1664525u + 1013904223u;
+	return lo + (int32_t)((rng_state >> 8) % (uint32_t)(hi - lo + 1));
+}
+
+struct ModelWriter {
+	// TFLM's trimmed flatbuffers has no implicit default allocator
+	flatbuffers::DefaultAllocator allocator;
+	FlatBufferBuilder fbb{16 * 1024, &allocator};
+	std::vector<Offset<tflite::Buffer>> buffers;
+	std::vector<Offset<tflite::Tensor>> tensors;
+	std::vector<Offset<tflite::Operator>> ops;
+	std::vector<tflite::BuiltinOperator> opcodes;
+
+	ModelWriter()
+	{
+		// Buffer 0 is the empty sentinel by convention
+		buffers.push_back(tflite::CreateBuffer(fbb));
+	}
+
+	uint32_t add_buffer(const void *data, size_t size)
+	{
+		fbb.ForceVectorAlignment(size, 1, 16);
+		auto vec = fbb.CreateVector(static_cast<const uint8_t *>(data), size);
+		buffers.push_back(tflite::CreateBuffer(fbb, vec));
+		return (uint32_t)buffers.size() - 1;
+	}
+
+	int add_tensor(const char *name, std::vector<int32_t> shape, tflite::TensorType type,
+		       std::vector<float> scales, std::vector<int64_t> zero_points, uint32_t buffer = 0)
+	{
+		auto quant = tflite::CreateQuantizationParameters(fbb, 0, 0, fbb.CreateVector(scales),
+								  fbb.CreateVector(zero_points));
+		tensors.push_back(tflite::CreateTensor(fbb, fbb.CreateVector(shape), type, buffer,
+						       fbb.CreateString(name), quant));
+		return (int)tensors.size() - 1;
+	}
+
+	int add_activation(const char *name, std::vector<int32_t> shape, float scale, int64_t zero_point)
+	{
+		return add_tensor(name, shape, tflite::TensorType_INT8, {scale}, {zero_point});
+	}
+
+	uint32_t opcode(tflite::BuiltinOperator code)
+	{
+		for (size_t i = 0; i < opcodes.size(); i++) {
+			if (opcodes[i] == code)
+				return (uint32_t)i;
+		}
+		opcodes.push_back(code);
+		return (uint32_t)opcodes.size() - 1;
+	}
+
+	void add_op(tflite::BuiltinOperator code, std::vector<int32_t> inputs, std::vector<int32_t> outputs,
+		    tflite::BuiltinOptions options_type = tflite::BuiltinOptions_NONE, Offset<void> options = 0)
+	{
+		ops.push_back(tflite::CreateOperator(fbb, opcode(code), fbb.CreateVector(inputs),
+						     fbb.CreateVector(outputs), options_type, options));
+	}
+
+	/* Conv2D with per-channel int8 weights and int32 bias, 1xK kernel (Conv1D as converted by TFLite) */
+	int conv(int input, float in_scale, int in_c, int out_c, int k, tflite::Padding padding,
+		 std::vector<int32_t> out_shape, float out_scale, int64_t out_zp, float w_scale)
+	{
+		std::vector<int8_t> w(out_c * k * in_c);
+		std::vector<int32_t> b(out_c);
+		std::vector<float> w_scales(out_c), b_scales(out_c);
+		std::vector<int64_t> zeros(out_c, 0);
+		for (auto &v : w)
+			v = (int8_t)rand_range(-127, 127);
+		for (int c = 0; c < out_c; c++) {
+			w_scales[c] = w_scale * (1.0f + 0.25f * (c % 4));
+			b_scales[c] = in_scale * w_scales[c];
+			b[c] = rand_range(-2000, 2000);
+		}
+		int wt = add_tensor("conv_w", {out_c, 1, k, in_c}, tflite::TensorType_INT8, w_scales, zeros,
+				    add_buffer(w.data(), w.size()));
+		int bt = add_tensor("conv_b", {out_c}, tflite::TensorType_INT32, b_scales, zeros,
+				    add_buffer(b.data(), b.size() * 4));
+		int out = add_activation("conv", out_shape, out_scale, out_zp);
+		auto opts = tflite::CreateConv2DOptions(fbb, padding, 1, 1, tflite::ActivationFunctionType_RELU);
+		add_op(tflite::BuiltinOperator_CONV_2D, {input, wt, bt}, {out}, tflite::BuiltinOptions_Conv2DOptions,
+		       opts.Union());
+		return out;
+	}
+
+	int max_pool(int input, std::vector<int32_t> out_shape, float scale, int64_t zp)
+	{
+		int out = add_activation("pool", out_shape, scale, zp);
+		auto opts = tflite::CreatePool2DOptions(fbb, tflite::Padding_VALID, 2, 1, 2, 1);
+		add_op(tflite::BuiltinOperator_MAX_POOL_2D, {input}, {out}, tflite::BuiltinOptions_Pool2DOptions,
+		       opts.Union());
+		return out;
+	}
+
+	/* Per-tensor FullyConnected, as emitted by the converter for Dense layers */
+	int dense(int input, float in_scale, int in_n, int out_n, float w_scale, float out_scale, int64_t out_zp,
+		  tflite::ActivationFunctionType act)
+	{
+		std::vector<int8_t> w(out_n * in_n);
+		std::vector<int32_t> b(out_n);
+		for (auto &v : w)
+			v = (int8_t)rand_range(-127, 127);
+		for (auto &v : b)
+			v = rand_range(-2000, 2000);
+		int wt = add_tensor("dense_w", {out_n, in_n}, tflite::TensorType_INT8, {w_scale}, {0},
+				    add_buffer(w.data(), w.size()));
+		int bt = add_tensor("dense_b", {out_n}, tflite::TensorType_INT32, {in_scale * w_scale}, {0},
+				    add_buffer(b.data(), b.size() * 4));
+		int out = add_activation("dense", {1, out_n}, out_scale, out_zp);
+		auto opts = tflite::CreateFullyConnectedOptions(fbb, act);
+		add_op(tflite::BuiltinOperator_FULLY_CONNECTED, {input, wt, bt}, {out},
+		       tflite::BuiltinOptions_FullyConnectedOptions, opts.Union());
+		return out;
+	}
+
+	void finish(int input, int output)
+	{
+		std::vector<Offset<tflite::OperatorCode>> codes;
+		for (auto code : opcodes)
+			codes.push_back(tflite::CreateOperatorCode(fbb, (int8_t)code, 0, 1, code));
+		std::vector<int32_t> inputs = {input}, outputs = {output};
+		auto subgraph = tflite::CreateSubGraph(fbb, fbb.CreateVector(tensors), fbb.CreateVector(inputs),
+						       fbb.CreateVector(outputs), fbb.CreateVector(ops));
+		std::vector<Offset<tflite::SubGraph>> subgraphs = {subgraph};
+		auto model = tflite::CreateModel(fbb, 3, fbb.CreateVector(codes), fbb.CreateVector(subgraphs),
+						 fbb.CreateString("af_dense_test"), fbb.CreateVector(buffers));
+		tflite::FinishModelBuffer(fbb, model);
+	}
+};
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+	if (argc < 2) {
+		fprintf(stderr, "usage: %s <out.tflite> [seed]\n", argv[0]);
+		return 1;
+	}
+	if (argc > 2)
+		rng_state = (uint32_t)strtoul(argv[2], nullptr, 0);
+
+	ModelWriter m;
+	const float in_scale = 1.7477f, c1_scale = 1.0f, c2_scale = 0.7f, d1_scale = 0.5f, d2_scale = 0.1f;
+
+	int input = m.add_activation("input", {1, 40, 1}, in_scale, -17);
+	int x = m.add_activation("input_4d", {1, 1, 40, 1}, in_scale, -17);
+	m.add_op(tflite::BuiltinOperator_RESHAPE, {input}, {x});
+
+	x = m.conv(x, in_scale, 1, 48, 5, tflite::Padding_SAME, {1, 1, 40, 48}, c1_scale, -128, 0.004f);
+	x = m.max_pool(x, {1, 1, 20, 48}, c1_scale, -128);
+	x = m.conv(x, c1_scale, 48, 96, 5, tflite::Padding_VALID, {1, 1, 16, 96}, c2_scale, -128, 0.001f);
+	x = m.max_pool(x, {1, 1, 8, 96}, c2_scale, -128);
+
+	int flat = m.add_activation("flatten", {1, 8 * 96}, c2_scale, -128);
+	m.add_op(tflite::BuiltinOperator_RESHAPE, {x}, {flat});
+
+	x = m.dense(flat, c2_scale, 8 * 96, 32, 0.0005f, d1_scale, -128, tflite::ActivationFunctionType_RELU);
+	x = m.dense(x, d1_scale, 32, 1, 0.002f, d2_scale, 0, tflite::ActivationFunctionType_NONE);
+
+	int output = m.add_activation("sigmoid", {1, 1}, 1.0f / 256, -128);
+	m.add_op(tflite::BuiltinOperator_LOGISTIC, {x}, {output});
+	m.finish(input, output);
+
+	FILE *f = fopen(argv[1], "wb");
+	if (f == nullptr) {
+		perror(argv[1]);
+		return 1;
+	}
+	fwrite(m.fbb.GetBufferPointer(), 1, m.fbb.GetSize(), f);
+	fclose(f);
+	printf("%s: %u bytes\n", argv[1], (unsigned)m.fbb.GetSize());
+	return 0;
+}
@@ -0,0 +1,740 @@
+#!/usr/bin/env python3
+"""Compile a small int8 .tflite model into a static C++ inference function.
+
+The generated <name>_compiled.cc calls the CMSIS-NN kernels of every operator
+in sequence with all parameters folded into constants: weights, biases,
+requantization multipliers/shifts and FC kernel sums are const arrays, and
+activations live in one statically planned buffer. There is no flatbuffer
+parsing, no interpreter and no tensor arena at runtime.
+
+Parameters are derived exactly like the TFLM CMSIS-NN kernels do it in their
+Prepare() step, so the output is bit-exact with the interpreter (checked by
+host/Makefile and on target by af_detect_testbench).
+
+Supported operators (int8, per-channel conv / per-tensor FC):
+    CONV_2D, FULLY_CONNECTED, MAX_POOL_2D, AVERAGE_POOL_2D, LOGISTIC,
+    RELU, RELU6, RESHAPE, EXPAND_DIMS, SQUEEZE
+
+When the model input feeds a stride-1 1xK CONV_2D first (a Conv1D over the
+time steps), <name>_compiled_invoke_shifted() is generated as well: for an
+input that is the previous one advanced by one time step it keeps that
+conv's output columns in a persistent buffer, shifts them and computes
+only the columns that see the new step or the padding.
+
+Usage:
+    python3 tflite_codegen.py model.tflite --name af --out-dir <dir>
+"""
+import argparse
+import math
+import os
+import struct
+import sys
+
+# tflite schema constants (tensorflow/compiler/mlir/lite/schema/schema.fbs)
+OP_AVERAGE_POOL_2D = 1
+OP_CONV_2D = 3
+OP_FULLY_CONNECTED = 9
+OP_LOGISTIC = 14
+OP_MAX_POOL_2D = 17
+OP_RELU = 19
+OP_RELU6 = 21
+OP_RESHAPE = 22
+OP_SQUEEZE = 43
+OP_EXPAND_DIMS = 70
+OP_NAMES = {OP_AVERAGE_POOL_2D: 'AVERAGE_POOL_2D', OP_CONV_2D: 'CONV_2D', OP_FULLY_CONNECTED: 'FULLY_CONNECTED',
+            OP_LOGISTIC: 'LOGISTIC', OP_MAX_POOL_2D: 'MAX_POOL_2D', OP_RELU: 'RELU', OP_RELU6: 'RELU6',
+            OP_RESHAPE: 'RESHAPE', OP_SQUEEZE: 'SQUEEZE', OP_EXPAND_DIMS: 'EXPAND_DIMS'}
+ALIAS_OPS = (OP_RESHAPE, OP_SQUEEZE, OP_EXPAND_DIMS)
+
+TYPE_INT32 = 2
+TYPE_INT8 = 9
+
+PADDING_SAME = 0
+ACT_NONE, ACT_RELU, ACT_RELU_N1_TO_1, ACT_RELU6 = 0, 1, 2, 3
+
+BUF_ALIGN = 16
+
+
+class CodegenError(Exception):
+    pass
+
+
+class Table:
+    """Read-only view of a flatbuffer table."""
+
+    def __init__(self, buf, pos):
+        self.buf = buf
+        self.pos = pos
+        self.vtable = pos - struct.unpack_from('<i', buf, pos)[0]
+        self.vtable_len = struct.unpack_from('<H', buf, self.vtable)[0]
+
+    def _field(self, index):
+        entry = 4 + 2 * index
+        if entry >= self.vtable_len:
+            return 0
+        return struct.unpack_from('<H', self.buf, self.vtable + entry)[0]
+
+    def scalar(self, index, fmt, default=0):
+        off = self._field(index)
+        return struct.unpack_from('<' + fmt, self.buf, self.pos + off)[0] if off else default
+
+    def _indirect(self, index):
+        off = self._field(index)
+        if not off:
+            return None
+        pos = self.pos + off
+        return pos + struct.unpack_from('<I', self.buf, pos)[0]
+
+    def table(self, index):
+        pos = self._indirect(index)
+        return Table(self.buf, pos) if pos is not None else None
+
+    def _vector(self, index):
+        pos = self._indirect(index)
+        if pos is None:
+            return None, 0
+        return pos + 4, struct.unpack_from('<I', self.buf, pos)[0]
+
+    def tables(self, index):
+        pos, n = self._vector(index)
+        return [Table(self.buf, pos + 4 * i + struct.unpack_from('<I', self.buf, pos + 4 * i)[0]) for i in range(n)]
+
+    def scalars(self, index, fmt):
+        pos, n = self._vector(index)
+        size = struct.calcsize(fmt)
+        return [struct.unpack_from('<' + fmt, self.buf, pos + size * i)[0] for i in range(n)]
+
+    def bytes(self, index):
+        pos, n = self._vector(index)
+        return b'' if pos is None else self.buf[pos:pos + n]
+
+    def string(self, index):
+        pos, n = self._vector(index)
+        return None if pos is None else self.buf[pos:pos + n].decode('utf-8', 'replace')
+
+
+def f32(value):
+    """Rounds a Python float to float32, like the float arithmetic in TFLM."""
+    return struct.unpack('<f', struct.pack('<f', value))[0]
+
+
+def tf_round(value):
+    """std::round: half away from zero."""
+    return int(math.floor(abs(value) + 0.5)) * (1 if value >= 0 else -1)
+
+
+def quantize_multiplier(real):
+    """tflite::QuantizeMultiplier()."""
+    if real == 0.0:
+        return 0, 0
+    q, shift = math.frexp(real)
+    q_fixed = tf_round(q * (1 << 31))
+    if q_fixed == (1 << 31):
+        q_fixed //= 2
+        shift += 1
+    if shift < -31:
+        shift = 0
+        q_fixed = 0
+    return q_fixed, shift
+
+
+def activation_range(act, scale, zero_point):
+    """tflite::CalculateActivationRangeQuantized() for int8 outputs."""
+    def quantize(f):
+        return zero_point + int(tf_round(f32(f32(f) / f32(scale))))
+    if act == ACT_NONE:
+        return -128, 127
+    if act == ACT_RELU:
+        return max(-128, quantize(0.0)), 127
+    if act == ACT_RELU6:
+        return max(-128, quantize(0.0)), min(127, quantize(6.0))
+    if act == ACT_RELU_N1_TO_1:
+        return max(-128, quantize(-1.0)), min(127, quantize(1.0))
+    raise CodegenError('unsupported fused activation %d' % act)
+
+
+def compute_padding(stride, in_size, filter_size, out_size, dilation=1):
+    """tflite::ComputePaddingHeightWidth() for one dimension."""
+    effective = (filter_size - 1) * dilation + 1
+    total = max((out_size - 1) * stride + effective - in_size, 0)
+    return total // 2
+
+
+def align(value, alignment=BUF_ALIGN):
+    return (value + alignment - 1) // alignment * alignment
+
+
+class Tensor:
+    def __init__(self, index, table, buffers):
+        self.index = index
+        self.name = table.string(3) or 't%d' % index
+        self.shape = table.scalars(0, 'i')
+        self.type = table.scalar(1, 'b')
+        buffer_index = table.scalar(2, 'I')
+        self.data = buffers[buffer_index].bytes(0) if buffer_index < len(buffers) else b''
+        q = table.table(4)
+        self.scales = q.scalars(2, 'f') if q else []
+        self.zero_points = q.scalars(3, 'q') if q else []
+
+    @property
+    def size(self):
+        return max(1, math.prod(self.shape)) if self.shape else 1
+
+    @property
+    def scale(self):
+        return self.scales[0] if self.scales else 0.0
+
+    @property
+    def zero_point(self):
+        return int(self.zero_points[0]) if self.zero_points else 0
+
+    def values(self, fmt):
+        n = len(self.data) // struct.calcsize(fmt)
+        return list(struct.unpack_from('<%d%s' % (n, fmt), self.data))
+
+
+class Model:
+    def __init__(self, buf):
+        root = Table(buf, struct.unpack_from('<I', buf, 0)[0])
+        buffers = root.tables(4)
+        self.opcodes = [max(c.scalar(0, 'b'), c.scalar(3, 'i')) for c in root.tables(1)]
+        self.custom_codes = [c.string(1) for c in root.tables(1)]
+        subgraphs = root.tables(2)
+        if len(subgraphs) != 1:
+            raise CodegenError('only single-subgraph models are supported')
+        sg = subgraphs[0]
+        self.tensors = [Tensor(i, t, buffers) for i, t in enumerate(sg.tables(0))]
+        self.inputs = sg.scalars(1, 'i')
+        self.outputs = sg.scalars(2, 'i')
+        self.ops = []
+        for op in sg.tables(3):
+            index = op.scalar(0, 'I')
+            if self.opcodes[index] == 32:
+                raise CodegenError('custom op "%s" found, pass the model before vela compilation'
+                                   % self.custom_codes[index])
+            self.ops.append((self.opcodes[index], op.scalars(1, 'i'), op.scalars(2, 'i'), op.table(4)))
+        if len(self.inputs) != 1 or len(self.outputs) != 1:
+            raise CodegenError('only models with one input and one output are supported')
+        for t in (self.tensors[self.inputs[0]], self.tensors[self.outputs[0]]):
+            if t.type != TYPE_INT8:
+                raise CodegenError('input/output tensor %s must be int8' % t.name)
+
+
+def c_array(ctype, name, values, per_line=16, attr=''):
+    lines = ['%sconst %s %s[%d] = {' % (attr, ctype, name, len(values))]
+    for i in range(0, len(values), per_line):
+        lines.append('\t' + ', '.join(str(v) for v in values[i:i + per_line]) + ',')
+    lines.append('};')
+    return lines
+
+
+class Generator:
+    def __init__(self, model, name, source):
+        self.m = model
+        self.name = name
+        self.prefix = name.upper() + '_COMPILED'
+        self.source = source
+        self.consts = []
+        self.body = []
+        self.scratch = 0
+        self.scratch_checks = []
+        self.uses_logistic = False
+        self.shift = None
+
+    # -- sliding window ----------------------------------------------------
+    def plan_shift(self):
+        """Finds a first layer whose output columns can be reused when the input slides by one time step."""
+        m = self.m
+        aliases = {m.inputs[0]}
+        for step, (code, ins, outs, opts) in enumerate(m.ops):
+            if code in ALIAS_OPS and ins[0] in aliases:
+                aliases.add(outs[0])
+                continue
+            if not any(i in aliases for i in ins):
+                continue
+            if code != OP_CONV_2D or ins[0] not in aliases or outs[0] == m.outputs[0]:
+                return
+            inp, flt, out = m.tensors[ins[0]], m.tensors[ins[1]], m.tensors[outs[0]]
+            if len(inp.shape) != 4 or inp.shape[0] != 1 or inp.shape[1] != 1 or flt.shape[1] != 1:
+                return
+            if opts.scalar(1, 'i') != 1 or opts.scalar(4, 'i', 1) != 1:
+                return
+            in_w, k, out_w = inp.shape[2], flt.shape[2], out.shape[2]
+            pad = compute_padding(1, in_w, k, out_w) if opts.scalar(0, 'b') == PADDING_SAME else 0
+            # Output column j reads inputs j - pad .. j - pad + k - 1. Those that read only
+            # real inputs, in both this window and the previous one, are the previous column j + 1.
+            left, right = pad, in_w - k + pad
+            if right <= left:
+                return
+            self.shift = {'step': step, 'left': left, 'right': right, 'pad': pad, 'step_size': inp.shape[3],
+                          'out_w': out_w, 'out_c': out.shape[3], 'in_w': in_w, 'k': k}
+            return
+
+    # -- memory planning -------------------------------------------------
+    def plan_memory(self):
+        """Assigns every activation tensor a storage: input, output or a pool offset."""
+        m = self.m
+        group = {}
+        for t in range(len(m.tensors)):
+            group[t] = t
+        def find(t):
+            while group[t] != t:
+                t = group[t]
+            return t
+        for code, ins, outs, _ in m.ops:
+            if code in ALIAS_OPS:
+                group[find(outs[0])] = find(ins[0])
+
+        in_group = find(m.inputs[0])
+        out_group = find(m.outputs[0])
+        if in_group == out_group:
+            raise CodegenError('model output aliases its input')
+
+        first, last, size = {}, {}, {}
+        for step, (code, ins, outs, _) in enumerate(m.ops):
+            for t in [i for i in ins if i >= 0] + outs:
+                if m.tensors[t].data:
+                    continue
+                g = find(t)
+                first.setdefault(g, step)
+                last[g] = step
+                size[g] = max(size.get(g, 0), m.tensors[t].size)
+
+        placed = []
+        self.storage = {}
+        for g in sorted(first, key=lambda g: -size[g]):
+            if g == in_group:
+                self.storage[g] = 'input'
+                continue
+            if g == out_group:
+                self.storage[g] = 'output'
+                continue
+            if self.shift and g == find(m.ops[self.shift['step']][2][0]):
+                # Kept between calls for invoke_shifted(), outside the shared pool
+                self.storage[g] = 'shift'
+                continue
+            offset = 0
+            for (o, s, f, l) in sorted(placed):
+                overlap_time = not (l < first[g] or last[g] < f)
+                if overlap_time and offset + size[g] > o and offset < o + s:
+                    offset = align(o + s)
+            placed.append((offset, size[g], first[g], last[g]))
+            self.storage[g] = offset
+        self.pool_size = max([align(o + s) for o, s, _, _ in placed] + [BUF_ALIGN])
+        self.find = find
+
+    def ptr(self, t, const=False):
+        where = self.storage[self.find(t)]
+        if where == 'input':
+            return 'input' if const else 'const_cast<int8_t *>(input)'
+        if where == 'output':
+            return 'output'
+        if where == 'shift':
+            return 'shift_buf'
+        return '&activation_buf[%d]' % where
+
+    # -- operators ---------------------------------------------------------
+    def emit_conv(self, step, ins, outs, opts):
+        m = self.m
+        inp, flt, out = m.tensors[ins[0]], m.tensors[ins[1]], m.tensors[outs[0]]
+        bias = m.tensors[ins[2]] if len(ins) > 2 and ins[2] >= 0 else None
+        if len(inp.shape) != 4 or flt.type != TYPE_INT8 or inp.type != TYPE_INT8:
+            raise CodegenError('CONV_2D %s: only int8 NHWC is supported' % out.name)
+        padding, stride_w, stride_h = opts.scalar(0, 'b'), opts.scalar(1, 'i'), opts.scalar(2, 'i')
+        act = opts.scalar(3, 'b')
+        dil_w, dil_h = opts.scalar(4, 'i', 1), opts.scalar(5, 'i', 1)
+        n, in_h, in_w, in_c = inp.shape
+        out_c, k_h, k_w, f_c = flt.shape
+        _, out_h, out_w, _ = out.shape
+        pad_h = compute_padding(stride_h, in_h, k_h, out_h, dil_h) if padding == PADDING_SAME else 0
+        pad_w = compute_padding(stride_w, in_w, k_w, out_w, dil_w) if padding == PADDING_SAME else 0
+
+        mults, shifts = [], []
+        for c in range(out_c):
+            fs = flt.scales[c] if len(flt.scales) > 1 else flt.scales[0]
+            mult, shift = quantize_multiplier(inp.scale * fs / out.scale)
+            mults.append(mult)
+            shifts.append(shift)
+        act_min, act_max = activation_range(act, out.scale, out.zero_point)
+        biases = bias.values('i') if bias else [0] * out_c
+
+        p = 'op%d' % step
+        self.consts += c_array('int8_t', p + '_filter', flt.values('b'), attr='alignas(16) ')
+        self.consts += c_array('int32_t', p + '_bias', biases, 8)
+        self.consts += c_array('int32_t', p + '_multiplier', mults, 8)
+        self.consts += c_array('int32_t', p + '_shift', shifts, 16)
+        self.consts.append('')
+
+        col = in_c * k_w * k_h
+        # Largest of the MVE, DSP and 1xN im2col buffers of arm_convolve_wrapper_s8
+        self.scratch = max(self.scratch, 4 * align(col, 16), 4 * align(col, 4), 2 * (col + pad_w * in_c))
+
+        conv_params = ('{%d, %d, {%d, %d}, {%d, %d}, {%d, %d}, {%d, %d}}'
+                       % (-inp.zero_point, out.zero_point, stride_w, stride_h, pad_w, pad_h, dil_w, dil_h, act_min, act_max))
+        self.scratch_checks += [
+            '\t{',
+            '\t\tconst cmsis_nn_conv_params conv_params = %s;' % conv_params,
+            '\t\tconst cmsis_nn_dims input_dims = {%d, %d, %d, %d};' % (n, in_h, in_w, in_c),
+            '\t\tconst cmsis_nn_dims filter_dims = {%d, %d, %d, %d};' % (out_c, k_h, k_w, f_c),
+            '\t\tconst cmsis_nn_dims output_dims = {%d, %d, %d, %d};' % (n, out_h, out_w, out_c),
+            '\t\tif (arm_convolve_wrapper_s8_get_buffer_size(&conv_params, &input_dims, &filter_dims, &output_dims) >',
+            '\t\t    (int32_t)sizeof(scratch_buf))',
+            '\t\t\treturn -1;',
+            '\t}',
+        ]
+        self.body += [
+            '\t{',
+            '\t\tconst cmsis_nn_conv_params conv_params = %s;' % conv_params,
+            '\t\tconst cmsis_nn_per_channel_quant_params quant_params = {const_cast<int32_t *>(%s_multiplier), '
+            'const_cast<int32_t *>(%s_shift)};' % (p, p),
+            '\t\tconst cmsis_nn_dims input_dims = {%d, %d, %d, %d};' % (n, in_h, in_w, in_c),
+            '\t\tconst cmsis_nn_dims filter_dims = {%d, %d, %d, %d};' % (out_c, k_h, k_w, f_c),
+            '\t\tconst cmsis_nn_dims bias_dims = {1, 1, 1, %d};' % out_c,
+            '\t\tconst cmsis_nn_dims output_dims = {%d, %d, %d, %d};' % (n, out_h, out_w, out_c),
+            '\t\tif (arm_convolve_wrapper_s8(&ctx, &conv_params, &quant_params, &input_dims, %s, &filter_dims, %s_filter,'
+            % (self.ptr(ins[0], True), p),
+            '\t\t\t\t&bias_dims, %s_bias, &output_dims, %s) != ARM_CMSIS_NN_SUCCESS)' % (p, self.ptr(outs[0])),
+            '\t\t\treturn -1;',
+            '\t}',
+        ]
+        if self.shift and self.shift['step'] == step:
+            self.emit_conv_shifted(p, ins, inp, out, act_min, act_max, n, in_c, out_c, k_h, k_w, f_c)
+
+    def emit_conv_shifted(self, p, ins, inp, out, act_min, act_max, n, in_c, out_c, k_h, k_w, f_c):
+        """Columns [left, right) move one to the left; only the rest is recomputed."""
+        sh = self.shift
+        left, right, pad, in_w, out_w = sh['left'], sh['right'], sh['pad'], sh['in_w'], sh['out_w']
+        lines = [
+            '\tmemmove(&shift_buf[%d], &shift_buf[%d], %d);' % (left * out_c, (left + 1) * out_c, (right - left) * out_c),
+        ]
+        # (first input column, input width, left padding, first output column, output width)
+        parts = []
+        if left > 0:
+            parts.append((0, min(in_w, left - pad + k_w - 1), pad, 0, left))
+        parts.append((right - pad, in_w - (right - pad), 0, right, out_w - right))
+        for in_x, in_n, pad_x, out_x, out_n in parts:
+            params = ('{%d, %d, {1, 1}, {%d, 0}, {1, 1}, {%d, %d}}'
+                      % (-inp.zero_point, out.zero_point, pad_x, act_min, act_max))
+            lines += [
+                '\t{',
+                '\t\tconst cmsis_nn_conv_params conv_params = %s;' % params,
+                '\t\tconst cmsis_nn_per_channel_quant_params quant_params = {const_cast<int32_t *>(%s_multiplier), '
+                'const_cast<int32_t *>(%s_shift)};' % (p, p),
+                '\t\tconst cmsis_nn_dims input_dims = {%d, 1, %d, %d};' % (n, in_n, in_c),
+                '\t\tconst cmsis_nn_dims filter_dims = {%d, %d, %d, %d};' % (out_c, k_h, k_w, f_c),
+                '\t\tconst cmsis_nn_dims bias_dims = {1, 1, 1, %d};' % out_c,
+                '\t\tconst cmsis_nn_dims output_dims = {%d, 1, %d, %d};' % (n, out_n, out_c),
+                '\t\tif (arm_convolve_s8(&ctx, &conv_params, &quant_params, &input_dims, &%s[%d], &filter_dims, %s_filter,'
+                % (self.ptr(ins[0], True), in_x * in_c, p),
+                '\t\t\t\t&bias_dims, %s_bias, NULL, &output_dims, &shift_buf[%d]) != ARM_CMSIS_NN_SUCCESS)'
+                % (p, out_x * out_c),
+                '\t\t\treturn -1;',
+                '\t}',
+            ]
+        self.shift['body'] = lines
+        self.shift['cols'] = out_w - (right - left)
+
+    def emit_fc(self, step, ins, outs, opts):
+        m = self.m
+        inp, flt, out = m.tensors[ins[0]], m.tensors[ins[1]], m.tensors[outs[0]]
+        bias = m.tensors[ins[2]] if len(ins) > 2 and ins[2] >= 0 else None
+        if flt.type != TYPE_INT8 or inp.type != TYPE_INT8:
+            raise CodegenError('FULLY_CONNECTED %s: only int8 is supported' % out.name)
+        if len(flt.scales) > 1:
+            raise CodegenError('FULLY_CONNECTED %s: per-channel quantization is not supported' % out.name)
+        act = opts.scalar(0, 'b') if opts else ACT_NONE
+        out_depth, accum_depth = flt.shape
+        batches = inp.size // accum_depth
+        weights = flt.values('b')
+        biases = bias.values('i') if bias else [0] * out_depth
+
+        # FullyConnected uses the float product of the scales, see GetQuantizedConvolutionMultipler()
+        mult, shift = quantize_multiplier(f32(inp.scale * flt.scale) / out.scale)
+        act_min, act_max = activation_range(act, out.scale, out.zero_point)
+        input_offset, filter_offset = -inp.zero_point, -flt.zero_point
+        # arm_vector_sum_s8(): bias + lhs_offset * (row sum + cols * rhs_offset), read by the MVE kernel
+        kernel_sums = []
+        for r in range(out_depth):
+            row = sum(weights[r * accum_depth:(r + 1) * accum_depth])
+            kernel_sums.append(biases[r] + (input_offset * (row + accum_depth * filter_offset) if input_offset else 0))
+
+        p = 'op%d' % step
+        self.consts += c_array('int8_t', p + '_filter', weights, attr='alignas(16) ')
+        self.consts += c_array('int32_t', p + '_bias', biases, 8)
+        self.consts += c_array('int32_t', p + '_kernel_sum', kernel_sums, 8)
+        self.consts.append('')
+
+        self.body += [
+            '\t{',
+            '\t\tcmsis_nn_context fc_ctx = {const_cast<int32_t *>(%s_kernel_sum), (int32_t)sizeof(%s_kernel_sum)};'
+            % (p, p),
+            '\t\tconst cmsis_nn_fc_params fc_params = {%d, %d, %d, {%d, %d}};'
+            % (input_offset, filter_offset, out.zero_point, act_min, act_max),
+            '\t\tconst cmsis_nn_per_tensor_quant_params quant_params = {%d, %d};' % (mult, shift),
+            '\t\tconst cmsis_nn_dims input_dims = {%d, 1, 1, %d};' % (batches, accum_depth),
+            '\t\tconst cmsis_nn_dims filter_dims = {%d, 1, 1, %d};' % (accum_depth, out_depth),
+            '\t\tconst cmsis_nn_dims bias_dims = {1, 1, 1, %d};' % out_depth,
+            '\t\tconst cmsis_nn_dims output_dims = {%d, 1, 1, %d};' % (batches, out_depth),
+            '\t\tif (arm_fully_connected_s8(&fc_ctx, &fc_params, &quant_params, &input_dims, %s, &filter_dims, %s_filter,'
+            % (self.ptr(ins[0], True), p),
+            '\t\t\t\t&bias_dims, %s_bias, &output_dims, %s) != ARM_CMSIS_NN_SUCCESS)' % (p, self.ptr(outs[0])),
+            '\t\t\treturn -1;',
+            '\t}',
+        ]
+
+    def emit_pool(self, step, code, ins, outs, opts):
+        m = self.m
+        inp, out = m.tensors[ins[0]], m.tensors[outs[0]]
+        if len(inp.shape) != 4 or inp.type != TYPE_INT8:
+            raise CodegenError('%s %s: only int8 NHWC is supported' % (OP_NAMES[code], out.name))
+        padding, stride_w, stride_h = opts.scalar(0, 'b'), opts.scalar(1, 'i'), opts.scalar(2, 'i')
+        f_w, f_h, act = opts.scalar(3, 'i'), opts.scalar(4, 'i'), opts.scalar(5, 'b')
+        _, in_h, in_w, c = inp.shape
+        _, out_h, out_w, _ = out.shape
+        pad_h = compute_padding(stride_h, in_h, f_h, out_h) if padding == PADDING_SAME else 0
+        pad_w = compute_padding(stride_w, in_w, f_w, out_w) if padding == PADDING_SAME else 0
+        act_min, act_max = activation_range(act, out.scale, out.zero_point)
+        func = 'arm_max_pool_s8' if code == OP_MAX_POOL_2D else 'arm_avgpool_s8'
+        if code == OP_AVERAGE_POOL_2D:
+            self.scratch = max(self.scratch, 4 * c)
+            self.scratch_checks += [
+                '\t{',
+                '\t\tconst cmsis_nn_dims output_dims = {1, %d, %d, %d};' % (out_h, out_w, c),
+                '\t\tif (arm_avgpool_s8_get_buffer_size(output_dims.w, output_dims.c) > (int32_t)sizeof(scratch_buf))',
+                '\t\t\treturn -1;',
+                '\t}',
+            ]
+        self.body += [
+            '\t{',
+            '\t\tconst cmsis_nn_pool_params pool_params = {{%d, %d}, {%d, %d}, {%d, %d}};'
+            % (stride_w, stride_h, pad_w, pad_h, act_min, act_max),
+            '\t\tconst cmsis_nn_dims input_dims = {1, %d, %d, %d};' % (in_h, in_w, c),
+            '\t\tconst cmsis_nn_dims filter_dims = {1, %d, %d, 1};' % (f_h, f_w),
+            '\t\tconst cmsis_nn_dims output_dims = {1, %d, %d, %d};' % (out_h, out_w, c),
+            '\t\tif (%s(&ctx, &pool_params, &input_dims, %s, &filter_dims, &output_dims, %s) != ARM_CMSIS_NN_SUCCESS)'
+            % (func, self.ptr(ins[0], True), self.ptr(outs[0])),
+            '\t\t\treturn -1;',
+            '\t}',
+        ]
+
+    def emit_logistic(self, step, ins, outs):
+        m = self.m
+        inp, out = m.tensors[ins[0]], m.tensors[outs[0]]
+        if out.zero_point != -128:
+            raise CodegenError('LOGISTIC %s: output zero point must be -128' % out.name)
+        # CalculateArithmeticOpDataLogistic(), kInputIntegerBits = 4
+        q, left_shift = math.frexp(inp.scale * float(1 << (31 - 4)))
+        multiplier = tf_round(q * (1 << 31))
+        radius = int(math.floor(1.0 * ((1 << 4) - 1) * (1 << (31 - 4)) / (1 << left_shift)))
+        self.uses_logistic = True
+        self.body += [
+            '\ttflite::reference_integer_ops::Logistic(%d, %d, %d, %d, %d, %s, %s);'
+            % (inp.zero_point, radius, multiplier, left_shift, inp.size, self.ptr(ins[0], True), self.ptr(outs[0])),
+        ]
+
+    def emit_relu(self, step, code, ins, outs):
+        m = self.m
+        inp, out = m.tensors[ins[0]], m.tensors[outs[0]]
+        if inp.scale != out.scale or inp.zero_point != out.zero_point:
+            raise CodegenError('%s %s: requantizing activations are not supported' % (OP_NAMES[code], out.name))
+        act_min, act_max = activation_range(ACT_RELU if code == OP_RELU else ACT_RELU6, out.scale, out.zero_point)
+        self.body += [
+            '\tfor (int i = 0; i < %d; i++) {' % inp.size,
+            '\t\tconst int8_t v = %s[i];' % self.ptr(ins[0], True),
+            '\t\t%s[i] = v < %d ? %d : (v > %d ? %d : v);' % (self.ptr(outs[0]), act_min, act_min, act_max, act_max),
+            '\t}',
+        ]
+
+    def emit_alias(self, step, ins, outs):
+        if self.ptr(ins[0]) != self.ptr(outs[0]):
+            raise CodegenError('reshape between different storages')
+
+    def generate(self):
+        self.plan_shift()
+        self.plan_memory()
+        for step, (code, ins, outs, opts) in enumerate(self.m.ops):
+            if self.shift and self.shift['step'] == step:
+                self.shift['start'] = len(self.body)
+            self.body.append('\t/* op %d: %s -> %s */' % (step, OP_NAMES.get(code, code), self.m.tensors[outs[0]].name))
+            if code == OP_CONV_2D:
+                self.emit_conv(step, ins, outs, opts)
+            elif code == OP_FULLY_CONNECTED:
+                self.emit_fc(step, ins, outs, opts)
+            elif code in (OP_MAX_POOL_2D, OP_AVERAGE_POOL_2D):
+                self.emit_pool(step, code, ins, outs, opts)
+            elif code == OP_LOGISTIC:
+                self.emit_logistic(step, ins, outs)
+            elif code in (OP_RELU, OP_RELU6):
+                self.emit_relu(step, code, ins, outs)
+            elif code in ALIAS_OPS:
+                self.emit_alias(step, ins, outs)
+            else:
+                raise CodegenError('operator %s is not supported' % OP_NAMES.get(code, 'builtin %d' % code))
+            if self.shift and self.shift['step'] == step:
+                self.shift['end'] = len(self.body)
+
+    @property
+    def shift_size(self):
+        return self.shift['out_w'] * self.shift['out_c'] if self.shift else 0
+
+    def header(self):
+        inp = self.m.tensors[self.m.inputs[0]]
+        out = self.m.tensors[self.m.outputs[0]]
+        guard = self.prefix + '_H'
+        return '\n'.join([
+            '/* Generated by model_codegen/tflite_codegen.py from %s -- do not edit */' % self.source,
+            '#ifndef %s' % guard,
+            '#define %s' % guard,
+            '',
+            '#include <stdint.h>',
+            '',
+            '#define %s_INPUT_SIZE %d' % (self.prefix, inp.size),
+            '#define %s_OUTPUT_SIZE %d' % (self.prefix, out.size),
+            '#define %s_INPUT_SCALE %.9gf' % (self.prefix, inp.scale),
+            '#define %s_INPUT_ZERO_POINT %d' % (self.prefix, inp.zero_point),
+            '#define %s_OUTPUT_SCALE %.9gf' % (self.prefix, out.scale),
+            '#define %s_OUTPUT_ZERO_POINT %d' % (self.prefix, out.zero_point),
+            '/* Static RAM used: activations + CMSIS-NN scratch */',
+            '#define %s_RAM_BYTES %d' % (self.prefix, self.pool_size + align(self.scratch) + align(self.shift_size)),
+            '/* %s_compiled_invoke_shifted() is generated, for inputs advancing by STEP_SIZE values */' % self.name,
+            '#define %s_SHIFTED %d' % (self.prefix, 1 if self.shift else 0),
+            '#define %s_STEP_SIZE %d' % (self.prefix, self.shift['step_size'] if self.shift else 0),
+            '',
+            '#ifdef __cplusplus',
+            'extern "C" {',
+            '#endif',
+            '',
+            '/**',
+            ' * @brief Runs the compiled model, bit-exact with the TFLM CMSIS-NN kernels.',
+            ' *',
+            ' * @param input %d quantized input values.' % inp.size,
+            ' * @param output Buffer for %d quantized output values.' % out.size,
+            ' * @return 0 on success, -1 if a kernel rejected its parameters.',
+            ' */',
+            'int %s_compiled_invoke(const int8_t *input, int8_t *output);' % self.name,
+            '',
+            '/**',
+            ' * @brief Checks the static scratch buffer against the CMSIS-NN build in use.',
+            ' *',
+            ' * The generator sizes it for the MVE, DSP and plain C kernels alike, call',
+            ' * this once at startup to catch a CMSIS-NN version with larger buffers.',
+            ' *',
+            ' * @return 0 if every layer fits, -1 otherwise.',
+            ' */',
+            'int %s_compiled_check(void);' % self.name,
+            '',
+        ] + ([
+            '/**',
+            ' * @brief Runs the compiled model on the previous input advanced by one time step.',
+            ' *',
+            ' * input must equal the input of the previous invoke call, either one, with',
+            ' * its first time step (%d int8 values) dropped and a new one appended. The'
+            % self.shift['step_size'],
+            ' * output columns of the first convolution are kept from that call, only',
+            ' * %d of %d are computed. Call %s_compiled_invoke() for the first window'
+            % (self.shift['cols'], self.shift['out_w'], self.name),
+            ' * and after any gap. The output is the same as %s_compiled_invoke().' % self.name,
+            ' *',
+            ' * @return 0 on success, -1 if a kernel rejected its parameters.',
+            ' */',
+            'int %s_compiled_invoke_shifted(const int8_t *input, int8_t *output);' % self.name,
+            '',
+        ] if self.shift else []) + [
+            '#ifdef __cplusplus',
+            '}',
+            '#endif',
+            '',
+            '#endif /* %s */' % guard,
+            '',
+        ])
+
+    def source_file(self):
+        lines = [
+            '/* Generated by model_codegen/tflite_codegen.py from %s -- do not edit */' % self.source,
+            '#include "%s_compiled.h"' % self.name,
+            '#include "arm_nnfunctions.h"',
+        ]
+        if self.shift:
+            lines.append('#include <string.h>')
+        if self.uses_logistic:
+            lines.append('#include "tensorflow/lite/kernels/internal/reference/integer_ops/logistic.h"')
+        lines += [
+            '',
+            'namespace {',
+            '',
+        ]
+        lines += self.consts
+        lines += [
+            'alignas(16) int8_t activation_buf[%d];' % self.pool_size,
+            'alignas(16) int8_t scratch_buf[%d];' % max(align(self.scratch), BUF_ALIGN),
+        ]
+        if self.shift:
+            lines.append('alignas(16) int8_t shift_buf[%d];' % align(self.shift_size))
+        lines += [
+            '',
+            '} // namespace',
+            '',
+            'extern "C" int %s_compiled_invoke(const int8_t *input, int8_t *output)' % self.name,
+            '{',
+            '\tcmsis_nn_context ctx = {scratch_buf, (int32_t)sizeof(scratch_buf)};',
+            '\t(void)ctx;',
+            '',
+        ]
+        lines += self.body
+        lines += [
+            '\treturn 0;',
+            '}',
+            '',
+        ]
+        if self.shift:
+            lines += [
+                'extern "C" int %s_compiled_invoke_shifted(const int8_t *input, int8_t *output)' % self.name,
+                '{',
+                '\tcmsis_nn_context ctx = {scratch_buf, (int32_t)sizeof(scratch_buf)};',
+                '\t(void)ctx;',
+                '',
+                '\t/* op %d: %s columns %d..%d kept */' % (self.shift['step'], OP_NAMES[OP_CONV_2D],
+                                                          self.shift['left'], self.shift['right'] - 1),
+            ]
+            lines += self.shift['body']
+            lines += self.body[self.shift['end']:]
+            lines += [
+                '\treturn 0;',
+                '}',
+                '',
+            ]
+        lines += [
+            'extern "C" int %s_compiled_check(void)' % self.name,
+            '{',
+        ]
+        lines += self.scratch_checks
+        lines += [
+            '\treturn 0;',
+            '}',
+            '',
+        ]
+        return '\n'.join(lines)
+
+
+if __name__ == '__main__':
+    parser = argparse.ArgumentParser(description=__doc__.split('\n')[0])
+    parser.add_argument('model', help='int8 .tflite (before vela compilation)')
+    parser.add_argument('--name', default='af', help='Symbol prefix: <name>_compiled_invoke(), <NAME>_COMPILED_*')
+    parser.add_argument('--out-dir', default='.', help='Directory for <name>_compiled.h/.cc')
+    args = parser.parse_args()
+
+    with open(args.model, 'rb') as f:
+        data = f.read()
+    try:
+        gen = Generator(Model(data), args.name, os.path.basename(args.model))
+        gen.generate()
+    except CodegenError as e:
+        sys.exit('%s: %s' % (args.model, e))
+
+    os.makedirs(args.out_dir, exist_ok=True)
+    with open(os.path.join(args.out_dir, args.name + '_compiled.h'), 'w') as f:
+        f.write(gen.header())
+    with open(os.path.join(args.out_dir, args.name + '_compiled.cc'), 'w') as f:
+        f.write(gen.source_file())
+    print('%s: %d ops, %d bytes activations, %d bytes scratch' %
+          (args.model, len(gen.m.ops), gen.pool_size, align(gen.scratch)))
@@ -0,0 +1,291 @@
+#!/usr/bin/env python3
+"""Plan where models, weights and arenas live on WE2 (SRAM / PSRAM / flash).
+
+Reads the vela *_summary_*.csv of every model and the memory map of the
+application's linker script, then picks a tier for each model's weights so
+the predicted cycles (weighted by how often each model runs) are minimal:
+
+    sram   weights are burnt to flash and copied into SRAM at init
+    psram  weights are burnt to flash and copied into PSRAM at init
+    flash  weights are read by the NPU straight from the flash XIP window
+
+Arenas (vela feature maps) always go to SRAM. Outputs:
+
+    --header  model_placement.h   tier, flash offset and XIP address per model
+    --linker  model_placement.ld  SRAM section for the weight copies
+    --xmodem                      xmodem_send.py --model arguments to burn them
+
+Example for the AF testbench:
+
+    python3 model_placement_planner.py \\
+        --ld ../EPII_CM55M_APP_S/app/scenario_app/af_detect_testbench/af_detect_testbench.ld \\
+        --model af=../EPII_CM55M_APP_S/app/scenario_app/af_detect_testbench/models/v2_0_1_model_dense/model_summary_My_Sys_Cfg.csv@../EPII_CM55M_APP_S/app/scenario_app/af_detect_testbench/models/v2_0_1_model_dense/model_vela.tflite \\
+        --sram-reserved 0x60000 --xmodem \\
+        --header ../EPII_CM55M_APP_S/app/scenario_app/af_detect_testbench/model_placement.h \\
+        --linker ../EPII_CM55M_APP_S/app/scenario_app/af_detect_testbench/model_placement.ld
+"""
+import argparse
+import csv
+import itertools
+import os
+import re
+import sys
+
+FLASH_XIP_BASE = 0x3A000000
+FLASH_SECTOR = 0x1000
+DEF_DEVICE_ADDR_H = os.path.join(os.path.dirname(os.path.realpath(__file__)),
+                                 '..', 'EPII_CM55M_APP_S', 'device', 'inc', 'WE2_device_addr.h')
+TIERS = ['sram', 'psram', 'flash']
+# Beyond this many models the exhaustive search is replaced by a greedy one
+MAX_EXHAUSTIVE_MODELS = 10
+
+
+def parse_int(text):
+    return int(text, 0)
+
+
+def read_defines(path):
+    """Collects the plain #define NAME VALUE lines of a header."""
+    defines = {}
+    with open(path, 'r', errors='replace') as f:
+        for line in f:
+            line = line.split('//')[0]
+            m = re.match(r'\s*#define\s+(\w+)\s+(.+)', line)
+            if m:
+                defines[m.group(1)] = m.group(2).strip()
+    return defines
+
+
+def evaluate(expr, defines, depth=0):
+    """Evaluates a linker/C constant expression, expanding known defines."""
+    if depth > 16:
+        raise ValueError('define recursion while evaluating ' + expr)
+    def expand(m):
+        name = m.group(0)
+        if name in defines:
+            return '(' + str(evaluate(defines[name], defines, depth + 1)) + ')'
+        return name
+    expr = re.sub(r'/\*.*?\*/', '', expr)
+    expr = re.sub(r'\b(0[xX][0-9a-fA-F]+|\d+)[uUlL]*\b', lambda m: m.group(1), expr)
+    expr = re.sub(r'\b[A-Za-z_]\w*\b', expand, expr)
+    if re.search(r'[A-Za-z_]', re.sub(r'0[xX][0-9a-fA-F]+', '', expr)):
+        raise ValueError('unresolved symbol in ' + expr)
+    return int(eval(expr, {'__builtins__': {}}))
+
+
+def read_memory_map(ld_path, defines):
+    """Returns {region: (origin, length)} from the MEMORY block of a linker script."""
+    with open(ld_path, 'r', errors='replace') as f:
+        text = f.read()
+    block = re.search(r'MEMORY\s*\{(.*?)\}', text, re.S)
+    if not block:
+        raise ValueError('no MEMORY block in ' + ld_path)
+    regions = {}
+    for line in block.group(1).splitlines():
+        line = re.sub(r'/\*.*?\*/', '', line)
+        m = re.match(r'\s*(\w+)\s*\([^)]*\)\s*:\s*ORIGIN\s*=\s*(.+?)\s*,\s*LENGTH\s*=\s*(.+?)\s*$', line)
+        if m:
+            regions[m.group(1)] = (evaluate(m.group(2), defines), evaluate(m.group(3), defines))
+    return regions
+
+
+def read_map_usage(map_path, origin, length):
+    """Sums the output sections of a GNU ld map file that fall into a region."""
+    used = 0
+    with open(map_path, 'r', errors='replace') as f:
+        for line in f:
+            m = re.match(r'^(\.\S+)\s+0x([0-9a-fA-F]+)\s+0x([0-9a-fA-F]+)', line)
+            if m and m.group(1) != '.model_plan_sram':
+                addr, size = int(m.group(2), 16), int(m.group(3), 16)
+                if origin <= addr < origin + length:
+                    used += size
+    return used
+
+
+class Model:
+    def __init__(self, name, summary_path, tflite_path, rate):
+        self.name = name
+        self.summary_path = summary_path
+        self.tflite_path = tflite_path
+        self.rate = rate
+        with open(summary_path, newline='') as f:
+            row = next(csv.DictReader(f))
+        num = lambda key: float(row.get(key) or 0.0)
+        self.cycles_total = num('cycles_total')
+        self.cycles_flash = num('cycles_off_chip_flash_access')
+        self.sram_bw = num('sram_bandwidth')
+        self.flash_bw = num('off_chip_flash_bandwidth')
+        self.weights_storage = row.get('weights_storage_area', '')
+        self.arena_bytes = int(num('sram_memory_used') * 1024 + 0.5)
+        if tflite_path:
+            self.size = os.path.getsize(tflite_path)
+        else:
+            self.size = int(num('off_chip_flash_memory_used') * 1024 + 0.5)
+        self.flash_offset = None
+        self.tier = None
+
+    def predicted_cycles(self, tier, psram_bw):
+        """Vela cycles with the flash access part rescaled to the tier's bandwidth."""
+        if tier == 'flash' or self.flash_bw == 0:
+            return self.cycles_total
+        bw = self.sram_bw if tier == 'sram' else psram_bw
+        return self.cycles_total - self.cycles_flash + self.cycles_flash * self.flash_bw / bw
+
+    def macro(self):
+        return 'MODEL_PLAN_' + re.sub(r'\W', '_', self.name).upper()
+
+
+def align(value, alignment):
+    return (value + alignment - 1) // alignment * alignment
+
+
+def plan(models, sram_budget, psram_budget, psram_bw):
+    """Chooses a tier per model minimizing rate-weighted predicted cycles."""
+    tiers = ['sram', 'flash'] + (['psram'] if psram_budget > 0 else [])
+
+    def cost(assignment):
+        sram = sum(align(m.size, 32) for m, t in zip(models, assignment) if t == 'sram')
+        psram = sum(align(m.size, 32) for m, t in zip(models, assignment) if t == 'psram')
+        if sram > sram_budget or psram > psram_budget:
+            return None
+        return sum(m.rate * m.predicted_cycles(t, psram_bw) for m, t in zip(models, assignment))
+
+    if len(models) <= MAX_EXHAUSTIVE_MODELS:
+        best = min((a for a in itertools.product(tiers, repeat=len(models)) if cost(a) is not None),
+                   key=cost)
+    else:
+        # Greedy: hand out the fastest tier to the models that save the most cycles per byte
+        best = ['flash'] * len(models)
+        for tier in [t for t in ['sram', 'psram'] if t in tiers]:
+            order = sorted(range(len(models)), reverse=True,
+                           key=lambda i: models[i].rate * (models[i].predicted_cycles('flash', psram_bw) -
+                                                           models[i].predicted_cycles(tier, psram_bw)) / max(models[i].size, 1))
+            for i in order:
+                if best[i] != 'flash':
+                    continue
+                best[i] = tier
+                if cost(best) is None:
+                    best[i] = 'flash'
+    for m, t in zip(models, best):
+        m.tier = t
+
+
+def assign_flash_offsets(models, flash_base, flash_size):
+    offset = flash_base
+    for m in models:
+        m.flash_offset = offset
+        offset = align(offset + m.size, FLASH_SECTOR)
+    if offset > flash_size:
+        raise ValueError('models need 0x%X bytes of flash, only 0x%X available' % (offset, flash_size))
+
+
+def write_header(path, models, psram_bw):
+    sram_total = sum(align(m.size, 32) for m in models if m.tier == 'sram')
+    psram_total = sum(align(m.size, 32) for m in models if m.tier == 'psram')
+    lines = [
+        '/* Generated by model_placement/model_placement_planner.py -- do not edit */',
+        '#ifndef MODEL_PLACEMENT_H',
+        '#define MODEL_PLACEMENT_H',
+        '',
+        '#define MODEL_TIER_SRAM  0',
+        '#define MODEL_TIER_PSRAM 1',
+        '#define MODEL_TIER_FLASH 2',
+        '',
+        '/* Bytes of the .model_plan_sram / PSRAM areas holding weight copies */',
+        '#define MODEL_PLAN_SRAM_BYTES  0x%X' % sram_total,
+        '#define MODEL_PLAN_PSRAM_BYTES 0x%X' % psram_total,
+        '',
+    ]
+    for m in models:
+        p = m.macro()
+        lines += [
+            '/* %s: %s, predicted %d cycles (flash %d) */' % (m.name, m.tier, m.predicted_cycles(m.tier, psram_bw), m.cycles_total),
+            '#define %s_TIER         MODEL_TIER_%s' % (p, m.tier.upper()),
+            '#define %s_SIZE         0x%X' % (p, m.size),
+            '#define %s_ARENA_SIZE   0x%X' % (p, m.arena_bytes),
+            '#define %s_FLASH_OFFSET 0x%X' % (p, m.flash_offset),
+            '#define %s_XIP_ADDR     0x%X' % (p, FLASH_XIP_BASE + m.flash_offset),
+            '',
+        ]
+    lines += ['#endif /* MODEL_PLACEMENT_H */', '']
+    with open(path, 'w') as f:
+        f.write('\n'.join(lines))
+
+
+def write_linker(path, models, sram_region):
+    sram_total = sum(align(m.size, 32) for m in models if m.tier == 'sram')
+    lines = [
+        '/* Generated by model_placement/model_placement_planner.py -- do not edit',
+        ' * Included inside SECTIONS of the application linker script. */',
+        '    .model_plan_sram (NOLOAD) : ALIGN(32)',
+        '    {',
+        '        KEEP(*(.model_plan_sram*))',
+        '    } > %s' % sram_region,
+        '    ASSERT(SIZEOF(.model_plan_sram) <= 0x%X, "model weight copies exceed the placement plan")' % max(sram_total, 0),
+        '',
+    ]
+    with open(path, 'w') as f:
+        f.write('\n'.join(lines))
+
+
+if __name__ == '__main__':
+    parser = argparse.ArgumentParser(description=__doc__.split('\n')[0])
+    parser.add_argument('--model', required=True, action='append',
+                        help='name=summary.csv[@model.tflite], repeat for every model')
+    parser.add_argument('--rate', action='append', default=[],
+                        help='name=invocations, relative weight of a model in the objective (default 1)')
+    parser.add_argument('--ld', required=True, help='Application linker script (*.ld)')
+    parser.add_argument('--device-addr', default=DEF_DEVICE_ADDR_H,
+                        help='Header with the address defines used by the linker script')
+    parser.add_argument('--sram-region', default='CM55M_S_SRAM', help='Linker MEMORY region for SRAM copies')
+    parser.add_argument('--map', help='GNU ld map file of the current build, to measure used SRAM')
+    parser.add_argument('--sram-reserved', type=parse_int, default=0,
+                        help='SRAM bytes already used by the application (ignored with --map)')
+    parser.add_argument('--psram-size', type=parse_int, default=0, help='PSRAM bytes available for weights')
+    parser.add_argument('--psram-bandwidth', type=float, default=0.2, help='PSRAM bandwidth in GB/s (vela units)')
+    parser.add_argument('--flash-base', type=parse_int, default=0x180000, help='First flash offset for models')
+    parser.add_argument('--flash-size', type=parse_int, default=0x1000000, help='Flash size in bytes')
+    parser.add_argument('--header', help='Write the firmware plan header here')
+    parser.add_argument('--linker', help='Write the linker section fragment here')
+    parser.add_argument('--xmodem', action='store_true', help='Print xmodem_send.py --model arguments')
+    args = parser.parse_args()
+
+    rates = {}
+    for item in args.rate:
+        name, value = item.split('=', 1)
+        rates[name] = float(value)
+
+    models = []
+    for item in args.model:
+        name, paths = item.split('=', 1)
+        summary, _, tflite = paths.partition('@')
+        models.append(Model(name, summary, tflite or None, rates.get(name, 1.0)))
+
+    defines = read_defines(args.device_addr)
+    regions = read_memory_map(args.ld, defines)
+    if args.sram_region not in regions:
+        sys.exit('region %s not in %s (%s)' % (args.sram_region, args.ld, ', '.join(regions)))
+    sram_origin, sram_length = regions[args.sram_region]
+    used = read_map_usage(args.map, sram_origin, sram_length) if args.map else args.sram_reserved
+    arenas = sum(align(m.arena_bytes, 32) for m in models)
+    sram_budget = sram_length - used - arenas
+    if sram_budget < 0:
+        sys.exit('arenas (0x%X) do not fit the free SRAM (0x%X)' % (arenas, sram_length - used))
+
+    plan(models, sram_budget, args.psram_size, args.psram_bandwidth)
+    assign_flash_offsets(models, args.flash_base, args.flash_size)
+
+    print('%s: 0x%08X + 0x%X, used 0x%X, arenas 0x%X, free for weights 0x%X' %
+          (args.sram_region, sram_origin, sram_length, used, arenas, sram_budget))
+    print('%-16s %-6s %8s %8s %10s %12s %12s' % ('model', 'tier', 'size', 'arena', 'flash', 'cycles', 'flash cycles'))
+    for m in models:
+        print('%-16s %-6s %8d %8d 0x%08X %12d %12d' % (m.name, m.tier, m.size, m.arena_bytes, m.flash_offset,
+                                                      m.predicted_cycles(m.tier, args.psram_bandwidth), m.cycles_total))
+    if args.header:
+        write_header(args.header, models, args.psram_bandwidth)
+    if args.linker:
+        write_linker(args.linker, models, args.sram_region)
+    if args.xmodem:
+        for m in models:
+            if m.tflite_path:
+                print('--model="%s 0x%X 0x0"' % (m.tflite_path, m.flash_offset))
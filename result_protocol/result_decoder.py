@@ -0,0 +1,216 @@
+#!/usr/bin/env python3
+"""Decode the binary result frames of the WE2 scenario apps.
+
+The YOLOv8 / YOLO11 object detection and YOLOv8 pose apps send one frame per
+inference when the transfer type is 3 (UART binary). Send the byte 252 to the
+device to select it (255 switches back to the JSON replies). The layout
+(little endian) is defined in the apps' send_result.h:
+
+    'H' 'X'  u8 version  u8 reserved  u32 payload length
+    payload: records of  u8 type  u32 length  data
+    u16 CRC-16/MAXIM of version .. end of payload
+
+Decode frames from a serial port or from a captured file:
+
+    python3 result_decoder.py --port /dev/ttyACM0 --baud 921600 --jpeg-dir out
+    python3 result_decoder.py capture.bin
+
+Compare JSON and binary frame rates for a frame of a given size:
+
+    python3 result_decoder.py --throughput --jpeg-bytes 30000 --boxes 10 \\
+        --baud 921600 --spi-mhz 20
+"""
+import argparse
+import os
+import struct
+import sys
+
+SYNC = b'HX'
+VERSION = 1
+HEADER = struct.Struct('<BBI')      # version, reserved, payload length
+RECORD = struct.Struct('<BI')       # type, length
+BOX = struct.Struct('<HHHHBB')      # x, y, w, h, score, target
+POINT = struct.Struct('<HHBB')      # x, y, score, target
+KEYPOINT_NUM = 17
+
+REC_ALGO_TICK = 1
+REC_RESOLUTION = 2
+REC_BOXES = 3
+REC_KEYPOINTS = 4
+REC_JPEG = 5
+
+# Frames larger than this are treated as a false sync
+MAX_PAYLOAD = 1 << 20
+
+
+def crc16_maxim(data, crc=0):
+    """CRC-16/MAXIM without the final xor, like el_crc16_maxim_update()"""
+    for b in data:
+        crc ^= b
+        for _ in range(8):
+            crc = (crc >> 1) ^ 0xA001 if crc & 1 else crc >> 1
+    return crc
+
+
+def decode_payload(payload):
+    """Returns a dict of the records in one frame payload"""
+    frame = {}
+    pos = 0
+    while pos < len(payload):
+        if pos + RECORD.size > len(payload):
+            raise ValueError('truncated record header at %d' % pos)
+        rtype, rlen = RECORD.unpack_from(payload, pos)
+        pos += RECORD.size
+        data = payload[pos:pos + rlen]
+        if len(data) != rlen:
+            raise ValueError('record %d truncated' % rtype)
+        pos += rlen
+        if rtype == REC_ALGO_TICK:
+            frame['algo_tick'] = struct.unpack('<I', data)[0]
+        elif rtype == REC_RESOLUTION:
+            frame['resolution'] = list(struct.unpack('<HH', data))
+        elif rtype == REC_BOXES:
+            frame['boxes'] = [list(b) for b in BOX.iter_unpack(data)]
+        elif rtype == REC_KEYPOINTS:
+            size = BOX.size + KEYPOINT_NUM * POINT.size
+            keypoints = []
+            for off in range(0, rlen, size):
+                box = list(BOX.unpack_from(data, off))
+                points = [list(POINT.unpack_from(data, off + BOX.size + i * POINT.size))
+                          for i in range(KEYPOINT_NUM)]
+                keypoints.append([box, points])
+            frame['keypoints'] = keypoints
+        elif rtype == REC_JPEG:
+            frame['jpeg'] = bytes(data)
+        else:
+            frame.setdefault('unknown', []).append((rtype, bytes(data)))
+    return frame
+
+
+class FrameDecoder:
+    """Feeds raw bytes, yields decoded frames; skips noise and bad frames"""
+
+    def __init__(self):
+        self.buf = bytearray()
+        self.crc_errors = 0
+        self.skipped = 0
+
+    def feed(self, data):
+        self.buf += data
+        while True:
+            start = self.buf.find(SYNC)
+            if start < 0:
+                keep = 1 if self.buf.endswith(SYNC[:1]) else 0
+                self.skipped += len(self.buf) - keep
+                del self.buf[:len(self.buf) - keep]
+                return
+            if start:
+                self.skipped += start
+                del self.buf[:start]
+            if len(self.buf) < len(SYNC) + HEADER.size:
+                return
+            version, _, length = HEADER.unpack_from(self.buf, len(SYNC))
+            if version != VERSION or length > MAX_PAYLOAD:
+                self.skipped += 1
+                del self.buf[:1]
+                continue
+            total = len(SYNC) + HEADER.size + length + 2
+            if len(self.buf) < total:
+                return
+            body = bytes(self.buf[len(SYNC):total - 2])
+            crc = struct.unpack_from('<H', self.buf, total - 2)[0]
+            if crc16_maxim(body) ^ 0xFFFF != crc:
+                self.crc_errors += 1
+                self.skipped += 1
+                del self.buf[:1]
+                continue
+            del self.buf[:total]
+            yield decode_payload(body[HEADER.size:])
+
+
+def json_reply_bytes(jpeg_bytes, boxes):
+    """Size of the JSON INVOKE reply of the object detection apps"""
+    box = '[%d, %d, %d, %d, %d, %d]' % (320, 240, 120, 200, 87, 0)
+    text = ('\r{"type": 1, "name": "INVOKE", "code": 0, "data": {"count": 0'
+            ', "algo_tick": [[%d]]' % 12345678 +
+            ', "boxes": [' + ', '.join([box] * boxes) + ']'
+            ', "image": "' + 'A' * (4 * ((jpeg_bytes + 2) // 3)) + '"}}\n')
+    return len(text)
+
+
+def binary_frame_bytes(jpeg_bytes, boxes):
+    payload = (RECORD.size + 4) + (RECORD.size + boxes * BOX.size) + (RECORD.size + jpeg_bytes)
+    return len(SYNC) + HEADER.size + payload + 2
+
+
+def throughput(args):
+    json_size = json_reply_bytes(args.jpeg_bytes, args.boxes)
+    bin_size = binary_frame_bytes(args.jpeg_bytes, args.boxes)
+    # 8N1 UART: 10 bit times per byte; SPI: 8 clocks per byte
+    links = [('UART %d baud' % args.baud, args.baud / 10.0),
+             ('SPI %g MHz' % args.spi_mhz, args.spi_mhz * 1e6 / 8.0)]
+    print('frame: %d byte JPEG, %d boxes' % (args.jpeg_bytes, args.boxes))
+    print('  JSON   %7d bytes' % json_size)
+    print('  binary %7d bytes (%.1f%%)' % (bin_size, 100.0 * bin_size / json_size))
+    for name, bytes_per_s in links:
+        print('%-22s JSON %6.2f frames/s, binary %6.2f frames/s' %
+              (name, bytes_per_s / json_size, bytes_per_s / bin_size))
+    print('(link time only: inference, capture and protocol overhead not included)')
+
+
+def print_frame(n, frame, jpeg_dir):
+    summary = {k: v for k, v in frame.items() if k != 'jpeg'}
+    if 'jpeg' in frame:
+        summary['jpeg_bytes'] = len(frame['jpeg'])
+        if jpeg_dir:
+            path = os.path.join(jpeg_dir, 'frame_%05d.jpg' % n)
+            with open(path, 'wb') as f:
+                f.write(frame['jpeg'])
+            summary['jpeg_file'] = path
+    print(summary)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('file', nargs='?', help='captured byte stream to decode')
+    parser.add_argument('--port', help='serial port to read frames from (needs pyserial)')
+    parser.add_argument('--baud', type=int, default=921600)
+    parser.add_argument('--jpeg-dir', help='save each frame JPEG in this directory')
+    parser.add_argument('--check', action='store_true', help='exit 1 if file has no frame, a CRC error or a truncated frame')
+    parser.add_argument('--throughput', action='store_true', help='print JSON vs binary frame rates and exit')
+    parser.add_argument('--jpeg-bytes', type=int, default=30000)
+    parser.add_argument('--boxes', type=int, default=10)
+    parser.add_argument('--spi-mhz', type=float, default=20.0)
+    args = parser.parse_args()
+
+    if args.throughput:
+        throughput(args)
+        return 0
+    if args.jpeg_dir:
+        os.makedirs(args.jpeg_dir, exist_ok=True)
+
+    decoder = FrameDecoder()
+    frames = 0
+    if args.port:
+        import serial
+        with serial.Serial(args.port, args.baud, timeout=0.1) as port:
+            while True:
+                for frame in decoder.feed(port.read(4096)):
+                    print_frame(frames, frame, args.jpeg_dir)
+                    frames += 1
+    elif args.file:
+        with open(args.file, 'rb') as f:
+            data = f.read()
+        for frame in decoder.feed(data):
+            print_frame(frames, frame, args.jpeg_dir)
+            frames += 1
+        print('%d frames, %d CRC errors, %d bytes skipped' % (frames, decoder.crc_errors, decoder.skipped + len(decoder.buf)))
+        if args.check and (frames == 0 or decoder.crc_errors or decoder.buf):
+            return 1
+    else:
+        parser.error('give a capture file, --port or --throughput')
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,86 @@
+#!/usr/bin/env python
+# Push .tflite models to the af_detect_testbench built with RUNTIME_MODEL_LOAD 2.
+#
+# The firmware prints "Waiting for xmodem model transfer" before each model,
+# runs the full testbench on it and then asks for the next one, so a single
+# flash image can sweep every model candidate:
+#
+#   python3 xmodem_model_push.py --port /dev/ttyACM0 --model a.tflite --model b.tflite
+import serial
+import xmodem
+import os
+import sys
+import argparse
+import math
+
+DEF_TIMEOUT = 60
+DEF_BAUDRATE = 115200
+PROMPT = 'Waiting for xmodem model transfer'
+
+def uart_open(com, baudrate, timeout):
+    ser = serial.Serial()
+    ser.port = com
+    ser.timeout = timeout
+    ser.baudrate = baudrate
+    ser.bytesize = serial.EIGHTBITS
+    ser.stopbits = serial.STOPBITS_ONE
+    ser.xonxoff = 0
+    ser.rtscts = 0
+    ser.parity = serial.PARITY_NONE
+    ser.open()
+    print("Open Serial Port", ser.port)
+    return ser
+
+def wait_for_prompt(ser):
+    # Echo the testbench log until the firmware is ready for the next model
+    while True:
+        response = ser.readline().decode('ascii', errors='replace').strip()
+        if response:
+            print(response)
+        if response.count(PROMPT) > 0:
+            return
+
+def push_model(ser, model_file, protocol):
+    packet_size = 1024 if protocol == 'xmodem1k' else 128
+    total_packets = math.ceil(os.path.getsize(model_file) / packet_size)
+
+    def callback(sent_packets, success_count, error_count):
+        print("\r{} {}/{} error: {}".format(os.path.basename(model_file), sent_packets, total_packets, error_count), end="")
+
+    modem = xmodem.XMODEM(getc=lambda size, timeout=1: ser.read(size),
+                          putc=lambda data, timeout=1: ser.write(data),
+                          mode=protocol)
+    with open(model_file, 'rb') as stream:
+        ret = modem.send(stream, callback=callback)
+    print("")
+    return ret
+
+if __name__ == '__main__':
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--port", required=True, type=str,
+                        help="Serial device port: COMn for windows; /dev/ttyUSBn,/dev/ttyACMn for unix")
+    parser.add_argument("--model", required=True, type=str, action='append',
+                        help="Model .tflite file, repeat to sweep several models")
+    parser.add_argument("--baudrate", default=DEF_BAUDRATE, type=lambda x: int(x, 0),
+                        help="Serial device baudrate. Default is " + str(DEF_BAUDRATE))
+    parser.add_argument("--protocol", default='xmodem1k', choices=['xmodem', 'xmodem1k'],
+                        help="File transfer protocol. Default is xmodem1k")
+    parser.add_argument("--timeout", default=DEF_TIMEOUT, type=lambda x: int(x, 0),
+                        help="Serial device timeout. Default is " + str(DEF_TIMEOUT))
+    args = parser.parse_args()
+
+    try:
+        ser = uart_open(args.port, args.baudrate, args.timeout)
+    except serial.SerialException:
+        print("Uart port open fail")
+        sys.exit(-1)
+
+    for model_file in args.model:
+        wait_for_prompt(ser)
+        print("xmodem_sending >>", model_file)
+        if not push_model(ser, model_file, args.protocol):
+            print("xmodem_send model FAIL!!!!")
+            sys.exit(-1)
+
+    # Show the log of the last run, the firmware stops after its next prompt times out
+    wait_for_prompt(ser)